@@ -0,0 +1,771 @@
+/* Copyright (C) 2020 Greenbone Networks GmbH
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file arrow_ipc.c
+ * @brief Apache Arrow IPC stream writer.
+ *
+ * Writes tables in the Arrow IPC streaming format, version 5, so that
+ * Arrow based tools can read them without any parsing.  Only flat tables
+ * of UTF-8, 64 bit integer and double columns are supported.
+ *
+ * The stream is a Schema message followed by a RecordBatch message for
+ * every ARROW_IPC_BATCH_ROWS rows and an end of stream marker.  The
+ * metadata of each message is a flatbuffer, which is built here by hand
+ * from front to back, so that every offset points forward as required.
+ */
+
+#include "arrow_ipc.h"
+
+#include <assert.h>
+#include <string.h>
+
+#undef G_LOG_DOMAIN
+/**
+ * @brief GLib log domain.
+ */
+#define G_LOG_DOMAIN "md manage"
+
+
+/* Arrow constants. */
+
+/**
+ * @brief MetadataVersion V5.
+ */
+#define ARROW_METADATA_V5 4
+
+/**
+ * @brief MessageHeader Schema.
+ */
+#define ARROW_HEADER_SCHEMA 1
+
+/**
+ * @brief MessageHeader RecordBatch.
+ */
+#define ARROW_HEADER_RECORD_BATCH 3
+
+/**
+ * @brief Type Int.
+ */
+#define ARROW_TYPE_ID_INT 2
+
+/**
+ * @brief Type FloatingPoint.
+ */
+#define ARROW_TYPE_ID_FLOATING_POINT 3
+
+/**
+ * @brief Type Utf8.
+ */
+#define ARROW_TYPE_ID_UTF8 5
+
+/**
+ * @brief Precision DOUBLE.
+ */
+#define ARROW_PRECISION_DOUBLE 2
+
+
+/* Flatbuffer building. */
+
+/**
+ * @brief Field of a flatbuffer table.
+ */
+typedef struct
+{
+  int size;          ///< Size of field: 1, 2, 4 or 8.  0 if absent.
+  gboolean offset;   ///< Whether the field is an offset to a later object.
+  guint64 value;     ///< Value, for a scalar field.
+} fb_field_t;
+
+/**
+ * @brief Maximum number of fields in a flatbuffer table.
+ */
+#define FB_MAX_FIELDS 8
+
+/**
+ * @brief Pad a buffer with zeros.
+ *
+ * @param[in]  fb     Buffer.
+ * @param[in]  align  Alignment to pad to.
+ */
+static void
+fb_pad (GByteArray *fb, guint align)
+{
+  static const guint8 zeros[8] = { 0 };
+
+  if (fb->len % align)
+    g_byte_array_append (fb, zeros, align - (fb->len % align));
+}
+
+/**
+ * @brief Write a little endian scalar into a buffer.
+ *
+ * @param[in]  fb        Buffer.
+ * @param[in]  position  Position in buffer.
+ * @param[in]  value     Value.
+ * @param[in]  size      Size of value in bytes.
+ */
+static void
+fb_set (GByteArray *fb, guint position, guint64 value, int size)
+{
+  int index;
+
+  for (index = 0; index < size; index++)
+    fb->data[position + index] = (value >> (8 * index)) & 0xFF;
+}
+
+/**
+ * @brief Append a little endian scalar to a buffer.
+ *
+ * @param[in]  fb     Buffer.
+ * @param[in]  value  Value.
+ * @param[in]  size   Size of value in bytes.
+ */
+static void
+fb_put (GByteArray *fb, guint64 value, int size)
+{
+  guint position;
+
+  position = fb->len;
+  g_byte_array_set_size (fb, position + size);
+  fb_set (fb, position, value, size);
+}
+
+/**
+ * @brief Point an offset slot at the end of a buffer.
+ *
+ * @param[in]  fb    Buffer.
+ * @param[in]  slot  Position of offset slot.
+ */
+static void
+fb_link (GByteArray *fb, guint slot)
+{
+  fb_set (fb, slot, fb->len - slot, 4);
+}
+
+/**
+ * @brief Append a table to a buffer.
+ *
+ * @param[in]  fb      Buffer.
+ * @param[in]  slot    Position of offset slot that must point to the table.
+ * @param[in]  fields  Fields, in order of field ID.
+ * @param[in]  count   Number of fields.
+ * @param[out] slots   Positions of the offset slots of offset fields.
+ */
+static void
+fb_table (GByteArray *fb, guint slot, const fb_field_t *fields, int count,
+          guint *slots)
+{
+  guint positions[FB_MAX_FIELDS];
+  guint size, vtable, table;
+  int index, width;
+
+  assert (count <= FB_MAX_FIELDS);
+
+  /* Lay the fields out after the vtable offset, widest first, so that each
+   * field is aligned. */
+
+  size = 4;
+  for (width = 8; width; width /= 2)
+    for (index = 0; index < count; index++)
+      if (fields[index].size == width)
+        {
+          size = (size + width - 1) & ~(width - 1);
+          positions[index] = size;
+          size += width;
+        }
+
+  /* The vtable comes first, so the table refers back to it. */
+
+  fb_pad (fb, 2);
+  vtable = fb->len;
+  fb_put (fb, 4 + 2 * count, 2);
+  fb_put (fb, size, 2);
+  for (index = 0; index < count; index++)
+    fb_put (fb, fields[index].size ? positions[index] : 0, 2);
+
+  fb_pad (fb, 8);
+  table = fb->len;
+  fb_set (fb, slot, table - slot, 4);
+  g_byte_array_set_size (fb, table + size);
+  memset (fb->data + table, 0, size);
+  fb_set (fb, table, table - vtable, 4);
+  for (index = 0; index < count; index++)
+    if (fields[index].size)
+      {
+        if (fields[index].offset)
+          slots[index] = table + positions[index];
+        else
+          fb_set (fb, table + positions[index], fields[index].value,
+                  fields[index].size);
+      }
+}
+
+/**
+ * @brief Append a string to a buffer.
+ *
+ * @param[in]  fb      Buffer.
+ * @param[in]  slot    Position of offset slot that must point to the string.
+ * @param[in]  string  String.
+ */
+static void
+fb_string (GByteArray *fb, guint slot, const char *string)
+{
+  fb_pad (fb, 4);
+  fb_link (fb, slot);
+  fb_put (fb, strlen (string), 4);
+  g_byte_array_append (fb, (const guint8 *) string, strlen (string) + 1);
+}
+
+/**
+ * @brief Append a vector of offsets to a buffer.
+ *
+ * @param[in]  fb      Buffer.
+ * @param[in]  slot    Position of offset slot that must point to the vector.
+ * @param[in]  count   Number of elements.
+ *
+ * @return Position of the slot of the first element.
+ */
+static guint
+fb_offset_vector (GByteArray *fb, guint slot, int count)
+{
+  guint first;
+
+  fb_pad (fb, 4);
+  fb_link (fb, slot);
+  fb_put (fb, count, 4);
+  first = fb->len;
+  g_byte_array_set_size (fb, first + 4 * count);
+  memset (fb->data + first, 0, 4 * count);
+  return first;
+}
+
+/**
+ * @brief Append a vector of 8 byte aligned structs to a buffer.
+ *
+ * @param[in]  fb       Buffer.
+ * @param[in]  slot     Position of offset slot that must point to the vector.
+ * @param[in]  structs  Structs, already in little endian.
+ * @param[in]  size     Size of a struct.
+ */
+static void
+fb_struct_vector (GByteArray *fb, guint slot, GByteArray *structs,
+                  guint size)
+{
+  /* The elements follow the 4 byte length, and must be 8 byte aligned. */
+  fb_pad (fb, 8);
+  fb_put (fb, 0, 4);
+  fb_link (fb, slot);
+  fb_put (fb, structs->len / size, 4);
+  g_byte_array_append (fb, structs->data, structs->len);
+}
+
+
+/* Writer. */
+
+/**
+ * @brief Data of a column in the current record batch.
+ */
+typedef struct
+{
+  const char *name;       ///< Name of column.
+  arrow_type_t type;      ///< Type of column.
+  GByteArray *validity;   ///< Validity bitmap.
+  GByteArray *values;     ///< Values, or offsets into data for strings.
+  GByteArray *data;       ///< String data.
+  gint64 null_count;      ///< Number of nulls.
+} arrow_column_data_t;
+
+/**
+ * @brief Arrow IPC stream writer.
+ */
+struct arrow_writer
+{
+  FILE *stream;                  ///< Stream to write to.
+  arrow_column_data_t *columns;  ///< Columns.
+  int column_count;              ///< Number of columns.
+  int column;                    ///< Next column of the current row.
+  gint64 rows;                   ///< Number of rows in the current batch.
+};
+
+/**
+ * @brief Empty the columns of a writer, for the next batch.
+ *
+ * @param[in]  writer  Writer.
+ */
+static void
+arrow_writer_reset (arrow_writer_t *writer)
+{
+  int index;
+
+  for (index = 0; index < writer->column_count; index++)
+    {
+      arrow_column_data_t *column;
+
+      column = &writer->columns[index];
+      g_byte_array_set_size (column->validity, 0);
+      g_byte_array_set_size (column->values, 0);
+      g_byte_array_set_size (column->data, 0);
+      column->null_count = 0;
+      if (column->type == ARROW_TYPE_UTF8)
+        fb_put (column->values, 0, 4);
+    }
+  writer->column = 0;
+  writer->rows = 0;
+}
+
+/**
+ * @brief Write a message to the stream of a writer.
+ *
+ * @param[in]  writer    Writer.
+ * @param[in]  metadata  Flatbuffer of Message.
+ * @param[in]  body      Body, or NULL.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+arrow_writer_message (arrow_writer_t *writer, GByteArray *metadata,
+                      GByteArray *body)
+{
+  GByteArray *prefix;
+  int ret;
+
+  fb_pad (metadata, 8);
+
+  prefix = g_byte_array_new ();
+  fb_put (prefix, 0xFFFFFFFF, 4);
+  fb_put (prefix, metadata->len, 4);
+
+  ret = fwrite (prefix->data, 1, prefix->len, writer->stream) < prefix->len
+        || fwrite (metadata->data, 1, metadata->len, writer->stream)
+           < metadata->len
+        || (body
+            && fwrite (body->data, 1, body->len, writer->stream) < body->len);
+  g_byte_array_free (prefix, TRUE);
+  if (ret)
+    {
+      g_warning ("%s: Failed to write message", __func__);
+      return -1;
+    }
+  return 0;
+}
+
+/**
+ * @brief Write the schema to the stream of a writer.
+ *
+ * @param[in]  writer  Writer.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+arrow_writer_schema (arrow_writer_t *writer)
+{
+  GByteArray *fb;
+  guint message_slots[4], schema_slots[2], field_slots[6], type_slots[2];
+  guint first, *name_slots, *type_table_slots, *children_slots;
+  int index, ret;
+
+  fb = g_byte_array_new ();
+  fb_put (fb, 0, 4);
+
+  {
+    fb_field_t fields[] = {{ 2, FALSE, ARROW_METADATA_V5 },
+                           { 1, FALSE, ARROW_HEADER_SCHEMA },
+                           { 4, TRUE, 0 },
+                           { 8, FALSE, 0 }};
+    fb_table (fb, 0, fields, 4, message_slots);
+  }
+
+  {
+    fb_field_t fields[] = {{ 2, FALSE, 0 },  /* Little endian. */
+                           { 4, TRUE, 0 }};
+    fb_table (fb, message_slots[2], fields, 2, schema_slots);
+  }
+
+  first = fb_offset_vector (fb, schema_slots[1], writer->column_count);
+
+  /* Write all the Field tables, then the objects they refer to. */
+
+  name_slots = g_malloc (writer->column_count * sizeof (guint));
+  type_table_slots = g_malloc (writer->column_count * sizeof (guint));
+  children_slots = g_malloc (writer->column_count * sizeof (guint));
+
+  for (index = 0; index < writer->column_count; index++)
+    {
+      int type_id;
+
+      switch (writer->columns[index].type)
+        {
+          case ARROW_TYPE_INT64:
+            type_id = ARROW_TYPE_ID_INT;
+            break;
+          case ARROW_TYPE_DOUBLE:
+            type_id = ARROW_TYPE_ID_FLOATING_POINT;
+            break;
+          default:
+            type_id = ARROW_TYPE_ID_UTF8;
+            break;
+        }
+
+      {
+        fb_field_t fields[] = {{ 4, TRUE, 0 },         /* name */
+                               { 1, FALSE, 1 },        /* nullable */
+                               { 1, FALSE, type_id },  /* type_type */
+                               { 4, TRUE, 0 },         /* type */
+                               { 0, FALSE, 0 },        /* dictionary */
+                               { 4, TRUE, 0 }};        /* children */
+        fb_table (fb, first + 4 * index, fields, 6, field_slots);
+      }
+      name_slots[index] = field_slots[0];
+      type_table_slots[index] = field_slots[3];
+      children_slots[index] = field_slots[5];
+    }
+
+  for (index = 0; index < writer->column_count; index++)
+    {
+      fb_string (fb, name_slots[index], writer->columns[index].name);
+
+      switch (writer->columns[index].type)
+        {
+          case ARROW_TYPE_INT64:
+            {
+              fb_field_t fields[] = {{ 4, FALSE, 64 },   /* bitWidth */
+                                     { 1, FALSE, 1 }};   /* is_signed */
+              fb_table (fb, type_table_slots[index], fields, 2, type_slots);
+            }
+            break;
+          case ARROW_TYPE_DOUBLE:
+            {
+              fb_field_t fields[] = {{ 2, FALSE, ARROW_PRECISION_DOUBLE }};
+              fb_table (fb, type_table_slots[index], fields, 1, type_slots);
+            }
+            break;
+          default:
+            fb_table (fb, type_table_slots[index], NULL, 0, type_slots);
+            break;
+        }
+
+      fb_offset_vector (fb, children_slots[index], 0);
+    }
+
+  g_free (name_slots);
+  g_free (type_table_slots);
+  g_free (children_slots);
+
+  ret = arrow_writer_message (writer, fb, NULL);
+  g_byte_array_free (fb, TRUE);
+  return ret;
+}
+
+/**
+ * @brief Append a buffer to the body of a record batch.
+ *
+ * @param[in]  body     Body.
+ * @param[in]  buffers  Buffer structs of the batch.
+ * @param[in]  data     Data of buffer, or NULL for an empty buffer.
+ */
+static void
+arrow_body_buffer (GByteArray *body, GByteArray *buffers, GByteArray *data)
+{
+  fb_put (buffers, body->len, 8);
+  fb_put (buffers, data ? data->len : 0, 8);
+  if (data)
+    {
+      g_byte_array_append (body, data->data, data->len);
+      fb_pad (body, 8);
+    }
+}
+
+/**
+ * @brief Write the current rows to the stream of a writer as a batch.
+ *
+ * @param[in]  writer  Writer.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+arrow_writer_batch (arrow_writer_t *writer)
+{
+  GByteArray *fb, *body, *nodes, *buffers;
+  guint message_slots[4], batch_slots[3];
+  int index, ret;
+
+  if (writer->rows == 0)
+    return 0;
+
+  body = g_byte_array_new ();
+  nodes = g_byte_array_new ();
+  buffers = g_byte_array_new ();
+
+  for (index = 0; index < writer->column_count; index++)
+    {
+      arrow_column_data_t *column;
+
+      column = &writer->columns[index];
+
+      fb_put (nodes, writer->rows, 8);
+      fb_put (nodes, column->null_count, 8);
+
+      arrow_body_buffer (body, buffers,
+                         column->null_count ? column->validity : NULL);
+      arrow_body_buffer (body, buffers, column->values);
+      if (column->type == ARROW_TYPE_UTF8)
+        arrow_body_buffer (body, buffers, column->data);
+    }
+
+  fb = g_byte_array_new ();
+  fb_put (fb, 0, 4);
+
+  {
+    fb_field_t fields[] = {{ 2, FALSE, ARROW_METADATA_V5 },
+                           { 1, FALSE, ARROW_HEADER_RECORD_BATCH },
+                           { 4, TRUE, 0 },
+                           { 8, FALSE, body->len }};
+    fb_table (fb, 0, fields, 4, message_slots);
+  }
+
+  {
+    fb_field_t fields[] = {{ 8, FALSE, writer->rows },
+                           { 4, TRUE, 0 },
+                           { 4, TRUE, 0 }};
+    fb_table (fb, message_slots[2], fields, 3, batch_slots);
+  }
+
+  fb_struct_vector (fb, batch_slots[1], nodes, 16);
+  fb_struct_vector (fb, batch_slots[2], buffers, 16);
+
+  ret = arrow_writer_message (writer, fb, body);
+
+  g_byte_array_free (fb, TRUE);
+  g_byte_array_free (body, TRUE);
+  g_byte_array_free (nodes, TRUE);
+  g_byte_array_free (buffers, TRUE);
+
+  arrow_writer_reset (writer);
+  return ret;
+}
+
+/**
+ * @brief Create a writer, writing the schema.
+ *
+ * @param[in]  stream   Stream to write to.
+ * @param[in]  columns  Columns of table.
+ * @param[in]  count    Number of columns.
+ *
+ * @return Writer, or NULL on error.
+ */
+arrow_writer_t *
+arrow_writer_new (FILE *stream, const arrow_column_t *columns, int count)
+{
+  arrow_writer_t *writer;
+  int index;
+
+  writer = g_malloc0 (sizeof (arrow_writer_t));
+  writer->stream = stream;
+  writer->column_count = count;
+  writer->columns = g_malloc0 (count * sizeof (arrow_column_data_t));
+  for (index = 0; index < count; index++)
+    {
+      writer->columns[index].name = columns[index].name;
+      writer->columns[index].type = columns[index].type;
+      writer->columns[index].validity = g_byte_array_new ();
+      writer->columns[index].values = g_byte_array_new ();
+      writer->columns[index].data = g_byte_array_new ();
+    }
+  arrow_writer_reset (writer);
+
+  if (arrow_writer_schema (writer))
+    {
+      arrow_writer_free (writer);
+      return NULL;
+    }
+
+  return writer;
+}
+
+/**
+ * @brief Get the next column of the current row, marking its validity.
+ *
+ * @param[in]  writer  Writer.
+ * @param[in]  valid   Whether the value is valid, as opposed to null.
+ *
+ * @return Column.
+ */
+static arrow_column_data_t *
+arrow_writer_next (arrow_writer_t *writer, gboolean valid)
+{
+  arrow_column_data_t *column;
+
+  assert (writer->column < writer->column_count);
+
+  column = &writer->columns[writer->column++];
+  if (writer->rows % 8 == 0)
+    fb_put (column->validity, 0, 1);
+  if (valid)
+    column->validity->data[writer->rows / 8] |= 1 << (writer->rows % 8);
+  else
+    column->null_count++;
+  return column;
+}
+
+/**
+ * @brief Add a string to the current row.
+ *
+ * @param[in]  writer  Writer.
+ * @param[in]  value   Value, or NULL for null.
+ */
+void
+arrow_writer_string (arrow_writer_t *writer, const char *value)
+{
+  arrow_column_data_t *column;
+
+  column = arrow_writer_next (writer, value != NULL);
+  assert (column->type == ARROW_TYPE_UTF8);
+  if (value)
+    g_byte_array_append (column->data, (const guint8 *) value,
+                         strlen (value));
+  fb_put (column->values, column->data->len, 4);
+}
+
+/**
+ * @brief Add an integer to the current row.
+ *
+ * @param[in]  writer  Writer.
+ * @param[in]  value   Value.
+ */
+void
+arrow_writer_int64 (arrow_writer_t *writer, gint64 value)
+{
+  arrow_column_data_t *column;
+
+  column = arrow_writer_next (writer, TRUE);
+  assert (column->type == ARROW_TYPE_INT64);
+  fb_put (column->values, (guint64) value, 8);
+}
+
+/**
+ * @brief Add a double to the current row.
+ *
+ * @param[in]  writer  Writer.
+ * @param[in]  value   Value.
+ */
+void
+arrow_writer_double (arrow_writer_t *writer, double value)
+{
+  arrow_column_data_t *column;
+  guint64 bits;
+
+  column = arrow_writer_next (writer, TRUE);
+  assert (column->type == ARROW_TYPE_DOUBLE);
+  memcpy (&bits, &value, sizeof (bits));
+  fb_put (column->values, bits, 8);
+}
+
+/**
+ * @brief Add a null to the current row.
+ *
+ * @param[in]  writer  Writer.
+ */
+void
+arrow_writer_null (arrow_writer_t *writer)
+{
+  arrow_column_data_t *column;
+
+  column = arrow_writer_next (writer, FALSE);
+  if (column->type == ARROW_TYPE_UTF8)
+    fb_put (column->values, column->data->len, 4);
+  else
+    fb_put (column->values, 0, 8);
+}
+
+/**
+ * @brief End the current row, writing a batch if the batch is full.
+ *
+ * @param[in]  writer  Writer.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+arrow_writer_end_row (arrow_writer_t *writer)
+{
+  while (writer->column < writer->column_count)
+    arrow_writer_null (writer);
+  writer->column = 0;
+  writer->rows++;
+
+  if (writer->rows >= ARROW_IPC_BATCH_ROWS)
+    return arrow_writer_batch (writer);
+  return 0;
+}
+
+/**
+ * @brief Write any remaining rows and the end of the stream, and free
+ *        the writer.
+ *
+ * @param[in]  writer  Writer.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+arrow_writer_finish (arrow_writer_t *writer)
+{
+  int ret;
+
+  ret = arrow_writer_batch (writer);
+  if (ret == 0)
+    {
+      GByteArray *end;
+
+      end = g_byte_array_new ();
+      fb_put (end, 0xFFFFFFFF, 4);
+      fb_put (end, 0, 4);
+      if (fwrite (end->data, 1, end->len, writer->stream) < end->len)
+        {
+          g_warning ("%s: Failed to write end of stream", __func__);
+          ret = -1;
+        }
+      g_byte_array_free (end, TRUE);
+    }
+
+  arrow_writer_free (writer);
+  return ret;
+}
+
+/**
+ * @brief Free a writer.
+ *
+ * @param[in]  writer  Writer.
+ */
+void
+arrow_writer_free (arrow_writer_t *writer)
+{
+  int index;
+
+  if (writer == NULL)
+    return;
+
+  for (index = 0; index < writer->column_count; index++)
+    {
+      g_byte_array_free (writer->columns[index].validity, TRUE);
+      g_byte_array_free (writer->columns[index].values, TRUE);
+      g_byte_array_free (writer->columns[index].data, TRUE);
+    }
+  g_free (writer->columns);
+  g_free (writer);
+}
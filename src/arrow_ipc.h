@@ -0,0 +1,81 @@
+/* Copyright (C) 2020 Greenbone Networks GmbH
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * @file arrow_ipc.h
+ * @brief Headers for the Apache Arrow IPC stream writer.
+ */
+
+#ifndef _GVMD_ARROW_IPC_H
+#define _GVMD_ARROW_IPC_H
+
+#include <glib.h>
+#include <stdio.h>
+
+/**
+ * @brief Type of an Arrow column.
+ */
+typedef enum
+{
+  ARROW_TYPE_UTF8,     ///< UTF-8 string.
+  ARROW_TYPE_INT64,    ///< Signed 64 bit integer.
+  ARROW_TYPE_DOUBLE    ///< Double precision float.
+} arrow_type_t;
+
+/**
+ * @brief Column of an Arrow schema.
+ */
+typedef struct
+{
+  const char *name;    ///< Name of column.
+  arrow_type_t type;   ///< Type of column.
+} arrow_column_t;
+
+/**
+ * @brief Number of rows in each record batch.
+ */
+#define ARROW_IPC_BATCH_ROWS 10000
+
+typedef struct arrow_writer arrow_writer_t;
+
+arrow_writer_t *
+arrow_writer_new (FILE *, const arrow_column_t *, int);
+
+void
+arrow_writer_string (arrow_writer_t *, const char *);
+
+void
+arrow_writer_int64 (arrow_writer_t *, gint64);
+
+void
+arrow_writer_double (arrow_writer_t *, double);
+
+void
+arrow_writer_null (arrow_writer_t *);
+
+int
+arrow_writer_end_row (arrow_writer_t *);
+
+int
+arrow_writer_finish (arrow_writer_t *);
+
+void
+arrow_writer_free (arrow_writer_t *);
+
+#endif /* not _GVMD_ARROW_IPC_H */
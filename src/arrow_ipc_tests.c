@@ -0,0 +1,353 @@
+/* Copyright (C) 2020 Greenbone Networks GmbH
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "arrow_ipc.c"
+
+#include <cgreen/cgreen.h>
+
+Describe (arrow_ipc);
+BeforeEach (arrow_ipc) {}
+AfterEach (arrow_ipc) {}
+
+/* Helpers for reading back the stream. */
+
+static guint64
+read_le (const guint8 *data, guint position, int size)
+{
+  guint64 value;
+  int index;
+
+  value = 0;
+  for (index = size - 1; index >= 0; index--)
+    value = (value << 8) | data[position + index];
+  return value;
+}
+
+/* Position of a field of a flatbuffer table, or 0 if absent. */
+static guint
+fb_field (const guint8 *data, guint table, guint id)
+{
+  guint vtable, vtable_size, offset;
+
+  vtable = table - (gint32) read_le (data, table, 4);
+  vtable_size = read_le (data, vtable, 2);
+  if (4 + 2 * id >= vtable_size)
+    return 0;
+  offset = read_le (data, vtable + 4 + 2 * id, 2);
+  return offset ? table + offset : 0;
+}
+
+/* Position that the offset field of a table points to. */
+static guint
+fb_deref (const guint8 *data, guint table, int id)
+{
+  guint field;
+
+  field = fb_field (data, table, id);
+  assert_that (field, is_not_equal_to (0));
+  return field + read_le (data, field, 4);
+}
+
+static guint64
+fb_scalar (const guint8 *data, guint table, int id, int size)
+{
+  guint field;
+
+  field = fb_field (data, table, id);
+  return field ? read_le (data, field, size) : 0;
+}
+
+/* Read a message.  Returns the Message table, or 0 at the end of the
+ * stream.  Moves position past the message and sets body to the start of
+ * the body. */
+static guint
+read_message (const guint8 *data, gsize length, guint *position, guint *body)
+{
+  guint metadata, metadata_length, message;
+
+  assert_that (*position + 8, is_less_than (length + 1));
+  assert_that (read_le (data, *position, 4), is_equal_to (0xFFFFFFFF));
+  metadata_length = read_le (data, *position + 4, 4);
+  metadata = *position + 8;
+  *position = metadata + metadata_length;
+  if (metadata_length == 0)
+    return 0;
+
+  /* The body must start 8 byte aligned. */
+  assert_that (metadata_length % 8, is_equal_to (0));
+
+  message = metadata + read_le (data, metadata, 4);
+  assert_that (fb_scalar (data, message, 0, 2),
+               is_equal_to (ARROW_METADATA_V5));
+  *body = *position;
+  *position += fb_scalar (data, message, 3, 8);
+  return message;
+}
+
+/* Write a table with the given function and return the stream. */
+static guint8 *
+write_stream (const arrow_column_t *columns, int count,
+              void (*rows) (arrow_writer_t *), gsize *length)
+{
+  arrow_writer_t *writer;
+  char *buffer;
+  size_t size;
+  FILE *stream;
+
+  stream = open_memstream (&buffer, &size);
+  assert_that (stream, is_not_null);
+  writer = arrow_writer_new (stream, columns, count);
+  assert_that (writer, is_not_null);
+  if (rows)
+    rows (writer);
+  assert_that (arrow_writer_finish (writer), is_equal_to (0));
+  assert_that (fclose (stream), is_equal_to (0));
+  *length = size;
+  return (guint8 *) buffer;
+}
+
+/* Schema. */
+
+Ensure (arrow_ipc, writer_writes_schema_and_end_of_stream)
+{
+  static const arrow_column_t columns[]
+    = {{ "name", ARROW_TYPE_UTF8 },
+       { "count", ARROW_TYPE_INT64 },
+       { "score", ARROW_TYPE_DOUBLE }};
+  guint8 *data;
+  gsize length;
+  guint position, body, message, schema, fields, field, name, type;
+
+  data = write_stream (columns, 3, NULL, &length);
+
+  position = 0;
+  message = read_message (data, length, &position, &body);
+  assert_that (message, is_not_equal_to (0));
+  assert_that (fb_scalar (data, message, 1, 1),
+               is_equal_to (ARROW_HEADER_SCHEMA));
+
+  schema = fb_deref (data, message, 2);
+  fields = fb_deref (data, schema, 1);
+  assert_that (read_le (data, fields, 4), is_equal_to (3));
+
+  field = fields + 4 + read_le (data, fields + 4, 4);
+  name = fb_deref (data, field, 0);
+  assert_that (read_le (data, name, 4), is_equal_to (4));
+  assert_that ((char *) data + name + 4, is_equal_to_string ("name"));
+  assert_that (fb_scalar (data, field, 1, 1), is_equal_to (1));
+  assert_that (fb_scalar (data, field, 2, 1),
+               is_equal_to (ARROW_TYPE_ID_UTF8));
+
+  field = fields + 8 + read_le (data, fields + 8, 4);
+  name = fb_deref (data, field, 0);
+  assert_that ((char *) data + name + 4, is_equal_to_string ("count"));
+  assert_that (fb_scalar (data, field, 2, 1),
+               is_equal_to (ARROW_TYPE_ID_INT));
+  type = fb_deref (data, field, 3);
+  assert_that (fb_scalar (data, type, 0, 4), is_equal_to (64));
+  assert_that (fb_scalar (data, type, 1, 1), is_equal_to (1));
+
+  field = fields + 12 + read_le (data, fields + 12, 4);
+  name = fb_deref (data, field, 0);
+  assert_that ((char *) data + name + 4, is_equal_to_string ("score"));
+  assert_that (fb_scalar (data, field, 2, 1),
+               is_equal_to (ARROW_TYPE_ID_FLOATING_POINT));
+  type = fb_deref (data, field, 3);
+  assert_that (fb_scalar (data, type, 0, 2),
+               is_equal_to (ARROW_PRECISION_DOUBLE));
+
+  /* No rows, so no batch, only the end of stream marker. */
+  assert_that (read_message (data, length, &position, &body),
+               is_equal_to (0));
+  assert_that (position, is_equal_to (length));
+
+  free (data);
+}
+
+/* Record batches. */
+
+static void
+write_mixed_rows (arrow_writer_t *writer)
+{
+  arrow_writer_string (writer, "a");
+  arrow_writer_int64 (writer, 1);
+  arrow_writer_double (writer, 1.5);
+  assert_that (arrow_writer_end_row (writer), is_equal_to (0));
+
+  arrow_writer_null (writer);
+  arrow_writer_null (writer);
+  arrow_writer_double (writer, 2.5);
+  assert_that (arrow_writer_end_row (writer), is_equal_to (0));
+
+  arrow_writer_string (writer, "bcd");
+  arrow_writer_int64 (writer, -3);
+  /* Missing columns are null. */
+  assert_that (arrow_writer_end_row (writer), is_equal_to (0));
+}
+
+Ensure (arrow_ipc, writer_writes_record_batch_round_trip)
+{
+  static const arrow_column_t columns[]
+    = {{ "name", ARROW_TYPE_UTF8 },
+       { "count", ARROW_TYPE_INT64 },
+       { "score", ARROW_TYPE_DOUBLE }};
+  guint8 *data;
+  gsize length;
+  guint position, body, message, batch, nodes, buffers, buffer;
+  double score;
+  guint64 bits;
+  int index;
+
+  data = write_stream (columns, 3, write_mixed_rows, &length);
+
+  position = 0;
+  read_message (data, length, &position, &body);
+  message = read_message (data, length, &position, &body);
+  assert_that (message, is_not_equal_to (0));
+  assert_that (fb_scalar (data, message, 1, 1),
+               is_equal_to (ARROW_HEADER_RECORD_BATCH));
+
+  batch = fb_deref (data, message, 2);
+  assert_that (fb_scalar (data, batch, 0, 8), is_equal_to (3));
+
+  /* One node per column, each with one null. */
+  nodes = fb_deref (data, batch, 1);
+  assert_that (read_le (data, nodes, 4), is_equal_to (3));
+  assert_that ((nodes + 4) % 8, is_equal_to (0));
+  for (index = 0; index < 3; index++)
+    {
+      assert_that (read_le (data, nodes + 4 + 16 * index, 8), is_equal_to (3));
+      assert_that (read_le (data, nodes + 12 + 16 * index, 8),
+                   is_equal_to (1));
+    }
+
+  /* Validity, offsets and data for the string.  Validity and values for
+   * the others. */
+  buffers = fb_deref (data, batch, 2);
+  assert_that (read_le (data, buffers, 4), is_equal_to (7));
+  buffers += 4;
+
+  /* The buffers are 8 byte aligned in the body. */
+  for (index = 0; index < 7; index++)
+    assert_that (read_le (data, buffers + 16 * index, 8) % 8,
+                 is_equal_to (0));
+
+  /* name: rows 0 and 2 are valid. */
+  buffer = body + read_le (data, buffers, 8);
+  assert_that (data[buffer], is_equal_to (0x05));
+  buffer = body + read_le (data, buffers + 16, 8);
+  assert_that (read_le (data, buffers + 24, 8), is_equal_to (16));
+  assert_that (read_le (data, buffer, 4), is_equal_to (0));
+  assert_that (read_le (data, buffer + 4, 4), is_equal_to (1));
+  assert_that (read_le (data, buffer + 8, 4), is_equal_to (1));
+  assert_that (read_le (data, buffer + 12, 4), is_equal_to (4));
+  buffer = body + read_le (data, buffers + 32, 8);
+  assert_that (read_le (data, buffers + 40, 8), is_equal_to (4));
+  assert_that (strncmp ((char *) data + buffer, "abcd", 4), is_equal_to (0));
+
+  /* count: rows 0 and 2 are valid. */
+  buffer = body + read_le (data, buffers + 48, 8);
+  assert_that (data[buffer], is_equal_to (0x05));
+  buffer = body + read_le (data, buffers + 64, 8);
+  assert_that (read_le (data, buffers + 72, 8), is_equal_to (24));
+  assert_that ((gint64) read_le (data, buffer, 8), is_equal_to (1));
+  assert_that ((gint64) read_le (data, buffer + 16, 8), is_equal_to (-3));
+
+  /* score: rows 0 and 1 are valid. */
+  buffer = body + read_le (data, buffers + 80, 8);
+  assert_that (data[buffer], is_equal_to (0x03));
+  buffer = body + read_le (data, buffers + 96, 8);
+  bits = read_le (data, buffer + 8, 8);
+  memcpy (&score, &bits, sizeof (score));
+  assert_that_double (score, is_equal_to_double (2.5));
+
+  assert_that (read_message (data, length, &position, &body),
+               is_equal_to (0));
+  assert_that (position, is_equal_to (length));
+
+  free (data);
+}
+
+static void
+write_batch_plus_one_rows (arrow_writer_t *writer)
+{
+  int row;
+
+  for (row = 0; row <= ARROW_IPC_BATCH_ROWS; row++)
+    {
+      arrow_writer_int64 (writer, row);
+      assert_that (arrow_writer_end_row (writer), is_equal_to (0));
+    }
+}
+
+Ensure (arrow_ipc, writer_splits_rows_into_batches)
+{
+  static const arrow_column_t columns[] = {{ "row", ARROW_TYPE_INT64 }};
+  guint8 *data;
+  gsize length;
+  guint position, body, message, batch, buffers;
+
+  data = write_stream (columns, 1, write_batch_plus_one_rows, &length);
+
+  position = 0;
+  read_message (data, length, &position, &body);
+
+  message = read_message (data, length, &position, &body);
+  batch = fb_deref (data, message, 2);
+  assert_that (fb_scalar (data, batch, 0, 8),
+               is_equal_to (ARROW_IPC_BATCH_ROWS));
+
+  message = read_message (data, length, &position, &body);
+  batch = fb_deref (data, message, 2);
+  assert_that (fb_scalar (data, batch, 0, 8), is_equal_to (1));
+  buffers = fb_deref (data, batch, 2) + 4;
+  /* No nulls, so no validity bitmap. */
+  assert_that (read_le (data, buffers + 8, 8), is_equal_to (0));
+  assert_that ((gint64) read_le (data,
+                                 body + read_le (data, buffers + 16, 8),
+                                 8),
+               is_equal_to (ARROW_IPC_BATCH_ROWS));
+
+  assert_that (read_message (data, length, &position, &body),
+               is_equal_to (0));
+  assert_that (position, is_equal_to (length));
+
+  free (data);
+}
+
+/* Test suite. */
+
+int
+main (int argc, char **argv)
+{
+  TestSuite *suite;
+
+  suite = create_test_suite ();
+
+  add_test_with_context (suite, arrow_ipc,
+                         writer_writes_schema_and_end_of_stream);
+  add_test_with_context (suite, arrow_ipc,
+                         writer_writes_record_batch_round_trip);
+  add_test_with_context (suite, arrow_ipc, writer_splits_rows_into_batches);
+
+  if (argc > 1)
+    return run_single_test (suite, argv[1], create_text_reporter ());
+
+  return run_test_suite (suite, create_text_reporter ());
+}
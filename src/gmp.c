@@ -113,6 +113,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <gnutls/x509.h>
@@ -507,6 +508,10 @@ process_gmp (gmp_parser_t *, const gchar *, gchar **);
  *
  * @param[in]  write_to_client       Function to write to client.
  * @param[in]  write_to_client_data  Argument to \p write_to_client.
+ * @param[in]  compress_client       Function to start or finish compressing
+ *                                   output to client, or NULL.
+ * @param[in]  flush_client          Function to write queued output to
+ *                                   client, or NULL.
  * @param[in]  disable               Commands to disable.  Copied, and freed by
  *                                   gmp_parser_free.
  *
@@ -514,11 +519,15 @@ process_gmp (gmp_parser_t *, const gchar *, gchar **);
  */
 static gmp_parser_t *
 gmp_parser_new (int (*write_to_client) (const char*, void*), void* write_to_client_data,
+                int (*compress_client) (const char*, void*),
+                int (*flush_client) (void*),
                 gchar **disable)
 {
   gmp_parser_t *gmp_parser = (gmp_parser_t*) g_malloc0 (sizeof (gmp_parser_t));
   gmp_parser->client_writer = write_to_client;
   gmp_parser->client_writer_data = write_to_client_data;
+  gmp_parser->client_compress = compress_client;
+  gmp_parser->client_flush = flush_client;
   gmp_parser->read_over = 0;
   gmp_parser->disabled_commands = g_strdupv (disable);
   return gmp_parser;
@@ -923,14 +932,38 @@ typedef struct
   char *result_scan_nvt_version;  ///< Version of NVT used in scan.
   char *result_severity;          ///< Severity score for current result.
   char *result_threat;            ///< Message type for current result.
-  array_t *results;               ///< All results.
+  char *result_count;             ///< Result count given in the report.
+  array_t *results;               ///< Results not yet streamed.
+  arena_t *results_arena;         ///< Memory of results not yet streamed.
   char *scan_end;                 ///< End time for a scan.
   char *scan_start;               ///< Start time for a scan.
   char *task_id;                  ///< ID of container task.
   char *type;                     ///< Type of report.
   int wrapper;                    ///< Whether there was a wrapper REPORT.
+  report_t stream_report;         ///< Report of streamed upload, if any.
+  char *stream_report_id;         ///< UUID of stream_report.
+  int stream_count;               ///< Number of results streamed so far.
+  int stream_error;               ///< Error from starting stream, if any.
 } create_report_data_t;
 
+/**
+ * @brief Free the results of the create_report command.
+ *
+ * The results and their strings are all in the results arena, so they
+ * are released together.
+ *
+ * @param[in]  data  Command data.
+ */
+static void
+create_report_results_free (create_report_data_t *data)
+{
+  if (data->results)
+    g_ptr_array_free (data->results, TRUE);
+  data->results = NULL;
+  if (data->results_arena)
+    arena_clear (data->results_arena);
+}
+
 /**
  * @brief Reset command data.
  *
@@ -989,43 +1022,72 @@ create_report_data_reset (create_report_data_t *data)
     }
   free (data->in_assets);
   free (data->ip);
-  free (data->result_description);
-  free (data->result_host);
-  free (data->result_hostname);
-  free (data->result_nvt_oid);
-  free (data->result_port);
-  free (data->result_threat);
-  if (data->results)
-    {
-      guint index = data->results->len;
-      while (index--)
-        {
-          create_report_result_t *result;
-          result = (create_report_result_t*) g_ptr_array_index (data->results,
-                                                                index);
-          if (result)
-            {
-              free (result->host);
-              free (result->hostname);
-              free (result->description);
-              free (result->nvt_oid);
-              free (result->port);
-              free (result->qod);
-              free (result->qod_type);
-              free (result->scan_nvt_version);
-              free (result->severity);
-            }
-        }
-      array_free (data->results);
-    }
+  free (data->result_count);
+  create_report_results_free (data);
+  arena_free (data->results_arena);
   free (data->scan_end);
   free (data->scan_start);
   free (data->task_id);
   free (data->type);
+  free (data->stream_report_id);
 
   memset (data, 0, sizeof (create_report_data_t));
 }
 
+/**
+ * @brief Import the parsed results of a create_report command, if due.
+ *
+ * When a batch size is set, the results are written to the database each
+ * time a batch has been parsed, instead of all at the end of the command.
+ * This needs the TASK before the REPORT, otherwise the results are kept
+ * until the end as usual.
+ *
+ * @param[in]  data  Command data.
+ */
+static void
+create_report_data_stream (create_report_data_t *data)
+{
+  int batch_size, upload_count;
+
+  batch_size = report_import_batch_size ();
+  if (batch_size == 0
+      || data->results->len < (guint) batch_size
+      || data->task_id == NULL)
+    return;
+
+  if (data->stream_error == 0
+      && (data->type == NULL || strcmp (data->type, "scan") == 0))
+    {
+      /* Use the count given in the report for the upload progress if there
+       * is one, otherwise stay below 100% until the end. */
+      if (data->result_count && atoi (data->result_count) > 0)
+        upload_count = atoi (data->result_count);
+      else
+        upload_count = data->stream_count + data->results->len + batch_size;
+
+      if (data->stream_report == 0)
+        data->stream_error = create_report_stream_start
+                              (data->task_id, data->in_assets,
+                               data->scan_start, upload_count,
+                               &data->stream_report,
+                               &data->stream_report_id);
+
+      if (data->stream_error == 0
+          && create_report_stream_results (data->stream_report,
+                                           data->results,
+                                           upload_count))
+        data->stream_error = -1;
+
+      if (data->stream_error == 0)
+        data->stream_count += data->results->len;
+    }
+
+  /* The command fails at the end if there was an error, so the results
+   * are dropped either way. */
+  create_report_results_free (data);
+  data->results = make_array ();
+}
+
 /**
  * @brief Command data for the create_role command.
  */
@@ -2050,6 +2112,29 @@ get_groups_data_reset (get_groups_data_t *data)
   memset (data, 0, sizeof (get_groups_data_t));
 }
 
+/**
+ * @brief Command data for the get_host_trends command.
+ */
+typedef struct
+{
+  char *host_id;      ///< ID of host, or NULL for all hosts.
+  char *days;         ///< Number of days to get.
+} get_host_trends_data_t;
+
+/**
+ * @brief Reset command data.
+ *
+ * @param[in]  data  Command data.
+ */
+static void
+get_host_trends_data_reset (get_host_trends_data_t *data)
+{
+  free (data->host_id);
+  free (data->days);
+
+  memset (data, 0, sizeof (get_host_trends_data_t));
+}
+
 /**
  * @brief Command data for the get_info command.
  */
@@ -2118,6 +2203,7 @@ typedef struct
   char *sort_field;      ///< Field to sort results on.
   int sort_order;        ///< Result sort order: 0 descending, else ascending.
   int timeout;           ///< Boolean.  Whether to include timeout preference.
+  char *compress;        ///< Compression method for response.
 } get_nvts_data_t;
 
 /**
@@ -2133,6 +2219,7 @@ get_nvts_data_reset (get_nvts_data_t *data)
   free (data->family);
   free (data->nvt_oid);
   free (data->sort_field);
+  free (data->compress);
 
   memset (data, 0, sizeof (get_nvts_data_t));
 }
@@ -2268,6 +2355,7 @@ typedef struct
   int overrides_details; ///< Boolean.  Whether to include details of above.
   int result_tags;       ///< Boolean.  Whether to include result tags.
   int ignore_pagination; ///< Boolean.  Whether to ignore pagination filters.
+  char *compress;        ///< Compression method for response.
 } get_reports_data_t;
 
 /**
@@ -2284,6 +2372,7 @@ get_reports_data_reset (get_reports_data_t *data)
   free (data->format_id);
   free (data->alert_id);
   free (data->report_id);
+  free (data->compress);
 
   memset (data, 0, sizeof (get_reports_data_t));
 }
@@ -2320,6 +2409,7 @@ typedef struct
   int notes_details;     ///< Boolean.  Whether to include details of above.
   int overrides_details; ///< Boolean.  Whether to include details of above.
   int get_counts;        ///< Boolean.  Whether to include result counts.
+  char *compress;        ///< Compression method for response.
 } get_results_data_t;
 
 /**
@@ -2332,6 +2422,7 @@ get_results_data_reset (get_results_data_t *data)
 {
   get_data_reset (&data->get);
   free (data->task_id);
+  free (data->compress);
 
   memset (data, 0, sizeof (get_results_data_t));
 }
@@ -3678,6 +3769,7 @@ typedef union
   get_feeds_data_t get_feeds;                         ///< get_feeds
   get_filters_data_t get_filters;                     ///< get_filters
   get_groups_data_t get_groups;                       ///< get_groups
+  get_host_trends_data_t get_host_trends;             ///< get_host_trends
   get_info_data_t get_info;                           ///< get_info
   get_notes_data_t get_notes;                         ///< get_notes
   get_nvts_data_t get_nvts;                           ///< get_nvts
@@ -4019,6 +4111,12 @@ static get_filters_data_t *get_filters_data
 static get_groups_data_t *get_groups_data
  = &(command_data.get_groups);
 
+/**
+ * @brief Parser callback data for GET_HOST_TRENDS.
+ */
+static get_host_trends_data_t *get_host_trends_data
+ = &(command_data.get_host_trends);
+
 /**
  * @brief Parser callback data for GET_INFO.
  */
@@ -4359,6 +4457,11 @@ static GMarkupParser xml_parser;
  */
 static const gchar *nvt_sync_script = BINDIR "/greenbone-nvt-sync";
 
+/**
+ * @brief Authentication token given in AUTHENTICATE instead of a password.
+ */
+static gchar *credentials_token = NULL;
+
 
 /* Client state. */
 
@@ -4373,6 +4476,7 @@ typedef enum
   CLIENT_AUTHENTICATE,
   CLIENT_AUTHENTICATE_CREDENTIALS,
   CLIENT_AUTHENTICATE_CREDENTIALS_PASSWORD,
+  CLIENT_AUTHENTICATE_CREDENTIALS_TOKEN,
   CLIENT_AUTHENTICATE_CREDENTIALS_USERNAME,
   CLIENT_CREATE_ALERT,
   CLIENT_CREATE_ALERT_ACTIVE,
@@ -4678,6 +4782,7 @@ typedef enum
   CLIENT_GET_FEEDS,
   CLIENT_GET_FILTERS,
   CLIENT_GET_GROUPS,
+  CLIENT_GET_HOST_TRENDS,
   CLIENT_GET_INFO,
   CLIENT_GET_NOTES,
   CLIENT_GET_NVTS,
@@ -4686,6 +4791,7 @@ typedef enum
   CLIENT_GET_PERMISSIONS,
   CLIENT_GET_PORT_LISTS,
   CLIENT_GET_PREFERENCES,
+  CLIENT_GET_PROCESSES,
   CLIENT_GET_REPORTS,
   CLIENT_GET_REPORT_FORMATS,
   CLIENT_GET_RESULTS,
@@ -4919,6 +5025,266 @@ typedef enum
  */
 static client_state_t client_state = CLIENT_TOP;
 
+/**
+ * @brief Seconds between flushes of the command statistics to the database.
+ */
+#define COMMAND_STATS_FLUSH_PERIOD 60
+
+/**
+ * @brief Statistics per command, keyed on command name, not yet flushed.
+ */
+static GHashTable *command_stats = NULL;
+
+/**
+ * @brief Time of the last flush of the command statistics.
+ */
+static time_t command_stats_flushed = 0;
+
+/**
+ * @brief Name of the command in progress, NULL if none.
+ */
+static gchar *command_stats_name = NULL;
+
+/**
+ * @brief Monotonic time when the command in progress started, in µs.
+ */
+static gint64 command_stats_wall;
+
+/**
+ * @brief CPU time when the command in progress started.
+ */
+static clock_t command_stats_cpu;
+
+/**
+ * @brief SQL statement count when the command in progress started.
+ */
+static long long command_stats_sql_count;
+
+/**
+ * @brief SQL time when the command in progress started.
+ */
+static double command_stats_sql_time;
+
+/**
+ * @brief SQL row count when the command in progress started.
+ */
+static long long command_stats_sql_rows;
+
+/**
+ * @brief Bytes sent when the command in progress started.
+ */
+static unsigned long long command_stats_bytes;
+
+/**
+ * @brief Write the command statistics of this process to the database.
+ */
+void
+gmp_command_stats_flush ()
+{
+  GHashTableIter iter;
+  gpointer name, stats;
+
+  command_stats_flushed = time (NULL);
+  if (command_stats == NULL || g_hash_table_size (command_stats) == 0)
+    return;
+
+  g_hash_table_iter_init (&iter, command_stats);
+  while (g_hash_table_iter_next (&iter, &name, &stats))
+    manage_command_stats_add (name, stats);
+  g_hash_table_remove_all (command_stats);
+  manage_lock_stats_flush ();
+}
+
+/**
+ * @brief Clean up after any command that the client left unfinished.
+ *
+ * This is for when the connection ends in the middle of a command, either
+ * because the client went away or because the input could not be parsed.
+ */
+void
+gmp_abort_commands ()
+{
+  /* Roll back a command that ran out of time. */
+  manage_command_timeout_end ();
+  gmp_send_stop (0);
+
+  /* The command data is a union, so only look at the create_report data
+   * while in a CREATE_REPORT. */
+  if (client_state >= CLIENT_CREATE_REPORT
+      && client_state <= CLIENT_CREATE_REPORT_TASK_NAME)
+    {
+      if (create_report_data->stream_report)
+        create_report_stream_abort (create_report_data->stream_report);
+      create_report_data_reset (create_report_data);
+    }
+}
+
+/**
+ * @brief Start recording the statistics of a command.
+ *
+ * @param[in]  element_name  Name of the command element.
+ */
+static void
+command_stats_start (const gchar *element_name)
+{
+  g_free (command_stats_name);
+  command_stats_name = g_ascii_strdown (element_name, -1);
+  command_stats_wall = g_get_monotonic_time ();
+  command_stats_cpu = clock ();
+  manage_sql_stats (&command_stats_sql_count, &command_stats_sql_time,
+                    &command_stats_sql_rows);
+  command_stats_bytes = gmp_sent_bytes ();
+}
+
+/**
+ * @brief Finish recording the statistics of the command in progress.
+ */
+static void
+command_stats_end ()
+{
+  command_stats_t *stats;
+  double wall, cpu, sql_time;
+  long long sql_count, sql_rows;
+  unsigned long long bytes;
+
+  if (command_stats_name == NULL)
+    return;
+
+  wall = (g_get_monotonic_time () - command_stats_wall) / 1000000.0;
+  cpu = ((double) (clock () - command_stats_cpu)) / CLOCKS_PER_SEC;
+  manage_sql_stats (&sql_count, &sql_time, &sql_rows);
+  sql_count -= command_stats_sql_count;
+  sql_time -= command_stats_sql_time;
+  sql_rows -= command_stats_sql_rows;
+  bytes = gmp_sent_bytes () - command_stats_bytes;
+
+  g_log ("md  stats", G_LOG_LEVEL_INFO,
+         "command=%s wall=%.6f cpu=%.6f sql_count=%lli sql_time=%.6f"
+         " sql_rows=%lli bytes=%llu",
+         command_stats_name, wall, cpu, sql_count, sql_time, sql_rows, bytes);
+
+  if (command_stats == NULL)
+    {
+      command_stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             g_free);
+      command_stats_flushed = time (NULL);
+    }
+  stats = g_hash_table_lookup (command_stats, command_stats_name);
+  if (stats == NULL)
+    {
+      stats = g_malloc0 (sizeof (command_stats_t));
+      g_hash_table_insert (command_stats, command_stats_name, stats);
+    }
+  else
+    g_free (command_stats_name);
+  command_stats_name = NULL;
+
+  stats->count++;
+  stats->wall_time += wall;
+  stats->cpu_time += cpu;
+  stats->sql_count += sql_count;
+  stats->sql_time += sql_time;
+  stats->sql_rows += sql_rows;
+  stats->bytes += bytes;
+
+  if (time (NULL) - command_stats_flushed >= COMMAND_STATS_FLUSH_PERIOD)
+    gmp_command_stats_flush ();
+}
+
+/**
+ * @brief Parser of the command that has a time budget, if any.
+ */
+static gmp_parser_t *command_timeout_parser = NULL;
+
+/**
+ * @brief Lower case name of the command that has a time budget.
+ */
+static gchar *command_timeout_name = NULL;
+
+/**
+ * @brief Bytes sent to the client before the command started.
+ */
+static unsigned long long command_timeout_bytes;
+
+/**
+ * @brief Give up on a command that ran out of time.
+ *
+ * Called from inside the SQL layer.  The client gets a status 503 response
+ * if none of the response has gone out yet.  After that sending stops, and
+ * the SQL layer ends the iterators of the command, so the handler fails at
+ * its next send and the connection closes.  The transaction of the command
+ * is rolled back.
+ */
+static void
+command_timeout_expired ()
+{
+  gmp_parser_t *gmp_parser;
+
+  gmp_parser = command_timeout_parser;
+  g_warning ("%s: %s exceeded its time budget", __func__,
+             command_timeout_name);
+
+  if (gmp_parser && gmp_sent_bytes () == command_timeout_bytes)
+    {
+      gchar *msg;
+
+      msg = g_strdup_printf ("<%s_response"
+                             " status=\"" STATUS_SERVICE_UNAVAILABLE "\""
+                             " status_text=\"Command exceeded its time"
+                             " budget\"/>",
+                             command_timeout_name);
+      send_to_client (msg, gmp_parser->client_writer,
+                      gmp_parser->client_writer_data);
+      g_free (msg);
+    }
+
+  if (gmp_parser)
+    {
+      if (gmp_parser->client_compress)
+        gmp_parser->client_compress (NULL, gmp_parser->client_writer_data);
+      if (gmp_parser->client_flush)
+        gmp_parser->client_flush (gmp_parser->client_writer_data);
+    }
+
+  gmp_send_stop (1);
+}
+
+/**
+ * @brief Start the time budget of a command.
+ *
+ * @param[in]  gmp_parser    GMP parser.
+ * @param[in]  element_name  Name of the command element.
+ */
+static void
+command_timeout_start (gmp_parser_t *gmp_parser, const gchar *element_name)
+{
+  g_free (command_timeout_name);
+  command_timeout_name = g_ascii_strdown (element_name, -1);
+  command_timeout_parser = gmp_parser;
+  command_timeout_bytes = gmp_sent_bytes ();
+  gmp_send_stop (0);
+  manage_command_timeout_begin (element_name, command_timeout_expired);
+}
+
+/**
+ * @brief Take the request ID from the attributes of a command element.
+ *
+ * @param[in]  attribute_names   All attribute names.
+ * @param[in]  attribute_values  All attribute values.
+ */
+static void
+request_id_start (const gchar **attribute_names,
+                  const gchar **attribute_values)
+{
+  const gchar *attribute;
+
+  if (find_attribute (attribute_names, attribute_values, "request_id",
+                      &attribute))
+    gmp_set_request_id (attribute);
+  else
+    gmp_set_request_id (NULL);
+}
+
 /**
  * @brief Set the client state.
  *
@@ -4929,6 +5295,12 @@ set_client_state (client_state_t state)
 {
   client_state = state;
   g_debug ("   client state set: %i", client_state);
+  if (state == CLIENT_AUTHENTIC)
+    {
+      manage_command_timeout_end ();
+      manage_read_replica_end ();
+      command_stats_end ();
+    }
 }
 
 
@@ -5047,6 +5419,7 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
   else switch (client_state)
     {
       case CLIENT_TOP:
+        request_id_start (attribute_names, attribute_values);
         if (strcasecmp ("GET_VERSION", element_name) == 0)
           set_client_state (CLIENT_GET_VERSION);
         else if (strcasecmp ("AUTHENTICATE", element_name) == 0)
@@ -5070,6 +5443,11 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
         break;
 
       case CLIENT_AUTHENTIC:
+        acl_cache_reset ();
+        command_stats_start (element_name);
+        manage_read_replica_begin (element_name);
+        command_timeout_start (gmp_parser, element_name);
+        request_id_start (attribute_names, attribute_values);
         if (command_disabled (gmp_parser, element_name))
           {
             SEND_TO_CLIENT_OR_FAIL
@@ -5660,6 +6038,14 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
                                        attribute_values);
             set_client_state (CLIENT_GET_GROUPS);
           }
+        else if (strcasecmp ("GET_HOST_TRENDS", element_name) == 0)
+          {
+            append_attribute (attribute_names, attribute_values, "host_id",
+                              &get_host_trends_data->host_id);
+            append_attribute (attribute_names, attribute_values, "days",
+                              &get_host_trends_data->days);
+            set_client_state (CLIENT_GET_HOST_TRENDS);
+          }
         else if (strcasecmp ("GET_NOTES", element_name) == 0)
           {
             const gchar* attribute;
@@ -5695,6 +6081,8 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
             append_attribute (attribute_names, attribute_values,
                               "preferences_config_id",
                               &get_nvts_data->preferences_config_id);
+            append_attribute (attribute_names, attribute_values, "compress",
+                              &get_nvts_data->compress);
             if (find_attribute (attribute_names, attribute_values,
                                 "details", &attribute))
               get_nvts_data->details = strcmp (attribute, "0");
@@ -5797,6 +6185,8 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
                               &get_preferences_data->preference);
             set_client_state (CLIENT_GET_PREFERENCES);
           }
+        else if (strcasecmp ("GET_PROCESSES", element_name) == 0)
+          set_client_state (CLIENT_GET_PROCESSES);
         else if (strcasecmp ("GET_REPORTS", element_name) == 0)
           {
             const gchar* attribute;
@@ -5834,6 +6224,9 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
             append_attribute (attribute_names, attribute_values, "format_id",
                               &get_reports_data->format_id);
 
+            append_attribute (attribute_names, attribute_values, "compress",
+                              &get_reports_data->compress);
+
             if (find_attribute (attribute_names, attribute_values,
                                 "lean", &attribute))
               get_reports_data->lean = atoi (attribute);
@@ -5899,6 +6292,9 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
             append_attribute (attribute_names, attribute_values, "task_id",
                               &get_results_data->task_id);
 
+            append_attribute (attribute_names, attribute_values, "compress",
+                              &get_results_data->compress);
+
             if (find_attribute (attribute_names, attribute_values,
                                 "notes_details", &attribute))
               get_results_data->notes_details = strcmp (attribute, "0");
@@ -6331,6 +6727,8 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
           {
             /* Init, so it's the empty string when the entity is empty. */
             append_to_credentials_password (&current_credentials, "", 0);
+            g_free (credentials_token);
+            credentials_token = NULL;
             set_client_state (CLIENT_AUTHENTICATE_CREDENTIALS);
           }
         ELSE_READ_OVER;
@@ -6340,6 +6738,11 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
           set_client_state (CLIENT_AUTHENTICATE_CREDENTIALS_USERNAME);
         else if (strcasecmp ("PASSWORD", element_name) == 0)
           set_client_state (CLIENT_AUTHENTICATE_CREDENTIALS_PASSWORD);
+        else if (strcasecmp ("TOKEN", element_name) == 0)
+          {
+            gvm_append_string (&credentials_token, "");
+            set_client_state (CLIENT_AUTHENTICATE_CREDENTIALS_TOKEN);
+          }
         ELSE_READ_OVER;
 
       case CLIENT_CREATE_SCANNER:
@@ -7602,6 +8005,7 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
                 create_report_data->host_ends = make_array ();
                 create_report_data->host_starts = make_array ();
                 create_report_data->results = make_array ();
+                create_report_data->results_arena = arena_new (0);
                 set_client_state (CLIENT_CREATE_REPORT_RR);
               }
           }
@@ -7620,6 +8024,7 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
             create_report_data->host_ends = make_array ();
             create_report_data->host_starts = make_array ();
             create_report_data->results = make_array ();
+            create_report_data->results_arena = arena_new (0);
             set_client_state (CLIENT_CREATE_REPORT_RR);
           }
         ELSE_READ_OVER;
@@ -7639,6 +8044,8 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
           set_client_state (CLIENT_CREATE_REPORT_RR_HOST_START);
         else if (strcasecmp ("RESULTS", element_name) == 0)
           set_client_state (CLIENT_CREATE_REPORT_RR_RESULTS);
+        else if (strcasecmp ("RESULT_COUNT", element_name) == 0)
+          set_client_state (CLIENT_CREATE_REPORT_RR_RESULT_COUNT);
         else if (strcasecmp ("SCAN_END", element_name) == 0)
           {
             set_client_state (CLIENT_CREATE_REPORT_RR_SCAN_END);
@@ -7666,8 +8073,13 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
           }
         else if (strcasecmp ("NVT", element_name) == 0)
           {
-            append_attribute (attribute_names, attribute_values, "oid",
-                              &create_report_data->result_nvt_oid);
+            const gchar *attribute;
+
+            if (find_attribute (attribute_names, attribute_values, "oid",
+                                &attribute))
+              create_report_data->result_nvt_oid
+               = arena_strdup (create_report_data->results_arena,
+                               attribute);
             set_client_state (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_NVT);
           }
         else if (strcasecmp ("PORT", element_name) == 0)
@@ -7771,8 +8183,13 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
           }
         else if (strcasecmp ("NVT", element_name) == 0)
           {
-            append_attribute (attribute_names, attribute_values, "oid",
-                              &create_report_data->result_nvt_oid);
+            const gchar *attribute;
+
+            if (find_attribute (attribute_names, attribute_values, "oid",
+                                &attribute))
+              create_report_data->result_nvt_oid
+               = arena_strdup (create_report_data->results_arena,
+                               attribute);
             set_client_state (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_NVT);
           }
         else if (strcasecmp ("ORIGINAL_SEVERITY", element_name) == 0)
@@ -12158,7 +12575,14 @@ handle_get_configs (gmp_parser_t *gmp_parser, GError **error)
               const char *family;
 
               family = family_iterator_name (&families);
-              if (family)
+              if (family
+                  && nvt_selector_family_counts (selector, family,
+                                                 &family_growing,
+                                                 &family_selected_count,
+                                                 &family_max)
+                     == 0)
+                known_nvt_count += family_selected_count;
+              else if (family)
                 {
                   family_growing = nvt_selector_family_growing
                                     (selector, family, config_families_growing);
@@ -13221,6 +13645,106 @@ handle_get_groups (gmp_parser_t *gmp_parser, GError **error)
   set_client_state (CLIENT_AUTHENTIC);
 }
 
+/**
+ * @brief Default number of days for GET_HOST_TRENDS.
+ */
+#define HOST_TRENDS_DEFAULT_DAYS 90
+
+/**
+ * @brief Handle end of GET_HOST_TRENDS element.
+ *
+ * @param[in]  gmp_parser   GMP parser.
+ * @param[in]  error        Error parameter.
+ */
+static void
+handle_get_host_trends (gmp_parser_t *gmp_parser, GError **error)
+{
+  iterator_t points;
+  int days;
+
+  if (acl_user_may ("get_host_trends") == 0)
+    {
+      SEND_TO_CLIENT_OR_FAIL
+       (XML_ERROR_SYNTAX ("get_host_trends",
+                          "Permission denied"));
+      get_host_trends_data_reset (get_host_trends_data);
+      set_client_state (CLIENT_AUTHENTIC);
+      return;
+    }
+
+  days = get_host_trends_data->days
+          ? atoi (get_host_trends_data->days)
+          : HOST_TRENDS_DEFAULT_DAYS;
+  if (days <= 0)
+    {
+      SEND_TO_CLIENT_OR_FAIL
+       (XML_ERROR_SYNTAX ("get_host_trends",
+                          "DAYS must be greater than 0"));
+      get_host_trends_data_reset (get_host_trends_data);
+      set_client_state (CLIENT_AUTHENTIC);
+      return;
+    }
+
+  switch (init_host_trend_iterator (&points, get_host_trends_data->host_id,
+                                    days))
+    {
+      case 0:
+        break;
+      case 1:
+        if (send_find_error_to_client ("get_host_trends", "host",
+                                       get_host_trends_data->host_id,
+                                       gmp_parser))
+          {
+            error_send_to_client (error);
+            return;
+          }
+        get_host_trends_data_reset (get_host_trends_data);
+        set_client_state (CLIENT_AUTHENTIC);
+        return;
+      default:
+        SEND_TO_CLIENT_OR_FAIL
+         (XML_INTERNAL_ERROR ("get_host_trends"));
+        get_host_trends_data_reset (get_host_trends_data);
+        set_client_state (CLIENT_AUTHENTIC);
+        return;
+    }
+
+  SEND_TO_CLIENT_OR_FAIL ("<get_host_trends_response"
+                          " status=\"" STATUS_OK "\""
+                          " status_text=\"" STATUS_OK_TEXT "\">");
+  while (next (&points))
+    {
+      time_t day;
+
+      day = host_trend_iterator_day (&points);
+      SENDF_TO_CLIENT_OR_FAIL ("<point>"
+                               "<date>%s</date>",
+                               iso_time_tz (&day, "UTC", NULL));
+      SENDF_TO_CLIENT_OR_FAIL ("<hosts>%i</hosts>"
+                               "<max_severity>%1.1f</max_severity>"
+                               "<high>%i</high>"
+                               "<medium>%i</medium>"
+                               "<low>%i</low>"
+                               "<log>%i</log>"
+                               "<open>%i</open>"
+                               "<closed>%i</closed>"
+                               "</point>",
+                               host_trend_iterator_hosts (&points),
+                               host_trend_iterator_max_severity (&points),
+                               host_trend_iterator_high (&points),
+                               host_trend_iterator_medium (&points),
+                               host_trend_iterator_low (&points),
+                               host_trend_iterator_log (&points),
+                               host_trend_iterator_open (&points),
+                               host_trend_iterator_closed (&points));
+    }
+  cleanup_iterator (&points);
+  SEND_TO_CLIENT_OR_FAIL ("</get_host_trends_response>");
+
+  get_host_trends_data_reset (get_host_trends_data);
+  set_client_state (CLIENT_AUTHENTIC);
+}
+
 /**
  * @brief Handle end of GET_INFO element.
  *
@@ -14548,6 +15072,77 @@ handle_get_preferences (gmp_parser_t *gmp_parser, GError **error)
   set_client_state (CLIENT_AUTHENTIC);
 }
 
+/**
+ * @brief Handle end of GET_PROCESSES element.
+ *
+ * @param[in]  gmp_parser   GMP parser.
+ * @param[in]  error        Error parameter.
+ */
+static void
+handle_get_processes (gmp_parser_t *gmp_parser, GError **error)
+{
+  iterator_t processes;
+
+  if (acl_user_may ("get_processes") == 0)
+    {
+      SEND_TO_CLIENT_OR_FAIL
+       (XML_ERROR_SYNTAX ("get_processes",
+                          "Permission denied"));
+      set_client_state (CLIENT_AUTHENTIC);
+      return;
+    }
+
+  /* Make sure the row of this process is current. */
+  manage_process_update ();
+
+  SEND_TO_CLIENT_OR_FAIL ("<get_processes_response"
+                          " status=\"" STATUS_OK "\""
+                          " status_text=\"" STATUS_OK_TEXT "\">");
+
+  init_process_iterator (&processes);
+  while (next (&processes))
+    {
+      time_t start_time, update_time;
+
+      SENDF_TO_CLIENT_OR_FAIL ("<process>"
+                               "<pid>%i</pid>"
+                               "<role>%s</role>",
+                               process_iterator_pid (&processes),
+                               process_iterator_role (&processes));
+      if (process_iterator_node (&processes)
+          && strlen (process_iterator_node (&processes)))
+        SENDF_TO_CLIENT_OR_FAIL ("<node>%s</node>",
+                                 process_iterator_node (&processes));
+      if (process_iterator_task_id (&processes))
+        SENDF_TO_CLIENT_OR_FAIL ("<task id=\"%s\"/>",
+                                 process_iterator_task_id (&processes));
+      if (process_iterator_report_id (&processes))
+        SENDF_TO_CLIENT_OR_FAIL ("<report id=\"%s\"/>",
+                                 process_iterator_report_id (&processes));
+      start_time = process_iterator_start_time (&processes);
+      SENDF_TO_CLIENT_OR_FAIL ("<start_time>%s</start_time>",
+                               iso_time (&start_time));
+      update_time = process_iterator_update_time (&processes);
+      SENDF_TO_CLIENT_OR_FAIL ("<update_time>%s</update_time>",
+                               iso_time (&update_time));
+      SENDF_TO_CLIENT_OR_FAIL ("<rss>%lli</rss>"
+                               "<peak_rss>%lli</peak_rss>"
+                               "<cpu_time>%.3f</cpu_time>"
+                               "<sql_count>%lli</sql_count>"
+                               "<sql_time>%.3f</sql_time>"
+                               "</process>",
+                               process_iterator_rss (&processes),
+                               process_iterator_peak_rss (&processes),
+                               process_iterator_cpu_time (&processes),
+                               process_iterator_sql_count (&processes),
+                               process_iterator_sql_time (&processes));
+    }
+  cleanup_iterator (&processes);
+
+  SEND_TO_CLIENT_OR_FAIL ("</get_processes_response>");
+  set_client_state (CLIENT_AUTHENTIC);
+}
+
 /**
  * @brief Handle end of GET_REPORTS element.
  *
@@ -14839,6 +15434,7 @@ handle_get_reports (gmp_parser_t *gmp_parser, GError **error)
     {
       gchar *extension, *content_type;
       GString *prefix;
+      task_t render_task;
 
       prefix = g_string_new ("");
       content_type = report_format_content_type (report_format);
@@ -14944,6 +15540,9 @@ handle_get_reports (gmp_parser_t *gmp_parser, GError **error)
       if (get_reports_data->alert_id)
         get_reports_data->get.details = 1;
 
+      if (report_task (report, &render_task))
+        render_task = 0;
+      manage_process_set_work (render_task, report);
       ret = manage_send_report (report,
                                 delta_report,
                                 report_format,
@@ -14966,6 +15565,7 @@ handle_get_reports (gmp_parser_t *gmp_parser, GError **error)
                                 gmp_parser->client_writer_data,
                                 get_reports_data->alert_id,
                                 prefix->str);
+      manage_process_set_work (0, 0);
       g_string_free (prefix, TRUE);
       if (ret)
         {
@@ -17253,7 +17853,10 @@ handle_get_targets (gmp_parser_t *gmp_parser, GError **error)
 
           hosts = target_iterator_hosts (&targets);
           exclude_hosts = target_iterator_exclude_hosts (&targets);
-          max_hosts = manage_count_hosts_max (hosts, exclude_hosts, 0);
+          if (get_targets_data->get.trash)
+            max_hosts = manage_count_hosts_max (hosts, exclude_hosts, 0);
+          else
+            max_hosts = target_max_hosts (get_iterator_resource (&targets));
           reverse_lookup_only = target_iterator_reverse_lookup_only
                                   (&targets);
           reverse_lookup_unify = target_iterator_reverse_lookup_unify
@@ -19103,6 +19706,61 @@ modify_config_leave:
 
 extern char client_address[];
 
+/**
+ * @brief Start compressing the response to a command, if requested.
+ *
+ * The whole response, from the opening tag to the closing tag, goes to
+ * the client as a single gzip member, which the client can decompress as
+ * it arrives.
+ *
+ * @param[in]  gmp_parser  GMP parser.
+ * @param[in]  method      COMPRESS attribute of command, or NULL.
+ * @param[in]  command     Name of command, for error response.
+ * @param[in]  error       Error parameter.
+ *
+ * @return 0 success, 1 sent error response to client.
+ */
+static int
+gmp_compress_start (gmp_parser_t *gmp_parser, const char *method,
+                    const char *command, GError **error)
+{
+  gchar *msg;
+
+  if (method == NULL || strcmp (method, "") == 0)
+    return 0;
+
+  if (gmp_parser->client_compress
+      && strcasecmp (method, "gzip") == 0
+      && gmp_parser->client_compress ("gzip",
+                                      gmp_parser->client_writer_data)
+         == 0)
+    return 0;
+
+  msg = g_strdup_printf ("<%s_response status=\""
+                         STATUS_ERROR_SYNTAX
+                         "\" status_text=\"COMPRESS must be gzip\"/>",
+                         command);
+  if (send_to_client (msg, gmp_parser->client_writer,
+                      gmp_parser->client_writer_data))
+    error_send_to_client (error);
+  g_free (msg);
+  return 1;
+}
+
+/**
+ * @brief Finish compressing the response to a command.
+ *
+ * Does nothing if the response is not being compressed.
+ *
+ * @param[in]  gmp_parser  GMP parser.
+ */
+static void
+gmp_compress_finish (gmp_parser_t *gmp_parser)
+{
+  if (gmp_parser->client_compress)
+    gmp_parser->client_compress (NULL, gmp_parser->client_writer_data);
+}
+
 /**
  * @brief Handle the end of a GMP XML element.
  *
@@ -19151,12 +19809,16 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         break;
 
       case CLIENT_AUTHENTICATE:
-        switch (authenticate (&current_credentials))
+        switch (credentials_token
+                 ? authenticate_token (&current_credentials,
+                                       credentials_token)
+                 : authenticate (&current_credentials))
           {
             case 0:   /* Authentication succeeded. */
               {
                 const char *zone, *severity;
                 char *pw_warning;
+                gchar *token;
 
                 zone = (current_credentials.timezone
                         && strlen (current_credentials.timezone))
@@ -19178,9 +19840,26 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
                 manage_session_set_timezone (zone);
 
                 severity = setting_severity ();
-                pw_warning = gvm_validate_password
-                              (current_credentials.password,
-                               current_credentials.username);
+                if (credentials_token)
+                  {
+                    /* The password was checked when the token was issued. */
+                    pw_warning = NULL;
+                    token = g_strdup ("");
+                  }
+                else
+                  {
+                    gchar *new_token;
+
+                    pw_warning = gvm_validate_password
+                                  (current_credentials.password,
+                                   current_credentials.username);
+                    new_token = auth_token_new (&current_credentials);
+                    token = new_token
+                             ? g_markup_printf_escaped ("<token>%s</token>",
+                                                        new_token)
+                             : g_strdup ("");
+                    g_free (new_token);
+                  }
 
                 if (pw_warning)
                   SENDF_TO_CLIENT_OR_FAIL
@@ -19190,6 +19869,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
                     "<role>%s</role>"
                     "<timezone>%s</timezone>"
                     "<severity>%s</severity>"
+                    "%s"
                     "<password_warning>%s</password_warning>"
                     "</authenticate_response>",
                     current_credentials.role
@@ -19197,6 +19877,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
                       : "",
                     zone,
                     severity,
+                    token,
                     pw_warning ? pw_warning : "");
                 else
                   SENDF_TO_CLIENT_OR_FAIL
@@ -19206,14 +19887,17 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
                     "<role>%s</role>"
                     "<timezone>%s</timezone>"
                     "<severity>%s</severity>"
+                    "%s"
                     "</authenticate_response>",
                     current_credentials.role
                       ? current_credentials.role
                       : "",
                     zone,
-                    severity);
+                    severity,
+                    token);
 
                 free (pw_warning);
+                g_free (token);
                 set_client_state (CLIENT_AUTHENTIC);
 
                 break;
@@ -19242,6 +19926,8 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
               set_client_state (CLIENT_TOP);
               break;
           }
+        g_free (credentials_token);
+        credentials_token = NULL;
         break;
 
       case CLIENT_AUTHENTICATE_CREDENTIALS:
@@ -19256,6 +19942,10 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         set_client_state (CLIENT_AUTHENTICATE_CREDENTIALS);
         break;
 
+      case CLIENT_AUTHENTICATE_CREDENTIALS_TOKEN:
+        set_client_state (CLIENT_AUTHENTICATE_CREDENTIALS);
+        break;
+
       CASE_DELETE (ALERT, alert, "Alert");
 
       case CLIENT_DELETE_ASSET:
@@ -19700,6 +20390,10 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         handle_get_groups (gmp_parser, error);
         break;
 
+      case CLIENT_GET_HOST_TRENDS:
+        handle_get_host_trends (gmp_parser, error);
+        break;
+
       case CLIENT_GET_INFO:
         handle_get_info (gmp_parser, error);
         break;
@@ -19709,7 +20403,17 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         break;
 
       case CLIENT_GET_NVTS:
-        handle_get_nvts (gmp_parser, error);
+        if (gmp_compress_start (gmp_parser, get_nvts_data->compress,
+                                "get_nvts", error) == 0)
+          {
+            handle_get_nvts (gmp_parser, error);
+            gmp_compress_finish (gmp_parser);
+          }
+        else
+          {
+            get_nvts_data_reset (get_nvts_data);
+            set_client_state (CLIENT_AUTHENTIC);
+          }
         break;
 
       case CLIENT_GET_NVT_FAMILIES:
@@ -19732,8 +20436,22 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         handle_get_preferences (gmp_parser, error);
         break;
 
+      case CLIENT_GET_PROCESSES:
+        handle_get_processes (gmp_parser, error);
+        break;
+
       case CLIENT_GET_REPORTS:
-        handle_get_reports (gmp_parser, error);
+        if (gmp_compress_start (gmp_parser, get_reports_data->compress,
+                                "get_reports", error) == 0)
+          {
+            handle_get_reports (gmp_parser, error);
+            gmp_compress_finish (gmp_parser);
+          }
+        else
+          {
+            get_reports_data_reset (get_reports_data);
+            set_client_state (CLIENT_AUTHENTIC);
+          }
         break;
 
       case CLIENT_GET_REPORT_FORMATS:
@@ -19741,7 +20459,17 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         break;
 
       case CLIENT_GET_RESULTS:
-        handle_get_results (gmp_parser, error);
+        if (gmp_compress_start (gmp_parser, get_results_data->compress,
+                                "get_results", error) == 0)
+          {
+            handle_get_results (gmp_parser, error);
+            gmp_compress_finish (gmp_parser);
+          }
+        else
+          {
+            get_results_data_reset (get_results_data);
+            set_client_state (CLIENT_AUTHENTIC);
+          }
         break;
 
       case CLIENT_GET_ROLES:
@@ -20634,6 +21362,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
                    (XML_OK_CREATED_ID ("create_credential"), uuid);
                   log_event ("credential", "Credential", uuid, "created");
                   free (uuid);
+                  credential_prebuild_packages (new_credential);
                   break;
                 }
               case 1:
@@ -21594,11 +22323,27 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         {
           char *uuid;
 
+          uuid = NULL;
+          if (create_report_data->stream_report)
+            {
+              uuid = create_report_data->stream_report_id;
+              create_report_data->stream_report_id = NULL;
+            }
+
           array_terminate (create_report_data->results);
           array_terminate (create_report_data->host_ends);
           array_terminate (create_report_data->host_starts);
           array_terminate (create_report_data->details);
 
+          /* A streamed upload that fails here leaves the task running, so
+           * clean up the same way as for a failed import. */
+          if (create_report_data->stream_report
+              && (create_report_data->stream_error
+                  || create_report_data->results == NULL
+                  || (create_report_data->type
+                      && strcmp (create_report_data->type, "scan"))))
+            create_report_stream_abort (create_report_data->stream_report);
+
           if (create_report_data->results == NULL)
             SEND_TO_CLIENT_OR_FAIL
              (XML_ERROR_SYNTAX ("create_report",
@@ -21608,16 +22353,20 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
             SEND_TO_CLIENT_OR_FAIL
              (XML_ERROR_SYNTAX ("create_report",
                                 "Type must be 'scan'"));
-          else switch (create_report
-                        (create_report_data->results,
-                         create_report_data->task_id,
-                         create_report_data->in_assets,
-                         create_report_data->scan_start,
-                         create_report_data->scan_end,
-                         create_report_data->host_starts,
-                         create_report_data->host_ends,
-                         create_report_data->details,
-                         &uuid))
+          else switch (create_report_data->stream_error
+                        ? create_report_data->stream_error
+                        : create_report
+                           (create_report_data->results,
+                            create_report_data->task_id,
+                            create_report_data->in_assets,
+                            create_report_data->scan_start,
+                            create_report_data->scan_end,
+                            create_report_data->host_starts,
+                            create_report_data->host_ends,
+                            create_report_data->details,
+                            create_report_data->stream_report,
+                            create_report_data->stream_count,
+                            &uuid))
             {
               case 99:
                 SEND_TO_CLIENT_OR_FAIL
@@ -21627,6 +22376,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
                 break;
               case -1:
               case -2:
+                free (uuid);
                 SEND_TO_CLIENT_OR_FAIL
                  (XML_INTERNAL_ERROR ("create_report"));
                 log_event_fail ("report", "Report", NULL, "created");
@@ -21691,19 +22441,23 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
           assert (create_report_data->results);
 
           if (create_report_data->result_scan_nvt_version == NULL)
-            create_report_data->result_scan_nvt_version = strdup ("");
+            create_report_data->result_scan_nvt_version
+              = arena_strdup (create_report_data->results_arena, "");
 
           if (create_report_data->result_severity == NULL)
             {
-              create_report_data->result_severity = strdup ("-3.0");
+              create_report_data->result_severity
+                = arena_strdup (create_report_data->results_arena, "-3.0");
             }
 
           if (create_report_data->result_threat == NULL)
             {
-              create_report_data->result_threat = strdup ("Error");
+              create_report_data->result_threat
+                = arena_strdup (create_report_data->results_arena, "Error");
             }
 
-          result = g_malloc (sizeof (create_report_result_t));
+          result = arena_alloc (create_report_data->results_arena,
+                               sizeof (create_report_result_t));
           result->description = create_report_data->result_description;
           result->host = create_report_data->result_host;
           result->hostname = create_report_data->result_hostname;
@@ -21717,6 +22471,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
           result->threat = create_report_data->result_threat;
 
           array_add (create_report_data->results, result);
+          create_report_data_stream (create_report_data);
 
           create_report_data->result_description = NULL;
           create_report_data->result_host = NULL;
@@ -21790,6 +22545,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         set_client_state (CLIENT_CREATE_REPORT_RR);
         break;
       CLOSE (CLIENT_CREATE_REPORT_RR, RESULTS);
+      CLOSE (CLIENT_CREATE_REPORT_RR, RESULT_COUNT);
       CLOSE (CLIENT_CREATE_REPORT_RR, SCAN_END);
       CLOSE (CLIENT_CREATE_REPORT_RR, SCAN_START);
 
@@ -21879,32 +22635,41 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
           assert (create_report_data->results);
 
           if (create_report_data->result_scan_nvt_version == NULL)
-            create_report_data->result_scan_nvt_version = strdup ("");
+            create_report_data->result_scan_nvt_version
+              = arena_strdup (create_report_data->results_arena, "");
 
           if (create_report_data->result_severity == NULL)
             {
               if (create_report_data->result_threat == NULL)
-                create_report_data->result_severity = strdup ("");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "");
               else if (strcasecmp (create_report_data->result_threat,
                               "High") == 0)
-                create_report_data->result_severity = strdup ("10.0");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "10.0");
               else if (strcasecmp (create_report_data->result_threat,
                                    "Medium") == 0)
-                create_report_data->result_severity = strdup ("5.0");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "5.0");
               else if (strcasecmp (create_report_data->result_threat,
                                    "Low")  == 0)
-                create_report_data->result_severity = strdup ("2.0");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "2.0");
               else if (strcasecmp (create_report_data->result_threat,
                                    "Log")  == 0)
-                create_report_data->result_severity = strdup ("0.0");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "0.0");
               else if (strcasecmp (create_report_data->result_threat,
                                    "False Positive")  == 0)
-                create_report_data->result_severity = strdup ("-1.0");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "-1.0");
               else
-                create_report_data->result_severity = strdup ("");
+                create_report_data->result_severity
+                  = arena_strdup (create_report_data->results_arena, "");
             }
 
-          result = g_malloc (sizeof (create_report_result_t));
+          result = arena_alloc (create_report_data->results_arena,
+                               sizeof (create_report_result_t));
           result->description = create_report_data->result_description;
           result->host = create_report_data->result_host;
           result->hostname = create_report_data->result_hostname;
@@ -21918,6 +22683,7 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
           result->threat = create_report_data->result_threat;
 
           array_add (create_report_data->results, result);
+          create_report_data_stream (create_report_data);
 
           create_report_data->result_description = NULL;
           create_report_data->result_host = NULL;
@@ -26591,6 +27357,20 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
     gvm_append_text (dest, text, text_len);  \
     break;
 
+/**
+ * @brief Append text to a var of the current create_report result.
+ *
+ * The text goes into the results arena, so the var must not be freed.
+ *
+ * @param[in]  state  Parser state.
+ * @param[in]  dest   Append destination.
+ */
+#define APPEND_RESULT(state, dest)                                \
+  case state:                                                     \
+    arena_append (create_report_data->results_arena, dest, text,  \
+                  text_len);                                      \
+    break;
+
 /**
  * @brief Handle the addition of text to a GMP XML element.
  *
@@ -26624,6 +27404,8 @@ gmp_xml_handle_text (/* unused */ GMarkupParseContext* context,
         append_to_credentials_password (&current_credentials, text, text_len);
         break;
 
+      APPEND (CLIENT_AUTHENTICATE_CREDENTIALS_TOKEN, &credentials_token);
+
       APPEND (CLIENT_MODIFY_CONFIG_NVT_SELECTION_FAMILY,
               &modify_config_data->nvt_selection_family);
 
@@ -26994,20 +27776,20 @@ gmp_xml_handle_text (/* unused */ GMarkupParseContext* context,
       APPEND (CLIENT_CREATE_REPORT_IN_ASSETS,
               &create_report_data->in_assets);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_DESCRIPTION,
-              &create_report_data->result_description);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_DESCRIPTION,
+                     &create_report_data->result_description);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_HOST,
-              &create_report_data->result_host);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_HOST,
+                     &create_report_data->result_host);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_HOST_HOSTNAME,
-              &create_report_data->result_hostname);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_HOST_HOSTNAME,
+                     &create_report_data->result_hostname);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_SCAN_NVT_VERSION,
-              &create_report_data->result_scan_nvt_version);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_SCAN_NVT_VERSION,
+                     &create_report_data->result_scan_nvt_version);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_PORT,
-              &create_report_data->result_port);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_ERRORS_ERROR_PORT,
+                     &create_report_data->result_port);
 
       APPEND (CLIENT_CREATE_REPORT_RR_HOST_END,
               &create_report_data->host_end);
@@ -27022,6 +27804,9 @@ gmp_xml_handle_text (/* unused */ GMarkupParseContext* context,
               &create_report_data->host_start_host);
 
 
+      APPEND (CLIENT_CREATE_REPORT_RR_RESULT_COUNT,
+              &create_report_data->result_count);
+
       APPEND (CLIENT_CREATE_REPORT_RR_SCAN_END,
               &create_report_data->scan_end);
 
@@ -27029,32 +27814,32 @@ gmp_xml_handle_text (/* unused */ GMarkupParseContext* context,
               &create_report_data->scan_start);
 
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_DESCRIPTION,
-              &create_report_data->result_description);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_DESCRIPTION,
+                     &create_report_data->result_description);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_HOST,
-              &create_report_data->result_host);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_HOST,
+                     &create_report_data->result_host);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_HOST_HOSTNAME,
-              &create_report_data->result_hostname);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_HOST_HOSTNAME,
+                     &create_report_data->result_hostname);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_SCAN_NVT_VERSION,
-              &create_report_data->result_scan_nvt_version);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_SCAN_NVT_VERSION,
+                     &create_report_data->result_scan_nvt_version);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_PORT,
-              &create_report_data->result_port);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_PORT,
+                     &create_report_data->result_port);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_QOD_TYPE,
-              &create_report_data->result_qod_type);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_QOD_TYPE,
+                     &create_report_data->result_qod_type);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_QOD_VALUE,
-              &create_report_data->result_qod);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_QOD_VALUE,
+                     &create_report_data->result_qod);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_SEVERITY,
-              &create_report_data->result_severity);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_SEVERITY,
+                     &create_report_data->result_severity);
 
-      APPEND (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_THREAT,
-              &create_report_data->result_threat);
+      APPEND_RESULT (CLIENT_CREATE_REPORT_RR_RESULTS_RESULT_THREAT,
+                     &create_report_data->result_threat);
 
 
       APPEND (CLIENT_CREATE_REPORT_RR_H_DETAIL_NAME,
@@ -27650,6 +28435,10 @@ init_gmp (GSList *log_config, const gchar *database,
  * @param[in]  database          Location of manage database.
  * @param[in]  write_to_client       Function to write to client.
  * @param[in]  write_to_client_data  Argument to \p write_to_client.
+ * @param[in]  compress_client       Function to start or finish compressing
+ *                                   output to client, or NULL.
+ * @param[in]  flush_client          Function to write queued output to
+ *                                   client, or NULL.
  * @param[in]  disable               Commands to disable.
  *
  * This should run once per process, before the first call to \ref
@@ -27658,7 +28447,10 @@ init_gmp (GSList *log_config, const gchar *database,
 void
 init_gmp_process (const gchar *database,
                   int (*write_to_client) (const char*, void*),
-                  void* write_to_client_data, gchar **disable)
+                  void* write_to_client_data,
+                  int (*compress_client) (const char*, void*),
+                  int (*flush_client) (void*),
+                  gchar **disable)
 {
   client_state = CLIENT_TOP;
   command_data_init (&command_data);
@@ -27677,7 +28469,7 @@ init_gmp_process (const gchar *database,
                  (&xml_parser,
                   0,
                   gmp_parser_new (write_to_client, write_to_client_data,
-                                  disable),
+                                  compress_client, flush_client, disable),
                   (GDestroyNotify) gmp_parser_free);
 }
 
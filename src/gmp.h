@@ -54,11 +54,18 @@ init_gmp (GSList *, const gchar *, int, int, int, int,
 
 void
 init_gmp_process (const gchar *, int (*) (const char *, void *), void *,
+                  int (*) (const char *, void *), int (*) (void *),
                   gchar **);
 
 int
 process_gmp_client_input ();
 
+void
+gmp_command_stats_flush ();
+
+void
+gmp_abort_commands ();
+
 /** @todo As described in gmp.c, probably should be replaced by gmp_parser_t. */
 extern char to_client[];
 extern buffer_size_t to_client_start;
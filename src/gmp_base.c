@@ -33,6 +33,7 @@
 
 #include "gmp_base.h"
 #include "manage.h"
+#include "utils.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -111,17 +112,70 @@ void
 buffer_xml_append_printf (GString *buffer, const char *format, ...)
 {
   va_list args;
-  gchar *msg;
   va_start (args, format);
-  msg = g_markup_vprintf_escaped (format, args);
+  xml_string_vappend_escaped (buffer, format, args);
   va_end (args);
-  g_string_append (buffer, msg);
-  g_free (msg);
 }
 
 
 /* Communication. */
 
+/**
+ * @brief Number of bytes sent to the client by this process.
+ */
+static unsigned long long sent_bytes = 0;
+
+/**
+ * @brief Get the number of bytes sent to the client by this process.
+ *
+ * @return Number of bytes sent with send_to_client.
+ */
+unsigned long long
+gmp_sent_bytes ()
+{
+  return sent_bytes;
+}
+
+/**
+ * @brief Whether sending to the client is stopped.
+ */
+static int send_stopped = 0;
+
+/**
+ * @brief Stop or resume sending to the client.
+ *
+ * While stopped, send_to_client fails, so that the command handler gives up
+ * through its usual error path.
+ *
+ * @param[in]  stop  1 to stop, 0 to resume.
+ */
+void
+gmp_send_stop (int stop)
+{
+  send_stopped = stop;
+}
+
+/**
+ * @brief Escaped request ID to add to the next response, or NULL.
+ */
+static gchar *request_id = NULL;
+
+/**
+ * @brief Set the request ID of the command being processed.
+ *
+ * Clients that pipeline commands on one connection can give each command
+ * a request_id attribute.  The response of the command carries the same
+ * attribute.
+ *
+ * @param[in]  id  Request ID, or NULL for none.
+ */
+void
+gmp_set_request_id (const char *id)
+{
+  g_free (request_id);
+  request_id = id ? g_markup_escape_text (id, -1) : NULL;
+}
+
 /**
  * @brief Send a response message to the client.
  *
@@ -136,8 +190,31 @@ send_to_client (const char* msg,
                 int (*user_send_to_client) (const char*, void*),
                 void* user_send_to_client_data)
 {
+  if (send_stopped)
+    return TRUE;
   if (user_send_to_client && msg)
-    return user_send_to_client (msg, user_send_to_client_data);
+    {
+      if (request_id && msg[0] == '<')
+        {
+          gchar *tagged;
+          size_t name_length;
+          gboolean ret;
+
+          /* Add the request ID to the response element. */
+          name_length = 1 + strcspn (msg + 1, " />");
+          tagged = g_strdup_printf ("%.*s request_id=\"%s\"%s",
+                                    (int) name_length, msg, request_id,
+                                    msg + name_length);
+          g_free (request_id);
+          request_id = NULL;
+          sent_bytes += strlen (tagged);
+          ret = user_send_to_client (tagged, user_send_to_client_data);
+          g_free (tagged);
+          return ret;
+        }
+      sent_bytes += strlen (msg);
+      return user_send_to_client (msg, user_send_to_client_data);
+    }
   return FALSE;
 }
 
@@ -35,6 +35,9 @@ typedef struct
 {
   int (*client_writer) (const char *, void *); ///< Writes to the client.
   void *client_writer_data;                    ///< Argument to client_writer.
+  int (*client_compress) (const char *, void *); ///< Starts or finishes
+                                                 ///< compressing output.
+  int (*client_flush) (void *); ///< Writes queued output to the client.
   int importing;             ///< Whether the current op is importing.
   int read_over;             ///< Read over any child elements.
   int parent_state;          ///< Parent state when reading over.
@@ -53,6 +56,15 @@ buffer_xml_append_printf (GString *, const char *, ...);
 gboolean
 send_to_client (const char *, int (*) (const char *, void *), void *);
 
+unsigned long long
+gmp_sent_bytes ();
+
+void
+gmp_send_stop (int);
+
+void
+gmp_set_request_id (const char *);
+
 gboolean
 send_find_error_to_client (const char *, const char *, const char *,
                            gmp_parser_t *);
@@ -44,7 +44,9 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <zlib.h>
 
 #include <gvm/util/serverutils.h>
 
@@ -117,7 +119,7 @@ init_gmpd_process (const gchar *database, gchar **disable)
 {
   from_client_start = 0;
   from_client_end = 0;
-  init_gmp_process (database, NULL, NULL, disable);
+  init_gmp_process (database, NULL, NULL, NULL, disable);
 }
 
 /**
@@ -349,67 +351,355 @@ write_to_client (gvm_connection_t *client_connection)
 }
 
 /**
- * @brief Send a response message to the client.
+ * @brief Wait until the client socket can be written to.
  *
- * Queue a message in \ref to_client.
+ * @param[in]  client_socket  The client socket.
  *
- * @param[in]  msg                   The message, a string.
- * @param[in]  write_to_client_data  Argument to \p write_to_client.
+ * @return 0 success, -1 error.
+ */
+static int
+wait_to_write_to_client (int client_socket)
+{
+  while (1)
+    {
+      fd_set writefds;
+
+      FD_ZERO (&writefds);
+      FD_SET (client_socket, &writefds);
+      if (select (client_socket + 1, NULL, &writefds, NULL, NULL) >= 0)
+        return 0;
+      if (errno == EINTR)
+        continue;
+      g_warning ("%s: select failed: %s", __func__, strerror (errno));
+      return -1;
+    }
+}
+
+/**
+ * @brief Write \ref to_client and then a message to the client.
  *
- * @return TRUE if write to client failed, else FALSE.
+ * The two are written with one writev, so the message is not copied.
+ *
+ * @param[in]  client_socket  The client socket.
+ * @param[in]  msg            The message.
+ * @param[in]  length         Length of message.
+ *
+ * @return 0 wrote everything, -1 error.
  */
-static gboolean
-gmpd_send_to_client (const char* msg, void* write_to_client_data)
+static int
+write_direct_to_client_unix (int client_socket, const char *msg,
+                             size_t length)
 {
-  assert (to_client_end <= TO_CLIENT_BUFFER_SIZE);
-  assert (msg);
+  while (to_client_start < to_client_end || length)
+    {
+      struct iovec iov[2];
+      ssize_t count;
+      int iov_count;
+
+      iov_count = 0;
+      if (to_client_start < to_client_end)
+        {
+          iov[iov_count].iov_base = to_client + to_client_start;
+          iov[iov_count].iov_len = to_client_end - to_client_start;
+          iov_count++;
+        }
+      if (length)
+        {
+          iov[iov_count].iov_base = (void *) msg;
+          iov[iov_count].iov_len = length;
+          iov_count++;
+        }
+
+      count = writev (client_socket, iov, iov_count);
+      if (count < 0)
+        {
+          if (errno == EAGAIN)
+            {
+              /* The caller frees msg, so wait until it's all written. */
+              if (wait_to_write_to_client (client_socket))
+                return -1;
+              continue;
+            }
+          if (errno == EINTR)
+            /* Interrupted, try write again. */
+            continue;
+          g_warning ("%s: failed to write to client: %s",
+                     __func__,
+                     strerror (errno));
+          return -1;
+        }
+      g_debug ("=> client  %u bytes", (unsigned int) count);
+
+      if (to_client_start < to_client_end)
+        {
+          size_t queued;
+
+          queued = to_client_end - to_client_start;
+          if ((size_t) count < queued)
+            {
+              to_client_start += count;
+              continue;
+            }
+          count -= queued;
+          to_client_start = to_client_end = 0;
+        }
+      msg += count;
+      length -= count;
+    }
+  g_debug ("=> client  done");
+
+  return 0;
+}
+
+/**
+ * @brief Write \ref to_client and then a message to the client, with TLS.
+ *
+ * The message is passed to GnuTLS straight from the caller, which sends it
+ * in full sized records.
+ *
+ * @param[in]  client_connection  The client connection.
+ * @param[in]  msg                The message.
+ * @param[in]  length             Length of message.
+ *
+ * @return 0 wrote everything, -1 error.
+ */
+static int
+write_direct_to_client_tls (gvm_connection_t *client_connection,
+                            const char *msg, size_t length)
+{
+  int ret;
+
+  while ((ret = write_to_client_tls (&client_connection->session)) == -2)
+    if (wait_to_write_to_client (client_connection->socket))
+      return -1;
+  if (ret)
+    return -1;
+
+  while (length)
+    {
+      ssize_t count;
+
+      count = gnutls_record_send (client_connection->session, msg, length);
+      if (count < 0)
+        {
+          if (count == GNUTLS_E_AGAIN)
+            {
+              /* The caller frees msg, so wait until it's all written. */
+              if (wait_to_write_to_client (client_connection->socket))
+                return -1;
+              continue;
+            }
+          if (count == GNUTLS_E_INTERRUPTED)
+            /* Interrupted, try write again. */
+            continue;
+          if (count == GNUTLS_E_REHANDSHAKE)
+            /** @todo Rehandshake. */
+            continue;
+          g_warning ("%s: failed to write to client: %s",
+                     __func__,
+                     gnutls_strerror ((int) count));
+          return -1;
+        }
+      g_debug ("=> client  %u bytes", (unsigned int) count);
+      msg += count;
+      length -= count;
+    }
+  g_debug ("=> client  done");
+
+  return 0;
+}
+
+/**
+ * @brief Compressor of output to the client.
+ */
+static z_stream client_compressor;
+
+/**
+ * @brief Whether output to the client is going through the compressor.
+ */
+static int client_compressing = 0;
+
+/**
+ * @brief Write all of \ref to_client to the client.
+ *
+ * @param[in]  client_connection  The client connection.
+ *
+ * @return 0 wrote everything, -1 error.
+ */
+static int
+flush_to_client (gvm_connection_t *client_connection)
+{
+  if (client_connection->tls)
+    return write_direct_to_client_tls (client_connection, "", 0);
+  return write_direct_to_client_unix (client_connection->socket, "", 0);
+}
 
-  while (((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end
-         < strlen (msg))
+/**
+ * @brief Write all of \ref to_client to the client.
+ *
+ * @param[in]  write_to_client_data  The client connection.
+ *
+ * @return 0 wrote everything, -1 error.
+ */
+static int
+gmpd_flush_client (void *write_to_client_data)
+{
+  return flush_to_client ((gvm_connection_t *) write_to_client_data);
+}
+
+/**
+ * @brief Compress a message into \ref to_client.
+ *
+ * Deflates straight into the free end of \ref to_client, writing the
+ * buffer to the client whenever it fills up.
+ *
+ * @param[in]  msg                The message.
+ * @param[in]  length             Length of message.
+ * @param[in]  flush              Z_NO_FLUSH, or Z_FINISH to end the stream.
+ * @param[in]  client_connection  The client connection.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+compress_to_client (const char *msg, size_t length, int flush,
+                    gvm_connection_t *client_connection)
+{
+  client_compressor.next_in = (Bytef *) msg;
+  client_compressor.avail_in = length;
+
+  while (1)
     {
-      buffer_size_t length;
+      int ret;
+
+      if (to_client_end == TO_CLIENT_BUFFER_SIZE
+          && flush_to_client (client_connection))
+        return -1;
 
-      /* Too little space in to_client buffer for message. */
+      client_compressor.next_out = (Bytef *) to_client + to_client_end;
+      client_compressor.avail_out = TO_CLIENT_BUFFER_SIZE - to_client_end;
+      ret = deflate (&client_compressor, flush);
+      to_client_end = TO_CLIENT_BUFFER_SIZE - client_compressor.avail_out;
 
-      switch (write_to_client (write_to_client_data))
+      if (ret == Z_STREAM_ERROR)
         {
-          case  0:      /* Wrote everything in to_client. */
-            break;
-          case -1:      /* Error. */
-            g_debug ("   %s full (%i < %zu); client write failed",
-                    __func__,
-                    ((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end,
-                    strlen (msg));
-            return TRUE;
-          case -2:      /* Wrote as much as client was willing to accept. */
-            break;
-          default:      /* Programming error. */
-            assert (0);
+          g_warning ("%s: deflate failed", __func__);
+          return -1;
         }
+      if (flush == Z_FINISH)
+        {
+          if (ret == Z_STREAM_END)
+            return 0;
+        }
+      else if (client_compressor.avail_in == 0
+               && client_compressor.avail_out)
+        return 0;
+    }
+}
+
+/**
+ * @brief Start or finish compressing output to the client.
+ *
+ * @param[in]  method                Compression method to start with, or
+ *                                   NULL to finish the current compression.
+ *                                   Only "gzip" is supported.
+ * @param[in]  write_to_client_data  The client connection.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+gmpd_compress_client (const char *method, void *write_to_client_data)
+{
+  int ret;
 
-      length = ((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end;
+  if (method)
+    {
+      if (client_compressing || strcmp (method, "gzip"))
+        return -1;
+      memset (&client_compressor, 0, sizeof (client_compressor));
+      /* Favour speed, because the point is to get big responses out sooner.
+       * The 16 added to the window bits asks for a gzip wrapper. */
+      if (deflateInit2 (&client_compressor, Z_BEST_SPEED, Z_DEFLATED,
+                        MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY)
+          != Z_OK)
+        {
+          g_warning ("%s: failed to init compressor", __func__);
+          return -1;
+        }
+      client_compressing = 1;
+      return 0;
+    }
+
+  if (client_compressing == 0)
+    return 0;
+
+  ret = compress_to_client ("", 0, Z_FINISH,
+                            (gvm_connection_t *) write_to_client_data);
+  deflateEnd (&client_compressor);
+  client_compressing = 0;
+  return ret;
+}
+
+/**
+ * @brief Send a response message to the client.
+ *
+ * While compressing, deflate the message into \ref to_client instead.
+ *
+ * Queue a message in \ref to_client.  If there is not enough space left
+ * in \ref to_client, write the queued output and the message straight to
+ * the client instead, without copying the message.
+ *
+ * @param[in]  msg                   The message, a string.
+ * @param[in]  write_to_client_data  Argument to \p write_to_client.
+ *
+ * @return TRUE if write to client failed, else FALSE.
+ */
+static gboolean
+gmpd_send_to_client (const char* msg, void* write_to_client_data)
+{
+  gvm_connection_t *client_connection;
+  size_t length;
+  int ret;
 
-      if (length > strlen (msg))
-        break;
+  assert (to_client_end <= TO_CLIENT_BUFFER_SIZE);
+  assert (msg);
 
-      /* length can be 0 if write_to_client returns -2. */
+  length = strlen (msg);
+  if (length == 0)
+    return FALSE;
 
-      if (length > 0)
+  if (client_compressing)
+    {
+      g_debug ("-> client (compressed): %s", msg);
+      if (compress_to_client (msg, length, Z_NO_FLUSH,
+                              (gvm_connection_t *) write_to_client_data))
         {
-          memmove (to_client + to_client_end, msg, length);
-          g_debug ("-> client: %.*s", (int) length, msg);
-          to_client_end += length;
-          msg += length;
+          g_debug ("   %s: client write of %zu bytes failed", __func__,
+                   length);
+          return TRUE;
         }
+      return FALSE;
     }
 
-  if (strlen (msg))
+  if (length <= ((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end)
     {
-      assert (strlen (msg)
-              <= (((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end));
-      memmove (to_client + to_client_end, msg, strlen (msg));
+      /* Queue, so that small messages go out together. */
+      memcpy (to_client + to_client_end, msg, length);
       g_debug ("-> client: %s", msg);
-      to_client_end += strlen (msg);
+      to_client_end += length;
+      return FALSE;
+    }
+
+  g_debug ("-> client: %s", msg);
+  client_connection = (gvm_connection_t *) write_to_client_data;
+  if (client_connection->tls)
+    ret = write_direct_to_client_tls (client_connection, msg, length);
+  else
+    ret = write_direct_to_client_unix (client_connection->socket, msg,
+                                       length);
+  if (ret)
+    {
+      g_debug ("   %s: client write of %zu bytes failed", __func__, length);
+      return TRUE;
     }
 
   return FALSE;
@@ -460,10 +750,23 @@ serve_gmp (gvm_connection_t *client_connection, const gchar *database,
 
   g_debug ("   Serving GMP");
 
+  /* Start with empty buffers, in case the process served a client before. */
+  from_client_start = 0;
+  from_client_end = 0;
+  to_client_start = 0;
+  to_client_end = 0;
+  if (client_compressing)
+    {
+      deflateEnd (&client_compressor);
+      client_compressing = 0;
+    }
+
   /* Initialise the XML parser and the manage library. */
   init_gmp_process (database,
                     (int (*) (const char*, void*)) gmpd_send_to_client,
                     (void*) client_connection,
+                    gmpd_compress_client,
+                    gmpd_flush_client,
                     disable);
 
   /** @todo Confirm and clarify complications, especially last one. */
@@ -506,6 +809,8 @@ serve_gmp (gvm_connection_t *client_connection, const gchar *database,
           goto client_free;
         }
 
+      manage_process_tick ();
+
       /* Setup for select. */
 
       /** @todo nfds must only include a socket if it's in >= one set. */
@@ -587,7 +892,10 @@ serve_gmp (gvm_connection_t *client_connection, const gchar *database,
             {
               if (g_strstr_len (from_client + initial_start,
                                 from_client_end - initial_start,
-                                "<password>"))
+                                "<password>")
+                  || g_strstr_len (from_client + initial_start,
+                                   from_client_end - initial_start,
+                                   "<token>"))
                 g_debug ("<= client  Input may contain password, suppressed");
               else
                 g_debug ("<= client  \"%.*s\"",
@@ -637,6 +945,8 @@ serve_gmp (gvm_connection_t *client_connection, const gchar *database,
     } /* while (1) */
 
 client_free:
+  gmp_abort_commands ();
+  gmp_command_stats_flush ();
   gvm_connection_free (client_connection);
   return rc;
 }
@@ -75,6 +75,7 @@
 #include <fcntl.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <gnutls/crypto.h>
 #include <gnutls/gnutls.h>
 #include <grp.h>
 #include <netdb.h>
@@ -85,6 +86,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -185,6 +187,38 @@
  */
 static int client_watch_interval = DEFAULT_CLIENT_WATCH_INTERVAL;
 
+/**
+ * @brief Maximum number of pre-forked client workers.
+ */
+#define MAX_CLIENT_WORKERS 256
+
+/**
+ * @brief Number of clients a worker serves before it is replaced.
+ *
+ * This bounds any state a client leaves behind in a reused process.
+ */
+#define CLIENT_WORKER_MAX_CLIENTS 1000
+
+/**
+ * @brief Seconds that a TLS session ticket key is used before it is replaced.
+ */
+#define SESSION_TICKET_KEY_PERIOD 3600
+
+/**
+ * @brief Size of a TLS session ticket key, as GnuTLS generates them.
+ */
+#define SESSION_TICKET_KEY_SIZE 64
+
+/**
+ * @brief Number of pre-forked workers serving clients, 0 to fork per client.
+ */
+static int client_workers = 0;
+
+/**
+ * @brief PIDs of the client workers, 0 for a free slot.
+ */
+static volatile pid_t client_worker_pids[MAX_CLIENT_WORKERS];
+
 /**
  * @brief The socket accepting GMP connections from clients.
  */
@@ -217,6 +251,26 @@ static gnutls_session_t client_session;
  */
 static gnutls_certificate_credentials_t client_credentials;
 
+/**
+ * @brief Keys of TLS session tickets, shared by all processes.
+ *
+ * The parent writes a new key to the slot that is not current, and then
+ * switches current, so that a process that reads the current key while
+ * the parent rotates still gets a whole key.  The old key stays in its
+ * slot until the next rotation overwrites it.
+ */
+typedef struct
+{
+  gint current;             ///< Slot of the current key.
+  time_t period;            ///< Period of current key.
+  unsigned char keys[2][SESSION_TICKET_KEY_SIZE]; ///< Key slots.
+} session_ticket_keys_t;
+
+/**
+ * @brief Session ticket keys, in memory shared with the children.
+ */
+static session_ticket_keys_t *session_ticket_keys = NULL;
+
 /**
  * @brief Location of the manage database.
  */
@@ -299,6 +353,95 @@ set_gnutls_priority (gnutls_session_t *session, const char *priority)
     g_warning ("Invalid GnuTLS priority: %s", errp);
 }
 
+/**
+ * @brief Replace the session ticket key if its period is over.
+ *
+ * Each key is fresh random data, so a leaked key reveals nothing about the
+ * keys of other periods.  Only the parent rotates, and the children take
+ * the new key from the shared memory.
+ */
+static void
+rotate_session_ticket_key ()
+{
+  time_t period;
+  int next;
+
+  if (session_ticket_keys == NULL || is_parent == 0)
+    return;
+
+  period = time (NULL) / SESSION_TICKET_KEY_PERIOD;
+  if (session_ticket_keys->period >= period)
+    return;
+
+  next = g_atomic_int_get (&session_ticket_keys->current) ? 0 : 1;
+  if (gnutls_rnd (GNUTLS_RND_KEY,
+                  session_ticket_keys->keys[next],
+                  SESSION_TICKET_KEY_SIZE))
+    {
+      g_warning ("%s: failed to generate session ticket key", __func__);
+      return;
+    }
+  session_ticket_keys->period = period;
+  g_atomic_int_set (&session_ticket_keys->current, next);
+}
+
+/**
+ * @brief Enable TLS session tickets for a client session.
+ *
+ * Lets clients resume an earlier session on a new connection, instead of
+ * doing a full handshake.  The first call sets up the keys in shared
+ * memory, and must happen before forking so that all processes share
+ * them.  The parent replaces the key every SESSION_TICKET_KEY_PERIOD
+ * seconds, so this must be called again before serving each client.
+ *
+ * @param[in]   session     Session.
+ */
+static void
+enable_session_tickets (gnutls_session_t *session)
+{
+  unsigned char key[SESSION_TICKET_KEY_SIZE];
+  gnutls_datum_t datum;
+
+  if (session_ticket_keys == NULL)
+    {
+      void *shared;
+
+      shared = mmap (NULL, sizeof (session_ticket_keys_t),
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                     -1, 0);
+      if (shared == MAP_FAILED)
+        {
+          g_warning ("%s: mmap failed: %s", __func__, strerror (errno));
+          return;
+        }
+      session_ticket_keys = shared;
+      session_ticket_keys->current = 0;
+      if (gnutls_rnd (GNUTLS_RND_KEY,
+                      session_ticket_keys->keys[0],
+                      SESSION_TICKET_KEY_SIZE))
+        {
+          g_warning ("%s: failed to generate session ticket key", __func__);
+          munmap (shared, sizeof (session_ticket_keys_t));
+          session_ticket_keys = NULL;
+          return;
+        }
+      session_ticket_keys->period = time (NULL) / SESSION_TICKET_KEY_PERIOD;
+    }
+  else
+    rotate_session_ticket_key ();
+
+  /* GnuTLS copies the key into the session. */
+  memcpy (key,
+          session_ticket_keys->keys
+           [g_atomic_int_get (&session_ticket_keys->current)],
+          SESSION_TICKET_KEY_SIZE);
+  datum.data = key;
+  datum.size = SESSION_TICKET_KEY_SIZE;
+  if (gnutls_session_ticket_enable_server (*session, &datum))
+    g_warning ("%s: failed to enable session tickets", __func__);
+  gnutls_memset (key, 0, sizeof (key));
+}
+
 /**
  * @brief Lock gvm-helping for an option.
  *
@@ -601,11 +744,14 @@ accept_and_maybe_fork (int server_socket, sigset_t *sigmask_current)
             }
           /* Reopen the database (required after fork). */
           cleanup_manage_process (FALSE);
+          manage_process_register ("gmp", 0, 0);
           memset (&client_connection, 0, sizeof (client_connection));
           client_connection.tls = use_tls;
           client_connection.socket = client_socket;
           client_connection.session = client_session;
           client_connection.credentials = client_credentials;
+          if (use_tls)
+            enable_session_tickets (&client_session);
           ret = serve_client (server_socket, &client_connection);
           exit (ret);
         }
@@ -623,6 +769,247 @@ accept_and_maybe_fork (int server_socket, sigset_t *sigmask_current)
     }
 }
 
+
+/* Client worker pool. */
+
+/**
+ * @brief Create a new TLS session for serving a client.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+renew_client_session ()
+{
+  if (gvm_server_new (GNUTLS_SERVER,
+                      CACERT,
+                      SCANNERCERT,
+                      SCANNERKEY,
+                      &client_session,
+                      &client_credentials))
+    {
+      g_critical ("%s: client server initialisation failed",
+                  __func__);
+      return -1;
+    }
+  set_gnutls_priority (&client_session, priorities_option);
+  enable_session_tickets (&client_session);
+  if (dh_params_option
+      && set_gnutls_dhparams (client_credentials, dh_params_option))
+    g_warning ("Couldn't set DH parameters from %s", dh_params_option);
+  return 0;
+}
+
+/**
+ * @brief Accept a client connection in a client worker.
+ *
+ * @param[in]  server_socket  Manager socket.
+ *
+ * @return Client socket, or -1 if another worker took the connection.
+ */
+static int
+client_worker_accept (int server_socket)
+{
+  int client_socket;
+  struct sockaddr_storage addr;
+  socklen_t addrlen = sizeof (addr);
+
+  while ((client_socket = accept (server_socket, (struct sockaddr *) &addr,
+                                  &addrlen))
+         == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        /* Another worker took the connection, return to select. */
+        return -1;
+      g_critical ("%s: failed to accept client connection: %s",
+                  __func__,
+                  strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  sockaddr_as_str (&addr, client_address);
+
+  /* The socket must have O_NONBLOCK set, in case an "asynchronous
+   * network error" removes the data between `select' and `read'. */
+  if (fcntl (client_socket, F_SETFL, O_NONBLOCK) == -1)
+    {
+      g_warning ("%s: failed to set client socket flag: %s",
+                 __func__,
+                 strerror (errno));
+      shutdown (client_socket, SHUT_RDWR);
+      close (client_socket);
+      return -1;
+    }
+
+  return client_socket;
+}
+
+/**
+ * @brief Serve clients one after another, in a client worker.
+ *
+ * The worker keeps its database connection and NVT cache from one client
+ * to the next, and resets everything else with \ref reset_manage_process.
+ * It exits after \ref CLIENT_WORKER_MAX_CLIENTS clients, or when a client
+ * ends with an error, so that the parent replaces it with a fresh process.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in the worker.
+ */
+static void
+serve_clients_in_worker (sigset_t *sigmask_current)
+{
+  struct sigaction action;
+  int served;
+
+  is_parent = 0;
+
+  /* Restore the sigmask that was blanked for pselect. */
+  pthread_sigmask (SIG_SETMASK, sigmask_current, NULL);
+
+  memset (&action, '\0', sizeof (action));
+  sigemptyset (&action.sa_mask);
+  action.sa_handler = SIG_DFL;
+  if (sigaction (SIGCHLD, &action, NULL) == -1)
+    {
+      g_critical ("%s: failed to set worker SIGCHLD handler: %s",
+                  __func__,
+                  strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  /* Reopen the database (required after fork). */
+  cleanup_manage_process (FALSE);
+
+  served = 0;
+  while (served < CLIENT_WORKER_MAX_CLIENTS)
+    {
+      int ret, nfds, server_socket, client_socket;
+      fd_set readfds;
+      struct timeval timeout;
+      gvm_connection_t client_connection;
+
+      if (termination_signal)
+        exit (EXIT_SUCCESS);
+
+      proctitle_set ("gvmd: Waiting for client");
+
+      FD_ZERO (&readfds);
+      FD_SET (manager_socket, &readfds);
+      if (manager_socket_2 > -1)
+        FD_SET (manager_socket_2, &readfds);
+      if (manager_socket >= manager_socket_2)
+        nfds = manager_socket + 1;
+      else
+        nfds = manager_socket_2 + 1;
+
+      /* Time out to check termination_signal now and then. */
+      timeout.tv_sec = SCHEDULE_PERIOD;
+      timeout.tv_usec = 0;
+      ret = select (nfds, &readfds, NULL, NULL, &timeout);
+      if (ret == -1)
+        {
+          if (errno == EINTR)
+            continue;
+          g_critical ("%s: select failed: %s",
+                      __func__,
+                      strerror (errno));
+          exit (EXIT_FAILURE);
+        }
+      if (ret == 0)
+        continue;
+
+      if (FD_ISSET (manager_socket, &readfds))
+        server_socket = manager_socket;
+      else
+        server_socket = manager_socket_2;
+
+      client_socket = client_worker_accept (server_socket);
+      if (client_socket == -1)
+        continue;
+
+      /* The previous client freed the TLS session and credentials. */
+      if (use_tls && served && renew_client_session ())
+        {
+          shutdown (client_socket, SHUT_RDWR);
+          close (client_socket);
+          exit (EXIT_FAILURE);
+        }
+      else if (use_tls && served == 0)
+        enable_session_tickets (&client_session);
+
+      proctitle_set ("gvmd: Serving client");
+      manage_process_register ("gmp", 0, 0);
+
+      memset (&client_connection, 0, sizeof (client_connection));
+      client_connection.tls = use_tls;
+      client_connection.socket = client_socket;
+      client_connection.session = client_session;
+      client_connection.credentials = client_credentials;
+      ret = serve_client (server_socket, &client_connection);
+      served++;
+
+      reset_manage_process ();
+      if (ret)
+        exit (ret);
+    }
+
+  exit (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Start client workers for any free slots in the pool.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in the workers.
+ */
+static void
+start_client_workers (sigset_t *sigmask_current)
+{
+  int index;
+
+  for (index = 0; index < client_workers; index++)
+    {
+      pid_t pid;
+
+      if (client_worker_pids[index])
+        continue;
+
+      pid = fork ();
+      switch (pid)
+        {
+          case 0:
+            /* Child. */
+            serve_clients_in_worker (sigmask_current);
+            /* Not reached. */
+            exit (EXIT_FAILURE);
+          case -1:
+            /* Parent when error.  Try again on the next round. */
+            g_warning ("%s: failed to fork client worker: %s",
+                       __func__,
+                       strerror (errno));
+            return;
+          default:
+            /* Parent. */
+            g_debug ("%s: started client worker %i", __func__, pid);
+            client_worker_pids[index] = pid;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Stop all client workers.
+ */
+static void
+stop_client_workers ()
+{
+  int index;
+
+  for (index = 0; index < client_workers; index++)
+    if (client_worker_pids[index])
+      kill (client_worker_pids[index], SIGTERM);
+}
+
+
+
 
 /* Connection forker for scheduler. */
 
@@ -730,6 +1117,7 @@ fork_connection_internal (gvm_connection_t *client_connection,
         auth_uuid = g_strdup (uuid);
 
         init_gmpd_process (database, disabled_commands);
+        manage_process_register ("gmp_internal", 0, 0);
 
         /* Make any further authentications to this process succeed.  This
          * enables the scheduler to login as the owner of the scheduled
@@ -755,6 +1143,7 @@ fork_connection_internal (gvm_connection_t *client_connection,
                 exit (EXIT_FAILURE);
               }
             set_gnutls_priority (&client_session, priorities_option);
+            enable_session_tickets (&client_session);
             if (dh_params_option
                 && set_gnutls_dhparams (client_credentials, dh_params_option))
               g_warning ("Couldn't set DH parameters from %s", dh_params_option);
@@ -879,6 +1268,8 @@ cleanup ()
 {
   g_debug ("   Cleaning up");
   /** @todo These should happen via gmp, maybe with "cleanup_gmp ();". */
+  if (is_parent == 1)
+    stop_client_workers ();
   cleanup_manage_process (TRUE);
   g_strfreev (disabled_commands);
   if (manager_socket > -1) close (manager_socket);
@@ -1052,9 +1443,18 @@ handle_sigchld (/* unused */ int given_signal, siginfo_t *info, void *ucontext)
 {
   int status, pid;
   while ((pid = waitpid (-1, &status, WNOHANG)) > 0)
-    if (update_in_progress == pid)
-      /* This was the NVT update child, so allow updates again. */
-      update_in_progress = 0;
+    {
+      int index;
+
+      if (update_in_progress == pid)
+        /* This was the NVT update child, so allow updates again. */
+        update_in_progress = 0;
+
+      for (index = 0; index < client_workers; index++)
+        if (client_worker_pids[index] == pid)
+          /* Free the slot, so that the main loop starts a new worker. */
+          client_worker_pids[index] = 0;
+    }
 }
 
 
@@ -1081,6 +1481,7 @@ static int
 update_nvt_cache_osp (const gchar *update_socket)
 {
   proctitle_set ("gvmd: OSP: Updating NVT cache");
+  manage_process_register ("nvt_cache", 0, 0);
 
   return manage_update_nvts_osp (update_socket);
 }
@@ -1207,6 +1608,46 @@ fork_update_nvt_cache ()
     }
 }
 
+/**
+ * @brief Check whether the scheduler must run.
+ *
+ * @param[in]  last_schedule_time  Time the scheduler last ran.
+ *
+ * @return 1 if the scheduler must run, else 0.
+ */
+static int
+schedule_due (time_t last_schedule_time)
+{
+  time_t now;
+
+  now = time (NULL);
+  return ((now - last_schedule_time) >= SCHEDULE_PERIOD)
+         || (now >= manage_schedule_next_due ());
+}
+
+/**
+ * @brief Get the number of seconds to wait before the scheduler must run.
+ *
+ * @param[in]  last_schedule_time  Time the scheduler last ran.
+ *
+ * @return Seconds to wait, at least 1.
+ */
+static time_t
+schedule_wait (time_t last_schedule_time)
+{
+  time_t now, wait;
+
+  now = time (NULL);
+  wait = last_schedule_time + SCHEDULE_PERIOD - now;
+  if (manage_schedule_next_due () - now < wait)
+    wait = manage_schedule_next_due () - now;
+  if (wait > SCHEDULE_PERIOD)
+    wait = SCHEDULE_PERIOD;
+  if (wait < 1)
+    wait = 1;
+  return wait;
+}
+
 /**
  * @brief Serve incoming connections, scheduling periodically.
  *
@@ -1214,6 +1655,8 @@ fork_update_nvt_cache ()
  * `accept_and_maybe_fork'.
  *
  * Periodically, call the manage scheduler to start and stop scheduled tasks.
+ * The scheduler is also called as soon as the next scheduled action is due,
+ * and when a change to the task schedules arrives on the schedule socket.
  */
 static void
 serve_and_schedule ()
@@ -1238,22 +1681,39 @@ serve_and_schedule ()
   sigmask_normal = &sigmask_current;
   while (1)
     {
-      int ret, nfds;
+      int ret, nfds, schedule_socket;
       fd_set readfds, exceptfds;
       struct timespec timeout;
 
       FD_ZERO (&readfds);
-      FD_SET (manager_socket, &readfds);
-      if (manager_socket_2 > -1)
-        FD_SET (manager_socket_2, &readfds);
       FD_ZERO (&exceptfds);
-      FD_SET (manager_socket, &exceptfds);
-      if (manager_socket_2 > -1)
-        FD_SET (manager_socket_2, &exceptfds);
-      if (manager_socket >= manager_socket_2)
-        nfds = manager_socket + 1;
+      if (client_workers)
+        {
+          /* The workers accept the connections. */
+          start_client_workers (sigmask_normal);
+          nfds = 0;
+        }
       else
-        nfds = manager_socket_2 + 1;
+        {
+          FD_SET (manager_socket, &readfds);
+          if (manager_socket_2 > -1)
+            FD_SET (manager_socket_2, &readfds);
+          FD_SET (manager_socket, &exceptfds);
+          if (manager_socket_2 > -1)
+            FD_SET (manager_socket_2, &exceptfds);
+          if (manager_socket >= manager_socket_2)
+            nfds = manager_socket + 1;
+          else
+            nfds = manager_socket_2 + 1;
+        }
+
+      schedule_socket = scheduling_enabled ? manage_schedule_socket () : -1;
+      if (schedule_socket > -1)
+        {
+          FD_SET (schedule_socket, &readfds);
+          if (schedule_socket >= nfds)
+            nfds = schedule_socket + 1;
+        }
 
       if (termination_signal)
         {
@@ -1266,7 +1726,7 @@ serve_and_schedule ()
           raise (termination_signal);
         }
 
-      if ((time (NULL) - last_schedule_time) >= SCHEDULE_PERIOD)
+      if (schedule_due (last_schedule_time))
         switch (manage_schedule (fork_connection_for_scheduler,
                                  scheduling_enabled,
                                  sigmask_normal))
@@ -1288,7 +1748,9 @@ serve_and_schedule ()
           last_sync_time = time (NULL);
         }
 
-      timeout.tv_sec = SCHEDULE_PERIOD;
+      manage_process_tick ();
+
+      timeout.tv_sec = schedule_wait (last_schedule_time);
       timeout.tv_nsec = 0;
       ret = pselect (nfds, &readfds, NULL, &exceptfds, &timeout,
                      sigmask_normal);
@@ -1321,9 +1783,12 @@ serve_and_schedule ()
             accept_and_maybe_fork (manager_socket, sigmask_normal);
           if ((manager_socket_2 > -1) && FD_ISSET (manager_socket_2, &readfds))
             accept_and_maybe_fork (manager_socket_2, sigmask_normal);
+          if ((schedule_socket > -1) && FD_ISSET (schedule_socket, &readfds))
+            /* A task schedule changed. */
+            last_schedule_time = 0;
         }
 
-      if ((time (NULL) - last_schedule_time) >= SCHEDULE_PERIOD)
+      if (schedule_due (last_schedule_time))
         switch (manage_schedule (fork_connection_for_scheduler,
                                  scheduling_enabled, sigmask_normal))
           {
@@ -1344,6 +1809,9 @@ serve_and_schedule ()
           last_sync_time = time (NULL);
         }
 
+      /* Replace the session ticket key for all processes. */
+      rotate_session_ticket_key ();
+
       if (termination_signal)
         {
           g_debug ("Received %s signal",
@@ -1585,14 +2053,17 @@ gvmd (int argc, char** argv)
 
   static gboolean check_alerts = FALSE;
   static gboolean migrate_database = FALSE;
+  static gboolean migrate_progress = FALSE;
   static gboolean encrypt_all_credentials = FALSE;
   static gboolean decrypt_all_credentials = FALSE;
   static gboolean disable_password_policy = FALSE;
   static gboolean disable_scheduling = FALSE;
   static gboolean get_users = FALSE;
+  static gboolean get_gmp_stats = FALSE;
   static gboolean get_scanners = FALSE;
   static gboolean foreground = FALSE;
   static gboolean print_version = FALSE;
+  static gboolean osp_scan_supervisor = FALSE;
   static int max_ips_per_target = MANAGE_MAX_HOSTS;
   static int max_email_attachment_size = 0;
   static int max_email_include_size = 0;
@@ -1613,7 +2084,20 @@ gvmd (int argc, char** argv)
   static gchar *scanner_key_priv = NULL;
   static int schedule_timeout = SCHEDULE_TIMEOUT_DEFAULT;
   static int secinfo_commit_size = SECINFO_COMMIT_SIZE_DEFAULT;
+  static int secinfo_sync_workers = SECINFO_SYNC_WORKERS_DEFAULT;
+  static int alert_workers = ALERT_WORKERS_DEFAULT;
+  static int osp_connections = OSP_CONNECTIONS_DEFAULT;
+  static int auth_token_lifetime = AUTH_TOKEN_LIFETIME_DEFAULT;
   static int slave_commit_size = SLAVE_COMMIT_SIZE_DEFAULT;
+  static int slow_query_threshold = SLOW_QUERY_THRESHOLD_DEFAULT;
+  static gboolean slow_query_explain = FALSE;
+  static gchar *read_replica = NULL;
+  static gchar *command_timeouts = NULL;
+  static gchar *cluster_node = NULL;
+  static int read_replica_max_lag = READ_REPLICA_MAX_LAG_DEFAULT;
+  static int count_cache_rebuild_rate = COUNT_CACHE_REBUILD_RATE_DEFAULT;
+  static int report_cache_size = REPORT_CACHE_SIZE_DEFAULT;
+  static int report_import_batch_size = REPORT_IMPORT_BATCH_SIZE_DEFAULT;
   static gchar *delete_scanner = NULL;
   static gchar *verify_scanner = NULL;
   static gchar *priorities = "NORMAL";
@@ -1642,6 +2126,20 @@ gvmd (int argc, char** argv)
   GOptionContext *option_context;
   static GOptionEntry option_entries[]
     = {
+        { "alert-workers", '\0', 0, G_OPTION_ARG_INT,
+          &alert_workers,
+          "Queue triggered alerts and run them in up to <number> background"
+          " processes, with retries. 0 to run alerts in the process that"
+          " produced the event. Defaults to "
+          G_STRINGIFY (ALERT_WORKERS_DEFAULT) ".",
+          "<number>" },
+        { "auth-token-lifetime", '\0', 0, G_OPTION_ARG_INT,
+          &auth_token_lifetime,
+          "Issue authentication tokens valid for <seconds> on successful"
+          " authentication, which clients can use instead of the password."
+          " 0 to issue no tokens. Defaults to "
+          G_STRINGIFY (AUTH_TOKEN_LIFETIME_DEFAULT) ".",
+          "<seconds>" },
         { "check-alerts", '\0', 0, G_OPTION_ARG_NONE,
           &check_alerts,
           "Check SecInfo alerts.",
@@ -1652,6 +2150,28 @@ gvmd (int argc, char** argv)
           " 0 to disable. Defaults to "
           G_STRINGIFY (DEFAULT_CLIENT_WATCH_INTERVAL) " seconds.",
           "<number>" },
+        { "client-workers", '\0', 0, G_OPTION_ARG_INT,
+          &client_workers,
+          "Serve clients with <number> pre-forked processes that are reused"
+          " between clients. 0 to fork a process per client. Defaults to 0.",
+          "<number>" },
+        { "cluster-node", '\0', 0, G_OPTION_ARG_STRING,
+          &cluster_node,
+          "Run as cluster node <name>, sharing the database with other"
+          " nodes. Implies --osp-scan-supervisor.",
+          "<name>" },
+        { "command-timeouts", '\0', 0, G_OPTION_ARG_STRING,
+          &command_timeouts,
+          "Give up on GMP commands after a time budget, with a status 503"
+          " response. <list> is a comma separated list of COMMAND=SECONDS,"
+          " where a COMMAND of * sets the budget of all other commands.",
+          "<list>" },
+        { "count-cache-rebuild-rate", '\0', 0, G_OPTION_ARG_INT,
+          &count_cache_rebuild_rate,
+          "Rebuild at most <number> report count caches per second in the"
+          " background, 0 for unlimited. Defaults to "
+          G_STRINGIFY (COUNT_CACHE_REBUILD_RATE_DEFAULT) ".",
+          "<number>" },
         { "create-scanner", '\0', 0, G_OPTION_ARG_STRING,
           &create_scanner,
           "Create global scanner <scanner> and exit.",
@@ -1705,6 +2225,11 @@ gvmd (int argc, char** argv)
           &foreground,
           "Run in foreground.",
           NULL },
+        { "get-gmp-stats", '\0', 0, G_OPTION_ARG_NONE,
+          &get_gmp_stats,
+          "Print GMP command, lock wait and process statistics in"
+          " Prometheus text format and exit.",
+          NULL },
         { "get-scanners", '\0', 0, G_OPTION_ARG_NONE,
           &get_scanners,
           "List scanners and exit.",
@@ -1777,11 +2302,23 @@ gvmd (int argc, char** argv)
         { "optimize", '\0', 0, G_OPTION_ARG_STRING,
           &optimize,
           "Run an optimization: vacuum, analyze, cleanup-config-prefs,"
-          " cleanup-port-names, cleanup-report-formats, cleanup-result-nvts"
+          " cleanup-port-names, cleanup-report-formats,"
+          " cleanup-result-descriptions, cleanup-result-nvts,"
           " cleanup-result-severities, cleanup-schedule-times,"
-          " migrate-relay-sensors, rebuild-report-cache or"
-          " update-report-cache.",
+          " migrate-relay-sensors, partition-results, rebuild-report-cache"
+          " or update-report-cache.",
           "<name>" },
+        { "osp-connections", '\0', 0, G_OPTION_ARG_INT,
+          &osp_connections,
+          "Open at most <number> connections to each OSP scanner at a time,"
+          " across all gvmd processes. 0 for no limit. Defaults to "
+          G_STRINGIFY (OSP_CONNECTIONS_DEFAULT) ".",
+          "<number>" },
+        { "osp-scan-supervisor", '\0', 0, G_OPTION_ARG_NONE,
+          &osp_scan_supervisor,
+          "Poll all running OSP scans from a single supervisor process,"
+          " instead of from a process per scan.",
+          NULL },
         { "osp-vt-update", '\0', 0, G_OPTION_ARG_STRING,
           &osp_vt_update,
           "Unix socket for OSP NVT update.  Defaults to the path of the"
@@ -1799,6 +2336,22 @@ gvmd (int argc, char** argv)
           &manager_port_string_2,
           "Use port number <number> for address 2.",
           "<number>" },
+        { "progress", '\0', 0, G_OPTION_ARG_NONE,
+          &migrate_progress,
+          "With --migrate, print the progress of the migration, including"
+          " queued background migration steps.",
+          NULL },
+        { "read-replica", '\0', 0, G_OPTION_ARG_STRING,
+          &read_replica,
+          "Send heavy read-only commands like GET_REPORTS to the PostgreSQL"
+          " replica at <conninfo>, a libpq connection string.",
+          "<conninfo>" },
+        { "read-replica-max-lag", '\0', 0, G_OPTION_ARG_INT,
+          &read_replica_max_lag,
+          "Use the read replica only while it is at most <seconds> behind"
+          " the primary. Defaults to "
+          G_STRINGIFY (READ_REPLICA_MAX_LAG_DEFAULT) ".",
+          "<seconds>" },
         { "relay-mapper", '\0', 0, G_OPTION_ARG_FILENAME,
           &relay_mapper,
           "Executable for mapping scanner hosts to relays."
@@ -1806,6 +2359,18 @@ gvmd (int argc, char** argv)
           " If the option is not given, $PATH is checked for"
           " gvm-relay-mapper.",
           "<file>" },
+        { "report-cache-size", '\0', 0, G_OPTION_ARG_INT,
+          &report_cache_size,
+          "Keep up to <number> MiB of rendered finished reports for reuse,"
+          " 0 to disable. Defaults to "
+          G_STRINGIFY (REPORT_CACHE_SIZE_DEFAULT) ".",
+          "<number>" },
+        { "report-import-batch-size", '\0', 0, G_OPTION_ARG_INT,
+          &report_import_batch_size,
+          "Write uploaded reports to the database every <number> results"
+          " while they are being received, 0 to wait for the whole report."
+          " Defaults to " G_STRINGIFY (REPORT_IMPORT_BATCH_SIZE_DEFAULT) ".",
+          "<number>" },
         { "role", '\0', 0, G_OPTION_ARG_STRING,
           &role,
           "Role for --create-user and --get-users.",
@@ -1860,11 +2425,27 @@ gvmd (int argc, char** argv)
           "During CERT and SCAP sync, commit updates to the database every"
           " <number> items, 0 for unlimited, default: "
           G_STRINGIFY (SECINFO_COMMIT_SIZE_DEFAULT), "<number>" },
+        { "secinfo-sync-workers", '\0', 0, G_OPTION_ARG_INT,
+          &secinfo_sync_workers,
+          "During SCAP sync, load CPEs with <number> parallel processes,"
+          " 0 to load them in the sync process, default: "
+          G_STRINGIFY (SECINFO_SYNC_WORKERS_DEFAULT), "<number>" },
         { "slave-commit-size", '\0', 0, G_OPTION_ARG_INT,
           &slave_commit_size,
           "During slave updates, commit after every <number> updated results"
           " and hosts, 0 for unlimited",
           "<number>"},
+        { "slow-query-explain", '\0', 0, G_OPTION_ARG_NONE,
+          &slow_query_explain,
+          "Log the plan of slow SQL queries, captured with EXPLAIN ANALYZE"
+          " on a second database connection.",
+          NULL },
+        { "slow-query-threshold", '\0', 0, G_OPTION_ARG_INT,
+          &slow_query_threshold,
+          "Log SQL statements that take longer than <milliseconds>,"
+          " 0 to disable. Defaults to "
+          G_STRINGIFY (SLOW_QUERY_THRESHOLD_DEFAULT) ".",
+          "<milliseconds>" },
         { "unix-socket", 'c', 0, G_OPTION_ARG_STRING,
           &manager_address_string_unix,
           "Listen on UNIX socket at <filename>.",
@@ -1931,6 +2512,17 @@ gvmd (int argc, char** argv)
       client_watch_interval = 0;
     }
 
+  /* Keep the number of client workers in range. */
+
+  if (client_workers < 0)
+    client_workers = 0;
+  else if (client_workers > MAX_CLIENT_WORKERS)
+    {
+      g_warning ("%s: Limiting client workers to %i",
+                 __func__, MAX_CLIENT_WORKERS);
+      client_workers = MAX_CLIENT_WORKERS;
+    }
+
   /* Set schedule_timeout */
 
   set_schedule_timeout (schedule_timeout);
@@ -1938,10 +2530,66 @@ gvmd (int argc, char** argv)
   /* Set slave commit size */
   set_slave_commit_size (slave_commit_size);
 
+  /* Set report count cache rebuild rate */
+
+  set_count_cache_rebuild_rate (count_cache_rebuild_rate);
+
+  /* Set the cluster node.  Nodes share the scans through the supervisor
+   * queue, so a node always uses the supervisor. */
+
+  set_cluster_node (cluster_node);
+  if (cluster_node)
+    osp_scan_supervisor = TRUE;
+
+  /* Set whether the OSP scan supervisor polls the scans */
+
+  set_osp_scan_supervisor (osp_scan_supervisor);
+
+  /* Set rendered report cache size */
+
+  set_report_cache_size (report_cache_size);
+
+  /* Set streamed report upload batch size */
+
+  set_report_import_batch_size (report_import_batch_size);
+
+  /* Set authentication token lifetime */
+
+  set_auth_token_lifetime (auth_token_lifetime);
+
+  /* Set slow SQL statement logging */
+
+  set_slow_query_log (slow_query_threshold, slow_query_explain);
+
+  /* Set up the read replica */
+
+  set_read_replica (read_replica, read_replica_max_lag);
+
+  /* Set the time budgets of GMP commands */
+
+  if (set_command_timeouts (command_timeouts))
+    {
+      g_critical ("%s: invalid --command-timeouts: %s", __func__,
+                  command_timeouts);
+      return EXIT_FAILURE;
+    }
+
   /* Set SecInfo update commit size */
 
   set_secinfo_commit_size (secinfo_commit_size);
 
+  /* Set number of SecInfo sync workers */
+
+  set_secinfo_sync_workers (secinfo_sync_workers);
+
+  /* Set number of alert queue workers */
+
+  set_alert_workers (alert_workers);
+
+  /* Set the limit of connections to each OSP scanner */
+
+  set_osp_connections (osp_connections);
+
   /* Check which type of socket to use. */
 
   if (manager_address_string_unix == NULL)
@@ -2140,7 +2788,7 @@ gvmd (int argc, char** argv)
 
       g_info ("   Migrating database.");
 
-      switch (manage_migrate (log_config, database))
+      switch (manage_migrate (log_config, database, migrate_progress))
         {
           case 0:
             g_info ("   Migration succeeded.");
@@ -2403,6 +3051,22 @@ gvmd (int argc, char** argv)
       return EXIT_SUCCESS;
     }
 
+  if (get_gmp_stats)
+    {
+      int ret;
+
+      proctitle_set ("gvmd: Getting GMP statistics");
+
+      if (option_lock (&lockfile_checking))
+        return EXIT_FAILURE;
+
+      ret = manage_get_gmp_stats (log_config, database);
+      log_config_free ();
+      if (ret)
+        return EXIT_FAILURE;
+      return EXIT_SUCCESS;
+    }
+
   if (get_scanners)
     {
       int ret;
@@ -2673,6 +3337,7 @@ gvmd (int argc, char** argv)
         }
       priorities_option = priorities;
       set_gnutls_priority (&client_session, priorities);
+      enable_session_tickets (&client_session);
       dh_params_option = dh_params;
       if (dh_params && set_gnutls_dhparams (client_credentials, dh_params))
         g_warning ("Couldn't set DH parameters from %s", dh_params);
@@ -2742,6 +3407,7 @@ gvmd (int argc, char** argv)
   /* Enter the main forever-loop. */
 
   proctitle_set ("gvmd: Waiting for incoming connections");
+  manage_process_register ("main", 0, 0);
   serve_and_schedule ();
 
   return EXIT_SUCCESS;
@@ -0,0 +1,763 @@
+/* Copyright (C) 2020 Greenbone Networks GmbH
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file  gvmd_bench.c
+ * @brief Benchmarks for the GVM manager.
+ *
+ * Seeds a database with synthetic container tasks, reports and results,
+ * timing create_report, optionally times parse_osp_report on a given OSP
+ * report, and replays a mix of GMP commands against a running Manager on
+ * its UNIX socket.
+ *
+ * Seeding writes to the database, so point --database at a database that
+ * is only used for benchmarks.
+ *
+ * The results are printed to stdout, one JSON object per line, so that
+ * runs can be compared between releases.
+ */
+
+#include "manage.h"
+#include "manage_sql.h"
+#include "sql.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <gvm/base/array.h>
+#include <gvm/gmp/gmp.h>
+#include <gvm/util/serverutils.h>
+#include <gvm/util/xmlutils.h>
+
+#undef G_LOG_DOMAIN
+/**
+ * @brief GLib log domain.
+ */
+#define G_LOG_DOMAIN "md  bench"
+
+/**
+ * @brief Microseconds to sleep between checks for a finished import.
+ */
+#define BENCH_WAIT_SLEEP 10000
+
+/**
+ * @brief GMP commands replayed when no command file is given.
+ */
+static const char *bench_default_commands[]
+  = { "<get_tasks/>",
+      "<get_reports filter=\"rows=10\"/>",
+      "<get_results filter=\"rows=100\"/>",
+      "<get_aggregates type=\"result\" group_column=\"severity\"/>",
+      NULL };
+
+/**
+ * @brief Timings of one benchmark.
+ */
+typedef struct
+{
+  gchar *name;      ///< Name of benchmark.
+  int count;        ///< Number of runs.
+  double total;     ///< Total seconds.
+  double min;       ///< Seconds of fastest run.
+  double max;       ///< Seconds of slowest run.
+} bench_stats_t;
+
+/**
+ * @brief Get the current monotonic time.
+ *
+ * @return Time in seconds.
+ */
+static double
+bench_now ()
+{
+  return g_get_monotonic_time () / (double) G_USEC_PER_SEC;
+}
+
+/**
+ * @brief Create benchmark timings.
+ *
+ * @param[in]  name  Name of benchmark.
+ *
+ * @return Freshly allocated timings.
+ */
+static bench_stats_t *
+bench_stats_new (const gchar *name)
+{
+  bench_stats_t *stats;
+
+  stats = g_malloc0 (sizeof (bench_stats_t));
+  stats->name = g_strdup (name);
+  return stats;
+}
+
+/**
+ * @brief Add a run to benchmark timings.
+ *
+ * @param[in]  stats    Timings.
+ * @param[in]  seconds  Duration of run.
+ */
+static void
+bench_stats_add (bench_stats_t *stats, double seconds)
+{
+  if (stats->count == 0 || seconds < stats->min)
+    stats->min = seconds;
+  if (stats->count == 0 || seconds > stats->max)
+    stats->max = seconds;
+  stats->total += seconds;
+  stats->count++;
+}
+
+/**
+ * @brief Print and free benchmark timings.
+ *
+ * @param[in]  stats  Timings.
+ * @param[in]  size   Size of each run, like the number of results.
+ */
+static void
+bench_stats_print (bench_stats_t *stats, int size)
+{
+  printf ("{\"benchmark\": \"%s\", \"size\": %i, \"runs\": %i,"
+          " \"total\": %.6f, \"min\": %.6f, \"mean\": %.6f, \"max\": %.6f}\n",
+          stats->name,
+          size,
+          stats->count,
+          stats->total,
+          stats->min,
+          stats->count ? stats->total / stats->count : 0,
+          stats->max);
+  g_free (stats->name);
+  g_free (stats);
+}
+
+/**
+ * @brief Free an array of create_report_result_t pointers.
+ *
+ * @param[in]  results  Results.
+ */
+static void
+bench_results_free (array_t *results)
+{
+  guint index;
+
+  for (index = 0; index < results->len; index++)
+    {
+      create_report_result_t *result;
+
+      result = g_ptr_array_index (results, index);
+      if (result == NULL)
+        continue;
+      g_free (result->description);
+      g_free (result->host);
+      g_free (result->hostname);
+      g_free (result->nvt_oid);
+      g_free (result->port);
+      g_free (result->qod);
+      g_free (result->qod_type);
+      g_free (result->severity);
+      g_free (result->threat);
+      g_free (result);
+    }
+  g_ptr_array_free (results, TRUE);
+}
+
+/**
+ * @brief Make a synthetic host, for create_report.
+ *
+ * @param[in]  index  Index of host.
+ *
+ * @return Freshly allocated IP.
+ */
+static gchar *
+bench_host (int index)
+{
+  return g_strdup_printf ("10.%i.%i.%i",
+                          (index >> 16) & 0xFF,
+                          (index >> 8) & 0xFF,
+                          (index & 0xFF) + 1);
+}
+
+/**
+ * @brief Make synthetic results, for create_report.
+ *
+ * @param[in]  rand         Random generator, seeded for reproducible results.
+ * @param[in]  count        Number of results.
+ * @param[in]  host_count   Number of hosts to spread the results over.
+ * @param[out] host_starts  Host start times.
+ * @param[out] host_ends    Host end times.
+ *
+ * @return Results.
+ */
+static array_t *
+bench_results_make (GRand *rand, int count, int host_count,
+                    array_t **host_starts, array_t **host_ends)
+{
+  static const char *ports[] = { "22/tcp", "80/tcp", "443/tcp",
+                                 "general/tcp", "161/udp" };
+  array_t *results;
+  int index;
+
+  results = make_array ();
+  for (index = 0; index < count; index++)
+    {
+      create_report_result_t *result;
+      double severity;
+
+      severity = g_rand_int_range (rand, 0, 101) / 10.0;
+
+      result = g_malloc0 (sizeof (create_report_result_t));
+      result->host = bench_host (index % host_count);
+      result->port = g_strdup (ports[g_rand_int_range (rand, 0, 5)]);
+      result->nvt_oid = g_strdup_printf ("1.3.6.1.4.1.25623.1.0.%i",
+                                         g_rand_int_range (rand, 100000,
+                                                           200000));
+      result->severity = g_strdup_printf ("%.1f", severity);
+      result->threat = g_strdup (severity >= 7 ? "High"
+                                  : (severity >= 4 ? "Medium"
+                                      : (severity > 0 ? "Low" : "Log")));
+      result->qod = g_strdup_printf ("%i", g_rand_int_range (rand, 30, 100));
+      result->qod_type = g_strdup ("remote_banner");
+      result->description = g_strdup_printf ("Synthetic benchmark result %i"
+                                             " with random value %u.",
+                                             index,
+                                             g_rand_int (rand));
+      array_add (results, result);
+    }
+  array_terminate (results);
+
+  *host_starts = make_array ();
+  *host_ends = make_array ();
+  for (index = 0; index < host_count; index++)
+    {
+      create_report_result_t *start, *end;
+
+      start = g_malloc0 (sizeof (create_report_result_t));
+      start->host = bench_host (index);
+      start->description = g_strdup ("2020-01-01T00:00:00Z");
+      array_add (*host_starts, start);
+
+      end = g_malloc0 (sizeof (create_report_result_t));
+      end->host = bench_host (index);
+      end->description = g_strdup ("2020-01-01T01:00:00Z");
+      array_add (*host_ends, end);
+    }
+  array_terminate (*host_starts);
+  array_terminate (*host_ends);
+
+  return results;
+}
+
+/**
+ * @brief Wait for create_report to finish importing a report.
+ *
+ * create_report imports the results in a separate process, so wait until
+ * that process has set the task to Done.
+ *
+ * @param[in]  task  Task of report.
+ */
+static void
+bench_wait_import (task_t task)
+{
+  while (sql_int ("SELECT run_status FROM tasks WHERE id = %llu;", task)
+         != TASK_STATUS_DONE)
+    gvm_usleep (BENCH_WAIT_SLEEP);
+}
+
+/**
+ * @brief Import one synthetic report into a container task.
+ *
+ * @param[in]  rand         Random generator.
+ * @param[in]  task         Container task.
+ * @param[in]  results      Number of results.
+ * @param[in]  hosts        Number of hosts.
+ * @param[out] report_id    Report UUID return.  NULL to skip.
+ *
+ * @return Seconds the import took, -1 on error.
+ */
+static double
+bench_import (GRand *rand, task_t task, int results, int hosts,
+              char **report_id)
+{
+  array_t *report_results, *host_starts, *host_ends, *details;
+  char *task_id, *id;
+  double start;
+  int ret;
+
+  report_results = bench_results_make (rand, results, hosts, &host_starts,
+                                       &host_ends);
+  details = make_array ();
+  array_terminate (details);
+  task_uuid (task, &task_id);
+
+  sql ("UPDATE tasks SET run_status = %i WHERE id = %llu;",
+       TASK_STATUS_NEW, task);
+
+  id = NULL;
+  start = bench_now ();
+  ret = create_report (report_results, task_id, "0", "2020-01-01T00:00:00Z",
+                       "2020-01-01T01:00:00Z", host_starts, host_ends,
+                       details, 0, 0, &id);
+  if (ret == 0)
+    bench_wait_import (task);
+  start = bench_now () - start;
+
+  free (task_id);
+  bench_results_free (report_results);
+  bench_results_free (host_starts);
+  bench_results_free (host_ends);
+  g_ptr_array_free (details, TRUE);
+
+  if (ret)
+    {
+      g_warning ("%s: create_report failed: %i", __func__, ret);
+      return -1;
+    }
+
+  if (report_id)
+    *report_id = id;
+  else
+    free (id);
+  return start;
+}
+
+/**
+ * @brief Seed the database with synthetic tasks, reports and results.
+ *
+ * @param[in]  rand     Random generator.
+ * @param[in]  tasks    Number of container tasks.
+ * @param[in]  reports  Number of reports per task.
+ * @param[in]  results  Number of results per report.
+ * @param[in]  hosts    Number of hosts per report.
+ * @param[out] last     Last task created.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+bench_seed (GRand *rand, int tasks, int reports, int results, int hosts,
+            task_t *last)
+{
+  bench_stats_t *stats;
+  int task_index;
+
+  stats = bench_stats_new ("create_report");
+  for (task_index = 0; task_index < tasks; task_index++)
+    {
+      task_t task;
+      int report_index;
+
+      task = make_task (g_strdup_printf ("Bench Task %i", task_index),
+                        g_strdup ("Created by gvmd-bench"),
+                        0,
+                        0);
+      make_task_complete (task);
+      *last = task;
+
+      for (report_index = 0; report_index < reports; report_index++)
+        {
+          double seconds;
+
+          seconds = bench_import (rand, task, results, hosts, NULL);
+          if (seconds < 0)
+            {
+              bench_stats_print (stats, results);
+              return -1;
+            }
+          bench_stats_add (stats, seconds);
+        }
+    }
+  bench_stats_print (stats, results);
+  return 0;
+}
+
+/**
+ * @brief Time parse_osp_report on an OSP report.
+ *
+ * Each run parses the report into a fresh, empty report.
+ *
+ * @param[in]  rand        Random generator.
+ * @param[in]  task        Container task to hold the reports.
+ * @param[in]  file        File containing OSP report XML.
+ * @param[in]  iterations  Number of runs.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+bench_osp (GRand *rand, task_t task, const gchar *file, int iterations)
+{
+  bench_stats_t *stats;
+  gchar *xml;
+  GError *error;
+  int index;
+
+  error = NULL;
+  if (g_file_get_contents (file, &xml, NULL, &error) == FALSE)
+    {
+      g_warning ("%s: failed to read %s: %s", __func__, file, error->message);
+      g_error_free (error);
+      return -1;
+    }
+
+  stats = bench_stats_new ("parse_osp_report");
+  for (index = 0; index < iterations; index++)
+    {
+      report_t report;
+      char *report_id;
+      double start;
+
+      if (bench_import (rand, task, 0, 1, &report_id) < 0)
+        break;
+      if (find_report_with_permission (report_id, &report, "get_reports")
+          || report == 0)
+        {
+          g_warning ("%s: failed to find report %s", __func__, report_id);
+          free (report_id);
+          break;
+        }
+      free (report_id);
+
+      start = bench_now ();
+      parse_osp_report (task, report, xml);
+      bench_stats_add (stats, bench_now () - start);
+    }
+  bench_stats_print (stats, strlen (xml));
+
+  g_free (xml);
+  return index == iterations ? 0 : -1;
+}
+
+/**
+ * @brief Get the name of the command element of a GMP command.
+ *
+ * @param[in]  command  GMP command XML.
+ *
+ * @return Freshly allocated name.
+ */
+static gchar *
+bench_command_name (const gchar *command)
+{
+  const gchar *start;
+
+  start = strchr (command, '<');
+  if (start == NULL)
+    return g_strdup ("unknown");
+  start++;
+  return g_strndup (start, strcspn (start, " \t\r\n/>"));
+}
+
+/**
+ * @brief Replay GMP commands against a running Manager.
+ *
+ * @param[in]  socket_name  Path of Manager UNIX socket.
+ * @param[in]  username     Username.
+ * @param[in]  password     Password.
+ * @param[in]  file         File with one GMP command per line, NULL for
+ *                          the default commands.
+ * @param[in]  iterations   Number of times to replay the commands.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+bench_gmp (const gchar *socket_name, const gchar *username,
+           const gchar *password, const gchar *file, int iterations)
+{
+  gvm_connection_t connection;
+  gmp_authenticate_info_opts_t auth_opts;
+  struct sockaddr_un address;
+  GPtrArray *commands, *stats;
+  gchar *contents;
+  guint index;
+  int iteration, ret;
+
+  commands = g_ptr_array_new_with_free_func (g_free);
+  contents = NULL;
+  if (file)
+    {
+      gchar **lines, **line;
+      GError *error;
+
+      error = NULL;
+      if (g_file_get_contents (file, &contents, NULL, &error) == FALSE)
+        {
+          g_warning ("%s: failed to read %s: %s",
+                     __func__, file, error->message);
+          g_error_free (error);
+          g_ptr_array_free (commands, TRUE);
+          return -1;
+        }
+      lines = g_strsplit (contents, "\n", 0);
+      for (line = lines; *line; line++)
+        {
+          g_strstrip (*line);
+          if (**line && **line != '#')
+            g_ptr_array_add (commands, g_strdup (*line));
+        }
+      g_strfreev (lines);
+      g_free (contents);
+    }
+  else
+    {
+      const char **command;
+
+      for (command = bench_default_commands; *command; command++)
+        g_ptr_array_add (commands, g_strdup (*command));
+    }
+
+  memset (&connection, 0, sizeof (connection));
+  connection.tls = 0;
+  connection.socket = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (connection.socket == -1)
+    {
+      g_warning ("%s: failed to create socket: %s",
+                 __func__, strerror (errno));
+      g_ptr_array_free (commands, TRUE);
+      return -1;
+    }
+
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  g_strlcpy (address.sun_path, socket_name, sizeof (address.sun_path));
+  if (connect (connection.socket, (struct sockaddr *) &address,
+               sizeof (address))
+      == -1)
+    {
+      g_warning ("%s: failed to connect to %s: %s",
+                 __func__, socket_name, strerror (errno));
+      close (connection.socket);
+      g_ptr_array_free (commands, TRUE);
+      return -1;
+    }
+
+  auth_opts = gmp_authenticate_info_opts_defaults;
+  auth_opts.username = username;
+  auth_opts.password = password;
+  if (gmp_authenticate_info_ext_c (&connection, auth_opts))
+    {
+      g_warning ("%s: failed to authenticate", __func__);
+      gvm_connection_close (&connection);
+      g_ptr_array_free (commands, TRUE);
+      return -1;
+    }
+
+  stats = g_ptr_array_new ();
+  for (index = 0; index < commands->len; index++)
+    {
+      gchar *element, *name;
+
+      element = bench_command_name (g_ptr_array_index (commands, index));
+      name = g_strdup_printf ("gmp %u %s", index + 1, element);
+      g_ptr_array_add (stats, bench_stats_new (name));
+      g_free (element);
+      g_free (name);
+    }
+
+  ret = 0;
+  for (iteration = 0; ret == 0 && iteration < iterations; iteration++)
+    for (index = 0; index < commands->len; index++)
+      {
+        entity_t entity;
+        const char *status;
+        double start;
+
+        start = bench_now ();
+        entity = NULL;
+        if (gvm_connection_sendf (&connection, "%s",
+                                  (gchar *) g_ptr_array_index (commands,
+                                                               index))
+            || read_entity_c (&connection, &entity))
+          {
+            g_warning ("%s: failed to run command %u", __func__, index + 1);
+            ret = -1;
+            break;
+          }
+        bench_stats_add (g_ptr_array_index (stats, index),
+                         bench_now () - start);
+
+        status = entity_attribute (entity, "status");
+        if (status == NULL || status[0] != '2')
+          {
+            g_warning ("%s: command %u failed: %s", __func__, index + 1,
+                       entity_attribute (entity, "status_text"));
+            ret = -1;
+          }
+        free_entity (entity);
+        if (ret)
+          break;
+      }
+
+  for (index = 0; index < stats->len; index++)
+    bench_stats_print (g_ptr_array_index (stats, index), 1);
+
+  g_ptr_array_free (stats, TRUE);
+  g_ptr_array_free (commands, TRUE);
+  gvm_connection_close (&connection);
+  return ret;
+}
+
+/**
+ * @brief Entry point to the benchmarks.
+ *
+ * @param[in]  argc  The number of arguments in argv.
+ * @param[in]  argv  The list of arguments to the program.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int
+main (int argc, char **argv)
+{
+  static gchar *database = NULL;
+  static gchar *username = NULL;
+  static gchar *password = NULL;
+  static gchar *socket_name = NULL;
+  static gchar *gmp_file = NULL;
+  static gchar *osp_file = NULL;
+  static gboolean gmp = FALSE;
+  static int tasks = 0;
+  static int reports = 1;
+  static int results = 1000;
+  static int hosts = 10;
+  static int iterations = 10;
+  static int seed = 0;
+  GOptionContext *option_context;
+  GError *error;
+  GRand *rand;
+  int ret;
+
+  static GOptionEntry option_entries[]
+    = {
+        { "database", 'd', 0, G_OPTION_ARG_STRING, &database,
+          "Use <name> as database for seeding.", "<name>" },
+        { "gmp", '\0', 0, G_OPTION_ARG_NONE, &gmp,
+          "Replay GMP commands against the running Manager.", NULL },
+        { "gmp-commands", '\0', 0, G_OPTION_ARG_FILENAME, &gmp_file,
+          "Replay the GMP commands in <file>, one per line.", "<file>" },
+        { "hosts", '\0', 0, G_OPTION_ARG_INT, &hosts,
+          "Spread the results of each seeded report over <number> hosts."
+          " Defaults to 10.", "<number>" },
+        { "iterations", '\0', 0, G_OPTION_ARG_INT, &iterations,
+          "Run the GMP and OSP benchmarks <number> times. Defaults to 10.",
+          "<number>" },
+        { "osp-report", '\0', 0, G_OPTION_ARG_FILENAME, &osp_file,
+          "Time parse_osp_report on the OSP report XML in <file>.",
+          "<file>" },
+        { "password", '\0', 0, G_OPTION_ARG_STRING, &password,
+          "Password of the user.", "<password>" },
+        { "reports", '\0', 0, G_OPTION_ARG_INT, &reports,
+          "Seed <number> reports per task. Defaults to 1.", "<number>" },
+        { "results", '\0', 0, G_OPTION_ARG_INT, &results,
+          "Seed <number> results per report. Defaults to 1000.",
+          "<number>" },
+        { "seed", '\0', 0, G_OPTION_ARG_INT, &seed,
+          "Seed for the synthetic data. Defaults to 0.", "<number>" },
+        { "tasks", '\0', 0, G_OPTION_ARG_INT, &tasks,
+          "Seed <number> container tasks. Defaults to 0.", "<number>" },
+        { "unix-socket", 'c', 0, G_OPTION_ARG_FILENAME, &socket_name,
+          "Connect to the Manager on UNIX socket <filename>.",
+          "<filename>" },
+        { "user", 'u', 0, G_OPTION_ARG_STRING, &username,
+          "User that owns the seeded data and runs the GMP commands.",
+          "<username>" },
+        { NULL }
+      };
+
+  option_context = g_option_context_new ("- GVM manager benchmarks");
+  g_option_context_add_main_entries (option_context, option_entries, NULL);
+  error = NULL;
+  if (!g_option_context_parse (option_context, &argc, &argv, &error))
+    {
+      g_option_context_free (option_context);
+      g_critical ("%s: %s", __func__, error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+  g_option_context_free (option_context);
+
+  if (username == NULL || password == NULL)
+    {
+      g_critical ("%s: --user and --password are required", __func__);
+      return EXIT_FAILURE;
+    }
+
+  if (hosts < 1 || iterations < 1)
+    {
+      g_critical ("%s: --hosts and --iterations must be positive", __func__);
+      return EXIT_FAILURE;
+    }
+
+  ret = 0;
+  rand = g_rand_new_with_seed (seed);
+
+  if (tasks > 0 || osp_file)
+    {
+      task_t task;
+
+      if (manage_option_setup (NULL, database))
+        {
+          g_rand_free (rand);
+          return EXIT_FAILURE;
+        }
+
+      current_credentials.username = g_strdup (username);
+      current_credentials.password = g_strdup (password);
+      if (authenticate (&current_credentials))
+        {
+          g_critical ("%s: failed to authenticate %s", __func__, username);
+          manage_option_cleanup ();
+          g_rand_free (rand);
+          return EXIT_FAILURE;
+        }
+      manage_session_init (current_credentials.uuid);
+
+      task = 0;
+      if (tasks > 0)
+        ret = bench_seed (rand, tasks, reports, results, hosts, &task);
+      if (ret == 0 && osp_file)
+        {
+          if (task == 0)
+            {
+              task = make_task (g_strdup ("Bench OSP Task"),
+                                g_strdup ("Created by gvmd-bench"),
+                                0,
+                                0);
+              make_task_complete (task);
+            }
+          ret = bench_osp (rand, task, osp_file, iterations);
+        }
+
+      free_credentials (&current_credentials);
+      manage_option_cleanup ();
+    }
+
+  if (ret == 0 && (gmp || gmp_file))
+    {
+      gchar *default_socket;
+
+      default_socket = g_build_filename (GVM_RUN_DIR, "gvmd.sock", NULL);
+      ret = bench_gmp (socket_name ? socket_name : default_socket,
+                       username, password, gmp_file, iterations);
+      g_free (default_socket);
+    }
+
+  g_rand_free (rand);
+  return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -30,6 +30,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <sys/mman.h>
 
 #include <gvm/util/gpgmeutils.h>
 
@@ -94,8 +95,32 @@ struct lsc_crypt_ctx_s
   char *plaintext;             ///< Text to be encrypted.
   size_t plaintextlen;         ///< Length of text.
   struct namelist_s *namelist; ///< Info describing PLAINTEXT.
+  gboolean shared_encctx;      ///< Whether ENCCTX belongs to the session.
+  gboolean shared_plaintext;   ///< Whether PLAINTEXT belongs to the session.
 };
 
+/**
+ * @brief A plaintext cached by a decryption session.
+ */
+struct session_plaintext_s
+{
+  char *plaintext;             ///< Plaintext.
+  size_t plaintextlen;         ///< Length of plaintext.
+  gboolean locked;             ///< Whether PLAINTEXT is locked in memory.
+};
+
+/**
+ * @brief Context of the current decryption session, NULL if none.
+ *
+ * Contexts created during the session share its GPGME context.
+ */
+static lsc_crypt_ctx_t session_ctx = NULL;
+
+/**
+ * @brief Plaintexts decrypted during the session, keyed on ciphertext.
+ */
+static GHashTable *session_plaintexts = NULL;
+
 
 /* Simple helper functions  */
 
@@ -468,6 +493,66 @@ do_decrypt (lsc_crypt_ctx_t ctx, const char *cipherstring,
   return result;
 }
 
+/**
+ * @brief Free a plaintext cached by a decryption session.
+ *
+ * @param[in]  data  The plaintext.
+ */
+static void
+session_plaintext_free (gpointer data)
+{
+  struct session_plaintext_s *cached = data;
+
+  memset (cached->plaintext, 0, cached->plaintextlen);
+  if (cached->locked)
+    munlock (cached->plaintext, cached->plaintextlen);
+  g_free (cached->plaintext);
+  g_free (cached);
+}
+
+/**
+ * @brief Decrypt a ciphertext through the decryption session.
+ *
+ * The plaintext is copied to memory that is locked if possible, so that
+ * it is not swapped out while the session runs.
+ *
+ * @param[in]  ciphertext  The base64 encoded ciphertext.
+ *
+ * @return The plaintext, or NULL if there is no session or on error.  Valid
+ *         until the session ends.
+ */
+static struct session_plaintext_s *
+session_decrypt (const char *ciphertext)
+{
+  struct session_plaintext_s *cached;
+  char *plaintext;
+  size_t plaintextlen;
+
+  if (!session_ctx)
+    return NULL;
+
+  cached = g_hash_table_lookup (session_plaintexts, ciphertext);
+  if (cached)
+    return cached;
+
+  plaintext = do_decrypt (session_ctx, ciphertext, &plaintextlen);
+  if (!plaintext)
+    return NULL;
+
+  cached = g_malloc0 (sizeof *cached);
+  cached->plaintextlen = plaintextlen;
+  cached->plaintext = g_malloc (plaintextlen ? plaintextlen : 1);
+  cached->locked = (mlock (cached->plaintext, plaintextlen ?: 1) == 0);
+  if (!cached->locked)
+    g_debug ("%s: failed to lock plaintext in memory", G_STRFUNC);
+  memcpy (cached->plaintext, plaintext, plaintextlen);
+  memset (plaintext, 0, plaintextlen);
+  g_free (plaintext);
+
+  g_hash_table_insert (session_plaintexts, g_strdup (ciphertext), cached);
+  return cached;
+}
+
 
 
 /* API */
@@ -485,6 +570,13 @@ lsc_crypt_new ()
   lsc_crypt_ctx_t ctx;
 
   ctx = g_malloc0 (sizeof *ctx);
+  if (session_ctx)
+    {
+      g_free (path);
+      ctx->encctx = session_ctx->encctx;
+      ctx->shared_encctx = TRUE;
+      return ctx;
+    }
   ctx->encctx = gvm_init_gpgme_ctx_from_dir (path);
   g_free (path);
   if (!ctx->encctx)
@@ -507,7 +599,8 @@ lsc_crypt_release (lsc_crypt_ctx_t ctx)
   if (!ctx)
     return;
   lsc_crypt_flush (ctx);
-  if (ctx->encctx) /* Check required for gpgme < 1.3.1 */
+  if (ctx->encctx /* Check required for gpgme < 1.3.1 */
+      && !ctx->shared_encctx)
     gpgme_release (ctx->encctx);
   g_free (ctx);
 }
@@ -535,8 +628,10 @@ lsc_crypt_flush (lsc_crypt_ctx_t ctx)
       g_free (ctx->namelist);
       ctx->namelist = nl;
     }
-  g_free (ctx->plaintext);
+  if (!ctx->shared_plaintext)
+    g_free (ctx->plaintext);
   ctx->plaintext = NULL;
+  ctx->shared_plaintext = FALSE;
 }
 
 
@@ -656,11 +751,25 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
 
   if (!ctx->plaintext)
     {
+      struct session_plaintext_s *cached;
+
       if (!ciphertext)
         return NULL;
-      ctx->plaintext = do_decrypt (ctx, ciphertext, &ctx->plaintextlen);
-      if (!ctx->plaintext)
+      cached = session_decrypt (ciphertext);
+      if (cached)
+        {
+          ctx->plaintext = cached->plaintext;
+          ctx->plaintextlen = cached->plaintextlen;
+          ctx->shared_plaintext = TRUE;
+        }
+      else if (session_ctx)
         return NULL;
+      else
+        {
+          ctx->plaintext = do_decrypt (ctx, ciphertext, &ctx->plaintextlen);
+          if (!ctx->plaintext)
+            return NULL;
+        }
     }
 
   /* Try to return it from the cache.  */
@@ -806,3 +915,58 @@ lsc_crypt_get_private_key (lsc_crypt_ctx_t ctx, const char *ciphertext)
 {
   return lsc_crypt_decrypt (ctx, ciphertext, "private_key");
 }
+
+/**
+ * @brief Start a decryption session.
+ *
+ * Until \ref lsc_crypt_session_end, all contexts share one GPGME context,
+ * and each distinct ciphertext is decrypted only once.  This is meant for
+ * a scan launch, which decrypts the same few credentials many times.
+ */
+void
+lsc_crypt_session_start ()
+{
+  if (session_ctx)
+    return;
+  session_ctx = lsc_crypt_new ();
+  session_plaintexts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, session_plaintext_free);
+}
+
+/**
+ * @brief Decrypt a ciphertext into the decryption session.
+ *
+ * Used to decrypt all the credentials of a scan in one pass, before they
+ * are needed.
+ *
+ * @param[in]  ciphertext  The base64 encoded ciphertext.
+ *
+ * @return 0 success, -1 error or no session.
+ */
+int
+lsc_crypt_session_add (const char *ciphertext)
+{
+  if (!ciphertext || disable_encrypted_credentials)
+    return -1;
+  return session_decrypt (ciphertext) ? 0 : -1;
+}
+
+/**
+ * @brief End the decryption session.
+ *
+ * Wipes the cached plaintexts.  Values returned during the session by
+ * contexts that are still alive become invalid.
+ */
+void
+lsc_crypt_session_end ()
+{
+  lsc_crypt_ctx_t ctx;
+
+  if (!session_ctx)
+    return;
+  g_hash_table_destroy (session_plaintexts);
+  session_plaintexts = NULL;
+  ctx = session_ctx;
+  session_ctx = NULL;
+  lsc_crypt_release (ctx);
+}
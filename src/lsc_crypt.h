@@ -48,5 +48,9 @@ const char *lsc_crypt_decrypt (lsc_crypt_ctx_t, const char *, const char *);
 const char *lsc_crypt_get_password (lsc_crypt_ctx_t, const char *);
 const char *lsc_crypt_get_private_key (lsc_crypt_ctx_t, const char *);
 
+void lsc_crypt_session_start ();
+int lsc_crypt_session_add (const char *);
+void lsc_crypt_session_end ();
+
 
 #endif /* not _GVMD_LSC_CRYPT_H */
@@ -805,3 +805,265 @@ lsc_user_exe_recreate (const gchar *name, const gchar *password,
 
   return ret;
 }
+
+
+/* Package cache. */
+
+/**
+ * @brief Get the directory of the cached packages of a credential.
+ *
+ * @param[in]  credential_id  UUID of credential.
+ *
+ * @return Freshly allocated path.
+ */
+static gchar *
+lsc_user_package_dir (const gchar *credential_id)
+{
+  return g_build_filename (GVMD_STATE_DIR, "lsc_packages", credential_id,
+                           NULL);
+}
+
+/**
+ * @brief Get the path of a package in the cache.
+ *
+ * The file name is a hash of everything that goes into the package, so a
+ * package built from old key material or an old maintainer is never used.
+ *
+ * @param[in]  credential_id  UUID of credential, or NULL.
+ * @param[in]  format         Package format: "rpm", "deb" or "exe".
+ * @param[in]  name           User name.
+ * @param[in]  secret         Public key, or password for "exe".
+ * @param[in]  extra          Maintainer for "deb", else NULL.
+ *
+ * @return Freshly allocated path, or NULL if credential_id is NULL.
+ */
+static gchar *
+lsc_user_package_path (const gchar *credential_id, const gchar *format,
+                       const gchar *name, const gchar *secret,
+                       const gchar *extra)
+{
+  gchar *key_string, *key, *file_name, *dir, *path;
+
+  if (credential_id == NULL)
+    return NULL;
+
+  key_string = g_strdup_printf ("%s\n%s\n%s\n%s",
+                                format,
+                                name,
+                                secret,
+                                extra ? extra : "");
+  key = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key_string, -1);
+  g_free (key_string);
+
+  file_name = g_strdup_printf ("%s.%s", key, format);
+  g_free (key);
+
+  dir = lsc_user_package_dir (credential_id);
+  path = g_build_filename (dir, file_name, NULL);
+  g_free (dir);
+  g_free (file_name);
+  return path;
+}
+
+/**
+ * @brief Read a package from the cache.
+ *
+ * @param[in]   path          Path from lsc_user_package_path, or NULL.
+ * @param[out]  package       Package.
+ * @param[out]  package_size  Size of package, in bytes.
+ *
+ * @return 0 success, -1 not in cache.
+ */
+static int
+lsc_user_package_cache_get (const gchar *path, void **package,
+                            gsize *package_size)
+{
+  if (path == NULL
+      || g_file_get_contents (path, (gchar **) package, package_size, NULL)
+         == FALSE)
+    return -1;
+
+  g_debug ("%s: hit %s", __func__, path);
+  return 0;
+}
+
+/**
+ * @brief Write a package to the cache.
+ *
+ * @param[in]  path          Path from lsc_user_package_path, or NULL.
+ * @param[in]  package       Package.
+ * @param[in]  package_size  Size of package, in bytes.
+ */
+static void
+lsc_user_package_cache_put (const gchar *path, const void *package,
+                            gsize package_size)
+{
+  GError *error;
+  gchar *dir;
+
+  if (path == NULL)
+    return;
+
+  /* The packages give access to the target, so keep the cache private. */
+
+  dir = g_path_get_dirname (path);
+  if (g_mkdir_with_parents (dir, 0700))
+    {
+      g_warning ("%s: Failed to create %s", __func__, dir);
+      g_free (dir);
+      return;
+    }
+  g_free (dir);
+
+  error = NULL;
+  if (g_file_set_contents (path, package, package_size, &error) == FALSE)
+    {
+      g_warning ("%s: %s", __func__, error->message);
+      g_error_free (error);
+      return;
+    }
+  g_chmod (path, 0600);
+}
+
+/**
+ * @brief Get an RPM package, from the cache if possible.
+ *
+ * @param[in]   credential_id  UUID of credential, or NULL to skip the cache.
+ * @param[in]   name           User name.
+ * @param[in]   public_key     Public key.
+ * @param[out]  rpm            RPM package.
+ * @param[out]  rpm_size       Size of RPM package, in bytes.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+lsc_user_rpm_cached (const gchar *credential_id, const gchar *name,
+                     const char *public_key, void **rpm, gsize *rpm_size)
+{
+  gchar *path;
+  int ret;
+
+  path = lsc_user_package_path (credential_id, "rpm", name, public_key,
+                                NULL);
+  if (lsc_user_package_cache_get (path, rpm, rpm_size) == 0)
+    {
+      g_free (path);
+      return 0;
+    }
+
+  ret = lsc_user_rpm_recreate (name, public_key, rpm, rpm_size);
+  if (ret == 0)
+    lsc_user_package_cache_put (path, *rpm, *rpm_size);
+  g_free (path);
+  return ret;
+}
+
+/**
+ * @brief Get a DEB package, from the cache if possible.
+ *
+ * @param[in]   credential_id  UUID of credential, or NULL to skip the cache.
+ * @param[in]   name           User name.
+ * @param[in]   public_key     Public key.
+ * @param[in]   maintainer     The maintainer email address.
+ * @param[out]  deb            DEB package.
+ * @param[out]  deb_size       Size of DEB package, in bytes.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+lsc_user_deb_cached (const gchar *credential_id, const gchar *name,
+                     const char *public_key, const char *maintainer,
+                     void **deb, gsize *deb_size)
+{
+  gchar *path;
+  int ret;
+
+  path = lsc_user_package_path (credential_id, "deb", name, public_key,
+                                maintainer);
+  if (lsc_user_package_cache_get (path, deb, deb_size) == 0)
+    {
+      g_free (path);
+      return 0;
+    }
+
+  ret = lsc_user_deb_recreate (name, public_key, maintainer, deb, deb_size);
+  if (ret == 0)
+    lsc_user_package_cache_put (path, *deb, *deb_size);
+  g_free (path);
+  return ret;
+}
+
+/**
+ * @brief Get an NSIS package.
+ *
+ * The package contains the password in the clear, so it is always built
+ * again instead of being kept in the cache.
+ *
+ * @param[in]   credential_id  UUID of credential.
+ * @param[in]   name           User name.
+ * @param[in]   password       Password.
+ * @param[out]  exe            NSIS package.
+ * @param[out]  exe_size       Size of NSIS package, in bytes.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+lsc_user_exe_cached (const gchar *credential_id, const gchar *name,
+                     const gchar *password, void **exe, gsize *exe_size)
+{
+  gchar *path;
+
+  /* Remove any copy that an earlier version put in the cache. */
+  path = lsc_user_package_path (credential_id, "exe", name, password, NULL);
+  if (path)
+    g_unlink (path);
+  g_free (path);
+
+  return lsc_user_exe_recreate (name, password, exe, exe_size);
+}
+
+/**
+ * @brief Build the packages of a credential into the cache.
+ *
+ * @param[in]  credential_id  UUID of credential.
+ * @param[in]  name           User name.
+ * @param[in]  public_key     Public key for RPM and DEB packages, or NULL.
+ * @param[in]  maintainer     The maintainer email address for DEB packages.
+ */
+void
+lsc_user_packages_build (const gchar *credential_id, const gchar *name,
+                         const char *public_key, const char *maintainer)
+{
+  void *package;
+  gsize package_size;
+
+  if (public_key)
+    {
+      if (lsc_user_rpm_cached (credential_id, name, public_key,
+                               &package, &package_size) == 0)
+        g_free (package);
+      if (lsc_user_deb_cached (credential_id, name, public_key,
+                               maintainer ? maintainer : "",
+                               &package, &package_size) == 0)
+        g_free (package);
+    }
+}
+
+/**
+ * @brief Remove the cached packages of a credential.
+ *
+ * @param[in]  credential_id  UUID of credential.
+ */
+void
+lsc_user_packages_remove (const gchar *credential_id)
+{
+  gchar *dir;
+
+  if (credential_id == NULL)
+    return;
+
+  dir = lsc_user_package_dir (credential_id);
+  if (g_file_test (dir, G_FILE_TEST_IS_DIR))
+    gvm_file_remove_recurse (dir);
+  g_free (dir);
+}
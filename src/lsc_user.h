@@ -41,4 +41,23 @@ lsc_user_deb_recreate (const gchar *, const char *, const char *,
 int
 lsc_user_exe_recreate (const gchar *, const gchar *, void **, gsize *);
 
+int
+lsc_user_rpm_cached (const gchar *, const gchar *, const char *,
+                     void **, gsize *);
+
+int
+lsc_user_deb_cached (const gchar *, const gchar *, const char *,
+                     const char *, void **, gsize *);
+
+int
+lsc_user_exe_cached (const gchar *, const gchar *, const gchar *,
+                     void **, gsize *);
+
+void
+lsc_user_packages_build (const gchar *, const gchar *, const char *,
+                         const char *);
+
+void
+lsc_user_packages_remove (const gchar *);
+
 #endif /* not _GVMD_LSC_USER_H */
@@ -87,6 +87,15 @@
 #include <gvm/util/uuidutils.h>
 #include <gvm/gmp/gmp.h>
 
+#include <libexslt/exslt.h>
+#include <libxml/parser.h>
+#include <libxslt/imports.h>
+#include <libxslt/security.h>
+#include <libxslt/transform.h>
+#include <libxslt/variables.h>
+#include <libxslt/xsltInternals.h>
+#include <libxslt/xsltutils.h>
+
 #undef G_LOG_DOMAIN
 /**
  * @brief GLib log domain.
@@ -182,6 +191,11 @@ static int relay_migrate_sensors = 0;
  */
 static int schedule_timeout = SCHEDULE_TIMEOUT_DEFAULT;
 
+/**
+ * @brief Whether OSP scans are polled by the scan supervisor.
+ */
+static int osp_scan_supervisor = 0;
+
 
 /* Certificate and key management. */
 
@@ -640,7 +654,7 @@ xml_escape_text_truncated (const char *string, size_t max_len,
 
   orig_len = strlen (string);
   if (orig_len <= max_len)
-    escaped = g_markup_escape_text (string, -1);
+    escaped = xml_escape_text (string, -1);
   else
     {
       gchar *offset_next;
@@ -649,7 +663,7 @@ xml_escape_text_truncated (const char *string, size_t max_len,
       offset_next = g_utf8_find_next_char (string + max_len,
                                            string + orig_len);
       offset = offset_next - string;
-      escaped = g_markup_escape_text (string, offset);
+      escaped = xml_escape_text (string, offset);
     }
 
   truncate_text (escaped, max_len, TRUE, suffix);
@@ -763,6 +777,104 @@ check_available (const gchar *type, resource_t resource,
   return -1;
 }
 
+/**
+ * @brief Run a background worker in a child process.
+ *
+ * The child takes an exclusive lock on a lock file first, so that at most
+ * one such worker runs at a time.  If another process holds the lock the
+ * child simply exits.  Otherwise the child reopens the database (required
+ * after fork), sets its process title, registers itself, runs the worker
+ * and exits.
+ *
+ * @param[in]  sigmask_current    Sigmask to restore in child.
+ * @param[in]  lockfile_basename  Basename of lock file.
+ * @param[in]  title              Process title.
+ * @param[in]  process_type       Type of process, for the process registry.
+ * @param[in]  worker             Function that does the work.
+ */
+void
+fork_locked_worker (sigset_t *sigmask_current, const gchar *lockfile_basename,
+                    const gchar *title, const gchar *process_type,
+                    void (*worker) ())
+{
+  int pid, lockfile;
+  gchar *lockfile_name;
+
+  pid = fork ();
+  switch (pid)
+    {
+      case 0:
+        /* Child.  Carry on to run the worker. */
+
+        /* Restore the sigmask that was blanked for pselect in the parent. */
+        pthread_sigmask (SIG_SETMASK, sigmask_current, NULL);
+
+        /* Cleanup so that exit works. */
+
+        cleanup_manage_process (FALSE);
+
+        /* Open the lock file. */
+
+        lockfile_name = g_build_filename (g_get_tmp_dir (), lockfile_basename,
+                                          NULL);
+
+        lockfile = open (lockfile_name,
+                         O_RDWR | O_CREAT | O_APPEND,
+                         /* "-rw-r--r--" */
+                         S_IWUSR | S_IRUSR | S_IROTH | S_IRGRP);
+        if (lockfile == -1)
+          {
+            g_warning ("%s: failed to open lock file '%s': %s", __func__,
+                       lockfile_name, strerror (errno));
+            g_free (lockfile_name);
+            exit (EXIT_FAILURE);
+          }
+        g_free (lockfile_name);
+
+        if (flock (lockfile, LOCK_EX | LOCK_NB))  /* Exclusive, Non blocking. */
+          {
+            if (errno == EWOULDBLOCK)
+              g_debug ("%s: skipping %s, already running", __func__,
+                       process_type);
+            else
+              g_debug ("%s: flock: %s", __func__, strerror (errno));
+            exit (EXIT_SUCCESS);
+          }
+
+        /* Init. */
+
+        reinit_manage_process ();
+        manage_session_init (current_credentials.uuid);
+
+        break;
+
+      case -1:
+        /* Parent on error.  Try again next time. */
+        g_warning ("%s: fork failed", __func__);
+        return;
+
+      default:
+        /* Parent.  Continue. */
+        return;
+    }
+
+  proctitle_set (title);
+  manage_process_register (process_type, 0, 0);
+
+  worker ();
+
+  /* Closing the lock file releases the lock. */
+
+  if (close (lockfile))
+    {
+      g_warning ("%s: failed to close lock file: %s", __func__,
+                 strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  exit (EXIT_SUCCESS);
+}
+
 
 /* Severity related functions. */
 
@@ -3463,7 +3575,7 @@ delete_osp_scan (const char *report_id, const char *host, int port,
       return;
     }
   osp_delete_scan (connection, report_id);
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
 }
 
 /**
@@ -3505,7 +3617,7 @@ get_osp_scan_report (const char *scan_id, const char *host, int port,
       progress = -1;
     }
 
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   return progress;
 }
 
@@ -3544,13 +3656,146 @@ get_osp_scan_status (const char *scan_id, const char *host, int port,
     {
       g_warning ("OSP %s %s: %s", __func__, scan_id, error);
       g_free (error);
-      return status;
     }
 
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   return status;
 }
 
+/**
+ * @brief Get the status of the scan in the response to an OSP get_scans.
+ *
+ * Only looks in the start tag of the scan, so that a poll can take the
+ * status from the report instead of opening another connection for it.
+ *
+ * @param[in]   report_xml  Scan report.
+ *
+ * @return Status of the scan, OSP_SCAN_STATUS_ERROR if missing or unknown.
+ */
+static osp_scan_status_t
+osp_report_scan_status (const char *report_xml)
+{
+  const char *scan, *end, *status;
+
+  if (report_xml == NULL)
+    return OSP_SCAN_STATUS_ERROR;
+
+  scan = strstr (report_xml, "<scan ");
+  if (scan == NULL)
+    return OSP_SCAN_STATUS_ERROR;
+  end = strchr (scan, '>');
+  if (end == NULL)
+    return OSP_SCAN_STATUS_ERROR;
+
+  status = g_strstr_len (scan, end - scan, " status=\"");
+  if (status == NULL)
+    return OSP_SCAN_STATUS_ERROR;
+  status += strlen (" status=\"");
+
+  if (strncmp (status, "running\"", strlen ("running\"")) == 0)
+    return OSP_SCAN_STATUS_RUNNING;
+  if (strncmp (status, "finished\"", strlen ("finished\"")) == 0)
+    return OSP_SCAN_STATUS_FINISHED;
+  if (strncmp (status, "stopped\"", strlen ("stopped\"")) == 0)
+    return OSP_SCAN_STATUS_STOPPED;
+  if (strncmp (status, "init\"", strlen ("init\"")) == 0)
+    return OSP_SCAN_STATUS_INIT;
+  return OSP_SCAN_STATUS_ERROR;
+}
+
+/**
+ * @brief Number of seconds to wait between polls of an OSP scan.
+ */
+#define OSP_SCAN_POLL_PERIOD 5
+
+/**
+ * @brief Poll an ongoing OSP scan once.
+ *
+ * @param[in]      task      The task.
+ * @param[in]      report    The report.
+ * @param[in]      scan_id   The UUID of the scan on the scanner.
+ * @param[in]      host      Scanner host.
+ * @param[in]      port      Scanner port.
+ * @param[in]      ca_pub    CA Certificate.
+ * @param[in]      key_pub   Certificate.
+ * @param[in]      key_priv  Private key.
+ * @param[in,out]  started   Whether the task has been set to running.
+ *
+ * @return 1 if scan is still going, 0 if success, -1 if error, -2 if scan
+ *         was stopped.
+ */
+static int
+handle_osp_scan_poll (task_t task, report_t report, const char *scan_id,
+                      const char *host, int port, const char *ca_pub,
+                      const char *key_pub, const char *key_priv,
+                      gboolean *started)
+{
+  char *report_xml = NULL;
+  int run_status, progress;
+  osp_scan_status_t osp_scan_status;
+
+  run_status = task_run_status (task);
+  if (run_status == TASK_STATUS_STOPPED
+      || run_status == TASK_STATUS_STOP_REQUESTED)
+    return -2;
+
+  /* Get the results since the previous poll.  The scanner drops
+   * popped results, so each poll only carries new ones. */
+  progress = get_osp_scan_report (scan_id, host, port, ca_pub, key_pub,
+                                  key_priv, 1, 1, &report_xml);
+  if (progress < 0 || progress > 100)
+    {
+      result_t result = make_osp_result
+                         (task, "", "", "",
+                          threat_message_type ("Error"),
+                          "Erroneous scan progress value", "", "",
+                          QOD_DEFAULT);
+      report_add_result (report, result);
+      delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
+                       key_priv);
+      return -1;
+    }
+
+  set_report_slave_progress (report, progress);
+  osp_scan_status = osp_report_scan_status (report_xml);
+  parse_osp_report (task, report, report_xml);
+  g_free (report_xml);
+
+  /* Only ask separately when the report has no status that we know. */
+  if (osp_scan_status == OSP_SCAN_STATUS_ERROR)
+    osp_scan_status = get_osp_scan_status (scan_id, host, port,
+                                           ca_pub, key_pub, key_priv);
+  if (progress >= 0 && progress < 100
+      && osp_scan_status == OSP_SCAN_STATUS_STOPPED)
+    {
+      result_t result = make_osp_result
+        (task, "", "", "",
+         threat_message_type ("Error"),
+         "Scan stopped unexpectedly by the server", "", "",
+         QOD_DEFAULT);
+      report_add_result (report, result);
+      delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
+                       key_priv);
+      return -1;
+    }
+  else if (progress == 100
+           && osp_scan_status == OSP_SCAN_STATUS_FINISHED)
+    {
+      delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
+                       key_priv);
+      return 0;
+    }
+  else if (osp_scan_status == OSP_SCAN_STATUS_RUNNING
+           && *started == FALSE)
+    {
+      set_task_run_status (task, TASK_STATUS_RUNNING);
+      set_report_scan_run_status (report, TASK_STATUS_RUNNING);
+      *started = TRUE;
+    }
+
+  return 1;
+}
+
 /**
  * @brief Handle an ongoing OSP scan, until success or failure.
  *
@@ -3576,90 +3821,12 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
   key_priv = scanner_key_priv (scanner);
   started = FALSE;
 
-  while (1)
+  while ((rc = handle_osp_scan_poll (task, report, scan_id, host, port,
+                                     ca_pub, key_pub, key_priv, &started))
+         == 1)
     {
-      char *report_xml = NULL;
-      int run_status;
-      osp_scan_status_t osp_scan_status;
-
-      run_status = task_run_status (task);
-      if (run_status == TASK_STATUS_STOPPED
-          || run_status == TASK_STATUS_STOP_REQUESTED)
-        {
-          rc = -2;
-          break;
-        }
-      int progress = get_osp_scan_report (scan_id, host, port, ca_pub, key_pub,
-                                          key_priv, 0, 0, &report_xml);
-      if (progress < 0 || progress > 100)
-        {
-          result_t result = make_osp_result
-                             (task, "", "", "",
-                              threat_message_type ("Error"),
-                              "Erroneous scan progress value", "", "",
-                              QOD_DEFAULT);
-          report_add_result (report, result);
-          delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                           key_priv);
-          rc = -1;
-          break;
-        }
-      else
-        {
-          /* Get the full OSP report. */
-          progress = get_osp_scan_report (scan_id, host, port, ca_pub, key_pub,
-                                          key_priv, 1, 1, &report_xml);
-          if (progress < 0 || progress > 100)
-            {
-              result_t result = make_osp_result
-                                 (task, "", "", "",
-                                  threat_message_type ("Error"),
-                                  "Erroneous scan progress value", "", "",
-                                  QOD_DEFAULT);
-              report_add_result (report, result);
-              rc = -1;
-              break;
-            }
-          else
-            {
-              set_report_slave_progress (report, progress);
-              parse_osp_report (task, report, report_xml);
-              g_free (report_xml);
-
-              osp_scan_status = get_osp_scan_status (scan_id, host, port,
-                                                     ca_pub, key_pub, key_priv);
-              if (progress >= 0 && progress < 100
-                  && osp_scan_status == OSP_SCAN_STATUS_STOPPED)
-                {
-                  result_t result = make_osp_result
-                    (task, "", "", "",
-                     threat_message_type ("Error"),
-                     "Scan stopped unexpectedly by the server", "", "",
-                     QOD_DEFAULT);
-                  report_add_result (report, result);
-                  delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                                   key_priv);
-                  rc = -1;
-                  break;
-                }
-              else if (progress == 100
-                       && osp_scan_status == OSP_SCAN_STATUS_FINISHED)
-                {
-                  delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                                   key_priv);
-                  rc = 0;
-                  break;
-                }
-              else if (osp_scan_status == OSP_SCAN_STATUS_RUNNING
-                       && started == FALSE)
-                {
-                  set_task_run_status (task, TASK_STATUS_RUNNING);
-                  set_report_scan_run_status (global_current_report,
-                                              TASK_STATUS_RUNNING);
-                  started = TRUE;
-                }
-            }
-        }
+      manage_process_tick ();
+      gvm_sleep (OSP_SCAN_POLL_PERIOD);
     }
 
   g_free (host);
@@ -3669,6 +3836,34 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
   return rc;
 }
 
+/**
+ * @brief Finish the task and report of an OSP scan that has ended.
+ *
+ * @param[in]  task    The task.
+ * @param[in]  report  The report.
+ * @param[in]  rc      Return from handle_osp_scan.
+ */
+static void
+handle_osp_scan_end (task_t task, report_t report, int rc)
+{
+  if (rc == 0)
+    {
+      hosts_set_identifiers (report);
+      hosts_set_max_severity (report, NULL, NULL);
+      hosts_set_details (report);
+      set_task_run_status (task, TASK_STATUS_DONE);
+      set_report_scan_run_status (report, TASK_STATUS_DONE);
+    }
+  else if (rc == -1 || rc == -2)
+    {
+      set_task_run_status (task, TASK_STATUS_STOPPED);
+      set_report_scan_run_status (report, TASK_STATUS_STOPPED);
+    }
+
+  set_task_end_time_epoch (task, time (NULL));
+  set_scan_end_time_epoch (report, time (NULL));
+}
+
 /**
  * @brief Get an OSP Task's scan options.
  *
@@ -3753,7 +3948,7 @@ launch_osp_task (task_t task, target_t target, const char *scan_id,
                         error);
 
   g_hash_table_destroy (options);
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   g_free (target_str);
   g_free (ports_str);
   return ret;
@@ -4011,7 +4206,7 @@ prepare_osp_scan_for_resume (task_t task, const char *scan_id, char **error)
           g_debug ("%s: Scan %s not found", __func__, scan_id);
           g_free (*error);
           *error = NULL;
-          osp_connection_close (connection);
+          osp_scanner_disconnect (connection);
           trim_partial_report (global_current_report);
           return 1;
         }
@@ -4019,7 +4214,7 @@ prepare_osp_scan_for_resume (task_t task, const char *scan_id, char **error)
         {
           g_warning ("%s: Error getting status of scan %s: %s",
                      __func__, scan_id, *error);
-          osp_connection_close (connection);
+          osp_scanner_disconnect (connection);
           return -1;
         }
     }
@@ -4032,16 +4227,16 @@ prepare_osp_scan_for_resume (task_t task, const char *scan_id, char **error)
        * or storing the results, so some may be missing. */
       if (osp_stop_scan (connection, scan_id, error))
         {
-          osp_connection_close (connection);
+          osp_scanner_disconnect (connection);
           return -1;
         }
       if (osp_delete_scan (connection, scan_id))
         {
           *error = g_strdup ("Failed to delete old report");
-          osp_connection_close (connection);
+          osp_scanner_disconnect (connection);
           return -1;
         }
-      osp_connection_close (connection);
+      osp_scanner_disconnect (connection);
       trim_partial_report (global_current_report);
       return 1;
     }
@@ -4051,173 +4246,160 @@ prepare_osp_scan_for_resume (task_t task, const char *scan_id, char **error)
       if (osp_delete_scan (connection, scan_id))
         {
           *error = g_strdup ("Failed to delete old report");
-          osp_connection_close (connection);
+          osp_scanner_disconnect (connection);
           return -1;
         }
-      osp_connection_close (connection);
+      osp_scanner_disconnect (connection);
       trim_partial_report (global_current_report);
       return 1;
     }
 
   g_warning ("%s: Unexpected scanner status %d", __func__, status);
   *error = g_strdup_printf ("Unexpected scanner status %d", status);
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   return -1;
 }
 
 /**
- * @brief Launch an OpenVAS via OSP task.
+ * @brief Add a VT to the VTs of an OSP scan.
  *
- * @param[in]   task        The task.
- * @param[in]   target      The target.
- * @param[in]   scan_id     The scan uuid.
- * @param[in]   from        0 start from beginning, 1 continue from stopped,
- *                          2 continue if stopped else start from beginning.
- * @param[out]  error       Error return.
+ * @param[in,out]  vts             VTs.
+ * @param[in,out]  vts_hash_table  VTs, by OID.
+ * @param[in]      oid             OID of VT.
+ */
+static void
+osp_vts_add (GSList **vts, GHashTable *vts_hash_table, const char *oid)
+{
+  osp_vt_single_t *new_vt;
+
+  new_vt = osp_vt_single_new (oid);
+  *vts = g_slist_prepend (*vts, new_vt);
+  g_hash_table_replace (vts_hash_table, g_strdup (oid), new_vt);
+}
+
+/**
+ * @brief Add a preference value to the VTs of an OSP scan.
  *
- * @return 0 success, -1 if scanner is down.
+ * @param[in]  vts_hash_table  VTs, by OID.
+ * @param[in]  oid             OID of VT.
+ * @param[in]  pref_id         ID of preference.
+ * @param[in]  value           Value, in OSP form.
+ *
+ * @return 1 if VT is in the scan, else 0.
  */
 static int
-launch_osp_openvas_task (task_t task, target_t target, const char *scan_id,
-                         int from, char **error)
+osp_vts_add_value (GHashTable *vts_hash_table, const char *oid,
+                   const char *pref_id, const char *value)
 {
-  osp_connection_t *connection;
-  char *hosts_str, *ports_str, *exclude_hosts_str, *finished_hosts_str;
-  int alive_test, reverse_lookup_only, reverse_lookup_unify;
-  osp_target_t *osp_target;
-  GSList *osp_targets, *vts;
-  GHashTable *vts_hash_table;
-  osp_credential_t *ssh_credential, *smb_credential, *esxi_credential;
-  osp_credential_t *snmp_credential;
-  GHashTable *scanner_options;
-  int ret;
-  config_t config;
-  iterator_t scanner_prefs_iter, families, prefs;
-  osp_start_scan_opts_t start_scan_opts;
+  osp_vt_single_t *osp_vt;
 
-  config = task_config (task);
+  osp_vt = g_hash_table_lookup (vts_hash_table, oid);
+  if (osp_vt == NULL)
+    return 0;
+  osp_vt_single_add_value (osp_vt, pref_id, value);
+  return 1;
+}
 
-  connection = NULL;
+/**
+ * @brief Make the VTs of an OSP scan from a VT bundle.
+ *
+ * A bundle has a line "V<tab><OID>" for each VT and a line
+ * "P<tab><OID><tab><preference ID><tab><escaped value>" for each
+ * preference value.
+ *
+ * @param[in]  bundle  Bundle.
+ *
+ * @return VTs.
+ */
+static GSList *
+osp_vts_from_bundle (const gchar *bundle)
+{
+  GSList *vts;
+  GHashTable *vts_hash_table;
+  gchar **lines, **line;
 
-  alive_test = 0;
-  reverse_lookup_unify = 0;
-  reverse_lookup_only = 0;
+  vts = NULL;
+  vts_hash_table
+    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-  /* Prepare the report */
-  if (from)
+  lines = g_strsplit (bundle, "\n", -1);
+  for (line = lines; *line; line++)
     {
-      ret = prepare_osp_scan_for_resume (task, scan_id, error);
-      if (ret == 0)
-        return 0;
-      else if (ret == -1)
-        return -1;
-      finished_hosts_str = report_finished_hosts_str (global_current_report);
-    }
-  else
-    finished_hosts_str = NULL;
+      gchar **fields;
 
-  /* Set up target(s) */
-  hosts_str = target_hosts (target);
-  ports_str = target_port_range (target);
-  exclude_hosts_str = target_exclude_hosts (target);
+      fields = g_strsplit (*line, "\t", 4);
+      if (fields[0] && fields[1])
+        {
+          if (strcmp (fields[0], "V") == 0)
+            osp_vts_add (&vts, vts_hash_table, fields[1]);
+          else if (strcmp (fields[0], "P") == 0 && fields[2] && fields[3])
+            {
+              gchar *value;
 
-  if (target_alive_tests (target) > 0)
-   alive_test = target_alive_tests (target);
+              value = g_strcompress (fields[3]);
+              osp_vts_add_value (vts_hash_table, fields[1], fields[2], value);
+              g_free (value);
+            }
+        }
+      g_strfreev (fields);
+    }
+  g_strfreev (lines);
 
-  if (target_reverse_lookup_only (target) != NULL)
-    reverse_lookup_only = atoi (target_reverse_lookup_only (target));
+  g_hash_table_destroy (vts_hash_table);
+  return vts;
+}
 
-  if (target_reverse_lookup_unify (target) != NULL)
-    reverse_lookup_unify = atoi (target_reverse_lookup_unify (target));
+/**
+ * @brief Get the VTs of a config, with preferences, for an OSP scan.
+ *
+ * Resolving the families, NVT selectors and preferences of a config takes
+ * many queries, so the result is cached in the database as a bundle, for
+ * as long as the config and the NVT feed stay the same.
+ *
+ * @param[in]  config  Config.
+ *
+ * @return VTs.
+ */
+static GSList *
+config_osp_vts (config_t config)
+{
+  GSList *vts;
+  GHashTable *vts_hash_table;
+  GString *bundle;
+  gchar *cached, *key;
+  iterator_t families, prefs;
 
-  if (finished_hosts_str)
+  cached = config_vts_bundle (config, &key);
+  if (cached)
     {
-      gchar *new_exclude_hosts;
-
-      new_exclude_hosts = g_strdup_printf ("%s,%s",
-                                           exclude_hosts_str,
-                                           finished_hosts_str);
-      free (exclude_hosts_str);
-      exclude_hosts_str = new_exclude_hosts;
+      g_debug ("%s: using cached VTs of config %llu", __func__, config);
+      vts = osp_vts_from_bundle (cached);
+      g_free (cached);
+      g_free (key);
+      return vts;
     }
 
-  osp_target = osp_target_new (hosts_str, ports_str, exclude_hosts_str,
-                               alive_test, reverse_lookup_unify,
-                               reverse_lookup_only);
-  if (finished_hosts_str)
-    osp_target_set_finished_hosts (osp_target, finished_hosts_str);
+  vts = NULL;
+  vts_hash_table
+    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  bundle = g_string_new ("");
 
-  free (hosts_str);
-  free (ports_str);
-  free (exclude_hosts_str);
-  free (finished_hosts_str);
-  osp_targets = g_slist_append (NULL, osp_target);
-
-  ssh_credential = target_osp_ssh_credential (target);
-  if (ssh_credential)
-    osp_target_add_credential (osp_target, ssh_credential);
-
-  smb_credential = target_osp_smb_credential (target);
-  if (smb_credential)
-    osp_target_add_credential (osp_target, smb_credential);
-
-  esxi_credential = target_osp_esxi_credential (target);
-  if (esxi_credential)
-    osp_target_add_credential (osp_target, esxi_credential);
-
-  snmp_credential = target_osp_snmp_credential (target);
-  if (snmp_credential)
-    osp_target_add_credential (osp_target, snmp_credential);
-
-  /* Setup general scanner preferences */
-  scanner_options
-    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-  init_preference_iterator (&scanner_prefs_iter, config, "SERVER_PREFS");
-  while (next (&scanner_prefs_iter))
-    {
-      const char *name, *value;
-      name = preference_iterator_name (&scanner_prefs_iter);
-      value = preference_iterator_value (&scanner_prefs_iter);
-      if (name && value)
-        {
-          const char *osp_value;
-
-          // Workaround for boolean scanner preferences
-          if (strcmp (value, "yes") == 0)
-            osp_value = "1";
-          else if (strcmp (value, "no") == 0)
-            osp_value = "0";
-          else
-            osp_value = value;
-          g_hash_table_replace (scanner_options,
-                                g_strdup (name),
-                                g_strdup (osp_value));
-        }
-    }
-
-  /* Setup vulnerability tests (without preferences) */
-  vts = NULL;
-  vts_hash_table
-    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-
-  init_family_iterator (&families, 0, NULL, 1);
-  while (next (&families))
-    {
-      const char *family = family_iterator_name (&families);
-      if (family)
-        {
-          iterator_t nvts;
-          init_nvt_iterator (&nvts, 0, config, family, NULL, 1, NULL);
-          while (next (&nvts))
-            {
-              const char *oid;
-              osp_vt_single_t *new_vt;
+  /* Setup vulnerability tests (without preferences) */
+  init_family_iterator (&families, 0, NULL, 1);
+  while (next (&families))
+    {
+      const char *family = family_iterator_name (&families);
+      if (family)
+        {
+          iterator_t nvts;
+          init_nvt_iterator (&nvts, 0, config, family, NULL, 1, NULL);
+          while (next (&nvts))
+            {
+              const char *oid;
 
               oid = nvt_iterator_oid (&nvts);
-              new_vt = osp_vt_single_new (oid);
-
-              vts = g_slist_prepend (vts, new_vt);
-              g_hash_table_replace (vts_hash_table, g_strdup (oid), new_vt);
+              osp_vts_add (&vts, vts_hash_table, oid);
+              g_string_append_printf (bundle, "V\t%s\n", oid);
             }
           cleanup_iterator (&nvts);
         }
@@ -4229,14 +4411,12 @@ launch_osp_openvas_task (task_t task, target_t target, const char *scan_id,
   while (next (&prefs))
     {
       const char *full_name, *value;
-      osp_vt_single_t *osp_vt;
       gchar **split_name;
 
       full_name = preference_iterator_name (&prefs);
       value = preference_iterator_value (&prefs);
       split_name = g_strsplit (full_name, ":", 4);
 
-      osp_vt = NULL;
       if (split_name && split_name[0] && split_name[1] && split_name[2])
         {
           const char *oid = split_name[0];
@@ -4261,10 +4441,16 @@ launch_osp_openvas_task (task_t task, target_t target, const char *scan_id,
           else if (strcmp (type, "file") == 0)
             osp_value = g_base64_encode ((guchar*) value, strlen (value));
 
-          osp_vt = g_hash_table_lookup (vts_hash_table, oid);
-          if (osp_vt)
-            osp_vt_single_add_value (osp_vt, pref_id,
-                                     osp_value ? osp_value : value);
+          if (osp_vts_add_value (vts_hash_table, oid, pref_id,
+                                 osp_value ? osp_value : value))
+            {
+              gchar *escaped;
+
+              escaped = g_strescape (osp_value ? osp_value : value, NULL);
+              g_string_append_printf (bundle, "P\t%s\t%s\t%s\n",
+                                      oid, pref_id, escaped);
+              g_free (escaped);
+            }
           g_free (osp_value);
         }
 
@@ -4272,6 +4458,147 @@ launch_osp_openvas_task (task_t task, target_t target, const char *scan_id,
     }
   cleanup_iterator (&prefs);
 
+  if (key)
+    config_vts_bundle_set (config, key, bundle->str);
+
+  g_string_free (bundle, TRUE);
+  g_free (key);
+  g_hash_table_destroy (vts_hash_table);
+  return vts;
+}
+
+/**
+ * @brief Launch an OpenVAS via OSP task.
+ *
+ * @param[in]   task        The task.
+ * @param[in]   target      The target.
+ * @param[in]   scan_id     The scan uuid.
+ * @param[in]   from        0 start from beginning, 1 continue from stopped,
+ *                          2 continue if stopped else start from beginning.
+ * @param[out]  error       Error return.
+ *
+ * @return 0 success, -1 if scanner is down.
+ */
+static int
+launch_osp_openvas_task (task_t task, target_t target, const char *scan_id,
+                         int from, char **error)
+{
+  osp_connection_t *connection;
+  char *hosts_str, *ports_str, *exclude_hosts_str, *finished_hosts_str;
+  int alive_test, reverse_lookup_only, reverse_lookup_unify;
+  osp_target_t *osp_target;
+  GSList *osp_targets, *vts;
+  osp_credential_t *ssh_credential, *smb_credential, *esxi_credential;
+  osp_credential_t *snmp_credential;
+  GHashTable *scanner_options;
+  int ret;
+  config_t config;
+  iterator_t scanner_prefs_iter;
+  osp_start_scan_opts_t start_scan_opts;
+
+  config = task_config (task);
+
+  connection = NULL;
+
+  alive_test = 0;
+  reverse_lookup_unify = 0;
+  reverse_lookup_only = 0;
+
+  /* Prepare the report */
+  if (from)
+    {
+      ret = prepare_osp_scan_for_resume (task, scan_id, error);
+      if (ret == 0)
+        return 0;
+      else if (ret == -1)
+        return -1;
+      finished_hosts_str = report_finished_hosts_str (global_current_report);
+    }
+  else
+    finished_hosts_str = NULL;
+
+  /* Set up target(s) */
+  hosts_str = target_hosts (target);
+  ports_str = target_port_range (target);
+  exclude_hosts_str = target_exclude_hosts (target);
+
+  if (target_alive_tests (target) > 0)
+   alive_test = target_alive_tests (target);
+
+  if (target_reverse_lookup_only (target) != NULL)
+    reverse_lookup_only = atoi (target_reverse_lookup_only (target));
+
+  if (target_reverse_lookup_unify (target) != NULL)
+    reverse_lookup_unify = atoi (target_reverse_lookup_unify (target));
+
+  if (finished_hosts_str)
+    {
+      gchar *new_exclude_hosts;
+
+      new_exclude_hosts = g_strdup_printf ("%s,%s",
+                                           exclude_hosts_str,
+                                           finished_hosts_str);
+      free (exclude_hosts_str);
+      exclude_hosts_str = new_exclude_hosts;
+    }
+
+  osp_target = osp_target_new (hosts_str, ports_str, exclude_hosts_str,
+                               alive_test, reverse_lookup_unify,
+                               reverse_lookup_only);
+  if (finished_hosts_str)
+    osp_target_set_finished_hosts (osp_target, finished_hosts_str);
+
+  free (hosts_str);
+  free (ports_str);
+  free (exclude_hosts_str);
+  free (finished_hosts_str);
+  osp_targets = g_slist_append (NULL, osp_target);
+
+  ssh_credential = target_osp_ssh_credential (target);
+  if (ssh_credential)
+    osp_target_add_credential (osp_target, ssh_credential);
+
+  smb_credential = target_osp_smb_credential (target);
+  if (smb_credential)
+    osp_target_add_credential (osp_target, smb_credential);
+
+  esxi_credential = target_osp_esxi_credential (target);
+  if (esxi_credential)
+    osp_target_add_credential (osp_target, esxi_credential);
+
+  snmp_credential = target_osp_snmp_credential (target);
+  if (snmp_credential)
+    osp_target_add_credential (osp_target, snmp_credential);
+
+  /* Setup general scanner preferences */
+  scanner_options
+    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  init_preference_iterator (&scanner_prefs_iter, config, "SERVER_PREFS");
+  while (next (&scanner_prefs_iter))
+    {
+      const char *name, *value;
+      name = preference_iterator_name (&scanner_prefs_iter);
+      value = preference_iterator_value (&scanner_prefs_iter);
+      if (name && value)
+        {
+          const char *osp_value;
+
+          // Workaround for boolean scanner preferences
+          if (strcmp (value, "yes") == 0)
+            osp_value = "1";
+          else if (strcmp (value, "no") == 0)
+            osp_value = "0";
+          else
+            osp_value = value;
+          g_hash_table_replace (scanner_options,
+                                g_strdup (name),
+                                g_strdup (osp_value));
+        }
+    }
+
+  /* Setup vulnerability tests, with preferences */
+  vts = config_osp_vts (config);
+
   /* Start the scan */
   connection = osp_scanner_connect (task_scanner (task));
   if (!connection)
@@ -4296,7 +4623,7 @@ launch_osp_openvas_task (task_t task, target_t target, const char *scan_id,
                             start_scan_opts,
                             error);
 
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   g_slist_free_full (osp_targets, (GDestroyNotify) osp_target_free);
   // Credentials are freed with target
   g_slist_free_full (vts, (GDestroyNotify) osp_vt_single_free);
@@ -4438,6 +4765,10 @@ fork_osp_scan_handler (task_t task, target_t target, int from,
   reinit_manage_process ();
   manage_session_init (current_credentials.uuid);
 
+  /* Decrypt each credential once, instead of on every lookup. */
+  lsc_crypt_session_start ();
+  target_decrypt_credentials (target);
+
   if (scanner_type (task_scanner (task)) == SCANNER_TYPE_OPENVAS
       || scanner_type (task_scanner (task) == SCANNER_TYPE_OSP_SENSOR))
     {
@@ -4447,6 +4778,7 @@ fork_osp_scan_handler (task_t task, target_t target, int from,
     {
       rc = launch_osp_task (task, target, report_id, &error);
     }
+  lsc_crypt_session_end ();
 
   if (rc)
     {
@@ -4467,27 +4799,23 @@ fork_osp_scan_handler (task_t task, target_t target, int from,
       exit (-1);
     }
 
+  if (osp_scan_supervisor)
+    {
+      /* Leave the polling to the supervisor, which handles all scans from
+       * a single process. */
+      osp_scan_queue_add (task, global_current_report);
+      g_free (report_id);
+      global_current_report = 0;
+      exit (0);
+    }
+
   snprintf (title, sizeof (title), "gvmd: OSP: Handling scan %s", report_id);
   proctitle_set (title);
+  manage_process_register ("osp_handler", task, global_current_report);
 
   rc = handle_osp_scan (task, global_current_report, report_id);
   g_free (report_id);
-  if (rc == 0)
-    {
-      hosts_set_identifiers (global_current_report);
-      hosts_set_max_severity (global_current_report, NULL, NULL);
-      hosts_set_details (global_current_report);
-      set_task_run_status (task, TASK_STATUS_DONE);
-      set_report_scan_run_status (global_current_report, TASK_STATUS_DONE);
-    }
-  else if (rc == -1 || rc == -2)
-    {
-      set_task_run_status (task, TASK_STATUS_STOPPED);
-      set_report_scan_run_status (global_current_report, TASK_STATUS_STOPPED);
-    }
-
-  set_task_end_time_epoch (task, time (NULL));
-  set_scan_end_time_epoch (global_current_report, time (NULL));
+  handle_osp_scan_end (task, global_current_report, rc);
   global_current_report = 0;
   current_scanner_task = (task_t) 0;
   exit (rc);
@@ -4533,135 +4861,164 @@ run_osp_task (task_t task, int from, char **report_id)
   return 0;
 }
 
-
-/* CVE tasks. */
-
 /**
- * @brief Perform a CVE "scan" on a host.
+ * @brief Poll each supervised OSP scan once.
  *
- * @param[in]  task      Task.
- * @param[in]  gvm_host  Host.
- *
- * @return 0 success, 1 failed to get nthlast report for a host.
+ * @return Number of scans still going.
  */
 static int
-cve_scan_host (task_t task, gvm_host_t *gvm_host)
+supervise_osp_scans_poll ()
 {
-  report_host_t report_host;
-  gchar *ip, *host;
-
-  host = gvm_host_value_str (gvm_host);
-
-  ip = report_host_ip (host);
-  if (ip == NULL)
-    ip = g_strdup (host);
-
-  g_debug ("%s: ip: %s", __func__, ip);
-
-  /* Get the last report that applies to the host. */
+  iterator_t scans;
+  int remaining;
+  gchar *old_user_id;
 
-  if (host_nthlast_report_host (ip, &report_host, 1))
+  remaining = 0;
+  old_user_id = current_credentials.uuid;
+  cluster_heartbeat ();
+  init_osp_scan_queue_iterator (&scans);
+  while (next (&scans))
     {
-      g_warning ("%s: Failed to get nthlast report", __func__);
-      g_free (ip);
-      return 1;
-    }
+      task_t task;
+      report_t report;
+      scanner_t scanner;
+      char *host, *ca_pub, *key_pub, *key_priv, *scan_id;
+      int rc, port;
+      gboolean started;
 
-  g_debug ("%s: report_host: %llu", __func__, report_host);
+      task = osp_scan_queue_iterator_task (&scans);
+      report = osp_scan_queue_iterator_report (&scans);
+      started = osp_scan_queue_iterator_started (&scans) ? TRUE : FALSE;
 
-  if (report_host)
-    {
-      iterator_t report_hosts;
+      current_credentials.uuid
+        = g_strdup (osp_scan_queue_iterator_owner_uuid (&scans));
+      manage_session_init (current_credentials.uuid);
+      global_current_report = report;
 
-      /* Get the report_host for the host. */
+      scanner = task_scanner (task);
+      host = scanner_host (scanner);
+      port = scanner_port (scanner);
+      ca_pub = scanner_ca_pub (scanner);
+      key_pub = scanner_key_pub (scanner);
+      key_priv = scanner_key_priv (scanner);
+      scan_id = report_uuid (report);
 
-      init_report_host_iterator (&report_hosts, 0, NULL, report_host);
-      if (next (&report_hosts))
+      rc = handle_osp_scan_poll (task, report, scan_id, host, port,
+                                 ca_pub, key_pub, key_priv, &started);
+      if (rc == 1)
+        {
+          if (started && osp_scan_queue_iterator_started (&scans) == 0)
+            osp_scan_queue_set_started (task);
+          remaining++;
+        }
+      else
         {
-          iterator_t prognosis;
-          int prognosis_report_host, start_time;
+          handle_osp_scan_end (task, report, rc);
+          osp_scan_queue_remove (task);
+        }
 
-          /* Add report_host with prognosis results and host details. */
+      g_free (scan_id);
+      g_free (host);
+      g_free (ca_pub);
+      g_free (key_pub);
+      g_free (key_priv);
+      global_current_report = 0;
+      g_free (current_credentials.uuid);
+    }
+  cleanup_iterator (&scans);
+  current_credentials.uuid = old_user_id;
+  manage_session_init (current_credentials.uuid);
 
-          start_time = time (NULL);
-          prognosis_report_host = 0;
-          init_host_prognosis_iterator (&prognosis, report_host);
-          while (next (&prognosis))
-            {
-              const char *app, *cve;
-              double severity;
-              gchar *desc, *location;
-              result_t result;
-
-              if (global_current_report && (prognosis_report_host == 0))
-                prognosis_report_host = manage_report_host_add (global_current_report,
-                                                                ip,
-                                                                start_time,
-                                                                0);
-
-              severity = prognosis_iterator_cvss_double (&prognosis);
-
-              app = prognosis_iterator_cpe (&prognosis);
-              cve = prognosis_iterator_cve (&prognosis);
-              location = app_location (report_host, app);
-
-              desc = g_strdup_printf ("The host carries the product: %s\n"
-                                      "It is vulnerable according to: %s.\n"
-                                      "%s%s%s"
-                                      "\n"
-                                      "%s",
-                                      app,
-                                      cve,
-                                      location
-                                       ? "The product was found at: "
-                                       : "",
-                                      location ? location : "",
-                                      location ? ".\n" : "",
-                                      prognosis_iterator_description
-                                       (&prognosis));
-
-              g_debug ("%s: making result with severity %1.1f desc [%s]",
-                       __func__, severity, desc);
-
-              result = make_cve_result (task, ip, cve, severity, desc);
-              g_free (desc);
-              if (global_current_report)
-                {
-                  report_add_result (global_current_report, result);
+  return remaining;
+}
 
-                  insert_report_host_detail (global_current_report, ip, "cve", cve,
-                                             "CVE Scanner", "App", app);
+/**
+ * @brief Poll the supervised OSP scans until none are left.
+ */
+static void
+supervise_osp_scans ()
+{
+  while (supervise_osp_scans_poll ())
+    {
+      manage_process_tick ();
+      gvm_sleep (OSP_SCAN_POLL_PERIOD);
+    }
+}
 
-                  if (location)
-                    {
-                      insert_report_host_detail (global_current_report, ip, "cve", cve,
-                                                 "CVE Scanner", app, location);
-
-                      insert_report_host_detail (global_current_report, ip, "cve", cve,
-                                                 "CVE Scanner", "detected_at",
-                                                 location);
-                      insert_report_host_detail (global_current_report, ip, "cve", cve,
-                                                 "CVE Scanner", "detected_by",
-                                                 /* Detected by itself. */
-                                                 cve);
-                    }
-                }
-              g_free (location);
-            }
-          cleanup_iterator (&prognosis);
+/**
+ * @brief Start the OSP scan supervisor if there are supervised scans.
+ *
+ * The supervisor is a child process that polls all supervised scans in
+ * turn, with a single database connection, until none are left.  At most
+ * one supervisor runs at a time.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ */
+void
+manage_supervise_osp_scans (sigset_t *sigmask_current)
+{
+  if (osp_scan_queue_depth () == 0)
+    return;
 
-          if (prognosis_report_host)
-            {
-              /* Complete the report_host. */
+  fork_locked_worker (sigmask_current,
+                      "gvm-supervise-osp-scans",
+                      "gvmd: OSP: Supervising scans",
+                      "osp_supervisor",
+                      supervise_osp_scans);
+}
 
-              report_host_set_end_time (prognosis_report_host, time (NULL));
-              insert_report_host_detail (global_current_report, ip, "cve", "",
-                                         "CVE Scanner", "CVE Scan", "1");
-            }
-        }
-      cleanup_iterator (&report_hosts);
+/**
+ * @brief Set whether OSP scans are polled by the scan supervisor.
+ *
+ * @param[in]  supervise  Whether to use the supervisor.
+ */
+void
+set_osp_scan_supervisor (int supervise)
+{
+  osp_scan_supervisor = supervise ? 1 : 0;
+}
+
+
+/* CVE tasks. */
+
+/**
+ * @brief Add a host to a CVE "scan".
+ *
+ * @param[in]  scan      CVE scan.
+ * @param[in]  gvm_host  Host.
+ *
+ * @return 0 success, 1 failed to get nthlast report for a host.
+ */
+static int
+cve_scan_host (cve_scan_t *scan, gvm_host_t *gvm_host)
+{
+  report_host_t report_host;
+  gchar *ip, *host;
+
+  host = gvm_host_value_str (gvm_host);
+
+  ip = report_host_ip (host);
+  if (ip == NULL)
+    ip = g_strdup (host);
+
+  g_debug ("%s: ip: %s", __func__, ip);
+
+  /* Get the last report that applies to the host. */
+
+  if (host_nthlast_report_host (ip, &report_host, 1))
+    {
+      g_warning ("%s: Failed to get nthlast report", __func__);
+      g_free (ip);
+      return 1;
     }
 
+  g_debug ("%s: report_host: %llu", __func__, report_host);
+
+  /* The products of the host are matched later, with all the others. */
+
+  if (report_host)
+    cve_scan_add_host (scan, ip, report_host);
+
   g_free (ip);
   return 0;
 }
@@ -4683,6 +5040,7 @@ fork_cve_scan_handler (task_t task, target_t target)
   char *report_id, title[128], *hosts;
   gvm_hosts_t *gvm_hosts;
   gvm_host_t *gvm_host;
+  cve_scan_t *scan;
 
   assert (task);
   assert (target);
@@ -4732,6 +5090,7 @@ fork_cve_scan_handler (task_t task, target_t target)
   snprintf (title, sizeof (title), "gvmd: CVE: Handling scan %s", report_id);
   g_free (report_id);
   proctitle_set (title);
+  manage_process_register ("cve_scan", task, global_current_report);
 
   hosts = target_hosts (target);
   if (hosts == NULL)
@@ -4749,20 +5108,33 @@ fork_cve_scan_handler (task_t task, target_t target)
 
   /* Add the results. */
 
+  scan = cve_scan_new (task, global_current_report);
   gvm_hosts = gvm_hosts_new (hosts);
   free (hosts);
   while ((gvm_host = gvm_hosts_next (gvm_hosts)))
-    if (cve_scan_host (task, gvm_host))
+    if (cve_scan_host (scan, gvm_host))
       {
         set_task_interrupted (task,
                               "Failed to get nthlast report."
                               "  Interrupting scan.");
         set_report_scan_run_status (global_current_report, TASK_STATUS_INTERRUPTED);
         gvm_hosts_free (gvm_hosts);
+        cve_scan_free (scan);
         exit (1);
       }
   gvm_hosts_free (gvm_hosts);
 
+  if (cve_scan_run (scan))
+    {
+      set_task_interrupted (task,
+                            "Failed to add CVE results."
+                            "  Interrupting scan.");
+      set_report_scan_run_status (global_current_report, TASK_STATUS_INTERRUPTED);
+      cve_scan_free (scan);
+      exit (1);
+    }
+  cve_scan_free (scan);
+
   /* Set the end states. */
 
   set_scan_end_time_epoch (global_current_report, time (NULL));
@@ -5085,6 +5457,7 @@ run_gmp_slave_task (task_t task, int from, char **report_id,
             uuid);
   free (uuid);
   proctitle_set (title);
+  manage_process_register ("slave_scan", task, global_current_report);
 
   switch (handle_slave_task (task, target, ssh_credential, smb_credential,
                              esxi_credential, snmp_credential,
@@ -5640,7 +6013,7 @@ stop_osp_task (task_t task)
     goto end_stop_osp;
   set_task_run_status (task, TASK_STATUS_STOP_REQUESTED);
   ret = osp_stop_scan (connection, scan_id, NULL);
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   if (ret)
     {
       g_free (scan_id);
@@ -5651,7 +6024,7 @@ stop_osp_task (task_t task)
   if (!connection)
     goto end_stop_osp;
   ret = osp_delete_scan (connection, scan_id);
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   g_free (scan_id);
 
 end_stop_osp:
@@ -5985,14 +6358,14 @@ get_osp_performance_string (scanner_t scanner, int start, int end,
 
   if (osp_get_performance_ext (connection, opts, performance_str, &error))
     {
-      osp_connection_close (connection);
+      osp_scanner_disconnect (connection);
       g_warning ("Error getting OSP performance report: %s", error);
       g_free (error);
       g_free (opts.titles);
       return 4;
     }
 
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   g_free (opts.titles);
 
   return 0;
@@ -6737,6 +7110,28 @@ manage_system_report (const char *name, const char *duration,
       else
         g_string_append (buffer, "Error getting load averages.\n");
 
+      g_string_append_printf (buffer,
+                              "\nReport count caches queued for rebuild: %i\n",
+                              manage_count_cache_queue_depth ());
+
+      g_string_append_printf (buffer,
+                              "Reports queued for deletion: %i\n",
+                              manage_report_deletion_queue_depth ());
+
+      g_string_append_printf (buffer,
+                              "OSP scans supervised: %i\n",
+                              osp_scan_queue_depth ());
+
+      {
+        int depth, oldest;
+
+        depth = manage_alert_queue_depth (&oldest);
+        g_string_append_printf (buffer,
+                                "Alerts queued: %i (oldest waiting %i s)\n",
+                                depth,
+                                oldest);
+      }
+
       get_error = NULL;
       g_file_get_contents ("/proc/meminfo",
                            &output,
@@ -7165,54 +7560,59 @@ manage_sync (sigset_t *sigmask_current,
   manage_sync_configs ();
   manage_sync_port_lists ();
   manage_sync_report_formats ();
+  manage_rebuild_count_caches (sigmask_current);
+  manage_delete_queued_reports (sigmask_current);
+  manage_run_migration_steps (sigmask_current);
+  manage_extend_results_partitions ();
+  manage_supervise_osp_scans (sigmask_current);
+  manage_dispatch_alerts (sigmask_current);
 }
 
 /**
- * @brief Schedule any actions that are due.
+ * @brief Time at which manage_schedule must next look at the task schedules.
+ */
+static time_t schedule_next_due = 0;
+
+/**
+ * @brief Update the earliest time at which a schedule action is due.
  *
- * In gvmd, periodically called from the main daemon loop.
+ * @param[in,out]  next_due  Earliest due time so far.
+ * @param[in]      due       Due time of an action, 0 for none.
+ * @param[in]      now       Current time.
+ */
+static void
+schedule_due_at (time_t *next_due, time_t due, time_t now)
+{
+  if (due > now && due < *next_due)
+    *next_due = due;
+}
+
+/**
+ * @brief Start and stop the scheduled tasks that are due.
+ *
+ * Also work out when the next start or stop will be due.
  *
  * @param[in]  fork_connection  Function that forks a child which is connected
- *                              to the Manager.  Must return PID in parent, 0
- *                              in child, or -1 on error.
- * @param[in]  run_tasks        Whether to run scheduled tasks.
+ *                              to the Manager.
  * @param[in]  sigmask_current  Sigmask to restore in child.
  *
  * @return 0 success, 1 failed to get lock, -1 error.
  */
-int
-manage_schedule (manage_connection_forker_t fork_connection,
-                 gboolean run_tasks,
-                 sigset_t *sigmask_current)
+static int
+manage_schedule_tasks (manage_connection_forker_t fork_connection,
+                       sigset_t *sigmask_current)
 {
   iterator_t schedules;
   GSList *starts, *stops;
   int ret;
   task_t previous_start_task, previous_stop_task;
+  time_t now, next_due;
 
   starts = NULL;
   stops = NULL;
   previous_start_task = 0;
   previous_stop_task = 0;
 
-  ret = manage_update_nvti_cache ();
-  if (ret)
-    {
-      if (ret == -1)
-        {
-          g_warning ("%s: manage_update_nvti_cache error"
-                     " (Perhaps the db went down?)",
-                     __func__);
-          /* Just ignore, in case the db went down temporarily. */
-          return 0;
-        }
-
-      return ret;
-    }
-
-  if (run_tasks == 0)
-    return 0;
-
   /* Assemble "starts" and "stops" list containing task uuid, owner name and
    * owner UUID for each (scheduled) task to start or stop. */
 
@@ -7230,12 +7630,19 @@ manage_schedule (manage_connection_forker_t fork_connection,
 
       return ret;
     }
+
+  /* Look again after SCHEDULE_SCAN_PERIOD_MAX at the latest, in case a
+   * change was missed. */
+  now = time (NULL);
+  next_due = now + SCHEDULE_SCAN_PERIOD_MAX;
+
   /* This iterator runs in a transaction. */
   while (next (&schedules))
     if (task_schedule_iterator_start_due (&schedules))
       {
         const char *icalendar, *zone;
         int timed_out;
+        time_t next_time;
 
         /* Check if task schedule is timed out before updating next due time */
         timed_out = task_schedule_iterator_timed_out (&schedules);
@@ -7248,9 +7655,10 @@ manage_schedule (manage_connection_forker_t fork_connection,
         g_debug ("%s: start due for %llu, setting next_time",
                  __func__,
                  task_schedule_iterator_task (&schedules));
-        set_task_schedule_next_time
-         (task_schedule_iterator_task (&schedules),
-          icalendar_next_time_from_string (icalendar, zone, 0));
+        next_time = icalendar_next_time_from_string (icalendar, zone, 0);
+        set_task_schedule_next_time (task_schedule_iterator_task (&schedules),
+                                     next_time);
+        schedule_due_at (&next_due, next_time, now);
 
         /* Skip this task if it was already added to the starts list
          * to avoid conflicts between multiple users with permissions. */
@@ -7268,6 +7676,11 @@ manage_schedule (manage_connection_forker_t fork_connection,
 
         previous_start_task = task_schedule_iterator_task (&schedules);
 
+        g_info ("%s: starting task %s %li seconds after planned start",
+                __func__,
+                task_schedule_iterator_task_uuid (&schedules),
+                (long) (now - task_schedule_iterator_next_time (&schedules)));
+
         /* Add task UUID and owner name and UUID to the list. */
 
         starts = g_slist_prepend
@@ -7277,8 +7690,22 @@ manage_schedule (manage_connection_forker_t fork_connection,
                      task_schedule_iterator_owner_uuid (&schedules),
                      task_schedule_iterator_owner_name (&schedules)));
       }
-    else if (task_schedule_iterator_stop_due (&schedules))
+    else
       {
+        time_t stop_time;
+
+        /* A task is stopped once the end of the duration has passed. */
+        stop_time = task_schedule_iterator_stop_time (&schedules);
+        if (stop_time == 0 || stop_time >= now)
+          {
+            schedule_due_at (&next_due,
+                             task_schedule_iterator_next_time (&schedules),
+                             now);
+            if (stop_time)
+              schedule_due_at (&next_due, stop_time + 1, now);
+            continue;
+          }
+
         /* Skip this task if it was already added to the stops list
          * to avoid conflicts between multiple users with permissions. */
 
@@ -7297,6 +7724,10 @@ manage_schedule (manage_connection_forker_t fork_connection,
       }
   cleanup_task_schedule_iterator (&schedules);
 
+  schedule_next_due = next_due;
+  g_debug ("%s: next schedule action due in %li seconds",
+           __func__, (long) (next_due - now));
+
   /* Start tasks in forked processes, now that the SQL statement is closed. */
 
   while (starts)
@@ -7346,6 +7777,89 @@ manage_schedule (manage_connection_forker_t fork_connection,
       scheduled_task_free (scheduled_task);
     }
 
+  return 0;
+}
+
+/**
+ * @brief Get the time at which the next schedule action is due.
+ *
+ * @return Time at which manage_schedule must be called again to start or stop
+ *         a task.  Changes to task schedules arrive on the socket from
+ *         manage_schedule_socket, and also require a call.
+ */
+time_t
+manage_schedule_next_due ()
+{
+  return schedule_next_due;
+}
+
+/**
+ * @brief Get the socket on which changes to task schedules arrive.
+ *
+ * @return Socket, or -1 if there is none.
+ */
+int
+manage_schedule_socket ()
+{
+  return manage_task_schedules_socket ();
+}
+
+/**
+ * @brief Schedule any actions that are due.
+ *
+ * In gvmd, periodically called from the main daemon loop, and also when
+ * the next action is due or task schedules change.  The task schedules are
+ * only examined in the latter cases.
+ *
+ * @param[in]  fork_connection  Function that forks a child which is connected
+ *                              to the Manager.  Must return PID in parent, 0
+ *                              in child, or -1 on error.
+ * @param[in]  run_tasks        Whether to run scheduled tasks.
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ *
+ * @return 0 success, 1 failed to get lock, -1 error.
+ */
+int
+manage_schedule (manage_connection_forker_t fork_connection,
+                 gboolean run_tasks,
+                 sigset_t *sigmask_current)
+{
+  int ret;
+
+  cluster_heartbeat ();
+
+  /* Always consume the notifications, so that the socket goes quiet. */
+  if (manage_task_schedules_changed ())
+    schedule_next_due = 0;
+
+  ret = manage_update_nvti_cache ();
+  if (ret)
+    {
+      if (ret == -1)
+        {
+          g_warning ("%s: manage_update_nvti_cache error"
+                     " (Perhaps the db went down?)",
+                     __func__);
+          /* Just ignore, in case the db went down temporarily. */
+          return 0;
+        }
+
+      return ret;
+    }
+
+  if (run_tasks == 0)
+    {
+      schedule_next_due = time (NULL) + SCHEDULE_SCAN_PERIOD_MAX;
+      return 0;
+    }
+
+  if (time (NULL) >= schedule_next_due)
+    {
+      ret = manage_schedule_tasks (fork_connection, sigmask_current);
+      if (ret)
+        return ret;
+    }
+
   clear_duration_schedules (0);
   update_duration_schedule_periods (0);
 
@@ -7605,7 +8119,187 @@ get_dfn_cert_adv_filename (char *item_id)
 }
 
 /**
- * @brief Run xsltproc in an external process.
+ * @brief A compiled XSL stylesheet.
+ */
+typedef struct
+{
+  xsltStylesheetPtr stylesheet;  ///< Compiled stylesheet.
+  time_t mtime;                  ///< Modification time of stylesheet file.
+} xsl_stylesheet_t;
+
+/**
+ * @brief Compiled XSL stylesheets, keyed on file name.
+ */
+static GHashTable *xsl_stylesheets = NULL;
+
+/**
+ * @brief Security preferences for XSL transformations.
+ */
+static xsltSecurityPrefsPtr xsl_security_prefs = NULL;
+
+/**
+ * @brief Free a compiled XSL stylesheet.
+ *
+ * @param[in]  data  Stylesheet.
+ */
+static void
+xsl_stylesheet_free (gpointer data)
+{
+  xsl_stylesheet_t *cached;
+
+  cached = (xsl_stylesheet_t *) data;
+  xsltFreeStylesheet (cached->stylesheet);
+  g_free (cached);
+}
+
+/**
+ * @brief Get a compiled XSL stylesheet.
+ *
+ * Each stylesheet is compiled once per process, and again only when the
+ * file changes.
+ *
+ * @param[in]  file_name  Stylesheet file.
+ *
+ * @return Compiled stylesheet, or NULL on error.  Owned by the cache.
+ */
+static xsltStylesheetPtr
+xsl_stylesheet (const gchar *file_name)
+{
+  struct stat state;
+  xsl_stylesheet_t *cached;
+  xsltStylesheetPtr stylesheet;
+
+  if (stat (file_name, &state))
+    {
+      g_warning ("%s: failed to stat %s: %s",
+                 __func__, file_name, strerror (errno));
+      return NULL;
+    }
+
+  if (xsl_stylesheets == NULL)
+    {
+      exsltRegisterAll ();
+
+      /* Stylesheets may read the files they are given, but nothing else. */
+      xsl_security_prefs = xsltNewSecurityPrefs ();
+      xsltSetSecurityPrefs (xsl_security_prefs, XSLT_SECPREF_WRITE_FILE,
+                            xsltSecurityForbid);
+      xsltSetSecurityPrefs (xsl_security_prefs, XSLT_SECPREF_CREATE_DIRECTORY,
+                            xsltSecurityForbid);
+      xsltSetSecurityPrefs (xsl_security_prefs, XSLT_SECPREF_READ_NETWORK,
+                            xsltSecurityForbid);
+      xsltSetSecurityPrefs (xsl_security_prefs, XSLT_SECPREF_WRITE_NETWORK,
+                            xsltSecurityForbid);
+
+      xsl_stylesheets = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, xsl_stylesheet_free);
+    }
+
+  cached = g_hash_table_lookup (xsl_stylesheets, file_name);
+  if (cached && cached->mtime == state.st_mtime)
+    return cached->stylesheet;
+
+  g_debug ("%s: compiling %s", __func__, file_name);
+  stylesheet = xsltParseStylesheetFile ((const xmlChar *) file_name);
+  if (stylesheet == NULL)
+    {
+      g_warning ("%s: failed to parse stylesheet %s", __func__, file_name);
+      return NULL;
+    }
+
+  cached = g_malloc (sizeof (*cached));
+  cached->stylesheet = stylesheet;
+  cached->mtime = state.st_mtime;
+  g_hash_table_replace (xsl_stylesheets, g_strdup (file_name), cached);
+
+  return stylesheet;
+}
+
+/**
+ * @brief Apply an XSL stylesheet to an XML file.
+ *
+ * @param[in]  stylesheet        XSL stylesheet file.
+ * @param[in]  xmlfile           XML file to process.
+ * @param[in]  param_names       NULL terminated array of stringparam names
+ *                               (can be NULL).
+ * @param[in]  param_values      NULL terminated array of stringparam values
+ *                               (can be NULL).
+ * @param[out] stylesheet_return Compiled stylesheet, for saving the result.
+ *
+ * @return Result document, or NULL on error.  Free with xmlFreeDoc.
+ */
+static xmlDocPtr
+xsl_apply (const gchar *stylesheet, const gchar *xmlfile, gchar **param_names,
+           gchar **param_values, xsltStylesheetPtr *stylesheet_return)
+{
+  xsltStylesheetPtr compiled;
+  xsltTransformContextPtr context;
+  xmlDocPtr doc, result;
+  const char **params;
+  int index, param_idx;
+
+  compiled = xsl_stylesheet (stylesheet);
+  if (compiled == NULL)
+    return NULL;
+
+  doc = xmlReadFile (xmlfile, NULL, XML_PARSE_NONET | XML_PARSE_HUGE);
+  if (doc == NULL)
+    {
+      g_warning ("%s: failed to parse %s", __func__, xmlfile);
+      return NULL;
+    }
+
+  context = xsltNewTransformContext (compiled, doc);
+  if (context == NULL)
+    {
+      g_warning ("%s: failed to create transform context", __func__);
+      xmlFreeDoc (doc);
+      return NULL;
+    }
+  xsltSetCtxtSecurityPrefs (xsl_security_prefs, context);
+
+  param_idx = 0;
+  if (param_names && param_values)
+    while (param_names[param_idx] && param_values[param_idx])
+      param_idx++;
+
+  params = g_malloc ((1 + param_idx * 2) * sizeof (char *));
+  for (index = 0; index < param_idx; index++)
+    {
+      params[index * 2] = param_names[index];
+      params[index * 2 + 1] = param_values[index];
+    }
+  params[param_idx * 2] = NULL;
+
+  if (xsltQuoteUserParams (context, params))
+    {
+      g_warning ("%s: failed to set stylesheet parameters", __func__);
+      result = NULL;
+    }
+  else
+    {
+      result = xsltApplyStylesheetUser (compiled, doc, NULL, NULL, NULL,
+                                        context);
+      if (result && context->state != XSLT_STATE_OK)
+        {
+          xmlFreeDoc (result);
+          result = NULL;
+        }
+      if (result == NULL)
+        g_debug ("%s: failed to transform %s with %s",
+                 __func__, xmlfile, stylesheet);
+    }
+
+  g_free (params);
+  xsltFreeTransformContext (context);
+  xmlFreeDoc (doc);
+
+  *stylesheet_return = compiled;
+  return result;
+}
+
+/**
+ * @brief Run an XSL transformation in process.
  *
  * @param[in] stylesheet    XSL stylesheet to use.
  * @param[in] xmlfile       XML file to process.
@@ -7621,85 +8315,248 @@ static gchar *
 xsl_transform (gchar *stylesheet, gchar *xmlfile, gchar **param_names,
                gchar **param_values)
 {
-  int i, param_idx;
-  gchar **cmd, *cmd_full;
-  gint exit_status;
-  gboolean success;
-  gchar *standard_out = NULL, *standard_err = NULL;
+  xsltStylesheetPtr compiled;
+  xmlDocPtr result;
+  xmlChar *output;
+  gchar *ret;
+  int output_len;
 
-  param_idx = 0;
-  if (param_names && param_values)
-    while (param_names[param_idx] && param_values[param_idx])
-      param_idx++;
+  result = xsl_apply (stylesheet, xmlfile, param_names, param_values,
+                      &compiled);
+  if (result == NULL)
+    return NULL;
 
-  cmd = (gchar **)g_malloc ((4 + param_idx * 3) * sizeof (gchar *));
+  output = NULL;
+  output_len = 0;
+  if (xsltSaveResultToString (&output, &output_len, result, compiled))
+    {
+      g_warning ("%s: failed to save result", __func__);
+      xmlFreeDoc (result);
+      return NULL;
+    }
+  xmlFreeDoc (result);
 
-  i = 0;
-  cmd[i++] = "xsltproc";
-  if (param_idx)
+  if (output == NULL || output_len == 0)
+    /* Execution succeeded but nothing was found. */
+    ret = NULL;
+  else
+    ret = g_strndup ((gchar *) output, output_len);
+
+  xmlFree (output);
+  return ret;
+}
+
+/**
+ * @brief Run an XSL transformation in process, writing the result to a file.
+ *
+ * @param[in] stylesheet   XSL stylesheet to use.
+ * @param[in] xmlfile      XML file to process.
+ * @param[in] output_file  File to write result to.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+xsl_transform_to_file (const gchar *stylesheet, const gchar *xmlfile,
+                       const gchar *output_file)
+{
+  xsltStylesheetPtr compiled;
+  xmlDocPtr result;
+  int ret;
+
+  result = xsl_apply (stylesheet, xmlfile, NULL, NULL, &compiled);
+  if (result == NULL)
+    return -1;
+
+  ret = xsltSaveResultToFilename (output_file, result, compiled, 0);
+  xmlFreeDoc (result);
+  if (ret < 0)
     {
-      int j;
+      g_warning ("%s: failed to write %s", __func__, output_file);
+      return -1;
+    }
+  return 0;
+}
 
-      for (j = 0; j < param_idx; j++)
-        {
-          cmd[i++] = "--stringparam";
-          cmd[i++] = param_names[j];
-          cmd[i++] = param_values[j];
-        }
+/**
+ * @brief Run an XSL transformation in process, passing the result to a
+ *        writer as it is serialised.
+ *
+ * @param[in] stylesheet   XSL stylesheet to use.
+ * @param[in] xmlfile      XML file to process.
+ * @param[in] write        Function that writes a piece of the result.  Must
+ *                         return the number of bytes written, or -1 on error.
+ * @param[in] write_data   Argument for \p write.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+xsl_transform_to_stream (const gchar *stylesheet, const gchar *xmlfile,
+                         int (*write) (void *, const char *, int),
+                         void *write_data)
+{
+  xsltStylesheetPtr compiled;
+  xmlCharEncodingHandlerPtr encoder;
+  xmlOutputBufferPtr buffer;
+  const xmlChar *encoding;
+  xmlDocPtr result;
+  int ret;
+
+  result = xsl_apply (stylesheet, xmlfile, NULL, NULL, &compiled);
+  if (result == NULL)
+    return -1;
+
+  /* Encode the output like xsltSaveResultToFilename does. */
+  encoder = NULL;
+  XSLT_GET_IMPORT_PTR (encoding, compiled, encoding);
+  if (encoding)
+    {
+      encoder = xmlFindCharEncodingHandler ((const char *) encoding);
+      if (encoder
+          && xmlStrEqual ((const xmlChar *) encoder->name,
+                          (const xmlChar *) "UTF-8"))
+        encoder = NULL;
     }
-  cmd[i++] = stylesheet;
-  cmd[i++] = xmlfile;
-  cmd[i] = NULL;
-
-
-  /* DEBUG: display the final command line. */
-  cmd_full = g_strjoinv (" ", cmd);
-  g_debug ("%s: Spawning in parent dir: %s",
-           __func__, cmd_full);
-  g_free (cmd_full);
-  /* --- */
-
-  if ((g_spawn_sync (NULL,
-                     cmd,
-                     NULL,                  /* Environment. */
-                     G_SPAWN_SEARCH_PATH,
-                     NULL,                  /* Setup function. */
-                     NULL,
-                     &standard_out,
-                     &standard_err,
-                     &exit_status,
-                     NULL)
-       == FALSE)
-      || (WIFEXITED (exit_status) == 0)
-      || WEXITSTATUS (exit_status))
+
+  buffer = xmlOutputBufferCreateIO (write, NULL, write_data, encoder);
+  if (buffer == NULL)
     {
-      g_debug ("%s: failed to transform the xml: %d (WIF %i, WEX %i)",
-               __func__,
-               exit_status,
-               WIFEXITED (exit_status),
-               WEXITSTATUS (exit_status));
-      g_debug ("%s: stderr: %s", __func__, standard_err);
-      g_debug ("%s: stdout: %s", __func__, standard_out);
-      success = FALSE;
-    }
-  else if (strlen (standard_out) == 0)
-    success = FALSE; /* execution succeeded but nothing was found */
-  else
-    success = TRUE; /* execution succeeded and we have a result */
+      g_warning ("%s: failed to create output buffer", __func__);
+      xmlFreeDoc (result);
+      return -1;
+    }
 
-  /* Cleanup. */
-  g_free (cmd);
-  g_free (standard_err);
+  ret = xsltSaveResultTo (buffer, result, compiled);
+  xmlFreeDoc (result);
+  if (xmlOutputBufferClose (buffer) < 0 || ret < 0)
+    {
+      g_warning ("%s: failed to write result", __func__);
+      return -1;
+    }
+  return 0;
+}
+
+/**
+ * @brief Maximum number of bytes of NVT details in the NVT XML cache.
+ */
+#define NVT_XML_CACHE_MAX_SIZE (8 * 1024 * 1024)
 
-  if (success)
-    return standard_out;
+/**
+ * @brief Seconds between checks of the feed versions of the NVT XML cache.
+ */
+#define NVT_XML_CACHE_CHECK_PERIOD 5
 
-  g_free (standard_out);
-  return NULL;
+/**
+ * @brief NVT details in the NVT XML cache.
+ *
+ * This is the part of the detailed NVT XML that comes only from the feeds.
+ * The name and times depend on the user's timezone, and the user tags and
+ * preferences on the user and config, so they are added on every request.
+ */
+typedef struct
+{
+  gchar *oid;               ///< OID of NVT.
+  gchar *body;              ///< XML from category to tags.
+  gchar *default_timeout;   ///< Default timeout.
+  gchar *solution;          ///< Solution element.
+  gsize size;               ///< Bytes used by entry.
+  GList *link;              ///< Link in nvt_xml_cache_lru.
+} nvt_xml_cache_entry_t;
+
+/**
+ * @brief Rendered NVT details, keyed by OID.
+ */
+static GHashTable *nvt_xml_cache = NULL;
+
+/**
+ * @brief Entries of the NVT XML cache, most recently used first.
+ */
+static GQueue nvt_xml_cache_lru = G_QUEUE_INIT;
+
+/**
+ * @brief Bytes used by the entries of the NVT XML cache.
+ */
+static gsize nvt_xml_cache_size = 0;
+
+/**
+ * @brief Feed versions that the NVT XML cache was rendered from.
+ */
+static gchar *nvt_xml_cache_version = NULL;
+
+/**
+ * @brief Time of the last check of the feed versions.
+ */
+static time_t nvt_xml_cache_checked = 0;
+
+/**
+ * @brief Free an entry of the NVT XML cache.
+ *
+ * @param[in]  data  Entry.
+ */
+static void
+nvt_xml_cache_entry_free (gpointer data)
+{
+  nvt_xml_cache_entry_t *entry;
+
+  entry = (nvt_xml_cache_entry_t *) data;
+  g_free (entry->oid);
+  g_free (entry->body);
+  g_free (entry->default_timeout);
+  g_free (entry->solution);
+  g_free (entry);
+}
+
+/**
+ * @brief Remove an entry from the NVT XML cache.
+ *
+ * @param[in]  entry  Entry.
+ */
+static void
+nvt_xml_cache_remove (nvt_xml_cache_entry_t *entry)
+{
+  g_queue_delete_link (&nvt_xml_cache_lru, entry->link);
+  nvt_xml_cache_size -= entry->size;
+  g_hash_table_remove (nvt_xml_cache, entry->oid);
 }
 
 /**
- * @brief Define a code snippet for get_nvti_xml.
+ * @brief Empty the NVT XML cache if the feeds have changed.
+ *
+ * The feed versions are checked at most every NVT_XML_CACHE_CHECK_PERIOD
+ * seconds, so that a GET_NVTS with many NVTs checks only once.
+ */
+static void
+nvt_xml_cache_check ()
+{
+  gchar *version;
+  time_t now;
+
+  now = time (NULL);
+  if (nvt_xml_cache && now - nvt_xml_cache_checked < NVT_XML_CACHE_CHECK_PERIOD)
+    return;
+  nvt_xml_cache_checked = now;
+
+  version = nvt_details_version ();
+  if (nvt_xml_cache && g_strcmp0 (version, nvt_xml_cache_version) == 0)
+    {
+      g_free (version);
+      return;
+    }
+
+  if (nvt_xml_cache)
+    {
+      g_debug ("%s: feeds changed, emptying cache", __func__);
+      g_hash_table_destroy (nvt_xml_cache);
+    }
+  nvt_xml_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                         nvt_xml_cache_entry_free);
+  g_queue_clear (&nvt_xml_cache_lru);
+  nvt_xml_cache_size = 0;
+  g_free (nvt_xml_cache_version);
+  nvt_xml_cache_version = version;
+}
+
+/**
+ * @brief Define a code snippet for nvt_xml_cache_entry_new.
  *
  * @param  x  Prefix for names in snippet.
  */
@@ -7709,9 +8566,230 @@ xsl_transform (gchar *stylesheet, gchar *xmlfile, gchar **param_names,
                           ? g_markup_escape_text (x, -1)          \
                           : g_strdup ("");
 
+/**
+ * @brief Render the feed part of the detailed XML of an NVT.
+ *
+ * @param[in]  nvts  The NVT.
+ *
+ * @return Freshly allocated entry.
+ */
+static nvt_xml_cache_entry_t *
+nvt_xml_cache_entry_new (iterator_t *nvts)
+{
+  nvt_xml_cache_entry_t *entry;
+  GString *refs_str, *nvt_tags, *solution;
+  iterator_t cert_refs_iterator;
+  const char* oid = nvt_iterator_oid (nvts);
+  char *default_timeout = nvt_default_timeout (oid);
+
+  DEF (family);
+  DEF (tag);
+
+#undef DEF
+
+  nvt_tags = g_string_new (tag_text);
+  g_free (tag_text);
+
+  /* Add the elements that are expected as part of the pipe-separated tag list
+   * via API although internally already explicitly stored. Once the API is
+   * extended to have these elements explicitly, they do not need to be
+   * added to this tag string anymore. */
+  if (nvt_iterator_summary (nvts) && nvt_iterator_summary (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|summary=%s",
+                           nvt_iterator_summary (nvts));
+      else
+        xml_string_append (nvt_tags, "summary=%s",
+                           nvt_iterator_summary (nvts));
+    }
+  if (nvt_iterator_insight (nvts) && nvt_iterator_insight (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|insight=%s",
+                           nvt_iterator_insight (nvts));
+      else
+        xml_string_append (nvt_tags, "insight=%s",
+                           nvt_iterator_insight (nvts));
+    }
+  if (nvt_iterator_affected (nvts) && nvt_iterator_affected (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|affected=%s",
+                           nvt_iterator_affected (nvts));
+      else
+        xml_string_append (nvt_tags, "affected=%s",
+                           nvt_iterator_affected (nvts));
+    }
+  if (nvt_iterator_impact (nvts) && nvt_iterator_impact (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|impact=%s",
+                           nvt_iterator_impact (nvts));
+      else
+        xml_string_append (nvt_tags, "impact=%s",
+                           nvt_iterator_impact (nvts));
+    }
+  if (nvt_iterator_solution (nvts) && nvt_iterator_solution (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|solution=%s",
+                            nvt_iterator_solution (nvts));
+      else
+        xml_string_append (nvt_tags, "solution=%s",
+                           nvt_iterator_solution (nvts));
+    }
+  if (nvt_iterator_solution_type (nvts)
+      && nvt_iterator_solution_type (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|solution_type=%s",
+                           nvt_iterator_solution_type (nvts));
+      else
+        xml_string_append (nvt_tags, "solution_type=%s",
+                           nvt_iterator_solution_type (nvts));
+    }
+  if (nvt_iterator_detection (nvts) && nvt_iterator_detection (nvts)[0])
+    {
+      if (nvt_tags->str)
+        xml_string_append (nvt_tags, "|vuldetect=%s",
+                           nvt_iterator_detection (nvts));
+      else
+        xml_string_append (nvt_tags, "vuldetect=%s",
+                           nvt_iterator_detection (nvts));
+    }
+
+  refs_str = g_string_new ("");
+
+  if (manage_cert_loaded())
+    {
+      init_nvt_cert_bund_adv_iterator (&cert_refs_iterator, oid);
+      while (next (&cert_refs_iterator))
+        {
+          xml_string_append (refs_str,
+                             "<ref type=\"cert-bund\" id=\"%s\"/>",
+                             nvt_cert_bund_adv_iterator_name
+                              (&cert_refs_iterator));
+        }
+      cleanup_iterator (&cert_refs_iterator);
+
+      init_nvt_dfn_cert_adv_iterator (&cert_refs_iterator, oid);
+      while (next (&cert_refs_iterator))
+        {
+          xml_string_append (refs_str,
+                             "<ref type=\"dfn-cert\" id=\"%s\"/>",
+                             nvt_dfn_cert_adv_iterator_name
+                              (&cert_refs_iterator));
+        }
+      cleanup_iterator (&cert_refs_iterator);
+    }
+  else
+    {
+      g_string_append (refs_str,
+                       "<warning>database not available</warning>");
+    }
+
+  nvti_refs_append_xml (refs_str, oid, NULL);
+
+  entry = g_malloc0 (sizeof (nvt_xml_cache_entry_t));
+  entry->oid = g_strdup (oid);
+  entry->body = g_strdup_printf ("<category>%d</category>"
+                                 "<family>%s</family>"
+                                 "<cvss_base>%s</cvss_base>"
+                                 "<qod>"
+                                 "<value>%s</value>"
+                                 "<type>%s</type>"
+                                 "</qod>"
+                                 "<refs>%s</refs>"
+                                 "<tags>%s</tags>",
+                                 nvt_iterator_category (nvts),
+                                 family_text,
+                                 nvt_iterator_cvss_base (nvts)
+                                  ? nvt_iterator_cvss_base (nvts)
+                                  : "",
+                                 nvt_iterator_qod (nvts),
+                                 nvt_iterator_qod_type (nvts),
+                                 refs_str->str,
+                                 nvt_tags->str);
+  entry->default_timeout = g_strdup (default_timeout ? default_timeout : "");
+  g_free (family_text);
+  g_string_free (nvt_tags, 1);
+  g_string_free (refs_str, 1);
+  free (default_timeout);
+
+  solution = g_string_new ("");
+  if (nvt_iterator_solution (nvts) ||
+      nvt_iterator_solution_type (nvts) ||
+      nvt_iterator_solution_method (nvts))
+    {
+      g_string_append_printf (solution, "<solution");
+
+      if (nvt_iterator_solution_type (nvts))
+        g_string_append_printf (solution, " type='%s'",
+          nvt_iterator_solution_type (nvts));
+
+      if (nvt_iterator_solution_method (nvts))
+        g_string_append_printf (solution, " method='%s'",
+          nvt_iterator_solution_method (nvts));
+
+      if (nvt_iterator_solution (nvts))
+        g_string_append_printf (solution, ">%s</solution>",
+          nvt_iterator_solution (nvts));
+      else
+        g_string_append_printf (solution, "/>");
+    }
+  entry->solution = g_string_free (solution, FALSE);
+
+  entry->size = sizeof (*entry) + strlen (entry->oid) + strlen (entry->body)
+                + strlen (entry->default_timeout) + strlen (entry->solution);
+  return entry;
+}
+
+/**
+ * @brief Get the feed part of the detailed XML of an NVT.
+ *
+ * Renders the NVT and adds it to the cache if it is not there yet,
+ * removing the least recently used entries while the cache is too big.
+ *
+ * @param[in]  nvts  The NVT.
+ *
+ * @return Entry, owned by the cache.  Valid until the next call.
+ */
+static nvt_xml_cache_entry_t *
+nvt_xml_cache_get (iterator_t *nvts)
+{
+  nvt_xml_cache_entry_t *entry;
+
+  nvt_xml_cache_check ();
+
+  entry = g_hash_table_lookup (nvt_xml_cache, nvt_iterator_oid (nvts));
+  if (entry)
+    {
+      /* Mark the entry as recently used, for eviction. */
+      g_queue_unlink (&nvt_xml_cache_lru, entry->link);
+      g_queue_push_head_link (&nvt_xml_cache_lru, entry->link);
+      return entry;
+    }
+
+  entry = nvt_xml_cache_entry_new (nvts);
+  g_hash_table_insert (nvt_xml_cache, entry->oid, entry);
+  g_queue_push_head (&nvt_xml_cache_lru, entry);
+  entry->link = nvt_xml_cache_lru.head;
+  nvt_xml_cache_size += entry->size;
+
+  while (nvt_xml_cache_size > NVT_XML_CACHE_MAX_SIZE
+         && nvt_xml_cache_lru.tail
+         && nvt_xml_cache_lru.tail->data != entry)
+    nvt_xml_cache_remove (nvt_xml_cache_lru.tail->data);
+
+  return entry;
+}
+
 /**
  * @brief Create and return XML description for an NVT.
  *
+ * The parts of the detailed XML that come from the feeds are cached.
+ *
  * @param[in]  nvts        The NVT.
  * @param[in]  details     If true, detailed XML, else simple XML.
  * @param[in]  pref_count  Preference count.  Used if details is true.
@@ -7737,119 +8815,12 @@ get_nvti_xml (iterator_t *nvts, int details, int pref_count,
   if (details)
     {
       int tag_count;
-      GString *refs_str, *tags_str, *buffer, *nvt_tags;
-      iterator_t cert_refs_iterator, tags;
+      GString *tags_str, *buffer;
+      iterator_t tags;
       gchar *tag_name_esc, *tag_value_esc, *tag_comment_esc;
-      char *default_timeout = nvt_default_timeout (oid);
-
-      DEF (family);
-      DEF (tag);
-
-#undef DEF
-
-      nvt_tags = g_string_new (tag_text);
-      g_free (tag_text);
-
-      /* Add the elements that are expected as part of the pipe-separated tag list
-       * via API although internally already explicitly stored. Once the API is
-       * extended to have these elements explicitly, they do not need to be
-       * added to this tag string anymore. */
-      if (nvt_iterator_summary (nvts) && nvt_iterator_summary (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|summary=%s",
-                               nvt_iterator_summary (nvts));
-          else
-            xml_string_append (nvt_tags, "summary=%s",
-                               nvt_iterator_summary (nvts));
-        }
-      if (nvt_iterator_insight (nvts) && nvt_iterator_insight (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|insight=%s",
-                               nvt_iterator_insight (nvts));
-          else
-            xml_string_append (nvt_tags, "insight=%s",
-                               nvt_iterator_insight (nvts));
-        }
-      if (nvt_iterator_affected (nvts) && nvt_iterator_affected (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|affected=%s",
-                               nvt_iterator_affected (nvts));
-          else
-            xml_string_append (nvt_tags, "affected=%s",
-                               nvt_iterator_affected (nvts));
-        }
-      if (nvt_iterator_impact (nvts) && nvt_iterator_impact (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|impact=%s",
-                               nvt_iterator_impact (nvts));
-          else
-            xml_string_append (nvt_tags, "impact=%s",
-                               nvt_iterator_impact (nvts));
-        }
-      if (nvt_iterator_solution (nvts) && nvt_iterator_solution (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|solution=%s",
-                                nvt_iterator_solution (nvts));
-          else
-            xml_string_append (nvt_tags, "solution=%s",
-                               nvt_iterator_solution (nvts));
-        }
-      if (nvt_iterator_solution_type (nvts)
-          && nvt_iterator_solution_type (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|solution_type=%s",
-                               nvt_iterator_solution_type (nvts));
-          else
-            xml_string_append (nvt_tags, "solution_type=%s",
-                               nvt_iterator_solution_type (nvts));
-        }
-      if (nvt_iterator_detection (nvts) && nvt_iterator_detection (nvts)[0])
-        {
-          if (nvt_tags->str)
-            xml_string_append (nvt_tags, "|vuldetect=%s",
-                               nvt_iterator_detection (nvts));
-          else
-            xml_string_append (nvt_tags, "vuldetect=%s",
-                               nvt_iterator_detection (nvts));
-        }
-
-      refs_str = g_string_new ("");
-
-      if (manage_cert_loaded())
-        {
-          init_nvt_cert_bund_adv_iterator (&cert_refs_iterator, oid);
-          while (next (&cert_refs_iterator))
-            {
-              xml_string_append (refs_str,
-                                 "<ref type=\"cert-bund\" id=\"%s\"/>",
-                                 nvt_cert_bund_adv_iterator_name
-                                  (&cert_refs_iterator));
-            }
-          cleanup_iterator (&cert_refs_iterator);
-
-          init_nvt_dfn_cert_adv_iterator (&cert_refs_iterator, oid);
-          while (next (&cert_refs_iterator))
-            {
-              xml_string_append (refs_str,
-                                 "<ref type=\"dfn-cert\" id=\"%s\"/>",
-                                 nvt_dfn_cert_adv_iterator_name
-                                  (&cert_refs_iterator));
-            }
-          cleanup_iterator (&cert_refs_iterator);
-        }
-      else
-        {
-          g_string_append (refs_str,
-                           "<warning>database not available</warning>");
-        }
+      nvt_xml_cache_entry_t *entry;
 
-      nvti_refs_append_xml (refs_str, oid, NULL);
+      entry = nvt_xml_cache_get (nvts);
 
       tags_str = g_string_new ("");
       tag_count = resource_tag_count ("nvt",
@@ -7904,18 +8875,11 @@ get_nvti_xml (iterator_t *nvts, int details, int pref_count,
                               "<creation_time>%s</creation_time>"
                               "<modification_time>%s</modification_time>"
                               "%s" // user_tags
-                              "<category>%d</category>"
-                              "<family>%s</family>"
-                              "<cvss_base>%s</cvss_base>"
-                              "<qod>"
-                              "<value>%s</value>"
-                              "<type>%s</type>"
-                              "</qod>"
-                              "<refs>%s</refs>"
-                              "<tags>%s</tags>"
+                              "%s" // feed details
                               "<preference_count>%i</preference_count>"
                               "<timeout>%s</timeout>"
-                              "<default_timeout>%s</default_timeout>",
+                              "<default_timeout>%s</default_timeout>"
+                              "%s", // solution
                               oid,
                               name_text,
                               get_iterator_creation_time (nvts)
@@ -7925,45 +8889,13 @@ get_nvti_xml (iterator_t *nvts, int details, int pref_count,
                                ? get_iterator_modification_time (nvts)
                                : "",
                               tags_str->str,
-                              nvt_iterator_category (nvts),
-                              family_text,
-                              nvt_iterator_cvss_base (nvts)
-                               ? nvt_iterator_cvss_base (nvts)
-                               : "",
-                              nvt_iterator_qod (nvts),
-                              nvt_iterator_qod_type (nvts),
-                              refs_str->str,
-                              nvt_tags->str,
+                              entry->body,
                               pref_count,
                               timeout ? timeout : "",
-                              default_timeout ? default_timeout : "");
-      g_free (family_text);
-      g_string_free(nvt_tags, 1);
-      g_string_free(refs_str, 1);
+                              entry->default_timeout,
+                              entry->solution);
       g_string_free(tags_str, 1);
 
-      if (nvt_iterator_solution (nvts) ||
-          nvt_iterator_solution_type (nvts) ||
-          nvt_iterator_solution_method (nvts))
-        {
-          g_string_append_printf (buffer, "<solution");
-
-          if (nvt_iterator_solution_type (nvts))
-            g_string_append_printf (buffer, " type='%s'",
-              nvt_iterator_solution_type (nvts));
-
-          if (nvt_iterator_solution_method (nvts))
-            g_string_append_printf (buffer, " method='%s'",
-              nvt_iterator_solution_method (nvts));
-
-          if (nvt_iterator_solution (nvts))
-            g_string_append_printf (buffer, ">%s</solution>",
-              nvt_iterator_solution (nvts));
-          else
-            g_string_append_printf (buffer, "/>");
-        }
-
-
       if (preferences)
         {
           iterator_t prefs;
@@ -7976,7 +8908,7 @@ get_nvti_xml (iterator_t *nvts, int details, int pref_count,
                              "<timeout>%s</timeout>"
                              "<default_timeout>%s</default_timeout>",
                              timeout ? timeout : "",
-                             default_timeout ? default_timeout : "");
+                             entry->default_timeout);
 
           init_nvt_preference_iterator (&prefs, nvt_oid);
           while (next (&prefs))
@@ -7988,7 +8920,6 @@ get_nvti_xml (iterator_t *nvts, int details, int pref_count,
 
       xml_string_append (buffer, close_tag ? "</nvt>" : "");
       msg = g_string_free (buffer, FALSE);
-      free (default_timeout);
     }
   else
     {
@@ -8082,6 +9013,12 @@ manage_read_info (gchar *type, gchar *uid, gchar *name, gchar **result)
 
   if (g_ascii_strcasecmp ("CPE", type) == 0)
     {
+      /* The XML is stored at sync time.  Fall back to the feed file for
+       * CPEs that were loaded without it. */
+      *result = cpe_details_xml (name);
+      if (*result)
+        return 1;
+
       fname = get_cpe_filename ();
       if (fname)
         {
@@ -8094,6 +9031,10 @@ manage_read_info (gchar *type, gchar *uid, gchar *name, gchar **result)
     }
   else if (g_ascii_strcasecmp ("CVE", type) == 0)
     {
+      *result = cve_details_xml (name);
+      if (*result)
+        return 1;
+
       fname = get_cve_filename (uid);
       if (fname)
         {
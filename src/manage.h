@@ -125,6 +125,9 @@ init_manage_process (const gchar*);
 void
 cleanup_manage_process (gboolean);
 
+void
+reset_manage_process ();
+
 void
 manage_cleanup_process_error (int);
 
@@ -148,6 +151,53 @@ typedef struct
  */
 extern command_t gmp_commands[];
 
+/**
+ * @brief Statistics of a GMP command type.
+ */
+typedef struct
+{
+  int count;                 ///< Number of commands.
+  double wall_time;          ///< Wall clock time in seconds.
+  double cpu_time;           ///< CPU time in seconds.
+  long long sql_count;       ///< Number of SQL statements.
+  double sql_time;           ///< Time in SQL statements in seconds.
+  long long sql_rows;        ///< Number of rows returned by SQL statements.
+  unsigned long long bytes;  ///< Number of bytes sent to the client.
+} command_stats_t;
+
+void
+manage_sql_stats (long long *, double *, long long *);
+
+void
+set_slow_query_log (int, int);
+
+void
+set_read_replica (const char *, int);
+
+void
+manage_read_replica_begin (const char *);
+
+void
+manage_read_replica_end ();
+
+int
+set_command_timeouts (const char *);
+
+void
+manage_command_timeout_begin (const char *, void (*) ());
+
+void
+manage_command_timeout_end ();
+
+void
+manage_command_stats_add (const char *, const command_stats_t *);
+
+void
+manage_lock_stats_flush ();
+
+int
+manage_get_gmp_stats (GSList *, const gchar *);
+
 
 /* Certificate and key management. */
 
@@ -189,6 +239,15 @@ extern credentials_t current_credentials;
 int
 authenticate (credentials_t*);
 
+int
+authenticate_token (credentials_t *, const char *);
+
+gchar *
+auth_token_new (credentials_t *);
+
+void
+set_auth_token_lifetime (int);
+
 
 /* Database. */
 
@@ -220,7 +279,7 @@ char *
 manage_port_name (int, const char *);
 
 int
-manage_migrate (GSList*, const gchar*);
+manage_migrate (GSList*, const gchar*, int);
 
 int
 manage_encrypt_all_credentials (GSList *, const gchar *);
@@ -334,6 +393,63 @@ typedef long long int scanner_t;
 typedef long long int setting_t;
 typedef long long int user_t;
 
+
+/* Process registry. */
+
+void
+manage_process_register (const char *, task_t, report_t);
+
+void
+manage_process_set_work (task_t, report_t);
+
+void
+manage_process_update ();
+
+void
+manage_process_tick ();
+
+void
+manage_process_unregister ();
+
+void
+init_process_iterator (iterator_t *);
+
+int
+process_iterator_pid (iterator_t *);
+
+const char *
+process_iterator_role (iterator_t *);
+
+const char *
+process_iterator_task_id (iterator_t *);
+
+const char *
+process_iterator_report_id (iterator_t *);
+
+time_t
+process_iterator_start_time (iterator_t *);
+
+long long
+process_iterator_rss (iterator_t *);
+
+long long
+process_iterator_peak_rss (iterator_t *);
+
+double
+process_iterator_cpu_time (iterator_t *);
+
+long long
+process_iterator_sql_count (iterator_t *);
+
+double
+process_iterator_sql_time (iterator_t *);
+
+time_t
+process_iterator_update_time (iterator_t *);
+
+const char *
+process_iterator_node (iterator_t *);
+
 
 /* GMP GET. */
 
@@ -632,6 +748,20 @@ manage_alert (const char *, const char *, event_t, const void*, gchar **);
 int
 manage_test_alert (const char *, gchar **);
 
+/**
+ * @brief Default number of processes that run queued alerts.
+ */
+#define ALERT_WORKERS_DEFAULT 0
+
+int
+manage_alert_queue_depth (int *);
+
+void
+manage_dispatch_alerts (sigset_t *);
+
+void
+set_alert_workers (int);
+
 int
 alert_in_use (alert_t);
 
@@ -1166,9 +1296,119 @@ result_detection_reference (result_t, report_t, const char *, const char *,
  */
 #define MIN_QOD_DEFAULT 70
 
+/**
+ * @brief Default maximum number of report count caches rebuilt per second.
+ */
+#define COUNT_CACHE_REBUILD_RATE_DEFAULT 10
+
+/**
+ * @brief Default for the number of results per batch of a streamed report
+ *        upload, 0 to import uploads only once they are complete.
+ */
+#define REPORT_IMPORT_BATCH_SIZE_DEFAULT 0
+
+/**
+ * @brief Default for the seconds that an authentication token is valid, 0 to
+ *        issue no tokens.
+ */
+#define AUTH_TOKEN_LIFETIME_DEFAULT 0
+
+/**
+ * @brief Default for the milliseconds after which an SQL statement is logged
+ *        as slow, 0 to never log statements as slow.
+ */
+#define SLOW_QUERY_THRESHOLD_DEFAULT 0
+
+/**
+ * @brief Default for the seconds that the read replica may lag behind the
+ *        primary.
+ */
+#define READ_REPLICA_MAX_LAG_DEFAULT 5
+
+/**
+ * @brief Default maximum size of the rendered report cache in MiB.
+ */
+#define REPORT_CACHE_SIZE_DEFAULT 0
+
 void
 reports_clear_count_cache (int);
 
+int
+manage_count_cache_queue_depth ();
+
+void
+manage_rebuild_count_caches (sigset_t *);
+
+int
+manage_report_deletion_queue_depth ();
+
+void
+manage_delete_queued_reports (sigset_t *);
+
+void
+manage_run_migration_steps (sigset_t *);
+
+void
+manage_extend_results_partitions ();
+
+void
+manage_supervise_osp_scans (sigset_t *);
+
+void
+set_osp_scan_supervisor (int);
+
+void
+set_cluster_node (const gchar *);
+
+/**
+ * @brief Feeds whose updates a cluster serialises.
+ */
+typedef enum
+{
+  CLUSTER_FEED_NVT,
+  CLUSTER_FEED_SCAP,
+  CLUSTER_FEED_CERT
+} cluster_feed_t;
+
+int
+cluster_feed_lock (cluster_feed_t);
+
+void
+cluster_heartbeat ();
+
+void
+osp_scan_queue_add (task_t, report_t);
+
+void
+osp_scan_queue_remove (task_t);
+
+void
+osp_scan_queue_set_started (task_t);
+
+int
+osp_scan_queue_depth ();
+
+void
+init_osp_scan_queue_iterator (iterator_t *);
+
+task_t
+osp_scan_queue_iterator_task (iterator_t *);
+
+report_t
+osp_scan_queue_iterator_report (iterator_t *);
+
+const char *
+osp_scan_queue_iterator_owner_uuid (iterator_t *);
+
+int
+osp_scan_queue_iterator_started (iterator_t *);
+
+void
+set_count_cache_rebuild_rate (int);
+
+void
+set_report_cache_size (int);
+
 void
 reports_clear_count_cache_for_override (override_t, int);
 
@@ -1205,9 +1445,6 @@ result_t
 make_osp_result (task_t, const char*, const char*, const char*, const char*,
                  const char *, const char *, const char *, int);
 
-result_t
-make_cve_result (task_t, const char*, const char*, double, const char*);
-
 /**
  * @brief A CREATE_REPORT result.
  */
@@ -1265,7 +1502,23 @@ update_duration_schedule_periods (task_t);
 
 int
 create_report (array_t*, const char *, const char *, const char *, const char *,
-               array_t*, array_t*, array_t*, char **);
+               array_t*, array_t*, array_t*, report_t, int, char **);
+
+int
+create_report_stream_start (const char *, const char *, const char *, int,
+                            report_t *, char **);
+
+int
+create_report_stream_results (report_t, array_t *, int);
+
+void
+create_report_stream_abort (report_t);
+
+int
+report_import_batch_size ();
+
+void
+set_report_import_batch_size (int);
 
 void
 report_add_result (report_t, result_t);
@@ -1512,6 +1765,9 @@ result_iterator_cert_bunds (iterator_t*);
 gchar **
 result_iterator_dfn_certs (iterator_t*);
 
+const char*
+result_iterator_fingerprint (iterator_t*);
+
 int
 cleanup_result_nvts ();
 
@@ -1560,23 +1816,22 @@ manage_send_report (report_t, report_t, report_format_t, const get_data_t *,
 
 /* Reports. */
 
-gchar *
-app_location (report_host_t, const gchar *);
-
-void
-init_host_prognosis_iterator (iterator_t*, report_host_t);
+/**
+ * @brief A CVE scan.
+ */
+typedef struct cve_scan cve_scan_t;
 
-double
-prognosis_iterator_cvss_double (iterator_t*);
+cve_scan_t *
+cve_scan_new (task_t, report_t);
 
-const char*
-prognosis_iterator_cpe (iterator_t*);
+void
+cve_scan_free (cve_scan_t *);
 
-const char*
-prognosis_iterator_cve (iterator_t*);
+void
+cve_scan_add_host (cve_scan_t *, const char *, report_host_t);
 
-const char*
-prognosis_iterator_description (iterator_t*);
+int
+cve_scan_run (cve_scan_t *);
 
 
 /* Targets. */
@@ -1725,6 +1980,9 @@ target_hosts (target_t);
 char*
 target_exclude_hosts (target_t);
 
+int
+target_max_hosts (target_t);
+
 char*
 target_reverse_lookup_only (target_t);
 
@@ -1866,6 +2124,12 @@ config_iterator_usage_type (iterator_t*);
 char*
 config_nvt_selector (config_t);
 
+gchar *
+config_vts_bundle (config_t, gchar **);
+
+void
+config_vts_bundle_set (config_t, const gchar *, const gchar *);
+
 int
 config_in_use (config_t);
 
@@ -1956,6 +2220,9 @@ nvt_name (const char *);
 char*
 nvts_feed_version ();
 
+char*
+nvt_details_version ();
+
 time_t
 nvts_feed_version_epoch ();
 
@@ -2079,6 +2346,9 @@ nvt_selector_family_count (const char*, int);
 int
 nvt_selector_nvt_count (const char *, const char *, int);
 
+int
+nvt_selector_family_counts (const char *, const char *, int *, int *, int *);
+
 void
 init_nvt_selector_iterator (iterator_t*, const char*, config_t, int);
 
@@ -2256,6 +2526,9 @@ credential_iterator_deb (iterator_t*);
 char*
 credential_iterator_exe (iterator_t*);
 
+void
+credential_prebuild_packages (credential_t);
+
 const char*
 credential_iterator_certificate (iterator_t*);
 
@@ -2378,6 +2651,36 @@ asset_host_iterator_severity (iterator_t *);
 int
 asset_host_count (const get_data_t *);
 
+int
+init_host_trend_iterator (iterator_t *, const char *, int);
+
+time_t
+host_trend_iterator_day (iterator_t *);
+
+int
+host_trend_iterator_hosts (iterator_t *);
+
+double
+host_trend_iterator_max_severity (iterator_t *);
+
+int
+host_trend_iterator_high (iterator_t *);
+
+int
+host_trend_iterator_medium (iterator_t *);
+
+int
+host_trend_iterator_low (iterator_t *);
+
+int
+host_trend_iterator_log (iterator_t *);
+
+int
+host_trend_iterator_open (iterator_t *);
+
+int
+host_trend_iterator_closed (iterator_t *);
+
 int
 init_asset_os_iterator (iterator_t *, const get_data_t *);
 
@@ -2622,6 +2925,16 @@ int
 manage_system_report (const char *, const char *, const char *, const char *,
                       const char *, char **);
 
+
+/* XSL transformation. */
+
+int
+xsl_transform_to_file (const gchar *, const gchar *, const gchar *);
+
+int
+xsl_transform_to_stream (const gchar *, const gchar *,
+                         int (*) (void *, const char *, int), void *);
+
 
 /* Scanners. */
 
@@ -2797,6 +3110,17 @@ osp_connect_with_data (const char *,
 osp_connection_t *
 osp_scanner_connect (scanner_t);
 
+void
+osp_scanner_disconnect (osp_connection_t *);
+
+/**
+ * @brief Default maximum number of connections to each OSP scanner.
+ */
+#define OSP_CONNECTIONS_DEFAULT 10
+
+void
+set_osp_connections (int);
+
 int
 verify_scanner (const char *, char **);
 
@@ -2837,6 +3161,14 @@ slave_relay_connection (gvm_connection_t *, gvm_connection_t *);
  */
 #define SCHEDULE_PERIOD 10
 
+/**
+ * @brief Maximum seconds between looks at the task schedules.
+ *
+ * Normally manage_schedule only looks when an action is due or a schedule
+ * has changed.
+ */
+#define SCHEDULE_SCAN_PERIOD_MAX 300
+
 /**
  * @brief Minimum schedule timeout seconds.
  * This value must be greater than SCHEDULE_PERIOD.
@@ -2879,6 +3211,12 @@ manage_schedule (manage_connection_forker_t,
                  gboolean,
                  sigset_t *);
 
+time_t
+manage_schedule_next_due ();
+
+int
+manage_schedule_socket ();
+
 char *
 schedule_uuid (schedule_t);
 
@@ -3334,6 +3672,9 @@ cpe_info_iterator_cve_refs (iterator_t*);
 const char*
 cpe_info_iterator_nvd_id (iterator_t*);
 
+gchar *
+cpe_details_xml (const gchar *);
+
 /* CVE. */
 
 const char*
@@ -3378,6 +3719,9 @@ cve_info_count (const get_data_t *get);
 gchar *
 cve_cvss_base (const gchar *);
 
+gchar *
+cve_details_xml (const gchar *);
+
 /* OVAL definitions */
 int
 init_ovaldef_info_iterator (iterator_t*, get_data_t*, const char*);
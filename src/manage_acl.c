@@ -40,6 +40,133 @@
  */
 #define G_LOG_DOMAIN "md manage"
 
+/**
+ * @brief Maximum number of entries in the ACL cache.
+ *
+ * The cache is emptied when it grows beyond this.
+ */
+#define ACL_CACHE_MAX 10000
+
+/**
+ * @brief Results of ACL checks in the current GMP command.
+ *
+ * Keys are built by acl_cache_key, values are the check result plus one.
+ */
+static GHashTable *acl_cache = NULL;
+
+/**
+ * @brief Number of ACL checks answered from the cache.
+ */
+static int acl_cache_hits = 0;
+
+/**
+ * @brief Number of ACL checks that had to query the database.
+ */
+static int acl_cache_misses = 0;
+
+/**
+ * @brief Empty the ACL cache.
+ *
+ * Called at the start of every GMP command and whenever permissions,
+ * roles or groups change, so that cached results never outlive the
+ * permissions they were computed from.
+ */
+void
+acl_cache_reset ()
+{
+  if (acl_cache_hits || acl_cache_misses)
+    g_debug ("%s: %i hits, %i misses", __func__, acl_cache_hits,
+             acl_cache_misses);
+  acl_cache_hits = 0;
+  acl_cache_misses = 0;
+  if (acl_cache)
+    g_hash_table_remove_all (acl_cache);
+}
+
+/**
+ * @brief Get the hit and miss counts of the ACL cache.
+ *
+ * The counts cover the checks since the last acl_cache_reset.
+ *
+ * @param[out]  hits    Number of checks answered from the cache.
+ * @param[out]  misses  Number of checks that queried the database.
+ */
+void
+acl_cache_counts (int *hits, int *misses)
+{
+  if (hits)
+    *hits = acl_cache_hits;
+  if (misses)
+    *misses = acl_cache_misses;
+}
+
+/**
+ * @brief Build a key for the ACL cache.
+ *
+ * The key includes the current user, so that switching users does not
+ * need a reset.
+ *
+ * @param[in]  check   Name of the check.
+ * @param[in]  type    Resource type, or NULL.
+ * @param[in]  arg     Argument of the check, like a UUID, or NULL.
+ * @param[in]  number  Numeric argument of the check.
+ *
+ * @return Freshly allocated key.
+ */
+static gchar *
+acl_cache_key (const char *check, const char *type, const char *arg,
+               long long int number)
+{
+  return g_strdup_printf ("%s\x1f%s\x1f%s\x1f%s\x1f%lli",
+                          check,
+                          current_credentials.uuid
+                           ? current_credentials.uuid : "",
+                          type ? type : "",
+                          arg ? arg : "",
+                          number);
+}
+
+/**
+ * @brief Look up an ACL check in the cache.
+ *
+ * @param[in]   key  Key from acl_cache_key.
+ * @param[out]  ret  Cached result on success.
+ *
+ * @return 1 if found, else 0.
+ */
+static int
+acl_cache_lookup (const gchar *key, int *ret)
+{
+  gpointer value;
+
+  if (acl_cache
+      && (value = g_hash_table_lookup (acl_cache, key)))
+    {
+      acl_cache_hits++;
+      *ret = GPOINTER_TO_INT (value) - 1;
+      return 1;
+    }
+  acl_cache_misses++;
+  return 0;
+}
+
+/**
+ * @brief Add the result of an ACL check to the cache.
+ *
+ * @param[in]  key  Key from acl_cache_key.  Freed or taken over.
+ * @param[in]  ret  Result of check.
+ */
+static void
+acl_cache_add (gchar *key, int ret)
+{
+  if (acl_cache == NULL)
+    acl_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       NULL);
+  else if (g_hash_table_size (acl_cache) >= ACL_CACHE_MAX)
+    g_hash_table_remove_all (acl_cache);
+  g_hash_table_replace (acl_cache, key, GINT_TO_POINTER (ret + 1));
+}
+
 /**
  * @brief Test whether the current user may perform an operation.
  *
@@ -137,15 +264,28 @@ acl_commands (gchar **disabled_commands)
 int
 acl_user_may (const char *operation)
 {
+  gchar *key;
+  int ret;
+
   if (strlen (current_credentials.uuid) == 0)
     /* Allow the dummy user in init_manage to do anything. */
     return 1;
 
+  key = acl_cache_key ("may", NULL, operation, 0);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
+
   if (sql_int ("SELECT user_can_everything ('%s');",
                current_credentials.uuid))
-    return 1;
+    ret = 1;
+  else
+    ret = user_may_internal (operation);
 
-  return user_may_internal (operation);
+  acl_cache_add (key, ret);
+  return ret;
 }
 
 /**
@@ -360,7 +500,14 @@ int
 acl_user_is_admin (const char *uuid)
 {
   int ret;
-  gchar *quoted_uuid;
+  gchar *quoted_uuid, *key;
+
+  key = acl_cache_key ("is_admin", NULL, uuid, 0);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
 
   quoted_uuid = sql_quote (uuid);
   ret = sql_int ("SELECT count (*) FROM role_users"
@@ -369,6 +516,7 @@ acl_user_is_admin (const char *uuid)
                  " AND \"user\" = (SELECT id FROM users WHERE uuid = '%s');",
                  quoted_uuid);
   g_free (quoted_uuid);
+  acl_cache_add (key, ret);
   return ret;
 }
 
@@ -383,7 +531,14 @@ int
 acl_user_is_observer (const char *uuid)
 {
   int ret;
-  gchar *quoted_uuid;
+  gchar *quoted_uuid, *key;
+
+  key = acl_cache_key ("is_observer", NULL, uuid, 0);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
 
   quoted_uuid = sql_quote (uuid);
   ret = sql_int ("SELECT count (*) FROM role_users"
@@ -392,6 +547,7 @@ acl_user_is_observer (const char *uuid)
                  " AND \"user\" = (SELECT id FROM users WHERE uuid = '%s');",
                  quoted_uuid);
   g_free (quoted_uuid);
+  acl_cache_add (key, ret);
   return ret;
 }
 
@@ -406,7 +562,14 @@ int
 acl_user_is_super_admin (const char *uuid)
 {
   int ret;
-  gchar *quoted_uuid;
+  gchar *quoted_uuid, *key;
+
+  key = acl_cache_key ("is_super_admin", NULL, uuid, 0);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
 
   quoted_uuid = sql_quote (uuid);
   ret = sql_int ("SELECT count (*) FROM role_users"
@@ -415,6 +578,7 @@ acl_user_is_super_admin (const char *uuid)
                  " AND \"user\" = (SELECT id FROM users WHERE uuid = '%s');",
                  quoted_uuid);
   g_free (quoted_uuid);
+  acl_cache_add (key, ret);
   return ret;
 }
 
@@ -429,7 +593,14 @@ int
 acl_user_is_user (const char *uuid)
 {
   int ret;
-  gchar *quoted_uuid;
+  gchar *quoted_uuid, *key;
+
+  key = acl_cache_key ("is_user", NULL, uuid, 0);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
 
   quoted_uuid = sql_quote (uuid);
   ret = sql_int ("SELECT count (*) FROM role_users"
@@ -438,6 +609,7 @@ acl_user_is_user (const char *uuid)
                  " AND \"user\" = (SELECT id FROM users WHERE uuid = '%s');",
                  quoted_uuid);
   g_free (quoted_uuid);
+  acl_cache_add (key, ret);
   return ret;
 }
 
@@ -624,8 +796,8 @@ acl_user_is_owner (const char *type, const char *uuid)
  *
  * @return 1 if user owns resource, else 0.
  */
-int
-acl_user_owns_uuid (const char *type, const char *uuid, int trash)
+static int
+user_owns_uuid_internal (const char *type, const char *uuid, int trash)
 {
   int ret;
   gchar *quoted_uuid;
@@ -686,6 +858,36 @@ acl_user_owns_uuid (const char *type, const char *uuid, int trash)
   return ret;
 }
 
+/**
+ * @brief Test whether a user effectively owns a resource.
+ *
+ * A Super permissions can give a user effective ownership of another
+ * user's resource.
+ *
+ * @param[in]  type  Type of resource, for example "task".
+ * @param[in]  uuid      UUID of resource.
+ * @param[in]  trash     Whether the resource is in the trash.
+ *
+ * @return 1 if user owns resource, else 0.
+ */
+int
+acl_user_owns_uuid (const char *type, const char *uuid, int trash)
+{
+  gchar *key;
+  int ret;
+
+  key = acl_cache_key ("owns_uuid", type, uuid, trash);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
+
+  ret = user_owns_uuid_internal (type, uuid, trash);
+  acl_cache_add (key, ret);
+  return ret;
+}
+
 /**
  * @brief Test whether a user effectively owns a resource.
  *
@@ -701,6 +903,7 @@ acl_user_owns_uuid (const char *type, const char *uuid, int trash)
 int
 acl_user_owns (const char *type, resource_t resource, int trash)
 {
+  gchar *key;
   int ret;
 
   assert (current_credentials.uuid);
@@ -713,8 +916,18 @@ acl_user_owns (const char *type, resource_t resource, int trash)
       || (strcmp (type, "dfn_cert_adv") == 0))
     return 1;
 
+  key = acl_cache_key ("owns", type, NULL, resource * 2 + (trash ? 1 : 0));
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
+
   if (acl_user_has_super_on_resource (type, "id", resource, trash))
-    return 1;
+    {
+      acl_cache_add (key, 1);
+      return 1;
+    }
 
   if (strcmp (type, "result") == 0)
     ret = sql_int ("SELECT count(*) FROM results, reports"
@@ -738,6 +951,7 @@ acl_user_owns (const char *type, resource_t resource, int trash)
                      : (trash ? " AND hidden = 2" : " AND hidden < 2")),
                    current_credentials.uuid);
 
+  acl_cache_add (key, ret);
   return ret;
 }
 
@@ -787,9 +1001,9 @@ acl_user_owns_trash_uuid (const char *type, const char *uuid)
  *
  * @return 1 if user may access resource, else 0.
  */
-int
-acl_user_has_access_uuid (const char *type, const char *uuid,
-                          const char *permission, int trash)
+static int
+user_has_access_uuid_internal (const char *type, const char *uuid,
+                               const char *permission, int trash)
 {
   int ret, get;
   char *uuid_task;
@@ -962,6 +1176,39 @@ acl_user_has_access_uuid (const char *type, const char *uuid,
   return ret;
 }
 
+/**
+ * @brief Test whether the user may access a resource.
+ *
+ * @param[in]  type      Type of resource, for example "task".
+ * @param[in]  uuid      UUID of resource.
+ * @param[in]  permission       Permission.
+ * @param[in]  trash            Whether the resource is in the trash.
+ *
+ * @return 1 if user may access resource, else 0.
+ */
+int
+acl_user_has_access_uuid (const char *type, const char *uuid,
+                          const char *permission, int trash)
+{
+  gchar *key, *check;
+  int ret;
+
+  assert (current_credentials.uuid);
+
+  check = g_strdup_printf ("has_access\x1f%s", permission ? permission : "");
+  key = acl_cache_key (check, type, uuid, trash);
+  g_free (check);
+  if (acl_cache_lookup (key, &ret))
+    {
+      g_free (key);
+      return ret;
+    }
+
+  ret = user_has_access_uuid_internal (type, uuid, permission, trash);
+  acl_cache_add (key, ret);
+  return ret;
+}
+
 /**
  * @brief Generate the ownership part of an SQL WHERE clause for a given user.
  *
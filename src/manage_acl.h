@@ -98,6 +98,12 @@
   "  OR (owner = (SELECT users.id FROM users"                  \
   "               WHERE users.uuid = '%s')))"
 
+void
+acl_cache_reset ();
+
+void
+acl_cache_counts (int *, int *);
+
 command_t *
 acl_commands (gchar **);
 
@@ -160,8 +160,53 @@ typedef struct
   int (*function) (); ///< Function that does the migration.  NULL if too hard.
 } migrator_t;
 
+/**
+ * @brief A migration step that runs in the background, after the migration.
+ *
+ * Used for large data rewrites.  The step goes through the table in batches
+ * of rows, each in its own transaction, and records the last ID done in the
+ * meta table, so that it can resume after an interruption.
+ */
+typedef struct
+{
+  const char *name;   ///< Name of step.
+  const char *table;  ///< Table that the step goes through.
+  void (*function) (resource_t, resource_t); ///< Migrates IDs (from, to].
+  int batch_size;     ///< IDs per transaction, 0 for the default.
+} migration_step_t;
+
 /* Functions. */
 
+/**
+ * @brief Prefix of meta names of queued migration steps.
+ */
+#define MIGRATION_STEP_PREFIX "migration_step:"
+
+/**
+ * @brief Prefix of meta names of queued index creations.
+ */
+#define MIGRATION_INDEX_PREFIX "migration_index:"
+
+/**
+ * @brief Default number of rows per transaction of a background migration
+ *        step.
+ */
+#define MIGRATION_STEP_BATCH_SIZE 10000
+
+/**
+ * @brief Queue a background migration step.
+ *
+ * @param[in]  name  Name of step, from migration_steps.
+ */
+static void
+migration_step_queue (const char *name)
+{
+  sql ("INSERT INTO meta (name, value)"
+       " VALUES ('" MIGRATION_STEP_PREFIX "%s', '0')"
+       " ON CONFLICT (name) DO NOTHING;",
+       name);
+}
+
 /** @todo May be better ensure a ROLLBACK when functions like "sql" fail.
  *
  * Currently the SQL functions abort on failure.  This a general problem,
@@ -1792,8 +1837,787 @@ migrate_224_to_225 ()
   return 0;
 }
 
+/**
+ * @brief Migrate the database from version 225 to version 226.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_225_to_226 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 225. */
+
+  if (manage_db_version () != 225)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Results got a fingerprint for delta reports.  New results get it from
+   * a trigger that create_tables adds. */
+
+  sql ("ALTER TABLE results ADD COLUMN fingerprint text;");
+  sql ("ALTER TABLE results_trash ADD COLUMN fingerprint text;");
+
+  /* Filling in the fingerprints of existing results rewrites the whole
+   * results table, so leave it to the background migration steps.  Until
+   * then readers fall back to hashing the description. */
+
+  migration_step_queue ("results_fingerprint");
+  migration_step_queue ("results_trash_fingerprint");
+
+  /* Set the database version to 226. */
+
+  set_db_version (226);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 226 to version 227.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_226_to_227 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 226. */
+
+  if (manage_db_version () != 226)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Long result descriptions moved to result_descriptions, which
+   * create_tables adds with the trigger that moves them.  Moving the
+   * descriptions of existing results rewrites the results table, so leave
+   * it to the background migration steps. */
+
+  migration_step_queue ("results_descriptions");
+
+  /* Set the database version to 227. */
+
+  set_db_version (227);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 227 to version 228.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_227_to_228 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 227. */
+
+  if (manage_db_version () != 227)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Report hosts got a binary sort key.  New hosts get it from a trigger
+   * that create_tables adds. */
+
+  sql ("ALTER TABLE report_hosts ADD COLUMN host_order bytea;");
+  sql ("UPDATE report_hosts SET host_order = host_order_key (host);");
+
+  /* Set the database version to 228. */
+
+  set_db_version (228);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 228 to version 229.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_228_to_229 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 228. */
+
+  if (manage_db_version () != 228)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Result NVTs got counts of the notes, overrides and tickets on each NVT.
+   * Triggers that create_tables adds keep the counts from now on. */
+
+  sql ("ALTER TABLE result_nvts ADD COLUMN notes integer DEFAULT 0;");
+  sql ("ALTER TABLE result_nvts ADD COLUMN overrides integer DEFAULT 0;");
+  sql ("ALTER TABLE result_nvts ADD COLUMN tickets integer DEFAULT 0;");
+
+  sql ("INSERT INTO result_nvts (nvt)"
+       " SELECT nvt FROM notes"
+       " UNION SELECT nvt FROM overrides"
+       " UNION SELECT nvt FROM tickets WHERE nvt IS NOT NULL"
+       " ON CONFLICT (nvt) DO NOTHING;");
+
+  sql ("UPDATE result_nvts"
+       " SET notes = (SELECT count (*) FROM notes"
+       "              WHERE notes.nvt = result_nvts.nvt),"
+       "     overrides = (SELECT count (*) FROM overrides"
+       "                  WHERE overrides.nvt = result_nvts.nvt),"
+       "     tickets = (SELECT count (*) FROM tickets"
+       "                WHERE tickets.nvt = result_nvts.nvt);");
+
+  /* Set the database version to 229. */
+
+  set_db_version (229);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 229 to version 230.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_229_to_230 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 229. */
+
+  if (manage_db_version () != 229)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Port lists got their merged port range and port counts.  These are
+   * filled in by check_db_port_lists, which fills in any that are NULL. */
+
+  sql ("ALTER TABLE port_lists ADD COLUMN port_range text;");
+  sql ("ALTER TABLE port_lists ADD COLUMN port_count_all integer;");
+  sql ("ALTER TABLE port_lists ADD COLUMN port_count_tcp integer;");
+  sql ("ALTER TABLE port_lists ADD COLUMN port_count_udp integer;");
+
+  sql ("ALTER TABLE port_lists_trash ADD COLUMN port_range text;");
+  sql ("ALTER TABLE port_lists_trash ADD COLUMN port_count_all integer;");
+  sql ("ALTER TABLE port_lists_trash ADD COLUMN port_count_tcp integer;");
+  sql ("ALTER TABLE port_lists_trash ADD COLUMN port_count_udp integer;");
+
+  /* Set the database version to 230. */
+
+  set_db_version (230);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 230 to version 231.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_230_to_231 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 230. */
+
+  if (manage_db_version () != 230)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Supervised OSP scans got the cluster node that polls them.  The
+   * cluster_nodes table is added by create_tables. */
+
+  sql ("ALTER TABLE IF EXISTS osp_scans ADD COLUMN IF NOT EXISTS node text;");
+
+  /* Set the database version to 231. */
+
+  set_db_version (231);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 231 to version 232.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_231_to_232 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 231. */
+
+  if (manage_db_version () != 231)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Aggregate rollups got an owner, for the rollups of assets. */
+
+  sql ("ALTER TABLE IF EXISTS aggregate_rollups"
+       " ADD COLUMN IF NOT EXISTS owner integer;");
+
+  /* Set the database version to 232. */
+
+  set_db_version (232);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 232 to version 233.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_232_to_233 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 232. */
+
+  if (manage_db_version () != 232)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Cached result severities got the override and dynamic settings.  The
+   * existing entries are all for overrides without dynamic severity. */
+
+  sql ("ALTER TABLE IF EXISTS result_severities"
+       " ADD COLUMN IF NOT EXISTS override integer DEFAULT 1;");
+  sql ("ALTER TABLE IF EXISTS result_severities"
+       " ADD COLUMN IF NOT EXISTS dynamic integer DEFAULT 0;");
+  sql ("ALTER TABLE IF EXISTS result_severities"
+       " ALTER COLUMN override DROP DEFAULT;");
+  sql ("ALTER TABLE IF EXISTS result_severities"
+       " ALTER COLUMN dynamic DROP DEFAULT;");
+  sql ("DROP INDEX IF EXISTS result_severities_by_result_and_user;");
+
+  /* Set the database version to 233. */
+
+  set_db_version (233);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 233 to version 234.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_233_to_234 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 233. */
+
+  if (manage_db_version () != 233)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Users got a generation for revoking their authentication tokens. */
+
+  sql ("ALTER TABLE IF EXISTS users"
+       " ADD COLUMN IF NOT EXISTS auth_token_generation integer DEFAULT 0;");
+
+  /* Set the database version to 234. */
+
+  set_db_version (234);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 234 to version 235.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_234_to_235 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 234. */
+
+  if (manage_db_version () != 234)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* The process registry is keyed on PID and cluster node, without a serial
+   * ID.  The rows only describe running processes, so drop the table and
+   * let create_tables add it again. */
+
+  sql ("DROP TABLE IF EXISTS processes;");
+
+  /* Set the database version to 235. */
+
+  set_db_version (235);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 235 to version 236.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_235_to_236 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 235. */
+
+  if (manage_db_version () != 235)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* The host trends only had the scans that finished after they were
+   * added.  Adding the earlier scans goes through all their results, so
+   * leave it to the background migration steps. */
+
+  migration_step_queue ("host_trends");
+
+  /* Set the database version to 236. */
+
+  set_db_version (236);
+
+  sql_commit ();
+
+  return 0;
+}
+
 #undef UPDATE_DASHBOARD_SETTINGS
 
+/**
+ * @brief Fill in the fingerprints of a batch of results.
+ *
+ * @param[in]  from  Last ID of the previous batch.
+ * @param[in]  to    Last ID of this batch.
+ */
+static void
+migrate_step_results_fingerprint (resource_t from, resource_t to)
+{
+  sql ("UPDATE results SET fingerprint = md5 (coalesce (description, ''))"
+       " WHERE id > %llu AND id <= %llu AND fingerprint IS NULL;",
+       from, to);
+}
+
+/**
+ * @brief Fill in the fingerprints of a batch of trash results.
+ *
+ * @param[in]  from  Last ID of the previous batch.
+ * @param[in]  to    Last ID of this batch.
+ */
+static void
+migrate_step_results_trash_fingerprint (resource_t from, resource_t to)
+{
+  sql ("UPDATE results_trash"
+       " SET fingerprint = md5 (coalesce (description, ''))"
+       " WHERE id > %llu AND id <= %llu AND fingerprint IS NULL;",
+       from, to);
+}
+
+/**
+ * @brief Move the long descriptions of a batch of results.
+ *
+ * The results trigger does the moving.
+ *
+ * @param[in]  from  Last ID of the previous batch.
+ * @param[in]  to    Last ID of this batch.
+ */
+static void
+migrate_step_results_descriptions (resource_t from, resource_t to)
+{
+  sql ("UPDATE results SET description = description"
+       " WHERE id > %llu AND id <= %llu"
+       " AND length (description) >= %i;",
+       from, to, RESULT_DESCRIPTION_SHARED_MIN);
+}
+
+/**
+ * @brief Add a batch of finished scans to the host trends.
+ *
+ * @param[in]  from  Last ID of the previous batch.
+ * @param[in]  to    Last ID of this batch.
+ */
+static void
+migrate_step_host_trends (resource_t from, resource_t to)
+{
+  host_trends_add_reports (from, to);
+}
+
+/**
+ * @brief Background migration steps.
+ */
+static migration_step_t migration_steps[] = {
+  {"results_fingerprint", "results", migrate_step_results_fingerprint, 0},
+  {"results_trash_fingerprint", "results_trash",
+   migrate_step_results_trash_fingerprint, 0},
+  {"results_descriptions", "results", migrate_step_results_descriptions, 0},
+  /* Each report rolls up all of its results. */
+  {"host_trends", "reports", migrate_step_host_trends, 100},
+  /* End marker. */
+  {NULL, NULL, NULL, 0}};
+
+/**
+ * @brief Run a queued background migration step to completion.
+ *
+ * @param[in]  step  Step.
+ */
+static void
+migration_step_run (migration_step_t *step)
+{
+  gchar *value;
+  resource_t checkpoint, max;
+
+  value = sql_string ("SELECT value FROM meta"
+                      " WHERE name = '" MIGRATION_STEP_PREFIX "%s';",
+                      step->name);
+  if (value == NULL)
+    return;
+  checkpoint = strtoull (value, NULL, 10);
+  g_free (value);
+
+  /* Rows added after the migration are already in the new form. */
+  max = sql_int64_0 ("SELECT coalesce (max (id), 0) FROM %s;", step->table);
+
+  g_info ("%s: running %s from %llu to %llu", __func__, step->name,
+          checkpoint, max);
+
+  while (checkpoint < max)
+    {
+      resource_t to;
+
+      to = MIN (checkpoint + (step->batch_size
+                              ? step->batch_size
+                              : MIGRATION_STEP_BATCH_SIZE),
+                max);
+      sql_begin_immediate ();
+      step->function (checkpoint, to);
+      sql ("UPDATE meta SET value = '%llu'"
+           " WHERE name = '" MIGRATION_STEP_PREFIX "%s';",
+           to, step->name);
+      sql_commit ();
+      checkpoint = to;
+    }
+
+  sql ("DELETE FROM meta WHERE name = '" MIGRATION_STEP_PREFIX "%s';",
+       step->name);
+  g_info ("%s: %s done", __func__, step->name);
+}
+
+/**
+ * @brief Build a queued index on a partitioned table.
+ *
+ * CREATE INDEX CONCURRENTLY does not work on a partitioned table, so the
+ * index is created on the partitioned table alone, where it stays invalid,
+ * and then built concurrently on each partition and attached.  The index
+ * becomes valid once it is attached on every partition.  Partitions that
+ * are created in the meantime get the index with the table.
+ *
+ * @param[in]  name     Name of index.
+ * @param[in]  table    Partitioned table.
+ * @param[in]  columns  Columns to index, in brackets.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+migration_index_create_partitioned (const char *name, const char *table,
+                                    const char *columns)
+{
+  iterator_t partitions;
+  GSList *names, *partition;
+  int ret;
+
+  if (sql_error ("CREATE INDEX IF NOT EXISTS %s ON ONLY %s %s;",
+                 name, table, columns))
+    return -1;
+
+  /* Collect the partitions first, because the iterator may hold a
+   * transaction open. */
+  names = NULL;
+  init_iterator (&partitions,
+                 "SELECT child.relname"
+                 " FROM pg_inherits, pg_class AS child"
+                 " WHERE pg_inherits.inhparent = '%s'::regclass"
+                 " AND pg_inherits.inhrelid = child.oid"
+                 /* Skip partitions that already have the index attached. */
+                 " AND NOT EXISTS (SELECT * FROM pg_inherits AS attached,"
+                 "                               pg_index"
+                 "                 WHERE attached.inhparent = '%s'::regclass"
+                 "                 AND attached.inhrelid = pg_index.indexrelid"
+                 "                 AND pg_index.indrelid = child.oid);",
+                 table,
+                 name);
+  while (next (&partitions))
+    names = g_slist_prepend (names,
+                             g_strdup (iterator_string (&partitions, 0)));
+  cleanup_iterator (&partitions);
+
+  ret = 0;
+  for (partition = names; partition; partition = partition->next)
+    {
+      gchar *partition_index;
+
+      partition_index = g_strdup_printf ("%s_%s", name,
+                                         (gchar *) partition->data);
+
+      /* Drop any invalid index left by an interrupted build. */
+      if (sql_int ("SELECT EXISTS (SELECT * FROM pg_index, pg_class"
+                   "               WHERE pg_class.oid = pg_index.indexrelid"
+                   "               AND pg_class.relname = '%s'"
+                   "               AND NOT pg_index.indisvalid);",
+                   partition_index)
+          && sql_error ("DROP INDEX CONCURRENTLY %s;", partition_index))
+        {
+          g_free (partition_index);
+          ret = -1;
+          break;
+        }
+
+      if (sql_error ("CREATE INDEX CONCURRENTLY IF NOT EXISTS %s ON %s %s;",
+                     partition_index, (gchar *) partition->data, columns)
+          || sql_error ("ALTER INDEX %s ATTACH PARTITION %s;",
+                        name, partition_index))
+        {
+          g_free (partition_index);
+          ret = -1;
+          break;
+        }
+      g_free (partition_index);
+    }
+
+  g_slist_free_full (names, g_free);
+  return ret;
+}
+
+/**
+ * @brief Build all queued indexes, without blocking writes to the tables.
+ */
+static void
+migration_indexes_run ()
+{
+  iterator_t indexes;
+  GSList *names, *definitions, *name, *definition;
+
+  names = NULL;
+  definitions = NULL;
+  init_iterator (&indexes,
+                 "SELECT substr (name, %i), value FROM meta"
+                 " WHERE name LIKE '" MIGRATION_INDEX_PREFIX "%%';",
+                 (int) strlen (MIGRATION_INDEX_PREFIX) + 1);
+  while (next (&indexes))
+    {
+      names = g_slist_prepend (names,
+                               g_strdup (iterator_string (&indexes, 0)));
+      definitions = g_slist_prepend (definitions,
+                                     g_strdup (iterator_string (&indexes,
+                                                                1)));
+    }
+  cleanup_iterator (&indexes);
+
+  /* CREATE INDEX CONCURRENTLY cannot run inside a transaction. */
+
+  for (name = names, definition = definitions;
+       name;
+       name = name->next, definition = definition->next)
+    {
+      gchar *table, *columns;
+
+      /* The definition is the table followed by the columns in brackets. */
+      columns = strchr (definition->data, ' ');
+      table = columns
+               ? g_strndup (definition->data,
+                            columns - (gchar *) definition->data)
+               : g_strdup (definition->data);
+      if (columns
+          && sql_int ("SELECT current_setting ('server_version_num')"
+                      "::integer;")
+             >= 100000
+          && sql_int ("SELECT EXISTS (SELECT * FROM pg_partitioned_table"
+                      "               WHERE partrelid = '%s'::regclass);",
+                      table))
+        {
+          g_info ("%s: creating index %s on partitions", __func__,
+                  (gchar *) name->data);
+          if (migration_index_create_partitioned (name->data, table,
+                                                  columns + 1))
+            g_warning ("%s: failed to create index %s", __func__,
+                       (gchar *) name->data);
+          else
+            sql ("DELETE FROM meta"
+                 " WHERE name = '" MIGRATION_INDEX_PREFIX "%s';",
+                 name->data);
+          g_free (table);
+          continue;
+        }
+      g_free (table);
+
+      /* Drop any invalid index left by an interrupted build. */
+      if (sql_int ("SELECT EXISTS (SELECT * FROM pg_index, pg_class"
+                   "               WHERE pg_class.oid = pg_index.indexrelid"
+                   "               AND pg_class.relname = '%s'"
+                   "               AND NOT pg_index.indisvalid);",
+                   name->data)
+          && sql_error ("DROP INDEX CONCURRENTLY %s;", name->data))
+        {
+          g_warning ("%s: failed to drop invalid index %s", __func__,
+                     (gchar *) name->data);
+          continue;
+        }
+
+      g_info ("%s: creating index %s", __func__, (gchar *) name->data);
+      if (sql_error ("CREATE INDEX CONCURRENTLY IF NOT EXISTS %s ON %s;",
+                     name->data, definition->data))
+        {
+          g_warning ("%s: failed to create index %s", __func__,
+                     (gchar *) name->data);
+          continue;
+        }
+      sql ("DELETE FROM meta WHERE name = '" MIGRATION_INDEX_PREFIX "%s';",
+           name->data);
+    }
+
+  g_slist_free_full (names, g_free);
+  g_slist_free_full (definitions, g_free);
+}
+
+/**
+ * @brief Check whether any background migration steps are queued.
+ *
+ * @return 1 if yes, else 0.
+ */
+int
+migration_steps_queued ()
+{
+  return sql_int ("SELECT EXISTS (SELECT * FROM meta"
+                  "               WHERE name LIKE '" MIGRATION_STEP_PREFIX "%%'"
+                  "               OR name LIKE '" MIGRATION_INDEX_PREFIX "%%');");
+}
+
+/**
+ * @brief Run all queued background migration steps.
+ */
+void
+migration_steps_run ()
+{
+  migration_step_t *step;
+
+  for (step = migration_steps; step->name; step++)
+    migration_step_run (step);
+  migration_indexes_run ();
+}
+
+/**
+ * @brief Print the progress of the queued background migration steps.
+ */
+static void
+migration_steps_print_progress ()
+{
+  migration_step_t *step;
+  iterator_t indexes;
+
+  for (step = migration_steps; step->name; step++)
+    {
+      gchar *value;
+      resource_t checkpoint, max;
+
+      value = sql_string ("SELECT value FROM meta"
+                          " WHERE name = '" MIGRATION_STEP_PREFIX "%s';",
+                          step->name);
+      if (value == NULL)
+        continue;
+      checkpoint = strtoull (value, NULL, 10);
+      g_free (value);
+
+      max = sql_int64_0 ("SELECT coalesce (max (id), 0) FROM %s;",
+                         step->table);
+      printf ("Background step %s: %i%% (%llu of %llu)\n",
+              step->name,
+              max ? (int) (MIN (checkpoint, max) * 100 / max) : 100,
+              MIN (checkpoint, max),
+              max);
+    }
+
+  init_iterator (&indexes,
+                 "SELECT substr (name, %i) FROM meta"
+                 " WHERE name LIKE '" MIGRATION_INDEX_PREFIX "%%';",
+                 (int) strlen (MIGRATION_INDEX_PREFIX) + 1);
+  while (next (&indexes))
+    printf ("Background index %s: pending\n", iterator_string (&indexes, 0));
+  cleanup_iterator (&indexes);
+}
+
 /**
  * @brief The oldest version for which migration is supported
  */
@@ -1823,6 +2647,17 @@ static migrator_t database_migrators[] = {
   {223, migrate_222_to_223},
   {224, migrate_223_to_224},
   {225, migrate_224_to_225},
+  {226, migrate_225_to_226},
+  {227, migrate_226_to_227},
+  {228, migrate_227_to_228},
+  {229, migrate_228_to_229},
+  {230, migrate_229_to_230},
+  {231, migrate_230_to_231},
+  {232, migrate_231_to_232},
+  {233, migrate_232_to_233},
+  {234, migrate_233_to_234},
+  {235, migrate_234_to_235},
+  {236, migrate_235_to_236},
   /* End marker. */
   {-1, NULL}};
 
@@ -1879,15 +2714,20 @@ migrate_is_available (int old_version, int new_version)
 /**
  * @brief Migrate database to version supported by this manager.
  *
+ * Large data rewrites are queued as migration steps, which the main process
+ * runs in the background after the migration.
+ *
  * @param[in]  log_config  Log configuration.
  * @param[in]  database    Location of manage database.
+ * @param[in]  progress    Whether to print progress, including that of any
+ *                         queued background migration steps.
  *
  * @return 0 success, 1 already on supported version, 2 too hard,
  * 11 cannot migrate SCAP DB, 12 cannot migrate CERT DB,
  * -1 error, -11 error running SCAP migration, -12 error running CERT migration.
  */
 int
-manage_migrate (GSList *log_config, const gchar *database)
+manage_migrate (GSList *log_config, const gchar *database, int progress)
 {
   migrator_t *migrators;
   /* The version on the disk. */
@@ -1945,6 +2785,14 @@ manage_migrate (GSList *log_config, const gchar *database)
             }
 
           g_info ("   Migrating to %i", migrators->version);
+          if (progress)
+            {
+              printf ("Migrating to %i (%i of %i)\n",
+                      migrators->version,
+                      migrators->version - old_version,
+                      new_version - old_version);
+              fflush (stdout);
+            }
 
           if (migrators->function ())
             {
@@ -2035,6 +2883,9 @@ manage_migrate (GSList *log_config, const gchar *database)
         }
     }
 
+  if (progress && old_version > 0)
+    migration_steps_print_progress ();
+
   if (version_current && scap_version_current && cert_version_current)
     {
       cleanup_manage_process (TRUE);
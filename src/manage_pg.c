@@ -39,6 +39,9 @@
  */
 #define G_LOG_DOMAIN "md manage"
 
+void
+create_tables ();
+
 
 /* Session. */
 
@@ -770,11 +773,18 @@ manage_create_sql_functions ()
        "                      WHERE id = task_target);"
        "     target_exclude_hosts := (SELECT exclude_hosts FROM targets"
        "                              WHERE id = task_target);"
+       "     maximum_hosts := (SELECT max_hosts FROM target_host_counts"
+       "                       WHERE target = task_target"
+       "                       AND key = "
+       TARGET_HOSTS_KEY ("target_hosts", "target_exclude_hosts")
+       ");"
        "   END IF;"
        "   IF target_hosts IS NULL THEN"
        "     RETURN 0;"
        "   END IF;"
-       "   maximum_hosts := max_hosts (target_hosts, target_exclude_hosts);"
+       "   IF maximum_hosts IS NULL THEN"
+       "     maximum_hosts := max_hosts (target_hosts, target_exclude_hosts);"
+       "   END IF;"
        "   IF maximum_hosts = 0 THEN"
        "     RETURN 0;"
        "   END IF;"
@@ -831,6 +841,24 @@ manage_create_sql_functions ()
        "$$ LANGUAGE plpgsql"
        " IMMUTABLE;");
 
+  /* Binary sort key of a host, for report_hosts.host_order.  IPv4 addresses
+   * sort numerically and before everything else, which sorts by bytes. */
+  sql ("CREATE OR REPLACE FUNCTION host_order_key (text)"
+       " RETURNS bytea AS $$"
+       " BEGIN"
+       "   IF $1 ~ '^(25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9]?[0-9])"
+       "(\\.(25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9]?[0-9])){3}$' THEN"
+       "     RETURN '\\x01'::bytea"
+       "            || decode (lpad (to_hex ($1::inet - '0.0.0.0'::inet),"
+       "                             8, '0'),"
+       "                       'hex');"
+       "   ELSE"
+       "     RETURN '\\x02'::bytea || convert_to (coalesce ($1, ''), 'UTF8');"
+       "   END IF;"
+       " END;"
+       "$$ LANGUAGE plpgsql"
+       " IMMUTABLE;");
+
   sql ("CREATE OR REPLACE FUNCTION order_message_type (text)"
        " RETURNS integer AS $$"
        " BEGIN"
@@ -1326,18 +1354,37 @@ manage_create_sql_functions ()
            TASK_STATUS_STOPPED,
            TASK_STATUS_INTERRUPTED);
 
+      /* PL/pgSQL, because the table is created after the functions on a
+       * new database. */
+      sql ("CREATE OR REPLACE FUNCTION report_live_progress (integer)"
+           " RETURNS integer AS $$"
+           /* Get the progress of a running scan, as reported by the
+            * scanner. */
+           " BEGIN"
+           "   RETURN (SELECT progress FROM live_report_progress"
+           "           WHERE report = $1);"
+           " END;"
+           "$$ LANGUAGE plpgsql"
+           " STABLE;");
+
       sql ("CREATE OR REPLACE FUNCTION report_progress (integer)"
            " RETURNS integer AS $$"
            /* Calculate the progress of a report. */
            "  SELECT CASE"
            "         WHEN $1 = 0"
            "         THEN -1"
-           "         WHEN (SELECT slave_task_uuid FROM reports WHERE id = $1)"
-           "              != ''"
-           "         THEN (SELECT slave_progress FROM reports WHERE id = $1)"
-           "         WHEN report_active ($1)"
-           "         THEN report_progress_active ($1)"
-           "         ELSE -1"
+           "         ELSE coalesce"
+           "               (report_live_progress ($1),"
+           "                CASE"
+           "                WHEN (SELECT slave_task_uuid FROM reports"
+           "                      WHERE id = $1)"
+           "                     != ''"
+           "                THEN (SELECT slave_progress FROM reports"
+           "                      WHERE id = $1)"
+           "                WHEN report_active ($1)"
+           "                THEN report_progress_active ($1)"
+           "                ELSE -1"
+           "                END)"
            "         END;"
            "$$ LANGUAGE SQL;");
 
@@ -1528,21 +1575,66 @@ manage_create_sql_functions ()
              "         END;"
              "$$ LANGUAGE SQL;");
 
-      sql ("CREATE OR REPLACE FUNCTION task_last_report (integer)"
-           " RETURNS integer AS $$"
-           /* Get the report from the most recently completed invocation of task. */
-           "  SELECT id FROM reports WHERE task = $1 AND scan_run_status = %u"
-           "  ORDER BY date DESC LIMIT 1;"
-           "$$ LANGUAGE SQL;",
-           TASK_STATUS_DONE);
-
-      sql ("CREATE OR REPLACE FUNCTION task_second_last_report (integer)"
-           " RETURNS integer AS $$"
-           /* Get report from second most recently completed invocation of task. */
-           "  SELECT id FROM reports WHERE task = $1 AND scan_run_status = %u"
-           "  ORDER BY date DESC LIMIT 1 OFFSET 1;"
-           "$$ LANGUAGE SQL;",
-           TASK_STATUS_DONE);
+      /* The task summaries are created with the tables, after the first
+       * call of this function on a new database. */
+      if (sql_int ("SELECT EXISTS (SELECT * FROM information_schema.tables"
+                   "               WHERE table_catalog = '%s'"
+                   "               AND table_schema = 'public'"
+                   "               AND table_name = 'task_summaries')"
+                   " ::integer;",
+                   sql_database ()))
+        {
+          sql ("CREATE OR REPLACE FUNCTION task_last_report (integer)"
+               " RETURNS integer AS $$"
+               /* Get the report from the most recently completed invocation
+                * of task. */
+               "  SELECT last_report FROM task_summaries WHERE task = $1;"
+               "$$ LANGUAGE SQL;");
+
+          sql ("CREATE OR REPLACE FUNCTION task_second_last_report (integer)"
+               " RETURNS integer AS $$"
+               /* Get report from second most recently completed invocation
+                * of task. */
+               "  SELECT second_last_report FROM task_summaries"
+               "  WHERE task = $1;"
+               "$$ LANGUAGE SQL;");
+
+          sql ("CREATE OR REPLACE FUNCTION task_finished_reports (integer)"
+               " RETURNS integer AS $$"
+               /* Count the completed invocations of task. */
+               "  SELECT coalesce ((SELECT finished FROM task_summaries"
+               "                    WHERE task = $1),"
+               "                   0);"
+               "$$ LANGUAGE SQL;");
+        }
+      else
+        {
+          sql ("CREATE OR REPLACE FUNCTION task_last_report (integer)"
+               " RETURNS integer AS $$"
+               /* Get the report from the most recently completed invocation
+                * of task. */
+               "  SELECT id FROM reports WHERE task = $1 AND scan_run_status = %u"
+               "  ORDER BY date DESC LIMIT 1;"
+               "$$ LANGUAGE SQL;",
+               TASK_STATUS_DONE);
+
+          sql ("CREATE OR REPLACE FUNCTION task_second_last_report (integer)"
+               " RETURNS integer AS $$"
+               /* Get report from second most recently completed invocation
+                * of task. */
+               "  SELECT id FROM reports WHERE task = $1 AND scan_run_status = %u"
+               "  ORDER BY date DESC LIMIT 1 OFFSET 1;"
+               "$$ LANGUAGE SQL;",
+               TASK_STATUS_DONE);
+
+          sql ("CREATE OR REPLACE FUNCTION task_finished_reports (integer)"
+               " RETURNS integer AS $$"
+               /* Count the completed invocations of task. */
+               "  SELECT count (*)::integer FROM reports"
+               "  WHERE task = $1 AND scan_run_status = %u;"
+               "$$ LANGUAGE SQL;",
+               TASK_STATUS_DONE);
+        }
 
       /* result_nvt column (in OVERRIDES_SQL) was added in version 189. */
       if (current_db_version >= 189)
@@ -1555,14 +1647,9 @@ manage_create_sql_functions ()
              "               FROM tasks WHERE id = $1)"
              "         THEN CAST (NULL AS double precision)"
              "         ELSE"
-             "         (SELECT report_severity ((SELECT id FROM reports"
-             "                                   WHERE task = $1"
-             "                                   AND scan_run_status = %u"
-             "                                   ORDER BY date DESC"
-             "                                   LIMIT 1 OFFSET 0), $2, $3))"
+             "         (SELECT report_severity (task_last_report ($1), $2, $3))"
              "         END;"
-             "$$ LANGUAGE SQL;",
-             TASK_STATUS_DONE);
+             "$$ LANGUAGE SQL;");
 
       sql ("CREATE OR REPLACE FUNCTION task_trend (integer, integer, integer)"
            " RETURNS text AS $$"
@@ -1583,9 +1670,7 @@ manage_create_sql_functions ()
            " BEGIN"
            "   CASE"
            /*  Ensure there are enough reports. */
-           "   WHEN (SELECT count(*) <= 1 FROM reports"
-           "         WHERE task = $1"
-           "         AND scan_run_status = %u)"
+           "   WHEN task_finished_reports ($1) <= 1"
            "   THEN RETURN ''::text;"
            /*  Get trend only for authenticated users. */
            "   WHEN (SELECT current_setting ('gvmd.user.uuid') = '')"
@@ -1671,7 +1756,6 @@ manage_create_sql_functions ()
            "   RETURN 'same'::text;"
            " END;"
            "$$ LANGUAGE plpgsql;",
-           TASK_STATUS_DONE,
            TASK_STATUS_RUNNING);
     }
 
@@ -2005,18 +2089,259 @@ manage_create_sql_functions ()
 
 /* Creation. */
 
+/**
+ * @brief Create an index on the results, or queue it if there are results.
+ *
+ * Building an index on a large results table takes long and blocks writes
+ * to the table, so when there are results already the index is queued, to
+ * be built concurrently by the migration steps that run in the background.
+ *
+ * @param[in]  name     Name of index.
+ * @param[in]  columns  Columns to index.
+ */
+static void
+create_result_index (const char *name, const char *columns)
+{
+  if (sql_int ("SELECT EXISTS (SELECT * FROM pg_indexes"
+               "               WHERE schemaname = 'public'"
+               "               AND tablename = 'results'"
+               "               AND indexname = '%s');",
+               name))
+    return;
+
+  if (sql_int ("SELECT EXISTS (SELECT * FROM results);") == 0)
+    {
+      sql ("CREATE INDEX %s ON results (%s);", name, columns);
+      return;
+    }
+
+  g_info ("%s: queueing creation of index %s", __func__, name);
+  sql ("INSERT INTO meta (name, value)"
+       " VALUES ('migration_index:%s', 'results (%s)')"
+       " ON CONFLICT (name) DO NOTHING;",
+       name, columns);
+}
+
 /**
  * @brief Create result indexes.
  */
 void
 manage_create_result_indexes ()
 {
-  sql ("SELECT create_index ('results_by_host_and_qod', 'results',"
-       "                     'host, qod');");
-  sql ("SELECT create_index ('results_by_report', 'results', 'report');");
-  sql ("SELECT create_index ('results_by_nvt', 'results', 'nvt');");
-  sql ("SELECT create_index ('results_by_task', 'results', 'task');");
-  sql ("SELECT create_index ('results_by_date', 'results', 'date');");
+  create_result_index ("results_by_host_and_qod", "host, qod");
+  create_result_index ("results_by_report", "report");
+  create_result_index ("results_by_nvt", "nvt");
+  create_result_index ("results_by_task", "task");
+  create_result_index ("results_by_date", "date");
+  /* For keyset pagination of report results, sorted like filter_clause. */
+  create_result_index ("results_by_report_and_host",
+                       "report, lower (host), id");
+  create_result_index ("results_by_report_and_date",
+                       "report, (cast (date AS bigint)), id");
+}
+
+/**
+ * @brief Number of consecutive reports whose results share a partition.
+ */
+#define RESULTS_PARTITION_REPORTS 1000
+
+/**
+ * @brief Check whether the results table is partitioned.
+ *
+ * @return 1 if partitioned, else 0.
+ */
+static int
+results_partitioned ()
+{
+  if (sql_int ("SELECT current_setting ('server_version_num')::integer;")
+      < 100000)
+    return 0;
+  return sql_int ("SELECT EXISTS (SELECT * FROM pg_partitioned_table"
+                  "               WHERE partrelid = 'results'::regclass)"
+                  " ::integer;");
+}
+
+/**
+ * @brief Create the results partition that holds a report.
+ *
+ * @param[in]  report  Report.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+results_partition_create (report_t report)
+{
+  resource_t number;
+
+  number = report / RESULTS_PARTITION_REPORTS;
+  return sql_error ("CREATE TABLE IF NOT EXISTS results_part_%llu"
+                    " PARTITION OF results"
+                    " FOR VALUES FROM (%llu) TO (%llu);",
+                    number,
+                    number * RESULTS_PARTITION_REPORTS,
+                    (number + 1) * RESULTS_PARTITION_REPORTS);
+}
+
+/**
+ * @brief Convert the results table to a table partitioned by report.
+ *
+ * Consecutive reports share a partition, so the partitions follow the
+ * creation time of the reports.  Old partitions can then be dropped as a
+ * whole when their reports are deleted, and queries on a single report
+ * only touch one partition.
+ *
+ * The whole table is copied, in one transaction.
+ *
+ * @return 0 success, 1 already partitioned, 2 database server too old,
+ *         -1 error.
+ */
+int
+manage_partition_results ()
+{
+  iterator_t indexes;
+  report_t max_report, report;
+
+  /* The fingerprint trigger needs BEFORE ROW triggers on partitioned
+   * tables. */
+  if (sql_int ("SELECT current_setting ('server_version_num')::integer;")
+      < 130000)
+    return 2;
+
+  if (results_partitioned ())
+    return 1;
+
+  sql_begin_immediate ();
+
+  sql ("ALTER TABLE results RENAME TO results_unpartitioned;");
+
+  /* Free the index names for the new table. */
+  init_iterator (&indexes,
+                 "SELECT indexname FROM pg_indexes"
+                 " WHERE schemaname = 'public'"
+                 " AND tablename = 'results_unpartitioned'"
+                 " AND indexname LIKE 'results_by_%%';");
+  while (next (&indexes))
+    sql ("DROP INDEX %s;", iterator_string (&indexes, 0));
+  cleanup_iterator (&indexes);
+
+  /* Unique constraints on a partitioned table must include the partition
+   * key, and that would make report NOT NULL.  Results are created without
+   * a report and only added to one later (see make_result and
+   * report_add_result), so there are no unique constraints.  Until then
+   * they are in the default partition.  The sequence and gvm_uuid_make
+   * keep the ID and UUID unique, and plain indexes serve the lookups. */
+  sql ("CREATE TABLE results"
+       " (LIKE results_unpartitioned INCLUDING DEFAULTS,"
+       "  FOREIGN KEY (task) REFERENCES tasks (id) ON DELETE RESTRICT,"
+       "  FOREIGN KEY (report) REFERENCES reports (id) ON DELETE RESTRICT,"
+       "  FOREIGN KEY (owner) REFERENCES users (id) ON DELETE RESTRICT)"
+       " PARTITION BY RANGE (report);");
+  sql ("ALTER SEQUENCE results_id_seq OWNED BY results.id;");
+
+  max_report = sql_int64_0 ("SELECT coalesce (max (id), 0) FROM reports;");
+  for (report = 0;
+       report <= max_report + RESULTS_PARTITION_REPORTS;
+       report += RESULTS_PARTITION_REPORTS)
+    if (results_partition_create (report))
+      {
+        sql_rollback ();
+        return -1;
+      }
+  /* For results of reports above the partitions, until
+   * manage_extend_results_partitions catches up. */
+  sql ("CREATE TABLE results_default PARTITION OF results DEFAULT;");
+
+  /* The table is still empty, so this builds the indexes right away. */
+  sql ("CREATE INDEX results_by_id ON results (id);");
+  sql ("CREATE INDEX results_by_uuid ON results (uuid);");
+  manage_create_result_indexes ();
+  sql ("DELETE FROM meta WHERE name LIKE 'migration_index:results_by_%%';");
+
+  sql ("INSERT INTO results SELECT * FROM results_unpartitioned;");
+
+  /* The views on the results follow the renamed table, so drop them with
+   * it and let create_tables create them again, with the trigger. */
+  sql ("DROP TABLE results_unpartitioned CASCADE;");
+  create_tables ();
+
+  sql_commit ();
+  return 0;
+}
+
+/**
+ * @brief Create the results partitions for the next reports.
+ *
+ * Keeps one partition ahead of the newest report, so that results rarely
+ * land in the default partition.
+ */
+void
+manage_extend_results_partitions ()
+{
+  report_t max_report;
+
+  if (results_partitioned () == 0)
+    return;
+
+  max_report = sql_int64_0 ("SELECT coalesce (max (id), 0) FROM reports;");
+  if (sql_int ("SELECT EXISTS (SELECT * FROM pg_class"
+               "               WHERE relname = 'results_part_%llu');",
+               (max_report / RESULTS_PARTITION_REPORTS) + 1))
+    return;
+
+  sql_begin_immediate ();
+  if (results_partition_create (max_report)
+      || results_partition_create (max_report + RESULTS_PARTITION_REPORTS))
+    {
+      /* Probably results of the range in the default partition already. */
+      g_warning ("%s: failed to create results partition for report %llu",
+                 __func__, max_report);
+      sql_rollback ();
+      return;
+    }
+  sql_commit ();
+}
+
+/**
+ * @brief Drop the results partitions that hold only reports being deleted.
+ *
+ * The partition of the newest reports is kept, because new reports may
+ * still be added to it.
+ *
+ * @param[in]  reports  Comma separated IDs of reports being deleted.
+ */
+void
+manage_drop_results_partitions (const char *reports)
+{
+  iterator_t partitions;
+
+  if (results_partitioned () == 0)
+    return;
+
+  init_iterator (&partitions,
+                 "SELECT DISTINCT id / %i FROM reports"
+                 " WHERE id IN (%s)"
+                 " AND id / %i < (SELECT max (id) / %i FROM reports)"
+                 " AND NOT EXISTS (SELECT * FROM reports AS others"
+                 "                 WHERE others.id / %i = reports.id / %i"
+                 "                 AND others.id NOT IN (%s))"
+                 " AND EXISTS (SELECT * FROM pg_class"
+                 "             WHERE relname = 'results_part_'"
+                 "                             || (reports.id / %i));",
+                 RESULTS_PARTITION_REPORTS,
+                 reports,
+                 RESULTS_PARTITION_REPORTS,
+                 RESULTS_PARTITION_REPORTS,
+                 RESULTS_PARTITION_REPORTS,
+                 RESULTS_PARTITION_REPORTS,
+                 reports,
+                 RESULTS_PARTITION_REPORTS);
+  while (next (&partitions))
+    {
+      g_debug ("%s: dropping results_part_%lli", __func__,
+               iterator_int64 (&partitions, 0));
+      sql ("DROP TABLE results_part_%lli;", iterator_int64 (&partitions, 0));
+    }
+  cleanup_iterator (&partitions);
 }
 
 /**
@@ -2054,7 +2379,8 @@ create_tables ()
        "  ifaces_allow integer,"
        "  method text,"
        "  creation_time integer,"
-       "  modification_time integer);");
+       "  modification_time integer,"
+       "  auth_token_generation integer DEFAULT 0);");
 
   sql ("CREATE TABLE IF NOT EXISTS auth_cache"
        " (id SERIAL PRIMARY KEY,"
@@ -2092,6 +2418,38 @@ create_tables ()
        "  creation_time integer,"
        "  modification_time integer);");
 
+  sql ("CREATE TABLE IF NOT EXISTS aggregate_rollups"
+       " (id SERIAL PRIMARY KEY,"
+       "  type text NOT NULL,"
+       "  group_column text NOT NULL,"
+       "  data_column text NOT NULL,"
+       "  group_value text,"
+       "  group_type text,"
+       "  count integer,"
+       "  min_value real,"
+       "  max_value real,"
+       "  avg_value double precision,"
+       "  sum_value real,"
+       "  owner integer);");
+
+  sql ("SELECT create_index ('aggregate_rollups_by_columns',"
+       "                     'aggregate_rollups',"
+       "                     'type, group_column, data_column');");
+
+  sql ("CREATE TABLE IF NOT EXISTS alert_queue"
+       " (id SERIAL PRIMARY KEY,"
+       "  alert integer,"
+       "  task integer,"
+       "  report integer,"
+       "  event integer,"
+       "  event_data text,"
+       "  owner text,"
+       "  method integer,"
+       "  attempts integer,"
+       "  queued_time integer,"
+       "  next_time integer,"
+       "  worker integer);");
+
   sql ("CREATE TABLE IF NOT EXISTS alert_condition_data"
        " (id SERIAL PRIMARY KEY,"
        "  alert integer REFERENCES alerts (id) ON DELETE RESTRICT,"
@@ -2266,6 +2624,28 @@ create_tables ()
        "  source_id text NOT NULL,"
        "  creation_time integer);");
 
+  /* Daily rollups of the scans of each host, for trends. */
+  sql ("CREATE TABLE IF NOT EXISTS host_trends"
+       " (id SERIAL PRIMARY KEY,"
+       "  host integer REFERENCES hosts (id) ON DELETE RESTRICT,"
+       "  day integer,"
+       "  report integer,"
+       "  max_severity double precision,"
+       "  high integer,"
+       "  medium integer,"
+       "  low integer,"
+       "  log integer,"
+       "  open integer,"
+       "  closed integer,"
+       "  UNIQUE (host, day));");
+
+  /* Vulnerabilities found by the latest scan of each host. */
+  sql ("CREATE TABLE IF NOT EXISTS host_open_nvts"
+       " (id SERIAL PRIMARY KEY,"
+       "  host integer REFERENCES hosts (id) ON DELETE RESTRICT,"
+       "  nvt text,"
+       "  UNIQUE (host, nvt));");
+
   sql ("CREATE TABLE IF NOT EXISTS host_details"
        " (id SERIAL PRIMARY KEY,"
        "  host integer REFERENCES hosts (id) ON DELETE RESTRICT,"
@@ -2315,6 +2695,46 @@ create_tables ()
        "  family_or_nvt text,"
        "  family text);");
 
+  /* Per family expansion of each NVT selector.  A change to a selector only
+   * marks the families it touches as stale, so that only those families
+   * are counted again. */
+  sql ("CREATE TABLE IF NOT EXISTS nvt_selector_family_counts"
+       " (id SERIAL PRIMARY KEY,"
+       "  selector text NOT NULL,"
+       "  family text NOT NULL,"
+       "  growing integer,"
+       "  nvt_count integer,"
+       "  max_nvt_count integer,"
+       "  stale integer DEFAULT 0,"
+       "  UNIQUE (selector, family));");
+
+  sql ("CREATE OR REPLACE FUNCTION nvt_selectors_mark_stale ()"
+       " RETURNS TRIGGER AS $$"
+       " BEGIN"
+       "   IF TG_OP != 'INSERT' THEN"
+       "     UPDATE nvt_selector_family_counts SET stale = 1"
+       "     WHERE selector = OLD.name"
+       "     AND (OLD.type = " G_STRINGIFY (NVT_SELECTOR_TYPE_ALL)
+       "          OR family = OLD.family_or_nvt"
+       "          OR family = OLD.family);"
+       "   END IF;"
+       "   IF TG_OP != 'DELETE' THEN"
+       "     UPDATE nvt_selector_family_counts SET stale = 1"
+       "     WHERE selector = NEW.name"
+       "     AND (NEW.type = " G_STRINGIFY (NVT_SELECTOR_TYPE_ALL)
+       "          OR family = NEW.family_or_nvt"
+       "          OR family = NEW.family);"
+       "     RETURN NEW;"
+       "   END IF;"
+       "   RETURN OLD;"
+       " END;"
+       "$$ LANGUAGE plpgsql;");
+
+  sql ("DROP TRIGGER IF EXISTS nvt_selectors_stale ON nvt_selectors;");
+  sql ("CREATE TRIGGER nvt_selectors_stale"
+       " AFTER INSERT OR UPDATE OR DELETE ON nvt_selectors"
+       " FOR EACH ROW EXECUTE PROCEDURE nvt_selectors_mark_stale ();");
+
   sql ("CREATE TABLE IF NOT EXISTS port_lists"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2322,7 +2742,11 @@ create_tables ()
        "  name text NOT NULL,"
        "  comment text,"
        "  creation_time integer,"
-       "  modification_time integer);");
+       "  modification_time integer,"
+       "  port_range text,"
+       "  port_count_all integer,"
+       "  port_count_tcp integer,"
+       "  port_count_udp integer);");
 
   sql ("CREATE TABLE IF NOT EXISTS port_lists_trash"
        " (id SERIAL PRIMARY KEY,"
@@ -2331,7 +2755,11 @@ create_tables ()
        "  name text NOT NULL,"
        "  comment text,"
        "  creation_time integer,"
-       "  modification_time integer);");
+       "  modification_time integer,"
+       "  port_range text,"
+       "  port_count_all integer,"
+       "  port_count_tcp integer,"
+       "  port_count_udp integer);");
 
   sql ("CREATE TABLE IF NOT EXISTS port_ranges"
        " (id SERIAL PRIMARY KEY,"
@@ -2375,6 +2803,15 @@ create_tables ()
        "  creation_time integer,"
        "  modification_time integer);");
 
+  /* Number of hosts in each target, so that the hosts only have to be
+   * expanded when they change. */
+  sql ("CREATE TABLE IF NOT EXISTS target_host_counts"
+       " (id SERIAL PRIMARY KEY,"
+       "  target integer UNIQUE NOT NULL"
+       "         REFERENCES targets (id) ON DELETE CASCADE,"
+       "  key text,"
+       "  max_hosts integer);");
+
   sql ("CREATE TABLE IF NOT EXISTS targets_trash"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2582,6 +3019,13 @@ create_tables ()
        "  default_value text,"
        "  hr_name text);");
 
+  /* VTs and VT preferences of configs, in the form OSP scans need. */
+  sql ("CREATE TABLE IF NOT EXISTS config_vts_bundles"
+       " (id SERIAL PRIMARY KEY,"
+       "  config integer UNIQUE NOT NULL,"
+       "  key text,"
+       "  bundle text);");
+
   sql ("CREATE TABLE IF NOT EXISTS schedules"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2711,6 +3155,117 @@ create_tables ()
        "  end_time integer,"
        "  min_qod integer);");
 
+  sql ("CREATE TABLE IF NOT EXISTS report_counts_rebuilds"
+       " (id SERIAL PRIMARY KEY,"
+       "  report integer,"
+       "  \"user\" integer);");
+
+  /* Summary of the reports of each task, kept up to date by the Manager so
+   * that the task iterator does not have to search the reports. */
+  sql ("CREATE TABLE IF NOT EXISTS task_summaries"
+       " (id SERIAL PRIMARY KEY,"
+       "  task integer UNIQUE NOT NULL,"
+       "  total integer,"
+       "  finished integer,"
+       "  first_report integer,"
+       "  first_date integer,"
+       "  last_report integer,"
+       "  last_date integer,"
+       "  second_last_report integer);");
+
+  /* Progress of running scans, as last reported by the scanner.  Kept out
+   * of reports, because it changes on every poll of the scanner.  The
+   * progress is moved to reports.slave_progress when the scan ends. */
+  sql ("CREATE TABLE IF NOT EXISTS live_report_progress"
+       " (report integer PRIMARY KEY,"
+       "  progress integer NOT NULL,"
+       "  modification_time integer);");
+
+  sql ("CREATE TABLE IF NOT EXISTS report_deletions"
+       " (id SERIAL PRIMARY KEY,"
+       "  report integer UNIQUE,"
+       "  queued integer);");
+
+  /* Totals of GMP command statistics, added to by each GMP process. */
+  sql ("CREATE TABLE IF NOT EXISTS gmp_command_stats"
+       " (id SERIAL PRIMARY KEY,"
+       "  command text UNIQUE NOT NULL,"
+       "  count bigint,"
+       "  wall_time double precision,"
+       "  cpu_time double precision,"
+       "  sql_count bigint,"
+       "  sql_time double precision,"
+       "  sql_rows bigint,"
+       "  bytes bigint);");
+
+  /* Results of signature verifications, keyed on the signed material and
+   * the signature.  A result holds until the trusted keys file changes. */
+  sql ("CREATE TABLE IF NOT EXISTS signature_verifications"
+       " (id SERIAL PRIMARY KEY,"
+       "  hash text UNIQUE NOT NULL,"
+       "  keyring_time integer,"
+       "  trust integer);");
+
+  /* Registry of the running processes and their resource use, written by
+   * each process.  PIDs repeat across cluster nodes, so the key includes the
+   * node, which is '' outside a cluster. */
+  sql ("CREATE TABLE IF NOT EXISTS processes"
+       " (pid integer NOT NULL,"
+       "  node text NOT NULL DEFAULT '',"
+       "  role text,"
+       "  task integer,"
+       "  report integer,"
+       "  start_time integer,"
+       "  rss bigint,"
+       "  peak_rss bigint,"
+       "  cpu_time double precision,"
+       "  sql_count bigint,"
+       "  sql_time double precision,"
+       "  update_time integer,"
+       "  PRIMARY KEY (pid, node));");
+
+  /* Totals of lock waits per call site, added to by each process. */
+  sql ("CREATE TABLE IF NOT EXISTS lock_wait_stats"
+       " (id SERIAL PRIMARY KEY,"
+       "  site text UNIQUE NOT NULL,"
+       "  count bigint,"
+       "  wait_time double precision,"
+       "  max_wait double precision);");
+
+  /* Running OSP scans polled by the scan supervisor.  In a cluster the
+   * node is the name of the node whose supervisor polls the scan. */
+  sql ("CREATE TABLE IF NOT EXISTS osp_scans"
+       " (id SERIAL PRIMARY KEY,"
+       "  task integer UNIQUE,"
+       "  report integer,"
+       "  owner integer,"
+       "  started integer,"
+       "  node text);");
+
+  /* Nodes of a cluster of gvmd sharing this database. */
+  sql ("CREATE TABLE IF NOT EXISTS cluster_nodes"
+       " (id SERIAL PRIMARY KEY,"
+       "  name text UNIQUE NOT NULL,"
+       "  heartbeat integer);");
+
+  /* Active tasks of a cluster, with the name of the node that runs them. */
+  sql ("CREATE TABLE IF NOT EXISTS cluster_tasks"
+       " (task integer PRIMARY KEY,"
+       "  node text NOT NULL);");
+
+  /* Effective severities of results, per user, override and dynamic
+   * setting, cached along with the report counts.  The end_time is the
+   * earliest end time of the overrides involved. */
+  sql ("CREATE TABLE IF NOT EXISTS result_severities"
+       " (id SERIAL PRIMARY KEY,"
+       "  result integer,"
+       "  report integer,"
+       "  \"user\" integer,"
+       "  override integer,"
+       "  dynamic integer,"
+       "  severity real,"
+       "  end_time integer);");
+
   sql ("CREATE TABLE IF NOT EXISTS resources_predefined"
        " (id SERIAL PRIMARY KEY,"
        "  resource_type text,"
@@ -2733,7 +3288,62 @@ create_tables ()
        "  qod_type text,"
        "  owner integer REFERENCES users (id) ON DELETE RESTRICT,"
        "  date integer,"
-       "  hostname text);");
+       "  hostname text,"
+       "  fingerprint text);");
+
+  /* Long descriptions are stored once per content, keyed by the
+   * fingerprint.  The description column of such a result is NULL. */
+  sql ("CREATE TABLE IF NOT EXISTS result_descriptions"
+       " (id SERIAL PRIMARY KEY,"
+       "  fingerprint text UNIQUE NOT NULL,"
+       "  description text);");
+
+  sql ("CREATE OR REPLACE FUNCTION result_description (text, text)"
+       " RETURNS text AS $$"
+       /* Get the description of a result, from its description and
+        * fingerprint columns. */
+       "  SELECT coalesce ($1,"
+       "                   (SELECT description FROM result_descriptions"
+       "                    WHERE fingerprint = $2));"
+       "$$ LANGUAGE SQL"
+       " STABLE;");
+
+  /* The fingerprint is a hash of the description, so that delta reports can
+   * compare results without comparing the full descriptions.  A result
+   * without a description keeps any fingerprint it has, so that results
+   * can be copied with their shared description.
+   *
+   * Two descriptions can have the same hash, so a description is only
+   * shared if the stored one has the same text.  Otherwise the result
+   * keeps its own description, which result_description prefers. */
+  sql ("CREATE OR REPLACE FUNCTION results_set_fingerprint ()"
+       " RETURNS TRIGGER AS $$"
+       " BEGIN"
+       "   IF NEW.description IS NOT NULL THEN"
+       "     NEW.fingerprint := md5 (NEW.description);"
+       "     IF length (NEW.description) >= %i THEN"
+       "       INSERT INTO result_descriptions (fingerprint, description)"
+       "       VALUES (NEW.fingerprint, NEW.description)"
+       "       ON CONFLICT (fingerprint) DO NOTHING;"
+       "       IF (SELECT description FROM result_descriptions"
+       "           WHERE fingerprint = NEW.fingerprint)"
+       "          = NEW.description"
+       "       THEN"
+       "         NEW.description := NULL;"
+       "       END IF;"
+       "     END IF;"
+       "   ELSIF NEW.fingerprint IS NULL THEN"
+       "     NEW.fingerprint := md5 ('');"
+       "   END IF;"
+       "   RETURN NEW;"
+       " END;"
+       "$$ LANGUAGE plpgsql;",
+       RESULT_DESCRIPTION_SHARED_MIN);
+
+  sql ("DROP TRIGGER IF EXISTS results_fingerprint ON results;");
+  sql ("CREATE TRIGGER results_fingerprint"
+       " BEFORE INSERT OR UPDATE OF description ON results"
+       " FOR EACH ROW EXECUTE PROCEDURE results_set_fingerprint ();");
 
   sql ("CREATE TABLE IF NOT EXISTS results_trash"
        " (id SERIAL PRIMARY KEY,"
@@ -2752,15 +3362,24 @@ create_tables ()
        "  qod_type text,"
        "  owner integer REFERENCES users (id) ON DELETE RESTRICT,"
        "  date integer,"
-       "  hostname text);");
+       "  hostname text,"
+       "  fingerprint text);");
 
   /* All the NVTs that have ever been encountered in results and overrides.
    *
    * This gives the textual NVT oids an integer ID, so that they can be
-   * compared faster when calculating overridden severity. */
+   * compared faster when calculating overridden severity.
+   *
+   * The notes, overrides and tickets columns count the notes, overrides and
+   * tickets on each NVT, so that the result iterator can skip looking for
+   * them on the results of all other NVTs.  A trigger on each of the tables
+   * keeps the counts. */
   sql ("CREATE TABLE IF NOT EXISTS result_nvts"
        " (id SERIAL PRIMARY KEY,"
-       "  nvt text UNIQUE NOT NULL);");
+       "  nvt text UNIQUE NOT NULL,"
+       "  notes integer DEFAULT 0,"
+       "  overrides integer DEFAULT 0,"
+       "  tickets integer DEFAULT 0);");
 
   /* A record of all the reports that contain each result_nvt.  In other words,
    * all the reports that contain each NVT.
@@ -2843,7 +3462,23 @@ create_tables ()
        "  start_time integer,"
        "  end_time integer,"
        "  current_port integer,"
-       "  max_port integer);");
+       "  max_port integer,"
+       "  host_order bytea);");
+
+  /* The sort key is kept with the host, so that sorting by IP compares
+   * bytes instead of parsing each host. */
+  sql ("CREATE OR REPLACE FUNCTION report_hosts_set_host_order ()"
+       " RETURNS TRIGGER AS $$"
+       " BEGIN"
+       "   NEW.host_order := host_order_key (NEW.host);"
+       "   RETURN NEW;"
+       " END;"
+       "$$ LANGUAGE plpgsql;");
+
+  sql ("DROP TRIGGER IF EXISTS report_hosts_host_order ON report_hosts;");
+  sql ("CREATE TRIGGER report_hosts_host_order"
+       " BEFORE INSERT OR UPDATE OF host ON report_hosts"
+       " FOR EACH ROW EXECUTE PROCEDURE report_hosts_set_host_order ();");
 
   sql ("CREATE TABLE IF NOT EXISTS report_host_details"
        " (id SERIAL PRIMARY KEY,"
@@ -2954,6 +3589,46 @@ create_tables ()
        "  result integer," // REFERENCES results (id) ON DELETE RESTRICT,"
        "  end_time integer);");
 
+  /* The trigger uses the table name as the name of the count column. */
+  sql ("CREATE OR REPLACE FUNCTION result_nvts_count ()"
+       " RETURNS TRIGGER AS $$"
+       " BEGIN"
+       "   IF TG_OP != 'INSERT' AND OLD.nvt IS NOT NULL THEN"
+       "     EXECUTE format ('UPDATE result_nvts SET %%1$I = %%1$I - 1"
+       "                      WHERE nvt = $1 AND %%1$I > 0',"
+       "                     TG_TABLE_NAME)"
+       "     USING OLD.nvt;"
+       "   END IF;"
+       "   IF TG_OP != 'DELETE' THEN"
+       "     IF NEW.nvt IS NOT NULL THEN"
+       "       INSERT INTO result_nvts (nvt) VALUES (NEW.nvt)"
+       "       ON CONFLICT (nvt) DO NOTHING;"
+       "       EXECUTE format ('UPDATE result_nvts SET %%1$I = %%1$I + 1"
+       "                        WHERE nvt = $1',"
+       "                       TG_TABLE_NAME)"
+       "       USING NEW.nvt;"
+       "     END IF;"
+       "     RETURN NEW;"
+       "   END IF;"
+       "   RETURN OLD;"
+       " END;"
+       "$$ LANGUAGE plpgsql;");
+
+  sql ("DROP TRIGGER IF EXISTS notes_result_nvts_count ON notes;");
+  sql ("CREATE TRIGGER notes_result_nvts_count"
+       " AFTER INSERT OR UPDATE OF nvt OR DELETE ON notes"
+       " FOR EACH ROW EXECUTE PROCEDURE result_nvts_count ();");
+
+  sql ("DROP TRIGGER IF EXISTS overrides_result_nvts_count ON overrides;");
+  sql ("CREATE TRIGGER overrides_result_nvts_count"
+       " AFTER INSERT OR UPDATE OF nvt OR DELETE ON overrides"
+       " FOR EACH ROW EXECUTE PROCEDURE result_nvts_count ();");
+
+  sql ("DROP TRIGGER IF EXISTS tickets_result_nvts_count ON tickets;");
+  sql ("CREATE TRIGGER tickets_result_nvts_count"
+       " AFTER INSERT OR UPDATE OF nvt OR DELETE ON tickets"
+       " FOR EACH ROW EXECUTE PROCEDURE result_nvts_count ();");
+
   sql ("CREATE TABLE IF NOT EXISTS permissions"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2986,6 +3661,20 @@ create_tables ()
        "  creation_time integer,"
        "  modification_time integer);");
 
+  /* Kind is 0 for a new resource and 1 for an updated one.  Each SecInfo
+   * sync records its changes under a new generation. */
+  sql ("CREATE SEQUENCE IF NOT EXISTS secinfo_change_generations;");
+
+  sql ("CREATE TABLE IF NOT EXISTS secinfo_changes"
+       " (id SERIAL PRIMARY KEY,"
+       "  generation integer NOT NULL,"
+       "  type text NOT NULL,"
+       "  resource integer NOT NULL,"
+       "  kind integer NOT NULL);");
+
+  sql ("SELECT create_index ('secinfo_changes_by_generation',"
+       "                     'secinfo_changes', 'generation');");
+
   sql ("CREATE TABLE IF NOT EXISTS settings"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text NOT NULL,"     /* Note: not UNIQUE. */
@@ -3075,7 +3764,15 @@ create_tables ()
        "  SELECT results.id as result, users.id as user, dynamic, override,"
        "    CASE WHEN dynamic != 0 THEN"
        "      CASE WHEN override != 0 THEN"
-       "        coalesce ((SELECT ov_new_severity FROM result_overrides"
+       "        coalesce ((SELECT severity FROM result_severities"
+       "                   WHERE result_severities.result = results.id"
+       "                     AND result_severities.\"user\" = users.id"
+       "                     AND result_severities.override = 1"
+       "                     AND result_severities.dynamic = 1"
+       "                     AND (result_severities.end_time = 0"
+       "                          OR result_severities.end_time >= m_now ())"
+       "                   LIMIT 1),"
+       "                  (SELECT ov_new_severity FROM result_overrides"
        "                   WHERE result = results.id"
        "                     AND result_overrides.user = users.id"
        "                     AND severity_matches_ov"
@@ -3085,11 +3782,25 @@ create_tables ()
        "                   LIMIT 1),"
        "                  current_severity (results.severity, results.nvt))"
        "      ELSE"
-       "        current_severity (results.severity, results.nvt)"
+       "        coalesce ((SELECT severity FROM result_severities"
+       "                   WHERE result_severities.result = results.id"
+       "                     AND result_severities.\"user\" = users.id"
+       "                     AND result_severities.override = 0"
+       "                     AND result_severities.dynamic = 1"
+       "                   LIMIT 1),"
+       "                  current_severity (results.severity, results.nvt))"
        "      END"
        "    ELSE"
        "      CASE WHEN override != 0 THEN"
-       "        coalesce ((SELECT ov_new_severity FROM result_overrides"
+       "        coalesce ((SELECT severity FROM result_severities"
+       "                   WHERE result_severities.result = results.id"
+       "                     AND result_severities.\"user\" = users.id"
+       "                     AND result_severities.override = 1"
+       "                     AND result_severities.dynamic = 0"
+       "                     AND (result_severities.end_time = 0"
+       "                          OR result_severities.end_time >= m_now ())"
+       "                   LIMIT 1),"
+       "                  (SELECT ov_new_severity FROM result_overrides"
        "                   WHERE result = results.id"
        "                     AND result_overrides.user = users.id"
        "                     AND severity_matches_ov"
@@ -3248,6 +3959,12 @@ create_tables ()
   sql ("SELECT create_index ('report_counts_by_report_and_override',"
        "                     'report_counts', 'report, override');");
 
+  sql ("SELECT create_index ('result_severities_by_result_user_and_options',"
+       "                     'result_severities',"
+       "                     'result, \"user\", override, dynamic');");
+  sql ("SELECT create_index ('result_severities_by_report',"
+       "                     'result_severities', 'report');");
+
   sql ("SELECT create_index ('reports_by_task',"
        "                     'reports', 'task');");
 
@@ -3263,6 +3980,27 @@ create_tables ()
   sql ("SELECT create_index ('tag_resources_trash_by_tag',"
        "                     'tag_resources_trash', 'tag');");
 
+  sql ("SELECT create_index ('tags_by_name',"
+       "                     'tags', 'name');");
+
+  sql ("SELECT create_index ('tickets_by_task_and_host',"
+       "                     'tickets', 'task, host, nvt');");
+
+  sql ("SELECT create_index ('ticket_results_by_ticket',"
+       "                     'ticket_results', 'ticket');");
+
+  sql ("SELECT create_index ('tls_certificates_by_sha256_fingerprint',"
+       "                     'tls_certificates',"
+       "                     'sha256_fingerprint, owner')");
+
+  sql ("SELECT create_index ('tls_certificates_by_md5_fingerprint',"
+       "                     'tls_certificates',"
+       "                     'md5_fingerprint, owner')");
+
+  sql ("SELECT create_index ('tls_certificate_sources_by_tls_certificate',"
+       "                     'tls_certificate_sources',"
+       "                     'tls_certificate, location, origin')");
+
   sql ("SELECT create_index ('tls_certificate_locations_by_host_ip',"
        "                     'tls_certificate_locations', 'host_ip')");
 
@@ -3293,6 +4031,10 @@ create_tables ()
        "        ('report_hosts_by_report_and_host',"
        "         'report_hosts',"
        "         'report, host');");
+  sql ("SELECT create_index"
+       "        ('report_hosts_by_report_and_host_order',"
+       "         'report_hosts',"
+       "         'report, host_order');");
 
   manage_create_result_indexes ();
 
@@ -3525,7 +4267,8 @@ manage_db_init (const gchar *name)
            "  integrity_impact text,"
            "  availability_impact text,"
            "  products text,"
-           "  cvss FLOAT DEFAULT 0);");
+           "  cvss FLOAT DEFAULT 0,"
+           "  raw_xml text);");
       sql ("CREATE UNIQUE INDEX cve_idx"
            " ON cves (name);");
       sql ("CREATE INDEX cves_by_creation_time_idx"
@@ -3547,7 +4290,8 @@ manage_db_init (const gchar *name)
            "  deprecated_by_id INTEGER,"
            "  max_cvss FLOAT DEFAULT 0,"
            "  cve_refs INTEGER DEFAULT 0,"
-           "  nvd_id text);");
+           "  nvd_id text,"
+           "  raw_xml text);");
       sql ("CREATE UNIQUE INDEX cpe_idx"
            " ON cpes (name);");
       sql ("CREATE INDEX cpes_by_creation_time_idx"
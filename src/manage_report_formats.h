@@ -24,6 +24,13 @@
 
 #include <glib.h>
 
+/**
+ * @brief UUID of the Arrow Results report format.
+ *
+ * gvmd generates this format itself, directly from the database.
+ */
+#define REPORT_FORMAT_UUID_ARROW_RESULTS "9725cf5f-b5ab-46a9-b5cf-a327e91cd074"
+
 void
 resource_set_predefined (const gchar *, resource_t, int);
 
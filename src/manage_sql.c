@@ -42,6 +42,7 @@
 #include "lsc_user.h"
 #include "sql.h"
 #include "utils.h"
+#include "arrow_ipc.h"
 /* TODO This is for buffer_get_filter_xml, for print_report_xml_start.  We
  *      should not be generating XML in here, that should be done in gmp_*.c. */
 #include "gmp_get.h"
@@ -51,9 +52,13 @@
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glib/gstdio.h>
 #include <pwd.h>
 #include <stdlib.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -77,6 +82,7 @@
 #include <gvm/util/authutils.h>
 #include <gvm/util/ldaputils.h>
 #include <gvm/gmp/gmp.h>
+#include <gnutls/crypto.h>
 
 #undef G_LOG_DOMAIN
 /**
@@ -143,6 +149,12 @@ check_db_encryption_key ();
 void
 manage_attach_databases ();
 
+int
+manage_partition_results ();
+
+void
+manage_drop_results_partitions (const char *);
+
 
 /* Headers for symbols defined in manage.c which are private to libmanage. */
 
@@ -171,6 +183,10 @@ validate_username (const gchar *);
 void
 set_task_interrupted (task_t, const gchar *);
 
+void
+fork_locked_worker (sigset_t *, const gchar *, const gchar *, const gchar *,
+                    void (*) ());
+
 
 /* Static headers. */
 
@@ -185,6 +201,12 @@ static int cache_report_counts (report_t, int, int, severity_data_t*);
 static char*
 task_owner_uuid (task_t);
 
+static int
+report_scan_run_status (report_t, task_status_t *);
+
+static void
+report_live_progress_end (report_t);
+
 gchar*
 clean_hosts (const char *, int*);
 
@@ -221,6 +243,12 @@ role_is_predefined_id (const char *);
 static int
 task_second_last_report (task_t, report_t *);
 
+static void
+task_summaries_update (const char *);
+
+static void
+task_summary_update (task_t);
+
 static gchar *
 new_secinfo_message (event_t, const void*, alert_t);
 
@@ -228,16 +256,16 @@ static gchar *
 new_secinfo_list (event_t, const void*, alert_t, int*);
 
 static void
-check_for_new_scap ();
+check_for_secinfo_changes ();
 
-static void
-check_for_new_cert ();
+static gchar *
+cluster_own_tasks (const char *);
 
 static void
-check_for_updated_scap ();
+cluster_task_status (task_t, task_status_t);
 
 static void
-check_for_updated_cert ();
+processes_prune ();
 
 static gchar*
 results_extra_where (int, report_t, const gchar*,
@@ -269,6 +297,9 @@ find_trash_report_with_permission (const char *, report_t *, const char *);
 static int
 cleanup_schedule_times ();
 
+static void
+task_schedules_changed ();
+
 static char *
 permission_name (permission_t);
 
@@ -278,15 +309,25 @@ cache_permissions_for_resource (const char *, resource_t, GArray*);
 static void
 cache_all_permissions_for_users (GArray*);
 
+static void
+cache_permissions_for_permission (const char *, const char *, resource_t,
+                                  const char *);
+
 static void
 report_cache_counts (report_t, int, int, const char*);
 
+static void
+report_cache_purge (GHashTable *);
+
 static int
 report_host_dead (report_host_t);
 
 static int
 report_host_result_count (report_host_t);
 
+static void
+host_summary_append (GString *, const char *, const char *, const char *);
+
 static int
 set_credential_data (credential_t, const char*, const char*);
 
@@ -370,6 +411,12 @@ type_build_select (const char *, const char *, const get_data_t *,
                    gboolean, gboolean, const char *, const char *,
                    const char *, gchar **);
 
+static result_t
+report_max_result (report_t);
+
+static result_t
+report_counts_add_results (report_t, result_t);
+
 
 /* Variables. */
 
@@ -388,6 +435,22 @@ static int max_hosts = MANAGE_MAX_HOSTS;
  */
 static int slave_commit_size = SLAVE_COMMIT_SIZE_DEFAULT;
 
+/**
+ * @brief Maximum number of report count caches rebuilt per second.
+ */
+static int count_cache_rebuild_rate = COUNT_CACHE_REBUILD_RATE_DEFAULT;
+
+/**
+ * @brief Maximum size of the rendered report cache in MiB, 0 to disable.
+ */
+static int report_cache_size = REPORT_CACHE_SIZE_DEFAULT;
+
+/**
+ * @brief Number of processes that run queued alerts, 0 to run alerts in the
+ *        process that produced the event.
+ */
+static int alert_workers = ALERT_WORKERS_DEFAULT;
+
 /**
  * @brief Default max number of bytes of reports included in email alerts.
  */
@@ -429,6 +492,11 @@ static int max_email_message_length = MAX_EMAIL_MESSAGE_LENGTH;
  */
 static nvtis_t* nvti_cache = NULL;
 
+/**
+ * @brief NVT feed version that the NVT cache was loaded from.
+ */
+static gchar *nvti_cache_feed_version = NULL;
+
 /**
  * @brief Name of the database file.
  */
@@ -506,6 +574,7 @@ command_t gmp_commands[]
     {"GET_FEEDS", "Get details of one or all feeds this Manager uses."},
     {"GET_FILTERS", "Get all filters."},
     {"GET_GROUPS", "Get all groups."},
+    {"GET_HOST_TRENDS", "Get daily trends of hosts."},
     {"GET_INFO", "Get raw information for a given item."},
     {"GET_NOTES", "Get all notes."},
     {"GET_NVTS", "Get one or all available NVTs."},
@@ -514,6 +583,7 @@ command_t gmp_commands[]
     {"GET_PERMISSIONS", "Get all permissions."},
     {"GET_PORT_LISTS", "Get all port lists."},
     {"GET_PREFERENCES", "Get preferences for all available NVTs."},
+    {"GET_PROCESSES", "Get the resource use of the Manager processes."},
     {"GET_REPORTS", "Get all reports."},
     {"GET_REPORT_FORMATS", "Get all report formats."},
     {"GET_RESULTS", "Get results."},
@@ -799,8 +869,6 @@ parse_iso_time (const char *text_time)
   tm.tm_isdst = -1;
   if (strptime ((char*) text_time, "%FT%T%z", &tm) == NULL)
     {
-      gchar *tz;
-
       memset (&tm, 0, sizeof (struct tm));
       tm.tm_isdst = -1;
       if (strptime ((char*) text_time, "%FT%TZ", &tm) == NULL)
@@ -817,106 +885,24 @@ parse_iso_time (const char *text_time)
                 return parse_ctime (text_time);
             }
 
-          /* Store current TZ. */
-          tz = getenv ("TZ") ? g_strdup (getenv ("TZ")) : NULL;
-
-          if (setenv ("TZ",
-                      current_credentials.timezone
-                       ? current_credentials.timezone
-                       : "UTC",
-                      1)
-              == -1)
-            {
-              g_warning ("%s: Failed to switch to timezone %s",
-                         __func__, current_credentials.timezone);
-              if (tz != NULL)
-                setenv ("TZ", tz, 1);
-              g_free (tz);
-              return 0;
-            }
-
-          memset (&tm, 0, sizeof (struct tm));
-          tm.tm_isdst = -1;
-          if (strptime ((char*) text_time, "%FT%T", &tm) == NULL)
-            {
-              memset (&tm, 0, sizeof (struct tm));
-              tm.tm_isdst = -1;
-              if (strptime ((char*) text_time, "%F %T", &tm) == NULL)
-                {
-                  assert (0);
-                  g_warning ("%s: Failed to parse time", __func__);
-                  if (tz != NULL)
-                    setenv ("TZ", tz, 1);
-                  g_free (tz);
-                  return 0;
-                }
-            }
+          return tz_context_mktime (tz_context (current_credentials.timezone),
+                                    &tm);
         }
-      else
-        {
-          /* Time has "Z" suffix for UTC */
-
-          /* Store current TZ. */
-          tz = getenv ("TZ") ? g_strdup (getenv ("TZ")) : NULL;
-
-          if (setenv ("TZ", "UTC", 1) == -1)
-            {
-              g_warning ("%s: Failed to switch to UTC", __func__);
-              if (tz != NULL)
-                setenv ("TZ", tz, 1);
-              g_free (tz);
-              return 0;
-            }
 
-          memset (&tm, 0, sizeof (struct tm));
-          tm.tm_isdst = -1;
-          if (strptime ((char*) text_time, "%FT%TZ", &tm) == NULL)
-            {
-              assert (0);
-              g_warning ("%s: Failed to parse time", __func__);
-              if (tz != NULL)
-                setenv ("TZ", tz, 1);
-              g_free (tz);
-              return 0;
-            }
-        }
+      /* Time has "Z" suffix for UTC */
 
-      epoch_time = mktime (&tm);
-      if (epoch_time == -1)
-        {
-          g_warning ("%s: Failed to make time", __func__);
-          if (tz != NULL)
-            setenv ("TZ", tz, 1);
-          g_free (tz);
-          return 0;
-        }
-
-      /* Revert to stored TZ. */
-      if (tz)
-        {
-          if (setenv ("TZ", tz, 1) == -1)
-            {
-              g_warning ("%s: Failed to switch to original TZ", __func__);
-              g_free (tz);
-              return 0;
-            }
-        }
-      else
-        unsetenv ("TZ");
-
-      g_free (tz);
+      return tz_context_mktime (tz_context (NULL), &tm);
     }
   else
     {
-      gchar *tz, *new_tz;
       int offset_hour, offset_minute;
-      char sign;
+      char sign[2];
 
       /* Get the timezone offset from the string. */
 
       if (sscanf ((char*) text_time,
-                  "%*u-%*u-%*uT%*u:%*u:%*u%[-+]%d:%d",
-                  &sign, &offset_hour, &offset_minute)
+                  "%*u-%*u-%*uT%*u:%*u:%*u%1[-+]%d:%d",
+                  sign, &offset_hour, &offset_minute)
           != 3)
         {
           /* Perhaps %z is an acronym like "CEST".  Assume it's local time. */
@@ -929,65 +915,13 @@ parse_iso_time (const char *text_time)
           return epoch_time;
         }
 
-      /* Store current TZ. */
-
-      tz = getenv ("TZ") ? g_strdup (getenv ("TZ")) : NULL;
-
-      /* Switch to the timezone in the time string. */
-
-      new_tz = g_strdup_printf ("UTC%c%d:%d",
-                                sign == '-' ? '+' : '-',
-                                offset_hour,
-                                offset_minute);
-      if (setenv ("TZ", new_tz, 1) == -1)
-        {
-          g_warning ("%s: Failed to switch to %s", __func__, new_tz);
-          g_free (new_tz);
-          if (tz != NULL)
-            setenv ("TZ", tz, 1);
-          g_free (tz);
-          return 0;
-        }
-      g_free (new_tz);
-
-      /* Parse time again under the new timezone. */
-
-      memset (&tm, 0, sizeof (struct tm));
-      tm.tm_isdst = -1;
-      if (strptime ((char*) text_time, "%FT%T%z", &tm) == NULL)
-        {
-          assert (0);
-          g_warning ("%s: Failed to parse time", __func__);
-          if (tz != NULL)
-            setenv ("TZ", tz, 1);
-          g_free (tz);
-          return 0;
-        }
-
-      epoch_time = mktime (&tm);
-      if (epoch_time == -1)
-        {
-          g_warning ("%s: Failed to make time", __func__);
-          if (tz != NULL)
-            setenv ("TZ", tz, 1);
-          g_free (tz);
-          return 0;
-        }
+      /* The fields hold the time in the zone of the offset. */
 
-      /* Revert to stored TZ. */
-      if (tz)
-        {
-          if (setenv ("TZ", tz, 1) == -1)
-            {
-              g_warning ("%s: Failed to switch to original TZ", __func__);
-              g_free (tz);
-              return 0;
-            }
-        }
+      epoch_time = tz_context_mktime (tz_context (NULL), &tm);
+      if (sign[0] == '-')
+        epoch_time += offset_hour * 3600 + offset_minute * 60;
       else
-        unsetenv ("TZ");
-
-      g_free (tz);
+        epoch_time -= offset_hour * 3600 + offset_minute * 60;
     }
 
   return epoch_time;
@@ -1567,7 +1501,8 @@ cleanup_keyword (keyword_t *keyword)
         }
       keyword->relation = KEYWORD_RELATION_COLUMN_EQUAL;
     }
-  else if (strcasecmp (keyword->column, "delta_states") == 0
+  else if (strcasecmp (keyword->column, "after") == 0
+           || strcasecmp (keyword->column, "delta_states") == 0
            || strcasecmp (keyword->column, "levels") == 0
            || strcasecmp (keyword->column, "sort") == 0
            || strcasecmp (keyword->column, "sort-reverse") == 0)
@@ -2584,6 +2519,18 @@ manage_clean_filter_remove (const gchar *filter, const gchar *column)
   return g_strstrip (g_string_free (clean, FALSE));
 }
 
+/**
+ * @brief Maximum number of entries in each filter cache.
+ *
+ * A cache is emptied when it grows beyond this.
+ */
+#define FILTER_CACHE_MAX 1000
+
+/**
+ * @brief Cache of manage_clean_filter results, keyed by the filter.
+ */
+static GHashTable *clean_filter_cache = NULL;
+
 /**
  * @brief Clean a filter.
  *
@@ -2594,7 +2541,34 @@ manage_clean_filter_remove (const gchar *filter, const gchar *column)
 gchar *
 manage_clean_filter (const gchar *filter)
 {
-  return manage_clean_filter_remove (filter, NULL);
+  gchar *key, *clean;
+
+  if (filter == NULL)
+    return g_strdup ("");
+
+  /* Cleaning re-parses the filter, and the same filter is often cleaned
+   * several times per command, so cache the result. */
+
+  key = g_strdup_printf ("%i\x1f%s", table_order_if_sort_not_specified,
+                         filter);
+  if (clean_filter_cache)
+    {
+      clean = g_hash_table_lookup (clean_filter_cache, key);
+      if (clean)
+        {
+          g_free (key);
+          return g_strdup (clean);
+        }
+      if (g_hash_table_size (clean_filter_cache) >= FILTER_CACHE_MAX)
+        g_hash_table_remove_all (clean_filter_cache);
+    }
+  else
+    clean_filter_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, g_free);
+
+  clean = manage_clean_filter_remove (filter, NULL);
+  g_hash_table_insert (clean_filter_cache, key, g_strdup (clean));
+  return clean;
 }
 
 /**
@@ -2813,6 +2787,42 @@ keyword_applies_to_column (keyword_t *keyword, const char* column)
   return 1;
 }
 
+/**
+ * @brief Append a tag condition to a filter clause.
+ *
+ * Selects the tagged resources with one uncorrelated subquery, using the
+ * tag index on tag_resources, so that the database builds the set of UUIDs
+ * once instead of looking up the tags of each resource.
+ *
+ * @param[in,out] clause      Buffer for the filter clause to append to.
+ * @param[in]  type           The resource type.
+ * @param[in]  first_keyword  Whether keyword is first.
+ * @param[in]  last_was_and   Whether last keyword was "and".
+ * @param[in]  last_was_not   Whether last keyword was "not".
+ * @param[in]  condition      SQL condition on the tags.
+ */
+static void
+filter_clause_append_tag_condition (GString *clause, const char *type,
+                                    int first_keyword, int last_was_and,
+                                    int last_was_not, const gchar *condition)
+{
+  g_string_append_printf
+     (clause,
+      "%s"
+      "(%ss.uuid IN"
+      "  (SELECT tag_resources.resource_uuid"
+      "   FROM tag_resources, tags"
+      "   WHERE tag_resources.resource_type = '%s'"
+      "   AND tag_resources.resource_uuid IS NOT NULL"
+      "   AND tag_resources.tag = tags.id"
+      "   AND tags.active != 0"
+      "   AND %s))",
+      get_join (first_keyword, last_was_and, last_was_not),
+      type,
+      type,
+      condition);
+}
+
 /**
  * @brief Append parts for a "tag" keyword to a filter clause.
  *
@@ -2828,7 +2838,7 @@ filter_clause_append_tag (GString *clause, keyword_t *keyword,
                           const char *type, int first_keyword,
                           int last_was_and, int last_was_not)
 {
-  gchar *quoted_keyword;
+  gchar *quoted_keyword, *condition;
   gchar **tag_split, *tag_name, *tag_value;
   int value_given;
 
@@ -2847,89 +2857,40 @@ filter_clause_append_tag (GString *clause, keyword_t *keyword,
       value_given = 0;
     }
 
+  condition = NULL;
   if (keyword->relation == KEYWORD_RELATION_COLUMN_EQUAL
       || keyword->relation == KEYWORD_RELATION_COLUMN_ABOVE
       || keyword->relation == KEYWORD_RELATION_COLUMN_BELOW)
-    {
-      g_string_append_printf
-         (clause,
-          "%s"
-          "(EXISTS"
-          "  (SELECT * FROM tags"
-          "   WHERE tags.name = '%s'"
-          "   AND tags.active != 0"
-          "   AND EXISTS (SELECT * FROM tag_resources"
-          "                WHERE tag_resources.resource_uuid"
-          "                        = %ss.uuid"
-          "                  AND tag_resources.resource_type"
-          "                        = '%s'"
-          "                  AND tag = tags.id)"
-          "   %s%s%s))",
-          get_join (first_keyword, last_was_and,
-                    last_was_not),
-          tag_name,
-          type,
-          type,
-          (value_given
-            ? "AND tags.value = '"
-            : ""),
-          value_given ? tag_value : "",
-          (value_given
-            ? "'"
-            : ""));
-    }
+    condition = g_strdup_printf ("tags.name = '%s'%s%s%s",
+                                 tag_name,
+                                 (value_given
+                                   ? " AND tags.value = '"
+                                   : ""),
+                                 value_given ? tag_value : "",
+                                 (value_given
+                                   ? "'"
+                                   : ""));
   else if (keyword->relation == KEYWORD_RELATION_COLUMN_APPROX)
-    {
-      g_string_append_printf
-         (clause,
-          "%s"
-          "(EXISTS"
-          "  (SELECT * FROM tags"
-          "   WHERE tags.name %s '%%%%%s%%%%'"
-          "   AND tags.active != 0"
-          "   AND EXISTS (SELECT * FROM tag_resources"
-          "                WHERE tag_resources.resource_uuid"
-          "                        = %ss.uuid"
-          "                  AND tag_resources.resource_type"
-          "                        = '%s'"
-          "                  AND tag = tags.id)"
-          "   AND tags.value %s '%%%%%s%%%%'))",
-          get_join (first_keyword, last_was_and,
-                    last_was_not),
-          sql_ilike_op (),
-          tag_name,
-          type,
-          type,
-          sql_ilike_op (),
-          tag_value);
-    }
+    condition = g_strdup_printf ("tags.name %s '%%%%%s%%%%'"
+                                 " AND tags.value %s '%%%%%s%%%%'",
+                                 sql_ilike_op (),
+                                 tag_name,
+                                 sql_ilike_op (),
+                                 tag_value);
   else if (keyword->relation == KEYWORD_RELATION_COLUMN_REGEXP)
-    {
-      g_string_append_printf
-         (clause,
-          "%s"
-          "(EXISTS"
-          "  (SELECT * FROM tags"
-          "   WHERE tags.name %s '%s'"
-          "   AND tags.active != 0"
-          "   AND EXISTS (SELECT * FROM tag_resources"
-          "                WHERE tag_resources.resource_uuid"
-          "                        = %ss.uuid"
-          "                  AND tag_resources.resource_type"
-          "                        = '%s'"
-          "                  AND tag = tags.id)"
-          "   AND tags.value"
-          "       %s '%s'))",
-          get_join (first_keyword, last_was_and,
-                    last_was_not),
-          sql_regexp_op (),
-          tag_name,
-          type,
-          type,
-          sql_regexp_op (),
-          tag_value);
-    }
-
+    condition = g_strdup_printf ("tags.name %s '%s'"
+                                 " AND tags.value %s '%s'",
+                                 sql_regexp_op (),
+                                 tag_name,
+                                 sql_regexp_op (),
+                                 tag_value);
+
+  if (condition)
+    filter_clause_append_tag_condition (clause, type, first_keyword,
+                                        last_was_and, last_was_not,
+                                        condition);
+
+  g_free (condition);
   g_free (quoted_keyword);
   g_strfreev(tag_split);
   g_free(tag_name);
@@ -2951,83 +2912,35 @@ filter_clause_append_tag_id (GString *clause, keyword_t *keyword,
                              const char *type, int first_keyword,
                              int last_was_and, int last_was_not)
 {
-  gchar *quoted_keyword;
+  gchar *quoted_keyword, *condition;
 
   quoted_keyword = sql_quote (keyword->string);
 
+  condition = NULL;
   if (keyword->relation == KEYWORD_RELATION_COLUMN_EQUAL
       || keyword->relation == KEYWORD_RELATION_COLUMN_ABOVE
       || keyword->relation == KEYWORD_RELATION_COLUMN_BELOW)
-    {
-      g_string_append_printf
-         (clause,
-          "%s"
-          "(EXISTS"
-          "  (SELECT * FROM tags"
-          "   WHERE tags.uuid = '%s'"
-          "   AND tags.active != 0"
-          "   AND EXISTS (SELECT * FROM tag_resources"
-          "                WHERE tag_resources.resource_uuid"
-          "                        = %ss.uuid"
-          "                  AND tag_resources.resource_type"
-          "                        = '%s'"
-          "                  AND tag = tags.id)))",
-          get_join (first_keyword, last_was_and,
-                    last_was_not),
-          quoted_keyword,
-          type,
-          type);
-    }
+    condition = g_strdup_printf ("tags.uuid = '%s'", quoted_keyword);
   else if (keyword->relation == KEYWORD_RELATION_COLUMN_APPROX)
-    {
-      g_string_append_printf
-         (clause,
-          "%s"
-          "(EXISTS"
-          "  (SELECT * FROM tags"
-          "   WHERE tags.uuid %s '%%%%%s%%%%'"
-          "   AND tags.active != 0"
-          "   AND EXISTS (SELECT * FROM tag_resources"
-          "                WHERE tag_resources.resource_uuid"
-          "                        = %ss.uuid"
-          "                  AND tag_resources.resource_type"
-          "                        = '%s'"
-          "                  AND tag = tags.id)))",
-          get_join (first_keyword, last_was_and,
-                    last_was_not),
-          sql_ilike_op (),
-          quoted_keyword,
-          type,
-          type);
-    }
+    condition = g_strdup_printf ("tags.uuid %s '%%%%%s%%%%'",
+                                 sql_ilike_op (),
+                                 quoted_keyword);
   else if (keyword->relation == KEYWORD_RELATION_COLUMN_REGEXP)
-    {
-      g_string_append_printf
-         (clause,
-          "%s"
-          "(EXISTS"
-          "  (SELECT * FROM tags"
-          "   WHERE tags.uuid %s '%s'"
-          "   AND tags.active != 0"
-          "   AND EXISTS (SELECT * FROM tag_resources"
-          "                WHERE tag_resources.resource_uuid"
-          "                        = %ss.uuid"
-          "                  AND tag_resources.resource_type"
-          "                        = '%s'"
-          "                  AND tag = tags.id)))",
-          get_join (first_keyword, last_was_and,
-                    last_was_not),
-          sql_regexp_op (),
-          quoted_keyword,
-          type,
-          type);
-    }
+    condition = g_strdup_printf ("tags.uuid %s '%s'",
+                                 sql_regexp_op (),
+                                 quoted_keyword);
+
+  if (condition)
+    filter_clause_append_tag_condition (clause, type, first_keyword,
+                                        last_was_and, last_was_not,
+                                        condition);
 
+  g_free (condition);
   g_free (quoted_keyword);
 }
 
 /**
- * @brief Return SQL WHERE clause for restricting a SELECT to a filter term.
+ * @brief Build the SQL WHERE clause for restricting a SELECT to a filter term.
  *
  * @param[in]  type     Resource type.
  * @param[in]  filter   Filter term.
@@ -3037,18 +2950,18 @@ filter_clause_append_tag_id (GString *clause, keyword_t *keyword,
  * @param[out] trash           Whether the trash table is being queried.
  * @param[out] order_return  If given then order clause.
  * @param[out] first_return  If given then first row.
- * @param[out] max_return    If given then max rows.
+ * @param[out] max_return    If given then max rows, -2 for the default.
  * @param[out] permissions   When given then permissions string vector.
  * @param[out] owner_filter  When given then value of owner keyword.
  *
  * @return WHERE clause for filter if one is required, else NULL.
  */
-gchar *
-filter_clause (const char* type, const char* filter,
-               const char **filter_columns, column_t *select_columns,
-               column_t *where_columns, int trash, gchar **order_return,
-               int *first_return, int *max_return, array_t **permissions,
-               gchar **owner_filter)
+static gchar *
+filter_clause_build (const char* type, const char* filter,
+                     const char **filter_columns, column_t *select_columns,
+                     column_t *where_columns, int trash, gchar **order_return,
+                     int *first_return, int *max_return,
+                     array_t **permissions, gchar **owner_filter)
 {
   GString *clause, *order;
   keyword_t **point;
@@ -4056,8 +3969,276 @@ filter_clause (const char* type, const char* filter,
   else
     g_string_free (order, TRUE);
 
+  if (strlen (clause->str))
+    return g_string_free (clause, FALSE);
+
+  g_string_free (clause, TRUE);
+  return NULL;
+}
+
+/**
+ * @brief A cached result of filter_clause_build.
+ */
+typedef struct
+{
+  gchar *clause;         ///< WHERE clause, or NULL.
+  gchar *order;          ///< ORDER BY clause.
+  int first;             ///< First row.
+  int max;               ///< Max rows, -2 for the default.
+  array_t *permissions;  ///< Values of permission keywords.
+  gchar *owner_filter;   ///< Value of owner keyword, or NULL.
+} filter_clause_cache_entry_t;
+
+/**
+ * @brief Cache of filter_clause results, keyed by filter_clause_cache_key.
+ */
+static GHashTable *filter_clause_cache = NULL;
+
+/**
+ * @brief Free a filter_clause cache entry.
+ *
+ * @param[in]  data  Entry.
+ */
+static void
+filter_clause_cache_entry_free (gpointer data)
+{
+  filter_clause_cache_entry_t *entry;
+
+  entry = (filter_clause_cache_entry_t *) data;
+  g_free (entry->clause);
+  g_free (entry->order);
+  array_free (entry->permissions);
+  g_free (entry->owner_filter);
+  g_free (entry);
+}
+
+/**
+ * @brief Copy an array of strings.
+ *
+ * @param[in]  strings  Array.
+ *
+ * @return Freshly allocated array.
+ */
+static array_t *
+filter_cache_array_copy (array_t *strings)
+{
+  array_t *copy;
+  guint index;
+
+  copy = make_array ();
+  for (index = 0; index < strings->len; index++)
+    array_add (copy, g_strdup (g_ptr_array_index (strings, index)));
+  return copy;
+}
+
+/**
+ * @brief Add a string to an FNV-1a hash.
+ *
+ * @param[in]  hash    Hash so far.
+ * @param[in]  string  String, or NULL.
+ *
+ * @return New hash.
+ */
+static guint64
+filter_cache_hash_string (guint64 hash, const char *string)
+{
+  if (string)
+    while (*string)
+      {
+        hash ^= (guchar) *string++;
+        hash *= 1099511628211ULL;
+      }
+  /* Separator, so that "ab" "c" differs from "a" "bc". */
+  hash ^= 0xff;
+  hash *= 1099511628211ULL;
+  return hash;
+}
+
+/**
+ * @brief Add the definitions of columns to an FNV-1a hash.
+ *
+ * Some callers build their column arrays at run time, so the key must
+ * depend on the content of the arrays, not on where they live.
+ *
+ * @param[in]  hash     Hash so far.
+ * @param[in]  columns  Columns, or NULL.
+ *
+ * @return New hash.
+ */
+static guint64
+filter_cache_hash_columns (guint64 hash, column_t *columns)
+{
+  if (columns)
+    for (; columns->select; columns++)
+      {
+        hash = filter_cache_hash_string (hash, columns->select);
+        hash = filter_cache_hash_string (hash, columns->filter);
+        hash ^= columns->type;
+        hash *= 1099511628211ULL;
+      }
+  return filter_cache_hash_string (hash, NULL);
+}
+
+/**
+ * @brief Check whether a filter may contain a time relative to now.
+ *
+ * Keywords like "created>-1d" are converted to an absolute time when they
+ * are parsed, so their clause cannot be reused.  This errs on the side of
+ * saying yes.
+ *
+ * @param[in]  filter  Filter term.
+ *
+ * @return 1 if the filter may contain a relative time, else 0.
+ */
+static int
+filter_has_relative_time (const char *filter)
+{
+  const char *point;
+
+  for (point = filter; *point; point++)
+    if (isdigit (*point)
+        && *(point + 1)
+        && strchr ("smhdwMy", *(point + 1))
+        && (*(point + 2) == '\0'
+            || isspace (*(point + 2))
+            || *(point + 2) == '"'))
+      return 1;
+  return 0;
+}
+
+/**
+ * @brief Build a key for the filter_clause cache.
+ *
+ * Besides the arguments, the parsed result depends on the timezone (via
+ * mktime) and on table_order_if_sort_not_specified.
+ *
+ * @param[in]  type            Resource type.
+ * @param[in]  filter          Filter term.
+ * @param[in]  filter_columns  Filter columns.
+ * @param[in]  select_columns  SELECT columns.
+ * @param[in]  where_columns   Columns in SQL that only appear in WHERE clause.
+ * @param[in]  trash           Whether the trash table is being queried.
+ *
+ * @return Freshly allocated key.
+ */
+static gchar *
+filter_clause_cache_key (const char *type, const char *filter,
+                         const char **filter_columns,
+                         column_t *select_columns, column_t *where_columns,
+                         int trash)
+{
+  guint64 hash;
+  const char *tz;
+
+  hash = 14695981039346656037ULL;
+  if (filter_columns)
+    for (; *filter_columns; filter_columns++)
+      hash = filter_cache_hash_string (hash, *filter_columns);
+  hash = filter_cache_hash_string (hash, NULL);
+  hash = filter_cache_hash_columns (hash, select_columns);
+  hash = filter_cache_hash_columns (hash, where_columns);
+
+  tz = getenv ("TZ");
+  return g_strdup_printf ("%s\x1f%i\x1f%i\x1f%s\x1f%016llx\x1f%s",
+                          type ? type : "",
+                          trash,
+                          table_order_if_sort_not_specified,
+                          tz ? tz : "",
+                          (unsigned long long) hash,
+                          filter);
+}
+
+/**
+ * @brief Return SQL WHERE clause for restricting a SELECT to a filter term.
+ *
+ * The parse is cached per process, because clients send the same filters
+ * over and over.  The cached result only depends on the filter term and
+ * the columns, so the default and maximum row counts from the user's
+ * settings are applied after the lookup.
+ *
+ * @param[in]  type     Resource type.
+ * @param[in]  filter   Filter term.
+ * @param[in]  filter_columns  Filter columns.
+ * @param[in]  select_columns  SELECT columns.
+ * @param[in]  where_columns   Columns in SQL that only appear in WHERE clause.
+ * @param[out] trash           Whether the trash table is being queried.
+ * @param[out] order_return  If given then order clause.
+ * @param[out] first_return  If given then first row.
+ * @param[out] max_return    If given then max rows.
+ * @param[out] permissions   When given then permissions string vector.
+ * @param[out] owner_filter  When given then value of owner keyword.
+ *
+ * @return WHERE clause for filter if one is required, else NULL.
+ */
+gchar *
+filter_clause (const char* type, const char* filter,
+               const char **filter_columns, column_t *select_columns,
+               column_t *where_columns, int trash, gchar **order_return,
+               int *first_return, int *max_return, array_t **permissions,
+               gchar **owner_filter)
+{
+  filter_clause_cache_entry_t *entry;
+  gchar *key, *clause;
+  int cached;
+
+  if (filter == NULL)
+    filter = "";
+
+  if (filter_has_relative_time (filter))
+    {
+      key = NULL;
+      entry = NULL;
+    }
+  else
+    {
+      key = filter_clause_cache_key (type, filter, filter_columns,
+                                     select_columns, where_columns, trash);
+      entry = filter_clause_cache
+               ? g_hash_table_lookup (filter_clause_cache, key)
+               : NULL;
+    }
+
+  cached = 1;
+  if (entry == NULL)
+    {
+      entry = g_malloc0 (sizeof (filter_clause_cache_entry_t));
+      entry->max = -2;
+      entry->clause = filter_clause_build (type, filter, filter_columns,
+                                           select_columns, where_columns,
+                                           trash, &entry->order,
+                                           &entry->first, &entry->max,
+                                           &entry->permissions,
+                                           &entry->owner_filter);
+      if (key)
+        {
+          if (filter_clause_cache == NULL)
+            filter_clause_cache
+              = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       filter_clause_cache_entry_free);
+          else if (g_hash_table_size (filter_clause_cache)
+                   >= FILTER_CACHE_MAX)
+            g_hash_table_remove_all (filter_clause_cache);
+          g_hash_table_insert (filter_clause_cache, key, entry);
+        }
+      else
+        cached = 0;
+    }
+  else
+    g_free (key);
+
+  if (order_return)
+    *order_return = g_strdup (entry->order);
+  if (first_return)
+    *first_return = entry->first;
+  if (permissions)
+    *permissions = filter_cache_array_copy (entry->permissions);
+  if (owner_filter)
+    *owner_filter = g_strdup (entry->owner_filter);
+
   if (max_return)
     {
+      *max_return = entry->max;
+
       if (*max_return == -2)
         setting_value_int (SETTING_UUID_ROWS_PER_PAGE, max_return);
       else if (*max_return < 1)
@@ -4066,11 +4247,10 @@ filter_clause (const char* type, const char* filter,
       *max_return = manage_max_rows (*max_return);
     }
 
-  if (strlen (clause->str))
-    return g_string_free (clause, FALSE);
-
-  g_string_free (clause, TRUE);
-  return NULL;
+  clause = g_strdup (entry->clause);
+  if (cached == 0)
+    filter_clause_cache_entry_free (entry);
+  return clause;
 }
 
 
@@ -4365,7 +4545,9 @@ find_resource_with_permission (const char* type, const char* uuid,
                                resource_t* resource, const char *permission,
                                int trash)
 {
-  gchar *quoted_uuid;
+  gchar *quoted_uuid, *template;
+  int ret;
+
   if (uuid == NULL)
     return TRUE;
   if ((type == NULL) || (valid_db_resource_type (type) == 0))
@@ -4377,25 +4559,31 @@ find_resource_with_permission (const char* type, const char* uuid,
       *resource = 0;
       return FALSE;
     }
-  switch (sql_int64 (resource,
-                     "SELECT id FROM %ss%s WHERE uuid = '%s'%s%s;",
-                     type,
-                     (trash && strcmp (type, "task") && strcmp (type, "report"))
-                      ? "_trash"
-                      : "",
-                     quoted_uuid,
-                     strcmp (type, "task")
-                      ? ""
-                      : (trash ? " AND hidden = 2" : " AND hidden < 2"),
-                     strcmp (type, "report")
-                      ? ""
-                      : (trash
-                          ? " AND (SELECT hidden FROM tasks"
-                            "      WHERE tasks.id = task)"
-                            "     = 2"
-                          : " AND (SELECT hidden FROM tasks"
-                          "        WHERE tasks.id = task)"
-                          "       = 0")))
+  g_free (quoted_uuid);
+
+  /* The template only varies with the type, so it is prepared once per
+   * type and trash flag. */
+  template = g_strdup_printf
+              ("SELECT id FROM %ss%s WHERE uuid = $1%s%s;",
+               type,
+               (trash && strcmp (type, "task") && strcmp (type, "report"))
+                ? "_trash"
+                : "",
+               strcmp (type, "task")
+                ? ""
+                : (trash ? " AND hidden = 2" : " AND hidden < 2"),
+               strcmp (type, "report")
+                ? ""
+                : (trash
+                    ? " AND (SELECT hidden FROM tasks"
+                      "      WHERE tasks.id = task)"
+                      "     = 2"
+                    : " AND (SELECT hidden FROM tasks"
+                    "        WHERE tasks.id = task)"
+                    "       = 0"));
+  ret = sql_int64_ps (resource, template, SQL_STR_PARAM (uuid), NULL);
+  g_free (template);
+  switch (ret)
     {
       case 0:
         break;
@@ -4405,12 +4593,10 @@ find_resource_with_permission (const char* type, const char* uuid,
       default:       /* Programming error. */
         assert (0);
       case -1:
-        g_free (quoted_uuid);
         return TRUE;
         break;
     }
 
-  g_free (quoted_uuid);
   return FALSE;
 }
 
@@ -5294,6 +5480,439 @@ append_column (GArray *columns, const gchar *column_name,
     }
 }
 
+/**
+ * @brief An aggregate that is kept in the aggregate_rollups table.
+ */
+typedef struct
+{
+  const char *type;           ///< Resource type.
+  const char *group_column;   ///< Filter column to group by.
+  const char *data_column;    ///< Filter column for statistics, or NULL.
+  int owned;                  ///< Whether there is one rollup per owner.
+} aggregate_rollup_t;
+
+/**
+ * @brief Aggregates kept in the aggregate_rollups table.
+ *
+ * These are the SecInfo and asset dashboard charts.  SecInfo looks the same
+ * to every user, so it has one rollup.  Assets have one rollup per owner,
+ * which is only used for users who see no assets but their own.  Results
+ * depend on overrides, so they are always aggregated from the tables.
+ */
+static aggregate_rollup_t aggregate_rollups[] =
+{
+  { "nvt", "family", NULL, 0 },
+  { "nvt", "family", "severity", 0 },
+  { "nvt", "severity", NULL, 0 },
+  { "nvt", "qod", NULL, 0 },
+  { "nvt", "qod_type", NULL, 0 },
+  { "cve", "severity", NULL, 0 },
+  { "cpe", "severity", NULL, 0 },
+  { "ovaldef", "severity", NULL, 0 },
+  { "ovaldef", "class", NULL, 0 },
+  { "cert_bund_adv", "severity", NULL, 0 },
+  { "dfn_cert_adv", "severity", NULL, 0 },
+  { "host", "severity", NULL, 1 },
+  { "os", "highest_severity", NULL, 1 },
+  { "os", "average_severity", NULL, 1 },
+  { NULL, NULL, NULL, 0 }
+};
+
+/**
+ * @brief SQL condition for the rows of a rollup that the current user uses.
+ *
+ * @param[in]  rollup  Rollup.
+ *
+ * @return Freshly allocated SQL condition on the owner column.
+ */
+static gchar *
+aggregate_rollup_owner_clause (aggregate_rollup_t *rollup)
+{
+  if (rollup->owned)
+    return g_strdup_printf ("owner = (SELECT id FROM users WHERE uuid = '%s')",
+                            current_credentials.uuid);
+  return g_strdup ("owner IS NULL");
+}
+
+/**
+ * @brief Find the rollup of an aggregate.
+ *
+ * @param[in]  type          Resource type.
+ * @param[in]  group_column  Column to group by.
+ * @param[in]  data_column   Column to calculate statistics for, or NULL.
+ *
+ * @return Rollup if there is one, else NULL.
+ */
+static aggregate_rollup_t *
+aggregate_rollup_find (const char *type, const char *group_column,
+                       const char *data_column)
+{
+  aggregate_rollup_t *rollup;
+
+  for (rollup = aggregate_rollups; rollup->type; rollup++)
+    if (strcmp (rollup->type, type) == 0
+        && strcmp (rollup->group_column, group_column) == 0
+        && (rollup->data_column
+             ? (data_column && strcmp (rollup->data_column, data_column) == 0)
+             : (data_column == NULL)))
+      return rollup;
+  return NULL;
+}
+
+/**
+ * @brief Recalculate a rollup from the resource tables.
+ *
+ * A rollup per owner is recalculated for the current user.
+ *
+ * @param[in]  rollup  Rollup.
+ */
+static void
+aggregate_rollup_refresh (aggregate_rollup_t *rollup)
+{
+  get_data_t get;
+  column_t *select_columns, *where_columns;
+  gchar *select_group_column, *select_data_column, *columns, *inner_select;
+  gchar *owner_where, *owner;
+
+  select_columns = type_select_columns (rollup->type);
+  where_columns = type_where_columns (rollup->type);
+
+  select_group_column = columns_select_column (select_columns,
+                                               where_columns,
+                                               rollup->group_column);
+  if (select_group_column == NULL)
+    {
+      g_warning ("%s: invalid group column %s for %s",
+                 __func__, rollup->group_column, rollup->type);
+      return;
+    }
+
+  if (rollup->data_column)
+    {
+      select_data_column = columns_select_column (select_columns,
+                                                  where_columns,
+                                                  rollup->data_column);
+      if (select_data_column == NULL)
+        {
+          g_warning ("%s: invalid data column %s for %s",
+                     __func__, rollup->data_column, rollup->type);
+          return;
+        }
+      columns = g_strdup_printf (" count(*) AS aggregate_count,"
+                                 " %s AS aggregate_group_value,"
+                                 " min(CAST (%s AS real)) AS aggregate_min,"
+                                 " max(CAST (%s AS real)) AS aggregate_max,"
+                                 " avg(CAST (%s AS real)) * count(*)"
+                                 "   AS aggregate_avg,"
+                                 " sum(CAST (%s AS real)) AS aggregate_sum",
+                                 select_group_column,
+                                 select_data_column,
+                                 select_data_column,
+                                 select_data_column,
+                                 select_data_column);
+    }
+  else
+    columns = g_strdup_printf (" count(*) AS aggregate_count,"
+                               " %s AS aggregate_group_value,"
+                               " CAST (NULL AS real) AS aggregate_min,"
+                               " CAST (NULL AS real) AS aggregate_max,"
+                               " CAST (NULL AS double precision)"
+                               "   AS aggregate_avg,"
+                               " CAST (NULL AS real) AS aggregate_sum",
+                               select_group_column);
+
+  memset (&get, 0, sizeof (get));
+  get.ignore_pagination = 1;
+
+  /* Rollups per owner only hold the resources of the current user. */
+  owner_where = NULL;
+  if (rollup->owned)
+    owner_where = g_strdup_printf (" AND %ss.owner"
+                                   "     = (SELECT id FROM users"
+                                   "        WHERE uuid = '%s')",
+                                   rollup->type,
+                                   current_credentials.uuid);
+
+  inner_select = NULL;
+  if (type_build_select (rollup->type, columns, &get, 0, 0, NULL,
+                         owner_where, select_group_column, &inner_select))
+    {
+      g_warning ("%s: failed to build select for %s",
+                 __func__, rollup->type);
+      g_free (columns);
+      g_free (owner_where);
+      return;
+    }
+  g_free (columns);
+  g_free (owner_where);
+
+  owner = aggregate_rollup_owner_clause (rollup);
+
+  sql ("DELETE FROM aggregate_rollups"
+       " WHERE type = '%s' AND group_column = '%s' AND data_column = '%s'"
+       " AND %s;",
+       rollup->type,
+       rollup->group_column,
+       rollup->data_column ? rollup->data_column : "",
+       owner);
+
+  sql ("INSERT INTO aggregate_rollups"
+       " (type, group_column, data_column, group_value, group_type, count,"
+       "  min_value, max_value, avg_value, sum_value, owner)"
+       " SELECT '%s', '%s', '%s',"
+       "        CAST (aggregate_group_value AS text),"
+       "        CAST (pg_typeof (aggregate_group_value) AS text),"
+       "        aggregate_count, aggregate_min, aggregate_max,"
+       "        aggregate_avg, aggregate_sum,"
+       "        %s%s%s"
+       " FROM (%s) AS agg_sub;",
+       rollup->type,
+       rollup->group_column,
+       rollup->data_column ? rollup->data_column : "",
+       rollup->owned ? "(SELECT id FROM users WHERE uuid = '" : "NULL",
+       rollup->owned ? current_credentials.uuid : "",
+       rollup->owned ? "')" : "",
+       inner_select);
+
+  g_free (owner);
+  g_free (inner_select);
+}
+
+/**
+ * @brief Recalculate the rollups of a type.
+ *
+ * Called after the rows of the type change, like at the end of a feed sync.
+ * Rollups per owner are left to aggregate_rollups_refresh_assets.
+ *
+ * @param[in]  type  Resource type, or NULL for all types.
+ */
+void
+aggregate_rollups_refresh (const char *type)
+{
+  aggregate_rollup_t *rollup;
+
+  sql_begin_immediate ();
+  for (rollup = aggregate_rollups; rollup->type; rollup++)
+    {
+      if (rollup->owned || (type && strcmp (rollup->type, type)))
+        continue;
+
+      if ((manage_scap_loaded () == FALSE
+           && (strcmp (rollup->type, "cve") == 0
+               || strcmp (rollup->type, "cpe") == 0
+               || strcmp (rollup->type, "ovaldef") == 0))
+          || (manage_cert_loaded () == FALSE
+              && (strcmp (rollup->type, "cert_bund_adv") == 0
+                  || strcmp (rollup->type, "dfn_cert_adv") == 0)))
+        continue;
+
+      aggregate_rollup_refresh (rollup);
+    }
+  sql_commit ();
+}
+
+/**
+ * @brief Recalculate the asset rollups of the current user.
+ *
+ * Called at the end of a scan, after the severities of the hosts are set.
+ * Runs in the transaction of the caller, if there is one.
+ */
+void
+aggregate_rollups_refresh_assets ()
+{
+  aggregate_rollup_t *rollup;
+
+  if (current_credentials.uuid == NULL)
+    return;
+
+  for (rollup = aggregate_rollups; rollup->type; rollup++)
+    if (rollup->owned)
+      aggregate_rollup_refresh (rollup);
+}
+
+/**
+ * @brief Remove the asset rollups of all users.
+ *
+ * Called when assets are created or deleted outside a scan.  Until the next
+ * scan of each user, the charts are aggregated from the tables.
+ */
+void
+aggregate_rollups_clear_assets ()
+{
+  sql ("DELETE FROM aggregate_rollups WHERE owner IS NOT NULL;");
+}
+
+/**
+ * @brief Check whether the user sees only the resources they own.
+ *
+ * This is the case when the user has no Super permissions and no
+ * permissions on resources of the type.
+ *
+ * @param[in]  type  Resource type.
+ *
+ * @return 1 if so, else 0.
+ */
+static int
+aggregate_rollup_user_sees_only_own (const char *type)
+{
+  return sql_int ("SELECT NOT EXISTS"
+                  " (SELECT * FROM permissions"
+                  "  WHERE subject_location = " G_STRINGIFY (LOCATION_TABLE)
+                  "  AND (name = 'Super' OR resource_type = '%s')"
+                  "  AND ((subject_type = 'user'"
+                  "        AND subject = (SELECT id FROM users"
+                  "                       WHERE uuid = '%s'))"
+                  "       OR (subject_type = 'group'"
+                  "           AND subject"
+                  "               IN (SELECT DISTINCT \"group\""
+                  "                   FROM group_users"
+                  "                   WHERE \"user\" = (SELECT id FROM users"
+                  "                                     WHERE uuid = '%s')))"
+                  "       OR (subject_type = 'role'"
+                  "           AND subject"
+                  "               IN (SELECT DISTINCT role"
+                  "                   FROM role_users"
+                  "                   WHERE \"user\" = (SELECT id FROM users"
+                  "                                     WHERE uuid"
+                  "                                           = '%s')))));",
+                  type,
+                  current_credentials.uuid,
+                  current_credentials.uuid,
+                  current_credentials.uuid);
+}
+
+/**
+ * @brief Get an aggregate select that reads from the rollups, if possible.
+ *
+ * The rollups hold the groups of the unfiltered aggregate, so they can only
+ * be used when the filter has no conditions.  The returned select has the
+ * same columns as the one built by init_aggregate_iterator.
+ *
+ * @param[in]  type             Resource type.
+ * @param[in]  get              GET data.
+ * @param[in]  data_columns     Columns to calculate statistics for.
+ * @param[in]  group_column     Column to group data by.
+ * @param[in]  subgroup_column  Column to further group data by.
+ * @param[in]  text_columns     Columns to get text from.
+ *
+ * @return Freshly allocated select, or NULL if the rollups cannot be used.
+ */
+static gchar *
+aggregate_rollup_select (const char *type, const get_data_t *get,
+                         GArray *data_columns, const char *group_column,
+                         const char *subgroup_column, GArray *text_columns)
+{
+  aggregate_rollup_t *rollup;
+  column_t *select_columns, *where_columns;
+  const char **filter_columns;
+  gchar *filter, *clause, *order, *owner_filter, *group_type, *pagination;
+  gchar *select, *owner;
+  array_t *permissions;
+  int first, max;
+
+  if (group_column == NULL
+      || strcmp (group_column, "") == 0
+      || (subgroup_column && strcmp (subgroup_column, ""))
+      || (text_columns && text_columns->len)
+      || (data_columns && data_columns->len > 1)
+      || get->trash)
+    return NULL;
+
+  rollup = aggregate_rollup_find (type, group_column,
+                                  (data_columns && data_columns->len)
+                                   ? g_array_index (data_columns, gchar*, 0)
+                                   : NULL);
+  if (rollup == NULL)
+    return NULL;
+
+  if (rollup->owned
+      && (current_credentials.uuid == NULL
+          || aggregate_rollup_user_sees_only_own (type) == 0))
+    return NULL;
+
+  if (get->filt_id && strcmp (get->filt_id, FILT_ID_NONE))
+    {
+      if (get->filter_replacement)
+        filter = g_strdup (get->filter_replacement);
+      else
+        filter = filter_term (get->filt_id);
+      if (filter == NULL)
+        /* Leave the error to type_build_select. */
+        return NULL;
+    }
+  else
+    filter = NULL;
+
+  select_columns = type_select_columns (type);
+  where_columns = type_where_columns (type);
+  filter_columns = type_filter_columns (type);
+
+  clause = filter_clause (type, filter ? filter : get->filter, filter_columns,
+                          select_columns, where_columns, 0, &order, &first,
+                          &max, &permissions, &owner_filter);
+  g_free (filter);
+  g_free (order);
+  array_free (permissions);
+  if (clause || owner_filter)
+    {
+      g_free (clause);
+      g_free (owner_filter);
+      return NULL;
+    }
+
+  owner = aggregate_rollup_owner_clause (rollup);
+
+  group_type = sql_string ("SELECT group_type FROM aggregate_rollups"
+                           " WHERE type = '%s' AND group_column = '%s'"
+                           " AND data_column = '%s'"
+                           " AND %s"
+                           " LIMIT 1;",
+                           rollup->type,
+                           rollup->group_column,
+                           rollup->data_column ? rollup->data_column : "",
+                           owner);
+  if (group_type == NULL)
+    {
+      /* Rollup is empty, or was never calculated, or was cleared. */
+      g_free (owner);
+      return NULL;
+    }
+
+  if (get->ignore_pagination)
+    pagination = g_strdup ("");
+  else
+    pagination = g_strdup_printf (" LIMIT %s OFFSET %d",
+                                  sql_select_limit (max),
+                                  first);
+
+  select = g_strdup_printf ("SELECT count AS aggregate_count,"
+                            " CAST (group_value AS %s)"
+                            "   AS aggregate_group_value,"
+                            " CAST (NULL AS TEXT) AS aggregate_subgroup_value"
+                            "%s"
+                            " FROM aggregate_rollups"
+                            " WHERE type = '%s' AND group_column = '%s'"
+                            " AND data_column = '%s'"
+                            " AND %s"
+                            "%s",
+                            group_type,
+                            rollup->data_column
+                             ? ", min_value AS aggregate_min_0,"
+                               " max_value AS aggregate_max_0,"
+                               " avg_value AS aggregate_avg_0,"
+                               " sum_value AS aggregate_sum_0"
+                             : "",
+                            rollup->type,
+                            rollup->group_column,
+                            rollup->data_column ? rollup->data_column : "",
+                            owner,
+                            pagination);
+  g_free (owner);
+  g_free (group_type);
+  g_free (pagination);
+  return select;
+}
+
 /**
  * @brief Initialise a GET_AGGREGATES iterator, including observed resources.
  *
@@ -5649,11 +6268,17 @@ init_aggregate_iterator (iterator_t* iterator, const char *type,
                               col_index);
     }
 
+  build_select_ret = 0;
   inner_select = NULL;
-  build_select_ret = type_build_select (type, aggregate_select->str, get,
-                                        distinct, 0, extra_tables,
-                                        given_extra_where, aggregate_group_by,
-                                        &inner_select);
+  if (distinct == 0 && extra_tables == NULL && given_extra_where == NULL)
+    inner_select = aggregate_rollup_select (type, get, data_columns,
+                                            group_column, subgroup_column,
+                                            text_columns);
+  if (inner_select == NULL)
+    build_select_ret = type_build_select (type, aggregate_select->str, get,
+                                          distinct, 0, extra_tables,
+                                          given_extra_where,
+                                          aggregate_group_by, &inner_select);
 
   if (build_select_ret == 0)
     {
@@ -6549,6 +7174,9 @@ DEF_ACCESS (task_role_iterator_uuid, 4);
 void
 check_alerts ()
 {
+  /* Before the check times move, because alert conditions use them. */
+  check_for_secinfo_changes ();
+
   if (manage_scap_loaded ())
     {
       int max_time;
@@ -6568,19 +7196,10 @@ check_alerts ()
         sql ("INSERT INTO meta (name, value)"
              " VALUES ('scap_check_time', %i);",
              max_time);
-      else if (sql_int ("SELECT value = '0' FROM meta"
-                        " WHERE name = 'scap_check_time';"))
+      else
         sql ("UPDATE meta SET value = %i"
              " WHERE name = 'scap_check_time';",
              max_time);
-      else
-        {
-          check_for_new_scap ();
-          check_for_updated_scap ();
-          sql ("UPDATE meta SET value = %i"
-               " WHERE name = 'scap_check_time';",
-               max_time);
-        }
     }
 
   if (manage_cert_loaded ())
@@ -6601,19 +7220,10 @@ check_alerts ()
         sql ("INSERT INTO meta (name, value)"
              " VALUES ('cert_check_time', %i);",
              max_time);
-      else if (sql_int ("SELECT value = '0' FROM meta"
-                        " WHERE name = 'cert_check_time';"))
+      else
         sql ("UPDATE meta SET value = %i"
              " WHERE name = 'cert_check_time';",
              max_time);
-      else
-        {
-          check_for_new_cert ();
-          check_for_updated_cert ();
-          sql ("UPDATE meta SET value = %i"
-               " WHERE name = 'cert_check_time';",
-               max_time);
-        }
     }
 }
 
@@ -14526,6 +15136,79 @@ condition_met (task_t task, report_t report, alert_t alert,
   return 0;
 }
 
+/**
+ * @brief Maximum number of times a queued alert is tried.
+ */
+#define ALERT_QUEUE_MAX_ATTEMPTS 5
+
+/**
+ * @brief Seconds before the first retry of a failed queued alert.
+ *
+ * Doubles with each further attempt.
+ */
+#define ALERT_QUEUE_RETRY_DELAY 60
+
+/**
+ * @brief First key of the advisory locks of gvmd.
+ *
+ * The locks take two keys, so that they stay clear of any single key locks
+ * that other users of the database take.  The second keys are the *_LOCK
+ * defines.
+ */
+#define ADVISORY_LOCK_SPACE 0x47564d44
+
+/**
+ * @brief Advisory lock key that serialises the claims of the alert workers.
+ */
+#define ALERT_QUEUE_LOCK 2
+
+/**
+ * @brief Queue an alert for the alert workers.
+ *
+ * @param[in]  alert       Alert.
+ * @param[in]  task        Task.
+ * @param[in]  report      Report.
+ * @param[in]  event       Event.
+ * @param[in]  event_data  Event data.
+ */
+static void
+alert_queue_add (alert_t alert, task_t task, report_t report, event_t event,
+                 const void *event_data)
+{
+  gchar *data, *quoted_data, *quoted_owner;
+
+  switch (event)
+    {
+      case EVENT_TASK_RUN_STATUS_CHANGED:
+        data = g_strdup_printf ("%i", GPOINTER_TO_INT (event_data));
+        break;
+      case EVENT_NEW_SECINFO:
+      case EVENT_UPDATED_SECINFO:
+        data = g_strdup (event_data);
+        break;
+      default:
+        data = NULL;
+        break;
+    }
+
+  quoted_data = sql_insert (data);
+  quoted_owner = sql_insert (current_credentials.uuid);
+  sql ("INSERT INTO alert_queue"
+       " (alert, task, report, event, event_data, owner, method, attempts,"
+       "  queued_time, next_time, worker)"
+       " VALUES (%llu, %llu, %llu, %i, %s, %s, %i, 0, m_now (), m_now (), 0);",
+       alert,
+       task,
+       report,
+       event,
+       quoted_data,
+       quoted_owner,
+       alert_method (alert));
+  g_free (data);
+  g_free (quoted_data);
+  g_free (quoted_owner);
+}
+
 /**
  * @brief Produce an event.
  *
@@ -14577,6 +15260,11 @@ event (event_t event, void* event_data, resource_t resource_1,
       alert_condition_t condition;
 
       alert = g_array_index (alerts_triggered, alert_t, index);
+      if (alert_workers > 0)
+        {
+          alert_queue_add (alert, resource_1, resource_2, event, event_data);
+          continue;
+        }
       condition = alert_condition (alert);
       escalate_1 (alert,
                   resource_1,
@@ -14591,6 +15279,254 @@ event (event_t event, void* event_data, resource_t resource_1,
   g_array_free (alerts_triggered, TRUE);
 }
 
+/**
+ * @brief Run a queued alert.
+ *
+ * @param[in]  alert       Alert.
+ * @param[in]  task        Task.
+ * @param[in]  report      Report.
+ * @param[in]  event       Event.
+ * @param[in]  event_data  Event data, as stored by alert_queue_add.
+ * @param[in]  owner       UUID of user that produced the event, or NULL.
+ *
+ * @return 0 success, 1 alert is gone, -1 error.
+ */
+static int
+alert_queue_run (alert_t alert, task_t task, report_t report, event_t event,
+                 const gchar *event_data, const gchar *owner)
+{
+  const void *data;
+  int ret;
+
+  if (sql_int ("SELECT EXISTS (SELECT * FROM alerts WHERE id = %llu);",
+               alert)
+      == 0)
+    return 1;
+
+  if (event == EVENT_TASK_RUN_STATUS_CHANGED)
+    data = GINT_TO_POINTER (event_data ? atoi (event_data) : 0);
+  else
+    data = event_data;
+
+  current_credentials.uuid = owner ? g_strdup (owner) : NULL;
+  current_credentials.username = owner ? user_name (owner) : NULL;
+  manage_session_init (owner ? owner : "");
+  acl_cache_reset ();
+
+  ret = escalate_1 (alert, task, report, event, data, alert_method (alert),
+                    alert_condition (alert), NULL);
+
+  g_free (current_credentials.uuid);
+  g_free (current_credentials.username);
+  current_credentials.uuid = NULL;
+  current_credentials.username = NULL;
+  acl_cache_reset ();
+
+  return ret ? -1 : 0;
+}
+
+/**
+ * @brief Run queued alerts until none are due.
+ *
+ * @param[in]  method_limit  Maximum number of alerts running at once for
+ *                           each alert method.
+ */
+static void
+alert_queue_work (int method_limit)
+{
+  int count;
+
+  count = 0;
+  while (1)
+    {
+      iterator_t jobs;
+      rowid_t job;
+      alert_t alert;
+      task_t task;
+      report_t report;
+      event_t event;
+      gchar *event_data, *owner;
+      int attempts, latency, ret;
+
+      /* Claim the oldest due alert.  The lock serialises the claims of the
+       * workers, so that the limit per method holds.  It is an advisory lock
+       * so that queueing alerts does not wait for the workers. */
+
+      sql_begin_immediate ();
+      sql ("SELECT pg_advisory_xact_lock (%i, %i);",
+           ADVISORY_LOCK_SPACE, ALERT_QUEUE_LOCK);
+      ret = sql_int64 (&job,
+                       "UPDATE alert_queue"
+                       " SET worker = %i, attempts = attempts + 1"
+                       " WHERE id = (SELECT id FROM alert_queue AS due"
+                       "             WHERE worker = 0"
+                       "             AND next_time <= m_now ()"
+                       "             AND (SELECT count (*)"
+                       "                  FROM alert_queue AS running"
+                       "                  WHERE running.worker != 0"
+                       "                  AND running.method = due.method)"
+                       "                 < %i"
+                       "             ORDER BY id LIMIT 1)"
+                       " RETURNING id;",
+                       getpid (),
+                       method_limit);
+      sql_commit ();
+      if (ret)
+        break;
+
+      init_iterator (&jobs,
+                     "SELECT alert, task, report, event, event_data, owner,"
+                     "       attempts, m_now () - queued_time"
+                     " FROM alert_queue WHERE id = %llu;",
+                     job);
+      if (next (&jobs) == FALSE)
+        {
+          cleanup_iterator (&jobs);
+          continue;
+        }
+      alert = iterator_int64 (&jobs, 0);
+      task = iterator_int64 (&jobs, 1);
+      report = iterator_int64 (&jobs, 2);
+      event = iterator_int (&jobs, 3);
+      event_data = g_strdup (iterator_string (&jobs, 4));
+      owner = g_strdup (iterator_string (&jobs, 5));
+      attempts = iterator_int (&jobs, 6);
+      latency = iterator_int (&jobs, 7);
+      cleanup_iterator (&jobs);
+
+      g_debug ("%s: running alert %llu after %i s in queue (attempt %i)",
+               __func__, alert, latency, attempts);
+
+      ret = alert_queue_run (alert, task, report, event, event_data, owner);
+      g_free (event_data);
+      g_free (owner);
+
+      if (ret == -1 && attempts < ALERT_QUEUE_MAX_ATTEMPTS)
+        {
+          g_info ("%s: alert %llu failed, retrying later", __func__, alert);
+          sql ("UPDATE alert_queue"
+               " SET worker = 0, next_time = m_now () + %i"
+               " WHERE id = %llu;",
+               ALERT_QUEUE_RETRY_DELAY << (attempts - 1),
+               job);
+          continue;
+        }
+
+      if (ret == -1)
+        g_warning ("%s: alert %llu failed %i times, giving up",
+                   __func__, alert, attempts);
+      sql ("DELETE FROM alert_queue WHERE id = %llu;", job);
+      count++;
+    }
+
+  g_debug ("%s: ran %i alerts", __func__, count);
+}
+
+/**
+ * @brief Get the number of alerts waiting in the queue.
+ *
+ * @param[out]  oldest  Seconds the oldest alert has been waiting.
+ *
+ * @return Number of queued alerts.
+ */
+int
+manage_alert_queue_depth (int *oldest)
+{
+  if (oldest)
+    *oldest = sql_int ("SELECT coalesce (max (m_now () - queued_time), 0)"
+                       " FROM alert_queue;");
+  return sql_int ("SELECT count (*) FROM alert_queue;");
+}
+
+/**
+ * @brief Run the alert queue workers and wait for them.
+ */
+static void
+dispatch_alerts ()
+{
+  int workers, worker, due;
+  GArray *pids;
+  guint index;
+
+  /* No workers run while this process holds the lock, so any claimed
+   * alerts were claimed by workers that died. */
+  sql ("UPDATE alert_queue SET worker = 0 WHERE worker != 0;");
+
+  /* Run alerts left in the queue even if the queue has been disabled. */
+  workers = MAX (alert_workers, 1);
+  due = sql_int ("SELECT count (*) FROM alert_queue"
+                 " WHERE next_time <= m_now ();");
+  workers = MIN (workers, due);
+
+  pids = g_array_new (FALSE, FALSE, sizeof (pid_t));
+  for (worker = 0; worker < workers; worker++)
+    {
+      pid_t worker_pid;
+
+      worker_pid = fork ();
+      if (worker_pid == 0)
+        {
+          /* Child.  Reopen the database (required after fork). */
+          reinit_manage_process ();
+          proctitle_set ("gvmd: Running alerts");
+          manage_process_register ("alert_worker", 0, 0);
+          alert_queue_work (MAX (MAX (alert_workers, 1) / 2, 1));
+          exit (EXIT_SUCCESS);
+        }
+      if (worker_pid == -1)
+        {
+          g_warning ("%s: fork: %s", __func__, strerror (errno));
+          break;
+        }
+      g_array_append_val (pids, worker_pid);
+    }
+
+  for (index = 0; index < pids->len; index++)
+    while (waitpid (g_array_index (pids, pid_t, index), NULL, 0) < 0
+           && errno == EINTR);
+  g_array_free (pids, TRUE);
+}
+
+/**
+ * @brief Start the alert queue workers if any alerts are due.
+ *
+ * A dispatcher child forks a bounded pool of workers and waits for them.
+ * At most one dispatcher runs at a time.  Each alert method may use at
+ * most half of the workers, so that a slow method cannot hold up the
+ * others.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ */
+void
+manage_dispatch_alerts (sigset_t *sigmask_current)
+{
+  if (sql_int ("SELECT EXISTS (SELECT * FROM alert_queue"
+               "               WHERE next_time <= m_now ());")
+      == 0)
+    return;
+
+  fork_locked_worker (sigmask_current,
+                      "gvm-alert-queue",
+                      "gvmd: Dispatching alerts",
+                      "alert_dispatcher",
+                      dispatch_alerts);
+}
+
+/**
+ * @brief Set the number of alert queue workers.
+ *
+ * @param[in]  new_workers  Number of workers, 0 to run alerts in the process
+ *                          that produced the event.
+ */
+void
+set_alert_workers (int new_workers)
+{
+  if (new_workers < 0)
+    alert_workers = 0;
+  else
+    alert_workers = new_workers;
+}
+
 /**
  * @brief Initialise an alert task iterator.
  *
@@ -14753,38 +15689,39 @@ append_to_task_string (task_t task, const char* field, const char* value)
    "hosts", "result_hosts", "fp_per_host", "log_per_host", "low_per_host",    \
    "medium_per_host", "high_per_host", "target", "usage_type", NULL }
 
+/**
+ * @brief SQL for a column of the report summary of the current task.
+ *
+ * @param[in]  column  Column of task_summaries.
+ */
+#define TASK_SUMMARY_COLUMN(column)                                         \
+  "(SELECT " column " FROM task_summaries WHERE task = tasks.id)"
+
 /**
  * @brief Task iterator columns.
  */
 #define TASK_ITERATOR_COLUMNS_INNER                                         \
    { "run_status", NULL, KEYWORD_TYPE_INTEGER },                            \
    {                                                                        \
-     "(SELECT count(*) FROM reports"                                        \
-     " WHERE task = tasks.id)",                                             \
+     "coalesce (" TASK_SUMMARY_COLUMN ("total") ", 0)",                     \
      "total",                                                               \
      KEYWORD_TYPE_INTEGER                                                   \
    },                                                                       \
    {                                                                        \
-     "(SELECT uuid FROM reports WHERE task = tasks.id"                      \
-     /* TODO 1 == TASK_STATUS_DONE */                                       \
-     " AND scan_run_status = 1"                                             \
-     " ORDER BY date ASC LIMIT 1)",                                         \
+     "(SELECT uuid FROM reports"                                            \
+     " WHERE id = " TASK_SUMMARY_COLUMN ("first_report") ")",               \
      "first_report",                                                        \
      KEYWORD_TYPE_STRING                                                    \
    },                                                                       \
    { "run_status_name (run_status)", "status", KEYWORD_TYPE_STRING },       \
    {                                                                        \
-     "(SELECT uuid FROM reports WHERE task = tasks.id"                      \
-     /* TODO 1 == TASK_STATUS_DONE */                                       \
-     " AND scan_run_status = 1"                                             \
-     " ORDER BY date DESC LIMIT 1)",                                        \
+     "(SELECT uuid FROM reports"                                            \
+     " WHERE id = " TASK_SUMMARY_COLUMN ("last_report") ")",                \
      "last_report",                                                         \
      KEYWORD_TYPE_STRING                                                    \
    },                                                                       \
    {                                                                        \
-     "(SELECT count(*) FROM reports"                                        \
-     /* TODO 1 == TASK_STATUS_DONE */                                       \
-     " WHERE task = tasks.id AND scan_run_status = 1)",                     \
+     "coalesce (" TASK_SUMMARY_COLUMN ("finished") ", 0)",                  \
      NULL,                                                                  \
      KEYWORD_TYPE_INTEGER                                                   \
    },                                                                       \
@@ -14829,22 +15766,8 @@ append_to_task_string (task_t task, const char* field, const char* value)
      "next_due",                                                             \
      KEYWORD_TYPE_INTEGER                                                    \
    },                                                                        \
-   {                                                                         \
-     "(SELECT date FROM reports WHERE task = tasks.id"                       \
-     /* TODO 1 == TASK_STATUS_DONE */                                        \
-     " AND scan_run_status = 1"                                              \
-     " ORDER BY date ASC LIMIT 1)",                                          \
-     "first",                                                                \
-     KEYWORD_TYPE_INTEGER                                                    \
-   },                                                                        \
-   {                                                                         \
-     "(SELECT date FROM reports WHERE task = tasks.id"                       \
-     /* TODO 1 == TASK_STATUS_DONE */                                        \
-     " AND scan_run_status = 1"                                              \
-     " ORDER BY date DESC LIMIT 1)",                                         \
-     "last",                                                                 \
-     KEYWORD_TYPE_INTEGER                                                    \
-   },                                                                        \
+   { TASK_SUMMARY_COLUMN ("first_date"), "first", KEYWORD_TYPE_INTEGER },    \
+   { TASK_SUMMARY_COLUMN ("last_date"), "last", KEYWORD_TYPE_INTEGER },      \
    {                                                                         \
      "CASE WHEN target IS null OR opts.ignore_severity != 0 THEN 0 ELSE"     \
      " report_severity_count (task_last_report (id),"                        \
@@ -15359,6 +16282,7 @@ void
 init_manage_process (const gchar *database)
 {
   lockfile_t lockfile;
+  gint64 lock_start;
 
   if (sql_is_open ())
     return;
@@ -15381,8 +16305,10 @@ init_manage_process (const gchar *database)
 
   /* Lock to avoid an error return from Postgres when multiple processes
    * create a function at the same time. */
+  lock_start = g_get_monotonic_time ();
   if (lockfile_lock (&lockfile, "gvm-create-functions"))
     abort ();
+  sql_lock_wait (__func__, g_get_monotonic_time () - lock_start);
   if (manage_create_sql_functions ())
     {
       lockfile_unlock (&lockfile);
@@ -15406,7 +16332,679 @@ reinit_manage_process ()
 }
 
 /**
- * @brief Update the memory cache of NVTs.
+ * @brief Magic at the start of the NVT cache file.
+ */
+#define NVTI_MAP_MAGIC "GVMDNVTI"
+
+/**
+ * @brief Version of the layout of the NVT cache file.
+ */
+#define NVTI_MAP_FORMAT 1
+
+/**
+ * @brief String offset of a NULL field in the NVT cache file.
+ */
+#define NVTI_MAP_NULL G_MAXUINT32
+
+/**
+ * @brief Fields of an NVT in the NVT cache file.
+ */
+typedef enum
+{
+  NVTI_MAP_OID,
+  NVTI_MAP_NAME,
+  NVTI_MAP_FAMILY,
+  NVTI_MAP_CVSS_BASE,
+  NVTI_MAP_TAG,
+  NVTI_MAP_SOLUTION,
+  NVTI_MAP_SOLUTION_TYPE,
+  NVTI_MAP_SOLUTION_METHOD,
+  NVTI_MAP_SUMMARY,
+  NVTI_MAP_INSIGHT,
+  NVTI_MAP_AFFECTED,
+  NVTI_MAP_IMPACT,
+  NVTI_MAP_DETECTION,
+  NVTI_MAP_QOD_TYPE,
+  NVTI_MAP_FIELD_COUNT
+} nvti_map_field_t;
+
+/**
+ * @brief Header of the NVT cache file.
+ *
+ * All offsets of sections are from the start of the file.  All string
+ * offsets are from the start of the string section.
+ */
+typedef struct
+{
+  char magic[8];           ///< NVTI_MAP_MAGIC, without the NUL.
+  guint32 format;          ///< NVTI_MAP_FORMAT.
+  guint32 count;           ///< Number of NVTs.
+  guint32 ref_count;       ///< Number of refs.
+  guint32 feed_version;    ///< String offset of NVT feed version.
+  guint64 records;         ///< Offset of NVT records, sorted by OID.
+  guint64 refs;            ///< Offset of refs.
+  guint64 strings;         ///< Offset of NUL terminated strings.
+  guint64 size;            ///< Size of file.
+} nvti_map_header_t;
+
+/**
+ * @brief An NVT in the NVT cache file.
+ */
+typedef struct
+{
+  guint32 fields[NVTI_MAP_FIELD_COUNT];  ///< String offsets of fields.
+  guint32 refs_start;                    ///< Index of first ref.
+  guint32 refs_count;                    ///< Number of refs.
+} nvti_map_record_t;
+
+/**
+ * @brief A ref of an NVT in the NVT cache file.
+ */
+typedef struct
+{
+  guint32 type;    ///< String offset of type.
+  guint32 id;      ///< String offset of ID.
+  guint32 text;    ///< String offset of text.
+} nvti_map_ref_t;
+
+/**
+ * @brief Mapped NVT cache file, or NULL.
+ *
+ * Processes forked after the file is mapped share the pages.
+ */
+static const char *nvti_map = NULL;
+
+/**
+ * @brief Size of nvti_map.
+ */
+static gsize nvti_map_size = 0;
+
+/**
+ * @brief NVTis decoded from the mapped NVT cache by lookup_nvti.
+ */
+static GHashTable *nvti_map_decoded = NULL;
+
+/**
+ * @brief Get the path of the NVT cache file.
+ *
+ * @return Freshly allocated path.
+ */
+static gchar *
+nvti_map_path ()
+{
+  return g_build_filename (GVMD_STATE_DIR, "nvti-cache", NULL);
+}
+
+/**
+ * @brief Get the header of the mapped NVT cache file.
+ *
+ * @return Header.
+ */
+static const nvti_map_header_t *
+nvti_map_header ()
+{
+  return (const nvti_map_header_t *) nvti_map;
+}
+
+/**
+ * @brief Get a string from the mapped NVT cache file.
+ *
+ * @param[in]  offset  String offset.
+ *
+ * @return String in the mapping, or NULL.
+ */
+static const char *
+nvti_map_string (guint32 offset)
+{
+  const nvti_map_header_t *header;
+
+  header = nvti_map_header ();
+  if (offset == NVTI_MAP_NULL
+      || header->strings + offset >= header->size)
+    return NULL;
+  return nvti_map + header->strings + offset;
+}
+
+/**
+ * @brief Find an NVT in the mapped NVT cache file.
+ *
+ * @param[in]  oid  OID of NVT.
+ *
+ * @return NVT record in the mapping, or NULL if there is no such NVT.
+ */
+static const nvti_map_record_t *
+nvti_map_lookup (const gchar *oid)
+{
+  const nvti_map_record_t *records;
+  guint32 low, high;
+
+  if (oid == NULL)
+    return NULL;
+
+  records = (const nvti_map_record_t *) (nvti_map
+                                         + nvti_map_header ()->records);
+  low = 0;
+  high = nvti_map_header ()->count;
+  while (low < high)
+    {
+      guint32 middle;
+      const char *middle_oid;
+      int cmp;
+
+      middle = low + (high - low) / 2;
+      middle_oid = nvti_map_string (records[middle].fields[NVTI_MAP_OID]);
+      cmp = strcmp (oid, middle_oid ? middle_oid : "");
+      if (cmp == 0)
+        return &records[middle];
+      if (cmp < 0)
+        high = middle;
+      else
+        low = middle + 1;
+    }
+  return NULL;
+}
+
+/**
+ * @brief Get a ref of an NVT from the mapped NVT cache file.
+ *
+ * @param[in]  record  NVT record.
+ * @param[in]  index   Index of ref within NVT.
+ *
+ * @return Ref in the mapping.
+ */
+static const nvti_map_ref_t *
+nvti_map_ref (const nvti_map_record_t *record, guint32 index)
+{
+  const nvti_map_ref_t *refs;
+
+  refs = (const nvti_map_ref_t *) (nvti_map + nvti_map_header ()->refs);
+  return &refs[record->refs_start + index];
+}
+
+/**
+ * @brief Unmap the NVT cache file.
+ */
+static void
+nvti_map_close ()
+{
+  if (nvti_map_decoded)
+    {
+      g_hash_table_destroy (nvti_map_decoded);
+      nvti_map_decoded = NULL;
+    }
+  if (nvti_map)
+    {
+      munmap ((void *) nvti_map, nvti_map_size);
+      nvti_map = NULL;
+      nvti_map_size = 0;
+    }
+}
+
+/**
+ * @brief Map the NVT cache file.
+ *
+ * @param[in]  feed_version  NVT feed version the file must be built from.
+ *
+ * @return 0 success, -1 error or file is missing or out of date.
+ */
+static int
+nvti_map_open (const gchar *feed_version)
+{
+  const nvti_map_header_t *header;
+  const char *file_feed_version;
+  struct stat state;
+  gchar *path;
+  void *map;
+  int fd;
+
+  path = nvti_map_path ();
+  fd = open (path, O_RDONLY);
+  g_free (path);
+  if (fd < 0)
+    return -1;
+
+  if (fstat (fd, &state) || state.st_size < (off_t) sizeof (*header))
+    {
+      close (fd);
+      return -1;
+    }
+
+  map = mmap (NULL, state.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      g_warning ("%s: mmap failed: %s", __func__, strerror (errno));
+      return -1;
+    }
+
+  /* Check the layout, so that lookups can trust the offsets. */
+  header = (const nvti_map_header_t *) map;
+  if (memcmp (header->magic, NVTI_MAP_MAGIC, sizeof (header->magic))
+      || header->format != NVTI_MAP_FORMAT
+      || header->size != (guint64) state.st_size
+      || header->records < sizeof (*header)
+      || header->records + header->count * sizeof (nvti_map_record_t)
+         > header->refs
+      || header->refs + header->ref_count * sizeof (nvti_map_ref_t)
+         > header->strings
+      || header->strings >= header->size
+      || ((const char *) map)[header->size - 1] != '\0')
+    {
+      g_warning ("%s: NVT cache file is invalid", __func__);
+      munmap (map, state.st_size);
+      return -1;
+    }
+
+  nvti_map_close ();
+  nvti_map = map;
+  nvti_map_size = state.st_size;
+
+  file_feed_version = nvti_map_string (header->feed_version);
+  if (g_strcmp0 (file_feed_version, feed_version))
+    {
+      nvti_map_close ();
+      return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief An NVT while building the NVT cache file.
+ */
+typedef struct
+{
+  nvti_map_record_t record;   ///< Record, with refs_start unset.
+  GArray *refs;               ///< Refs, of nvti_map_ref_t.
+} nvti_map_build_t;
+
+/**
+ * @brief Free an NVT used while building the NVT cache file.
+ *
+ * @param[in]  build  NVT.
+ */
+static void
+nvti_map_build_free (gpointer build)
+{
+  g_array_free (((nvti_map_build_t *) build)->refs, TRUE);
+  g_free (build);
+}
+
+/**
+ * @brief Add a string to the string section of the NVT cache file.
+ *
+ * Strings are stored once, because fields like family repeat a lot.
+ *
+ * @param[in]  strings  String section.
+ * @param[in]  offsets  Offsets of strings already stored, plus one.
+ * @param[in]  string   String.  NULL for a NULL field.
+ *
+ * @return String offset.
+ */
+static guint32
+nvti_map_build_string (GString *strings, GHashTable *offsets,
+                       const char *string)
+{
+  guint32 offset;
+
+  if (string == NULL)
+    return NVTI_MAP_NULL;
+
+  offset = GPOINTER_TO_UINT (g_hash_table_lookup (offsets, string));
+  if (offset)
+    return offset - 1;
+
+  offset = strings->len;
+  g_string_append_len (strings, string, strlen (string) + 1);
+  g_hash_table_insert (offsets, g_strdup (string),
+                       GUINT_TO_POINTER (offset + 1));
+  return offset;
+}
+
+/**
+ * @brief String section, for sorting NVTs while building the cache file.
+ */
+static GString *nvti_map_build_strings = NULL;
+
+/**
+ * @brief Compare NVTs by OID, while building the NVT cache file.
+ *
+ * @param[in]  one  First NVT.
+ * @param[in]  two  Second NVT.
+ *
+ * @return Result of strcmp on the OIDs.
+ */
+static gint
+nvti_map_build_compare (gconstpointer one, gconstpointer two)
+{
+  const nvti_map_build_t *build_one, *build_two;
+
+  build_one = *(nvti_map_build_t **) one;
+  build_two = *(nvti_map_build_t **) two;
+  return strcmp (nvti_map_build_strings->str
+                 + build_one->record.fields[NVTI_MAP_OID],
+                 nvti_map_build_strings->str
+                 + build_two->record.fields[NVTI_MAP_OID]);
+}
+
+/**
+ * @brief Number of rows per batch when streaming the NVTs into the cache.
+ */
+#define NVTI_CACHE_FETCH_SIZE 5000
+
+/**
+ * @brief SQL to get the NVTs and their refs for the NVT cache.
+ *
+ * Because there are many NVTs and many refs it's slow to query the refs
+ * for each NVT.  So this query gets the NVTs and their refs at the same
+ * time.
+ *
+ * The NVT data is duplicated in the result of the query when there are
+ * multiple refs for an NVT, so callers must check if they've already seen
+ * the NVT.  This also means we don't have to sort the data by NVT, which
+ * would make the query too slow.
+ */
+#define NVTI_CACHE_SQL                                                   \
+  "SELECT nvts.oid, nvts.name, nvts.family, nvts.cvss_base,"             \
+  "       nvts.tag, nvts.solution, nvts.solution_type,"                  \
+  "       nvts.solution_method, nvts.summary, nvts.insight,"             \
+  "       nvts.affected, nvts.impact, nvts.detection, nvts.qod_type,"    \
+  "       vt_refs.type, vt_refs.ref_id, vt_refs.ref_text"                \
+  " FROM nvts"                                                           \
+  " LEFT OUTER JOIN vt_refs ON nvts.oid = vt_refs.vt_oid;"
+
+/**
+ * @brief Write the NVT cache file from the database.
+ *
+ * The file is written to a temporary name and then renamed, so that
+ * processes never map a partly written file.
+ *
+ * @param[in]  feed_version  NVT feed version of the NVTs in the database.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+nvti_map_write (const gchar *feed_version)
+{
+  iterator_t nvts;
+  GHashTable *builds, *offsets;
+  GPtrArray *sorted;
+  GString *strings;
+  nvti_map_header_t header;
+  gchar *path, *temp_path;
+  guint32 ref_count;
+  guint index;
+  FILE *file;
+  int fd, ret, began;
+
+  builds = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                  nvti_map_build_free);
+  offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  strings = g_string_new ("");
+
+  /* Streaming needs a transaction that lasts as long as the loop. */
+  began = sql_in_transaction () == 0;
+  if (began)
+    sql_begin_immediate ();
+  init_iterator (&nvts, NVTI_CACHE_SQL);
+  iterator_stream (&nvts, NVTI_CACHE_FETCH_SIZE);
+  while (next (&nvts))
+    {
+      nvti_map_build_t *build;
+      const char *oid;
+
+      oid = iterator_string (&nvts, 0);
+      if (oid == NULL)
+        continue;
+
+      build = g_hash_table_lookup (builds, oid);
+      if (build == NULL)
+        {
+          int field;
+
+          build = g_malloc0 (sizeof (*build));
+          build->refs = g_array_new (FALSE, FALSE, sizeof (nvti_map_ref_t));
+          for (field = 0; field < NVTI_MAP_FIELD_COUNT; field++)
+            build->record.fields[field]
+              = nvti_map_build_string (strings, offsets,
+                                       iterator_string (&nvts, field));
+          g_hash_table_insert (builds, g_strdup (oid), build);
+        }
+
+      if (iterator_null (&nvts, NVTI_MAP_FIELD_COUNT + 1) == 0)
+        {
+          nvti_map_ref_t ref;
+
+          ref.type = nvti_map_build_string
+                      (strings, offsets,
+                       iterator_string (&nvts, NVTI_MAP_FIELD_COUNT));
+          ref.id = nvti_map_build_string
+                    (strings, offsets,
+                     iterator_string (&nvts, NVTI_MAP_FIELD_COUNT + 1));
+          ref.text = nvti_map_build_string
+                      (strings, offsets,
+                       iterator_string (&nvts, NVTI_MAP_FIELD_COUNT + 2));
+          g_array_append_val (build->refs, ref);
+        }
+    }
+  cleanup_iterator (&nvts);
+  if (began)
+    sql_commit ();
+  g_hash_table_destroy (offsets);
+
+  /* The feed version goes last, so that it can be the terminating NUL. */
+  memset (&header, 0, sizeof (header));
+  header.feed_version = strings->len;
+  g_string_append_len (strings, feed_version ? feed_version : "",
+                       strlen (feed_version ? feed_version : "") + 1);
+
+  if (strings->len >= NVTI_MAP_NULL)
+    {
+      g_warning ("%s: Too much NVT data for NVT cache file", __func__);
+      g_hash_table_destroy (builds);
+      g_string_free (strings, TRUE);
+      return -1;
+    }
+
+  /* Sort by OID, for lookups by binary search. */
+  sorted = g_ptr_array_new ();
+  ref_count = 0;
+  {
+    GHashTableIter iter;
+    gpointer build;
+
+    g_hash_table_iter_init (&iter, builds);
+    while (g_hash_table_iter_next (&iter, NULL, &build))
+      {
+        ((nvti_map_build_t *) build)->record.refs_start = ref_count;
+        ((nvti_map_build_t *) build)->record.refs_count
+          = ((nvti_map_build_t *) build)->refs->len;
+        ref_count += ((nvti_map_build_t *) build)->refs->len;
+        g_ptr_array_add (sorted, build);
+      }
+  }
+  nvti_map_build_strings = strings;
+  g_ptr_array_sort (sorted, nvti_map_build_compare);
+  nvti_map_build_strings = NULL;
+
+  memcpy (header.magic, NVTI_MAP_MAGIC, sizeof (header.magic));
+  header.format = NVTI_MAP_FORMAT;
+  header.count = sorted->len;
+  header.ref_count = ref_count;
+  header.records = sizeof (header);
+  header.refs = header.records + sorted->len * sizeof (nvti_map_record_t);
+  header.strings = header.refs + ref_count * sizeof (nvti_map_ref_t);
+  header.size = header.strings + strings->len;
+
+  path = nvti_map_path ();
+  temp_path = g_strdup_printf ("%s.XXXXXX", path);
+  fd = g_mkstemp (temp_path);
+  if (fd < 0)
+    {
+      g_warning ("%s: Failed to create %s: %s",
+                 __func__, temp_path, strerror (errno));
+      ret = -1;
+      goto free;
+    }
+  file = fdopen (fd, "w");
+  if (file == NULL)
+    {
+      close (fd);
+      unlink (temp_path);
+      ret = -1;
+      goto free;
+    }
+
+  /* Records must be written in sorted order, refs in the order of the
+   * refs_start values, which follows the hash table, not the sort. */
+  ret = fwrite (&header, sizeof (header), 1, file) == 1 ? 0 : -1;
+  for (index = 0; ret == 0 && index < sorted->len; index++)
+    {
+      nvti_map_build_t *build = g_ptr_array_index (sorted, index);
+      if (fwrite (&build->record, sizeof (build->record), 1, file) != 1)
+        ret = -1;
+    }
+  {
+    GHashTableIter iter;
+    gpointer build;
+
+    g_hash_table_iter_init (&iter, builds);
+    while (ret == 0 && g_hash_table_iter_next (&iter, NULL, &build))
+      if (((nvti_map_build_t *) build)->refs->len
+          && fwrite (((nvti_map_build_t *) build)->refs->data,
+                     sizeof (nvti_map_ref_t),
+                     ((nvti_map_build_t *) build)->refs->len,
+                     file)
+             != ((nvti_map_build_t *) build)->refs->len)
+        ret = -1;
+  }
+  if (ret == 0 && fwrite (strings->str, 1, strings->len, file) != strings->len)
+    ret = -1;
+  if (fclose (file))
+    ret = -1;
+
+  if (ret == 0 && rename (temp_path, path))
+    {
+      g_warning ("%s: Failed to rename %s: %s",
+                 __func__, temp_path, strerror (errno));
+      ret = -1;
+    }
+  if (ret)
+    unlink (temp_path);
+  else
+    g_debug ("%s: wrote %u NVTs to %s", __func__, sorted->len, path);
+
+ free:
+  g_free (path);
+  g_free (temp_path);
+  g_ptr_array_free (sorted, TRUE);
+  g_hash_table_destroy (builds);
+  g_string_free (strings, TRUE);
+  return ret;
+}
+
+/**
+ * @brief Get a field of an NVT from the NVT cache.
+ *
+ * When the cache file is mapped the string points into the mapping, so
+ * nothing is copied.
+ *
+ * @param[in]  oid    OID of NVT.
+ * @param[in]  field  Field.
+ *
+ * @return Field, or NULL if there is no such NVT or the field is NULL.
+ */
+static const char *
+nvti_cache_field (const gchar *oid, nvti_map_field_t field)
+{
+  nvti_t *nvti;
+
+  if (nvti_map)
+    {
+      const nvti_map_record_t *record;
+
+      record = nvti_map_lookup (oid);
+      if (record == NULL)
+        return NULL;
+      return nvti_map_string (record->fields[field]);
+    }
+
+  nvti = nvtis_lookup (nvti_cache, oid);
+  if (nvti == NULL)
+    return NULL;
+  switch (field)
+    {
+      case NVTI_MAP_OID:             return nvti_oid (nvti);
+      case NVTI_MAP_NAME:            return nvti_name (nvti);
+      case NVTI_MAP_FAMILY:          return nvti_family (nvti);
+      case NVTI_MAP_CVSS_BASE:       return nvti_cvss_base (nvti);
+      case NVTI_MAP_TAG:             return nvti_tag (nvti);
+      case NVTI_MAP_SOLUTION:        return nvti_solution (nvti);
+      case NVTI_MAP_SOLUTION_TYPE:   return nvti_solution_type (nvti);
+      case NVTI_MAP_SOLUTION_METHOD: return nvti_solution_method (nvti);
+      case NVTI_MAP_SUMMARY:         return nvti_summary (nvti);
+      case NVTI_MAP_INSIGHT:         return nvti_insight (nvti);
+      case NVTI_MAP_AFFECTED:        return nvti_affected (nvti);
+      case NVTI_MAP_IMPACT:          return nvti_impact (nvti);
+      case NVTI_MAP_DETECTION:       return nvti_detection (nvti);
+      case NVTI_MAP_QOD_TYPE:        return nvti_qod_type (nvti);
+      default:                       return NULL;
+    }
+}
+
+/**
+ * @brief Decode an NVT from the mapped NVT cache file.
+ *
+ * @param[in]  record  NVT record.
+ *
+ * @return Freshly allocated NVTi.
+ */
+static nvti_t *
+nvti_map_decode (const nvti_map_record_t *record)
+{
+  nvti_t *nvti;
+  guint32 index;
+
+  nvti = nvti_new ();
+  nvti_set_oid (nvti, nvti_map_string (record->fields[NVTI_MAP_OID]));
+  nvti_set_name (nvti, nvti_map_string (record->fields[NVTI_MAP_NAME]));
+  nvti_set_family (nvti, nvti_map_string (record->fields[NVTI_MAP_FAMILY]));
+  nvti_set_cvss_base (nvti,
+                      nvti_map_string (record->fields[NVTI_MAP_CVSS_BASE]));
+  nvti_set_tag (nvti, nvti_map_string (record->fields[NVTI_MAP_TAG]));
+  nvti_set_solution (nvti,
+                     nvti_map_string (record->fields[NVTI_MAP_SOLUTION]));
+  nvti_set_solution_type
+   (nvti, nvti_map_string (record->fields[NVTI_MAP_SOLUTION_TYPE]));
+  nvti_set_solution_method
+   (nvti, nvti_map_string (record->fields[NVTI_MAP_SOLUTION_METHOD]));
+  nvti_set_summary (nvti, nvti_map_string (record->fields[NVTI_MAP_SUMMARY]));
+  nvti_set_insight (nvti, nvti_map_string (record->fields[NVTI_MAP_INSIGHT]));
+  nvti_set_affected (nvti,
+                     nvti_map_string (record->fields[NVTI_MAP_AFFECTED]));
+  nvti_set_impact (nvti, nvti_map_string (record->fields[NVTI_MAP_IMPACT]));
+  nvti_set_detection (nvti,
+                      nvti_map_string (record->fields[NVTI_MAP_DETECTION]));
+  nvti_set_qod_type (nvti,
+                     nvti_map_string (record->fields[NVTI_MAP_QOD_TYPE]));
+  for (index = 0; index < record->refs_count; index++)
+    {
+      const nvti_map_ref_t *ref;
+
+      ref = nvti_map_ref (record, index);
+      nvti_add_vtref (nvti,
+                      vtref_new (nvti_map_string (ref->type),
+                                 nvti_map_string (ref->id),
+                                 nvti_map_string (ref->text)));
+    }
+  return nvti;
+}
+
+/**
+ * @brief Look up an NVT in the NVT cache.
+ *
+ * With the cache file mapped, the NVTi is decoded on the first lookup and
+ * kept until the cache is reloaded.
  *
  * @param[in]  nvt  NVT.
  *
@@ -15415,37 +17013,52 @@ reinit_manage_process ()
 nvti_t *
 lookup_nvti (const gchar *nvt)
 {
-  return nvtis_lookup (nvti_cache, nvt);
+  const nvti_map_record_t *record;
+  nvti_t *nvti;
+
+  if (nvti_map == NULL)
+    return nvtis_lookup (nvti_cache, nvt);
+
+  if (nvt == NULL)
+    return NULL;
+
+  if (nvti_map_decoded == NULL)
+    nvti_map_decoded = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free,
+                                              (GDestroyNotify) nvti_free);
+  nvti = g_hash_table_lookup (nvti_map_decoded, nvt);
+  if (nvti)
+    return nvti;
+
+  record = nvti_map_lookup (nvt);
+  if (record == NULL)
+    return NULL;
+  nvti = nvti_map_decode (record);
+  g_hash_table_insert (nvti_map_decoded, g_strdup (nvt), nvti);
+  return nvti;
 }
 
 /**
- * @brief Update the memory cache of NVTs.
+ * @brief Load the memory cache of NVTs from the database.
+ *
+ * This is the fallback for when the NVT cache file cannot be written.
  */
 static void
-update_nvti_cache ()
+update_nvti_heap_cache ()
 {
   iterator_t nvts;
+  int began;
 
   nvtis_free (nvti_cache);
 
   nvti_cache = nvtis_new ();
 
-  /* Because there are many NVTs and many refs it's slow to query the refs
-   * for each NVT.  So this query gets the NVTs and their refs at the same
-   * time.
-   *
-   * The NVT data is duplicated in the result of the query when there are
-   * multiple refs for an NVT, but the loop below uses nvtis_lookup to
-   * check if we've already seen the NVT.  This also means we don't have
-   * to sort the data by NVT, which would make the query too slow. */
-  init_iterator (&nvts,
-                 "SELECT nvts.oid, nvts.name, nvts.family, nvts.cvss_base,"
-                 "       nvts.tag, nvts.solution, nvts.solution_type,"
-                 "       nvts.summary, nvts.insight, nvts.affected,"
-                 "       nvts.impact, nvts.detection, nvts.qod_type,"
-                 "       vt_refs.type, vt_refs.ref_id, vt_refs.ref_text"
-                 " FROM nvts"
-                 " LEFT OUTER JOIN vt_refs ON nvts.oid = vt_refs.vt_oid;");
+  /* Streaming needs a transaction that lasts as long as the loop. */
+  began = sql_in_transaction () == 0;
+  if (began)
+    sql_begin_immediate ();
+  init_iterator (&nvts, NVTI_CACHE_SQL);
+  iterator_stream (&nvts, NVTI_CACHE_FETCH_SIZE);
 
   while (next (&nvts))
     {
@@ -15462,26 +17075,78 @@ update_nvti_cache ()
           nvti_set_tag (nvti, iterator_string (&nvts, 4));
           nvti_set_solution (nvti, iterator_string (&nvts, 5));
           nvti_set_solution_type (nvti, iterator_string (&nvts, 6));
-          nvti_set_summary (nvti, iterator_string (&nvts, 7));
-          nvti_set_insight (nvti, iterator_string (&nvts, 8));
-          nvti_set_affected (nvti, iterator_string (&nvts, 9));
-          nvti_set_impact (nvti, iterator_string (&nvts, 10));
-          nvti_set_detection (nvti, iterator_string (&nvts, 11));
-          nvti_set_qod_type (nvti, iterator_string (&nvts, 12));
+          nvti_set_solution_method (nvti, iterator_string (&nvts, 7));
+          nvti_set_summary (nvti, iterator_string (&nvts, 8));
+          nvti_set_insight (nvti, iterator_string (&nvts, 9));
+          nvti_set_affected (nvti, iterator_string (&nvts, 10));
+          nvti_set_impact (nvti, iterator_string (&nvts, 11));
+          nvti_set_detection (nvti, iterator_string (&nvts, 12));
+          nvti_set_qod_type (nvti, iterator_string (&nvts, 13));
 
           nvtis_add (nvti_cache, nvti);
         }
 
-      if (iterator_null (&nvts, 14))
+      if (iterator_null (&nvts, 15))
         /* No refs. */;
       else
         nvti_add_vtref (nvti,
-                        vtref_new (iterator_string (&nvts, 13),
-                                   iterator_string (&nvts, 14),
-                                   iterator_string (&nvts, 15)));
+                        vtref_new (iterator_string (&nvts, 14),
+                                   iterator_string (&nvts, 15),
+                                   iterator_string (&nvts, 16)));
     }
 
   cleanup_iterator (&nvts);
+  if (began)
+    sql_commit ();
+}
+
+/**
+ * @brief Update the cache of NVTs from the database.
+ *
+ * Write and map the NVT cache file, falling back to a cache on the heap.
+ */
+static void
+update_nvti_cache ()
+{
+  g_free (nvti_cache_feed_version);
+  nvti_cache_feed_version = nvts_feed_version ();
+
+  nvti_map_close ();
+  if (nvti_map_write (nvti_cache_feed_version) == 0
+      && nvti_map_open (nvti_cache_feed_version) == 0)
+    {
+      nvtis_free (nvti_cache);
+      nvti_cache = NULL;
+      return;
+    }
+
+  g_warning ("%s: Failed to set up NVT cache file, caching NVTs in memory",
+             __func__);
+  update_nvti_heap_cache ();
+}
+
+/**
+ * @brief Load the cache of NVTs, using the cache file if it is current.
+ *
+ * Only rebuild the cache if no process has written the file for the
+ * current NVT feed version yet.
+ */
+static void
+load_nvti_cache ()
+{
+  gchar *feed_version;
+
+  feed_version = nvts_feed_version ();
+  if (nvti_map_open (feed_version) == 0)
+    {
+      nvtis_free (nvti_cache);
+      nvti_cache = NULL;
+      g_free (nvti_cache_feed_version);
+      nvti_cache_feed_version = feed_version;
+      return;
+    }
+  g_free (feed_version);
+  update_nvti_cache ();
 }
 
 /**
@@ -16102,6 +17767,7 @@ check_db_permissions ()
            "                WHERE uuid = '" ROLE_UUID_MONITOR "');");
     }
   add_role_permission (ROLE_UUID_MONITOR, "AUTHENTICATE");
+  add_role_permission (ROLE_UUID_MONITOR, "GET_PROCESSES");
   add_role_permission (ROLE_UUID_MONITOR, "GET_SETTINGS");
   add_role_permission (ROLE_UUID_MONITOR, "GET_SYSTEM_REPORTS");
   add_role_permission (ROLE_UUID_MONITOR, "HELP");
@@ -16122,6 +17788,7 @@ check_db_permissions ()
   while (command[0].name)
     {
       if (strstr (command[0].name, "DESCRIBE_AUTH") == NULL
+          && strcmp (command[0].name, "GET_PROCESSES")
           && strcmp (command[0].name, "GET_VERSION")
           && strstr (command[0].name, "GROUP") == NULL
           && strstr (command[0].name, "ROLE") == NULL
@@ -16148,6 +17815,7 @@ check_db_permissions ()
     {
       if ((strstr (command[0].name, "GET") == command[0].name)
           && strcmp (command[0].name, "GET_GROUPS")
+          && strcmp (command[0].name, "GET_PROCESSES")
           && strcmp (command[0].name, "GET_ROLES")
           && strcmp (command[0].name, "GET_USERS")
           && strcmp (command[0].name, "GET_VERSION"))
@@ -16347,38 +18015,135 @@ manage_migrate_relay_sensors ()
     }
 }
 
+/**
+ * @brief Start the background migration steps if there are any queued.
+ *
+ * The steps run in a child process, which commits after each batch, so
+ * that a large data rewrite does not keep the Manager offline.  At most
+ * one such child runs at a time.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ */
+void
+manage_run_migration_steps (sigset_t *sigmask_current)
+{
+  if (migration_steps_queued () == 0)
+    return;
+
+  fork_locked_worker (sigmask_current,
+                      "gvm-migration-steps",
+                      "gvmd: Running migration steps",
+                      "migration_steps",
+                      migration_steps_run);
+}
+
+/**
+ * @brief Get a fingerprint of what the startup checks of the database ensure.
+ *
+ * Covers the gvmd and database versions, the NVT feed version, the feed
+ * import owner, and the predefined roles, permissions, settings, scanners
+ * and NVT selectors.
+ *
+ * @return Freshly allocated fingerprint.
+ */
+static gchar *
+check_db_fingerprint ()
+{
+  gchar *resources, *fingerprint;
+
+  resources = sql_string ("SELECT md5 (concat_ws"
+                          "             (';',"
+                          "              (SELECT value FROM meta"
+                          "               WHERE name = 'nvts_feed_version'),"
+                          "              (SELECT value FROM settings"
+                          "               WHERE uuid = '%s'"
+                          "               AND owner IS NULL),"
+                          "              (SELECT string_agg (uuid, ','"
+                          "                                  ORDER BY uuid)"
+                          "               FROM roles),"
+                          "              (SELECT count (*) FROM permissions"
+                          "               WHERE owner IS NULL),"
+                          "              (SELECT string_agg (uuid, ','"
+                          "                                  ORDER BY uuid)"
+                          "               FROM settings WHERE owner IS NULL),"
+                          "              (SELECT string_agg (uuid, ','"
+                          "                                  ORDER BY uuid)"
+                          "               FROM scanners WHERE owner IS NULL),"
+                          "              (SELECT count (*)"
+                          "               FROM nvt_selectors)));",
+                          SETTING_UUID_FEED_IMPORT_OWNER);
+  fingerprint = g_strdup_printf ("%s %i %s",
+                                 GVMD_VERSION,
+                                 GVMD_DATABASE_VERSION,
+                                 resources ? resources : "");
+  g_free (resources);
+  return fingerprint;
+}
+
 /**
  * @brief Ensure that the database is in order.
  *
  * Only called by init_manage_internal, and ultimately only by the main process.
  *
+ * The checks of predefined resources are skipped when the fingerprint of
+ * the database matches the one recorded after the last full check.  Then
+ * the syncs of configs, port lists and report formats with the feed are
+ * left to manage_sync, which runs them once the Manager is listening.
+ *
  * @param[in]  check_encryption_key  Whether to check encryption key.
+ * @param[out] full                  Whether the full checks ran.
  *
  * @return 0 success, -1 error.
  */
 static int
-check_db (int check_encryption_key)
+check_db (int check_encryption_key, int *full)
 {
+  gchar *fingerprint, *last_fingerprint;
+
   /* The file locks managed at startup ensure that this is the only Manager
    * process accessing the db.  Nothing else should be accessing the db, access
    * should always go through Manager. */
   sql_begin_immediate ();
   create_tables ();
   check_db_sequences ();
+  task_summaries_update ("tasks.id NOT IN (SELECT task FROM task_summaries)");
   set_db_version (GVMD_DATABASE_VERSION);
-  check_db_roles ();
-  check_db_nvt_selectors ();
+
+  fingerprint = check_db_fingerprint ();
+  last_fingerprint = sql_string ("SELECT value FROM meta"
+                                 " WHERE name = 'check_db_fingerprint';");
+  *full = (last_fingerprint == NULL
+           || strcmp (last_fingerprint, fingerprint));
+  g_free (last_fingerprint);
+  g_free (fingerprint);
+
+  if (*full)
+    {
+      check_db_roles ();
+      check_db_nvt_selectors ();
+    }
+  else
+    g_info ("%s: Database unchanged since last full check,"
+            " skipping checks of predefined resources",
+            __func__);
   check_db_nvts ();
-  check_db_port_lists ();
+  if (*full)
+    check_db_port_lists ();
   clean_auth_cache ();
-  if (check_db_scanners ())
-    goto fail;
-  if (check_db_report_formats ())
-    goto fail;
+  if (*full)
+    {
+      if (check_db_scanners ())
+        goto fail;
+      if (check_db_report_formats ())
+        goto fail;
+    }
   if (check_db_report_formats_trash ())
     goto fail;
-  check_db_permissions ();
-  check_db_settings ();
+  if (*full)
+    {
+      check_db_permissions ();
+      check_db_settings ();
+    }
   cleanup_schedule_times ();
   if (check_encryption_key && check_db_encryption_key ())
     goto fail;
@@ -16391,14 +18156,40 @@ check_db (int check_encryption_key)
   return -1;
 }
 
+/**
+ * @brief Record the fingerprint of the database after a full check.
+ */
+static void
+check_db_fingerprint_record ()
+{
+  gchar *fingerprint, *quoted;
+
+  fingerprint = check_db_fingerprint ();
+  quoted = sql_quote (fingerprint);
+  g_free (fingerprint);
+  sql ("DELETE FROM meta WHERE name = 'check_db_fingerprint';");
+  sql ("INSERT INTO meta (name, value)"
+       " VALUES ('check_db_fingerprint', '%s');",
+       quoted);
+  g_free (quoted);
+}
+
 /**
  * @brief Stop any active tasks.
+ *
+ * In a cluster the tasks of the other live nodes are still running, and
+ * the scan supervisor takes over the OSP scans of dead nodes, so these
+ * are left alone.
  */
 static void
 stop_active_tasks ()
 {
   iterator_t tasks;
   get_data_t get;
+  gchar *own_tasks, *own_reports;
+
+  own_tasks = cluster_own_tasks ("id");
+  own_reports = cluster_own_tasks ("task");
 
   /* Set requested and running tasks to stopped. */
 
@@ -16420,6 +18211,12 @@ stop_active_tasks ()
           case TASK_STATUS_STOP_WAITING:
             {
               task_t index = get_iterator_resource (&tasks);
+              if (sql_int ("SELECT count (*) FROM tasks"
+                           " WHERE id = %llu AND %s;",
+                           index,
+                           own_tasks)
+                  == 0)
+                break;
               /* Set the current user, for event checks. */
               current_credentials.uuid = task_owner_uuid (index);
               task_last_report_any_status (index, &global_current_report);
@@ -16442,15 +18239,16 @@ stop_active_tasks ()
   /* Set requested and running reports to stopped. */
 
   sql ("UPDATE reports SET scan_run_status = %u"
-       " WHERE scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u"
-       " OR scan_run_status = %u;",
+       " WHERE (scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u"
+       "        OR scan_run_status = %u)"
+       " AND %s;",
        TASK_STATUS_INTERRUPTED,
        TASK_STATUS_DELETE_REQUESTED,
        TASK_STATUS_DELETE_ULTIMATE_REQUESTED,
@@ -16460,7 +18258,41 @@ stop_active_tasks ()
        TASK_STATUS_RUNNING,
        TASK_STATUS_STOP_REQUESTED,
        TASK_STATUS_STOP_REQUESTED_GIVEUP,
+       TASK_STATUS_STOP_WAITING,
+       own_reports);
+  g_free (own_tasks);
+  g_free (own_reports);
+
+  sql ("DELETE FROM cluster_tasks"
+       " WHERE task NOT IN (SELECT id FROM tasks"
+       "                    WHERE run_status IN (%u, %u, %u, %u, %u, %u, %u,"
+       "                                         %u, %u));",
+       TASK_STATUS_DELETE_REQUESTED,
+       TASK_STATUS_DELETE_ULTIMATE_REQUESTED,
+       TASK_STATUS_DELETE_ULTIMATE_WAITING,
+       TASK_STATUS_DELETE_WAITING,
+       TASK_STATUS_REQUESTED,
+       TASK_STATUS_RUNNING,
+       TASK_STATUS_STOP_REQUESTED,
+       TASK_STATUS_STOP_REQUESTED_GIVEUP,
        TASK_STATUS_STOP_WAITING);
+
+  /* Move the live progress of the ended reports into the reports. */
+
+  sql ("UPDATE reports"
+       " SET slave_progress = live_report_progress.progress"
+       " FROM live_report_progress"
+       " WHERE live_report_progress.report = reports.id"
+       " AND reports.scan_run_status IN (%u, %u, %u);",
+       TASK_STATUS_DONE,
+       TASK_STATUS_STOPPED,
+       TASK_STATUS_INTERRUPTED);
+  sql ("DELETE FROM live_report_progress"
+       " WHERE report NOT IN (SELECT id FROM reports"
+       "                      WHERE scan_run_status NOT IN (%u, %u, %u));",
+       TASK_STATUS_DONE,
+       TASK_STATUS_STOPPED,
+       TASK_STATUS_INTERRUPTED);
 }
 
 /**
@@ -16557,7 +18389,7 @@ init_manage_internal (GSList *log_config,
                       int skip_db_check,
                       int check_encryption_key)
 {
-  int ret;
+  int ret, full_db_check;
 
   /* Summary of init cases:
    *
@@ -16616,6 +18448,7 @@ init_manage_internal (GSList *log_config,
   memset (&current_credentials, '\0', sizeof (current_credentials));
 
   init_manage_process (database);
+  full_db_check = 0;
 
   /* Check that the versions of the databases are correct. */
 
@@ -16634,7 +18467,7 @@ init_manage_internal (GSList *log_config,
     {
       /* This only happens for init_manage callers with skip_db_check set, so
        * there is ultimately only one caller case, the main process. */
-      ret = check_db (check_encryption_key);
+      ret = check_db (check_encryption_key, &full_db_check);
       if (ret)
         return ret;
 
@@ -16647,17 +18480,24 @@ init_manage_internal (GSList *log_config,
     }
 
   if (stop_tasks)
-    /* Stop any active tasks. */
-    stop_active_tasks ();
+    {
+      /* Stop any active tasks.  In a cluster this leaves the tasks of the
+       * other live nodes, and the OSP scans of dead nodes, which the scan
+       * supervisor takes over. */
+      stop_active_tasks ();
+    }
 
   /* Load the NVT cache into memory. */
 
-  if (nvti_cache == NULL)
-    update_nvti_cache ();
+  if (nvti_cache == NULL && nvti_map == NULL)
+    load_nvti_cache ();
 
-  if (skip_db_check == 0)
-    /* Requires NVT cache. */
-    check_db_configs ();
+  if (skip_db_check == 0 && full_db_check)
+    {
+      /* Requires NVT cache. */
+      check_db_configs ();
+      check_db_fingerprint_record ();
+    }
 
   sql_close ();
   gvmd_db_name = database ? g_strdup (database) : NULL;
@@ -16768,6 +18608,8 @@ cleanup_manage_process (gboolean cleanup)
                 }
               set_task_run_status (current_scanner_task, TASK_STATUS_INTERRUPTED);
             }
+          manage_lock_stats_flush ();
+          manage_process_unregister ();
           sql_close ();
         }
       else
@@ -16775,6 +18617,42 @@ cleanup_manage_process (gboolean cleanup)
     }
 }
 
+/**
+ * @brief Reset the manage library between clients of a reused process.
+ *
+ * Keep the database connection and NVT cache, but drop everything that
+ * belongs to the previous client.  Reload the NVT cache if the NVT feed
+ * changed since it was loaded.
+ */
+void
+reset_manage_process ()
+{
+  manage_reset_currents ();
+
+  if (sql_is_open () == 0)
+    return;
+
+  if (sql_in_transaction ())
+    {
+      g_warning ("%s: rolling back transaction left open by client",
+                 __func__);
+      sql_rollback ();
+    }
+
+  sql ("SET SESSION \"gvmd.user.uuid\" = '';");
+  sql ("SET SESSION \"gvmd.tz_override\" = '';");
+
+  if (nvti_cache || nvti_map)
+    {
+      gchar *feed_version;
+
+      feed_version = nvts_feed_version ();
+      if (g_strcmp0 (feed_version, nvti_cache_feed_version))
+        load_nvti_cache ();
+      g_free (feed_version);
+    }
+}
+
 /**
  * @brief Cleanup as immediately as possible.
  *
@@ -17253,6 +19131,227 @@ authenticate (credentials_t* credentials)
   return 1;
 }
 
+/**
+ * @brief Seconds that an authentication token is valid, 0 for no tokens.
+ */
+static int auth_token_lifetime = AUTH_TOKEN_LIFETIME_DEFAULT;
+
+/**
+ * @brief Key that authentication tokens are signed with.
+ *
+ * Generated when the token lifetime is set, so that all the processes
+ * forked after that share it.  Tokens die with the main process.
+ *
+ * Tokens of a single user are revoked by increasing the token generation
+ * of the user, see auth_tokens_revoke.
+ */
+static guchar auth_token_key[32];
+
+/**
+ * @brief Set the lifetime of authentication tokens.
+ *
+ * @param[in]  lifetime  Seconds that a token is valid, 0 for no tokens.
+ */
+void
+set_auth_token_lifetime (int lifetime)
+{
+  if (lifetime <= 0)
+    {
+      auth_token_lifetime = 0;
+      return;
+    }
+
+  if (gnutls_rnd (GNUTLS_RND_KEY, auth_token_key, sizeof (auth_token_key)))
+    {
+      g_warning ("%s: failed to generate token key, tokens disabled",
+                 __func__);
+      auth_token_lifetime = 0;
+      return;
+    }
+  auth_token_lifetime = lifetime;
+}
+
+/**
+ * @brief Sign the fields of an authentication token.
+ *
+ * @param[in]  uuid        UUID of user.
+ * @param[in]  username    Name of user.
+ * @param[in]  expiry      Time at which the token expires.
+ * @param[in]  generation  Token generation of user.
+ *
+ * @return Freshly allocated hex signature.
+ */
+static gchar *
+auth_token_signature (const char *uuid, const char *username, time_t expiry,
+                      long long generation)
+{
+  gchar *data, *signature;
+
+  data = g_strdup_printf ("%s:%lld:%lld:%s", uuid, (long long) expiry,
+                          generation, username);
+  signature = g_compute_hmac_for_string (G_CHECKSUM_SHA256,
+                                         auth_token_key,
+                                         sizeof (auth_token_key),
+                                         data,
+                                         -1);
+  g_free (data);
+  return signature;
+}
+
+/**
+ * @brief Create an authentication token for authenticated credentials.
+ *
+ * @param[in]  credentials  Credentials, after successful authentication.
+ *
+ * @return Freshly allocated token, or NULL if tokens are disabled.
+ */
+gchar *
+auth_token_new (credentials_t *credentials)
+{
+  gchar *signature, *token, *quoted_uuid;
+  long long generation;
+  time_t expiry;
+  int ret;
+
+  if (auth_token_lifetime == 0
+      || credentials->uuid == NULL
+      || credentials->username == NULL)
+    return NULL;
+
+  quoted_uuid = sql_quote (credentials->uuid);
+  ret = sql_int64 (&generation,
+                   "SELECT auth_token_generation FROM users"
+                   " WHERE uuid = '%s';",
+                   quoted_uuid);
+  g_free (quoted_uuid);
+  if (ret)
+    return NULL;
+
+  expiry = time (NULL) + auth_token_lifetime;
+  signature = auth_token_signature (credentials->uuid,
+                                    credentials->username,
+                                    expiry,
+                                    generation);
+  token = g_strdup_printf ("%s:%lld:%lld:%s", credentials->uuid,
+                           (long long) expiry, generation, signature);
+  g_free (signature);
+  return token;
+}
+
+/**
+ * @brief Revoke all authentication tokens of a user.
+ *
+ * Called when the password, authentication method or name of the user
+ * changes.  Tokens of deleted users fail because the user is gone.
+ *
+ * It's up to the caller to provide the transaction.
+ *
+ * @param[in]  user  User.
+ */
+static void
+auth_tokens_revoke (user_t user)
+{
+  sql ("UPDATE users SET auth_token_generation = auth_token_generation + 1"
+       " WHERE id = %llu;",
+       user);
+}
+
+/**
+ * @brief Authenticate credentials with a token from auth_token_new.
+ *
+ * Only checks the signature, the expiry and the token generation of the
+ * user, so neither the password hash nor any LDAP or RADIUS server is
+ * consulted.
+ *
+ * @param[in]  credentials  Credentials.  Username must be set.
+ * @param[in]  token        Token.
+ *
+ * @return 0 authentication success, 1 authentication failure, 99 permission
+ *         denied, -1 error.
+ */
+int
+authenticate_token (credentials_t *credentials, const char *token)
+{
+  gchar **fields, *signature, *end, *quoted_uuid, *quoted_name;
+  long long expiry, generation, current;
+  size_t index;
+  int diff, ret;
+
+  if (auth_token_lifetime == 0 || credentials->username == NULL)
+    return 1;
+
+  fields = g_strsplit (token, ":", 0);
+  if (g_strv_length (fields) != 4)
+    {
+      g_strfreev (fields);
+      return 1;
+    }
+
+  expiry = strtoll (fields[1], &end, 10);
+  if (*fields[1] == '\0' || *end != '\0' || expiry < time (NULL))
+    {
+      g_strfreev (fields);
+      return 1;
+    }
+
+  generation = strtoll (fields[2], &end, 10);
+  if (*fields[2] == '\0' || *end != '\0')
+    {
+      g_strfreev (fields);
+      return 1;
+    }
+
+  signature = auth_token_signature (fields[0], credentials->username,
+                                    (time_t) expiry, generation);
+  if (strlen (signature) != strlen (fields[3]))
+    diff = 1;
+  else
+    {
+      /* Compare in constant time. */
+      diff = 0;
+      for (index = 0; signature[index]; index++)
+        diff |= signature[index] ^ fields[3][index];
+    }
+  g_free (signature);
+  if (diff)
+    {
+      g_strfreev (fields);
+      return 1;
+    }
+
+  /* A user that was deleted, or whose tokens were revoked, fails like a
+   * wrong password. */
+  quoted_uuid = sql_quote (fields[0]);
+  quoted_name = sql_quote (credentials->username);
+  ret = sql_int64 (&current,
+                   "SELECT auth_token_generation FROM users"
+                   " WHERE uuid = '%s' AND name = '%s';",
+                   quoted_uuid,
+                   quoted_name);
+  g_free (quoted_uuid);
+  g_free (quoted_name);
+  if (ret || current != generation)
+    {
+      g_strfreev (fields);
+      return 1;
+    }
+
+  credentials->uuid = g_strdup (fields[0]);
+  g_strfreev (fields);
+
+  if (credentials_setup (credentials))
+    {
+      free (credentials->uuid);
+      credentials->uuid = NULL;
+      credentials->role = NULL;
+      return 99;
+    }
+
+  manage_session_init (credentials->uuid);
+
+  return 0;
+}
+
 /**
  * @brief Return number of resources of a certain type for current user.
  *
@@ -17774,8 +19873,9 @@ set_task_usage_type (task_t task, const char *usage_type)
 task_status_t
 task_run_status (task_t task)
 {
-  return (unsigned int) sql_int ("SELECT run_status FROM tasks WHERE id = %llu;",
-                                 task);
+  return (unsigned int) sql_int_ps ("SELECT run_status FROM tasks"
+                                    " WHERE id = $1;",
+                                    SQL_RESOURCE_PARAM (task), NULL);
 }
 
 /**
@@ -17825,6 +19925,11 @@ set_task_run_status_internal (task_t task, task_status_t status)
       sql ("UPDATE reports SET scan_run_status = %u WHERE id = %llu;",
            status,
            global_current_report);
+      if (status == TASK_STATUS_DONE
+          || status == TASK_STATUS_STOPPED
+          || status == TASK_STATUS_INTERRUPTED)
+        report_live_progress_end (global_current_report);
+      task_summary_update (task);
       if (setting_auto_cache_rebuild_int ())
         report_cache_counts (global_current_report, 0, 0, NULL);
     }
@@ -17832,6 +19937,14 @@ set_task_run_status_internal (task_t task, task_status_t status)
   sql ("UPDATE tasks SET run_status = %u WHERE id = %llu;",
        status,
        task);
+  cluster_task_status (task, status);
+
+  /* A due start may wait for the task to end, and a stop for it to run. */
+  if (status == TASK_STATUS_DONE
+      || status == TASK_STATUS_INTERRUPTED
+      || status == TASK_STATUS_STOPPED
+      || status == TASK_STATUS_RUNNING)
+    task_schedules_changed ();
 }
 
 /**
@@ -17882,10 +19995,10 @@ set_task_requested (task_t task, task_status_t *status)
 
   assert ((task != current_scanner_task) && (global_current_report == 0));
 
-  /* Locking here prevents another process from starting the task
-   * concurrently. */
+  /* Locking the row of the task here prevents another process from starting
+   * or deleting the task concurrently, without holding up other tasks. */
   sql_begin_immediate ();
-  if (sql_error ("LOCK table tasks IN ACCESS EXCLUSIVE MODE;"))
+  if (sql_error ("SELECT id FROM tasks WHERE id = %llu FOR UPDATE;", task))
     {
       sql_rollback ();
       return 1;
@@ -17912,6 +20025,7 @@ set_task_requested (task_t task, task_status_t *status)
   sql ("UPDATE tasks SET run_status = %u WHERE id = %llu;",
        TASK_STATUS_REQUESTED,
        task);
+  cluster_task_status (task, TASK_STATUS_REQUESTED);
 
   task_uuid (task, &uuid);
   name = task_name (task);
@@ -18138,6 +20252,67 @@ task_report_previous (task_t task, report_t report, report_t *previous)
   return 0;
 }
 
+/**
+ * @brief Rebuild the report summaries of tasks.
+ *
+ * @param[in]  where  SQL clause selecting the tasks.
+ */
+static void
+task_summaries_update (const char *where)
+{
+  sql ("INSERT INTO task_summaries"
+       " (task, total, finished, first_report, first_date, last_report,"
+       "  last_date, second_last_report)"
+       " SELECT id,"
+       "        (SELECT count (*) FROM reports WHERE task = tasks.id),"
+       "        (SELECT count (*) FROM reports"
+       "         WHERE task = tasks.id AND scan_run_status = %u),"
+       "        first.id, first.date, last.id, last.date,"
+       "        (SELECT id FROM reports"
+       "         WHERE task = tasks.id AND scan_run_status = %u"
+       "         ORDER BY date DESC LIMIT 1 OFFSET 1)"
+       " FROM tasks"
+       " LEFT JOIN LATERAL (SELECT id, date FROM reports"
+       "                    WHERE task = tasks.id AND scan_run_status = %u"
+       "                    ORDER BY date ASC LIMIT 1)"
+       "           AS first ON true"
+       " LEFT JOIN LATERAL (SELECT id, date FROM reports"
+       "                    WHERE task = tasks.id AND scan_run_status = %u"
+       "                    ORDER BY date DESC LIMIT 1)"
+       "           AS last ON true"
+       " WHERE %s"
+       " ON CONFLICT (task) DO UPDATE"
+       " SET total = EXCLUDED.total,"
+       "     finished = EXCLUDED.finished,"
+       "     first_report = EXCLUDED.first_report,"
+       "     first_date = EXCLUDED.first_date,"
+       "     last_report = EXCLUDED.last_report,"
+       "     last_date = EXCLUDED.last_date,"
+       "     second_last_report = EXCLUDED.second_last_report;",
+       TASK_STATUS_DONE,
+       TASK_STATUS_DONE,
+       TASK_STATUS_DONE,
+       TASK_STATUS_DONE,
+       where);
+}
+
+/**
+ * @brief Rebuild the report summary of a task.
+ *
+ * Called whenever a report of the task is added, deleted or changes state.
+ *
+ * @param[in]  task  Task.
+ */
+static void
+task_summary_update (task_t task)
+{
+  gchar *where;
+
+  where = g_strdup_printf ("tasks.id = %llu", task);
+  task_summaries_update (where);
+  g_free (where);
+}
+
 /**
  * @brief Get the report from the most recently completed invocation of task.
  *
@@ -18150,11 +20325,9 @@ int
 task_last_report (task_t task, report_t *report)
 {
   switch (sql_int64 (report,
-                     "SELECT id FROM reports WHERE task = %llu"
-                     " AND scan_run_status = %u"
-                     " ORDER BY date DESC LIMIT 1;",
-                     task,
-                     TASK_STATUS_DONE))
+                     "SELECT last_report FROM task_summaries"
+                     " WHERE task = %llu AND last_report IS NOT NULL;",
+                     task))
     {
       case 0:
         break;
@@ -18214,11 +20387,9 @@ static int
 task_second_last_report (task_t task, report_t *report)
 {
   switch (sql_int64 (report,
-                     "SELECT id FROM reports WHERE task = %llu"
-                     " AND scan_run_status = %u"
-                     " ORDER BY date DESC LIMIT 1 OFFSET 1;",
-                     task,
-                     TASK_STATUS_DONE))
+                     "SELECT second_last_report FROM task_summaries"
+                     " WHERE task = %llu AND second_last_report IS NOT NULL;",
+                     task))
     {
       case 0:
         break;
@@ -18280,11 +20451,11 @@ task_last_resumable_report (task_t task, report_t *report)
 gchar*
 task_second_last_report_id (task_t task)
 {
-  return sql_string ("SELECT uuid FROM reports WHERE task = %llu"
-                     " AND scan_run_status = %u"
-                     " ORDER BY date DESC LIMIT 1 OFFSET 1;",
-                     task,
-                     TASK_STATUS_DONE);
+  return sql_string ("SELECT uuid FROM reports"
+                     " WHERE id = (SELECT second_last_report"
+                     "             FROM task_summaries"
+                     "             WHERE task = %llu);",
+                     task);
 }
 
 /**
@@ -18457,6 +20628,7 @@ set_task_schedule (task_t task, schedule_t schedule, int periods)
        " modification_time = m_now ()"
        " WHERE id = %llu;",
        schedule, periods, schedule, task);
+  task_schedules_changed ();
 
   return 0;
 }
@@ -18486,6 +20658,7 @@ set_task_schedule_uuid (const gchar *task_id, schedule_t schedule, int periods)
        " WHERE uuid = '%s';",
        schedule, periods, schedule, quoted_task_id);
   g_free (quoted_task_id);
+  task_schedules_changed ();
 
   return 0;
 }
@@ -18713,6 +20886,7 @@ set_task_schedule_next_time_uuid (const gchar *task_id, time_t time)
   sql ("UPDATE tasks SET schedule_next_time = %i WHERE uuid = '%s';",
        time, quoted_task_id);
   g_free (quoted_task_id);
+  task_schedules_changed ();
 }
 
 /**
@@ -18985,6 +21159,8 @@ update_duration_schedule_periods (task_t task)
 
 /**
  * @brief Auto delete reports.
+ *
+ * Only queues the reports.  The report deletion worker deletes them.
  */
 void
 auto_delete_reports ()
@@ -18995,14 +21171,6 @@ auto_delete_reports ()
 
   sql_begin_immediate ();
 
-  /* As in delete_report, this prevents other processes from getting the
-   * report ID. */
-  if (sql_int ("SELECT try_exclusive_lock('reports');") == 0)
-    {
-      sql_rollback ();
-      return;
-    }
-
   init_iterator (&tasks,
                  "SELECT id, name,"
                  "       (SELECT value FROM task_preferences"
@@ -19018,7 +21186,6 @@ auto_delete_reports ()
   while (next (&tasks))
     {
       task_t task;
-      iterator_t reports;
       const char *keep_string;
       int keep;
 
@@ -19035,45 +21202,21 @@ auto_delete_reports ()
               iterator_string (&tasks, 1),
               keep);
 
-      init_iterator (&reports,
-                     "SELECT id FROM reports"
-                     " WHERE task = %llu"
-                     " AND start_time IS NOT NULL"
-                     " AND start_time > 0"
-                     " ORDER BY start_time DESC LIMIT %s OFFSET %i;",
-                     task,
-                     sql_select_limit (-1),
-                     keep);
-      while (next (&reports))
-        {
-          int ret;
-          report_t report;
-
-          report = iterator_int64 (&reports, 0);
-          assert (report);
-
-          g_debug ("%s: delete %llu", __func__, report);
-          ret = delete_report_internal (report);
-          if (ret == 2)
-            {
-              /* Report is in use. */
-              g_debug ("%s: %llu is in use", __func__, report);
-              continue;
-            }
-          if (ret)
-            {
-              g_warning ("%s: failed to delete %llu (%i)",
-                         __func__, report, ret);
-              sql_rollback ();
-            }
-        }
-      cleanup_iterator (&reports);
+      sql ("INSERT INTO report_deletions (report, queued)"
+           " SELECT id, m_now () FROM reports"
+           " WHERE task = %llu"
+           " AND start_time IS NOT NULL"
+           " AND start_time > 0"
+           " ORDER BY start_time DESC LIMIT %s OFFSET %i"
+           " ON CONFLICT (report) DO NOTHING;",
+           task,
+           sql_select_limit (-1),
+           keep);
     }
   cleanup_iterator (&tasks);
   sql_commit ();
 }
 
-
 /**
  * @brief Get definitions file from a task's config.
  *
@@ -19108,6 +21251,7 @@ reschedule_task (const gchar *task_id)
       case 0:
         g_warning ("%s: rescheduling task '%s'", __func__, task_id);
         set_task_schedule_next_time (task, time (NULL) - 1);
+        task_schedules_changed ();
         break;
       case 1:        /* Too few rows in result of query. */
         break;
@@ -19177,6 +21321,53 @@ result_nvt_notice (const gchar *nvt)
        nvt);
 }
 
+/**
+ * @brief Get the severity to store for an OSP result.
+ *
+ * @param[in]  nvt       The uuid of oval definition that produced the
+ *                       result, a title for the result otherwise.
+ * @param[in]  type      Type of result.  "Alarm", etc.
+ * @param[in]  severity  Result severity from the scanner.
+ *
+ * @return Freshly allocated quoted severity, or NULL if the result must
+ *         be skipped.
+ */
+static gchar *
+osp_result_severity (const char *nvt, const char *type, const char *severity)
+{
+  gchar *result_severity;
+
+  if (severity && strcmp (severity, ""))
+    return sql_quote (severity);
+
+  if (!strcmp (type, severity_to_type (SEVERITY_ERROR)))
+    return g_strdup (G_STRINGIFY (SEVERITY_ERROR));
+
+  if (nvt && g_str_has_prefix (nvt, "CVE-"))
+    {
+      result_severity = cve_cvss_base (nvt);
+      if (result_severity == NULL || strcmp (result_severity, "") == 0)
+        {
+          g_free (result_severity);
+          result_severity
+            = g_strdup_printf ("%0.1f",
+                               setting_default_severity_dbl ());
+          g_debug ("%s: OSP CVE result without severity for '%s'",
+                   __func__, nvt);
+        }
+      return result_severity;
+    }
+
+  /*
+  result_severity
+    = g_strdup_printf ("%0.1f",
+                       setting_default_severity_dbl ());
+  */
+  g_warning ("%s: Non-CVE OSP result without severity for test %s",
+             __func__, nvt ? nvt : "(unknown)");
+  return NULL;
+}
+
 /**
  * @brief Make an OSP result.
  *
@@ -19204,46 +21395,16 @@ make_osp_result (task_t task, const char *host, const char *hostname,
   assert (task);
   assert (type);
 
+  result_severity = osp_result_severity (nvt, type, severity);
+  if (result_severity == NULL)
+    return 0;
+
   if (nvt && g_str_has_prefix (nvt, "oval:"))
     nvt_revision = ovaldef_version (nvt);
   quoted_desc = sql_quote (description ?: "");
   quoted_nvt = sql_quote (nvt ?: "");
   quoted_port = sql_quote (port ?: "");
   quoted_hostname = sql_quote (hostname ? hostname : "");
-  if (!severity || !strcmp (severity, ""))
-    {
-      if (!strcmp (type, severity_to_type (SEVERITY_ERROR)))
-        result_severity = g_strdup (G_STRINGIFY (SEVERITY_ERROR));
-      else
-        {
-          if (nvt && g_str_has_prefix (nvt, "CVE-"))
-            {
-              result_severity = cve_cvss_base (nvt);
-              if (result_severity == NULL || strcmp (result_severity, "") == 0)
-                {
-                  g_free (result_severity);
-                  result_severity
-                    = g_strdup_printf ("%0.1f",
-                                       setting_default_severity_dbl ());
-                  g_debug ("%s: OSP CVE result without severity for '%s'",
-                           __func__, nvt);
-                }
-            }
-          else
-            {
-              /*
-              result_severity
-                = g_strdup_printf ("%0.1f",
-                                   setting_default_severity_dbl ());
-              */
-              g_warning ("%s: Non-CVE OSP result without severity for test %s",
-                         __func__, nvt ? nvt : "(unknown)");
-              return 0;
-            }
-        }
-    }
-  else
-    result_severity = sql_quote (severity);
   result_nvt_notice (quoted_nvt);
   sql ("INSERT into results"
        " (owner, date, task, host, hostname, port, nvt,"
@@ -19485,6 +21646,170 @@ host_notice (const char *host_name, const char *identifier_type,
   return host;
 }
 
+/**
+ * @brief NVT details that results are made from.
+ */
+typedef struct
+{
+  nvt_t nvt;                  ///< Row ID of NVT.
+  const gchar *cvss_base;     ///< CVSS base score, "0.0" if none.
+  const gchar *qod_type;      ///< QoD type.
+  const gchar *solution_type; ///< Solution type.
+  const gchar *revision;      ///< Modification time of NVT, as ISO time.
+  int qod;                    ///< QoD percentage of QoD type.
+  gboolean noticed;           ///< Whether NVT is known to be in result_nvts.
+} ingest_nvt_t;
+
+/**
+ * @brief Number of NVTs to fetch at a time when loading the ingest NVTs.
+ */
+#define INGEST_NVTS_FETCH_SIZE 5000
+
+/**
+ * @brief NVT details for making results, keyed by OID.
+ */
+static GHashTable *ingest_nvts = NULL;
+
+/**
+ * @brief Strings of the ingest NVTs.
+ *
+ * Most of the values repeat, so they are stored once each.
+ */
+static GStringChunk *ingest_nvts_strings = NULL;
+
+/**
+ * @brief NVT feed version that the ingest NVTs were loaded from.
+ */
+static gchar *ingest_nvts_feed_version = NULL;
+
+/**
+ * @brief Load the NVT details for making results from the database.
+ *
+ * @param[in]  feed_version  NVT feed version.  Freed by the ingest NVTs.
+ */
+static void
+ingest_nvts_load (gchar *feed_version)
+{
+  iterator_t nvts;
+  int began;
+
+  if (ingest_nvts)
+    g_hash_table_destroy (ingest_nvts);
+  if (ingest_nvts_strings)
+    g_string_chunk_free (ingest_nvts_strings);
+  g_free (ingest_nvts_feed_version);
+
+  ingest_nvts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                       g_free);
+  ingest_nvts_strings = g_string_chunk_new (1024 * 1024);
+  ingest_nvts_feed_version = feed_version;
+
+  /* Streaming needs a transaction that lasts as long as the loop. */
+  began = sql_in_transaction () == 0;
+  if (began)
+    sql_begin_immediate ();
+  init_iterator (&nvts,
+                 "SELECT oid, id, coalesce (cvss_base, '0.0'), qod_type,"
+                 "       solution_type, iso_time (modification_time)"
+                 " FROM nvts;");
+  iterator_stream (&nvts, INGEST_NVTS_FETCH_SIZE);
+  while (next (&nvts))
+    {
+      ingest_nvt_t *ingest_nvt;
+
+      ingest_nvt = g_malloc0 (sizeof (ingest_nvt_t));
+      ingest_nvt->nvt = iterator_int64 (&nvts, 1);
+      ingest_nvt->cvss_base
+        = g_string_chunk_insert_const (ingest_nvts_strings,
+                                       iterator_string (&nvts, 2));
+      ingest_nvt->qod_type
+        = iterator_null (&nvts, 3)
+           ? NULL
+           : g_string_chunk_insert_const (ingest_nvts_strings,
+                                          iterator_string (&nvts, 3));
+      ingest_nvt->solution_type
+        = g_string_chunk_insert_const (ingest_nvts_strings,
+                                       iterator_string (&nvts, 4) ?: "");
+      ingest_nvt->revision
+        = g_string_chunk_insert_const (ingest_nvts_strings,
+                                       iterator_string (&nvts, 5) ?: "");
+      ingest_nvt->qod = qod_from_type (ingest_nvt->qod_type);
+      g_hash_table_insert (ingest_nvts,
+                           g_string_chunk_insert (ingest_nvts_strings,
+                                                  iterator_string (&nvts, 0)),
+                           ingest_nvt);
+    }
+  cleanup_iterator (&nvts);
+  if (began)
+    sql_commit ();
+
+  g_debug ("%s: loaded %u NVTs", __func__, g_hash_table_size (ingest_nvts));
+}
+
+/**
+ * @brief Reload the NVT details for making results if the feed changed.
+ *
+ * Called once for each batch of results, so that the results themselves
+ * need no lookups.
+ */
+static void
+ingest_nvts_refresh ()
+{
+  gchar *feed_version;
+
+  feed_version = nvts_feed_version ();
+  if (ingest_nvts
+      && g_strcmp0 (feed_version, ingest_nvts_feed_version) == 0)
+    {
+      g_free (feed_version);
+      return;
+    }
+  ingest_nvts_load (feed_version);
+}
+
+/**
+ * @brief Get the details of an NVT for making a result.
+ *
+ * @param[in]  oid  OID of NVT.
+ *
+ * @return NVT details, or NULL if there is no such NVT.
+ */
+static ingest_nvt_t *
+ingest_nvt_lookup (const char *oid)
+{
+  if (oid == NULL)
+    return NULL;
+  if (ingest_nvts == NULL)
+    ingest_nvts_load (nvts_feed_version ());
+  return g_hash_table_lookup (ingest_nvts, oid);
+}
+
+/**
+ * @brief Record that NVTs are in result_nvts, after the INSERTs committed.
+ *
+ * @param[in]  nvts  Quoted OIDs of NVTs.
+ */
+static void
+ingest_nvts_notice (GHashTable *nvts)
+{
+  GHashTableIter iter;
+  gpointer quoted_nvt;
+
+  if (ingest_nvts == NULL)
+    return;
+
+  /* OIDs need no quoting, so the quoted OID is the OID. */
+  g_hash_table_iter_init (&iter, nvts);
+  while (g_hash_table_iter_next (&iter, &quoted_nvt, NULL))
+    {
+      ingest_nvt_t *ingest_nvt;
+
+      ingest_nvt = g_hash_table_lookup (ingest_nvts, quoted_nvt);
+      if (ingest_nvt)
+        ingest_nvt->noticed = TRUE;
+    }
+}
+
 /**
  * @brief Get a severity string from an nvt and result type.
  *
@@ -19499,8 +21824,13 @@ nvt_severity (const char *nvt_id, const char *type)
   char *severity = NULL;
 
   if (strcasecmp (type, "Alarm") == 0 && nvt_id)
-    severity = sql_string ("SELECT coalesce(cvss_base, '0.0')"
-                           " FROM nvts WHERE uuid = '%s';", nvt_id);
+    {
+      ingest_nvt_t *ingest_nvt;
+
+      ingest_nvt = ingest_nvt_lookup (nvt_id);
+      if (ingest_nvt)
+        severity = g_strdup (ingest_nvt->cvss_base);
+    }
   else if (strcasecmp (type, "Alarm") == 0)
     g_warning ("%s result type requires an NVT", type);
   else if (strcasecmp (type, "Log Message") == 0)
@@ -19536,38 +21866,21 @@ make_result (task_t task, const char* host, const char *hostname,
   gchar *nvt_revision, *severity;
   gchar *quoted_hostname, *quoted_descr, *quoted_qod_type;
   int qod;
-  nvt_t nvt_id = 0;
+  ingest_nvt_t *ingest_nvt;
 
-  if (nvt && strcmp (nvt, "") && (find_nvt (nvt, &nvt_id) || nvt_id <= 0))
+  ingest_nvt = NULL;
+  if (nvt && strcmp (nvt, "")
+      && ((ingest_nvt = ingest_nvt_lookup (nvt)) == NULL
+          || ingest_nvt->nvt <= 0))
     {
       g_warning ("NVT '%s' not found. Result not created", nvt);
       return 0;
     }
-  else if (nvt && strcmp (nvt, ""))
+  else if (ingest_nvt)
     {
-      nvti_t *nvti;
-
-      nvti = lookup_nvti (nvt);
-      if (nvti)
-        {
-          gchar *qod_type;
-
-          qod_type = nvti_qod_type (nvti);
-          qod = qod_from_type (qod_type);
-          quoted_qod_type = sql_quote (qod_type);
-
-          g_free (qod_type);
-        }
-      else
-        {
-          qod = QOD_DEFAULT;
-          quoted_qod_type = g_strdup ("");
-        }
-
-      nvt_revision = sql_string ("SELECT iso_time (modification_time)"
-                                 " FROM nvts"
-                                 " WHERE uuid = '%s';",
-                                 nvt);
+      qod = ingest_nvt->qod;
+      quoted_qod_type = sql_quote (ingest_nvt->qod_type ?: "");
+      nvt_revision = g_strdup (ingest_nvt->revision);
     }
   else
     {
@@ -19589,7 +21902,13 @@ make_result (task_t task, const char* host, const char *hostname,
     }
   quoted_hostname = sql_quote (hostname ? hostname : "");
   quoted_descr = sql_quote (description ?: "");
-  result_nvt_notice (nvt);
+  if (ingest_nvt == NULL || ingest_nvt->noticed == FALSE)
+    {
+      result_nvt_notice (nvt);
+      /* A ROLLBACK would undo the INSERT. */
+      if (ingest_nvt && sql_in_transaction () == 0)
+        ingest_nvt->noticed = TRUE;
+    }
   sql ("INSERT into results"
        " (owner, date, task, host, hostname, port,"
        "  nvt, nvt_version, severity, type,"
@@ -19612,38 +21931,6 @@ make_result (task_t task, const char* host, const char *hostname,
   return result;
 }
 
-/**
- * @brief Make a CVE result.
- *
- * @param[in]  task         The task associated with the result.
- * @param[in]  host         Host.
- * @param[in]  nvt          The OID of the NVT that produced the result.
- * @param[in]  cvss         CVSS base.
- * @param[in]  description  Description of the result.
- *
- * @return A result descriptor for the new result, 0 if error.
- */
-result_t
-make_cve_result (task_t task, const char* host, const char *nvt, double cvss,
-                 const char* description)
-{
-  gchar *quoted_descr;
-  quoted_descr = sql_quote (description ?: "");
-  result_nvt_notice (nvt);
-  sql ("INSERT into results"
-       " (owner, date, task, host, port, nvt, nvt_version, severity, type,"
-       "  description, uuid, qod, qod_type, result_nvt)"
-       " VALUES"
-       " (NULL, m_now (), %llu, '%s', '', '%s', '', '%1.1f', '%s',"
-       "  '%s', make_uuid (), %i, '',"
-       "  (SELECT id FROM result_nvts WHERE nvt = '%s'));",
-       task, host ?: "", nvt, cvss, severity_to_type (cvss),
-       quoted_descr, QOD_DEFAULT, nvt);
-
-  g_free (quoted_descr);
-  return sql_last_insert_id ();
-}
-
 /**
  * @brief Return the UUID of a result.
  *
@@ -19737,7 +22024,8 @@ result_detection_reference (result_t result, report_t report, const gchar *host,
                      " WHERE report = %llu"
                      " AND host = '%s'"
                      " AND nvt = '%s'"
-                     " AND (description LIKE '%%%s%%'"
+                     " AND (result_description (description, fingerprint)"
+                     "      LIKE '%%%s%%'"
                      "      OR port LIKE '%%%s%%');",
                      report, quoted_host, oid, quoted_location,
                      quoted_location);
@@ -19761,91 +22049,500 @@ detect_cleanup:
 /* Prognostics. */
 
 /**
- * @brief Get the location of an App for a report's host.
+ * @brief Number of CVE scan results buffered before they are inserted.
+ */
+#define CVE_SCAN_INSERT_SIZE 1000
+
+/**
+ * @brief Number of App details fetched at a time during a CVE scan.
+ */
+#define CVE_SCAN_FETCH_SIZE 5000
+
+/**
+ * @brief A CVE that affects a product, in a CVE scan index.
+ */
+typedef struct
+{
+  resource_t id;        ///< Row ID of CVE.
+  gchar *name;          ///< Name of CVE.
+  double cvss;          ///< CVSS base of CVE.
+  gchar *description;   ///< Description of CVE.
+} cve_scan_cve_t;
+
+/**
+ * @brief A host of a CVE scan.
+ */
+typedef struct
+{
+  gchar *ip;                   ///< IP of host.
+  report_host_t last;          ///< Report host of host in last report.
+  report_host_t report_host;   ///< Report host of host in scan report, or 0.
+  time_t start_time;           ///< Start time of host.
+} cve_scan_host_t;
+
+/**
+ * @brief A CVE scan.
+ */
+struct cve_scan
+{
+  task_t task;                 ///< Task.
+  report_t report;             ///< Report that gets the results.
+  user_t owner;                ///< Owner of report.
+  GPtrArray *hosts;            ///< Hosts.
+  GHashTable *hosts_by_last;   ///< Hosts, keyed on report host in last report.
+  GHashTable *cves;            ///< CVEs of index, keyed on row ID.
+  GHashTable *products;        ///< CVEs (GPtrArray) of each CPE, keyed on CPE.
+  GString *results;            ///< Buffered results, in COPY text format.
+  GString *details;            ///< Buffered host details, in COPY text format.
+  int buffered;                ///< Number of buffered results.
+  int position;                ///< Position of next result.
+  result_t counted_result;     ///< Highest result ID already counted.
+};
+
+/**
+ * @brief Free a CVE of a CVE scan index.
  *
- * @param[in]  report_host  Report host.
- * @param[in]  app          CPE.
+ * @param[in]  data  CVE.
+ */
+static void
+cve_scan_cve_free (gpointer data)
+{
+  cve_scan_cve_t *cve;
+
+  cve = (cve_scan_cve_t *) data;
+  g_free (cve->name);
+  g_free (cve->description);
+  g_free (cve);
+}
+
+/**
+ * @brief Free the CVE list of a product in a CVE scan index.
  *
- * @return Location if there is one, else NULL.
+ * @param[in]  data  CVE list.
  */
-gchar *
-app_location (report_host_t report_host, const gchar *app)
+static void
+cve_scan_product_free (gpointer data)
+{
+  g_ptr_array_free ((GPtrArray *) data, TRUE);
+}
+
+/**
+ * @brief Start a CVE scan.
+ *
+ * @param[in]  task    Task.
+ * @param[in]  report  Report that gets the results.
+ *
+ * @return New CVE scan.
+ */
+cve_scan_t *
+cve_scan_new (task_t task, report_t report)
 {
-  gchar *quoted_app, *ret;
+  cve_scan_t *scan;
 
-  assert (app);
+  assert (report);
 
-  quoted_app = sql_quote (app);
+  scan = g_malloc0 (sizeof (cve_scan_t));
+  scan->task = task;
+  scan->report = report;
+  sql_int64 (&scan->owner,
+             "SELECT owner FROM reports WHERE id = %llu;",
+             report);
+  scan->hosts = g_ptr_array_new ();
+  scan->hosts_by_last = g_hash_table_new (g_int64_hash, g_int64_equal);
+  scan->cves = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL,
+                                      cve_scan_cve_free);
+  scan->products = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          cve_scan_product_free);
+  scan->results = g_string_new ("");
+  scan->details = g_string_new ("");
+  scan->counted_result = report_max_result (report);
+  return scan;
+}
+
+/**
+ * @brief Free a CVE scan.
+ *
+ * @param[in]  scan  CVE scan.
+ */
+void
+cve_scan_free (cve_scan_t *scan)
+{
+  guint index;
 
-  ret = sql_string ("SELECT value FROM report_host_details"
-                    " WHERE report_host = %llu"
-                    " AND name = '%s'"
-                    " AND source_type = 'nvt'"
-                    " AND source_name"
-                    "     = (SELECT source_name FROM report_host_details"
-                    "        WHERE report_host = %llu"
-                    "        AND source_type = 'nvt'"
-                    "        AND name = 'App'"
-                    "        AND value = '%s');",
-                    report_host,
-                    quoted_app,
-                    report_host,
-                    quoted_app);
+  if (scan == NULL)
+    return;
 
-  g_free (quoted_app);
+  for (index = 0; index < scan->hosts->len; index++)
+    {
+      cve_scan_host_t *host;
 
-  return ret;
+      host = (cve_scan_host_t *) g_ptr_array_index (scan->hosts, index);
+      g_free (host->ip);
+      g_free (host);
+    }
+  g_ptr_array_free (scan->hosts, TRUE);
+  g_hash_table_destroy (scan->hosts_by_last);
+  g_hash_table_destroy (scan->products);
+  g_hash_table_destroy (scan->cves);
+  g_string_free (scan->results, TRUE);
+  g_string_free (scan->details, TRUE);
+  g_free (scan);
 }
 
 /**
- * @brief Initialise a report host prognosis iterator.
+ * @brief Add a host to a CVE scan.
  *
- * @param[in]  iterator     Iterator.
- * @param[in]  report_host  Report host whose prognosis the iterator loops over.
- *                          All report_hosts if NULL.
+ * @param[in]  scan  CVE scan.
+ * @param[in]  ip    IP of host.
+ * @param[in]  last  Report host of the host in the last report of the host.
  */
 void
-init_host_prognosis_iterator (iterator_t* iterator, report_host_t report_host)
+cve_scan_add_host (cve_scan_t *scan, const char *ip, report_host_t last)
 {
-  init_iterator (iterator,
-                 "SELECT cves.name AS vulnerability,"
-                 "       CAST (cves.cvss AS NUMERIC) AS severity,"
-                 "       cves.description,"
-                 "       cpes.name AS location,"
-                 "       (SELECT host FROM report_hosts"
-                 "        WHERE id = %llu) AS host"
-                 " FROM scap.cves, scap.cpes, scap.affected_products,"
-                 "      report_host_details"
-                 " WHERE report_host_details.report_host = %llu"
-                 " AND cpes.name = report_host_details.value"
-                 " AND report_host_details.name = 'App'"
-                 " AND cpes.id=affected_products.cpe"
-                 " AND cves.id=affected_products.cve"
-                 " ORDER BY cves.id ASC"
-                 " LIMIT %s OFFSET 0;",
-                 report_host,
-                 report_host,
-                 sql_select_limit (-1));
+  cve_scan_host_t *host;
+
+  if (g_hash_table_lookup (scan->hosts_by_last, &last))
+    return;
+
+  host = g_malloc0 (sizeof (cve_scan_host_t));
+  host->ip = g_strdup (ip);
+  host->last = last;
+  host->start_time = time (NULL);
+  g_ptr_array_add (scan->hosts, host);
+  g_hash_table_insert (scan->hosts_by_last, &host->last, host);
 }
 
-DEF_ACCESS (prognosis_iterator_cve, 0);
+/**
+ * @brief Load the CVEs of the products of the hosts of a CVE scan.
+ *
+ * Only the products that the hosts carry are loaded, and each CVE is
+ * stored once, even if it affects many of the products.
+ *
+ * @param[in]  scan  CVE scan.
+ * @param[in]  ids   Report hosts of the hosts in their last reports, as a
+ *                   comma separated list.
+ */
+static void
+cve_scan_load (cve_scan_t *scan, const gchar *ids)
+{
+  iterator_t rows;
+
+  init_iterator (&rows,
+                 "SELECT cpes.name, cves.id, cves.name,"
+                 "       CAST (cves.cvss AS NUMERIC), cves.description"
+                 " FROM scap.cpes, scap.affected_products, scap.cves"
+                 " WHERE cpes.name IN (SELECT value FROM report_host_details"
+                 "                     WHERE report_host IN (%s)"
+                 "                     AND name = 'App')"
+                 " AND cpes.id = affected_products.cpe"
+                 " AND cves.id = affected_products.cve"
+                 " ORDER BY cpes.name, cves.id;",
+                 ids);
+  while (next (&rows))
+    {
+      const char *cpe;
+      resource_t id;
+      cve_scan_cve_t *cve;
+      GPtrArray *product;
+
+      id = iterator_int64 (&rows, 1);
+      cve = g_hash_table_lookup (scan->cves, &id);
+      if (cve == NULL)
+        {
+          cve = g_malloc (sizeof (cve_scan_cve_t));
+          cve->id = id;
+          cve->name = g_strdup (iterator_string (&rows, 2));
+          cve->cvss = iterator_double (&rows, 3);
+          cve->description = g_strdup (iterator_string (&rows, 4) ?: "");
+          g_hash_table_insert (scan->cves, &cve->id, cve);
+        }
+
+      cpe = iterator_string (&rows, 0);
+      product = g_hash_table_lookup (scan->products, cpe);
+      if (product == NULL)
+        {
+          product = g_ptr_array_new ();
+          g_hash_table_insert (scan->products, g_strdup (cpe), product);
+        }
+      g_ptr_array_add (product, cve);
+    }
+  cleanup_iterator (&rows);
+}
 
 /**
- * @brief Get the CVSS from a result iterator as a double.
+ * @brief Buffer a host detail of a CVE scan.
  *
- * @param[in]  iterator  Iterator.
+ * @param[in]  scan         CVE scan.
+ * @param[in]  host         Host.
+ * @param[in]  source_name  Source name of detail.
+ * @param[in]  name         Name of detail.
+ * @param[in]  value        Value of detail.
+ */
+static void
+cve_scan_detail (cve_scan_t *scan, cve_scan_host_t *host,
+                 const char *source_name, const char *name, const char *value)
+{
+  gchar *report_host;
+
+  report_host = g_strdup_printf ("%llu", host->report_host);
+  sql_copy_append (scan->details, report_host, 0);
+  g_free (report_host);
+  sql_copy_append (scan->details, "cve", 0);
+  sql_copy_append (scan->details, source_name, 0);
+  sql_copy_append (scan->details, "CVE Scanner", 0);
+  sql_copy_append (scan->details, name, 0);
+  sql_copy_append (scan->details, value, 1);
+}
+
+/**
+ * @brief Buffer the result of a CVE that affects a product on a host.
  *
- * @return CVSS.
+ * @param[in]  scan      CVE scan.
+ * @param[in]  host      Host.
+ * @param[in]  app       CPE of product.
+ * @param[in]  location  Location of product on host, or NULL.
+ * @param[in]  cve       CVE.
  */
-double
-prognosis_iterator_cvss_double (iterator_t* iterator)
+static void
+cve_scan_match (cve_scan_t *scan, cve_scan_host_t *host, const char *app,
+                const char *location, cve_scan_cve_t *cve)
 {
-  if (iterator->done) return 0;
-  return iterator_double (iterator, 1);
+  gchar *desc, *number;
+
+  desc = g_strdup_printf ("The host carries the product: %s\n"
+                          "It is vulnerable according to: %s.\n"
+                          "%s%s%s"
+                          "\n"
+                          "%s",
+                          app,
+                          cve->name,
+                          location ? "The product was found at: " : "",
+                          location ? location : "",
+                          location ? ".\n" : "",
+                          cve->description);
+
+  g_debug ("%s: making result with severity %1.1f desc [%s]",
+           __func__, cve->cvss, desc);
+
+  number = g_strdup_printf ("%i", scan->position++);
+  sql_copy_append (scan->results, number, 0);
+  g_free (number);
+  sql_copy_append (scan->results, host->ip, 0);
+  sql_copy_append (scan->results, cve->name, 0);
+  number = g_strdup_printf ("%1.1f", cve->cvss);
+  sql_copy_append (scan->results, number, 0);
+  g_free (number);
+  sql_copy_append (scan->results, severity_to_type (cve->cvss), 0);
+  sql_copy_append (scan->results, desc, 1);
+  g_free (desc);
+  scan->buffered++;
+
+  cve_scan_detail (scan, host, cve->name, "App", app);
+  if (location)
+    {
+      cve_scan_detail (scan, host, cve->name, app, location);
+      cve_scan_detail (scan, host, cve->name, "detected_at", location);
+      /* Detected by itself. */
+      cve_scan_detail (scan, host, cve->name, "detected_by", cve->name);
+    }
+}
+
+/**
+ * @brief Insert the buffered results and host details of a CVE scan.
+ *
+ * COPYs the results into a staging table, and then inserts all of them
+ * into the results of the report with one statement, like the merge of
+ * slave results.
+ *
+ * @param[in]  scan  CVE scan.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+cve_scan_flush (cve_scan_t *scan)
+{
+  if (scan->results->len)
+    {
+      sql ("CREATE TEMPORARY TABLE IF NOT EXISTS cve_scan_results"
+           " (position integer, host text, nvt text, severity real,"
+           "  type text, description text);");
+
+      if (sql_copy_start ("COPY cve_scan_results"
+                          " (position, host, nvt, severity, type, description)"
+                          " FROM STDIN;"))
+        return -1;
+      if (sql_copy_data (scan->results->str, scan->results->len))
+        {
+          sql_copy_end ("Failed to send CVE results");
+          return -1;
+        }
+      g_string_truncate (scan->results, 0);
+      if (sql_copy_end (NULL))
+        return -1;
+
+      sql ("INSERT INTO result_nvts (nvt)"
+           " SELECT DISTINCT nvt FROM cve_scan_results"
+           " ON CONFLICT (nvt) DO NOTHING;");
+
+      sql ("INSERT into results"
+           " (owner, date, task, host, port, nvt, nvt_version, severity, type,"
+           "  description, uuid, qod, qod_type, result_nvt, report)"
+           " SELECT %llu, m_now (), %llu, host, '', nvt, '', severity, type,"
+           "        description, make_uuid (), %i, '',"
+           "        (SELECT id FROM result_nvts"
+           "         WHERE result_nvts.nvt = cve_scan_results.nvt),"
+           "        %llu"
+           " FROM cve_scan_results"
+           " ORDER BY position;",
+           scan->owner, scan->task, QOD_DEFAULT, scan->report);
+
+      sql ("INSERT INTO result_nvt_reports (result_nvt, report)"
+           " SELECT DISTINCT result_nvts.id, %llu"
+           " FROM result_nvts, cve_scan_results"
+           " WHERE result_nvts.nvt = cve_scan_results.nvt"
+           " AND NOT EXISTS (SELECT * FROM result_nvt_reports"
+           "                 WHERE result_nvt = result_nvts.id"
+           "                 AND report = %llu);",
+           scan->report, scan->report);
+
+      sql ("TRUNCATE cve_scan_results;");
+
+      scan->counted_result = report_counts_add_results (scan->report,
+                                                        scan->counted_result);
+      scan->buffered = 0;
+    }
+
+  if (scan->details->len)
+    {
+      if (sql_copy_start ("COPY report_host_details"
+                          " (report_host, source_type, source_name,"
+                          "  source_description, name, value)"
+                          " FROM STDIN;"))
+        return -1;
+      if (sql_copy_data (scan->details->str, scan->details->len))
+        {
+          sql_copy_end ("Failed to send CVE host details");
+          return -1;
+        }
+      g_string_truncate (scan->details, 0);
+      if (sql_copy_end (NULL))
+        return -1;
+    }
+
+  return 0;
 }
 
-DEF_ACCESS (prognosis_iterator_description, 2);
-DEF_ACCESS (prognosis_iterator_cpe, 3);
+/**
+ * @brief Run a CVE scan, adding the results to the report.
+ *
+ * Loads an index of the CVEs of all the products that the hosts carry,
+ * then matches the products of each host against the index in memory,
+ * inserting the results and host details in bulk.
+ *
+ * @param[in]  scan  CVE scan.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+cve_scan_run (cve_scan_t *scan)
+{
+  iterator_t apps;
+  GString *ids;
+  guint index;
+  int ret;
+
+  if (scan->hosts->len == 0)
+    return 0;
+
+  ids = g_string_new ("");
+  for (index = 0; index < scan->hosts->len; index++)
+    {
+      cve_scan_host_t *host;
+
+      host = (cve_scan_host_t *) g_ptr_array_index (scan->hosts, index);
+      g_string_append_printf (ids, "%s%llu", index ? ", " : "", host->last);
+    }
+
+  cve_scan_load (scan, ids->str);
+  g_debug ("%s: %u products, %u CVEs", __func__,
+           g_hash_table_size (scan->products),
+           g_hash_table_size (scan->cves));
+  if (g_hash_table_size (scan->products) == 0)
+    {
+      g_string_free (ids, TRUE);
+      return 0;
+    }
+
+  /* Match the products of the hosts. */
+
+  ret = 0;
+  init_iterator (&apps,
+                 "SELECT app.report_host, app.value,"
+                 "       (SELECT location.value"
+                 "        FROM report_host_details AS location"
+                 "        WHERE location.report_host = app.report_host"
+                 "        AND location.name = app.value"
+                 "        AND location.source_type = 'nvt'"
+                 "        AND location.source_name = app.source_name"
+                 "        AND app.source_type = 'nvt'"
+                 "        LIMIT 1)"
+                 " FROM report_host_details AS app"
+                 " WHERE app.report_host IN (%s)"
+                 " AND app.name = 'App'"
+                 " ORDER BY app.report_host;",
+                 ids->str);
+  g_string_free (ids, TRUE);
+  iterator_stream (&apps, CVE_SCAN_FETCH_SIZE);
+  while (next (&apps))
+    {
+      report_host_t last;
+      cve_scan_host_t *host;
+      GPtrArray *product;
+
+      product = g_hash_table_lookup (scan->products,
+                                     iterator_string (&apps, 1));
+      if (product == NULL)
+        continue;
+
+      last = iterator_int64 (&apps, 0);
+      host = g_hash_table_lookup (scan->hosts_by_last, &last);
+      if (host == NULL)
+        continue;
+
+      if (host->report_host == 0)
+        host->report_host = manage_report_host_add (scan->report, host->ip,
+                                                    host->start_time, 0);
+
+      for (index = 0; index < product->len; index++)
+        cve_scan_match (scan, host, iterator_string (&apps, 1),
+                        iterator_string (&apps, 2),
+                        (cve_scan_cve_t *) g_ptr_array_index (product, index));
+
+      if (scan->buffered >= CVE_SCAN_INSERT_SIZE && cve_scan_flush (scan))
+        {
+          ret = -1;
+          break;
+        }
+    }
+  cleanup_iterator (&apps);
+  if (ret)
+    return ret;
+
+  /* Complete the report hosts. */
+
+  for (index = 0; index < scan->hosts->len; index++)
+    {
+      cve_scan_host_t *host;
+
+      host = (cve_scan_host_t *) g_ptr_array_index (scan->hosts, index);
+      if (host->report_host == 0)
+        continue;
+      report_host_set_end_time (host->report_host, time (NULL));
+      cve_scan_detail (scan, host, "", "CVE Scan", "1");
+    }
+
+  return cve_scan_flush (scan);
+}
 
 
 /* Reports. */
@@ -19878,7 +22575,6 @@ reports_add_for_override (GHashTable *reports_table,
                           override_t override)
 {
   result_t result;
-  task_t task;
   gchar *nvt_id;
   iterator_t reports;
 
@@ -19888,9 +22584,6 @@ reports_add_for_override (GHashTable *reports_table,
   sql_int64 (&result,
              "SELECT result FROM overrides WHERE id = %llu",
              override);
-  sql_int64 (&task,
-             "SELECT task FROM overrides WHERE id = %llu",
-             override);
   nvt_id = sql_string ("SELECT nvt FROM overrides WHERE id = %llu",
                        override);
 
@@ -19909,20 +22602,23 @@ reports_add_for_override (GHashTable *reports_table,
 
       return;
     }
-  else if (task)
-    {
-      init_iterator (&reports,
-                     "SELECT DISTINCT report FROM results"
-                     " WHERE task = %llu AND nvt = '%s'",
-                     task, nvt_id);
-    }
-  else
-    {
-      init_iterator (&reports,
-                     "SELECT DISTINCT report FROM results"
-                     " WHERE nvt = '%s'",
-                     nvt_id);
-    }
+  g_free (nvt_id);
+
+  /* Only the reports with results that match the hosts and port of the
+   * override, so that their count caches can be kept. */
+  init_iterator (&reports,
+                 "SELECT DISTINCT results.report FROM results, overrides"
+                 " WHERE overrides.id = %llu"
+                 " AND results.nvt = overrides.nvt"
+                 " AND (overrides.task = 0"
+                 "      OR results.task = overrides.task)"
+                 " AND (overrides.hosts IS NULL"
+                 "      OR overrides.hosts = ''"
+                 "      OR hosts_contains (overrides.hosts, results.host))"
+                 " AND (overrides.port IS NULL"
+                 "      OR overrides.port = ''"
+                 "      OR overrides.port = results.port);",
+                 override);
 
   while (next (&reports))
     {
@@ -20034,6 +22730,8 @@ reports_build_count_cache (int clear, int* changes_out)
 
   cleanup_iterator (&reports);
 
+  task_summaries_update ("true");
+
   if (changes_out)
     *changes_out = changes;
 }
@@ -20168,6 +22866,64 @@ report_counts_build_iterator_user (iterator_t *iterator)
   return iterator_int64 (iterator, 2);
 }
 
+/**
+ * @brief Cache the effective severities of the results of a report.
+ *
+ * There is one entry per result for each combination of overrides and
+ * dynamic severity that differs from the stored severity.  So switching
+ * either setting just reads other entries.
+ *
+ * The end time of the entries with overrides is the earliest end time of
+ * the overrides that may apply to the report, so that the view falls back
+ * to computing the severity once one of them expires.  Entries with dynamic
+ * severity are cleared when the NVT severities change.
+ *
+ * @param[in]  report  Report.
+ * @param[in]  user    User whose overrides apply.
+ */
+static void
+report_cache_severities (report_t report, user_t user)
+{
+  sql ("DELETE FROM result_severities"
+       " WHERE report = %llu AND \"user\" = %llu;",
+       report, user);
+
+  sql ("INSERT INTO result_severities"
+       " (result, report, \"user\", override, dynamic, severity, end_time)"
+       " SELECT result, %llu, %llu, override, dynamic, new_severity,"
+       "        CASE WHEN override = 1"
+       "        THEN (SELECT coalesce (min (overrides.end_time), 0)"
+       "              FROM overrides, results"
+       "              WHERE overrides.nvt = results.nvt"
+       "              AND results.report = %llu"
+       "              AND overrides.end_time >= m_now ())"
+       "        ELSE 0"
+       "        END"
+       " FROM result_new_severities"
+       " WHERE result IN (SELECT id FROM results WHERE report = %llu)"
+       " AND \"user\" = %llu"
+       " AND (override = 1 OR dynamic = 1);",
+       report, user, report, report, user);
+}
+
+/**
+ * @brief Clear the cached overridden severities of the results of a report.
+ *
+ * @param[in]  report       Report.
+ * @param[in]  users_where  Optional SQL clause to limit users.
+ */
+static void
+report_clear_severity_cache (report_t report, const char* users_where)
+{
+  if (users_where)
+    sql ("DELETE FROM result_severities"
+         " WHERE report = %llu"
+         " AND \"user\" IN (SELECT id FROM users WHERE %s);",
+         report, users_where);
+  else
+    sql ("DELETE FROM result_severities WHERE report = %llu;", report);
+}
+
 /**
  * @brief Cache report counts and clear existing caches if requested.
  *
@@ -20189,6 +22945,8 @@ report_cache_counts (report_t report, int clear_original, int clear_overridden,
   gchar *old_user_id;
 
   old_user_id = current_credentials.uuid;
+  if (clear_overridden)
+    report_clear_severity_cache (report, users_where);
   init_report_counts_build_iterator (&cache_iterator, report, INT_MAX, 1,
                                      users_where);
 
@@ -20215,6 +22973,17 @@ report_cache_counts (report_t report, int clear_original, int clear_overridden,
                report, user, override, min_qod);
         }
 
+      /* Recache when any combination is missing, like after the dynamic
+       * entries were cleared by an NVT update. */
+      if (override
+          && sql_int ("SELECT count (DISTINCT (override, dynamic))"
+                      " FROM result_severities"
+                      " WHERE report = %llu"
+                      " AND \"user\" = %llu;",
+                      report, user)
+             < 3)
+        report_cache_severities (report, user);
+
       report_counts_id (report, &debugs, &holes, &infos, &logs, &warnings,
                         &false_positives, &severity, get, NULL);
 
@@ -20250,6 +23019,9 @@ report_clear_count_cache (report_t report,
                            users_where);
     }
 
+  if (clear_overridden)
+    report_clear_severity_cache (report, users_where);
+
   if (clear_original && clear_overridden)
     {
       sql ("DELETE FROM report_counts"
@@ -20271,6 +23043,259 @@ report_clear_count_cache (report_t report,
     }
 }
 
+/**
+ * @brief Queue the count caches of a report for a rebuild in the background.
+ *
+ * The caches are cleared right away, so until the rebuild worker gets to
+ * them readers count live, and may refill the caches themselves.
+ *
+ * @param[in]  report             Report.
+ * @param[in]  clear_original     Whether to clear existing cache for
+ *                                 original severity.
+ * @param[in]  clear_overridden   Whether to clear existing cache for
+ *                                 overridden severity.
+ * @param[in]  users_where        Optional SQL clause to limit users.
+ */
+static void
+report_queue_counts (report_t report, int clear_original, int clear_overridden,
+                     const char* users_where)
+{
+  report_clear_count_cache (report, clear_original, clear_overridden,
+                            users_where);
+
+  if (users_where)
+    sql ("INSERT INTO report_counts_rebuilds (report, \"user\")"
+         " SELECT %llu, id FROM users"
+         " WHERE (%s)"
+         " AND NOT EXISTS (SELECT * FROM report_counts_rebuilds"
+         "                 WHERE report_counts_rebuilds.report = %llu"
+         "                 AND (report_counts_rebuilds.\"user\" = users.id"
+         "                      OR report_counts_rebuilds.\"user\" IS NULL));",
+         report, users_where, report);
+  else
+    sql ("INSERT INTO report_counts_rebuilds (report, \"user\")"
+         " SELECT %llu, NULL"
+         " WHERE NOT EXISTS (SELECT * FROM report_counts_rebuilds"
+         "                   WHERE report = %llu AND \"user\" IS NULL);",
+         report, report);
+}
+
+/**
+ * @brief Rebuild the queued report count caches.
+ *
+ * Runs in the rebuild worker until the queue is empty, rebuilding at most
+ * count_cache_rebuild_rate caches per second.
+ */
+static void
+rebuild_queued_count_caches ()
+{
+  int rebuilt;
+
+  rebuilt = 0;
+  while (1)
+    {
+      iterator_t rebuilds;
+      rowid_t rebuild;
+      report_t report;
+      user_t user;
+
+      init_iterator (&rebuilds,
+                     "SELECT id, report, \"user\" FROM report_counts_rebuilds"
+                     " ORDER BY id LIMIT 1;");
+      if (next (&rebuilds) == FALSE)
+        {
+          cleanup_iterator (&rebuilds);
+          break;
+        }
+      rebuild = iterator_int64 (&rebuilds, 0);
+      report = iterator_int64 (&rebuilds, 1);
+      user = iterator_int64 (&rebuilds, 2);
+      cleanup_iterator (&rebuilds);
+
+      sql_begin_immediate ();
+      if (sql_int ("SELECT EXISTS (SELECT * FROM reports WHERE id = %llu);",
+                   report))
+        {
+          gchar *users_where;
+
+          users_where = user ? g_strdup_printf ("id = %llu", user) : NULL;
+          report_cache_counts (report, 0, 0, users_where);
+          g_free (users_where);
+        }
+      sql ("DELETE FROM report_counts_rebuilds WHERE id = %llu;", rebuild);
+      sql_commit ();
+      rebuilt++;
+
+      if (count_cache_rebuild_rate > 0)
+        gvm_usleep (1000000 / count_cache_rebuild_rate);
+    }
+
+  g_info ("%s: Rebuilt %i report count caches", __func__, rebuilt);
+}
+
+/**
+ * @brief Get the number of report count caches waiting for a rebuild.
+ *
+ * @return Number of queued rebuilds.
+ */
+int
+manage_count_cache_queue_depth ()
+{
+  return sql_int ("SELECT count (*) FROM report_counts_rebuilds;");
+}
+
+/**
+ * @brief Start the report count cache rebuild worker if there is work.
+ *
+ * The worker is a child process, so that GMP commands that invalidate many
+ * caches return quickly.  At most one worker runs at a time.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ */
+void
+manage_rebuild_count_caches (sigset_t *sigmask_current)
+{
+  if (sql_int ("SELECT EXISTS (SELECT * FROM report_counts_rebuilds);")
+      == 0)
+    return;
+
+  fork_locked_worker (sigmask_current,
+                      "gvm-rebuild-counts",
+                      "gvmd: Rebuilding report counts",
+                      "report_counts",
+                      rebuild_queued_count_caches);
+}
+
+/**
+ * @brief Set the report count cache rebuild rate.
+ *
+ * @param[in]  new_rate  Maximum caches to rebuild per second, 0 for no limit.
+ */
+void
+set_count_cache_rebuild_rate (int new_rate)
+{
+  if (new_rate < 0)
+    count_cache_rebuild_rate = 0;
+  else
+    count_cache_rebuild_rate = new_rate;
+}
+
+/**
+ * @brief Get the highest result ID of a report.
+ *
+ * @param[in]  report  Report.
+ *
+ * @return Highest result ID, or 0 if the report has no results.
+ */
+static result_t
+report_max_result (report_t report)
+{
+  result_t result;
+
+  result = 0;
+  sql_int64 (&result,
+             "SELECT coalesce (max (id), 0) FROM results WHERE report = %llu;",
+             report);
+  return result;
+}
+
+/**
+ * @brief Add the counts of new results to the count cache of a report.
+ *
+ * Only counts that are already in the cache are updated, so the cache stays
+ * valid while a scan adds results, instead of being rebuilt.
+ *
+ * @param[in]  report  Report.
+ * @param[in]  after   Add results with a higher ID than this.
+ *
+ * @return Highest result ID counted, for the next call.
+ */
+static result_t
+report_counts_add_results (report_t report, result_t after)
+{
+  result_t max_result;
+
+  max_result = report_max_result (report);
+  if (max_result <= after || setting_dynamic_severity_int ())
+    return max_result;
+
+  sql ("WITH caches AS (SELECT DISTINCT \"user\", override, min_qod"
+       "                FROM report_counts"
+       "                WHERE report = %llu),"
+       "     new_counts AS (SELECT caches.\"user\", caches.override,"
+       "                           caches.min_qod,"
+       "                           round (new_severity::numeric, 1)"
+       "                           AS severity,"
+       "                           count (*) AS count"
+       "                    FROM caches, results, result_new_severities"
+       "                    WHERE results.report = %llu"
+       "                    AND results.id > %llu"
+       "                    AND results.id <= %llu"
+       "                    AND results.qod >= caches.min_qod"
+       "                    AND results.severity != "
+       G_STRINGIFY (SEVERITY_ERROR)
+       "                    AND result_new_severities.result = results.id"
+       "                    AND result_new_severities.\"user\""
+       "                        = caches.\"user\""
+       "                    AND result_new_severities.override"
+       "                        = caches.override"
+       "                    AND result_new_severities.dynamic = 0"
+       "                    GROUP BY caches.\"user\", caches.override,"
+       "                             caches.min_qod,"
+       "                             round (new_severity::numeric, 1)),"
+       "     updated AS (UPDATE report_counts"
+       "                 SET count = report_counts.count + new_counts.count"
+       "                 FROM new_counts"
+       "                 WHERE report_counts.report = %llu"
+       "                 AND report_counts.\"user\" = new_counts.\"user\""
+       "                 AND report_counts.override = new_counts.override"
+       "                 AND report_counts.min_qod = new_counts.min_qod"
+       "                 AND report_counts.severity = new_counts.severity"
+       "                 RETURNING report_counts.id, new_counts.\"user\","
+       "                           new_counts.override, new_counts.min_qod,"
+       "                           new_counts.severity)"
+       " INSERT INTO report_counts"
+       " (report, \"user\", override, min_qod, severity, count, end_time)"
+       " SELECT %llu, \"user\", override, min_qod, severity, count, 0"
+       " FROM new_counts"
+       " WHERE NOT EXISTS (SELECT * FROM updated"
+       "                   WHERE updated.\"user\" = new_counts.\"user\""
+       "                   AND updated.override = new_counts.override"
+       "                   AND updated.min_qod = new_counts.min_qod"
+       "                   AND updated.severity = new_counts.severity);",
+       report, report, after, max_result, report, report);
+
+  sql ("UPDATE report_counts"
+       " SET end_time = (SELECT coalesce(min(overrides.end_time), 0)"
+       "                 FROM overrides, results"
+       "                 WHERE overrides.nvt = results.nvt"
+       "                 AND results.report = %llu"
+       "                 AND overrides.end_time >= m_now ())"
+       " WHERE report = %llu AND override = 1;",
+       report, report);
+
+  return max_result;
+}
+
+/**
+ * @brief Update the count cache of a report after imported results.
+ *
+ * @param[in]  report          Report.
+ * @param[in]  counted_result  Highest result ID already counted, 0 for none.
+ *
+ * @return Highest result ID counted.
+ */
+static result_t
+create_report_count (report_t report, result_t counted_result)
+{
+  if (counted_result)
+    return report_counts_add_results (report, counted_result);
+
+  /* Build the cache from the first chunk, so that later chunks can add. */
+  report_cache_counts (report, 1, 1, NULL);
+  return report_max_result (report);
+}
+
 /**
  * @brief Make a report.
  *
@@ -20283,13 +23308,17 @@ report_clear_count_cache (report_t report,
 report_t
 make_report (task_t task, const char* uuid, task_status_t status)
 {
+  report_t report;
+
   sql ("INSERT into reports (uuid, owner, task, date, comment,"
        " scan_run_status, slave_progress, slave_task_uuid)"
        " VALUES ('%s',"
        " (SELECT owner FROM tasks WHERE tasks.id = %llu),"
        " %llu, %i, '', %u, 0, '');",
        uuid, task, task, time (NULL), status);
-  return sql_last_insert_id ();
+  report = sql_last_insert_id ();
+  task_summary_update (task);
+  return report;
 }
 
 /**
@@ -20403,38 +23432,197 @@ insert_report_host_detail (report_t report, const char *host,
 #define CREATE_REPORT_CHUNK_SLEEP 1000
 
 /**
- * @brief Create a report from an array of results.
+ * @brief Number of results per batch of a streamed report upload.
  *
- * @param[in]   results       Array of create_report_result_t pointers.
- * @param[in]   task_id       UUID of container task, or NULL to create new one.
+ * 0 to import uploads only once they are complete.
+ */
+static int import_batch_size = REPORT_IMPORT_BATCH_SIZE_DEFAULT;
+
+/**
+ * @brief Get the number of results per batch of a streamed report upload.
+ *
+ * @return Batch size, 0 if uploads are not streamed.
+ */
+int
+report_import_batch_size ()
+{
+  return import_batch_size;
+}
+
+/**
+ * @brief Set the number of results per batch of a streamed report upload.
+ *
+ * @param[in]  new_size  New batch size, 0 to not stream uploads.
+ */
+void
+set_report_import_batch_size (int new_size)
+{
+  if (new_size < 0)
+    import_batch_size = 0;
+  else
+    import_batch_size = new_size;
+}
+
+/**
+ * @brief Insert imported results into a report.
+ *
+ * Must be called inside a transaction.  Commits between chunks and leaves
+ * a transaction open on return.
+ *
+ * @param[in]      report          Report.
+ * @param[in]      task            Task of report.
+ * @param[in]      owner           Owner of task.
+ * @param[in]      results         Array of create_report_result_t pointers,
+ *                                 terminated by NULL.
+ * @param[in,out]  counted_result  Highest result ID already counted.  NULL
+ *                                 to leave the count cache alone.
+ */
+static void
+create_report_add_results (report_t report, task_t task, user_t owner,
+                           array_t *results, result_t *counted_result)
+{
+  int index, count, insert_count, first;
+  create_report_result_t *result;
+  GString *insert;
+
+  g_debug ("%s: add results", __func__);
+  insert = g_string_new ("");
+  index = 0;
+  first = 1;
+  insert_count = 0;
+  count = 0;
+  while ((result = (create_report_result_t*) g_ptr_array_index (results,
+                                                                index++)))
+    {
+      gchar *quoted_host, *quoted_hostname, *quoted_port, *quoted_nvt_oid;
+      gchar *quoted_description, *quoted_scan_nvt_version, *quoted_severity;
+      gchar *quoted_qod, *quoted_qod_type;
+
+      g_debug ("%s: add results: index: %i", __func__, index);
+
+      quoted_host = sql_quote (result->host ? result->host : "");
+      quoted_hostname = sql_quote (result->hostname ? result->hostname : "");
+      quoted_port = sql_quote (result->port ? result->port : "");
+      quoted_nvt_oid = sql_quote (result->nvt_oid ? result->nvt_oid : "");
+      quoted_description = sql_quote (result->description
+                                       ? result->description
+                                       : "");
+      quoted_scan_nvt_version = sql_quote (result->scan_nvt_version
+                                       ? result->scan_nvt_version
+                                       : "");
+      quoted_severity =  sql_quote (result->severity ? result->severity : "");
+      if (result->qod && strcmp (result->qod, "") && strcmp (result->qod, "0"))
+        quoted_qod = sql_quote (result->qod);
+      else
+        quoted_qod = g_strdup (G_STRINGIFY (QOD_DEFAULT));
+      quoted_qod_type = sql_quote (result->qod_type ? result->qod_type : "");
+      result_nvt_notice (quoted_nvt_oid);
+
+      if (first)
+        g_string_append (insert,
+                         "INSERT INTO results"
+                         " (uuid, owner, date, task, host, hostname, port,"
+                         "  nvt, type, description,"
+                         "  nvt_version, severity, qod, qod_type, result_nvt,"
+                         "  report)"
+                         " VALUES");
+      else
+        g_string_append (insert, ", ");
+      first = 0;
+      g_string_append_printf (insert,
+                              " (make_uuid (), %llu, m_now (), %llu, '%s',"
+                              "  '%s', '%s', '%s', '%s', '%s', '%s', '%s',"
+                              "  '%s', '%s',"
+                              "  (SELECT id FROM result_nvts WHERE nvt = '%s'),"
+                              "  %llu)",
+                              owner,
+                              task,
+                              quoted_host,
+                              quoted_hostname,
+                              quoted_port,
+                              quoted_nvt_oid,
+                              result->threat
+                               ? threat_message_type (result->threat)
+                               : "Log Message",
+                              quoted_description,
+                              quoted_scan_nvt_version,
+                              quoted_severity,
+                              quoted_qod,
+                              quoted_qod_type,
+                              quoted_nvt_oid,
+                              report);
+
+      /* Limit the number of results inserted at a time. */
+      if (insert_count == CREATE_REPORT_INSERT_SIZE)
+        {
+          sql ("%s", insert->str);
+          g_string_truncate (insert, 0);
+          count++;
+          insert_count = 0;
+          first = 1;
+
+          if (count == CREATE_REPORT_CHUNK_SIZE)
+            {
+              if (counted_result)
+                *counted_result = create_report_count (report,
+                                                       *counted_result);
+              sql_commit ();
+              gvm_usleep (CREATE_REPORT_CHUNK_SLEEP);
+              sql_begin_immediate ();
+              count = 0;
+            }
+        }
+      insert_count++;
+
+      g_free (quoted_host);
+      g_free (quoted_hostname);
+      g_free (quoted_port);
+      g_free (quoted_nvt_oid);
+      g_free (quoted_description);
+      g_free (quoted_scan_nvt_version);
+      g_free (quoted_severity);
+      g_free (quoted_qod);
+      g_free (quoted_qod_type);
+    }
+
+  if (first == 0)
+    {
+      sql ("%s", insert->str);
+      if (counted_result)
+        *counted_result = create_report_count (report, *counted_result);
+      sql_commit ();
+      gvm_usleep (CREATE_REPORT_CHUNK_SLEEP);
+      sql_begin_immediate ();
+    }
+
+  g_string_free (insert, TRUE);
+}
+
+/**
+ * @brief Check permissions and make the report of a report upload.
+ *
+ * @param[in]   task_id       UUID of container task.
  * @param[in]   in_assets     Whether to create assets from the report.
- * @param[in]   scan_start    Scan start time text.
- * @param[in]   scan_end      Scan end time text.
- * @param[in]   host_starts   Array of create_report_result_t pointers.  Host
- *                            name in host, time in description.
- * @param[in]   host_ends     Array of create_report_result_t pointers.  Host
- *                            name in host, time in description.
- * @param[in]   details       Array of host_detail_t pointers.
+ * @param[in]   scan_start    Scan start time text, or NULL.
+ * @param[in]   scan_end      Scan end time text, or NULL.
+ * @param[in]   upload_count  Number of results expected in the upload.
+ * @param[out]  task_return   Task.
+ * @param[out]  report_return Report.
  * @param[out]  report_id     Report ID.
  *
  * @return 0 success, 99 permission denied, -1 error, -2 failed to generate ID,
  *         -3 task_id is NULL, -4 failed to find task, -5 task must be
  *         container, -6 permission to create assets denied.
  */
-int
-create_report (array_t *results, const char *task_id, const char *in_assets,
-               const char *scan_start, const char *scan_end,
-               array_t *host_starts, array_t *host_ends, array_t *details,
-               char **report_id)
+static int
+create_report_start (const char *task_id, const char *in_assets,
+                     const char *scan_start, const char *scan_end,
+                     int upload_count, task_t *task_return,
+                     report_t *report_return, char **report_id)
 {
-  int index, in_assets_int, count, insert_count, first, rc;
-  create_report_result_t *result, *end, *start;
-  report_t report;
-  user_t owner;
+  int in_assets_int, rc;
   task_t task;
-  pid_t pid;
-  host_detail_t *detail;
-  GString *insert;
+  report_t report;
 
   in_assets_int
     = (in_assets && strcmp (in_assets, "") && strcmp (in_assets, "0"));
@@ -20474,7 +23662,11 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
   /* Generate report UUID. */
 
   *report_id = gvm_uuid_make ();
-  if (*report_id == NULL) return -2;
+  if (*report_id == NULL)
+    {
+      sql_rollback ();
+      return -2;
+    }
 
   /* Create the report. */
 
@@ -20497,11 +23689,186 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
   /* Show that the upload has started. */
 
   set_task_run_status (task, TASK_STATUS_RUNNING);
-  sql ("UPDATE tasks SET upload_result_count = %llu WHERE id = %llu;",
-       results->len,
+  sql ("UPDATE tasks SET upload_result_count = %i WHERE id = %llu;",
+       MAX (upload_count, 1),
        task);
   sql_commit ();
 
+  *task_return = task;
+  *report_return = report;
+  return 0;
+}
+
+/**
+ * @brief Start a streamed report upload.
+ *
+ * The report is made right away, so that results can be added in batches
+ * with create_report_stream_results while the upload is still being
+ * parsed.  The upload is finished with create_report.
+ *
+ * @param[in]   task_id       UUID of container task.
+ * @param[in]   in_assets     Whether to create assets from the report.
+ * @param[in]   scan_start    Scan start time text, or NULL.
+ * @param[in]   upload_count  Number of results expected in the upload.
+ * @param[out]  report        Report.
+ * @param[out]  report_id     Report ID.
+ *
+ * @return 0 success, else as for create_report.
+ */
+int
+create_report_stream_start (const char *task_id, const char *in_assets,
+                            const char *scan_start, int upload_count,
+                            report_t *report, char **report_id)
+{
+  task_t task;
+
+  return create_report_start (task_id, in_assets, scan_start, NULL,
+                              upload_count, &task, report, report_id);
+}
+
+/**
+ * @brief Add a batch of results to a streamed report upload.
+ *
+ * @param[in]  report        Report from create_report_stream_start.
+ * @param[in]  results       Array of create_report_result_t pointers.
+ * @param[in]  upload_count  Number of results now expected in the upload.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+create_report_stream_results (report_t report, array_t *results,
+                              int upload_count)
+{
+  task_t task;
+  user_t owner;
+
+  if (report_task (report, &task) || task == 0)
+    return -1;
+
+  if (sql_int64 (&owner,
+                 "SELECT owner FROM tasks WHERE tasks.id = %llu",
+                 task))
+    {
+      g_warning ("%s: failed to get owner of task", __func__);
+      return -1;
+    }
+
+  array_terminate (results);
+
+  sql_begin_immediate ();
+  create_report_add_results (report, task, owner, results, NULL);
+  sql ("UPDATE tasks SET upload_result_count = %i WHERE id = %llu;",
+       MAX (upload_count, 1),
+       task);
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Give up on a streamed report upload.
+ *
+ * Used when the upload fails after create_report_stream_start, for example
+ * because of a parse error or because the client went away.  Like a failed
+ * import, this interrupts the container task, and marks the partial report
+ * as Interrupted with an error result.
+ *
+ * Does nothing if the report is no longer running.
+ *
+ * @param[in]  report  Report from create_report_stream_start.
+ */
+void
+create_report_stream_abort (report_t report)
+{
+  task_t task;
+  task_status_t status;
+
+  if (report_task (report, &task) || task == 0)
+    return;
+
+  if (report_scan_run_status (report, &status)
+      || status != TASK_STATUS_RUNNING)
+    return;
+
+  current_scanner_task = task;
+  global_current_report = report;
+  set_task_interrupted (task,
+                        "Report upload failed before the end of the report."
+                        "  Setting task status to Interrupted.");
+  current_scanner_task = 0;
+  global_current_report = 0;
+}
+
+/**
+ * @brief Create a report from an array of results.
+ *
+ * @param[in]   results       Array of create_report_result_t pointers.
+ * @param[in]   task_id       UUID of container task, or NULL to create new one.
+ * @param[in]   in_assets     Whether to create assets from the report.
+ * @param[in]   scan_start    Scan start time text.
+ * @param[in]   scan_end      Scan end time text.
+ * @param[in]   host_starts   Array of create_report_result_t pointers.  Host
+ *                            name in host, time in description.
+ * @param[in]   host_ends     Array of create_report_result_t pointers.  Host
+ *                            name in host, time in description.
+ * @param[in]   details       Array of host_detail_t pointers.
+ * @param[in]   streamed      Report from create_report_stream_start when the
+ *                            upload was streamed, else 0.
+ * @param[in]   streamed_count  Number of results already streamed.
+ * @param[out]  report_id     Report ID.  When streamed, must be the ID from
+ *                            create_report_stream_start.
+ *
+ * @return 0 success, 99 permission denied, -1 error, -2 failed to generate ID,
+ *         -3 task_id is NULL, -4 failed to find task, -5 task must be
+ *         container, -6 permission to create assets denied.
+ */
+int
+create_report (array_t *results, const char *task_id, const char *in_assets,
+               const char *scan_start, const char *scan_end,
+               array_t *host_starts, array_t *host_ends, array_t *details,
+               report_t streamed, int streamed_count, char **report_id)
+{
+  int index, in_assets_int, count, insert_count, first, rc;
+  create_report_result_t *end, *start;
+  report_t report;
+  result_t counted_result;
+  user_t owner;
+  task_t task;
+  pid_t pid;
+  host_detail_t *detail;
+  GString *insert;
+
+  in_assets_int
+    = (in_assets && strcmp (in_assets, "") && strcmp (in_assets, "0"));
+
+  if (streamed)
+    {
+      report = streamed;
+      if (report_task (report, &task) || task == 0)
+        return -1;
+
+      sql_begin_immediate ();
+      if (scan_start)
+        sql ("UPDATE reports SET start_time = %i WHERE id = %llu;",
+             parse_iso_time (scan_start),
+             report);
+      if (scan_end)
+        sql ("UPDATE reports SET end_time = %i WHERE id = %llu;",
+             parse_iso_time (scan_end),
+             report);
+      sql ("UPDATE tasks SET upload_result_count = %i WHERE id = %llu;",
+           MAX (streamed_count + (int) results->len, 1),
+           task);
+      sql_commit ();
+    }
+  else
+    {
+      rc = create_report_start (task_id, in_assets, scan_start, scan_end,
+                                results->len, &task, &report, report_id);
+      if (rc)
+        return rc;
+    }
+
   /* Fork a child to import the results while the parent responds to the
    * client. */
 
@@ -20573,6 +23940,7 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
     }
 
   proctitle_set ("gvmd: Importing results");
+  manage_process_register ("report_import", 0, 0);
 
   /* Add the results. */
 
@@ -20595,109 +23963,13 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
                               0);
 
   g_debug ("%s: add results", __func__);
-  insert = g_string_new ("");
-  index = 0;
-  first = 1;
-  insert_count = 0;
-  count = 0;
-  while ((result = (create_report_result_t*) g_ptr_array_index (results,
-                                                                index++)))
+  counted_result = 0;
+  create_report_add_results (report, task, owner, results, &counted_result);
+  if (streamed && counted_result == 0)
     {
-      gchar *quoted_host, *quoted_hostname, *quoted_port, *quoted_nvt_oid;
-      gchar *quoted_description, *quoted_scan_nvt_version, *quoted_severity;
-      gchar *quoted_qod, *quoted_qod_type;
-
-      g_debug ("%s: add results: index: %i", __func__, index);
-
-      quoted_host = sql_quote (result->host ? result->host : "");
-      quoted_hostname = sql_quote (result->hostname ? result->hostname : "");
-      quoted_port = sql_quote (result->port ? result->port : "");
-      quoted_nvt_oid = sql_quote (result->nvt_oid ? result->nvt_oid : "");
-      quoted_description = sql_quote (result->description
-                                       ? result->description
-                                       : "");
-      quoted_scan_nvt_version = sql_quote (result->scan_nvt_version
-                                       ? result->scan_nvt_version
-                                       : "");
-      quoted_severity =  sql_quote (result->severity ? result->severity : "");
-      if (result->qod && strcmp (result->qod, "") && strcmp (result->qod, "0"))
-        quoted_qod = sql_quote (result->qod);
-      else
-        quoted_qod = g_strdup (G_STRINGIFY (QOD_DEFAULT));
-      quoted_qod_type = sql_quote (result->qod_type ? result->qod_type : "");
-      result_nvt_notice (quoted_nvt_oid);
-
-      if (first)
-        g_string_append (insert,
-                         "INSERT INTO results"
-                         " (uuid, owner, date, task, host, hostname, port,"
-                         "  nvt, type, description,"
-                         "  nvt_version, severity, qod, qod_type, result_nvt,"
-                         "  report)"
-                         " VALUES");
-      else
-        g_string_append (insert, ", ");
-      first = 0;
-      g_string_append_printf (insert,
-                              " (make_uuid (), %llu, m_now (), %llu, '%s',"
-                              "  '%s', '%s', '%s', '%s', '%s', '%s', '%s',"
-                              "  '%s', '%s',"
-                              "  (SELECT id FROM result_nvts WHERE nvt = '%s'),"
-                              "  %llu)",
-                              owner,
-                              task,
-                              quoted_host,
-                              quoted_hostname,
-                              quoted_port,
-                              quoted_nvt_oid,
-                              result->threat
-                               ? threat_message_type (result->threat)
-                               : "Log Message",
-                              quoted_description,
-                              quoted_scan_nvt_version,
-                              quoted_severity,
-                              quoted_qod,
-                              quoted_qod_type,
-                              quoted_nvt_oid,
-                              report);
-
-      /* Limit the number of results inserted at a time. */
-      if (insert_count == CREATE_REPORT_INSERT_SIZE)
-        {
-          sql ("%s", insert->str);
-          g_string_truncate (insert, 0);
-          count++;
-          insert_count = 0;
-          first = 1;
-
-          if (count == CREATE_REPORT_CHUNK_SIZE)
-            {
-              report_cache_counts (report, 1, 1, NULL);
-              sql_commit ();
-              gvm_usleep (CREATE_REPORT_CHUNK_SLEEP);
-              sql_begin_immediate ();
-              count = 0;
-            }
-        }
-      insert_count++;
-
-      g_free (quoted_host);
-      g_free (quoted_hostname);
-      g_free (quoted_port);
-      g_free (quoted_nvt_oid);
-      g_free (quoted_description);
-      g_free (quoted_scan_nvt_version);
-      g_free (quoted_severity);
-      g_free (quoted_qod);
-      g_free (quoted_qod_type);
-    }
-
-  if (first == 0)
-    {
-      sql ("%s", insert->str);
-      report_cache_counts (report, 1, 1, NULL);
+      /* The streamed results have not been counted yet. */
+      create_report_count (report, 0);
       sql_commit ();
-      gvm_usleep (CREATE_REPORT_CHUNK_SLEEP);
       sql_begin_immediate ();
     }
 
@@ -20747,7 +24019,7 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
   first = 1;
   count = 0;
   insert_count = 0;
-  g_string_truncate (insert, 0);
+  insert = g_string_new ("");
   while ((detail = (host_detail_t*) g_ptr_array_index (details, index++)))
     if (detail->ip && detail->name)
       {
@@ -20909,7 +24181,8 @@ report_compliance_by_uuid (const char *report_id,
       *compliance_yes 
         = sql_int ("SELECT count(*) FROM results"
                    " WHERE report = %llu"
-                   " AND description LIKE 'Compliant:%%YES%%';",
+                   " AND result_description (description, fingerprint)"
+                   "     LIKE 'Compliant:%%YES%%';",
                    report);
     }
 
@@ -20918,7 +24191,8 @@ report_compliance_by_uuid (const char *report_id,
       *compliance_no 
         = sql_int ("SELECT count(*) FROM results"
                    " WHERE report = %llu"
-                   " AND description LIKE 'Compliant:%%NO%%';",
+                   " AND result_description (description, fingerprint)"
+                   "     LIKE 'Compliant:%%NO%%';",
                    report);
     }
 
@@ -20927,7 +24201,8 @@ report_compliance_by_uuid (const char *report_id,
       *compliance_incomplete
         = sql_int ("SELECT count(*) FROM results"
                    " WHERE report = %llu"
-                   " AND description LIKE 'Compliant:%%INCOMPLETE%%';",
+                   " AND result_description (description, fingerprint)"
+                   "     LIKE 'Compliant:%%INCOMPLETE%%';",
                    report);
     }
 
@@ -21794,6 +25069,20 @@ where_qod (int min_qod)
 #define CVSS_BASE_SQL                                            \
   "(SELECT cvss_base FROM nvts WHERE nvts.oid = results.nvt)"
 
+/**
+ * @brief SQL for whether the NVT of a result has any of a kind of annotation.
+ *
+ * Uses the counts that triggers keep in result_nvts.  A result without a
+ * result_nvt may have any annotation.
+ *
+ * @param[in]  column  Count column of result_nvts: "notes", "overrides" or
+ *                     "tickets".
+ */
+#define RESULT_NVT_MAY_HAVE(column)                                           \
+  "coalesce ((SELECT " column " > 0 FROM result_nvts"                         \
+  "           WHERE result_nvts.id = results.result_nvt),"                    \
+  "          true)"
+
 /**
  * @brief Filter columns for result iterator.
  */
@@ -21834,7 +25123,9 @@ where_qod (int min_qod)
     { "'Log Message'", /* Adjusted by init_result_get_iterator_severity. */   \
       "type",                                                                 \
       KEYWORD_TYPE_STRING },                                                  \
-    { "description", NULL, KEYWORD_TYPE_STRING },                             \
+    { "result_description (description, fingerprint)",                        \
+      "description",                                                          \
+      KEYWORD_TYPE_STRING },                                                  \
     { "task", NULL, KEYWORD_TYPE_INTEGER },                                   \
     { "report", "report_rowid", KEYWORD_TYPE_INTEGER },                       \
     { "(SELECT cvss_base FROM nvts WHERE nvts.oid =  nvt)",                   \
@@ -21897,26 +25188,35 @@ where_qod (int min_qod)
       NULL,                                                                   \
       KEYWORD_TYPE_STRING },                                                  \
     { "(SELECT CASE"                                                          \
-      "        WHEN EXISTS (SELECT * FROM notes"                              \
-      "                     WHERE (result = results.id"                       \
-      "                            OR (result = 0 AND nvt = results.nvt))"    \
-      "                     AND (task = 0 OR task = results.task))"           \
+      "        WHEN " RESULT_NVT_MAY_HAVE ("notes")                           \
+      "             AND EXISTS (SELECT * FROM notes"                          \
+      "                         WHERE (result = results.id"                   \
+      "                                OR (result = 0"                        \
+      "                                    AND nvt = results.nvt))"           \
+      "                         AND (task = 0 OR task = results.task))"       \
       "        THEN 1"                                                        \
       "        ELSE 0"                                                        \
       "        END)",                                                         \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },                                                 \
     { "(SELECT CASE"                                                          \
-      "        WHEN EXISTS (SELECT * FROM overrides"                          \
-      "                     WHERE (result = results.id"                       \
-      "                            OR (result = 0 AND nvt = results.nvt))"    \
-      "                     AND (task = 0 OR task = results.task))"           \
+      "        WHEN " RESULT_NVT_MAY_HAVE ("overrides")                       \
+      "             AND EXISTS (SELECT * FROM overrides"                      \
+      "                         WHERE (result = results.id"                   \
+      "                                OR (result = 0"                        \
+      "                                    AND nvt = results.nvt))"           \
+      "                         AND (task = 0 OR task = results.task))"       \
       "        THEN 1"                                                        \
       "        ELSE 0"                                                        \
       "        END)",                                                         \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },                                                 \
-    { TICKET_SQL_RESULT_MAY_HAVE_TICKETS,                                     \
+    { "(SELECT CASE"                                                          \
+      "        WHEN " RESULT_NVT_MAY_HAVE ("tickets")                         \
+      "             AND " TICKET_SQL_RESULT_MAY_HAVE_TICKETS                  \
+      "        THEN 1"                                                        \
+      "        ELSE 0"                                                        \
+      "        END)",                                                         \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },
 
@@ -21982,7 +25282,9 @@ where_qod (int min_qod)
       " WHERE (result = results.id) AND (autofp_selection = opts.autofp))",   \
       "auto_type",                                                            \
       KEYWORD_TYPE_INTEGER },                                                 \
-    { "description", NULL, KEYWORD_TYPE_STRING },                             \
+    { "result_description (description, fingerprint)",                        \
+      "description",                                                          \
+      KEYWORD_TYPE_STRING },                                                  \
     { "task", NULL, KEYWORD_TYPE_INTEGER },                                   \
     { "report", "report_rowid", KEYWORD_TYPE_INTEGER },                       \
     { "(SELECT cvss_base FROM nvts WHERE nvts.oid =  nvt)",                   \
@@ -22053,26 +25355,35 @@ where_qod (int min_qod)
       NULL,                                                                   \
       KEYWORD_TYPE_STRING },                                                  \
     { "(SELECT CASE"                                                          \
-      "        WHEN EXISTS (SELECT * FROM notes"                              \
-      "                     WHERE (result = results.id"                       \
-      "                            OR (result = 0 AND nvt = results.nvt))"    \
-      "                     AND (task = 0 OR task = results.task))"           \
+      "        WHEN " RESULT_NVT_MAY_HAVE ("notes")                           \
+      "             AND EXISTS (SELECT * FROM notes"                          \
+      "                         WHERE (result = results.id"                   \
+      "                                OR (result = 0"                        \
+      "                                    AND nvt = results.nvt))"           \
+      "                         AND (task = 0 OR task = results.task))"       \
       "        THEN 1"                                                        \
       "        ELSE 0"                                                        \
       "        END)",                                                         \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },                                                 \
     { "(SELECT CASE"                                                          \
-      "        WHEN EXISTS (SELECT * FROM overrides"                          \
-      "                     WHERE (result = results.id"                       \
-      "                            OR (result = 0 AND nvt = results.nvt))"    \
-      "                     AND (task = 0 OR task = results.task))"           \
+      "        WHEN " RESULT_NVT_MAY_HAVE ("overrides")                       \
+      "             AND EXISTS (SELECT * FROM overrides"                      \
+      "                         WHERE (result = results.id"                   \
+      "                                OR (result = 0"                        \
+      "                                    AND nvt = results.nvt))"           \
+      "                         AND (task = 0 OR task = results.task))"       \
       "        THEN 1"                                                        \
       "        ELSE 0"                                                        \
       "        END)",                                                         \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },                                                 \
-    { TICKET_SQL_RESULT_MAY_HAVE_TICKETS,                                     \
+    { "(SELECT CASE"                                                          \
+      "        WHEN " RESULT_NVT_MAY_HAVE ("tickets")                         \
+      "             AND " TICKET_SQL_RESULT_MAY_HAVE_TICKETS                  \
+      "        THEN 1"                                                        \
+      "        ELSE 0"                                                        \
+      "        END)",                                                         \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },
 
@@ -22088,6 +25399,9 @@ where_qod (int min_qod)
     { SECINFO_SQL_RESULT_DFN_CERTS,                                           \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },                                                 \
+    { "coalesce (fingerprint, md5 (coalesce (description, '')))",            \
+      "fingerprint",                                                          \
+      KEYWORD_TYPE_STRING },                                                  \
     { NULL, NULL, KEYWORD_TYPE_UNKNOWN }                                      \
   }
 
@@ -22103,6 +25417,9 @@ where_qod (int min_qod)
     { "0",                                                                    \
       NULL,                                                                   \
       KEYWORD_TYPE_INTEGER },                                                 \
+    { "coalesce (fingerprint, md5 (coalesce (description, '')))",            \
+      "fingerprint",                                                          \
+      KEYWORD_TYPE_STRING },                                                  \
     { NULL, NULL, KEYWORD_TYPE_UNKNOWN }                                      \
   }
 
@@ -22509,6 +25826,212 @@ init_result_get_iterator_severity (iterator_t* iterator, const get_data_t *get,
   return ret;
 }
 
+/**
+ * @brief Number of rows per batch when streaming results.
+ */
+#define RESULT_ITERATOR_FETCH_SIZE 1000
+
+/**
+ * @brief Get the ORDER BY expression that filter_clause uses for a result.
+ *
+ * This must match the expressions that filter_clause uses for sorting.
+ *
+ * @param[in]  columns         Result iterator columns.
+ * @param[in]  filter_columns  Result filter columns.
+ * @param[in]  field           Sort field.
+ *
+ * @return Freshly allocated SQL expression, or NULL if the field does not
+ *         sort.
+ */
+static gchar *
+result_sort_expression (column_t *columns, const char **filter_columns,
+                        const char *field)
+{
+  gchar *column;
+  keyword_type_t column_type;
+
+  if (vector_find_filter (filter_columns, field) == 0)
+    return NULL;
+
+  column = columns_select_column_with_type (columns, NULL, field,
+                                            &column_type);
+  if (column == NULL)
+    return NULL;
+
+  if (strcmp (field, "severity") == 0
+      || strcmp (field, "original_severity") == 0
+      || strcmp (field, "cvss") == 0
+      || strcmp (field, "cvss_base") == 0)
+    return g_strdup_printf ("CASE CAST (%s AS text)"
+                            " WHEN '' THEN NULL"
+                            " ELSE CAST (%s AS REAL) END",
+                            column,
+                            column);
+
+  if (strcmp (field, "created") == 0
+      || strcmp (field, "modified") == 0
+      || strcmp (field, "qod") == 0)
+    return g_strdup (column);
+
+  if (column_type == KEYWORD_TYPE_INTEGER)
+    return g_strdup_printf ("cast (%s AS bigint)", column);
+  if (column_type == KEYWORD_TYPE_DOUBLE)
+    return g_strdup_printf ("cast (%s AS real)", column);
+  return g_strdup_printf ("lower (%s)", column);
+}
+
+/**
+ * @brief Get the keyset pagination clauses for a result iterator.
+ *
+ * With "after=<result UUID>" in the filter the page starts after the given
+ * result in the sort order of the filter, so "first" counts from there
+ * instead of from the start.  The result ID breaks ties between results
+ * with the same sort key.
+ *
+ * The anchor must be a result that the user may get and that the iterator
+ * itself would return, so that the sort key of other results cannot be
+ * probed.
+ *
+ * The page must be sorted on the key of the clause, and filter_clause only
+ * sorts on fields that it knows, so the filter for the iterator gets the
+ * sort term of the key in place of any others.  Without a usable sort term
+ * this is the default, "name".  "cvss" is taken as an alias of "severity".
+ *
+ * @param[in]   filter          Filter term.
+ * @param[in]   columns         Result iterator columns.
+ * @param[in]   filter_columns  Result filter columns.
+ * @param[in]   extra_tables    Extra tables of the iterator.
+ * @param[in]   extra_where     Extra WHERE clause of the iterator.
+ * @param[out]  order           Return for the tie breaking ORDER clause.
+ * @param[out]  sorted_filter   Return for the filter term to iterate with.
+ *
+ * @return Freshly allocated extra WHERE clause, or NULL if the filter does
+ *         not ask for keyset pagination.
+ */
+static gchar *
+result_keyset_where (const gchar *filter, column_t *columns,
+                     const char **filter_columns, const gchar *extra_tables,
+                     const gchar *extra_where, gchar **order,
+                     gchar **sorted_filter)
+{
+  gchar *after, *field, *key, *anchor, *clause, *unsorted, *clean;
+  result_t anchor_result;
+  int reverse;
+
+  after = filter_term_value (filter, "after");
+  if (after == NULL || strcmp (after, "") == 0)
+    {
+      g_free (after);
+      return NULL;
+    }
+
+  reverse = 0;
+  field = filter_term_value (filter, "sort");
+  if (field == NULL)
+    {
+      field = filter_term_value (filter, "sort-reverse");
+      reverse = (field != NULL);
+    }
+  if (field && strcmp (field, "cvss") == 0)
+    {
+      g_free (field);
+      field = g_strdup ("severity");
+    }
+
+  key = field ? result_sort_expression (columns, filter_columns, field)
+              : NULL;
+  if (key == NULL)
+    {
+      g_free (field);
+      field = g_strdup ("name");
+      reverse = 0;
+      key = result_sort_expression (columns, filter_columns, field);
+      assert (key);
+    }
+
+  /* The second removal drops the default sort term that the first adds. */
+  unsorted = manage_clean_filter_remove (filter, "sort-reverse");
+  clean = manage_clean_filter_remove (unsorted, "sort");
+  g_free (unsorted);
+  *sorted_filter = g_strdup_printf ("%s %s=%s",
+                                    clean,
+                                    reverse ? "sort-reverse" : "sort",
+                                    field);
+  g_free (clean);
+  g_free (field);
+
+  anchor_result = 0;
+  if (find_result_with_permission (after, &anchor_result, "get_results"))
+    anchor_result = 0;
+  g_free (after);
+  if (anchor_result
+      && sql_int ("SELECT count (*) FROM results%s"
+                  " WHERE results.id = %llu%s;",
+                  extra_tables ? extra_tables : "",
+                  anchor_result,
+                  extra_where ? extra_where : "")
+         == 0)
+    anchor_result = 0;
+  if (anchor_result == 0)
+    {
+      /* The result is gone, or hidden, so there is no place to continue
+       * from. */
+      g_free (key);
+      *order = NULL;
+      return g_strdup (" AND false");
+    }
+
+  anchor = sql_string ("SELECT quote_nullable (%s) FROM results%s"
+                       " WHERE results.id = %llu;",
+                       key,
+                       extra_tables ? extra_tables : "",
+                       anchor_result);
+
+  /* ASC sorts NULL keys last, DESC sorts them first. */
+  if (reverse)
+    {
+      if (anchor == NULL || strcmp (anchor, "NULL") == 0)
+        clause = g_strdup_printf (" AND (%s IS NOT NULL"
+                                  "      OR results.id < %llu)",
+                                  key,
+                                  anchor_result);
+      else
+        clause = g_strdup_printf (" AND (%s < %s"
+                                  "      OR (%s = %s"
+                                  "          AND results.id < %llu))",
+                                  key,
+                                  anchor,
+                                  key,
+                                  anchor,
+                                  anchor_result);
+      *order = g_strdup (", results.id DESC");
+    }
+  else
+    {
+      if (anchor == NULL || strcmp (anchor, "NULL") == 0)
+        clause = g_strdup_printf (" AND (%s IS NULL"
+                                  "      AND results.id > %llu)",
+                                  key,
+                                  anchor_result);
+      else
+        clause = g_strdup_printf (" AND (%s > %s"
+                                  "      OR (%s = %s"
+                                  "          AND results.id > %llu)"
+                                  "      OR %s IS NULL)",
+                                  key,
+                                  anchor,
+                                  key,
+                                  anchor,
+                                  anchor_result,
+                                  key);
+      *order = g_strdup (", results.id ASC");
+    }
+
+  g_free (anchor);
+  g_free (key);
+  return clause;
+}
+
 /**
  * @brief Initialise a result iterator.
  *
@@ -22533,7 +26056,8 @@ init_result_get_iterator (iterator_t* iterator, const get_data_t *get,
   gchar *filter;
   int autofp, apply_overrides, dynamic_severity;
 
-  gchar *extra_tables, *extra_where;
+  gchar *extra_tables, *extra_where, *keyset_order, *sorted_filter;
+  get_data_t sorted_get;
 
   if (report == -1)
     {
@@ -22562,8 +26086,44 @@ init_result_get_iterator (iterator_t* iterator, const get_data_t *get,
                                      autofp, apply_overrides, dynamic_severity,
                                      filter ? filter : get->filter);
 
+  keyset_order = NULL;
+  sorted_filter = NULL;
+  if (extra_order == NULL && get->id == NULL)
+    {
+      gchar *keyset_where;
+
+      keyset_where = result_keyset_where (filter ? filter : get->filter,
+                                          manage_cert_loaded ()
+                                           ? columns
+                                           : columns_no_cert,
+                                          filter_columns,
+                                          extra_tables,
+                                          extra_where,
+                                          &keyset_order,
+                                          &sorted_filter);
+      if (keyset_where)
+        {
+          gchar *old_where;
+
+          old_where = extra_where;
+          extra_where = g_strdup_printf ("%s%s", old_where, keyset_where);
+          g_free (old_where);
+          g_free (keyset_where);
+        }
+    }
+
   free (filter);
 
+  /* Iterate with the sort term of the keyset, so that the page is in the
+   * order of the keyset clause. */
+  if (sorted_filter)
+    {
+      sorted_get = *get;
+      sorted_get.filt_id = NULL;
+      sorted_get.filter = sorted_filter;
+      get = &sorted_get;
+    }
+
   ret = init_get_iterator2 (iterator,
                             "result",
                             get,
@@ -22579,9 +26139,18 @@ init_result_get_iterator (iterator_t* iterator, const get_data_t *get,
                             extra_where,
                             TRUE,
                             report ? TRUE : FALSE,
-                            extra_order);
+                            keyset_order ? keyset_order : extra_order);
   g_free (extra_tables);
   g_free (extra_where);
+  g_free (keyset_order);
+  g_free (sorted_filter);
+
+  /* Reports can have a huge number of results, so stream them unless this
+   * is a lookup of a single result.  This only streams when the caller is
+   * inside a transaction. */
+  if (ret == 0 && get->id == NULL)
+    iterator_stream (iterator, RESULT_ITERATOR_FETCH_SIZE);
+
   return ret;
 }
 
@@ -22695,12 +26264,9 @@ DEF_ACCESS (result_iterator_nvt_oid, GET_ITERATOR_COLUMN_COUNT + 2);
 const char*
 result_iterator_nvt_name (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_name (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_NAME);
 }
 
 /**
@@ -22713,12 +26279,9 @@ result_iterator_nvt_name (iterator_t *iterator)
 const char*
 result_iterator_nvt_summary (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_summary (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_SUMMARY);
 }
 
 /**
@@ -22731,12 +26294,9 @@ result_iterator_nvt_summary (iterator_t *iterator)
 const char*
 result_iterator_nvt_insight (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_insight (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_INSIGHT);
 }
 
 /**
@@ -22749,12 +26309,9 @@ result_iterator_nvt_insight (iterator_t *iterator)
 const char*
 result_iterator_nvt_affected (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_affected (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_AFFECTED);
 }
 
 /**
@@ -22767,12 +26324,9 @@ result_iterator_nvt_affected (iterator_t *iterator)
 const char*
 result_iterator_nvt_impact (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_impact (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_IMPACT);
 }
 
 /**
@@ -22785,12 +26339,9 @@ result_iterator_nvt_impact (iterator_t *iterator)
 const char*
 result_iterator_nvt_solution (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_solution (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_SOLUTION);
 }
 
 /**
@@ -22804,12 +26355,9 @@ result_iterator_nvt_solution (iterator_t *iterator)
 const char*
 result_iterator_nvt_solution_type (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_solution_type (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_SOLUTION_TYPE);
 }
 
 /**
@@ -22823,12 +26371,9 @@ result_iterator_nvt_solution_type (iterator_t *iterator)
 const char*
 result_iterator_nvt_solution_method (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_solution_method (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_SOLUTION_METHOD);
 }
 
 /**
@@ -22841,12 +26386,9 @@ result_iterator_nvt_solution_method (iterator_t *iterator)
 const char*
 result_iterator_nvt_detection (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_detection (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_DETECTION);
 }
 
 /**
@@ -22859,12 +26401,9 @@ result_iterator_nvt_detection (iterator_t *iterator)
 const char*
 result_iterator_nvt_family (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_family (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_FAMILY);
 }
 
 /**
@@ -22877,12 +26416,9 @@ result_iterator_nvt_family (iterator_t *iterator)
 const char*
 result_iterator_nvt_cvss_base (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_cvss_base (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_CVSS_BASE);
 }
 
 /**
@@ -22895,9 +26431,38 @@ result_iterator_nvt_cvss_base (iterator_t *iterator)
 void
 nvti_refs_append_xml (GString *xml, const char *oid, int *first)
 {
-  nvti_t *nvti = lookup_nvti (oid);
+  nvti_t *nvti;
   int i;
 
+  if (nvti_map)
+    {
+      const nvti_map_record_t *record;
+      guint32 index;
+
+      /* Use the strings in the mapping directly. */
+      record = nvti_map_lookup (oid);
+      if (record == NULL)
+        return;
+
+      for (index = 0; index < record->refs_count; index++)
+        {
+          const nvti_map_ref_t *ref;
+
+          if (first && *first)
+            {
+              xml_string_append (xml, "<refs>");
+              *first = 0;
+            }
+
+          ref = nvti_map_ref (record, index);
+          xml_string_append (xml, "<ref type=\"%s\" id=\"%s\"/>",
+                             nvti_map_string (ref->type),
+                             nvti_map_string (ref->id));
+        }
+      return;
+    }
+
+  nvti = lookup_nvti (oid);
   if (!nvti)
     return;
 
@@ -22941,12 +26506,9 @@ result_iterator_nvt_refs_append (GString *xml, iterator_t *iterator, int *first)
 const char*
 result_iterator_nvt_tag (iterator_t *iterator)
 {
-  nvti_t *nvti;
   if (iterator->done) return NULL;
-  nvti = lookup_nvti (result_iterator_nvt_oid (iterator));
-  if (nvti)
-    return nvti_tag (nvti);
-  return NULL;
+  return nvti_cache_field (result_iterator_nvt_oid (iterator),
+                           NVTI_MAP_TAG);
 }
 
 /**
@@ -23307,6 +26869,18 @@ result_iterator_dfn_certs (iterator_t* iterator)
   return iterator_array (iterator, GET_ITERATOR_COLUMN_COUNT + 28);
 }
 
+/**
+ * @brief Get the fingerprint from a result iterator.
+ *
+ * The fingerprint is a hash of the description.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return The fingerprint of the result, or NULL.  Caller must only use
+ *         before calling cleanup_iterator.
+ */
+DEF_ACCESS (result_iterator_fingerprint, GET_ITERATOR_COLUMN_COUNT + 29);
+
 /**
  * @brief Check if the result_nvts are assigned to result
  *
@@ -23402,7 +26976,7 @@ init_report_host_iterator (iterator_t* iterator, report_t report, const char *ho
                        " FROM report_hosts WHERE id = %llu"
                        " AND report = %llu"
                        "%s%s%s"
-                       " ORDER BY order_inet (host);",
+                       " ORDER BY host_order;",
                        report_host,
                        report,
                        host ? " AND host = '" : "",
@@ -23424,7 +26998,7 @@ init_report_host_iterator (iterator_t* iterator, report_t report, const char *ho
                        "              LIMIT 1))"
                        " FROM report_hosts WHERE report = %llu"
                        "%s%s%s"
-                       " ORDER BY order_inet (host);",
+                       " ORDER BY host_order;",
                        report,
                        host ? " AND host = '" : "",
                        host ? host : "",
@@ -23440,7 +27014,7 @@ init_report_host_iterator (iterator_t* iterator, report_t report, const char *ho
                        " ''"
                        " FROM report_hosts WHERE id = %llu"
                        "%s%s%s"
-                       " ORDER BY order_inet (host);",
+                       " ORDER BY host_order;",
                        report_host,
                        host ? " AND host = '" : "",
                        host ? host : "",
@@ -23453,7 +27027,7 @@ init_report_host_iterator (iterator_t* iterator, report_t report, const char *ho
                        " ''"
                        " FROM report_hosts"
                        "%s%s%s"
-                       " ORDER BY order_inet (host);",
+                       " ORDER BY host_order;",
                        host ? " WHERE host = '" : "",
                        host ? host : "",
                        host ? "'" : "");
@@ -23560,13 +27134,23 @@ init_report_errors_iterator (iterator_t* iterator, report_t report)
   if (report)
     init_iterator (iterator,
                    "SELECT results.host, results.port, results.nvt,"
-                   " results.description,"
+                   " result_description (results.description,"
+                   "                     results.fingerprint),"
                    " coalesce((SELECT name FROM nvts"
                    "           WHERE nvts.oid = results.nvt), ''),"
                    " coalesce((SELECT cvss_base FROM nvts"
                    "           WHERE nvts.oid = results.nvt), ''),"
                    " results.nvt_version, results.severity,"
-                   " results.id"
+                   " results.id,"
+                   " (SELECT uuid FROM hosts"
+                   "  WHERE id = (SELECT host FROM host_identifiers"
+                   "              WHERE source_type = 'Report Host'"
+                   "              AND name = 'ip'"
+                   "              AND source_id = (SELECT uuid"
+                   "                               FROM reports"
+                   "                               WHERE id = results.report)"
+                   "              AND value = results.host"
+                   "              LIMIT 1))"
                    " FROM results"
                    " WHERE results.type = 'Error Message'"
                    "  AND results.report = %llu",
@@ -23675,6 +27259,17 @@ report_errors_iterator_result (iterator_t* iterator)
   return iterator_int64 (iterator, 8);
 }
 
+/**
+ * @brief Get the asset UUID from a report error messages iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return The UUID of the asset of the host of the report error message.
+ *         Caller must use only before calling cleanup_iterator.
+ */
+static
+DEF_ACCESS (report_errors_iterator_asset_id, 9);
+
 /**
  * @brief Initialise a report host details iterator.
  *
@@ -23706,6 +27301,59 @@ init_report_host_details_iterator (iterator_t* iterator,
                  report_host);
 }
 
+/**
+ * @brief Initialise a report host details iterator over several hosts.
+ *
+ * The details of each report host are adjacent, with the report host in
+ * column 7.
+ *
+ * @param[in]  iterator      Iterator.
+ * @param[in]  report_hosts  Comma separated list of report hosts.
+ */
+static void
+init_report_host_details_hosts_iterator (iterator_t* iterator,
+                                         const char *report_hosts)
+{
+  init_iterator (iterator,
+                 "SELECT id, name, value, source_type, source_name,"
+                 "       source_description, extra, report_host"
+                 " FROM (SELECT id, name, value, source_type, source_name,"
+                 "              source_description, NULL AS extra,"
+                 "              report_host"
+                 "       FROM report_host_details"
+                 "       WHERE report_host IN (%s)"
+                 "       AND NOT name IN ('detected_at', 'detected_by')"
+                 "       UNION SELECT 0, 'Closed CVE', cve, 'openvasmd', oid,"
+                 "                    nvts.name, cvss_base, report_host"
+                 "             FROM nvts, report_host_details"
+                 "             WHERE cve != ''"
+                 "             AND family IN (" LSC_FAMILY_LIST ")"
+                 "             AND nvts.oid = report_host_details.source_name"
+                 "             AND report_host IN (%s)"
+                 "             AND report_host_details.name = 'EXIT_CODE'"
+                 "             AND report_host_details.value = 'EXIT_NOTVULN')"
+                 "      AS details"
+                 " ORDER BY report_host;",
+                 report_hosts,
+                 report_hosts);
+}
+
+/**
+ * @brief Get the report host from a report host details iterator.
+ *
+ * Only for iterators from init_report_host_details_hosts_iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Report host.
+ */
+static report_host_t
+report_host_details_iterator_report_host (iterator_t* iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 7);
+}
+
 /**
  * @brief Get the name from a report host details iterator.
  *
@@ -24098,6 +27746,31 @@ set_scan_host_start_time_ctime (report_t report, const char* host,
   g_free (quoted_host);
 }
 
+/**
+ * @brief Get the timestamp of a report in a given timezone.
+ *
+ * @param[in]   report_id    UUID of report.
+ * @param[in]   zone         Timezone, or NULL for the TZ of the process.
+ * @param[out]  timestamp    Timestamp on success.  Caller must free.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int
+report_timestamp_zone (const char* report_id, const char *zone,
+                       gchar** timestamp)
+{
+  const char* stamp;
+  time_t time = sql_int ("SELECT date FROM reports where uuid = '%s';",
+                         report_id);
+  if (zone)
+    stamp = iso_time_tz (&time, zone, NULL);
+  else
+    stamp = iso_time (&time);
+  if (stamp == NULL) return -1;
+  *timestamp = g_strdup (stamp);
+  return 0;
+}
+
 /**
  * @brief Get the timestamp of a report.
  *
@@ -24113,13 +27786,7 @@ set_scan_host_start_time_ctime (report_t report, const char* host,
 int
 report_timestamp (const char* report_id, gchar** timestamp)
 {
-  const char* stamp;
-  time_t time = sql_int ("SELECT date FROM reports where uuid = '%s';",
-                         report_id);
-  stamp = iso_time (&time);
-  if (stamp == NULL) return -1;
-  *timestamp = g_strdup (stamp);
-  return 0;
+  return report_timestamp_zone (report_id, NULL, timestamp);
 }
 
 /**
@@ -24139,6 +27806,23 @@ report_scan_run_status (report_t report, task_status_t* status)
   return 0;
 }
 
+/**
+ * @brief Move the live progress of a report into the report.
+ *
+ * @param[in]  report  The report.
+ */
+static void
+report_live_progress_end (report_t report)
+{
+  sql ("UPDATE reports"
+       " SET slave_progress = live_report_progress.progress"
+       " FROM live_report_progress"
+       " WHERE reports.id = %llu"
+       " AND live_report_progress.report = reports.id;",
+       report);
+  sql ("DELETE FROM live_report_progress WHERE report = %llu;", report);
+}
+
 /**
  * @brief Return the run status of the scan associated with a report.
  *
@@ -24150,9 +27834,17 @@ report_scan_run_status (report_t report, task_status_t* status)
 int
 set_report_scan_run_status (report_t report, task_status_t status)
 {
+  task_t task;
+
   sql ("UPDATE reports SET scan_run_status = %u WHERE id = %llu;",
        status,
        report);
+  if (status == TASK_STATUS_DONE
+      || status == TASK_STATUS_STOPPED
+      || status == TASK_STATUS_INTERRUPTED)
+    report_live_progress_end (report);
+  if (report_task (report, &task) == 0 && task)
+    task_summary_update (task);
   if (setting_auto_cache_rebuild_int ())
     report_cache_counts (report, 0, 0, NULL);
   return 0;
@@ -24305,14 +27997,18 @@ report_counts_cache_exists (report_t report, int override, int min_qod)
   if (setting_dynamic_severity_int ())
     return 0;
   else
-    return sql_int ("SELECT EXISTS (SELECT * FROM report_counts"
-                    " WHERE report = %llu"
-                    "   AND override = %d"
-                    "   AND \"user\" = (SELECT id FROM users"
-                    "                   WHERE users.uuid = '%s')"
-                    "   AND min_qod = %d"
-                    "   AND (end_time = 0 OR end_time >= m_now ()));",
-                    report, override, current_credentials.uuid, min_qod);
+    return sql_int_ps ("SELECT EXISTS (SELECT * FROM report_counts"
+                       " WHERE report = $1"
+                       "   AND override = $2"
+                       "   AND \"user\" = (SELECT id FROM users"
+                       "                   WHERE users.uuid = $3)"
+                       "   AND min_qod = $4"
+                       "   AND (end_time = 0 OR end_time >= m_now ()));",
+                       SQL_RESOURCE_PARAM (report),
+                       SQL_INT_PARAM (override),
+                       SQL_STR_PARAM (current_credentials.uuid),
+                       SQL_INT_PARAM (min_qod),
+                       NULL);
 }
 
 /**
@@ -24328,15 +28024,19 @@ report_counts_from_cache (report_t report, int override, int min_qod,
                           severity_data_t* data)
 {
   iterator_t iterator;
-  init_iterator (&iterator,
-                 "SELECT severity, count FROM report_counts"
-                 " WHERE report = %llu"
-                 "   AND override = %i"
-                 "   AND \"user\" = (SELECT id FROM users"
-                 "                   WHERE users.uuid = '%s')"
-                 "   AND min_qod = %d"
-                 "   AND (end_time = 0 OR end_time >= m_now ());",
-                 report, override, current_credentials.uuid, min_qod);
+  init_ps_iterator (&iterator,
+                    "SELECT severity, count FROM report_counts"
+                    " WHERE report = $1"
+                    "   AND override = $2"
+                    "   AND \"user\" = (SELECT id FROM users"
+                    "                   WHERE users.uuid = $3)"
+                    "   AND min_qod = $4"
+                    "   AND (end_time = 0 OR end_time >= m_now ());",
+                    SQL_RESOURCE_PARAM (report),
+                    SQL_INT_PARAM (override),
+                    SQL_STR_PARAM (current_credentials.uuid),
+                    SQL_INT_PARAM (min_qod),
+                    NULL);
   while (next (&iterator))
     {
       severity_data_add_count (data,
@@ -24346,6 +28046,94 @@ report_counts_from_cache (report_t report, int override, int min_qod,
   cleanup_iterator (&iterator);
 }
 
+/**
+ * @brief Check whether a severity passes the levels and severity filter terms.
+ *
+ * @param[in]  severity           Severity.
+ * @param[in]  levels             Levels, like "hmlgdf".  NULL for all.
+ * @param[in]  severity_keywords  Filter keywords on the severity column.
+ *
+ * @return 1 if the severity passes, else 0.
+ */
+static int
+severity_passes_filter (double severity, const char *levels,
+                        GPtrArray *severity_keywords)
+{
+  guint index;
+
+  if (levels
+      && !((strchr (levels, 'h') && severity_in_level (severity, "high"))
+           || (strchr (levels, 'm') && severity_in_level (severity, "medium"))
+           || (strchr (levels, 'l') && severity_in_level (severity, "low"))
+           || (strchr (levels, 'g') && severity_in_level (severity, "log"))
+           || (strchr (levels, 'd') && severity == SEVERITY_DEBUG)
+           || (strchr (levels, 'f') && severity == SEVERITY_FP)))
+    return 0;
+
+  for (index = 0; index < severity_keywords->len; index++)
+    {
+      keyword_t *keyword;
+      double value;
+
+      keyword = g_ptr_array_index (severity_keywords, index);
+      if (keyword->type == KEYWORD_TYPE_INTEGER)
+        value = keyword->integer_value;
+      else
+        value = keyword->double_value;
+
+      switch (keyword->relation)
+        {
+          case KEYWORD_RELATION_COLUMN_ABOVE:
+            if (severity <= value)
+              return 0;
+            break;
+          case KEYWORD_RELATION_COLUMN_BELOW:
+            if (severity >= value)
+              return 0;
+            break;
+          case KEYWORD_RELATION_COLUMN_EQUAL:
+            if (severity - value > 0.1 / SEVERITY_SUBDIVISIONS
+                || value - severity > 0.1 / SEVERITY_SUBDIVISIONS)
+              return 0;
+            break;
+          default:
+            assert (0);
+            break;
+        }
+    }
+
+  return 1;
+}
+
+/**
+ * @brief Restrict severity counts to the levels and severity filter terms.
+ *
+ * This gives the same counts as applying the terms to the results, because
+ * the counts are kept per severity.
+ *
+ * @param[in,out]  data               Severity counts.
+ * @param[in]      levels             Levels, like "hmlgdf".  NULL for all.
+ * @param[in]      severity_keywords  Filter keywords on the severity column.
+ */
+static void
+severity_data_apply_filter (severity_data_t *data, const char *levels,
+                            GPtrArray *severity_keywords)
+{
+  severity_data_t filtered;
+  double severity;
+  int index;
+
+  init_severity_data (&filtered);
+  for (index = 0;
+       (severity = severity_data_value (index)) != SEVERITY_MISSING;
+       index++)
+    if (data->counts[index]
+        && severity_passes_filter (severity, levels, severity_keywords))
+      severity_data_add_count (&filtered, severity, data->counts[index]);
+  cleanup_severity_data (data);
+  *data = filtered;
+}
+
 /**
  * @brief Cache the message counts for a report.
  *
@@ -24493,9 +28281,10 @@ report_counts_id_full (report_t report, int* debugs, int* holes, int* infos,
                        int* filtered_warnings, int* filtered_false_positives,
                        double* filtered_severity)
 {
-  const char *filter;
+  const char *filter, *levels;
   keyword_t **point;
   array_t *split;
+  GPtrArray *severity_keywords;
   int filter_cacheable, unfiltered_requested, filtered_requested, cache_exists;
   const char *severity_class;
   int override, min_qod_int;
@@ -24530,6 +28319,10 @@ report_counts_id_full (report_t report, int* debugs, int* holes, int* infos,
   override = 0;
   min_qod_int = MIN_QOD_DEFAULT;
 
+  /* Levels and severity terms are applied to the cached counts. */
+  levels = NULL;
+  severity_keywords = g_ptr_array_new ();
+
   if (filter == NULL)
     filter = "";
 
@@ -24575,13 +28368,31 @@ report_counts_id_full (report_t report, int* debugs, int* holes, int* infos,
               filter_cacheable = FALSE;
             }
         }
+      else if (strcasecmp (keyword->column, "levels") == 0)
+        {
+          if (keyword->string == NULL || strlen (keyword->string) == 0)
+            levels = NULL;
+          else if (strspn (keyword->string, "hmlgdf")
+                   == strlen (keyword->string))
+            levels = keyword->string;
+          else
+            filter_cacheable = FALSE;
+        }
+      else if (strcasecmp (keyword->column, "severity") == 0
+               && (keyword->type == KEYWORD_TYPE_INTEGER
+                   || keyword->type == KEYWORD_TYPE_DOUBLE)
+               && (keyword->relation == KEYWORD_RELATION_COLUMN_ABOVE
+                   || keyword->relation == KEYWORD_RELATION_COLUMN_BELOW
+                   || keyword->relation == KEYWORD_RELATION_COLUMN_EQUAL))
+        {
+          g_ptr_array_add (severity_keywords, keyword);
+        }
       else
         {
           filter_cacheable = FALSE;
         }
       point++;
     }
-  filter_free (split);
 
   cache_exists = filter_cacheable
                  && report_counts_cache_exists (report, override, min_qod_int);
@@ -24605,6 +28416,22 @@ report_counts_id_full (report_t report, int* debugs, int* holes, int* infos,
         report_counts_from_cache (report, override, min_qod_int,
                                   &filtered_severity_data);
     }
+  else if (filter_cacheable && (levels || severity_keywords->len))
+    {
+      get_data_t *get_cacheable;
+
+      /* Recalculate without the levels and severity terms, so that the
+       * counts can go in the cache. */
+      get_cacheable = report_results_get_data (1, -1, override, 0,
+                                               min_qod_int);
+      report_severity_data (report, host, get_cacheable,
+                            unfiltered_requested
+                              ? &severity_data : NULL,
+                            filtered_requested
+                              ? &filtered_severity_data : NULL);
+      get_data_reset (get_cacheable);
+      free (get_cacheable);
+    }
   else
     {
       /* Recalculate. */
@@ -24615,6 +28442,21 @@ report_counts_id_full (report_t report, int* debugs, int* holes, int* infos,
                               ? &filtered_severity_data : NULL);
     }
 
+  if (filter_cacheable && !cache_exists)
+    {
+      if (unfiltered_requested)
+        cache_report_counts (report, override, 0, &severity_data);
+      if (filtered_requested)
+        cache_report_counts (report, override, min_qod_int,
+                             &filtered_severity_data);
+    }
+
+  if (filter_cacheable && (levels || severity_keywords->len))
+    severity_data_apply_filter (&filtered_severity_data, levels,
+                                severity_keywords);
+  g_ptr_array_free (severity_keywords, TRUE);
+  filter_free (split);
+
   severity_data_level_counts (&severity_data, severity_class,
                               NULL, NULL, false_positives,
                               logs, infos, warnings, holes);
@@ -24628,15 +28470,6 @@ report_counts_id_full (report_t report, int* debugs, int* holes, int* infos,
   if (filtered_severity && filtered_requested)
     *filtered_severity = filtered_severity_data.max;
 
-  if (filter_cacheable && !cache_exists)
-    {
-      if (unfiltered_requested)
-        cache_report_counts (report, override, 0, &severity_data);
-      if (filtered_requested)
-        cache_report_counts (report, override, min_qod_int,
-                             &filtered_severity_data);
-    }
-
   cleanup_severity_data (&severity_data);
   cleanup_severity_data (&filtered_severity_data);
 
@@ -24715,11 +28548,221 @@ report_severity (report_t report, int overrides, int min_qod)
   return severity;
 }
 
+/**
+ * @brief Maximum number of reports deleted per transaction by bulk deletion.
+ */
+#define REPORT_DELETE_CHUNK_SIZE 10
+
+/**
+ * @brief Delete the slave task of a report, if there is one.
+ *
+ * @param[in]  report  Report.
+ * @param[in]  task    Task of report.
+ */
+static void
+delete_report_slave_task (report_t report, task_t task)
+{
+  char *slave_task_uuid;
+  scanner_t slave;
+
+  slave_task_uuid = report_slave_task_uuid (report);
+  g_debug ("%s: slave_task_uuid: %s", __func__, slave_task_uuid);
+  if (slave_task_uuid == NULL)
+    return;
+
+  /* A stopped report leaves the task on the slave.  Try delete the task. */
+
+  slave = task_scanner (task);
+  if (slave)
+    {
+      char *username, *password;
+
+      username = scanner_login (slave);
+      password = scanner_password (slave);
+      if (username && password)
+        {
+          char *host;
+          int port;
+
+          /* Try with values stored on report. */
+          host = report_slave_host (report);
+          port = report_slave_port_int (report);
+          if (host)
+            delete_slave_task (host, port, username, password,
+                               slave_task_uuid);
+          g_free (host);
+
+          /* TODO If that fails, try with the current values from the
+           *      slave/scanner stored on the report.  And if that fails,
+           *      try with the values from the current slave of the task. */
+        }
+      free (username);
+      free (password);
+    }
+  free (slave_task_uuid);
+}
+
+/**
+ * @brief Set the run status of a task from its last remaining report.
+ *
+ * @param[in]  task  Task.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+task_reset_run_status (task_t task)
+{
+  report_t report;
+
+  switch (sql_int64 (&report,
+                     "SELECT max (id) FROM reports WHERE task = %llu",
+                     task))
+    {
+      case 0:
+        if (report)
+          {
+            task_status_t status;
+            if (report_scan_run_status (report, &status))
+              return -1;
+            sql ("UPDATE tasks SET run_status = %u WHERE id = %llu;",
+                 status,
+                 task);
+            cluster_task_status (task, status);
+          }
+        else
+          {
+            sql ("UPDATE tasks SET run_status = %u WHERE id = %llu;",
+                 TASK_STATUS_NEW,
+                 task);
+            cluster_task_status (task, TASK_STATUS_NEW);
+          }
+        break;
+      case 1:        /* Too few rows in result of query. */
+        break;
+      default:       /* Programming error. */
+        assert (0);
+      case -1:
+        return -1;
+        break;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Delete the data of a set of reports, and the reports themselves.
+ *
+ * Each table is cleared with a single statement for the whole set.
+ *
+ * It's up to the caller to provide the transaction, and to check that
+ * none of the reports is in use.
+ *
+ * @param[in]  reports  Reports.
+ */
+static void
+delete_reports_data (GArray *reports)
+{
+  GString *ids;
+  guint index;
+  gchar *tasks;
+  GHashTable *uuids;
+  iterator_t rows;
+
+  if (reports->len == 0)
+    return;
+
+  ids = g_string_new ("");
+  for (index = 0; index < reports->len; index++)
+    g_string_append_printf (ids, "%s%llu",
+                            index ? ", " : "",
+                            g_array_index (reports, report_t, index));
+
+  tasks = sql_string ("SELECT string_agg (DISTINCT task::text, ', ')"
+                      " FROM reports WHERE id IN (%s);",
+                      ids->str);
+
+  uuids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  init_iterator (&rows, "SELECT uuid FROM reports WHERE id IN (%s);",
+                 ids->str);
+  while (next (&rows))
+    g_hash_table_add (uuids, g_strdup (iterator_string (&rows, 0)));
+  cleanup_iterator (&rows);
+
+  sql ("DELETE FROM report_host_details WHERE report_host IN"
+       " (SELECT id FROM report_hosts WHERE report IN (%s));",
+       ids->str);
+  sql ("DELETE FROM report_hosts WHERE report IN (%s);", ids->str);
+
+  sql ("DELETE FROM tag_resources"
+       " WHERE resource_type = 'result'"
+       "   AND resource IN"
+       "         (SELECT id FROM results WHERE report IN (%s));",
+       ids->str);
+  sql ("DELETE FROM tag_resources_trash"
+       " WHERE resource_type = 'result'"
+       "   AND resource IN"
+       "         (SELECT id FROM results WHERE report IN (%s));",
+       ids->str);
+  manage_drop_results_partitions (ids->str);
+  sql ("DELETE FROM results WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM results_trash WHERE report IN (%s);", ids->str);
+
+  sql ("DELETE FROM tag_resources"
+       " WHERE resource_type = 'report'"
+       "   AND resource IN (%s);",
+       ids->str);
+  sql ("DELETE FROM tag_resources_trash"
+       " WHERE resource_type = 'report'"
+       "   AND resource IN (%s);",
+       ids->str);
+  sql ("DELETE FROM report_counts WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM report_counts_rebuilds WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM result_severities WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM report_deletions WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM result_nvt_reports WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM live_report_progress WHERE report IN (%s);", ids->str);
+  sql ("DELETE FROM reports WHERE id IN (%s);", ids->str);
+
+  g_string_free (ids, TRUE);
+
+  report_cache_purge (uuids);
+  g_hash_table_destroy (uuids);
+
+  if (tasks)
+    {
+      gchar *where;
+
+      where = g_strdup_printf ("tasks.id IN (%s)", tasks);
+      task_summaries_update (where);
+      g_free (where);
+      g_free (tasks);
+    }
+
+  /* Adjust permissions. */
+
+  for (index = 0; index < reports->len; index++)
+    {
+      report_t report;
+
+      report = g_array_index (reports, report_t, index);
+      permissions_set_orphans ("report", report, LOCATION_TABLE);
+      tags_remove_resource ("report", report, LOCATION_TABLE);
+      tickets_remove_report (report);
+    }
+}
+
 /**
  * @brief Delete a report.
  *
  * It's up to the caller to provide the transaction.
  *
+ * A report is in use while its scan is requested, running or being deleted,
+ * and also while the scan is being stopped (Stop Requested, Stop Waiting or
+ * giving up on a stop).
+ *
+ * The data is removed by delete_reports_data, the same as for bulk
+ * deletions, and the task state is reset by task_reset_run_status.
+ *
  * @param[in]  report  Report.
  *
  * @return 0 success, 2 report is in use, -1 error.
@@ -24728,11 +28771,12 @@ int
 delete_report_internal (report_t report)
 {
   task_t task;
-  char *slave_task_uuid;
+  GArray *reports;
 
   if (sql_int ("SELECT count(*) FROM reports WHERE id = %llu"
                " AND (scan_run_status = %u OR scan_run_status = %u"
                " OR scan_run_status = %u OR scan_run_status = %u"
+               " OR scan_run_status = %u OR scan_run_status = %u"
                " OR scan_run_status = %u);",
                report,
                TASK_STATUS_RUNNING,
@@ -24753,111 +28797,199 @@ delete_report_internal (report_t report)
 
   /* Remove any associated slave task. */
 
-  slave_task_uuid = report_slave_task_uuid (report);
-  g_debug ("%s: slave_task_uuid: %s", __func__, slave_task_uuid);
-  if (slave_task_uuid)
-    {
-      scanner_t slave;
+  delete_report_slave_task (report, task);
 
-      /* A stopped report leaves the task on the slave.  Try delete the task. */
+  /* Remove the report data. */
 
-      slave = task_scanner (task);
-      if (slave)
-        {
-          char *username, *password;
+  reports = g_array_new (FALSE, FALSE, sizeof (report_t));
+  g_array_append_val (reports, report);
+  delete_reports_data (reports);
+  g_array_free (reports, TRUE);
 
-          username = scanner_login (slave);
-          password = scanner_password (slave);
-          if (username && password)
-            {
-              char *host;
-              int port;
+  /* Update the task state. */
 
-              /* Try with values stored on report. */
-              host = report_slave_host (report);
-              port = report_slave_port_int (report);
-              if (host)
-                delete_slave_task (host, port, username, password,
-                                   slave_task_uuid);
-              g_free (host);
+  return task_reset_run_status (task);
+}
 
-              /* TODO If that fails, try with the current values from the
-               *      slave/scanner stored on the report.  And if that fails,
-               *      try with the values from the current slave of the task. */
-            }
-          free (username);
-          free (password);
-        }
-    }
+/**
+ * @brief Delete one chunk of the reports that match a condition.
+ *
+ * The chunk runs in its own transaction, so that the row locks are
+ * released between chunks.  Reports that are in use are skipped.
+ *
+ * @param[in]  where  SQL condition on reports selecting the reports.
+ * @param[in]  wait   Whether to wait for the rows that other processes have
+ *                    locked.  Otherwise skip them.
+ *
+ * @return Number of reports deleted, -1 error.
+ */
+static int
+delete_reports_chunk (const gchar *where, int wait)
+{
+  iterator_t rows;
+  GArray *reports, *tasks;
+  guint index;
+  int ret;
 
-  /* Remove the report data. */
+  sql_begin_immediate ();
 
-  sql ("DELETE FROM report_host_details WHERE report_host IN"
-       " (SELECT id FROM report_hosts WHERE report = %llu);",
-       report);
-  sql ("DELETE FROM report_hosts WHERE report = %llu;", report);
+  /* As in delete_report, this prevents other processes from getting the
+   * report ID.  The rows of the tasks are locked before the rows of the
+   * reports, like lock_task_and_reports does, so that the two cannot
+   * deadlock. */
+
+  reports = g_array_new (FALSE, FALSE, sizeof (report_t));
+  tasks = g_array_new (FALSE, FALSE, sizeof (task_t));
+
+  init_iterator (&rows,
+                 "SELECT id, task FROM reports"
+                 " WHERE (%s)"
+                 " AND task IN (SELECT id FROM tasks"
+                 "              WHERE id IN (SELECT task FROM reports"
+                 "                           WHERE (%s))"
+                 "              ORDER BY id FOR UPDATE%s)"
+                 " AND coalesce (scan_run_status, -1)"
+                 "     NOT IN (%u, %u, %u, %u, %u, %u, %u)"
+                 " ORDER BY id LIMIT %i FOR UPDATE%s;",
+                 where,
+                 where,
+                 wait ? "" : " SKIP LOCKED",
+                 TASK_STATUS_RUNNING,
+                 TASK_STATUS_REQUESTED,
+                 TASK_STATUS_DELETE_REQUESTED,
+                 TASK_STATUS_DELETE_ULTIMATE_REQUESTED,
+                 TASK_STATUS_STOP_REQUESTED,
+                 TASK_STATUS_STOP_REQUESTED_GIVEUP,
+                 TASK_STATUS_STOP_WAITING,
+                 REPORT_DELETE_CHUNK_SIZE,
+                 wait ? "" : " SKIP LOCKED");
+  while (next (&rows))
+    {
+      report_t report;
+      task_t task;
 
-  sql ("DELETE FROM tag_resources"
-       " WHERE resource_type = 'result'"
-       "   AND resource IN"
-       "         (SELECT id FROM results WHERE report = %llu);",
-       report);
-  sql ("DELETE FROM tag_resources_trash"
-       " WHERE resource_type = 'result'"
-       "   AND resource IN"
-       "         (SELECT id FROM results WHERE report = %llu);",
-       report);
-  sql ("DELETE FROM results WHERE report = %llu;", report);
-  sql ("DELETE FROM results_trash WHERE report = %llu;", report);
+      report = iterator_int64 (&rows, 0);
+      task = iterator_int64 (&rows, 1);
+      g_array_append_val (reports, report);
+      delete_report_slave_task (report, task);
+      for (index = 0; index < tasks->len; index++)
+        if (g_array_index (tasks, task_t, index) == task)
+          break;
+      if (index == tasks->len)
+        g_array_append_val (tasks, task);
+    }
+  cleanup_iterator (&rows);
 
-  sql ("DELETE FROM tag_resources"
-       " WHERE resource_type = 'report'"
-       "   AND resource = %llu;",
-       report);
-  sql ("DELETE FROM tag_resources_trash"
-       " WHERE resource_type = 'report'"
-       "   AND resource = %llu;",
-       report);
-  sql ("DELETE FROM report_counts WHERE report = %llu;", report);
-  sql ("DELETE FROM result_nvt_reports WHERE report = %llu;", report);
-  sql ("DELETE FROM reports WHERE id = %llu;", report);
+  delete_reports_data (reports);
 
-  /* Adjust permissions. */
+  for (index = 0; index < tasks->len; index++)
+    if (task_reset_run_status (g_array_index (tasks, task_t, index)))
+      {
+        g_array_free (reports, TRUE);
+        g_array_free (tasks, TRUE);
+        sql_rollback ();
+        return -1;
+      }
 
-  permissions_set_orphans ("report", report, LOCATION_TABLE);
-  tags_remove_resource ("report", report, LOCATION_TABLE);
-  tickets_remove_report (report);
+  ret = reports->len;
+  g_array_free (reports, TRUE);
+  g_array_free (tasks, TRUE);
+  sql_commit ();
+  return ret;
+}
 
-  /* Update the task state. */
+/**
+ * @brief Delete the reports queued for deletion, chunk by chunk.
+ */
+static void
+delete_queued_reports ()
+{
+  int deleted, total, ret;
 
-  switch (sql_int64 (&report,
-                     "SELECT max (id) FROM reports WHERE task = %llu",
-                     task))
+  /* Drop entries for reports that are gone or in use.  Auto delete queues
+   * the reports that are in use again on a later round. */
+  sql ("DELETE FROM report_deletions"
+       " WHERE report NOT IN (SELECT id FROM reports)"
+       " OR report IN (SELECT id FROM reports"
+       "               WHERE scan_run_status IN (%u, %u, %u, %u, %u, %u, %u));",
+       TASK_STATUS_RUNNING,
+       TASK_STATUS_REQUESTED,
+       TASK_STATUS_DELETE_REQUESTED,
+       TASK_STATUS_DELETE_ULTIMATE_REQUESTED,
+       TASK_STATUS_STOP_REQUESTED,
+       TASK_STATUS_STOP_REQUESTED_GIVEUP,
+       TASK_STATUS_STOP_WAITING);
+
+  total = manage_report_deletion_queue_depth ();
+  deleted = 0;
+  while ((ret = delete_reports_chunk
+                 ("id IN (SELECT report FROM report_deletions)", 0))
+         > 0)
     {
-      case 0:
-        if (report)
-          {
-            task_status_t status;
-            if (report_scan_run_status (report, &status))
-              return -1;
-            sql ("UPDATE tasks SET run_status = %u WHERE id = %llu;",
-                 status,
-                 task);
-          }
-        else
-          sql ("UPDATE tasks SET run_status = %u WHERE id = %llu;",
-               TASK_STATUS_NEW,
-               task);
-        break;
-      case 1:        /* Too few rows in result of query. */
-        break;
-      default:       /* Programming error. */
-        assert (0);
-      case -1:
-        return -1;
-        break;
+      deleted += ret;
+      g_debug ("%s: deleted %i of %i queued reports",
+               __func__, deleted, total);
     }
 
+  if (ret == -1)
+    g_warning ("%s: failed to delete a chunk of reports", __func__);
+
+  g_info ("%s: Deleted %i of %i queued reports", __func__, deleted, total);
+}
+
+/**
+ * @brief Get the number of reports waiting for deletion.
+ *
+ * @return Number of queued report deletions.
+ */
+int
+manage_report_deletion_queue_depth ()
+{
+  return sql_int ("SELECT count (*) FROM report_deletions;");
+}
+
+/**
+ * @brief Start the report deletion worker if there is work.
+ *
+ * The worker is a child process that deletes the queued reports in chunks,
+ * committing after each chunk, so that scan ingestion is not blocked for
+ * the whole deletion.  At most one worker runs at a time.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ */
+void
+manage_delete_queued_reports (sigset_t *sigmask_current)
+{
+  if (sql_int ("SELECT EXISTS (SELECT * FROM report_deletions);") == 0)
+    return;
+
+  fork_locked_worker (sigmask_current,
+                      "gvm-delete-reports",
+                      "gvmd: Deleting reports",
+                      "report_deletion",
+                      delete_queued_reports);
+}
+
+/**
+ * @brief Lock the row of a task and the rows of its reports.
+ *
+ * This holds up only the processes that use this task, instead of every
+ * process that touches the reports table.  Must be called in a transaction.
+ *
+ * The task is locked before the reports, in the same order as any other
+ * process that locks both.
+ *
+ * @param[in]  task  Task.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+lock_task_and_reports (task_t task)
+{
+  if (sql_error ("SELECT id FROM tasks WHERE id = %llu FOR UPDATE;", task)
+      || sql_error ("SELECT id FROM reports WHERE task = %llu FOR UPDATE;",
+                    task))
+    return -1;
   return 0;
 }
 
@@ -24877,14 +29009,6 @@ delete_report (const char *report_id, int dummy)
 
   sql_begin_immediate ();
 
-  /* This prevents other processes (in particular a RESUME_TASK) from getting
-   * a reference to the report ID, and then using that reference to try access
-   * the deleted report.
-   *
-   * If the report is running already then delete_report_internal will
-   * ROLLBACK. */
-  sql ("LOCK table reports IN ACCESS EXCLUSIVE MODE;");
-
   if (acl_user_may ("delete_report") == 0)
     {
       sql_rollback ();
@@ -24912,6 +29036,21 @@ delete_report (const char *report_id, int dummy)
         }
     }
 
+  /* This prevents other processes (in particular a RESUME_TASK) from getting
+   * a reference to the report ID, and then using that reference to try access
+   * the deleted report.  Resuming locks the row of the task, so locking the
+   * rows of the task of the report is enough.
+   *
+   * If the report is running already then delete_report_internal will
+   * ROLLBACK. */
+  if (lock_task_and_reports (sql_int64_0 ("SELECT task FROM reports"
+                                          " WHERE id = %llu;",
+                                          report)))
+    {
+      sql_rollback ();
+      return -1;
+    }
+
   ret = delete_report_internal (report);
   if (ret)
     {
@@ -24927,20 +29066,31 @@ delete_report (const char *report_id, int dummy)
 /**
  * @brief Return the slave progress of a report.
  *
+ * This is the progress that an OSP or GMP scanner last reported, from the
+ * live progress while the scan runs.
+ *
  * @param[in]  report  Report.
  *
- * @return Number of reports.
+ * @return Progress, 0 if none.
  */
 static int
 report_slave_progress (report_t report)
 {
-  return sql_int ("SELECT slave_progress FROM reports WHERE id = %llu;",
+  return sql_int ("SELECT coalesce ((SELECT progress"
+                  "                  FROM live_report_progress"
+                  "                  WHERE report = %llu),"
+                  "                 (SELECT slave_progress FROM reports"
+                  "                  WHERE id = %llu));",
+                  report,
                   report);
 }
 
 /**
  * @brief Set slave progress of a report.
  *
+ * The scanner handlers call this on every poll, so the progress goes to the
+ * small live progress table instead of to the report.
+ *
  * @param[in]  report    The report.
  * @param[in]  progress  The new progress value.
  *
@@ -24949,12 +29099,314 @@ report_slave_progress (report_t report)
 int
 set_report_slave_progress (report_t report, int progress)
 {
-  sql ("UPDATE reports SET slave_progress = %i WHERE id = %llu;",
-       progress,
-       report);
+  sql ("INSERT INTO live_report_progress (report, progress, modification_time)"
+       " VALUES (%llu, %i, m_now ())"
+       " ON CONFLICT (report)"
+       " DO UPDATE SET progress = EXCLUDED.progress,"
+       "               modification_time = EXCLUDED.modification_time;",
+       report,
+       progress);
   return 0;
 }
 
+/**
+ * @brief Seconds without a heartbeat after which a cluster node is dead.
+ */
+#define CLUSTER_NODE_TIMEOUT 60
+
+/**
+ * @brief SQL selecting the names of the live cluster nodes.
+ */
+#define CLUSTER_LIVE_NODES                                      \
+  "SELECT name FROM cluster_nodes"                              \
+  " WHERE heartbeat >= m_now () - " G_STRINGIFY (CLUSTER_NODE_TIMEOUT)
+
+/**
+ * @brief Advisory lock key that serialises schedule handling in a cluster.
+ */
+#define CLUSTER_SCHEDULE_LOCK 1
+
+/**
+ * @brief First advisory lock key of the feed updates in a cluster.
+ *
+ * Each feed locks its own key from here on, so that the updates of
+ * different feeds can run at the same time.
+ */
+#define CLUSTER_FEED_LOCK 16
+
+/**
+ * @brief SQL quoted name of this node in the cluster, or NULL if alone.
+ */
+static gchar *cluster_node = NULL;
+
+/**
+ * @brief Set the name of this node in the cluster.
+ *
+ * @param[in]  name  Node name, or NULL to run without a cluster.
+ */
+void
+set_cluster_node (const gchar *name)
+{
+  g_free (cluster_node);
+  cluster_node = (name && strlen (name)) ? sql_quote (name) : NULL;
+}
+
+/**
+ * @brief Record that this cluster node is alive.
+ */
+void
+cluster_heartbeat ()
+{
+  if (cluster_node == NULL)
+    return;
+
+  sql ("INSERT INTO cluster_nodes (name, heartbeat)"
+       " VALUES ('%s', m_now ())"
+       " ON CONFLICT (name) DO UPDATE SET heartbeat = EXCLUDED.heartbeat;",
+       cluster_node);
+}
+
+/**
+ * @brief Get a condition that selects the tasks that this node may stop.
+ *
+ * This leaves the tasks of the other live nodes, and the OSP scans of dead
+ * nodes, which the scan supervisor takes over.  Everything else stopped
+ * with its process, including the tasks of dead nodes that have no scan
+ * to take over.
+ *
+ * @param[in]  column  Column that holds the task.
+ *
+ * @return Freshly allocated SQL condition.
+ */
+static gchar *
+cluster_own_tasks (const char *column)
+{
+  if (cluster_node == NULL)
+    return g_strdup ("true");
+
+  return g_strdup_printf ("%s NOT IN (SELECT task FROM cluster_tasks"
+                          "            WHERE node != '%s'"
+                          "            AND (node IN (" CLUSTER_LIVE_NODES ")"
+                          "                 OR task IN (SELECT task"
+                          "                             FROM osp_scans)))",
+                          column,
+                          cluster_node);
+}
+
+/**
+ * @brief Record the node of a task when its run status changes.
+ *
+ * @param[in]  task    Task.
+ * @param[in]  status  New run status.
+ */
+static void
+cluster_task_status (task_t task, task_status_t status)
+{
+  if (cluster_node == NULL)
+    return;
+
+  if (status == TASK_STATUS_REQUESTED)
+    sql ("INSERT INTO cluster_tasks (task, node) VALUES (%llu, '%s')"
+         " ON CONFLICT (task) DO UPDATE SET node = EXCLUDED.node;",
+         task,
+         cluster_node);
+  else if (status == TASK_STATUS_NEW
+           || status == TASK_STATUS_DONE
+           || status == TASK_STATUS_STOPPED
+           || status == TASK_STATUS_INTERRUPTED)
+    sql ("DELETE FROM cluster_tasks WHERE task = %llu;", task);
+}
+
+/**
+ * @brief Take the cluster wide lock on the updates of a feed.
+ *
+ * SCAP, CERT and NVT updates drop and rebuild data that all nodes share, so
+ * only one node may update a feed at a time.  The lock belongs to the
+ * session, so it is held across the transactions of the update until the
+ * process exits.
+ *
+ * @param[in]  feed  Feed to update.
+ *
+ * @return 0 got the lock or not in a cluster, 1 another node has it.
+ */
+int
+cluster_feed_lock (cluster_feed_t feed)
+{
+  if (cluster_node == NULL)
+    return 0;
+
+  return sql_int ("SELECT pg_try_advisory_lock (%i, %i);",
+                  ADVISORY_LOCK_SPACE,
+                  CLUSTER_FEED_LOCK + feed)
+         ? 0 : 1;
+}
+
+/**
+ * @brief Queue a running OSP scan for the scan supervisor.
+ *
+ * In a cluster the scan belongs to this node until the node dies.
+ *
+ * @param[in]  task    The task.
+ * @param[in]  report  The report of the scan.
+ */
+void
+osp_scan_queue_add (task_t task, report_t report)
+{
+  sql ("INSERT INTO osp_scans (task, report, owner, started, node)"
+       " VALUES (%llu, %llu,"
+       "         (SELECT id FROM users WHERE uuid = '%s'), 0, %s%s%s)"
+       " ON CONFLICT (task)"
+       " DO UPDATE SET report = EXCLUDED.report,"
+       "               owner = EXCLUDED.owner,"
+       "               started = 0,"
+       "               node = EXCLUDED.node;",
+       task, report, current_credentials.uuid,
+       cluster_node ? "'" : "",
+       cluster_node ? cluster_node : "NULL",
+       cluster_node ? "'" : "");
+}
+
+/**
+ * @brief Remove an OSP scan from the scan supervisor queue.
+ *
+ * @param[in]  task  The task.
+ */
+void
+osp_scan_queue_remove (task_t task)
+{
+  sql ("DELETE FROM osp_scans WHERE task = %llu;", task);
+}
+
+/**
+ * @brief Record that the task of a supervised OSP scan is running.
+ *
+ * @param[in]  task  The task.
+ */
+void
+osp_scan_queue_set_started (task_t task)
+{
+  sql ("UPDATE osp_scans SET started = 1 WHERE task = %llu;", task);
+}
+
+/**
+ * @brief Get the number of OSP scans queued for the scan supervisor.
+ *
+ * @return Number of supervised scans.
+ */
+int
+osp_scan_queue_depth ()
+{
+  if (cluster_node)
+    return sql_int ("SELECT count (*) FROM osp_scans"
+                    " WHERE node IS NULL"
+                    " OR node = '%s'"
+                    " OR node NOT IN (" CLUSTER_LIVE_NODES ");",
+                    cluster_node);
+
+  return sql_int ("SELECT count (*) FROM osp_scans;");
+}
+
+/**
+ * @brief Initialise an iterator over the OSP scans of the scan supervisor.
+ *
+ * Scans of tasks that have gone, or that are no longer active, for example
+ * because they were interrupted by a restart, are dropped first.
+ *
+ * In a cluster this node first takes over the scans of dead nodes, and
+ * then iterates only over its own scans.  The OSP scanner keeps running a
+ * scan when its node dies, so the new node simply carries on polling.
+ *
+ * @param[in]  iterator  Iterator.
+ */
+void
+init_osp_scan_queue_iterator (iterator_t *iterator)
+{
+  sql ("DELETE FROM osp_scans"
+       " WHERE task NOT IN (SELECT id FROM tasks"
+       "                    WHERE run_status IN (%u, %u, %u, %u));",
+       TASK_STATUS_REQUESTED,
+       TASK_STATUS_RUNNING,
+       TASK_STATUS_STOP_REQUESTED,
+       TASK_STATUS_STOPPED);
+
+  if (cluster_node)
+    {
+      sql ("UPDATE osp_scans SET node = '%s'"
+           " WHERE node IS NULL"
+           " OR node NOT IN (" CLUSTER_LIVE_NODES ");",
+           cluster_node);
+      sql ("UPDATE cluster_tasks SET node = '%s'"
+           " WHERE task IN (SELECT task FROM osp_scans WHERE node = '%s');",
+           cluster_node,
+           cluster_node);
+
+      init_iterator (iterator,
+                     "SELECT task, report,"
+                     "       (SELECT uuid FROM users WHERE id = owner),"
+                     "       started"
+                     " FROM osp_scans"
+                     " WHERE node = '%s'"
+                     " ORDER BY id;",
+                     cluster_node);
+      return;
+    }
+
+  init_iterator (iterator,
+                 "SELECT task, report,"
+                 "       (SELECT uuid FROM users WHERE id = owner),"
+                 "       started"
+                 " FROM osp_scans"
+                 " ORDER BY id;");
+}
+
+/**
+ * @brief Get the task from an OSP scan queue iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Task.
+ */
+task_t
+osp_scan_queue_iterator_task (iterator_t *iterator)
+{
+  return iterator_int64 (iterator, 0);
+}
+
+/**
+ * @brief Get the report from an OSP scan queue iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Report.
+ */
+report_t
+osp_scan_queue_iterator_report (iterator_t *iterator)
+{
+  return iterator_int64 (iterator, 1);
+}
+
+/**
+ * @brief Get the owner UUID from an OSP scan queue iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return UUID of the user who started the scan.
+ */
+DEF_ACCESS (osp_scan_queue_iterator_owner_uuid, 2);
+
+/**
+ * @brief Get whether the task is running from an OSP scan queue iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return 1 if the task has been set to running, else 0.
+ */
+int
+osp_scan_queue_iterator_started (iterator_t *iterator)
+{
+  return iterator_int (iterator, 3);
+}
+
 /**
  * @brief Return the UUID of the task on the slave.
  *
@@ -25477,7 +29929,7 @@ compare_results (iterator_t *results, iterator_t *delta_results, int sort_order,
                  const char* sort_field)
 {
   int ret;
-  const char *descr, *delta_descr;
+  const char *descr, *delta_descr, *fingerprint, *delta_fingerprint;
 
   g_debug ("   delta: %s", __func__);
 
@@ -25489,6 +29941,22 @@ compare_results (iterator_t *results, iterator_t *delta_results, int sort_order,
     /* The 'results' result sorts first, so it has gone. */
     return COMPARE_RESULTS_GONE;
 
+  /* Compare the fingerprints if both results have one, to avoid comparing
+   * long descriptions. */
+
+  fingerprint = result_iterator_fingerprint (results);
+  delta_fingerprint = result_iterator_fingerprint (delta_results);
+
+  if (fingerprint && delta_fingerprint)
+    {
+      g_debug ("   delta: %s: fingerprint: %s VS %s",
+               __func__, fingerprint, delta_fingerprint);
+
+      if (strcmp (fingerprint, delta_fingerprint))
+        return COMPARE_RESULTS_CHANGED;
+      return COMPARE_RESULTS_SAME;
+    }
+
   descr = result_iterator_descr (results);
   delta_descr = result_iterator_descr (delta_results);
 
@@ -26368,6 +30836,253 @@ print_report_host_details_xml (report_host_t report_host, FILE *stream,
   return 0;
 }
 
+/**
+ * @brief Number of report hosts whose details are fetched in one query.
+ */
+#define REPORT_HOST_CHUNK_SIZE 500
+
+/**
+ * @brief A report host, buffered for printing.
+ */
+typedef struct
+{
+  report_host_t report_host;   ///< Report host.
+  gchar *host;                 ///< Host.
+  gchar *start_time;           ///< Start time, in ISO format.
+  gchar *end_time;             ///< End time, in ISO format.  NULL if running.
+  gchar *asset_id;             ///< UUID of asset.
+  int ports_count;             ///< Number of ports on the page.
+  int holes_count;             ///< Number of high results on the page.
+  int warnings_count;          ///< Number of medium results on the page.
+  int infos_count;             ///< Number of low results on the page.
+  int logs_count;              ///< Number of log results on the page.
+  int false_positives_count;   ///< Number of false positives on the page.
+  long details_start;          ///< Offset of details XML in chunk buffer.
+  long details_length;         ///< Length of details XML in chunk buffer.
+} report_host_buffer_t;
+
+/**
+ * @brief Create a buffered report host from a host iterator.
+ *
+ * @param[in]  hosts  Host iterator.
+ *
+ * @return Buffered report host.  Free with report_host_buffer_free.
+ */
+static report_host_buffer_t *
+report_host_buffer_new (iterator_t *hosts)
+{
+  report_host_buffer_t *buffer;
+
+  buffer = g_malloc0 (sizeof (report_host_buffer_t));
+  buffer->report_host = host_iterator_report_host (hosts);
+  buffer->host = g_strdup (host_iterator_host (hosts));
+  buffer->start_time = g_strdup (host_iterator_start_time (hosts));
+  buffer->end_time = g_strdup (host_iterator_end_time (hosts));
+  buffer->asset_id = g_strdup (host_iterator_asset_uuid (hosts));
+  return buffer;
+}
+
+/**
+ * @brief Copy a buffered report host.
+ *
+ * @param[in]  buffer  Buffered report host.
+ *
+ * @return Copy of buffered report host.  Free with report_host_buffer_free.
+ */
+static report_host_buffer_t *
+report_host_buffer_copy (const report_host_buffer_t *buffer)
+{
+  report_host_buffer_t *copy;
+
+  copy = g_memdup (buffer, sizeof (report_host_buffer_t));
+  copy->host = g_strdup (buffer->host);
+  copy->start_time = g_strdup (buffer->start_time);
+  copy->end_time = g_strdup (buffer->end_time);
+  copy->asset_id = g_strdup (buffer->asset_id);
+  return copy;
+}
+
+/**
+ * @brief Free a buffered report host.
+ *
+ * @param[in]  buffer  Buffered report host.
+ */
+static void
+report_host_buffer_free (gpointer buffer)
+{
+  report_host_buffer_t *report_host;
+
+  report_host = (report_host_buffer_t *) buffer;
+  g_free (report_host->host);
+  g_free (report_host->start_time);
+  g_free (report_host->end_time);
+  g_free (report_host->asset_id);
+  g_free (report_host);
+}
+
+/**
+ * @brief Print the XML for a chunk of report hosts to a file stream.
+ *
+ * Gets the details of all hosts in the chunk with one query, instead of
+ * one query per host, then prints the hosts in the order of the chunk.
+ * Empties the chunk.
+ *
+ * @param[in]  out                  File stream to write to.
+ * @param[in]  chunk                Array of report_host_buffer_t.
+ * @param[in]  host_summary_buffer  Host summary, or NULL.
+ * @param[in]  lean                 Whether to return reduced info.
+ *
+ * @return 0 on success, -1 error.
+ */
+static int
+print_report_host_chunk_xml (FILE *out, GPtrArray *chunk,
+                             GString *host_summary_buffer, int lean)
+{
+  GString *report_hosts;
+  GHashTable *buffers;
+  iterator_t details;
+  report_host_buffer_t *current;
+  char *details_xml;
+  size_t details_size;
+  FILE *stream;
+  guint index;
+
+  if (chunk->len == 0)
+    return 0;
+
+  report_hosts = g_string_new ("");
+  buffers = g_hash_table_new (g_int64_hash, g_int64_equal);
+  for (index = 0; index < chunk->len; index++)
+    {
+      report_host_buffer_t *buffer;
+
+      buffer = g_ptr_array_index (chunk, index);
+      g_string_append_printf (report_hosts, "%s%llu",
+                              index ? ", " : "",
+                              buffer->report_host);
+      g_hash_table_insert (buffers, &buffer->report_host, buffer);
+    }
+
+  /* Print the details of every host in the chunk into a single buffer,
+   * remembering where each host starts. */
+
+  details_xml = NULL;
+  details_size = 0;
+  stream = open_memstream (&details_xml, &details_size);
+  if (stream == NULL)
+    {
+      g_warning ("%s: open_memstream failed: %s", __func__, strerror (errno));
+      g_hash_table_destroy (buffers);
+      g_string_free (report_hosts, TRUE);
+      return -1;
+    }
+
+  current = NULL;
+  init_report_host_details_hosts_iterator (&details, report_hosts->str);
+  while (next (&details))
+    {
+      report_host_t report_host;
+
+      report_host = report_host_details_iterator_report_host (&details);
+      if (current == NULL || current->report_host != report_host)
+        {
+          if (current)
+            current->details_length = ftell (stream) - current->details_start;
+          current = g_hash_table_lookup (buffers, &report_host);
+          if (current == NULL)
+            continue;
+          current->details_start = ftell (stream);
+        }
+      if (print_report_host_detail (stream, &details, lean))
+        {
+          cleanup_iterator (&details);
+          g_hash_table_destroy (buffers);
+          g_string_free (report_hosts, TRUE);
+          free (details_xml);
+          return -1;
+        }
+    }
+  if (current)
+    current->details_length = ftell (stream) - current->details_start;
+  cleanup_iterator (&details);
+  g_hash_table_destroy (buffers);
+  g_string_free (report_hosts, TRUE);
+
+  if (fclose (stream))
+    {
+      g_warning ("%s: fclose failed: %s", __func__, strerror (errno));
+      free (details_xml);
+      return -1;
+    }
+
+  /* Print the hosts. */
+
+  for (index = 0; index < chunk->len; index++)
+    {
+      report_host_buffer_t *buffer;
+
+      buffer = g_ptr_array_index (chunk, index);
+
+      host_summary_append (host_summary_buffer,
+                           buffer->host,
+                           buffer->start_time,
+                           buffer->end_time);
+      PRINT (out,
+             "<host>"
+             "<ip>%s</ip>",
+             buffer->host);
+
+      if (buffer->asset_id && strlen (buffer->asset_id))
+        PRINT (out,
+               "<asset asset_id=\"%s\"/>",
+               buffer->asset_id);
+      else if (lean == 0)
+        PRINT (out,
+               "<asset asset_id=\"\"/>");
+
+      PRINT (out,
+             "<start>%s</start>"
+             "<end>%s</end>"
+             "<port_count><page>%d</page></port_count>"
+             "<result_count>"
+             "<page>%d</page>"
+             "<hole><page>%d</page></hole>"
+             "<warning><page>%d</page></warning>"
+             "<info><page>%d</page></info>"
+             "<log><page>%d</page></log>"
+             "<false_positive><page>%d</page></false_positive>"
+             "</result_count>",
+             buffer->start_time,
+             buffer->end_time ? buffer->end_time : "",
+             buffer->ports_count,
+             (buffer->holes_count + buffer->warnings_count
+              + buffer->infos_count + buffer->logs_count
+              + buffer->false_positives_count),
+             buffer->holes_count,
+             buffer->warnings_count,
+             buffer->infos_count,
+             buffer->logs_count,
+             buffer->false_positives_count);
+
+      if (buffer->details_length
+          && fwrite (details_xml + buffer->details_start, 1,
+                     buffer->details_length, out)
+             < (size_t) buffer->details_length)
+        {
+          free (details_xml);
+          fclose (out);
+          return -1;
+        }
+
+      PRINT (out,
+             "</host>");
+    }
+
+  free (details_xml);
+  g_ptr_array_set_size (chunk, 0);
+  return 0;
+}
+
 /**
  * @brief Write report error message to file stream.
  *
@@ -26424,12 +31139,10 @@ print_report_errors_xml (report_t report, FILE *stream)
   PRINT (stream, "<errors><count>%i</count>", report_error_count (report));
   while (next (&errors))
     {
-      char *asset_id;
+      const char *asset_id;
 
-      asset_id = result_host_asset_id (report_errors_iterator_host (&errors),
-                                       report_errors_iterator_result (&errors));
+      asset_id = report_errors_iterator_asset_id (&errors);
       PRINT_REPORT_ERROR (stream, &errors, asset_id);
-      free (asset_id);
     }
   cleanup_iterator (&errors);
   PRINT (stream, "</errors>");
@@ -26732,15 +31445,14 @@ report_progress (report_t report, task_t task, gchar **hosts_xml)
       hosts = target ? trash_target_hosts (target) : NULL;
       exclude_hosts = target ? trash_target_exclude_hosts
                                 (target) : NULL;
+      maximum_hosts = hosts
+                       ? manage_count_hosts_max (hosts, exclude_hosts, 0)
+                       : 0;
+      g_free (hosts);
+      g_free (exclude_hosts);
     }
   else
-    {
-      hosts = target ? target_hosts (target) : NULL;
-      exclude_hosts = target ? target_exclude_hosts (target) : NULL;
-    }
-  maximum_hosts = hosts ? manage_count_hosts_max (hosts, exclude_hosts, 0) : 0;
-  g_free (hosts);
-  g_free (exclude_hosts);
+    maximum_hosts = target ? target_max_hosts (target) : 0;
 
   if (report_active (report))
     return report_progress_active (report, maximum_hosts, hosts_xml);
@@ -26814,35 +31526,18 @@ severity_class_xml (const gchar *severity)
 }
 
 /**
- * @brief Restore original TZ.
+ * @brief Restore original tz_override.
  *
  * @param[in]  zone             Only revert if this is at least one character.
  *                               Freed here always.
- * @param[in]  tz               Original TZ.  Freed here if revert occurs.
  * @param[in]  old_tz_override  Original tz_override.  Freed here on revert.
- *
- * @return 0 success, -1 error.
  */
-static int
-tz_revert (gchar *zone, char *tz, char *old_tz_override)
+static void
+tz_revert (gchar *zone, char *old_tz_override)
 {
   if (zone && strlen (zone))
     {
       gchar *quoted_old_tz_override;
-      /* Revert to stored TZ. */
-      if (tz)
-        {
-          if (setenv ("TZ", tz, 1) == -1)
-            {
-              g_warning ("%s: Failed to switch to original TZ", __func__);
-              g_free (tz);
-              g_free (zone);
-              free (old_tz_override);
-              return -1;
-            }
-        }
-      else
-        unsetenv ("TZ");
 
       quoted_old_tz_override = sql_insert (old_tz_override);
       sql ("SET SESSION \"gvmd.tz_override\" = %s;",
@@ -26850,10 +31545,8 @@ tz_revert (gchar *zone, char *tz, char *old_tz_override)
       g_free (quoted_old_tz_override);
 
       free (old_tz_override);
-      g_free (tz);
     }
   g_free (zone);
-  return 0;
 }
 
 /**
@@ -26943,23 +31636,24 @@ init_delta_iterators (report_t report, iterator_t *results, report_t delta,
   get_data_t delta_get;
 
   /*
-   * Order must be the same as in result_cmp, except for description
-   *  which isn't checked there.
+   * Order must be the same as in result_cmp, except for the fingerprint
+   *  which isn't checked there.  The fingerprint is last so that results
+   *  with the same description line up in both reports.
    */
   if ((strcmp (sort_field, "name") == 0)
       || (strcmp (sort_field, "vulnerability") == 0))
-    order = g_strdup (", host, port, severity, nvt, description");
+    order = g_strdup (", host, port, severity, nvt, fingerprint");
   else if (strcmp (sort_field, "host") == 0)
-    order = g_strdup (", port, severity, nvt, description");
+    order = g_strdup (", port, severity, nvt, fingerprint");
   else if ((strcmp (sort_field, "port") == 0)
            || (strcmp (sort_field, "location") == 0))
-    order = g_strdup (", host, severity, nvt, description");
+    order = g_strdup (", host, severity, nvt, fingerprint");
   else if (strcmp (sort_field, "severity") == 0)
-    order = g_strdup (", host, port, nvt, description");
+    order = g_strdup (", host, port, nvt, fingerprint");
   else if (strcmp (sort_field, "nvt") == 0)
-    order = g_strdup (", host, port, severity, description");
+    order = g_strdup (", host, port, severity, fingerprint");
   else
-    order = g_strdup (", host, port, severity, nvt, description");
+    order = g_strdup (", host, port, severity, nvt, fingerprint");
 
   delta_get = *get;
   delta_get.filt_id = NULL;
@@ -27116,6 +31810,8 @@ print_report_delta_xml (FILE *out, iterator_t *results,
       compare_results_t state;
       int used, would_use;
 
+      manage_process_tick ();
+
       if (max_results == 0)
         break;
 
@@ -27747,6 +32443,44 @@ print_report_delta_xml (FILE *out, iterator_t *results,
   return 0;
 }
 
+/**
+ * @brief Get the sort field to use for a delta report.
+ *
+ * @param[in]  sort_field  Sort field from the filter.  Freed if replaced.
+ *
+ * @return Sort field that result_cmp supports.
+ */
+static gchar *
+delta_sort_field (gchar *sort_field)
+{
+  if (sort_field
+      && strcmp (sort_field, "name")
+      && strcmp (sort_field, "vulnerability")
+      && strcmp (sort_field, "host")
+      && strcmp (sort_field, "port")
+      && strcmp (sort_field, "location")
+      && strcmp (sort_field, "severity")
+      && strcmp (sort_field, "type")
+      && strcmp (sort_field, "original_type"))
+    {
+      /* The task fields don't affect a delta report.  The remaining
+       * filterable fields for the result iterator could be added to
+       * result_cmp.  For now sort all of these by vulnerability. */
+#if 0
+      "task", "task_id", "report_id",
+      "uuid", "comment", "created", "modified", "_owner"
+      "nvt",
+      "auto_type",
+      "report", "cvss_base", "nvt_version",
+      "original_severity", "date",
+      "solution_type", "qod", "qod_type", "cve", "hostname"
+#endif
+      g_free (sort_field);
+      return g_strdup ("vulnerability");
+    }
+  return sort_field;
+}
+
 /**
  * @brief Print the main XML content for a report to a file.
  *
@@ -27795,7 +32529,7 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
   int orig_f_warnings, orig_f_false_positives, orig_filtered_result_count;
   int search_phrase_exact, apply_overrides, count_filtered;
   double severity, f_severity;
-  gchar *tz, *zone;
+  gchar *zone;
   char *old_tz_override;
   GString *filters_buffer, *filters_extra_buffer, *host_summary_buffer;
   gchar *term_value;
@@ -27885,42 +32619,8 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
 
   max_results = manage_max_rows (max_results);
 
-  if (delta
-      && sort_field
-      && strcmp (sort_field, "name")
-      && strcmp (sort_field, "vulnerability")
-      && strcmp (sort_field, "host")
-      && strcmp (sort_field, "port")
-      && strcmp (sort_field, "location")
-      && strcmp (sort_field, "severity")
-      && strcmp (sort_field, "type")
-      && strcmp (sort_field, "original_type"))
-    {
-      if ((strcmp (sort_field, "task") == 0)
-          || (strcmp (sort_field, "task_id") == 0)
-          || (strcmp (sort_field, "report_id") == 0))
-        {
-          /* These don't affect delta report, so sort by vulnerability. */
-          g_free (sort_field);
-          sort_field = g_strdup ("vulnerability");
-        }
-      else
-        {
-          /* The remaining filterable fields for the result iterator, all of
-           * which may be used as a sort field.  These could be added to
-           * result_cmp.  For now sort by vulnerability. */
-#if 0
-          "uuid", "comment", "created", "modified", "_owner"
-          "nvt",
-          "auto_type",
-          "report", "cvss_base", "nvt_version",
-          "original_severity", "date",
-          "solution_type", "qod", "qod_type", "cve", "hostname"
-#endif
-          g_free (sort_field);
-          sort_field = g_strdup ("vulnerability");
-        }
-    }
+  if (delta)
+    sort_field = delta_sort_field (sort_field);
 
   levels = levels ? levels : g_strdup ("hmlgd");
 
@@ -27936,21 +32636,11 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
       return -1;
     }
 
+  /* The SQL side formats times in the zone via tz_override, and the C side
+   * via the zone context, so the TZ of the process stays as it is. */
   if (zone && strlen (zone))
     {
       gchar *quoted_zone;
-      /* Store current TZ. */
-      tz = getenv ("TZ") ? g_strdup (getenv ("TZ")) : NULL;
-
-      if (setenv ("TZ", zone, 1) == -1)
-        {
-          g_warning ("%s: Failed to switch to timezone", __func__);
-          if (tz != NULL)
-            setenv ("TZ", tz, 1);
-          g_free (tz);
-          g_free (zone);
-          return -1;
-        }
 
       old_tz_override = sql_string ("SELECT current_setting"
                                     "        ('gvmd.tz_override');");
@@ -27958,15 +32648,10 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
       quoted_zone = sql_insert (zone);
       sql ("SET SESSION \"gvmd.tz_override\" = %s;", quoted_zone);
       g_free (quoted_zone);
-
-      tzset ();
     }
   else
-    {
-      /* Keep compiler quiet. */
-      tz = NULL;
-      old_tz_override = NULL;
-    }
+    /* Keep compiler quiet. */
+    old_tz_override = NULL;
 
   if (delta && report)
     {
@@ -27998,7 +32683,9 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
                                ? run_status
                                : TASK_STATUS_INTERRUPTED));
 
-      if (report_timestamp (uuid, &timestamp))
+      if (report_timestamp_zone (uuid,
+                                 (zone && strlen (zone)) ? zone : NULL,
+                                 &timestamp))
         {
           free (uuid);
           g_free (sort_field);
@@ -28006,7 +32693,7 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
           g_free (search_phrase);
           g_free (min_qod);
           g_free (delta_states);
-          tz_revert (zone, tz, old_tz_override);
+          tz_revert (zone, old_tz_override);
           return -1;
         }
       PRINT (out,
@@ -28137,7 +32824,7 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
 
   if (delta)
     {
-      gchar *escaped_delta_states = g_markup_escape_text (delta_states, -1);
+      gchar *escaped_delta_states = xml_escape_text (delta_states, -1);
       g_string_append_printf (filters_extra_buffer,
                               "<delta>"
                               "%s"
@@ -28399,11 +33086,12 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
     }
 
   uuid = report_uuid (report);
-  if (report_timestamp (uuid, &timestamp))
+  if (report_timestamp_zone (uuid, (zone && strlen (zone)) ? zone : NULL,
+                             &timestamp))
     {
       free (uuid);
       g_free (term);
-      tz_revert (zone, tz, old_tz_override);
+      tz_revert (zone, old_tz_override);
       return -1;
     }
   free (uuid);
@@ -28457,7 +33145,7 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
                                  sort_order, sort_field, f_host_ports, &results))
         {
           g_free (term);
-          tz_revert (zone, tz, old_tz_override);
+          tz_revert (zone, old_tz_override);
           g_hash_table_destroy (f_host_ports);
           return -1;
         }
@@ -28571,7 +33259,7 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
           g_free (delta_states);
           cleanup_iterator (&results);
           cleanup_iterator (&delta_results);
-          tz_revert (zone, tz, old_tz_override);
+          tz_revert (zone, old_tz_override);
           g_hash_table_destroy (f_host_ports);
           g_hash_table_destroy (f_host_holes);
           g_hash_table_destroy (f_host_warnings);
@@ -28591,9 +33279,13 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
         {
           const char* level;
           GHashTable *f_host_result_counts;
-          GString *buffer = g_string_new ("");
+          GString *buffer;
           double result_severity;
 
+          manage_process_tick ();
+
+          buffer = g_string_new ("");
+
           buffer_results_xml (buffer,
                               &results,
                               task,
@@ -28752,210 +33444,130 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
   else
     host_summary_buffer = NULL;
 
-  if (get->details && result_hosts_only)
+  if (get->details)
     {
-      gchar *result_host;
-      int index = 0;
-      array_terminate (result_hosts);
-      while ((result_host = g_ptr_array_index (result_hosts, index++)))
-        {
-          gboolean present;
+      GPtrArray *chunk;
+
+      chunk = g_ptr_array_new_with_free_func (report_host_buffer_free);
+
+#define REPORT_HOST_BUFFER_COUNTS(buffer)                                     \
+      do                                                                      \
+        {                                                                     \
+          buffer->ports_count                                                 \
+            = GPOINTER_TO_INT                                                 \
+                (g_hash_table_lookup (f_host_ports, buffer->host));           \
+          buffer->holes_count                                                 \
+            = GPOINTER_TO_INT                                                 \
+                (g_hash_table_lookup (f_host_holes, buffer->host));           \
+          buffer->warnings_count                                              \
+            = GPOINTER_TO_INT                                                 \
+                (g_hash_table_lookup (f_host_warnings, buffer->host));        \
+          buffer->infos_count                                                 \
+            = GPOINTER_TO_INT                                                 \
+                (g_hash_table_lookup (f_host_infos, buffer->host));           \
+          buffer->logs_count                                                  \
+            = GPOINTER_TO_INT                                                 \
+                (g_hash_table_lookup (f_host_logs, buffer->host));            \
+          buffer->false_positives_count                                       \
+            = GPOINTER_TO_INT                                                 \
+                (g_hash_table_lookup (f_host_false_positives, buffer->host)); \
+        }                                                                     \
+      while (0)
+
+#define REPORT_HOST_CHUNK_PRINT(force)                                        \
+      do                                                                      \
+        {                                                                     \
+          if ((force || chunk->len >= REPORT_HOST_CHUNK_SIZE)                 \
+              && print_report_host_chunk_xml (out, chunk,                     \
+                                              host_summary_buffer, lean))     \
+            {                                                                 \
+              tz_revert (zone, old_tz_override);                              \
+              if (host_summary_buffer)                                        \
+                g_string_free (host_summary_buffer, TRUE);                    \
+              g_ptr_array_free (chunk, TRUE);                                 \
+              g_hash_table_destroy (f_host_ports);                            \
+              g_hash_table_destroy (f_host_holes);                            \
+              g_hash_table_destroy (f_host_warnings);                         \
+              g_hash_table_destroy (f_host_infos);                            \
+              g_hash_table_destroy (f_host_logs);                             \
+              g_hash_table_destroy (f_host_false_positives);                  \
+              return -1;                                                      \
+            }                                                                 \
+        }                                                                     \
+      while (0)
+
+      if (result_hosts_only)
+        {
+          gchar *result_host;
+          GHashTable *report_hosts;
           iterator_t hosts;
-          init_report_host_iterator (&hosts, report, result_host, 0);
-          present = next (&hosts);
-          if (delta && (present == FALSE))
-            {
-              cleanup_iterator (&hosts);
-              init_report_host_iterator (&hosts, delta, result_host, 0);
-              present = next (&hosts);
-            }
-          if (present)
-            {
-              const char *current_host;
-              int ports_count;
-              int holes_count, warnings_count, infos_count;
-              int logs_count, false_positives_count;
-
-              current_host = host_iterator_host (&hosts);
-
-              ports_count
-                = GPOINTER_TO_INT
-                    (g_hash_table_lookup (f_host_ports, current_host));
-              holes_count
-                = GPOINTER_TO_INT
-                    (g_hash_table_lookup ( f_host_holes, current_host));
-              warnings_count
-                = GPOINTER_TO_INT
-                    (g_hash_table_lookup ( f_host_warnings, current_host));
-              infos_count
-                = GPOINTER_TO_INT
-                    (g_hash_table_lookup ( f_host_infos, current_host));
-              logs_count
-                = GPOINTER_TO_INT
-                    (g_hash_table_lookup ( f_host_logs, current_host));
-              false_positives_count
-                = GPOINTER_TO_INT
-                    (g_hash_table_lookup ( f_host_false_positives, current_host));
-
-              host_summary_append (host_summary_buffer,
-                                   result_host,
-                                   host_iterator_start_time (&hosts),
-                                   host_iterator_end_time (&hosts));
-              PRINT (out,
-                     "<host>"
-                     "<ip>%s</ip>",
-                     result_host);
-
-              if (host_iterator_asset_uuid (&hosts)
-                  && strlen (host_iterator_asset_uuid (&hosts)))
-                PRINT (out,
-                       "<asset asset_id=\"%s\"/>",
-                       host_iterator_asset_uuid (&hosts));
-              else if (lean == 0)
-                PRINT (out,
-                       "<asset asset_id=\"\"/>");
+          int index = 0;
+
+          /* Get all the hosts of the report at once, instead of a query
+           * per result host. */
+          report_hosts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                NULL,
+                                                report_host_buffer_free);
+          init_report_host_iterator (&hosts, report, NULL, 0);
+          while (next (&hosts))
+            if (g_hash_table_lookup (report_hosts, host_iterator_host (&hosts))
+                == NULL)
+              {
+                report_host_buffer_t *buffer;
 
-              PRINT (out,
-                     "<start>%s</start>"
-                     "<end>%s</end>"
-                     "<port_count><page>%d</page></port_count>"
-                     "<result_count>"
-                     "<page>%d</page>"
-                     "<hole><page>%d</page></hole>"
-                     "<warning><page>%d</page></warning>"
-                     "<info><page>%d</page></info>"
-                     "<log><page>%d</page></log>"
-                     "<false_positive><page>%d</page></false_positive>"
-                     "</result_count>",
-                     host_iterator_start_time (&hosts),
-                     host_iterator_end_time (&hosts)
-                       ? host_iterator_end_time (&hosts)
-                       : "",
-                     ports_count,
-                     (holes_count + warnings_count + infos_count
-                      + logs_count + false_positives_count),
-                     holes_count,
-                     warnings_count,
-                     infos_count,
-                     logs_count,
-                     false_positives_count);
-
-              if (print_report_host_details_xml
-                   (host_iterator_report_host (&hosts), out, lean))
+                buffer = report_host_buffer_new (&hosts);
+                g_hash_table_insert (report_hosts, buffer->host, buffer);
+              }
+          cleanup_iterator (&hosts);
+
+          array_terminate (result_hosts);
+          while ((result_host = g_ptr_array_index (result_hosts, index++)))
+            {
+              report_host_buffer_t *buffer;
+
+              buffer = g_hash_table_lookup (report_hosts, result_host);
+              if (buffer)
+                buffer = report_host_buffer_copy (buffer);
+              else if (delta)
                 {
-                  tz_revert (zone, tz, old_tz_override);
-                  if (host_summary_buffer)
-                    g_string_free (host_summary_buffer, TRUE);
-                  g_hash_table_destroy (f_host_ports);
-                  g_hash_table_destroy (f_host_holes);
-                  g_hash_table_destroy (f_host_warnings);
-                  g_hash_table_destroy (f_host_infos);
-                  g_hash_table_destroy (f_host_logs);
-                  g_hash_table_destroy (f_host_false_positives);
-                  return -1;
+                  init_report_host_iterator (&hosts, delta, result_host, 0);
+                  if (next (&hosts))
+                    buffer = report_host_buffer_new (&hosts);
+                  cleanup_iterator (&hosts);
                 }
 
-              PRINT (out,
-                     "</host>");
+              if (buffer)
+                {
+                  REPORT_HOST_BUFFER_COUNTS (buffer);
+                  g_ptr_array_add (chunk, buffer);
+                  REPORT_HOST_CHUNK_PRINT (FALSE);
+                }
             }
-          cleanup_iterator (&hosts);
+          g_hash_table_destroy (report_hosts);
+          array_free (result_hosts);
         }
-      array_free (result_hosts);
-    }
-  else if (get->details)
-    {
-      iterator_t hosts;
-      init_report_host_iterator (&hosts, report, NULL, 0);
-      while (next (&hosts))
-        {
-          const char *current_host;
-          int ports_count;
-          int holes_count, warnings_count, infos_count;
-          int logs_count, false_positives_count;
-
-          current_host = host_iterator_host (&hosts);
-
-          ports_count
-            = GPOINTER_TO_INT
-                (g_hash_table_lookup (f_host_ports, current_host));
-          holes_count
-            = GPOINTER_TO_INT
-                (g_hash_table_lookup (f_host_holes, current_host));
-          warnings_count
-            = GPOINTER_TO_INT
-                (g_hash_table_lookup (f_host_warnings, current_host));
-          infos_count
-            = GPOINTER_TO_INT
-                (g_hash_table_lookup (f_host_infos, current_host));
-          logs_count
-            = GPOINTER_TO_INT
-                (g_hash_table_lookup (f_host_logs, current_host));
-          false_positives_count
-            = GPOINTER_TO_INT
-                (g_hash_table_lookup (f_host_false_positives, current_host));
-
-          host_summary_append (host_summary_buffer,
-                               host_iterator_host (&hosts),
-                               host_iterator_start_time (&hosts),
-                               host_iterator_end_time (&hosts));
-          PRINT (out,
-                 "<host>"
-                 "<ip>%s</ip>",
-                 host_iterator_host (&hosts));
-
-          if (host_iterator_asset_uuid (&hosts)
-              && strlen (host_iterator_asset_uuid (&hosts)))
-            PRINT (out,
-                   "<asset asset_id=\"%s\"/>",
-                   host_iterator_asset_uuid (&hosts));
-          else if (lean == 0)
-            PRINT (out,
-                   "<asset asset_id=\"\"/>");
+      else
+        {
+          iterator_t hosts;
 
-          PRINT (out,
-                 "<start>%s</start>"
-                 "<end>%s</end>"
-                 "<port_count><page>%d</page></port_count>"
-                 "<result_count>"
-                 "<page>%d</page>"
-                 "<hole><page>%d</page></hole>"
-                 "<warning><page>%d</page></warning>"
-                 "<info><page>%d</page></info>"
-                 "<log><page>%d</page></log>"
-                 "<false_positive><page>%d</page></false_positive>"
-                 "</result_count>",
-                 host_iterator_start_time (&hosts),
-                 host_iterator_end_time (&hosts)
-                   ? host_iterator_end_time (&hosts)
-                   : "",
-                 ports_count,
-                 (holes_count + warnings_count + infos_count
-                  + logs_count + false_positives_count),
-                 holes_count,
-                 warnings_count,
-                 infos_count,
-                 logs_count,
-                 false_positives_count);
-
-          if (print_report_host_details_xml
-               (host_iterator_report_host (&hosts), out, lean))
-            {
-              tz_revert (zone, tz, old_tz_override);
-              if (host_summary_buffer)
-                g_string_free (host_summary_buffer, TRUE);
-              g_hash_table_destroy (f_host_ports);
-              g_hash_table_destroy (f_host_holes);
-              g_hash_table_destroy (f_host_warnings);
-              g_hash_table_destroy (f_host_infos);
-              g_hash_table_destroy (f_host_logs);
-              g_hash_table_destroy (f_host_false_positives);
-              return -1;
-            }
+          init_report_host_iterator (&hosts, report, NULL, 0);
+          while (next (&hosts))
+            {
+              report_host_buffer_t *buffer;
 
-          PRINT (out,
-                 "</host>");
+              buffer = report_host_buffer_new (&hosts);
+              REPORT_HOST_BUFFER_COUNTS (buffer);
+              g_ptr_array_add (chunk, buffer);
+              REPORT_HOST_CHUNK_PRINT (FALSE);
+            }
+          cleanup_iterator (&hosts);
         }
-      cleanup_iterator (&hosts);
+      REPORT_HOST_CHUNK_PRINT (TRUE);
+
+#undef REPORT_HOST_BUFFER_COUNTS
+#undef REPORT_HOST_CHUNK_PRINT
+
+      g_ptr_array_free (chunk, TRUE);
     }
 
   g_hash_table_destroy (f_host_ports);
@@ -28973,7 +33585,7 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
 
   if (delta == 0 && print_report_errors_xml (report, out))
     {
-      tz_revert (zone, tz, old_tz_override);
+      tz_revert (zone, old_tz_override);
       if (host_summary_buffer)
         g_string_free (host_summary_buffer, TRUE);
       return -1;
@@ -28999,6 +33611,873 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
   return 0;
 }
 
+
+/* Rendered report cache. */
+
+/**
+ * @brief Set the maximum size of the rendered report cache.
+ *
+ * @param[in]  new_size  Size in MiB, 0 to disable the cache.
+ */
+void
+set_report_cache_size (int new_size)
+{
+  if (new_size < 0)
+    report_cache_size = 0;
+  else
+    report_cache_size = new_size;
+}
+
+/**
+ * @brief Get the directory of the rendered report cache.
+ *
+ * @return Freshly allocated path.
+ */
+static gchar *
+report_cache_dir ()
+{
+  return g_build_filename (GVMD_STATE_DIR, "report_cache", NULL);
+}
+
+/**
+ * @brief Get the key of a rendered report in the cache.
+ *
+ * Only finished reports are cached, because only their output is fixed.
+ * The key covers everything else that goes into the output, including the
+ * current user and their roles and groups, because permissions decide which
+ * notes, overrides and tickets are included.  Any change to notes,
+ * overrides, tags, tickets, permissions or the task changes the key, so
+ * stale entries are never used and age out of the cache.
+ *
+ * The key starts with the UUIDs of the user and the reports, so that
+ * report_cache_purge can find the entries when these are deleted.
+ *
+ * @param[in]  report             Report.
+ * @param[in]  delta_report       Report to compare with.
+ * @param[in]  get                GET data for report.
+ * @param[in]  report_format      Report format.
+ * @param[in]  notes_details      If notes, Whether to include details.
+ * @param[in]  overrides_details  If overrides, Whether to include details.
+ * @param[in]  variant            Other report options, as text.
+ *
+ * @return Freshly allocated key, or NULL if the report cannot be cached.
+ */
+static gchar *
+report_cache_key (report_t report, report_t delta_report,
+                  const get_data_t *get, report_format_t report_format,
+                  int notes_details, int overrides_details,
+                  const gchar *variant)
+{
+  task_status_t status;
+  gchar *term, *clean, *report_id, *delta_id, *format, *versions, *task;
+  gchar *key_string, *hash, *key;
+
+  if (report_cache_size == 0)
+    return NULL;
+
+  if (report_scan_run_status (report, &status)
+      || status != TASK_STATUS_DONE)
+    return NULL;
+
+  if (delta_report
+      && (report_scan_run_status (delta_report, &status)
+          || status != TASK_STATUS_DONE))
+    return NULL;
+
+  if (get->filt_id && strlen (get->filt_id)
+      && strcmp (get->filt_id, FILT_ID_NONE))
+    {
+      term = filter_term (get->filt_id);
+      if (term == NULL)
+        return NULL;
+    }
+  else
+    term = g_strdup (get->filter ? get->filter : "");
+  clean = manage_clean_filter (term);
+  g_free (term);
+
+  format = sql_string ("SELECT uuid || ' ' || modification_time || ' '"
+                       "       || coalesce ((SELECT string_agg"
+                       "                             (name || '=' || value,"
+                       "                              ' ' ORDER BY name)"
+                       "                     FROM report_format_params"
+                       "                     WHERE report_format = %llu),"
+                       "                    '')"
+                       " FROM report_formats WHERE id = %llu;",
+                       report_format,
+                       report_format);
+
+  versions = sql_string ("SELECT (SELECT count (*) || ' '"
+                         "               || coalesce (max (modification_time),"
+                         "                            0)"
+                         "        FROM notes)"
+                         "       || ' ' || (SELECT count (*) || ' '"
+                         "                         || coalesce"
+                         "                             (max (modification_time),"
+                         "                              0)"
+                         "                  FROM overrides)"
+                         "       || ' ' || (SELECT count (*) || ' '"
+                         "                         || coalesce"
+                         "                             (max (modification_time),"
+                         "                              0)"
+                         "                  FROM tags)"
+                         "       || ' ' || (SELECT count (*) || ' '"
+                         "                         || coalesce"
+                         "                             (max (modification_time),"
+                         "                              0)"
+                         "                  FROM tickets)"
+                         "       || ' ' || (SELECT count (*) || ' '"
+                         "                         || coalesce"
+                         "                             (max (modification_time),"
+                         "                              0)"
+                         "                  FROM permissions)"
+                         "       || ' ' || coalesce"
+                         "                  ((SELECT string_agg"
+                         "                            (role::text, ','"
+                         "                             ORDER BY role)"
+                         "                    FROM role_users"
+                         "                    WHERE \"user\" = (SELECT id FROM users"
+                         "                                    WHERE uuid = '%s')),"
+                         "                   '')"
+                         "       || ' ' || coalesce"
+                         "                  ((SELECT string_agg"
+                         "                            (\"group\"::text, ','"
+                         "                             ORDER BY \"group\")"
+                         "                    FROM group_users"
+                         "                    WHERE \"user\" = (SELECT id FROM users"
+                         "                                    WHERE uuid = '%s')),"
+                         "                   '');",
+                         current_credentials.uuid,
+                         current_credentials.uuid);
+
+  task = sql_string ("SELECT name || ' ' || modification_time || ' '"
+                     "       || coalesce (comment, '')"
+                     " FROM tasks"
+                     " WHERE id = (SELECT task FROM reports WHERE id = %llu);",
+                     report);
+
+  report_id = report_uuid (report);
+  delta_id = delta_report ? report_uuid (delta_report) : NULL;
+
+  key_string = g_strdup_printf ("%s\n%s\n%s %i\n%s\n%s\n%s\n%s\n%i %i %s\n%s\n%s",
+                                current_credentials.uuid,
+                                current_credentials.timezone
+                                 ? current_credentials.timezone : "",
+                                current_credentials.severity_class
+                                 ? current_credentials.severity_class : "",
+                                current_credentials.dynamic_severity,
+                                report_id,
+                                delta_id ? delta_id : "",
+                                clean,
+                                format ? format : "",
+                                notes_details,
+                                overrides_details,
+                                variant,
+                                versions ? versions : "",
+                                task ? task : "");
+  hash = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key_string, -1);
+  key = g_strdup_printf ("%s_%s_%s_%s",
+                         current_credentials.uuid,
+                         report_id,
+                         delta_id ? delta_id : "",
+                         hash);
+
+  g_free (key_string);
+  g_free (hash);
+  free (report_id);
+  free (delta_id);
+  g_free (format);
+  g_free (versions);
+  g_free (task);
+  g_free (clean);
+  return key;
+}
+
+/**
+ * @brief Look up a rendered report in the cache.
+ *
+ * @param[in]  key   Key from report_cache_key.
+ * @param[out] meta  NULL or location for the extra values stored with the
+ *                   report.  Free with g_key_file_free.
+ *
+ * @return Freshly allocated path of the cached output, or NULL if missing.
+ */
+static gchar *
+report_cache_lookup (const gchar *key, GKeyFile **meta)
+{
+  gchar *dir, *path;
+
+  dir = report_cache_dir ();
+  path = g_build_filename (dir, key, NULL);
+  g_free (dir);
+
+  if (g_file_test (path, G_FILE_TEST_IS_REGULAR) == FALSE)
+    {
+      g_free (path);
+      return NULL;
+    }
+
+  if (meta)
+    {
+      gchar *meta_path;
+
+      *meta = g_key_file_new ();
+      meta_path = g_strdup_printf ("%s.meta", path);
+      if (g_key_file_load_from_file (*meta, meta_path, G_KEY_FILE_NONE, NULL)
+          == FALSE)
+        {
+          g_key_file_free (*meta);
+          *meta = NULL;
+          g_free (meta_path);
+          g_free (path);
+          return NULL;
+        }
+      g_free (meta_path);
+    }
+
+  /* Mark the entry as recently used, for eviction. */
+  if (g_utime (path, NULL))
+    g_debug ("%s: utime %s: %s", __func__, path, strerror (errno));
+
+  g_debug ("%s: hit %s", __func__, key);
+  return path;
+}
+
+/**
+ * @brief An entry in the rendered report cache.
+ */
+typedef struct
+{
+  gchar *path;    ///< Path of cached output.
+  off_t size;     ///< Size of cached output.
+  time_t mtime;   ///< Time of last use.
+} report_cache_entry_t;
+
+/**
+ * @brief Free a rendered report cache entry.
+ *
+ * @param[in]  data  Entry.
+ */
+static void
+report_cache_entry_free (gpointer data)
+{
+  report_cache_entry_t *entry;
+
+  entry = (report_cache_entry_t *) data;
+  g_free (entry->path);
+  g_free (entry);
+}
+
+/**
+ * @brief Compare rendered report cache entries by time of last use.
+ *
+ * @param[in]  one  Pointer to first entry.
+ * @param[in]  two  Pointer to second entry.
+ *
+ * @return Less than, equal to or greater than 0, like strcmp.
+ */
+static gint
+report_cache_entry_compare (gconstpointer one, gconstpointer two)
+{
+  const report_cache_entry_t *entry_one, *entry_two;
+
+  entry_one = *(report_cache_entry_t * const *) one;
+  entry_two = *(report_cache_entry_t * const *) two;
+  if (entry_one->mtime < entry_two->mtime)
+    return -1;
+  return entry_one->mtime > entry_two->mtime;
+}
+
+/**
+ * @brief Remove the least recently used entries while the cache is too big.
+ *
+ * @param[in]  dir  Cache directory.
+ */
+static void
+report_cache_evict (const gchar *dir)
+{
+  GDir *handle;
+  const gchar *name;
+  GPtrArray *entries;
+  off_t total, limit;
+  guint index;
+
+  handle = g_dir_open (dir, 0, NULL);
+  if (handle == NULL)
+    return;
+
+  entries = g_ptr_array_new_with_free_func (report_cache_entry_free);
+  total = 0;
+  while ((name = g_dir_read_name (handle)))
+    {
+      report_cache_entry_t *entry;
+      struct stat state;
+      gchar *path;
+
+      /* Skip .meta and temporary files. */
+      if (strchr (name, '.'))
+        continue;
+
+      path = g_build_filename (dir, name, NULL);
+      if (stat (path, &state))
+        {
+          g_free (path);
+          continue;
+        }
+
+      entry = g_malloc (sizeof (*entry));
+      entry->path = path;
+      entry->size = state.st_size;
+      entry->mtime = state.st_mtime;
+      total += state.st_size;
+      g_ptr_array_add (entries, entry);
+    }
+  g_dir_close (handle);
+
+  limit = (off_t) report_cache_size * 1024 * 1024;
+  if (total > limit)
+    {
+      g_ptr_array_sort (entries, report_cache_entry_compare);
+      for (index = 0; index < entries->len && total > limit; index++)
+        {
+          report_cache_entry_t *entry;
+          gchar *meta_path;
+
+          entry = g_ptr_array_index (entries, index);
+          meta_path = g_strdup_printf ("%s.meta", entry->path);
+          g_debug ("%s: evicting %s", __func__, entry->path);
+          unlink (entry->path);
+          unlink (meta_path);
+          g_free (meta_path);
+          total -= entry->size;
+        }
+    }
+
+  g_ptr_array_free (entries, TRUE);
+}
+
+/**
+ * @brief Remove the cached renders of deleted users and reports.
+ *
+ * @param[in]  uuids  UUIDs of the users and reports, as keys.
+ */
+static void
+report_cache_purge (GHashTable *uuids)
+{
+  GDir *handle;
+  const gchar *name;
+  gchar *dir;
+
+  dir = report_cache_dir ();
+  handle = g_dir_open (dir, 0, NULL);
+  if (handle == NULL)
+    {
+      g_free (dir);
+      return;
+    }
+
+  while ((name = g_dir_read_name (handle)))
+    {
+      gchar **fields;
+
+      /* The key starts with the user, report and delta report, and the
+       * .meta and temporary files share the key. */
+      fields = g_strsplit (name, "_", 4);
+      if (g_strv_length (fields) == 4
+          && (g_hash_table_contains (uuids, fields[0])
+              || g_hash_table_contains (uuids, fields[1])
+              || g_hash_table_contains (uuids, fields[2])))
+        {
+          gchar *path;
+
+          path = g_build_filename (dir, name, NULL);
+          g_debug ("%s: removing %s", __func__, path);
+          unlink (path);
+          g_free (path);
+        }
+      g_strfreev (fields);
+    }
+  g_dir_close (handle);
+  g_free (dir);
+}
+
+/**
+ * @brief Add a rendered report to the cache.
+ *
+ * @param[in]  key          Key from report_cache_key.
+ * @param[in]  output_file  File containing the rendered report.
+ * @param[in]  meta         Extra values to store with the report, or NULL.
+ */
+static void
+report_cache_add (const gchar *key, const gchar *output_file, GKeyFile *meta)
+{
+  gchar *dir, *path, *temp_path;
+  int fd;
+
+  dir = report_cache_dir ();
+  if (g_mkdir_with_parents (dir, 0700))
+    {
+      g_warning ("%s: failed to create %s: %s",
+                 __func__, dir, strerror (errno));
+      g_free (dir);
+      return;
+    }
+
+  path = g_build_filename (dir, key, NULL);
+
+  if (meta)
+    {
+      gchar *meta_path, *data;
+
+      meta_path = g_strdup_printf ("%s.meta", path);
+      data = g_key_file_to_data (meta, NULL, NULL);
+      if (g_file_set_contents (meta_path, data, -1, NULL) == FALSE)
+        {
+          g_warning ("%s: failed to write %s", __func__, meta_path);
+          g_free (data);
+          g_free (meta_path);
+          g_free (path);
+          g_free (dir);
+          return;
+        }
+      g_free (data);
+      g_free (meta_path);
+    }
+
+  /* Copy to a temporary name first, so that readers never see a partial
+   * entry. */
+  temp_path = g_strdup_printf ("%s.XXXXXX", path);
+  fd = mkstemp (temp_path);
+  if (fd == -1)
+    {
+      g_warning ("%s: mkstemp failed: %s", __func__, strerror (errno));
+      g_free (temp_path);
+      g_free (path);
+      g_free (dir);
+      return;
+    }
+  close (fd);
+
+  if (gvm_file_copy (output_file, temp_path) == FALSE
+      || rename (temp_path, path))
+    {
+      g_warning ("%s: failed to add %s", __func__, key);
+      unlink (temp_path);
+    }
+
+  g_free (temp_path);
+  g_free (path);
+
+  report_cache_evict (dir);
+  g_free (dir);
+}
+
+/**
+ * @brief Get an extra value of a rendered report from the cache.
+ *
+ * @param[in]  meta   Extra values from report_cache_lookup.
+ * @param[in]  name   Name of value.
+ * @param[out] value  NULL or location for freshly allocated value.
+ *
+ * @return TRUE if the value was requested and found, or not requested,
+ *         else FALSE.
+ */
+static gboolean
+report_cache_meta_get (GKeyFile *meta, const gchar *name, gchar **value)
+{
+  if (value == NULL)
+    return TRUE;
+  *value = g_key_file_get_string (meta, "report", name, NULL);
+  return *value != NULL;
+}
+
+/**
+ * @brief Write a result as a row of an Arrow IPC stream.
+ *
+ * @param[in]  writer     Arrow writer.
+ * @param[in]  results    Result iterator, at the result.
+ * @param[in]  report_id  UUID of the report.
+ * @param[in]  task_id    UUID of the task.
+ * @param[in]  name       Name of the task.
+ * @param[in]  delta      Delta state of the result, or NULL.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+arrow_write_result (arrow_writer_t *writer, iterator_t *results,
+                    const char *report_id, const char *task_id,
+                    const char *name, const char *delta)
+{
+  const char *qod;
+
+  arrow_writer_string (writer, get_iterator_uuid (results));
+  arrow_writer_string (writer, report_id);
+  arrow_writer_string (writer, task_id);
+  arrow_writer_string (writer, name);
+  arrow_writer_string (writer, result_iterator_host (results));
+  arrow_writer_string (writer, result_iterator_hostname (results));
+  arrow_writer_string (writer, result_iterator_asset_host_id (results));
+  arrow_writer_string (writer, result_iterator_port (results));
+  arrow_writer_string (writer, result_iterator_nvt_oid (results));
+  arrow_writer_string (writer, result_iterator_nvt_name (results));
+  arrow_writer_string (writer, result_iterator_nvt_family (results));
+  arrow_writer_string (writer, result_iterator_scan_nvt_version (results));
+  if (result_iterator_severity (results))
+    arrow_writer_double (writer, result_iterator_severity_double (results));
+  else
+    arrow_writer_null (writer);
+  arrow_writer_string (writer, result_iterator_level (results));
+  qod = result_iterator_qod (results);
+  if (qod && strlen (qod))
+    arrow_writer_int64 (writer, atoi (qod));
+  else
+    arrow_writer_null (writer);
+  arrow_writer_string (writer, result_iterator_qod_type (results));
+  arrow_writer_string (writer, result_iterator_solution_type (results));
+  arrow_writer_string (writer, result_iterator_descr (results));
+  arrow_writer_string (writer, get_iterator_creation_time (results));
+  arrow_writer_string (writer, get_iterator_modification_time (results));
+  arrow_writer_string (writer, delta);
+  return arrow_writer_end_row (writer);
+}
+
+/**
+ * @brief Write the delta of two reports as rows of an Arrow IPC stream.
+ *
+ * Compares the two sorted iterators like print_report_delta_xml does.
+ * New results come from the delta report, all others from the report.
+ *
+ * @param[in]  writer         Arrow writer.
+ * @param[in]  results        Result iterator of the report.
+ * @param[in]  delta_results  Result iterator of the delta report.
+ * @param[in]  delta_states   Delta states to include, like "cgns".
+ * @param[in]  first_result   Number of matching results to skip.
+ * @param[in]  max_results    Max number of results to write, -1 for all.
+ * @param[in]  sort_order     Whether the iterators sort ascending.
+ * @param[in]  sort_field     Field the iterators sort on.
+ * @param[in]  report_id      UUID of the report.
+ * @param[in]  task_id        UUID of the task.
+ * @param[in]  name           Name of the task.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+arrow_write_delta (arrow_writer_t *writer, iterator_t *results,
+                   iterator_t *delta_results, const char *delta_states,
+                   int first_result, int max_results, int sort_order,
+                   const char *sort_field, const char *report_id,
+                   const char *task_id, const char *name)
+{
+  gboolean done, delta_done;
+
+  done = !next (results);
+  delta_done = !next (delta_results);
+  while (max_results && (done == FALSE || delta_done == FALSE))
+    {
+      compare_results_t state;
+      const char *state_name;
+      iterator_t *row;
+
+      manage_process_tick ();
+
+      if (done)
+        state = COMPARE_RESULTS_NEW;
+      else if (delta_done)
+        state = COMPARE_RESULTS_GONE;
+      else
+        state = compare_results (results, delta_results, sort_order,
+                                 sort_field);
+
+      switch (state)
+        {
+          case COMPARE_RESULTS_CHANGED:
+            state_name = "changed";
+            row = results;
+            break;
+          case COMPARE_RESULTS_GONE:
+            state_name = "gone";
+            row = results;
+            break;
+          case COMPARE_RESULTS_NEW:
+            state_name = "new";
+            row = delta_results;
+            break;
+          case COMPARE_RESULTS_SAME:
+            state_name = "same";
+            row = results;
+            break;
+          default:
+            g_warning ("%s: compare_results failed", __func__);
+            return -1;
+        }
+
+      if (strchr (delta_states, state_name[0]))
+        {
+          if (first_result)
+            first_result--;
+          else
+            {
+              if (arrow_write_result (writer, row, report_id, task_id, name,
+                                      state_name))
+                return -1;
+              if (max_results > 0)
+                max_results--;
+            }
+        }
+
+      if (state != COMPARE_RESULTS_NEW)
+        done = !next (results);
+      if (state != COMPARE_RESULTS_GONE)
+        delta_done = !next (delta_results);
+    }
+  return 0;
+}
+
+/**
+ * @brief Print the results of a report to a file as an Arrow IPC stream.
+ *
+ * Writes the results straight from the result iterator, in batches,
+ * without generating any XML.
+ *
+ * Times are in the timezone of the filter, like in the XML report.
+ *
+ * With a delta report the rows are the delta of the two reports, and the
+ * "delta" column holds the state of each row, like the delta XML report.
+ * The delta_states keyword of the filter selects the states.
+ *
+ * @param[in]  report             Report.
+ * @param[in]  delta              Report to compare with, 0 for none.
+ * @param[in]  task               Task of report.
+ * @param[in]  get                GET data for report.
+ * @param[in]  ignore_pagination  Whether to ignore pagination.
+ * @param[out] zone_return        NULL or location for actual timezone used.
+ * @param[in]  file               File name.
+ *
+ * @return 0 success, 2 failed to find filter, -1 error.
+ */
+static int
+print_report_arrow (report_t report, report_t delta, task_t task,
+                    const get_data_t *get, int ignore_pagination,
+                    gchar **zone_return, const gchar *file)
+{
+  static const arrow_column_t columns[]
+    = {{ "result_id", ARROW_TYPE_UTF8 },
+       { "report_id", ARROW_TYPE_UTF8 },
+       { "task_id", ARROW_TYPE_UTF8 },
+       { "task_name", ARROW_TYPE_UTF8 },
+       { "host", ARROW_TYPE_UTF8 },
+       { "hostname", ARROW_TYPE_UTF8 },
+       { "asset_id", ARROW_TYPE_UTF8 },
+       { "port", ARROW_TYPE_UTF8 },
+       { "nvt_oid", ARROW_TYPE_UTF8 },
+       { "nvt_name", ARROW_TYPE_UTF8 },
+       { "nvt_family", ARROW_TYPE_UTF8 },
+       { "scan_nvt_version", ARROW_TYPE_UTF8 },
+       { "severity", ARROW_TYPE_DOUBLE },
+       { "threat", ARROW_TYPE_UTF8 },
+       { "qod", ARROW_TYPE_INT64 },
+       { "qod_type", ARROW_TYPE_UTF8 },
+       { "solution_type", ARROW_TYPE_UTF8 },
+       { "description", ARROW_TYPE_UTF8 },
+       { "creation_time", ARROW_TYPE_UTF8 },
+       { "modification_time", ARROW_TYPE_UTF8 },
+       { "delta", ARROW_TYPE_UTF8 }};
+  iterator_t results, delta_results;
+  arrow_writer_t *writer;
+  char *report_id, *task_id, *name, *old_tz_override;
+  gchar *term, *zone, *sort_field, *delta_states;
+  get_data_t get_all;
+  FILE *stream;
+  int ret, first_result, max_results, sort_order;
+
+  term = NULL;
+  if (get->filt_id && strlen (get->filt_id)
+      && strcmp (get->filt_id, FILT_ID_NONE))
+    {
+      term = filter_term (get->filt_id);
+      if (term == NULL)
+        return 2;
+    }
+  else
+    term = g_strdup (get->filter ? get->filter : "");
+
+  zone = NULL;
+  sort_field = NULL;
+  delta_states = NULL;
+  manage_report_filter_controls (term,
+                                 &first_result, &max_results, &sort_field,
+                                 &sort_order, NULL, NULL, NULL, &delta_states,
+                                 NULL, NULL, NULL, NULL, NULL, NULL, &zone);
+
+  if (zone && strlen (zone))
+    {
+      gchar *quoted_zone;
+
+      old_tz_override = sql_string ("SELECT current_setting"
+                                    "        ('gvmd.tz_override');");
+
+      quoted_zone = sql_insert (zone);
+      sql ("SET SESSION \"gvmd.tz_override\" = %s;", quoted_zone);
+      g_free (quoted_zone);
+    }
+  else
+    old_tz_override = NULL;
+
+  if (zone_return)
+    *zone_return = (zone && strlen (zone))
+                    ? g_strdup (zone)
+                    : setting_timezone ();
+
+  if (delta)
+    {
+      /* The delta iterators get every result, so paginate the delta. */
+      if (ignore_pagination)
+        {
+          first_result = 0;
+          max_results = -1;
+        }
+      else
+        {
+          first_result = MAX (first_result, 0);
+          max_results = manage_max_rows (max_results);
+        }
+      sort_field = delta_sort_field (sort_field);
+      ret = init_delta_iterators (report, &results, delta, &delta_results,
+                                  get, term, sort_field);
+    }
+  else
+    {
+      if (ignore_pagination)
+        {
+          get_all = *get;
+          get_all.ignore_pagination = 1;
+          get = &get_all;
+        }
+      ret = init_result_get_iterator (&results, get, report, NULL, NULL);
+    }
+  g_free (term);
+  if (ret)
+    {
+      g_free (sort_field);
+      g_free (delta_states);
+      tz_revert (zone, old_tz_override);
+      return ret == 2 ? 2 : -1;
+    }
+
+  stream = fopen (file, "w");
+  if (stream == NULL)
+    {
+      g_warning ("%s: fopen failed: %s", __func__, strerror (errno));
+      cleanup_iterator (&results);
+      if (delta)
+        cleanup_iterator (&delta_results);
+      g_free (sort_field);
+      g_free (delta_states);
+      tz_revert (zone, old_tz_override);
+      return -1;
+    }
+
+  writer = arrow_writer_new (stream, columns, G_N_ELEMENTS (columns));
+  if (writer == NULL)
+    {
+      cleanup_iterator (&results);
+      if (delta)
+        cleanup_iterator (&delta_results);
+      g_free (sort_field);
+      g_free (delta_states);
+      tz_revert (zone, old_tz_override);
+      fclose (stream);
+      return -1;
+    }
+
+  report_id = report_uuid (report);
+  task_uuid (task, &task_id);
+  name = task_name (task);
+
+  ret = 0;
+  if (delta)
+    {
+      ret = arrow_write_delta (writer, &results, &delta_results,
+                               delta_states ? delta_states : "cgns",
+                               first_result, max_results, sort_order,
+                               sort_field, report_id, task_id, name);
+      cleanup_iterator (&delta_results);
+    }
+  else
+    while (ret == 0 && next (&results))
+      {
+        manage_process_tick ();
+        ret = arrow_write_result (writer, &results, report_id, task_id, name,
+                                  NULL);
+      }
+  cleanup_iterator (&results);
+  g_free (sort_field);
+  g_free (delta_states);
+  tz_revert (zone, old_tz_override);
+  free (report_id);
+  free (task_id);
+  free (name);
+
+  if (ret)
+    {
+      arrow_writer_free (writer);
+      fclose (stream);
+      return -1;
+    }
+
+  if (arrow_writer_finish (writer))
+    {
+      fclose (stream);
+      return -1;
+    }
+
+  if (fclose (stream))
+    {
+      g_warning ("%s: fclose failed: %s", __func__, strerror (errno));
+      return -1;
+    }
+  return 0;
+}
+
+/**
+ * @brief Generate a report in a format that gvmd generates itself.
+ *
+ * @param[in]  report            Report.
+ * @param[in]  delta_report      Report to compare with.
+ * @param[in]  task              Task of report.
+ * @param[in]  get               GET data for report.
+ * @param[in]  ignore_pagination  Whether to ignore pagination.
+ * @param[in]  report_format_id  UUID of report format.
+ * @param[in]  dir               Directory for output file.
+ * @param[out] zone_return       NULL or location for actual timezone used.
+ * @param[out] output_file       Output file on success.
+ *
+ * @return 0 success, 1 report format is not generated natively, 2 failed
+ *         to find filter, -1 error.
+ */
+static int
+print_report_native (report_t report, report_t delta_report, task_t task,
+                     const get_data_t *get, int ignore_pagination,
+                     const char *report_format_id, const char *dir,
+                     gchar **zone_return, gchar **output_file)
+{
+  int ret;
+
+  if (report_format_id == NULL
+      || strcmp (report_format_id, REPORT_FORMAT_UUID_ARROW_RESULTS))
+    return 1;
+
+  *output_file = g_build_filename (dir, "report.arrows", NULL);
+  ret = print_report_arrow (report, delta_report, task, get,
+                            ignore_pagination, zone_return, *output_file);
+  if (ret)
+    {
+      g_free (*output_file);
+      *output_file = NULL;
+    }
+  return ret;
+}
+
 /**
  * @brief Generate a report.
  *
@@ -29028,18 +34507,17 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
                gchar **host_summary)
 {
   task_t task;
-  gchar *report_format_id, *xml_start, *xml_file, *output_file;
+  gchar *report_format_id, *xml_start, *xml_file, *output_file, *cache_key;
   char xml_dir[] = "/tmp/gvmd_XXXXXX";
   int ret;
   GList *used_rfps;
   GError *get_error;
   gchar *output;
   gsize output_len;
+  GKeyFile *meta;
 
   used_rfps = NULL;
 
-  /* Print the report as XML to a file. */
-
   if (((report_format_predefined (report_format) == 0)
        && (report_format_trust (report_format) != TRUST_YES))
       || (report_task (report, &task)))
@@ -29047,9 +34525,64 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
       return NULL;
     }
 
+  /* Use the rendered report from the cache if there is one. */
+
+  cache_key = report_cache_key (report, delta_report, get, report_format,
+                                notes_details, overrides_details,
+                                "1 0 0");
+  meta = NULL;
+  output_file = cache_key ? report_cache_lookup (cache_key, &meta) : NULL;
+  if (output_file)
+    {
+      if (report_cache_meta_get (meta, "filter_term", filter_term_return)
+          && report_cache_meta_get (meta, "zone", zone_return)
+          && report_cache_meta_get (meta, "host_summary", host_summary)
+          && g_file_get_contents (output_file, &output, &output_len, NULL))
+        {
+          g_key_file_free (meta);
+          g_free (output_file);
+          g_free (cache_key);
+          report_format_id = report_format_uuid (report_format);
+          goto convenience;
+        }
+      g_key_file_free (meta);
+      g_free (output_file);
+    }
+
+  /* Print the report as XML to a file. */
+
   if (mkdtemp (xml_dir) == NULL)
     {
       g_warning ("%s: mkdtemp failed", __func__);
+      g_free (cache_key);
+      return NULL;
+    }
+
+  report_format_id = report_format_uuid (report_format);
+
+  /* Some formats are generated directly from the database. */
+
+  ret = print_report_native (report, delta_report, task, get,
+                             0 /* ignore_pagination */,
+                             report_format_id, xml_dir, zone_return,
+                             &output_file);
+  if (ret == 0)
+    {
+      if (filter_term_return)
+        *filter_term_return = (get->filt_id
+                               && strcmp (get->filt_id, FILT_ID_NONE))
+                               ? filter_term (get->filt_id)
+                               : g_strdup (get->filter);
+      /* Native formats have no host summary. */
+      if (host_summary)
+        *host_summary = g_strdup ("");
+      goto read;
+    }
+  if (ret != 1)
+    {
+      g_free (report_format_id);
+      g_free (cache_key);
+      gvm_file_remove_recurse (xml_dir);
       return NULL;
     }
 
@@ -29062,7 +34595,9 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
                                 filter_term_return, zone_return, host_summary);
   if (ret)
     {
+      g_free (report_format_id);
       g_free (xml_start);
+      g_free (cache_key);
       gvm_file_remove_recurse (xml_dir);
       return NULL;
     }
@@ -29070,7 +34605,6 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
   xml_file = g_strdup_printf ("%s/report.xml", xml_dir);
 
   /* Apply report format(s) */
-  report_format_id = report_format_uuid (report_format);
 
   output_file = apply_report_format (report_format_id,
                                      xml_start, xml_file, xml_dir,
@@ -29083,10 +34617,13 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
   g_free (xml_file);
   g_free (xml_start);
 
+ read:
+
   /* Read the script output from file. */
   if (output_file == NULL)
     {
       g_free (report_format_id);
+      g_free (cache_key);
       gvm_file_remove_recurse (xml_dir);
       return NULL;
     }
@@ -29096,6 +34633,21 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
                        &output,
                        &output_len,
                        &get_error);
+  if (get_error == NULL && cache_key)
+    {
+      meta = g_key_file_new ();
+      if (filter_term_return && *filter_term_return)
+        g_key_file_set_string (meta, "report", "filter_term",
+                               *filter_term_return);
+      if (zone_return && *zone_return)
+        g_key_file_set_string (meta, "report", "zone", *zone_return);
+      if (host_summary && *host_summary)
+        g_key_file_set_string (meta, "report", "host_summary",
+                               *host_summary);
+      report_cache_add (cache_key, output_file, meta);
+      g_key_file_free (meta);
+    }
+  g_free (cache_key);
   g_free (output_file);
   if (get_error)
     {
@@ -29116,6 +34668,7 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
 
   /* Set convenience return parameters. */
 
+ convenience:
   if (extension || content_type)
     {
       iterator_t formats;
@@ -29161,6 +34714,112 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
  */
 #define MANAGE_SEND_REPORT_CHUNK_SIZE (MANAGE_SEND_REPORT_CHUNK64_SIZE * 3 / 4)
 
+/**
+ * @brief State of a report being streamed to the client.
+ */
+typedef struct
+{
+  gboolean (*send) (const char *, int (*) (const char *, void*), void*);
+                                 ///< Function to write to client.
+  int (*send_data_1) (const char *, void*);  ///< Second argument to send.
+  void *send_data_2;             ///< Third argument to send.
+  int base64;                    ///< Whether to base64 encode the report.
+  const gchar *prefix;           ///< Text to send before the report, or NULL.
+  char *chunk;                   ///< Buffer of MANAGE_SEND_REPORT_CHUNK_SIZE.
+  int chunk_len;                 ///< Number of bytes in chunk.
+} report_stream_t;
+
+/**
+ * @brief Send the buffered chunk of a streamed report to the client.
+ *
+ * The prefix is sent before the first chunk, so that nothing is sent if
+ * the report fails before producing output.
+ *
+ * @param[in]  stream  Report stream.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+report_stream_flush (report_stream_t *stream)
+{
+  if (stream->prefix)
+    {
+      if (stream->send (stream->prefix, stream->send_data_1,
+                        stream->send_data_2))
+        {
+          g_warning ("%s: send prefix error", __func__);
+          return -1;
+        }
+      stream->prefix = NULL;
+    }
+
+  if (stream->chunk_len == 0)
+    return 0;
+
+  if (stream->base64)
+    {
+      gchar *chunk64;
+      chunk64 = g_base64_encode ((guchar*) stream->chunk, stream->chunk_len);
+      if (stream->send (chunk64, stream->send_data_1, stream->send_data_2))
+        {
+          g_free (chunk64);
+          g_warning ("%s: send error", __func__);
+          return -1;
+        }
+      g_free (chunk64);
+    }
+  else
+    {
+      stream->chunk[stream->chunk_len] = '\0';
+      if (stream->send (stream->chunk, stream->send_data_1,
+                        stream->send_data_2))
+        {
+          g_warning ("%s: send error", __func__);
+          return -1;
+        }
+    }
+
+  stream->chunk_len = 0;
+  return 0;
+}
+
+/**
+ * @brief Write a piece of a streamed report.
+ *
+ * Buffers into whole chunks, so that each base64 chunk can be encoded on its
+ * own.
+ *
+ * @param[in]  data    Report stream.
+ * @param[in]  buffer  Output.
+ * @param[in]  len     Length of output.
+ *
+ * @return Number of bytes written, or -1 on error.
+ */
+static int
+report_stream_write (void *data, const char *buffer, int len)
+{
+  report_stream_t *stream;
+  int written;
+
+  stream = (report_stream_t *) data;
+  written = 0;
+  while (written < len)
+    {
+      int count;
+
+      count = MIN (len - written,
+                   MANAGE_SEND_REPORT_CHUNK_SIZE - stream->chunk_len);
+      memcpy (stream->chunk + stream->chunk_len, buffer + written, count);
+      stream->chunk_len += count;
+      written += count;
+
+      if (stream->chunk_len == MANAGE_SEND_REPORT_CHUNK_SIZE
+          && report_stream_flush (stream))
+        return -1;
+    }
+  return len;
+}
+
 /**
  * @brief Generate a report.
  *
@@ -29203,9 +34862,10 @@ manage_send_report (report_t report, report_t delta_report,
   char xml_dir[] = "/tmp/gvmd_XXXXXX";
   int ret;
   GList *used_rfps;
-  gchar *output_file, *report_format_id;
+  gchar *output_file, *report_format_id, *cache_key, *variant;
   char chunk[MANAGE_SEND_REPORT_CHUNK_SIZE + 1];
   FILE *stream;
+  report_stream_t report_stream;
 
   used_rfps = NULL;
 
@@ -29253,13 +34913,52 @@ manage_send_report (report_t report, report_t delta_report,
       return -1;
     }
 
+  /* Send the rendered report from the cache if there is one. */
+
+  variant = g_strdup_printf ("%i %i %i", result_tags, ignore_pagination,
+                             lean);
+  cache_key = report_cache_key (report, delta_report, get, report_format,
+                                notes_details, overrides_details, variant);
+  g_free (variant);
+  output_file = cache_key ? report_cache_lookup (cache_key, NULL) : NULL;
+  if (output_file)
+    {
+      g_free (cache_key);
+      goto send;
+    }
+
+  report_format_id = report_format_uuid (report_format);
+
+  /* Some formats are generated directly from the database. */
+
+  ret = print_report_native (report, delta_report, task, get,
+                             ignore_pagination, report_format_id, xml_dir,
+                             NULL, &output_file);
+  if (ret == 0)
+    {
+      if (cache_key)
+        report_cache_add (cache_key, output_file, NULL);
+      g_free (cache_key);
+      g_free (report_format_id);
+      goto send;
+    }
+  if (ret != 1)
+    {
+      g_free (report_format_id);
+      g_free (cache_key);
+      gvm_file_remove_recurse (xml_dir);
+      return ret == 2 ? 2 : -1;
+    }
+
   xml_start = g_strdup_printf ("%s/report-start.xml", xml_dir);
   ret = print_report_xml_start (report, delta_report, task, xml_start, get,
                                 notes_details, overrides_details, result_tags,
                                 ignore_pagination, lean, NULL, NULL, NULL);
   if (ret)
     {
+      g_free (report_format_id);
       g_free (xml_start);
+      g_free (cache_key);
       gvm_file_remove_recurse (xml_dir);
       if (ret == 2)
         return 2;
@@ -29269,7 +34968,34 @@ manage_send_report (report_t report, report_t delta_report,
   xml_file = g_strdup_printf ("%s/report.xml", xml_dir);
 
   /* Apply report format(s). */
-  report_format_id = report_format_uuid (report_format);
+
+  /* Stream the output straight to the client if possible.  Reports that
+   * can be cached go through a file instead, so that the file can be
+   * added to the cache. */
+
+  if (cache_key == NULL)
+    {
+      report_stream.send = send;
+      report_stream.send_data_1 = send_data_1;
+      report_stream.send_data_2 = send_data_2;
+      report_stream.base64 = base64;
+      report_stream.prefix = prefix;
+      report_stream.chunk = chunk;
+      report_stream.chunk_len = 0;
+
+      ret = apply_report_format_stream (report_format_id, xml_start, xml_file,
+                                        report_stream_write, &report_stream);
+      if (ret == 0)
+        ret = report_stream_flush (&report_stream);
+      if (ret != 1)
+        {
+          g_free (report_format_id);
+          g_free (xml_file);
+          g_free (xml_start);
+          gvm_file_remove_recurse (xml_dir);
+          return ret ? -1 : 0;
+        }
+    }
 
   output_file = apply_report_format (report_format_id,
                                      xml_start, xml_file, xml_dir,
@@ -29279,10 +35005,15 @@ manage_send_report (report_t report, report_t delta_report,
     {
       g_warning ("%s: No file returned for report format", __func__);
     }
+  else if (cache_key)
+    report_cache_add (cache_key, output_file, NULL);
+  g_free (cache_key);
   g_free (report_format_id);
 
   /* Send the report. */
 
+ send:
+
   /* Read the script output from file in chunks, sending to client. */
 
   stream = fopen (output_file, "r");
@@ -29430,165 +35161,603 @@ report_host_noticeable (report_t report, const gchar *host)
 }
 
 /**
- * @brief Parse an OSP report.
+ * @brief Maximum number of values per insert, when parsing an OSP report.
+ */
+#define OSP_REPORT_INSERT_SIZE 500
+
+/**
+ * @brief Buffer for a multi-row INSERT, when parsing an OSP report.
+ */
+typedef struct
+{
+  GString *statement;   ///< Statement being built.
+  gchar *open_sql;      ///< SQL up to and including VALUES.
+  int current_size;     ///< Number of values in statement.
+  int total;            ///< Number of values inserted so far.
+} osp_inserts_t;
+
+/**
+ * @brief Initialise a multi-row INSERT buffer.
  *
- * @param[in]  task        Task.
- * @param[in]  report      Report.
- * @param[in]  report_xml  Report XML.
+ * @param[in]  inserts   Insert buffer.
+ * @param[in]  open_sql  SQL up to and including VALUES.
  */
-void
-parse_osp_report (task_t task, report_t report, const char *report_xml)
+static void
+osp_inserts_init (osp_inserts_t *inserts, const gchar *open_sql)
 {
-  entity_t entity, child;
-  entities_t results;
-  const char *str;
-  char *defs_file = NULL;
-  time_t start_time, end_time;
+  inserts->statement = g_string_new ("");
+  inserts->open_sql = g_strdup (open_sql);
+  inserts->current_size = 0;
+  inserts->total = 0;
+}
 
-  assert (task);
-  assert (report);
-  assert (report_xml);
+/**
+ * @brief Run the buffered INSERT, if there are any values.
+ *
+ * @param[in]  inserts  Insert buffer.
+ */
+static void
+osp_inserts_flush (osp_inserts_t *inserts)
+{
+  if (inserts->current_size == 0)
+    return;
+
+  g_string_append (inserts->statement, ";");
+  sql ("%s", inserts->statement->str);
+  g_string_truncate (inserts->statement, 0);
+  inserts->total += inserts->current_size;
+  inserts->current_size = 0;
+}
+
+/**
+ * @brief Prepare the buffer for another value.
+ *
+ * Runs the buffered INSERT first if it is full.  The caller must append
+ * the value to inserts->statement afterwards.
+ *
+ * @param[in]  inserts  Insert buffer.
+ */
+static void
+osp_inserts_next (osp_inserts_t *inserts)
+{
+  if (inserts->current_size >= OSP_REPORT_INSERT_SIZE)
+    osp_inserts_flush (inserts);
+
+  if (inserts->current_size == 0)
+    g_string_append (inserts->statement, inserts->open_sql);
+  else
+    g_string_append (inserts->statement, ",");
+  inserts->current_size++;
+}
 
-  if (parse_entity (report_xml, &entity))
+/**
+ * @brief Free a multi-row INSERT buffer, without running it.
+ *
+ * @param[in]  inserts  Insert buffer.
+ */
+static void
+osp_inserts_free (osp_inserts_t *inserts)
+{
+  g_string_free (inserts->statement, TRUE);
+  g_free (inserts->open_sql);
+}
+
+/**
+ * @brief Buffer a host detail from an OSP report.
+ *
+ * Details that have already been buffered for the same host are skipped.
+ *
+ * @param[in]  inserts  Insert buffer.
+ * @param[in]  seen     Details seen so far.
+ * @param[in]  report   Report.
+ * @param[in]  host     Host.
+ * @param[in]  name     Detail name.
+ * @param[in]  value    Detail value.
+ */
+static void
+osp_report_buffer_detail (osp_inserts_t *inserts, GHashTable *seen,
+                          report_t report, const char *host,
+                          const char *name, const char *value)
+{
+  gchar *key, *quoted_host, *quoted_name, *quoted_value;
+
+  key = g_strdup_printf ("%s\n%s\n%s", host, name, value);
+  if (g_hash_table_contains (seen, key))
     {
-      g_warning ("Couldn't parse %s OSP scan report", report_xml);
+      g_free (key);
       return;
     }
+  g_hash_table_add (seen, key);
 
-  sql_begin_immediate ();
-  /* Set the report's start and end times. */
-  start_time = 0;
-  str = entity_attribute (entity, "start_time");
-  if (str)
+  quoted_host = sql_quote (host);
+  quoted_name = sql_quote (name);
+  quoted_value = sql_quote (value);
+  osp_inserts_next (inserts);
+  g_string_append_printf (inserts->statement,
+                          " ((SELECT id FROM report_hosts"
+                          "   WHERE report = %llu AND host = '%s'),"
+                          "  'osp', '', 'OSP Host Detail', '%s', '%s')",
+                          report, quoted_host, quoted_name, quoted_value);
+  g_free (quoted_host);
+  g_free (quoted_name);
+  g_free (quoted_value);
+}
+
+/**
+ * @brief Buffer a result from an OSP report.
+ *
+ * @param[in]  inserts      Insert buffer.
+ * @param[in]  nvts         NVTs already noticed in result_nvts.
+ * @param[in]  task         The task associated with the result.
+ * @param[in]  report       Report.
+ * @param[in]  owner        Owner of report.
+ * @param[in]  host         Target host of result.
+ * @param[in]  hostname     Hostname of the result.
+ * @param[in]  nvt          The uuid of oval definition that produced the
+ *                          result, a title for the result otherwise.
+ * @param[in]  type         Type of result.  "Alarm", etc.
+ * @param[in]  description  Description of the result.
+ * @param[in]  port         Result port.
+ * @param[in]  severity     Result severity.
+ * @param[in]  qod          Quality of detection.
+ */
+static void
+osp_report_buffer_result (osp_inserts_t *inserts, GHashTable *nvts,
+                          task_t task, report_t report, user_t owner,
+                          const char *host, const char *hostname,
+                          const char *nvt, const char *type,
+                          const char *description, const char *port,
+                          const char *severity, int qod)
+{
+  gchar *nvt_revision, *quoted_desc, *quoted_nvt, *result_severity;
+  gchar *quoted_host, *quoted_port, *quoted_hostname, *quoted_type;
+
+  result_severity = osp_result_severity (nvt, type, severity);
+  if (result_severity == NULL)
+    return;
+
+  nvt_revision = NULL;
+  if (nvt && g_str_has_prefix (nvt, "oval:"))
+    nvt_revision = ovaldef_version (nvt);
+  quoted_desc = sql_quote (description ?: "");
+  quoted_nvt = sql_quote (nvt ?: "");
+  quoted_host = sql_quote (host ?: "");
+  quoted_port = sql_quote (port ?: "");
+  quoted_hostname = sql_quote (hostname ?: "");
+  quoted_type = sql_quote (type);
+
+  if (g_hash_table_contains (nvts, quoted_nvt) == FALSE)
     {
-      start_time = atoi (str);
-      set_scan_start_time_epoch (report, start_time);
+      ingest_nvt_t *ingest_nvt;
+
+      /* NVTs noticed by earlier batches only have to go in nvts. */
+      ingest_nvt = (nvt && ingest_nvts)
+                    ? g_hash_table_lookup (ingest_nvts, nvt)
+                    : NULL;
+      if (ingest_nvt == NULL || ingest_nvt->noticed == FALSE)
+        result_nvt_notice (quoted_nvt);
+      g_hash_table_add (nvts, g_strdup (quoted_nvt));
     }
 
-  end_time = 0;
-  str = entity_attribute (entity, "end_time");
-  if (str)
+  osp_inserts_next (inserts);
+  g_string_append_printf (inserts->statement,
+                          " (make_uuid (), %llu, m_now (), %llu, '%s', '%s',"
+                          "  '%s', '%s', '%s', '%s', '%s', %d, '', '%s',"
+                          "  (SELECT id FROM result_nvts WHERE nvt = '%s'),"
+                          "  %llu)",
+                          owner, task, quoted_host, quoted_hostname,
+                          quoted_port, quoted_nvt, nvt_revision ?: "",
+                          result_severity, quoted_type, qod, quoted_desc,
+                          quoted_nvt, report);
+
+  g_free (result_severity);
+  g_free (nvt_revision);
+  g_free (quoted_desc);
+  g_free (quoted_nvt);
+  g_free (quoted_host);
+  g_free (quoted_port);
+  g_free (quoted_hostname);
+  g_free (quoted_type);
+}
+
+/**
+ * @brief Add the NVTs of newly inserted OSP results to result_nvt_reports.
+ *
+ * @param[in]  report  Report.
+ * @param[in]  nvts    Quoted NVTs of the new results.
+ */
+static void
+osp_report_add_result_nvts (report_t report, GHashTable *nvts)
+{
+  GHashTableIter iter;
+  gpointer quoted_nvt;
+  GString *list;
+
+  if (g_hash_table_size (nvts) == 0)
+    return;
+
+  list = g_string_new ("");
+  g_hash_table_iter_init (&iter, nvts);
+  while (g_hash_table_iter_next (&iter, &quoted_nvt, NULL))
+    g_string_append_printf (list, "%s'%s'",
+                            list->len ? ", " : "",
+                            (gchar *) quoted_nvt);
+
+  sql ("INSERT INTO result_nvt_reports (result_nvt, report)"
+       " SELECT id, %llu FROM result_nvts"
+       " WHERE nvt IN (%s)"
+       " AND NOT EXISTS (SELECT * FROM result_nvt_reports"
+       "                 WHERE result_nvt = result_nvts.id"
+       "                 AND report = %llu);",
+       report, list->str, report);
+  g_string_free (list, TRUE);
+}
+
+/**
+ * @brief State of the OSP report parser.
+ */
+typedef struct
+{
+  task_t task;                  ///< Task.
+  report_t report;              ///< Report.
+  user_t owner;                 ///< Owner of report.
+  time_t start_time;            ///< Scan start time.
+  time_t end_time;              ///< Scan end time.
+  char *defs_file;              ///< Definitions file of task.
+  int depth;                    ///< Depth of current element.
+  gboolean in_results;          ///< Whether inside the results element.
+  gboolean found_results;       ///< Whether the results element was seen.
+  gboolean in_result;           ///< Whether inside a result element.
+  GHashTable *attributes;       ///< Attributes of current result.
+  GString *text;                ///< Text of current result.
+  osp_inserts_t result_inserts; ///< Buffered results.
+  osp_inserts_t detail_inserts; ///< Buffered host details.
+  GHashTable *hosts;            ///< Report hosts already added.
+  GHashTable *details;          ///< Host details already buffered.
+  GHashTable *nvts;             ///< NVTs already in result_nvts.
+} osp_report_parser_t;
+
+/**
+ * @brief Add a result element of an OSP report to the report.
+ *
+ * @param[in]  parser  Parser state, with the attributes and text of the
+ *                     result.
+ */
+static void
+osp_report_handle_result (osp_report_parser_t *parser)
+{
+  const char *type, *name, *severity, *host, *hostname, *test_id, *port;
+  const char *qod, *text;
+  char *desc = NULL, *nvt_id = NULL, *severity_str = NULL;
+  report_t report;
+  int qod_int;
+
+  report = parser->report;
+  text = parser->text->str;
+  type = g_hash_table_lookup (parser->attributes, "type");
+  name = g_hash_table_lookup (parser->attributes, "name");
+  severity = g_hash_table_lookup (parser->attributes, "severity");
+  test_id = g_hash_table_lookup (parser->attributes, "test_id");
+  host = g_hash_table_lookup (parser->attributes, "host");
+  hostname = g_hash_table_lookup (parser->attributes, "hostname");
+  port = g_hash_table_lookup (parser->attributes, "port") ?: "";
+  qod = g_hash_table_lookup (parser->attributes, "qod") ?: "";
+  if (!name || !type || !severity || !test_id || !host)
+    {
+      GHashTableIter iter;
+      gpointer key, value;
+      GString *string = g_string_new ("<result");
+
+      g_hash_table_iter_init (&iter, parser->attributes);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        g_string_append_printf (string, " %s=\"%s\"",
+                                (gchar *) key, (gchar *) value);
+      g_string_append_printf (string, ">%s</result>", text);
+      g_warning ("Erroneous attribute in OSP result %s", string->str);
+      g_string_free (string, TRUE);
+      return;
+    }
+
+  /* Add report host if it doesn't exist. */
+  if (g_hash_table_contains (parser->hosts, host) == FALSE)
+    {
+      manage_report_host_add (report, host, parser->start_time,
+                              parser->end_time);
+      g_hash_table_add (parser->hosts, g_strdup (host));
+    }
+  if (!strcmp (type, "Host Detail"))
+    {
+      osp_report_buffer_detail (&parser->detail_inserts, parser->details,
+                                report, host, name, text);
+      return;
+    }
+  else if (g_str_has_prefix (test_id, "1.3.6.1.4.1.25623.1.0."))
+    {
+      nvt_id = g_strdup (test_id);
+      severity_str = nvt_severity (test_id, type);
+      desc = g_strdup (text);
+    }
+  else if (g_str_has_prefix (test_id, "oval:"))
     {
-      end_time = atoi (str);
-      set_scan_end_time_epoch (report, end_time);
+      nvt_id = ovaldef_uuid (test_id, parser->defs_file);
+      severity_str = ovaldef_severity (nvt_id);
+    }
+  else
+    {
+      nvt_id = g_strdup (name);
+      desc = g_strdup (text);
     }
 
-  /* Insert results. */
-  child = entity_child (entity, "results");
-  if (!child)
+  qod_int = atoi (qod);
+  if (qod_int <= 0 || qod_int > 100)
+    qod_int = QOD_DEFAULT;
+  if (port && strcmp (port, "general/Host_Details") == 0)
+    {
+      /* TODO: This should probably be handled by the "Host Detail"
+       *        result type with extra source info in OSP.
+       */
+      if (manage_report_host_detail (report, host, desc))
+        g_warning ("%s: Failed to add report detail for host '%s': %s",
+                  __func__,
+                  host,
+                  desc);
+    }
+  else if (host && nvt_id && desc && (strcmp (nvt_id, "HOST_START") == 0))
     {
-      g_warning ("Missing results element in OSP report %s", report_xml);
-      goto end_parse_osp_report;
+      set_scan_host_start_time_ctime (report, host, desc);
     }
-  results = child->entities;
-  defs_file = task_definitions_file (task);
-  while (results)
+  else if (host && nvt_id && desc && (strcmp (nvt_id, "HOST_END") == 0))
     {
-      result_t result;
-      const char *type, *name, *severity, *host, *hostname, *test_id, *port;
-      const char *qod;
-      char *desc = NULL, *nvt_id = NULL, *severity_str = NULL;
-      entity_t r_entity = results->data;
-      int qod_int;
+      set_scan_host_end_time_ctime (report, host, desc);
+      /* The assets are made from the results and details. */
+      osp_inserts_flush (&parser->result_inserts);
+      osp_inserts_flush (&parser->detail_inserts);
+      add_assets_from_host_in_report (report, host);
+    }
+  else
+    osp_report_buffer_result (&parser->result_inserts, parser->nvts,
+                              parser->task, report, parser->owner,
+                              host, hostname, nvt_id, type, desc,
+                              port ?: "", severity_str ?: severity,
+                              qod_int);
+  g_free (nvt_id);
+  g_free (desc);
+  g_free (severity_str);
+}
 
-      if (strcmp (entity_name (r_entity), "result"))
-        {
-          g_warning ("Erroneous entry in OSP results %s",
-                     entity_name (r_entity));
-          results = next_entities (results);
-          continue;
-        }
-      type = entity_attribute (r_entity, "type");
-      name = entity_attribute (r_entity, "name");
-      severity = entity_attribute (r_entity, "severity");
-      test_id = entity_attribute (r_entity, "test_id");
-      host = entity_attribute (r_entity, "host");
-      hostname = entity_attribute (r_entity, "hostname");
-      port = entity_attribute (r_entity, "port") ?: "";
-      qod = entity_attribute (r_entity, "qod") ?: "";
-      if (!name || !type || !severity || !test_id || !host)
-        {
-          GString *string = g_string_new ("");
-
-          print_entity_to_string (r_entity, string);
-          g_warning ("Erroneous attribute in OSP result %s", string->str);
-          g_string_free (string, TRUE);
-          results = next_entities (results);
-          continue;
-        }
+/**
+ * @brief Handle the start of an OSP report element.
+ *
+ * @param[in]  context           Parser context.
+ * @param[in]  element_name      XML element name.
+ * @param[in]  attribute_names   XML attribute names.
+ * @param[in]  attribute_values  XML attribute values.
+ * @param[in]  user_data         Parser state.
+ * @param[in]  error             Error parameter.
+ */
+static void
+osp_report_handle_start_element (/* unused */ GMarkupParseContext* context,
+                                 const gchar *element_name,
+                                 const gchar **attribute_names,
+                                 const gchar **attribute_values,
+                                 gpointer user_data,
+                                 /* unused */ GError **error)
+{
+  osp_report_parser_t *parser;
 
-      /* Add report host if it doesn't exist. */
-      manage_report_host_add (report, host, start_time, end_time);
-      if (!strcmp (type, "Host Detail"))
-        {
-          insert_report_host_detail (report, host, "osp", "", "OSP Host Detail",
-                                     name, entity_text (r_entity));
-          results = next_entities (results);
-          continue;
-        }
-      else if (g_str_has_prefix (test_id, "1.3.6.1.4.1.25623.1.0."))
-        {
-          nvt_id = g_strdup (test_id);
-          severity_str = nvt_severity (test_id, type);
-          desc = g_strdup (entity_text (r_entity));
-        }
-      else if (g_str_has_prefix (test_id, "oval:"))
-        {
-          nvt_id = ovaldef_uuid (test_id, defs_file);
-          severity_str = ovaldef_severity (nvt_id);
-        }
-      else
-        {
-          nvt_id = g_strdup (name);
-          desc = g_strdup (entity_text (r_entity));
-        }
+  parser = (osp_report_parser_t *) user_data;
+  parser->depth++;
 
-      qod_int = atoi (qod);
-      if (qod_int <= 0 || qod_int > 100)
-        qod_int = QOD_DEFAULT;
-      if (port && strcmp (port, "general/Host_Details") == 0)
-        {
-          /* TODO: This should probably be handled by the "Host Detail"
-           *        result type with extra source info in OSP.
-           */
-          if (manage_report_host_detail (report, host, desc))
-            g_warning ("%s: Failed to add report detail for host '%s': %s",
-                      __func__,
-                      host,
-                      desc);
-        }
-      else if (host && nvt_id && desc && (strcmp (nvt_id, "HOST_START") == 0))
-        {
-          set_scan_host_start_time_ctime (report, host, desc);
-        }
-      else if (host && nvt_id && desc && (strcmp (nvt_id, "HOST_END") == 0))
+  if (parser->depth == 1)
+    {
+      /* Set the report's start and end times. */
+      for (; *attribute_names; attribute_names++, attribute_values++)
+        if (strcmp (*attribute_names, "start_time") == 0)
+          {
+            parser->start_time = atoi (*attribute_values);
+            set_scan_start_time_epoch (parser->report, parser->start_time);
+          }
+        else if (strcmp (*attribute_names, "end_time") == 0)
+          {
+            parser->end_time = atoi (*attribute_values);
+            set_scan_end_time_epoch (parser->report, parser->end_time);
+          }
+    }
+  else if (parser->depth == 2 && strcmp (element_name, "results") == 0)
+    {
+      parser->in_results = TRUE;
+      parser->found_results = TRUE;
+    }
+  else if (parser->depth == 3 && parser->in_results)
+    {
+      if (strcmp (element_name, "result"))
         {
-          set_scan_host_end_time_ctime (report, host, desc);
-          add_assets_from_host_in_report (report, host);
+          g_warning ("Erroneous entry in OSP results %s", element_name);
+          return;
         }
-      else
-        {
-          result = make_osp_result (task,
-                                    host,
-                                    hostname,
-                                    nvt_id,
-                                    type,
-                                    desc,
-                                    port ?: "",
-                                    severity_str ?: severity,
-                                    qod_int);
-          report_add_result (report, result);
-        }
-      g_free (nvt_id);
-      g_free (desc);
-      g_free (severity_str);
-      results = next_entities (results);
+      parser->in_result = TRUE;
+      g_hash_table_remove_all (parser->attributes);
+      g_string_truncate (parser->text, 0);
+      for (; *attribute_names; attribute_names++, attribute_values++)
+        g_hash_table_insert (parser->attributes,
+                             g_strdup (*attribute_names),
+                             g_strdup (*attribute_values));
+    }
+}
+
+/**
+ * @brief Handle the end of an OSP report element.
+ *
+ * @param[in]  context           Parser context.
+ * @param[in]  element_name      XML element name.
+ * @param[in]  user_data         Parser state.
+ * @param[in]  error             Error parameter.
+ */
+static void
+osp_report_handle_end_element (/* unused */ GMarkupParseContext* context,
+                               /* unused */ const gchar *element_name,
+                               gpointer user_data,
+                               /* unused */ GError **error)
+{
+  osp_report_parser_t *parser;
+
+  parser = (osp_report_parser_t *) user_data;
+
+  if (parser->depth == 3 && parser->in_result)
+    {
+      osp_report_handle_result (parser);
+      parser->in_result = FALSE;
+    }
+  else if (parser->depth == 2)
+    parser->in_results = FALSE;
+
+  parser->depth--;
+}
+
+/**
+ * @brief Handle the text of an OSP report element.
+ *
+ * @param[in]  context           Parser context.
+ * @param[in]  text              The text.
+ * @param[in]  text_len          Length of the text.
+ * @param[in]  user_data         Parser state.
+ * @param[in]  error             Error parameter.
+ */
+static void
+osp_report_handle_text (/* unused */ GMarkupParseContext* context,
+                        const gchar *text,
+                        gsize text_len,
+                        gpointer user_data,
+                        /* unused */ GError **error)
+{
+  osp_report_parser_t *parser;
+
+  parser = (osp_report_parser_t *) user_data;
+
+  /* Only the text directly inside the result, like entity_text. */
+  if (parser->depth == 3 && parser->in_result)
+    g_string_append_len (parser->text, text, text_len);
+}
+
+/**
+ * @brief Parse an OSP report.
+ *
+ * The report XML is parsed as a stream of elements.  Each result is added
+ * as soon as its end tag is parsed, so memory use does not grow with the
+ * size of the report.
+ *
+ * Results and host details are buffered and written with multi-row
+ * INSERTs, instead of one statement per OSP result.  The report XML may
+ * hold only the results popped since the previous poll, so the work done
+ * here is kept proportional to the results in report_xml.
+ *
+ * @param[in]  task        Task.
+ * @param[in]  report      Report.
+ * @param[in]  report_xml  Report XML.
+ */
+void
+parse_osp_report (task_t task, report_t report, const char *report_xml)
+{
+  GMarkupParser xml_parser;
+  GMarkupParseContext *xml_context;
+  GError *error;
+  osp_report_parser_t parser;
+  struct timeval start, now;
+  long elapsed;
+  result_t counted_result;
+
+  assert (task);
+  assert (report);
+  assert (report_xml);
+
+  gettimeofday (&start, NULL);
+
+  memset (&parser, 0, sizeof (parser));
+  parser.task = task;
+  parser.report = report;
+  parser.attributes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, g_free);
+  parser.text = g_string_new ("");
+  osp_inserts_init (&parser.result_inserts,
+                    "INSERT INTO results"
+                    " (uuid, owner, date, task, host, hostname, port, nvt,"
+                    "  nvt_version, severity, type, qod, qod_type,"
+                    "  description, result_nvt, report)"
+                    " VALUES");
+  osp_inserts_init (&parser.detail_inserts,
+                    "INSERT INTO report_host_details"
+                    " (report_host, source_type, source_name,"
+                    "  source_description, name, value)"
+                    " VALUES");
+  parser.hosts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                        NULL);
+  parser.details = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          NULL);
+  parser.nvts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       NULL);
+
+  memset (&xml_parser, 0, sizeof (xml_parser));
+  xml_parser.start_element = osp_report_handle_start_element;
+  xml_parser.end_element = osp_report_handle_end_element;
+  xml_parser.text = osp_report_handle_text;
+  xml_context = g_markup_parse_context_new (&xml_parser, 0, &parser, NULL);
+
+  /* So that the results need no NVT lookups. */
+  ingest_nvts_refresh ();
+
+  sql_begin_immediate ();
+  sql_int64 (&parser.owner, "SELECT owner FROM reports WHERE id = %llu;",
+             report);
+  counted_result = report_max_result (report);
+  parser.defs_file = task_definitions_file (task);
+
+  error = NULL;
+  if (g_markup_parse_context_parse (xml_context, report_xml, -1, &error)
+      == FALSE
+      || g_markup_parse_context_end_parse (xml_context, &error) == FALSE)
+    {
+      g_warning ("Couldn't parse %s OSP scan report: %s",
+                 report_xml, error ? error->message : "");
+      g_clear_error (&error);
+      sql_rollback ();
+      goto free_parse_osp_report;
     }
 
- end_parse_osp_report:
+  if (parser.found_results == FALSE)
+    g_warning ("Missing results element in OSP report %s", report_xml);
+
+  osp_inserts_flush (&parser.result_inserts);
+  osp_inserts_flush (&parser.detail_inserts);
+  if (parser.result_inserts.total)
+    {
+      osp_report_add_result_nvts (report, parser.nvts);
+      /* Only count the new results, so that the cost here depends only on
+       * the results in this report XML, which may be one of many polls. */
+      report_counts_add_results (report, counted_result);
+    }
   sql_commit ();
-  g_free (defs_file);
-  free_entity (entity);
+  ingest_nvts_notice (parser.nvts);
+
+  gettimeofday (&now, NULL);
+  elapsed = TIMEVAL_SUBTRACT_MS (now, start);
+  g_info ("%s: Added %i results and %i host details to report %llu"
+          " in %ld ms (%.0f results/s)",
+          __func__, parser.result_inserts.total,
+          parser.detail_inserts.total, report, elapsed,
+          elapsed > 0
+           ? parser.result_inserts.total * 1000.0 / elapsed
+           : 0.0);
+
+ free_parse_osp_report:
+  g_markup_parse_context_free (xml_context);
+  osp_inserts_free (&parser.result_inserts);
+  osp_inserts_free (&parser.detail_inserts);
+  g_hash_table_destroy (parser.attributes);
+  g_string_free (parser.text, TRUE);
+  g_hash_table_destroy (parser.hosts);
+  g_hash_table_destroy (parser.details);
+  g_hash_table_destroy (parser.nvts);
+  g_free (parser.defs_file);
 }
 
 
@@ -29935,11 +36104,15 @@ delete_task_lock (task_t task, int ultimate)
 
   /* This prevents other processes (for example a START_TASK) from getting
    * a reference to a report ID or the task ID, and then using that
-   * reference to try access the deleted report or task.
+   * reference to try access the deleted report or task.  Starting a task
+   * locks the row of the task, so locking the rows of this task is enough
+   * for starts.  Adding results to a report does not lock the report row,
+   * but only happens while the report is active (Running or Requested),
+   * and delete_report_internal refuses to delete an active report.
    *
    * If the task is already active then delete_report (via delete_task)
    * will fail and rollback. */
-  if (sql_error ("LOCK table reports IN ACCESS EXCLUSIVE MODE;"))
+  if (lock_task_and_reports (task))
     {
       sql_rollback ();
       return -1;
@@ -30085,6 +36258,7 @@ request_delete_task_uuid (const char *task_id, int ultimate)
       sql ("DELETE FROM task_alerts WHERE task = %llu;", task);
       sql ("DELETE FROM task_files WHERE task = %llu;", task);
       sql ("DELETE FROM task_preferences WHERE task = %llu;", task);
+      sql ("DELETE FROM task_summaries WHERE task = %llu;", task);
       sql ("DELETE FROM tasks WHERE id = %llu;", task);
       sql_commit ();
       return 0;
@@ -30109,7 +36283,7 @@ request_delete_task_uuid (const char *task_id, int ultimate)
              *
              * If the task is running already then delete_task will lead to
              * ROLLBACK. */
-            sql ("LOCK table reports IN ACCESS EXCLUSIVE MODE;");
+            lock_task_and_reports (task);
 
           ret = delete_task (task, ultimate);
           if (ret)
@@ -30186,6 +36360,7 @@ delete_task (task_t task, int ultimate)
       sql ("DELETE FROM task_alerts WHERE task = %llu;", task);
       sql ("DELETE FROM task_files WHERE task = %llu;", task);
       sql ("DELETE FROM task_preferences WHERE task = %llu;", task);
+      sql ("DELETE FROM task_summaries WHERE task = %llu;", task);
       sql ("DELETE FROM tasks WHERE id = %llu;", task);
     }
   else
@@ -30222,10 +36397,10 @@ delete_task (task_t task, int ultimate)
       sql ("INSERT INTO results_trash"
            " (uuid, task, host, port, nvt, result_nvt, type, description,"
            "  report, nvt_version, severity, qod, qod_type, owner, date,"
-           "  hostname)"
+           "  hostname, fingerprint)"
            " SELECT uuid, task, host, port, nvt, result_nvt, type,"
            "        description, report, nvt_version, severity, qod,"
-           "         qod_type, owner, date, hostname"
+           "         qod_type, owner, date, hostname, fingerprint"
            " FROM results"
            " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
            task);
@@ -30240,6 +36415,10 @@ delete_task (task_t task, int ultimate)
            " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
            task);
 
+      sql ("DELETE FROM result_severities"
+           " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
+           task);
+
       sql ("UPDATE tasks SET hidden = 2 WHERE id = %llu;", task);
     }
 
@@ -30279,6 +36458,7 @@ delete_trash_tasks ()
       sql ("DELETE FROM task_alerts WHERE task = %llu;", task);
       sql ("DELETE FROM task_files WHERE task = %llu;", task);
       sql ("DELETE FROM task_preferences WHERE task = %llu;", task);
+      sql ("DELETE FROM task_summaries WHERE task = %llu;", task);
       sql ("DELETE FROM tasks WHERE id = %llu;", task);
     }
   cleanup_iterator (&tasks);
@@ -31279,6 +37459,74 @@ target_login_port (target_t target, const char* type)
   return port;
 }
 
+/**
+ * @brief Store the number of hosts in a target.
+ *
+ * The count is keyed on the hosts and exclude hosts of the target, so it
+ * is ignored after any change to the hosts that does not update it.
+ *
+ * @param[in]  target     Target.
+ * @param[in]  max_hosts  Number of hosts in the target.
+ */
+static void
+target_max_hosts_set (target_t target, int max_hosts)
+{
+  sql ("INSERT INTO target_host_counts (target, key, max_hosts)"
+       " SELECT id, " TARGET_HOSTS_KEY ("hosts", "exclude_hosts") ", %i"
+       " FROM targets WHERE id = %llu"
+       " ON CONFLICT (target) DO UPDATE"
+       " SET key = EXCLUDED.key, max_hosts = EXCLUDED.max_hosts;",
+       max_hosts,
+       target);
+}
+
+/**
+ * @brief Return the number of hosts in a target.
+ *
+ * Uses the stored count when it is current, so that the target hosts
+ * only have to be expanded after they change.
+ *
+ * @param[in]  target  Target.
+ *
+ * @return Number of hosts, or -1 on error.
+ */
+int
+target_max_hosts (target_t target)
+{
+  long long int max;
+  char *hosts, *exclude_hosts;
+
+  switch (sql_int64 (&max,
+                     "SELECT max_hosts FROM target_host_counts"
+                     " WHERE target = %llu"
+                     " AND key = (SELECT "
+                     TARGET_HOSTS_KEY ("hosts", "exclude_hosts")
+                     "            FROM targets WHERE id = %llu);",
+                     target,
+                     target))
+    {
+      case 0:
+        return max;
+      case 1:         /* Too few rows in result of query. */
+        break;
+      default:        /* Programming error. */
+        assert (0);
+      case -1:
+        return -1;
+    }
+
+  hosts = target_hosts (target);
+  if (hosts == NULL)
+    return 0;
+  exclude_hosts = target_exclude_hosts (target);
+  max = manage_count_hosts_max (hosts, exclude_hosts, 0);
+  free (hosts);
+  free (exclude_hosts);
+
+  target_max_hosts_set (target, max);
+  return max;
+}
+
 /**
  * @brief Create a target.
  *
@@ -31477,6 +37725,8 @@ create_target (const char* name, const char* asset_hosts_filter,
   if (target)
     *target = new_target;
 
+  target_max_hosts_set (new_target, max);
+
   g_free (quoted_comment);
   g_free (quoted_name);
   g_free (quoted_hosts);
@@ -32126,6 +38376,8 @@ modify_target (const char *target_id, const char *name, const char *hosts,
            quoted_exclude_hosts,
            target);
 
+      target_max_hosts_set (target, max);
+
       g_free (quoted_hosts);
       g_free (quoted_exclude_hosts);
     }
@@ -32252,7 +38504,11 @@ modify_target (const char *target_id, const char *name, const char *hosts,
      KEYWORD_TYPE_STRING                                    \
    },                                                       \
    { "hosts", NULL, KEYWORD_TYPE_STRING },                  \
-   { "max_hosts (hosts, exclude_hosts)",                    \
+   { "coalesce ((SELECT max_hosts FROM target_host_counts"  \
+     "           WHERE target = targets.id"                 \
+     "           AND key = "                                \
+     TARGET_HOSTS_KEY ("hosts", "exclude_hosts") "),"       \
+     "          max_hosts (hosts, exclude_hosts))",         \
      "ips",                                                 \
      KEYWORD_TYPE_INTEGER },                                \
    { NULL, NULL, KEYWORD_TYPE_UNKNOWN }                     \
@@ -32906,6 +39162,33 @@ target_esxi_credential (target_t target)
   return target_credential (target, "esxi");
 }
 
+/**
+ * @brief Decrypt all the credentials of a target into the decryption session.
+ *
+ * Does nothing if no session has been started with lsc_crypt_session_start.
+ *
+ * @param[in]  target  Target.
+ */
+void
+target_decrypt_credentials (target_t target)
+{
+  iterator_t secrets;
+
+  if (disable_encrypted_credentials)
+    return;
+
+  init_iterator (&secrets,
+                 "SELECT DISTINCT value FROM credentials_data"
+                 " WHERE type = 'secret'"
+                 " AND credential IN (SELECT credential"
+                 "                    FROM targets_login_data"
+                 "                    WHERE target = %llu);",
+                 target);
+  while (next (&secrets))
+    lsc_crypt_session_add (iterator_string (&secrets, 0));
+  cleanup_iterator (&secrets);
+}
+
 /**
  * @brief Return the port list associated with a target, if any.
  *
@@ -32943,6 +39226,8 @@ target_port_list (target_t target)
  *
  * For "OpenVAS Default", return the explicit port ranges instead of "default".
  *
+ * Uses the merged range that is stored on the port list.
+ *
  * @param[in]  target  Target.
  *
  * @return Newly allocated port range if available, else NULL.
@@ -32950,51 +39235,7 @@ target_port_list (target_t target)
 char*
 target_port_range (target_t target)
 {
-  GString *range;
-  iterator_t ranges;
-  range = g_string_new ("");
-  init_port_range_iterator (&ranges, target_port_list (target), 0, 1,
-                            "type, CAST (start AS INTEGER)");
-  if (next (&ranges))
-    {
-      const char *start, *end;
-      int type;
-
-      start = port_range_iterator_start (&ranges);
-      end = port_range_iterator_end (&ranges);
-      type = port_range_iterator_type_int (&ranges);
-
-      /* Scanner can only handle: T:1-3,5-6,9,U:1-2 */
-
-      if (end && strcmp (end, "0") && strcmp (end, start))
-        g_string_append_printf (range, "%s%s-%s",
-                                (type == PORT_PROTOCOL_UDP ? "U:" : "T:"),
-                                start, end);
-      else
-        g_string_append_printf (range, "%s%s",
-                                (type == PORT_PROTOCOL_UDP ? "U:" : "T:"),
-                                start);
-      while (next (&ranges))
-        {
-          int tcp;
-
-          start = port_range_iterator_start (&ranges);
-          end = port_range_iterator_end (&ranges);
-          tcp = (type == PORT_PROTOCOL_TCP);
-          type = port_range_iterator_type_int (&ranges);
-
-          if (end && strcmp (end, "0") && strcmp (end, start))
-            g_string_append_printf (range, ",%s%s-%s",
-                                    (tcp && type == PORT_PROTOCOL_UDP ? "U:" : ""),
-                                    start, end);
-          else
-            g_string_append_printf (range, ",%s%s",
-                                    (tcp && type == PORT_PROTOCOL_UDP ? "U:" : ""),
-                                    start);
-        }
-    }
-  cleanup_iterator (&ranges);
-  return g_string_free (range, FALSE);
+  return port_list_port_range (target_port_list (target));
 }
 
 /**
@@ -33146,73 +39387,215 @@ target_task_iterator_readable (iterator_t* iterator)
 /* FIX From old NVTs section. */
 
 /**
- * @brief Check for new SCAP SecInfo after an update.
+ * @brief Kind of SecInfo change: a new resource.
  */
-static void
-check_for_new_scap ()
+#define SECINFO_CHANGE_NEW 0
+
+/**
+ * @brief Kind of SecInfo change: an updated resource.
+ */
+#define SECINFO_CHANGE_UPDATED 1
+
+/**
+ * @brief Get the table of a SecInfo type that has a change log.
+ *
+ * @param[in]  type  SecInfo type.
+ *
+ * @return Table, or NULL if the type has no change log.
+ */
+static const char *
+secinfo_changes_table (const char *type)
+{
+  if (strcmp (type, "cve") == 0)
+    return "scap.cves";
+  if (strcmp (type, "cpe") == 0)
+    return "scap.cpes";
+  if (strcmp (type, "ovaldef") == 0)
+    return "scap.ovaldefs";
+  if (strcmp (type, "cert_bund_adv") == 0)
+    return "cert.cert_bund_advs";
+  if (strcmp (type, "dfn_cert_adv") == 0)
+    return "cert.dfn_cert_advs";
+  return NULL;
+}
+
+/**
+ * @brief Get the newest time of a SecInfo type, before a sync changes it.
+ *
+ * @param[in]  type  SecInfo type.
+ *
+ * @return Newest creation or modification time, 0 if there are no rows.
+ */
+int
+secinfo_changes_mark (const char *type)
 {
-  if (manage_scap_loaded ())
-    {
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM cves"
-                   "  WHERE creation_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'scap_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0));"))
-        event (EVENT_NEW_SECINFO, "cve", 0, 0);
-
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM cpes"
-                   "  WHERE creation_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'scap_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0));"))
-        event (EVENT_NEW_SECINFO, "cpe", 0, 0);
-
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM ovaldefs"
-                   "  WHERE creation_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'scap_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0));"))
-        event (EVENT_NEW_SECINFO, "ovaldef", 0, 0);
-    }
-}
-
-/**
- * @brief Check for new CERT SecInfo after an update.
+  const char *table;
+
+  table = secinfo_changes_table (type);
+  assert (table);
+  return sql_int ("SELECT coalesce (%s (max (creation_time),"
+                  "                     max (modification_time)),"
+                  "                 0)"
+                  " FROM %s;",
+                  sql_greatest (),
+                  table);
+}
+
+/**
+ * @brief Start a new generation of SecInfo changes.
+ *
+ * @return Generation.
+ */
+int
+secinfo_changes_generation ()
+{
+  return sql_int ("SELECT nextval ('secinfo_change_generations');");
+}
+
+/**
+ * @brief Record the SecInfo of a type that a sync added or updated.
+ *
+ * Nothing is recorded when the type had no rows before the sync, because
+ * then everything is new and the first load is not alerted on anyway.
+ *
+ * @param[in]  type        SecInfo type.
+ * @param[in]  mark        Mark from secinfo_changes_mark before the sync.
+ * @param[in]  generation  Generation from secinfo_changes_generation.
+ */
+void
+secinfo_changes_record (const char *type, int mark, int generation)
+{
+  const char *table;
+
+  if (mark == 0)
+    return;
+
+  table = secinfo_changes_table (type);
+  assert (table);
+  sql ("INSERT INTO secinfo_changes (generation, type, resource, kind)"
+       " SELECT %i, '%s', id,"
+       "        CASE WHEN creation_time > %i THEN %i ELSE %i END"
+       " FROM %s"
+       " WHERE creation_time > %i OR modification_time > %i;",
+       generation,
+       type,
+       mark,
+       SECINFO_CHANGE_NEW,
+       SECINFO_CHANGE_UPDATED,
+       table,
+       mark,
+       mark);
+}
+
+/**
+ * @brief Get a clause that selects the changes of the last SecInfo check.
+ *
+ * The changes are those after the generation in secinfo_check_first, up to
+ * and including the one in secinfo_check_last.  Alerts from the queue read
+ * the same changes as the check that produced their events.
+ *
+ * @param[in]  type   SecInfo type.
+ * @param[in]  event  EVENT_NEW_SECINFO or EVENT_UPDATED_SECINFO.
+ *
+ * @return Freshly allocated clause for the id of the resource.
+ */
+static gchar *
+secinfo_changes_clause (const char *type, event_t event)
+{
+  return g_strdup_printf
+          ("id IN (SELECT resource FROM secinfo_changes"
+           "       WHERE type = '%s'"
+           "       AND kind = %i"
+           "       AND generation"
+           "           > coalesce ((SELECT CAST (value AS integer)"
+           "                        FROM meta"
+           "                        WHERE name = 'secinfo_check_first'),"
+           "                       0)"
+           "       AND generation"
+           "           <= coalesce ((SELECT CAST (value AS integer)"
+           "                         FROM meta"
+           "                         WHERE name = 'secinfo_check_last'),"
+           "                        0))",
+           type,
+           event == EVENT_NEW_SECINFO
+            ? SECINFO_CHANGE_NEW
+            : SECINFO_CHANGE_UPDATED);
+}
+
+/**
+ * @brief Produce the events for the SecInfo changes since the last check.
+ *
+ * Reads the change log that the syncs write, so the cost depends on the
+ * number of changes instead of on the size of the SecInfo tables.
  */
 static void
-check_for_new_cert ()
+check_for_secinfo_changes ()
 {
-  if (manage_cert_loaded ())
+  iterator_t changes;
+  int last, current;
+
+  last = sql_int ("SELECT coalesce ((SELECT CAST (value AS integer)"
+                  "                  FROM meta"
+                  "                  WHERE name = 'secinfo_check_last'),"
+                  "                 -1);");
+  current = sql_int ("SELECT coalesce (max (generation), 0)"
+                     " FROM secinfo_changes;");
+
+  if (last == -1)
     {
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM cert_bund_advs"
-                   "  WHERE creation_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'cert_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0));"))
-        event (EVENT_NEW_SECINFO, "cert_bund_adv", 0, 0);
+      /* First check, so only note where the log is. */
+      sql ("INSERT INTO meta (name, value)"
+           " VALUES ('secinfo_check_last', '%i')"
+           " ON CONFLICT (name) DO UPDATE SET value = EXCLUDED.value;",
+           current);
+      return;
+    }
 
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM dfn_cert_advs"
-                   "  WHERE creation_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'cert_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0));"))
-        event (EVENT_NEW_SECINFO, "dfn_cert_adv", 0, 0);
+  if (current <= last)
+    return;
+
+  /* Move the range before producing events, because the lists of the
+   * alerts read the changes in the range. */
+
+  sql ("INSERT INTO meta (name, value)"
+       " VALUES ('secinfo_check_first', '%i')"
+       " ON CONFLICT (name) DO UPDATE SET value = EXCLUDED.value;",
+       last);
+  sql ("UPDATE meta SET value = '%i' WHERE name = 'secinfo_check_last';",
+       current);
+
+  init_iterator (&changes,
+                 "SELECT DISTINCT type, kind FROM secinfo_changes"
+                 " WHERE generation > %i AND generation <= %i"
+                 " ORDER BY type, kind;",
+                 last,
+                 current);
+  while (next (&changes))
+    {
+      const char *type;
+
+      type = iterator_string (&changes, 0);
+      if (manage_scap_loaded () == 0
+          && (strcmp (type, "cve") == 0
+              || strcmp (type, "cpe") == 0
+              || strcmp (type, "ovaldef") == 0))
+        continue;
+      if (manage_cert_loaded () == 0
+          && (strcmp (type, "cert_bund_adv") == 0
+              || strcmp (type, "dfn_cert_adv") == 0))
+        continue;
+
+      event (iterator_int (&changes, 1) == SECINFO_CHANGE_NEW
+              ? EVENT_NEW_SECINFO
+              : EVENT_UPDATED_SECINFO,
+             (void *) type,
+             0,
+             0);
     }
+  cleanup_iterator (&changes);
+
+  /* Keep the range of this check for alerts that are still queued. */
+  sql ("DELETE FROM secinfo_changes WHERE generation <= %i;", last);
 }
 
 /**
@@ -33386,32 +39769,21 @@ new_cves_list (event_t event, const void* event_data, alert_t alert,
     init_iterator (&rows,
                    "SELECT uuid, name, cvss, description FROM cves"
                    " LIMIT 4;");
-  else if (event == EVENT_NEW_SECINFO)
-    init_iterator (&rows,
-                   "SELECT uuid, name, cvss, description FROM cves"
-                   " WHERE creation_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " ORDER BY creation_time DESC;");
   else
-    init_iterator (&rows,
-                   "SELECT uuid, name, cvss, description FROM cves"
-                   " WHERE modification_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " AND creation_time"
-                   "     <= coalesce (CAST ((SELECT value FROM meta"
-                   "                         WHERE name"
-                   "                               = 'scap_check_time')"
-                   "                        AS INTEGER),"
-                   "                  0)"
-                   " ORDER BY modification_time DESC;");
+    {
+      gchar *clause;
+
+      clause = secinfo_changes_clause (type, event);
+      init_iterator (&rows,
+                     "SELECT uuid, name, cvss, description FROM cves"
+                     " WHERE %s"
+                     " ORDER BY %s DESC;",
+                     clause,
+                     event == EVENT_NEW_SECINFO
+                      ? "creation_time"
+                      : "modification_time");
+      g_free (clause);
+    }
 
   while (next (&rows))
     {
@@ -33477,32 +39849,21 @@ new_cpes_list (event_t event, const void* event_data, alert_t alert,
     init_iterator (&rows,
                    "SELECT uuid, name, title FROM cpes"
                    " LIMIT 4;");
-  else if (event == EVENT_NEW_SECINFO)
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM cpes"
-                   " WHERE creation_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " ORDER BY creation_time DESC;");
   else
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM cpes"
-                   " WHERE modification_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " AND creation_time"
-                   "     <= coalesce (CAST ((SELECT value FROM meta"
-                   "                         WHERE name"
-                   "                               = 'scap_check_time')"
-                   "                        AS INTEGER),"
-                   "                  0)"
-                   " ORDER BY modification_time DESC;");
+    {
+      gchar *clause;
+
+      clause = secinfo_changes_clause (type, event);
+      init_iterator (&rows,
+                     "SELECT uuid, name, title FROM cpes"
+                     " WHERE %s"
+                     " ORDER BY %s DESC;",
+                     clause,
+                     event == EVENT_NEW_SECINFO
+                      ? "creation_time"
+                      : "modification_time");
+      g_free (clause);
+    }
 
   while (next (&rows))
     {
@@ -33567,32 +39928,21 @@ new_cert_bunds_list (event_t event, const void* event_data, alert_t alert,
     init_iterator (&rows,
                    "SELECT uuid, name, title FROM cert_bund_advs"
                    " LIMIT 4;");
-  else if (event == EVENT_NEW_SECINFO)
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM cert_bund_advs"
-                   " WHERE creation_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'cert_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " ORDER BY creation_time DESC;");
   else
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM cert_bund_advs"
-                   " WHERE modification_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'cert_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " AND creation_time"
-                   "     <= coalesce (CAST ((SELECT value FROM meta"
-                   "                         WHERE name"
-                   "                               = 'cert_check_time')"
-                   "                        AS INTEGER),"
-                   "                  0)"
-                   " ORDER BY modification_time DESC;");
+    {
+      gchar *clause;
+
+      clause = secinfo_changes_clause (type, event);
+      init_iterator (&rows,
+                     "SELECT uuid, name, title FROM cert_bund_advs"
+                     " WHERE %s"
+                     " ORDER BY %s DESC;",
+                     clause,
+                     event == EVENT_NEW_SECINFO
+                      ? "creation_time"
+                      : "modification_time");
+      g_free (clause);
+    }
 
   while (next (&rows))
     {
@@ -33654,32 +40004,21 @@ new_dfn_certs_list (event_t event, const void* event_data, alert_t alert,
     init_iterator (&rows,
                    "SELECT uuid, name, title FROM dfn_cert_advs"
                    " LIMIT 4;");
-  else if (event == EVENT_NEW_SECINFO)
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM dfn_cert_advs"
-                   " WHERE creation_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'cert_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " ORDER BY creation_time DESC;");
   else
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM dfn_cert_advs"
-                   " WHERE modification_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'cert_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " AND creation_time"
-                   "     <= coalesce (CAST ((SELECT value FROM meta"
-                   "                         WHERE name"
-                   "                               = 'cert_check_time')"
-                   "                        AS INTEGER),"
-                   "                  0)"
-                   " ORDER BY modification_time DESC;");
+    {
+      gchar *clause;
+
+      clause = secinfo_changes_clause (type, event);
+      init_iterator (&rows,
+                     "SELECT uuid, name, title FROM dfn_cert_advs"
+                     " WHERE %s"
+                     " ORDER BY %s DESC;",
+                     clause,
+                     event == EVENT_NEW_SECINFO
+                      ? "creation_time"
+                      : "modification_time");
+      g_free (clause);
+    }
 
   while (next (&rows))
     {
@@ -33741,32 +40080,21 @@ new_oval_defs_list (event_t event, const void* event_data, alert_t alert,
     init_iterator (&rows,
                    "SELECT uuid, name, title FROM ovaldefs"
                    " LIMIT 4;");
-  else if (event == EVENT_NEW_SECINFO)
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM ovaldefs"
-                   " WHERE creation_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " ORDER BY creation_time DESC;");
   else
-    init_iterator (&rows,
-                   "SELECT uuid, name, title FROM ovaldefs"
-                   " WHERE modification_time"
-                   "       > coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0)"
-                   " AND creation_time"
-                   "     <= coalesce (CAST ((SELECT value FROM meta"
-                   "                         WHERE name"
-                   "                               = 'scap_check_time')"
-                   "                        AS INTEGER),"
-                   "                  0)"
-                   " ORDER BY modification_time DESC;");
+    {
+      gchar *clause;
+
+      clause = secinfo_changes_clause (type, event);
+      init_iterator (&rows,
+                     "SELECT uuid, name, title FROM ovaldefs"
+                     " WHERE %s"
+                     " ORDER BY %s DESC;",
+                     clause,
+                     event == EVENT_NEW_SECINFO
+                      ? "creation_time"
+                      : "modification_time");
+      g_free (clause);
+    }
 
   while (next (&rows))
     {
@@ -33905,106 +40233,6 @@ new_secinfo_message (event_t event, const void* event_data, alert_t alert)
   return message;
 }
 
-/**
- * @brief Check for updated SCAP SecInfo after an update.
- */
-static void
-check_for_updated_scap ()
-{
-  if (manage_scap_loaded ())
-    {
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM cves"
-                   "  WHERE modification_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'scap_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0)"
-                   "  AND creation_time"
-                   "      <= coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0));"))
-        event (EVENT_UPDATED_SECINFO, "cve", 0, 0);
-
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM cpes"
-                   "  WHERE modification_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'scap_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0)"
-                   "  AND creation_time"
-                   "      <= coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0));"))
-        event (EVENT_UPDATED_SECINFO, "cpe", 0, 0);
-
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM ovaldefs"
-                   "  WHERE modification_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'scap_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0)"
-                   "  AND creation_time"
-                   "      <= coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'scap_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0));"))
-        event (EVENT_UPDATED_SECINFO, "ovaldef", 0, 0);
-    }
-}
-
-/**
- * @brief Check for updated CERT SecInfo after an update.
- */
-static void
-check_for_updated_cert ()
-{
-  if (manage_cert_loaded ())
-    {
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM cert_bund_advs"
-                   "  WHERE modification_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'cert_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0)"
-                   "  AND creation_time"
-                   "      <= coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'cert_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0));"))
-        event (EVENT_UPDATED_SECINFO, "cert_bund_adv", 0, 0);
-
-      if (sql_int ("SELECT EXISTS"
-                   " (SELECT * FROM dfn_cert_advs"
-                   "  WHERE modification_time"
-                   "        > coalesce (CAST ((SELECT value FROM meta"
-                   "                           WHERE name"
-                   "                                 = 'cert_check_time')"
-                   "                          AS INTEGER),"
-                   "                    0)"
-                   "  AND creation_time"
-                   "      <= coalesce (CAST ((SELECT value FROM meta"
-                   "                          WHERE name"
-                   "                                = 'cert_check_time')"
-                   "                         AS INTEGER),"
-                   "                   0));"))
-        event (EVENT_UPDATED_SECINFO, "dfn_cert_adv", 0, 0);
-    }
-}
-
 
 /* Credentials. */
 
@@ -35010,6 +41238,9 @@ modify_credential (const char *credential_id,
 
   sql_commit ();
 
+  /* Packages built from the old key material are stale. */
+  lsc_user_packages_remove (credential_id);
+
   return 0;
 }
 
@@ -35077,6 +41308,7 @@ delete_credential (const char *credential_id, int ultimate)
            credential);
       sql ("DELETE FROM credentials_trash WHERE id = %llu;", credential);
       sql_commit ();
+      lsc_user_packages_remove (credential_id);
       return 0;
     }
 
@@ -35142,6 +41374,7 @@ delete_credential (const char *credential_id, int ultimate)
   sql ("DELETE FROM credentials WHERE id = %llu;", credential);
 
   sql_commit ();
+  lsc_user_packages_remove (credential_id);
   return 0;
 }
 
@@ -35956,7 +42189,8 @@ credential_iterator_rpm (iterator_t *iterator)
       g_free (public_key);
       return NULL;
     }
-  else if (lsc_user_rpm_recreate (login, public_key, &rpm, &rpm_size))
+  else if (lsc_user_rpm_cached (get_iterator_uuid (iterator), login,
+                                public_key, &rpm, &rpm_size))
     {
       g_warning ("%s: Failed to create RPM", __func__);
       g_free (public_key);
@@ -36003,9 +42237,9 @@ credential_iterator_deb (iterator_t *iterator)
       free (maintainer);
       return NULL;
     }
-  else if (lsc_user_deb_recreate (login, public_key,
-                                  maintainer ? maintainer : "",
-                                  &deb, &deb_size))
+  else if (lsc_user_deb_cached (get_iterator_uuid (iterator), login,
+                                public_key, maintainer ? maintainer : "",
+                                &deb, &deb_size))
     {
       g_warning ("%s: Failed to create DEB", __func__);
       g_free (public_key);
@@ -36044,7 +42278,8 @@ credential_iterator_exe (iterator_t *iterator)
   if (credential_iterator_format_available
           (iterator, CREDENTIAL_FORMAT_EXE) == FALSE)
     return NULL;
-  else if (lsc_user_exe_recreate (login, password, &exe, &exe_size))
+  else if (lsc_user_exe_cached (get_iterator_uuid (iterator), login,
+                                password, &exe, &exe_size))
     {
       g_warning ("%s: Failed to create EXE", __func__);
       return NULL;
@@ -36056,6 +42291,95 @@ credential_iterator_exe (iterator_t *iterator)
   return exe64;
 }
 
+/**
+ * @brief Build the installer packages of a credential in the background.
+ *
+ * Fills the package cache, so that the first GET_CREDENTIALS with format
+ * rpm or deb does not have to wait for the packaging tools.  EXE packages
+ * contain the password, so they are not cached.
+ *
+ * @param[in]  credential  Credential.
+ */
+void
+credential_prebuild_packages (credential_t credential)
+{
+  iterator_t iterator;
+  gchar *credential_id, *login;
+  char *public_key, *maintainer;
+  pid_t pid;
+  int status;
+
+  init_credential_iterator_one (&iterator, credential);
+  if (next (&iterator) == FALSE)
+    {
+      cleanup_iterator (&iterator);
+      return;
+    }
+
+  public_key = NULL;
+  if (credential_iterator_format_available (&iterator, CREDENTIAL_FORMAT_RPM))
+    public_key = gvm_ssh_public_from_private
+                  (credential_iterator_private_key (&iterator),
+                   credential_iterator_password (&iterator));
+
+  if (public_key == NULL)
+    {
+      cleanup_iterator (&iterator);
+      return;
+    }
+
+  credential_id = g_strdup (get_iterator_uuid (&iterator));
+  login = g_strdup (credential_iterator_login (&iterator));
+  cleanup_iterator (&iterator);
+
+  maintainer = NULL;
+  setting_value (SETTING_UUID_LSC_DEB_MAINTAINER, &maintainer);
+
+  pid = fork ();
+  switch (pid)
+    {
+      case 0:
+        /* Child.  Fork again so the parent can wait on the child, to
+         * prevent zombies. */
+
+        cleanup_manage_process (FALSE);
+        pid = fork ();
+        if (pid == -1)
+          {
+            g_warning ("%s: Failed to fork: %s", __func__, strerror (errno));
+            exit (EXIT_FAILURE);
+          }
+        if (pid)
+          exit (EXIT_SUCCESS);
+
+        /* Grandchild.  Build the packages into the cache, then exit. */
+
+        reinit_manage_process ();
+        proctitle_set ("gvmd: Building credential packages");
+        manage_process_register ("credential_packages", 0, 0);
+
+        lsc_user_packages_build (credential_id, login, public_key,
+                                 maintainer);
+        exit (EXIT_SUCCESS);
+
+      case -1:
+        g_warning ("%s: Failed to fork: %s", __func__, strerror (errno));
+        break;
+
+      default:
+        g_debug ("%s: forked %i to build packages of credential %s",
+                 __func__, pid, credential_id);
+        while (waitpid (pid, &status, 0) < 0 && errno == EINTR)
+          ;
+        break;
+    }
+
+  g_free (credential_id);
+  g_free (login);
+  g_free (public_key);
+  free (maintainer);
+}
+
 /**
  * @brief  Test if a credential format is available for an iterator.
  *
@@ -37709,7 +44033,7 @@ create_override (const char* active, const char* nvt, const char* text,
                                  ((gpointer*)&reports_ptr), NULL))
     {
       if (auto_cache_rebuild)
-        report_cache_counts (*reports_ptr, 0, 1, users_where);
+        report_queue_counts (*reports_ptr, 0, 1, users_where);
       else
         report_clear_count_cache (*reports_ptr, 0, 1, users_where);
     }
@@ -37853,7 +44177,7 @@ delete_override (const char *override_id, int ultimate)
                                  ((gpointer*)&reports_ptr), NULL))
     {
       if (auto_cache_rebuild)
-        report_cache_counts (*reports_ptr, 0, 1, users_where);
+        report_queue_counts (*reports_ptr, 0, 1, users_where);
       else
         report_clear_count_cache (*reports_ptr, 0, 1, users_where);
     }
@@ -38204,7 +44528,7 @@ modify_override (const gchar *override_id, const char *active, const char *nvt,
                                     ((gpointer*)&reports_ptr), NULL))
         {
           if (auto_cache_rebuild)
-            report_cache_counts (*reports_ptr, 0, 1, users_where);
+            report_queue_counts (*reports_ptr, 0, 1, users_where);
           else
             report_clear_count_cache (*reports_ptr, 0, 1, users_where);
         }
@@ -40651,6 +46975,137 @@ openvas_default_scanner_host ()
                      SCANNER_UUID_DEFAULT);
 }
 
+/**
+ * @brief Maximum number of connections to each OSP scanner, 0 for no limit.
+ */
+static int osp_connections = OSP_CONNECTIONS_DEFAULT;
+
+/**
+ * @brief Seconds to wait for a free OSP connection slot.
+ *
+ * After this the connection is opened anyway, so that a stuck process
+ * cannot block every scan on the scanner.
+ */
+#define OSP_CONNECTION_SLOT_WAIT 30
+
+/**
+ * @brief Microseconds between attempts to get an OSP connection slot.
+ */
+#define OSP_CONNECTION_SLOT_SLEEP 50000
+
+/**
+ * @brief Slots held by open OSP connections, keyed by connection.
+ */
+static GHashTable *osp_connection_slots = NULL;
+
+/**
+ * @brief Set the maximum number of connections to each OSP scanner.
+ *
+ * @param[in]  new_connections  Number of connections, 0 for no limit.
+ */
+void
+set_osp_connections (int new_connections)
+{
+  if (new_connections < 0)
+    osp_connections = 0;
+  else
+    osp_connections = new_connections;
+}
+
+/**
+ * @brief Get a connection slot for an OSP scanner.
+ *
+ * The slots are lock files, so the limit holds across all gvmd processes.
+ *
+ * @param[in]  host  Host name or IP address, or path of socket.
+ * @param[in]  port  Port.
+ *
+ * @return Slot, or NULL if there is no limit or no slot could be had.
+ */
+static lockfile_t *
+osp_connection_slot_acquire (const char *host, int port)
+{
+  gchar *address, *checksum;
+  lockfile_t *slot;
+  gint64 give_up;
+
+  if (osp_connections == 0)
+    return NULL;
+
+  address = g_strdup_printf ("%s:%i", host ? host : "", port);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, address, -1);
+  g_free (address);
+
+  slot = g_malloc0 (sizeof (*slot));
+  give_up = g_get_monotonic_time ()
+            + OSP_CONNECTION_SLOT_WAIT * G_USEC_PER_SEC;
+  while (1)
+    {
+      int index;
+
+      for (index = 0; index < osp_connections; index++)
+        {
+          gchar *name;
+          int ret;
+
+          name = g_strdup_printf ("gvm-osp-%s-%i", checksum, index);
+          ret = lockfile_lock_nb (slot, name);
+          g_free (name);
+          if (ret == 0)
+            {
+              g_free (checksum);
+              return slot;
+            }
+          if (ret == -1)
+            {
+              g_free (checksum);
+              g_free (slot);
+              return NULL;
+            }
+        }
+
+      if (g_get_monotonic_time () >= give_up)
+        {
+          g_warning ("%s: All %i connections to the scanner at %s:%i"
+                     " are busy, connecting anyway",
+                     __func__, osp_connections, host, port);
+          g_free (checksum);
+          g_free (slot);
+          return NULL;
+        }
+
+      g_usleep (OSP_CONNECTION_SLOT_SLEEP);
+    }
+}
+
+/**
+ * @brief Close a connection to an OSP scanner, freeing its slot.
+ *
+ * For connections from osp_connect_with_data and osp_scanner_connect.
+ *
+ * @param[in]  connection  Connection.
+ */
+void
+osp_scanner_disconnect (osp_connection_t *connection)
+{
+  lockfile_t *slot;
+
+  if (connection == NULL)
+    return;
+
+  osp_connection_close (connection);
+
+  if (osp_connection_slots == NULL)
+    return;
+  slot = g_hash_table_lookup (osp_connection_slots, connection);
+  if (slot)
+    {
+      g_hash_table_remove (osp_connection_slots, connection);
+      lockfile_unlock (slot);
+      g_free (slot);
+    }
+}
+
 /**
  * @brief Create a new connection to an OSP scanner relay.
  *
@@ -40735,8 +47190,11 @@ osp_connect_with_data (const char *host,
                        const char *key_priv)
 {
   osp_connection_t *connection;
+  lockfile_t *slot;
   int is_unix_socket = (host && *host == '/') ? 1 : 0;
 
+  slot = osp_connection_slot_acquire (host, port);
+
   if (is_unix_socket == 0
       && get_relay_mapper_path ())
     {
@@ -40755,6 +47213,23 @@ osp_connect_with_data (const char *host,
             g_warning ("Could not connect to Scanner at %s:%d", host, port);
         }
     }
+
+  if (slot)
+    {
+      if (connection == NULL)
+        {
+          lockfile_unlock (slot);
+          g_free (slot);
+        }
+      else
+        {
+          if (osp_connection_slots == NULL)
+            osp_connection_slots = g_hash_table_new (g_direct_hash,
+                                                     g_direct_equal);
+          g_hash_table_insert (osp_connection_slots, connection, slot);
+        }
+    }
+
   return connection;
 }
 
@@ -40817,6 +47292,7 @@ osp_get_version_from_iterator (iterator_t *iterator, char **s_name,
                                char **p_name, char **p_ver)
 {
   osp_connection_t *connection;
+  int ret;
 
   assert (iterator);
   connection = osp_connect_with_data (scanner_iterator_host (iterator),
@@ -40826,10 +47302,10 @@ osp_get_version_from_iterator (iterator_t *iterator, char **s_name,
                                       scanner_iterator_key_priv (iterator));
   if (!connection)
     return 1;
-  if (osp_get_version (connection, s_name, s_ver, d_name, d_ver, p_name, p_ver))
-    return 1;
-  osp_connection_close (connection);
-  return 0;
+  ret = osp_get_version (connection, s_name, s_ver, d_name, d_ver, p_name,
+                         p_ver);
+  osp_scanner_disconnect (connection);
+  return ret ? 1 : 0;
 }
 
 /**
@@ -40846,6 +47322,7 @@ osp_get_details_from_iterator (iterator_t *iterator, char **desc,
                                GSList **params)
 {
   osp_connection_t *connection;
+  int ret;
 
   assert (iterator);
   connection = osp_connect_with_data (scanner_iterator_host (iterator),
@@ -40855,10 +47332,9 @@ osp_get_details_from_iterator (iterator_t *iterator, char **desc,
                                       scanner_iterator_key_priv (iterator));
   if (!connection)
     return 1;
-  if (osp_get_scanner_details (connection, desc, params))
-    return 1;
-  osp_connection_close (connection);
-  return 0;
+  ret = osp_get_scanner_details (connection, desc, params);
+  osp_scanner_disconnect (connection);
+  return ret ? 1 : 0;
 }
 
 /**
@@ -41145,6 +47621,848 @@ manage_get_scanners (GSList *log_config, const gchar *database)
   return 0;
 }
 
+
+/* GMP command statistics. */
+
+/**
+ * @brief Get the SQL statistics of this process.
+ *
+ * @param[out]  statements  Number of statements executed.
+ * @param[out]  seconds     Time spent executing statements.
+ * @param[out]  rows        Number of rows fetched.
+ */
+void
+manage_sql_stats (long long *statements, double *seconds, long long *rows)
+{
+  sql_stats (statements, seconds, rows);
+}
+
+/**
+ * @brief Set up logging of slow SQL statements.
+ *
+ * @param[in]  threshold  Milliseconds after which a statement is logged as
+ *                        slow, 0 for never.
+ * @param[in]  explain    Whether to log the plan of slow queries too.
+ */
+void
+set_slow_query_log (int threshold, int explain)
+{
+  sql_set_slow_log (threshold, explain);
+}
+
+/**
+ * @brief Set up the read replica.
+ *
+ * @param[in]  conn_info  libpq connection string of the replica, NULL for
+ *                        none.
+ * @param[in]  max_lag    Seconds that the replica may lag behind the primary.
+ */
+void
+set_read_replica (const char *conn_info, int max_lag)
+{
+  sql_replica_setup (conn_info, max_lag);
+}
+
+/**
+ * @brief Check whether a GMP command only reads, so it may use the replica.
+ *
+ * These are the heavy readers.  If one writes after all, for example to a
+ * cache, the statement moves the command to the primary.
+ *
+ * @param[in]  name  Command name.
+ *
+ * @return 1 if read-only, else 0.
+ */
+static int
+gmp_command_read_only (const char *name)
+{
+  return strcasecmp (name, "GET_AGGREGATES") == 0
+         || strcasecmp (name, "GET_INFO") == 0
+         || strcasecmp (name, "GET_NVTS") == 0
+         || strcasecmp (name, "GET_NVT_FAMILIES") == 0
+         || strcasecmp (name, "GET_REPORTS") == 0
+         || strcasecmp (name, "GET_RESULTS") == 0
+         || strcasecmp (name, "GET_VULNS") == 0;
+}
+
+/**
+ * @brief Start routing the statements of a GMP command.
+ *
+ * Read-only commands go to the read replica when there is one that is
+ * close enough to the primary.
+ *
+ * @param[in]  name  Command name.
+ */
+void
+manage_read_replica_begin (const char *name)
+{
+  if (valid_gmp_command (name) && gmp_command_read_only (name))
+    sql_replica_begin ();
+}
+
+/**
+ * @brief Send statements to the primary again, at the end of a command.
+ */
+void
+manage_read_replica_end ()
+{
+  sql_replica_end ();
+}
+
+/**
+ * @brief Time budgets of GMP commands in seconds, keyed by lower case name.
+ */
+static GHashTable *command_timeouts = NULL;
+
+/**
+ * @brief Time budget in seconds of commands that have none of their own.
+ */
+static int command_timeout_default = 0;
+
+/**
+ * @brief Set up the time budgets of GMP commands.
+ *
+ * @param[in]  timeouts  Comma separated list of COMMAND=SECONDS.  A COMMAND
+ *                       of "*" sets the budget of all other commands.  0
+ *                       SECONDS means no budget.  NULL for no budgets.
+ *
+ * @return 0 success, -1 error in list.
+ */
+int
+set_command_timeouts (const char *timeouts)
+{
+  gchar **items, **point;
+  int ret;
+
+  if (command_timeouts)
+    g_hash_table_remove_all (command_timeouts);
+  else
+    command_timeouts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, NULL);
+  command_timeout_default = 0;
+
+  if (timeouts == NULL)
+    return 0;
+
+  ret = 0;
+  items = g_strsplit (timeouts, ",", 0);
+  for (point = items; *point; point++)
+    {
+      gchar *equal, *name, *end;
+      long seconds;
+
+      g_strstrip (*point);
+      if (**point == '\0')
+        continue;
+
+      equal = strchr (*point, '=');
+      if (equal == NULL)
+        {
+          g_warning ("%s: missing '=' in: %s", __func__, *point);
+          ret = -1;
+          break;
+        }
+      *equal = '\0';
+      name = g_strstrip (*point);
+
+      seconds = strtol (equal + 1, &end, 10);
+      if (end == equal + 1 || *g_strstrip (end) || seconds < 0
+          || seconds > G_MAXINT / 1000)
+        {
+          g_warning ("%s: invalid seconds for %s: %s",
+                     __func__, name, equal + 1);
+          ret = -1;
+          break;
+        }
+
+      if (strcmp (name, "*") == 0)
+        command_timeout_default = seconds;
+      else if (valid_gmp_command (name))
+        g_hash_table_insert (command_timeouts, g_ascii_strdown (name, -1),
+                             GINT_TO_POINTER (seconds));
+      else
+        {
+          g_warning ("%s: unknown command: %s", __func__, name);
+          ret = -1;
+          break;
+        }
+    }
+  g_strfreev (items);
+  return ret;
+}
+
+/**
+ * @brief Start the time budget of a GMP command.
+ *
+ * @param[in]  name     Command name.
+ * @param[in]  expired  Function to call if the command runs out of time.
+ */
+void
+manage_command_timeout_begin (const char *name, void (*expired) ())
+{
+  gpointer seconds;
+  gchar *lower;
+  int budget;
+
+  if (command_timeouts == NULL)
+    return;
+
+  lower = g_ascii_strdown (name, -1);
+  if (g_hash_table_lookup_extended (command_timeouts, lower, NULL, &seconds))
+    budget = GPOINTER_TO_INT (seconds);
+  else if (valid_gmp_command (name))
+    budget = command_timeout_default;
+  else
+    budget = 0;
+  g_free (lower);
+
+  if (budget > 0)
+    sql_set_deadline (budget * 1000, expired);
+}
+
+/**
+ * @brief End the time budget of a GMP command.
+ */
+void
+manage_command_timeout_end ()
+{
+  sql_set_deadline (0, NULL);
+}
+
+/**
+ * @brief Add the statistics of a GMP command type to the totals.
+ *
+ * @param[in]  command  Command name.
+ * @param[in]  stats    Statistics gathered since the previous call.
+ */
+void
+manage_command_stats_add (const char *command, const command_stats_t *stats)
+{
+  gchar *quoted_command;
+
+  quoted_command = sql_quote (command);
+  sql ("INSERT INTO gmp_command_stats"
+       " (command, count, wall_time, cpu_time, sql_count, sql_time,"
+       "  sql_rows, bytes)"
+       " VALUES ('%s', %i, %f, %f, %lli, %f, %lli, %llu)"
+       " ON CONFLICT (command)"
+       " DO UPDATE SET count = gmp_command_stats.count + EXCLUDED.count,"
+       "               wall_time = gmp_command_stats.wall_time"
+       "                           + EXCLUDED.wall_time,"
+       "               cpu_time = gmp_command_stats.cpu_time"
+       "                          + EXCLUDED.cpu_time,"
+       "               sql_count = gmp_command_stats.sql_count"
+       "                           + EXCLUDED.sql_count,"
+       "               sql_time = gmp_command_stats.sql_time"
+       "                          + EXCLUDED.sql_time,"
+       "               sql_rows = gmp_command_stats.sql_rows"
+       "                          + EXCLUDED.sql_rows,"
+       "               bytes = gmp_command_stats.bytes + EXCLUDED.bytes;",
+       quoted_command,
+       stats->count,
+       stats->wall_time,
+       stats->cpu_time,
+       stats->sql_count,
+       stats->sql_time,
+       stats->sql_rows,
+       stats->bytes);
+  g_free (quoted_command);
+}
+
+/**
+ * @brief Add the lock waits of this process to the totals.
+ */
+void
+manage_lock_stats_flush ()
+{
+  GHashTable *lock_stats;
+  GHashTableIter iter;
+  gpointer site, value;
+
+  lock_stats = sql_lock_stats_take ();
+  if (lock_stats == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, lock_stats);
+  while (g_hash_table_iter_next (&iter, &site, &value))
+    {
+      sql_lock_stats_t *stats;
+      gchar *quoted_site;
+
+      stats = value;
+      quoted_site = sql_quote (site);
+      sql ("INSERT INTO lock_wait_stats (site, count, wait_time, max_wait)"
+           " VALUES ('%s', %lli, %f, %f)"
+           " ON CONFLICT (site)"
+           " DO UPDATE SET count = lock_wait_stats.count + EXCLUDED.count,"
+           "               wait_time = lock_wait_stats.wait_time"
+           "                           + EXCLUDED.wait_time,"
+           "               max_wait = greatest (lock_wait_stats.max_wait,"
+           "                                    EXCLUDED.max_wait);",
+           quoted_site,
+           stats->count,
+           stats->wait_time,
+           stats->max_wait);
+      g_free (quoted_site);
+    }
+  g_hash_table_destroy (lock_stats);
+}
+
+/**
+ * @brief Print the GMP command, lock wait and process statistics.
+ *
+ * The statistics are in Prometheus text format.
+ *
+ * @param[in]  log_config  Log configuration.
+ * @param[in]  database    Location of manage database.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+manage_get_gmp_stats (GSList *log_config, const gchar *database)
+{
+  static const char *metrics[][3]
+    = {{ "gvmd_gmp_commands_total", "count",
+         "Number of GMP commands handled." },
+       { "gvmd_gmp_wall_seconds_total", "wall_time",
+         "Wall clock time spent handling GMP commands." },
+       { "gvmd_gmp_cpu_seconds_total", "cpu_time",
+         "CPU time spent handling GMP commands." },
+       { "gvmd_gmp_sql_statements_total", "sql_count",
+         "Number of SQL statements run for GMP commands." },
+       { "gvmd_gmp_sql_seconds_total", "sql_time",
+         "Time spent in SQL statements for GMP commands." },
+       { "gvmd_gmp_sql_rows_total", "sql_rows",
+         "Number of rows returned by SQL statements for GMP commands." },
+       { "gvmd_gmp_sent_bytes_total", "bytes",
+         "Number of bytes sent in responses to GMP commands." },
+       { NULL, NULL, NULL }};
+  static const char *lock_metrics[][4]
+    = {{ "gvmd_lock_waits_total", "count", "counter",
+         "Number of locks taken, per call site." },
+       { "gvmd_lock_wait_seconds_total", "wait_time", "counter",
+         "Time spent waiting for locks, per call site." },
+       { "gvmd_lock_wait_max_seconds", "max_wait", "gauge",
+         "Longest wait for a lock, per call site." },
+       { NULL, NULL, NULL, NULL }};
+  static const char *process_metrics[][4]
+    = {{ "gvmd_process_resident_bytes", "rss", "gauge",
+         "Resident set size of a process." },
+       { "gvmd_process_peak_resident_bytes", "peak_rss", "gauge",
+         "Peak resident set size of a process." },
+       { "gvmd_process_cpu_seconds_total", "cpu_time", "counter",
+         "CPU time used by a process." },
+       { "gvmd_process_sql_statements_total", "sql_count", "counter",
+         "Number of SQL statements run by a process." },
+       { "gvmd_process_sql_seconds_total", "sql_time", "counter",
+         "Time spent in SQL statements by a process." },
+       { "gvmd_process_start_time_seconds", "start_time", "gauge",
+         "Time at which a process took on its role." },
+       { NULL, NULL, NULL, NULL }};
+  int ret, index;
+
+  g_info ("   Getting GMP statistics.");
+
+  ret = manage_option_setup (log_config, database);
+  if (ret)
+    return ret;
+
+  for (index = 0; metrics[index][0]; index++)
+    {
+      iterator_t stats;
+
+      printf ("# HELP %s %s\n", metrics[index][0], metrics[index][2]);
+      printf ("# TYPE %s counter\n", metrics[index][0]);
+      init_iterator (&stats,
+                     "SELECT command, %s FROM gmp_command_stats"
+                     " ORDER BY command;",
+                     metrics[index][1]);
+      while (next (&stats))
+        printf ("%s{command=\"%s\"} %s\n",
+                metrics[index][0],
+                iterator_string (&stats, 0),
+                iterator_string (&stats, 1));
+      cleanup_iterator (&stats);
+    }
+
+  for (index = 0; lock_metrics[index][0]; index++)
+    {
+      iterator_t stats;
+
+      printf ("# HELP %s %s\n", lock_metrics[index][0],
+              lock_metrics[index][3]);
+      printf ("# TYPE %s %s\n", lock_metrics[index][0],
+              lock_metrics[index][2]);
+      init_iterator (&stats,
+                     "SELECT site, %s FROM lock_wait_stats"
+                     " ORDER BY site;",
+                     lock_metrics[index][1]);
+      while (next (&stats))
+        printf ("%s{site=\"%s\"} %s\n",
+                lock_metrics[index][0],
+                iterator_string (&stats, 0),
+                iterator_string (&stats, 1));
+      cleanup_iterator (&stats);
+    }
+
+  processes_prune ();
+  for (index = 0; process_metrics[index][0]; index++)
+    {
+      iterator_t processes;
+
+      printf ("# HELP %s %s\n", process_metrics[index][0],
+              process_metrics[index][3]);
+      printf ("# TYPE %s %s\n", process_metrics[index][0],
+              process_metrics[index][2]);
+      init_iterator (&processes,
+                     "SELECT pid, role, %s, node FROM processes"
+                     " ORDER BY node, pid;",
+                     process_metrics[index][1]);
+      while (next (&processes))
+        printf ("%s{pid=\"%s\",role=\"%s\",node=\"%s\"} %s\n",
+                process_metrics[index][0],
+                iterator_string (&processes, 0),
+                iterator_string (&processes, 1),
+                iterator_string (&processes, 3),
+                iterator_string (&processes, 2));
+      cleanup_iterator (&processes);
+    }
+
+  manage_option_cleanup ();
+
+  return 0;
+}
+
+
+/* Process registry. */
+
+/**
+ * @brief Minimum seconds between updates of the row of a process.
+ */
+#define PROCESS_UPDATE_PERIOD 10
+
+/**
+ * @brief PID of the registered process, 0 if none.
+ *
+ * A forked child inherits the registration of its parent, so this tells
+ * whether the registration belongs to the current process.
+ */
+static pid_t process_pid = 0;
+
+/**
+ * @brief Role of the registered process.
+ */
+static gchar *process_role = NULL;
+
+/**
+ * @brief Task that the registered process is working on, 0 for none.
+ */
+static task_t process_task = 0;
+
+/**
+ * @brief Report that the registered process is working on, 0 for none.
+ */
+static report_t process_report = 0;
+
+/**
+ * @brief Time at which the process registered.
+ */
+static time_t process_start = 0;
+
+/**
+ * @brief Time of the last update of the row of the process, 0 for never.
+ */
+static time_t process_update_last = 0;
+
+/**
+ * @brief SQL statement count when the process registered.
+ */
+static long long process_sql_count = 0;
+
+/**
+ * @brief SQL time when the process registered.
+ */
+static double process_sql_time = 0;
+
+/**
+ * @brief Get the resident set size of this process.
+ *
+ * @return Resident set size in bytes, 0 if unknown.
+ */
+static long long
+process_rss ()
+{
+  FILE *statm;
+  long long size, resident;
+
+  statm = fopen ("/proc/self/statm", "r");
+  if (statm == NULL)
+    return 0;
+  if (fscanf (statm, "%lli %lli", &size, &resident) != 2)
+    resident = 0;
+  fclose (statm);
+  return resident * sysconf (_SC_PAGESIZE);
+}
+
+/**
+ * @brief Get the node of this process, for the process registry.
+ *
+ * @return SQL quoted name of the cluster node, or "" if alone.
+ */
+static const gchar *
+process_node ()
+{
+  return cluster_node ? cluster_node : "";
+}
+
+/**
+ * @brief Register this process in the process registry.
+ *
+ * The row of the process is written right away if the database is open,
+ * and updated from then on by manage_process_tick.  So a forked child must
+ * register after it has closed or reopened the database of its parent.
+ *
+ * @param[in]  role    Role of the process, like "gmp" or "osp_handler".
+ * @param[in]  task    Task that the process works on, 0 for none.
+ * @param[in]  report  Report that the process works on, 0 for none.
+ */
+void
+manage_process_register (const char *role, task_t task, report_t report)
+{
+  long long sql_rows;
+
+  g_free (process_role);
+  process_role = g_strdup (role);
+  process_pid = getpid ();
+  process_task = task;
+  process_report = report;
+  process_start = time (NULL);
+  /* The SQL counters include the work of the parent before the fork. */
+  sql_stats (&process_sql_count, &process_sql_time, &sql_rows);
+  process_update_last = 0;
+  manage_process_update ();
+}
+
+/**
+ * @brief Set the task and report that this process works on.
+ *
+ * For processes that serve many requests, like GMP children, around the
+ * work of a single request.
+ *
+ * @param[in]  task    Task that the process works on, 0 for none.
+ * @param[in]  report  Report that the process works on, 0 for none.
+ */
+void
+manage_process_set_work (task_t task, report_t report)
+{
+  process_task = task;
+  process_report = report;
+  process_update_last = 0;
+  manage_process_update ();
+}
+
+/**
+ * @brief Update the row of this process if it is due.
+ *
+ * Called from the loops of long running processes, like the GMP command
+ * loop, the scheduler loop, the OSP scan loops and the report render loops,
+ * between statements.
+ */
+void
+manage_process_tick ()
+{
+  if (time (NULL) - process_update_last >= PROCESS_UPDATE_PERIOD)
+    manage_process_update ();
+}
+
+/**
+ * @brief Write the resource use of this process to the process registry.
+ *
+ * Does nothing inside a transaction, so that the row never joins the work
+ * of the caller.
+ */
+void
+manage_process_update ()
+{
+  struct rusage usage;
+  long long sql_count, sql_rows;
+  double sql_time;
+  gchar *quoted_role;
+
+  if (process_pid != getpid ()
+      || sql_is_open () == 0
+      || sql_in_transaction ())
+    return;
+
+  process_update_last = time (NULL);
+
+  if (getrusage (RUSAGE_SELF, &usage))
+    memset (&usage, 0, sizeof (usage));
+  sql_stats (&sql_count, &sql_time, &sql_rows);
+
+  quoted_role = sql_quote (process_role);
+  sql ("INSERT INTO processes"
+       " (pid, node, role, task, report, start_time, rss, peak_rss, cpu_time,"
+       "  sql_count, sql_time, update_time)"
+       " VALUES (%i, '%s', '%s', %llu, %llu, %li, %lli, %lli, %f, %lli, %f,"
+       "         m_now ())"
+       " ON CONFLICT (pid, node)"
+       " DO UPDATE SET role = EXCLUDED.role,"
+       "               task = EXCLUDED.task,"
+       "               report = EXCLUDED.report,"
+       "               start_time = EXCLUDED.start_time,"
+       "               rss = EXCLUDED.rss,"
+       "               peak_rss = EXCLUDED.peak_rss,"
+       "               cpu_time = EXCLUDED.cpu_time,"
+       "               sql_count = EXCLUDED.sql_count,"
+       "               sql_time = EXCLUDED.sql_time,"
+       "               update_time = EXCLUDED.update_time;",
+       process_pid,
+       process_node (),
+       quoted_role,
+       process_task,
+       process_report,
+       (long) process_start,
+       process_rss (),
+       /* Kilobytes on Linux. */
+       usage.ru_maxrss * 1024LL,
+       usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0,
+       sql_count - process_sql_count,
+       sql_time - process_sql_time);
+  g_free (quoted_role);
+}
+
+/**
+ * @brief Remove this process from the process registry.
+ */
+void
+manage_process_unregister ()
+{
+  if (process_pid != getpid ())
+    return;
+
+  if (sql_is_open ())
+    sql ("DELETE FROM processes WHERE pid = %i AND node = '%s';",
+         process_pid, process_node ());
+  process_pid = 0;
+}
+
+/**
+ * @brief Remove the processes that exited without unregistering.
+ *
+ * Most children exit without cleaning up the manage library.
+ *
+ * Only the processes of this node can be checked with kill.  In a cluster
+ * the rows of the other nodes go when their node stops sending heartbeats.
+ */
+static void
+processes_prune ()
+{
+  iterator_t processes;
+  GString *gone;
+
+  if (cluster_node)
+    sql ("DELETE FROM processes"
+         " WHERE node != '%s'"
+         " AND node NOT IN (" CLUSTER_LIVE_NODES ");",
+         cluster_node);
+
+  gone = g_string_new ("");
+  init_iterator (&processes,
+                 "SELECT pid FROM processes WHERE node = '%s';",
+                 process_node ());
+  while (next (&processes))
+    {
+      pid_t pid;
+
+      pid = iterator_int (&processes, 0);
+      if (kill (pid, 0) && errno == ESRCH)
+        g_string_append_printf (gone, "%s%i", gone->len ? ", " : "", pid);
+    }
+  cleanup_iterator (&processes);
+
+  if (gone->len)
+    sql ("DELETE FROM processes WHERE node = '%s' AND pid IN (%s);",
+         process_node (), gone->str);
+  g_string_free (gone, TRUE);
+}
+
+/**
+ * @brief Initialise an iterator over the registered processes.
+ *
+ * Processes that have exited are dropped first.
+ *
+ * @param[in]  iterator  Iterator.
+ */
+void
+init_process_iterator (iterator_t *iterator)
+{
+  processes_prune ();
+  init_iterator (iterator,
+                 "SELECT pid, role,"
+                 "       (SELECT uuid FROM tasks WHERE id = task),"
+                 "       (SELECT uuid FROM reports WHERE id = report),"
+                 "       start_time, rss, peak_rss, cpu_time, sql_count,"
+                 "       sql_time, update_time, node"
+                 " FROM processes"
+                 " ORDER BY node, pid;");
+}
+
+/**
+ * @brief Get the PID from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return PID.
+ */
+int
+process_iterator_pid (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 0);
+}
+
+/**
+ * @brief Get the role from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Role of the process, or NULL if iteration is complete.  Freed by
+ *         cleanup_iterator.
+ */
+DEF_ACCESS (process_iterator_role, 1);
+
+/**
+ * @brief Get the task UUID from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return UUID of the task, or NULL if none.  Freed by cleanup_iterator.
+ */
+DEF_ACCESS (process_iterator_task_id, 2);
+
+/**
+ * @brief Get the report UUID from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return UUID of the report, or NULL if none.  Freed by cleanup_iterator.
+ */
+DEF_ACCESS (process_iterator_report_id, 3);
+
+/**
+ * @brief Get the start time from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Time at which the process registered.
+ */
+time_t
+process_iterator_start_time (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 4);
+}
+
+/**
+ * @brief Get the resident set size from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Resident set size in bytes, at the last update.
+ */
+long long
+process_iterator_rss (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 5);
+}
+
+/**
+ * @brief Get the peak resident set size from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Peak resident set size in bytes, at the last update.
+ */
+long long
+process_iterator_peak_rss (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 6);
+}
+
+/**
+ * @brief Get the CPU time from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return User and system CPU time in seconds, at the last update.
+ */
+double
+process_iterator_cpu_time (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_double (iterator, 7);
+}
+
+/**
+ * @brief Get the SQL statement count from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of SQL statements run since the process registered.
+ */
+long long
+process_iterator_sql_count (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 8);
+}
+
+/**
+ * @brief Get the SQL time from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Seconds spent in SQL statements since the process registered.
+ */
+double
+process_iterator_sql_time (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_double (iterator, 9);
+}
+
+/**
+ * @brief Get the update time from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Time of the last update of the row of the process.
+ */
+time_t
+process_iterator_update_time (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 10);
+}
+
+/**
+ * @brief Get the cluster node from a process iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Name of the cluster node of the process, "" if not in a cluster.
+ */
+const char *
+process_iterator_node (iterator_t *iterator)
+{
+  if (iterator->done) return NULL;
+  return iterator_string (iterator, 11);
+}
+
 
 /* Schedules. */
 
@@ -41931,6 +49249,52 @@ schedule_iterator_next_time (iterator_t* iterator)
   return ret;
 }
 
+/**
+ * @brief Database notification channel for task schedule changes.
+ */
+#define TASK_SCHEDULES_CHANNEL "gvmd_task_schedules"
+
+/**
+ * @brief Notify the scheduler that the schedule of a task may have changed.
+ */
+static void
+task_schedules_changed ()
+{
+  sql_notify (TASK_SCHEDULES_CHANNEL);
+}
+
+/**
+ * @brief Check whether task schedules have changed since the last check.
+ *
+ * The first call starts listening for changes, and always returns 1.
+ *
+ * @return 1 if changed, else 0.
+ */
+int
+manage_task_schedules_changed ()
+{
+  static int listening = 0;
+
+  if (listening == 0)
+    {
+      sql_listen (TASK_SCHEDULES_CHANNEL);
+      listening = 1;
+      return 1;
+    }
+  return sql_notified (TASK_SCHEDULES_CHANNEL);
+}
+
+/**
+ * @brief Get the socket on which task schedule changes arrive.
+ *
+ * @return Socket, or -1 if there is no database connection.
+ */
+int
+manage_task_schedules_socket ()
+{
+  return sql_socket ();
+}
+
 /**
  * @brief Initialise a task schedule iterator.
  *
@@ -41949,6 +49313,12 @@ init_task_schedule_iterator (iterator_t* iterator)
   if (ret)
     return ret;
 
+  /* In a cluster the nodes take turns, so that each node sees the next times
+   * that the other nodes have set, and every due task starts once. */
+  if (cluster_node)
+    sql ("SELECT pg_advisory_xact_lock (%i, %i);",
+         ADVISORY_LOCK_SPACE, CLUSTER_SCHEDULE_LOCK);
+
   init_iterator (iterator,
                  "SELECT tasks.id, tasks.uuid,"
                  " schedules.id, tasks.schedule_next_time,"
@@ -42010,7 +49380,7 @@ DEF_ACCESS (task_schedule_iterator_task_uuid, 1);
  *
  * @return Next time.
  */
-static time_t
+time_t
 task_schedule_iterator_next_time (iterator_t* iterator)
 {
   if (iterator->done) return 0;
@@ -42103,19 +49473,20 @@ task_schedule_iterator_start_due (iterator_t* iterator)
 }
 
 /**
- * @brief Get the stop due state from a task schedule iterator.
+ * @brief Get the stop time from a task schedule iterator.
  *
  * @param[in]  iterator  Iterator.
  *
- * @return Stop due flag.
+ * @return Time at which the schedule duration of the running task ends, or
+ *         0 if the task does not have to be stopped.
  */
-gboolean
-task_schedule_iterator_stop_due (iterator_t* iterator)
+time_t
+task_schedule_iterator_stop_time (iterator_t* iterator)
 {
   const char *icalendar, *zone;
   time_t duration;
 
-  if (iterator->done) return FALSE;
+  if (iterator->done) return 0;
 
   icalendar = task_schedule_iterator_icalendar (iterator);
   zone = task_schedule_iterator_timezone (iterator);
@@ -42128,24 +49499,37 @@ task_schedule_iterator_stop_due (iterator_t* iterator)
 
       report = task_running_report (task_schedule_iterator_task (iterator));
       if (report && (report_scheduled (report) == 0))
-        return FALSE;
+        return 0;
 
       run_status = task_run_status (task_schedule_iterator_task (iterator));
 
       if (run_status == TASK_STATUS_RUNNING
           || run_status == TASK_STATUS_REQUESTED)
         {
-          time_t now, start;
-
-          now = time (NULL);
+          time_t start;
 
           start = icalendar_next_time_from_string (icalendar, zone, -1);
-          if ((start + duration) < now)
-            return TRUE;
+          return start + duration;
         }
     }
 
-  return FALSE;
+  return 0;
+}
+
+/**
+ * @brief Get the stop due state from a task schedule iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Stop due flag.
+ */
+gboolean
+task_schedule_iterator_stop_due (iterator_t* iterator)
+{
+  time_t stop_time;
+
+  stop_time = task_schedule_iterator_stop_time (iterator);
+  return stop_time && (stop_time < time (NULL));
 }
 
 /**
@@ -42542,6 +49926,7 @@ modify_schedule (const char *schedule_id, const char *name, const char *comment,
        " WHERE schedule = %llu;",
        new_next_time,
        schedule);
+  task_schedules_changed ();
 
   g_free (byday_mask_string);
   g_free (duration_string);
@@ -42581,183 +49966,260 @@ set_slave_commit_size (int new_commit_size)
 }
 
 /**
- * @brief Buffer a result to be inserted.
+ * @brief Details of an NVT, for results from a slave.
+ */
+typedef struct
+{
+  gchar *revision;    ///< Modification time of NVT, in ISO format.
+  gchar *cvss_base;   ///< CVSS base score of NVT.
+} slave_nvt_t;
+
+/**
+ * @brief Free details of an NVT.
  *
- * @param[in]  results_buffer     Buffer to store results SQL.
- * @param[in]  result_nvts_buffer Buffer to store result_nvts SQL.
- * @param[in]  task         The task associated with the result.
+ * @param[in]  data  The slave_nvt_t.
+ */
+static void
+slave_nvt_free (gpointer data)
+{
+  slave_nvt_t *slave_nvt = data;
+
+  g_free (slave_nvt->revision);
+  g_free (slave_nvt->cvss_base);
+  g_free (slave_nvt);
+}
+
+/**
+ * @brief Get the details of all NVTs of a page of slave results.
+ *
+ * Gets the details in one statement, instead of one per result.
+ *
+ * @param[in]  results  Result entities of slave report.
+ *
+ * @return Hash table of slave_nvt_t, keyed on OID.
+ */
+static GHashTable *
+slave_nvts_new (entities_t results)
+{
+  GHashTable *nvts;
+  GString *oids;
+  entity_t entity;
+  iterator_t rows;
+
+  nvts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                slave_nvt_free);
+
+  oids = g_string_new ("");
+  while ((entity = first_entity (results)))
+    {
+      entity_t nvt;
+      const char *oid;
+
+      if (strcmp (entity_name (entity), "result") == 0
+          && (nvt = entity_child (entity, "nvt"))
+          && (oid = entity_attribute (nvt, "oid"))
+          && strlen (oid))
+        {
+          gchar *quoted_oid;
+
+          quoted_oid = sql_quote (oid);
+          g_string_append_printf (oids, "%s'%s'",
+                                  oids->len ? ", " : "",
+                                  quoted_oid);
+          g_free (quoted_oid);
+        }
+      results = next_entities (results);
+    }
+
+  if (oids->len == 0)
+    {
+      g_string_free (oids, TRUE);
+      return nvts;
+    }
+
+  init_iterator (&rows,
+                 "SELECT DISTINCT uuid, iso_time (modification_time),"
+                 "       coalesce (cvss_base, '0.0')"
+                 " FROM nvts WHERE uuid IN (%s);",
+                 oids->str);
+  while (next (&rows))
+    {
+      slave_nvt_t *slave_nvt;
+
+      slave_nvt = g_malloc (sizeof (*slave_nvt));
+      slave_nvt->revision = g_strdup (iterator_string (&rows, 1));
+      slave_nvt->cvss_base = g_strdup (iterator_string (&rows, 2));
+      g_hash_table_insert (nvts, g_strdup (iterator_string (&rows, 0)),
+                           slave_nvt);
+    }
+  cleanup_iterator (&rows);
+  g_string_free (oids, TRUE);
+
+  return nvts;
+}
+
+/**
+ * @brief Add a result to the COPY rows of a page of slave results.
+ *
+ * @param[in]  rows         Rows in COPY text format.
+ * @param[in]  nvts         NVT details from slave_nvts_new.
+ * @param[in]  position     Position of result in page.
  * @param[in]  host         Host IP address.
  * @param[in]  hostname     Hostname.
  * @param[in]  port         The port the result refers to.
  * @param[in]  nvt          The OID of the NVT that produced the result.
  * @param[in]  type         Type of result.  "Security Hole", etc.
  * @param[in]  description  Description of the result.
- * @param[in]  report       Report that result belongs to.
- * @param[in]  owner        Owner of report.
  *
  * @return 0 success, -1 error.
  */
 static int
-buffer_insert (GString *results_buffer, GString *result_nvts_buffer,
-               task_t task, const char* host,
-               const char *hostname, const char* port, const char* nvt,
-               const char* type, const char* description,
-               report_t report, user_t owner)
+slave_result_copy (GString *rows, GHashTable *nvts, int position,
+                   const char* host, const char *hostname, const char* port,
+                   const char* nvt, const char* type, const char* description)
 {
-  gchar *nvt_revision, *severity;
-  gchar *quoted_hostname, *quoted_descr, *quoted_qod_type;
-  int qod, first;
-  nvt_t nvt_id = 0;
-
-  assert (report);
+  slave_nvt_t *slave_nvt;
+  gchar *severity, *qod_type, *number;
+  nvti_t *nvti;
+  int qod;
 
-  if (nvt && strcmp (nvt, "") && (find_nvt (nvt, &nvt_id) || nvt_id <= 0))
+  slave_nvt = g_hash_table_lookup (nvts, nvt);
+  if (slave_nvt == NULL)
     {
       g_warning ("NVT '%s' not found. Result not created", nvt);
       return -1;
     }
 
-  if (nvt && strcmp (nvt, ""))
-    {
-      nvti_t *nvti;
-
-      nvti = lookup_nvti (nvt);
-      if (nvti)
-        {
-          gchar *qod_str, *qod_type;
-          qod_str = nvti_get_tag (nvti, "qod");
-          qod_type = nvti_get_tag (nvti, "qod_type");
-
-          if (qod_str == NULL || sscanf (qod_str, "%d", &qod) != 1)
-            qod = qod_from_type (qod_type);
-
-          quoted_qod_type = sql_quote (qod_type);
-
-          g_free (qod_str);
-          g_free (qod_type);
-        }
-      else
-        {
-          qod = QOD_DEFAULT;
-          quoted_qod_type = g_strdup ("");
-        }
-
-      nvt_revision = sql_string ("SELECT iso_time (modification_time)"
-                                 " FROM nvts"
-                                 " WHERE uuid = '%s';",
-                                 nvt);
-    }
+  if (strcasecmp (type, "Alarm") == 0)
+    severity = g_strdup (slave_nvt->cvss_base);
   else
-    {
-      qod = QOD_DEFAULT;
-      quoted_qod_type = g_strdup ("");
-      nvt_revision = g_strdup ("");
-    }
-  severity = nvt_severity (nvt, type);
+    severity = nvt_severity (nvt, type);
   if (!severity)
     {
       g_warning ("NVT '%s' has no severity.  Result not created.", nvt);
       return -1;
     }
-
   if (!strcmp (severity, ""))
     {
       g_free (severity);
       severity = g_strdup ("0.0");
     }
-  quoted_hostname = sql_quote (hostname ? hostname : "");
-  quoted_descr = sql_quote (description ?: "");
-  result_nvt_notice (nvt);
-  first = (strlen (results_buffer->str) == 0);
 
-  if (first)
+  nvti = lookup_nvti (nvt);
+  if (nvti)
     {
-      g_string_append (results_buffer,
-                       "INSERT into results"
-                       " (owner, date, task, host, hostname, port,"
-                       "  nvt, nvt_version, severity, type,"
-                       "  description, uuid, qod, qod_type, result_nvt,"
-                       "  report)"
-                       " VALUES");
-      g_string_append (result_nvts_buffer,
-                       "INSERT INTO result_nvts (nvt) VALUES ");
-    }
-
-  g_string_append_printf
-      (result_nvts_buffer,
-       "%s ('%s')",
-       first ? "" : ",",
-       nvt);
+      gchar *qod_str;
 
-  g_string_append_printf (results_buffer,
-                          "%s"
-                          " (%llu, m_now (), %llu, '%s', '%s', '%s',"
-                          "  '%s', '%s', '%s', '%s',"
-                          "  '%s', make_uuid (), %i, '%s',"
-                          "  (SELECT id FROM result_nvts WHERE nvt = '%s'),"
-                          "  %llu)",
-                          first ? "" : ",",
-                          owner,
-                          task, host ?: "", quoted_hostname, port ?: "",
-                          nvt ?: "", nvt_revision, severity, type,
-                          quoted_descr, qod, quoted_qod_type, nvt ? nvt : "",
-                          report);
-
-  g_free (quoted_hostname);
-  g_free (quoted_descr);
-  g_free (quoted_qod_type);
-  g_free (nvt_revision);
+      qod_str = nvti_get_tag (nvti, "qod");
+      qod_type = nvti_get_tag (nvti, "qod_type");
+      if (qod_str == NULL || sscanf (qod_str, "%d", &qod) != 1)
+        qod = qod_from_type (qod_type);
+      g_free (qod_str);
+    }
+  else
+    {
+      qod = QOD_DEFAULT;
+      qod_type = NULL;
+    }
+
+  number = g_strdup_printf ("%i", position);
+  sql_copy_append (rows, number, 0);
+  g_free (number);
+  sql_copy_append (rows, host ?: "", 0);
+  sql_copy_append (rows, hostname ?: "", 0);
+  sql_copy_append (rows, port ?: "", 0);
+  sql_copy_append (rows, nvt, 0);
+  sql_copy_append (rows, slave_nvt->revision ?: "", 0);
+  sql_copy_append (rows, severity, 0);
+  sql_copy_append (rows, type, 0);
+  sql_copy_append (rows, description ?: "", 0);
+  number = g_strdup_printf ("%i", qod);
+  sql_copy_append (rows, number, 0);
+  g_free (number);
+  sql_copy_append (rows, qod_type ?: "", 1);
+
+  g_free (qod_type);
   g_free (severity);
   return 0;
 }
 
 /**
- * @brief Run INSERT for update_from_slave.
+ * @brief Merge buffered slave results into the results of a report.
  *
- * @param[in]  results_buffer     Buffer of results SQL.
- * @param[in]  result_nvts_buffer Buffer of result_nvts SQL.
- * @param[in]  report             Report.
+ * COPYs the rows into a staging table, and then inserts all of them
+ * into the results with one statement.
+ *
+ * @param[in]  rows    Rows in COPY text format.  Emptied.
+ * @param[in]  task    Task.
+ * @param[in]  report  Report.
+ * @param[in]  owner   Owner of report.
+ *
+ * @return 0 success, -1 error.
  */
-static void
-update_from_slave_insert (GString *results_buffer, GString *result_nvts_buffer,
-                          report_t report)
+static int
+update_from_slave_merge (GString *rows, task_t task, report_t report,
+                         user_t owner)
 {
-  if (result_nvts_buffer && strlen (result_nvts_buffer->str))
-    {
-      g_string_append (result_nvts_buffer,
-                       " ON CONFLICT (nvt) DO NOTHING;");
+  iterator_t ids;
 
-      sql ("%s", result_nvts_buffer->str);
-      g_string_truncate (result_nvts_buffer, 0);
-    }
+  if (rows->len == 0)
+    return 0;
 
-  if (results_buffer && strlen (results_buffer->str))
-    {
-      if (report)
-        {
-          iterator_t ids;
+  sql ("CREATE TEMPORARY TABLE IF NOT EXISTS slave_results"
+       " (position integer, host text, hostname text, port text, nvt text,"
+       "  nvt_version text, severity real, type text, description text,"
+       "  qod integer, qod_type text);");
 
-          g_string_append (results_buffer, " RETURNING id;");
+  if (sql_copy_start ("COPY slave_results"
+                      " (position, host, hostname, port, nvt, nvt_version,"
+                      "  severity, type, description, qod, qod_type)"
+                      " FROM STDIN;"))
+    return -1;
+  if (sql_copy_data (rows->str, rows->len))
+    {
+      sql_copy_end ("Failed to send slave results");
+      return -1;
+    }
+  g_string_truncate (rows, 0);
+  if (sql_copy_end (NULL))
+    return -1;
 
-          init_iterator (&ids, "%s", results_buffer->str);
-          while (next (&ids))
-            report_add_result_for_buffer (report, iterator_int64 (&ids, 0));
-          cleanup_iterator (&ids);
+  sql ("INSERT INTO result_nvts (nvt)"
+       " SELECT DISTINCT nvt FROM slave_results"
+       " ON CONFLICT (nvt) DO NOTHING;");
+
+  init_iterator (&ids,
+                 "INSERT into results"
+                 " (owner, date, task, host, hostname, port,"
+                 "  nvt, nvt_version, severity, type,"
+                 "  description, uuid, qod, qod_type, result_nvt,"
+                 "  report)"
+                 " SELECT %llu, m_now (), %llu, host, hostname, port,"
+                 "        nvt, nvt_version, severity, type,"
+                 "        description, make_uuid (), qod, qod_type,"
+                 "        (SELECT id FROM result_nvts"
+                 "         WHERE result_nvts.nvt = slave_results.nvt),"
+                 "        %llu"
+                 " FROM slave_results"
+                 " ORDER BY position"
+                 " RETURNING id;",
+                 owner, task, report);
+  while (next (&ids))
+    report_add_result_for_buffer (report, iterator_int64 (&ids, 0));
+  cleanup_iterator (&ids);
+
+  sql ("TRUNCATE slave_results;");
 
-          sql ("UPDATE report_counts"
-               " SET end_time = (SELECT coalesce(min(overrides.end_time), 0)"
-               "                 FROM overrides, results"
-               "                 WHERE overrides.nvt = results.nvt"
-               "                 AND results.report = %llu"
-               "                 AND overrides.end_time >= m_now ())"
-               " WHERE report = %llu AND override = 1;",
-               report, report);
-        }
-      else
-        sql ("%s", results_buffer->str);
+  sql ("UPDATE report_counts"
+       " SET end_time = (SELECT coalesce(min(overrides.end_time), 0)"
+       "                 FROM overrides, results"
+       "                 WHERE overrides.nvt = results.nvt"
+       "                 AND results.report = %llu"
+       "                 AND overrides.end_time >= m_now ())"
+       " WHERE report = %llu AND override = 1;",
+       report, report);
 
-      g_string_truncate (results_buffer, 0);
-    }
+  return 0;
 }
 
 /**
@@ -42776,8 +50238,9 @@ update_from_slave (task_t task, entity_t get_report, entity_t *report,
 {
   entity_t entity, host, start;
   entities_t results, hosts, entities;
-  int current_commit_size;
-  GString *results_buffer, *result_nvts_buffer;
+  int current_commit_size, position;
+  GString *rows;
+  GHashTable *nvts;
   user_t owner;
 
   entity = entity_child (get_report, "report");
@@ -42847,11 +50310,13 @@ update_from_slave (task_t task, entity_t get_report, entity_t *report,
   owner = sql_int64_0 ("SELECT reports.owner FROM reports WHERE id = %llu;",
                        global_current_report);
 
+  nvts = slave_nvts_new (entity->entities);
+
   sql_begin_immediate ();
   results = entity->entities;
   current_commit_size = 0;
-  results_buffer = g_string_new ("");
-  result_nvts_buffer = g_string_new ("");
+  position = 0;
+  rows = g_string_new ("");
   while ((entity = first_entity (results)))
     {
       if (strcmp (entity_name (entity), "result") == 0)
@@ -42861,47 +50326,45 @@ update_from_slave (task_t task, entity_t get_report, entity_t *report,
 
           result_host = entity_child (entity, "host");
           if (result_host == NULL)
-            goto rollback_fail;
+            goto rollback_free_fail;
 
           hostname = entity_child (result_host, "hostname");
 
           port = entity_child (entity, "port");
           if (port == NULL)
-            goto rollback_fail;
+            goto rollback_free_fail;
 
           nvt = entity_child (entity, "nvt");
           if (nvt == NULL)
-            goto rollback_fail;
+            goto rollback_free_fail;
           oid = entity_attribute (nvt, "oid");
           if ((oid == NULL) || (strlen (oid) == 0))
-            goto rollback_fail;
+            goto rollback_free_fail;
 
           threat = entity_child (entity, "threat");
           if (threat == NULL)
-            goto rollback_fail;
+            goto rollback_free_fail;
 
           description = entity_child (entity, "description");
           if (description == NULL)
-            goto rollback_fail;
-
-          buffer_insert (results_buffer,
-                         result_nvts_buffer,
-                         task,
-                         entity_text (result_host),
-                         hostname ? entity_text (hostname) : "",
-                         entity_text (port),
-                         oid,
-                         threat_message_type (entity_text (threat)),
-                         entity_text (description),
-                         global_current_report,
-                         owner);
+            goto rollback_free_fail;
+
+          slave_result_copy (rows,
+                             nvts,
+                             position++,
+                             entity_text (result_host),
+                             hostname ? entity_text (hostname) : "",
+                             entity_text (port),
+                             oid,
+                             threat_message_type (entity_text (threat)),
+                             entity_text (description));
 
           current_commit_size++;
           if (slave_commit_size && current_commit_size >= slave_commit_size)
             {
-              update_from_slave_insert (results_buffer,
-                                        result_nvts_buffer,
-                                        global_current_report);
+              if (update_from_slave_merge (rows, task, global_current_report,
+                                           owner))
+                goto rollback_free_fail;
               sql_commit ();
               sql_begin_immediate ();
               current_commit_size = 0;
@@ -42911,11 +50374,10 @@ update_from_slave (task_t task, entity_t get_report, entity_t *report,
         }
       results = next_entities (results);
     }
-  update_from_slave_insert (results_buffer,
-                            result_nvts_buffer,
-                            global_current_report);
-  g_string_free (results_buffer, TRUE);
-  g_string_free (result_nvts_buffer, TRUE);
+  if (update_from_slave_merge (rows, task, global_current_report, owner))
+    goto rollback_free_fail;
+  g_string_free (rows, TRUE);
+  g_hash_table_destroy (nvts);
   sql_commit ();
 
   sql_begin_immediate ();
@@ -42960,6 +50422,9 @@ update_from_slave (task_t task, entity_t get_report, entity_t *report,
   sql_commit ();
   return 0;
 
+ rollback_free_fail:
+  g_string_free (rows, TRUE);
+  g_hash_table_destroy (nvts);
  rollback_fail:
   sql_rollback ();
   return -1;
@@ -44158,10 +51623,8 @@ create_permission_internal (int check_access, const char *name_arg,
     *permission = sql_last_insert_id ();
 
   /* Update Permissions cache */
-  if (strcasecmp (quoted_name, "super") == 0)
-    cache_all_permissions_for_users (NULL);
-  else if (resource_type && resource)
-    cache_permissions_for_resource (resource_type, resource, NULL);
+  cache_permissions_for_permission (quoted_name, resource_type, resource,
+                                    subject_where);
 
   /* Update Reports cache */
   if (resource_type && resource_id && strcmp (resource_type, "override") == 0)
@@ -44187,7 +51650,7 @@ create_permission_internal (int check_access, const char *name_arg,
                                     ((gpointer*)&reports_ptr), NULL))
         {
           if (auto_cache_rebuild)
-            report_cache_counts (*reports_ptr, clear_original, 1,
+            report_queue_counts (*reports_ptr, clear_original, 1,
                                  subject_where);
           else
             report_clear_count_cache (*reports_ptr, clear_original, 1,
@@ -45082,10 +52545,8 @@ delete_permission (const char *permission_id, int ultimate)
   sql ("DELETE FROM permissions WHERE id = %llu;", permission);
 
   /* Update Permissions cache */
-  if (strcasecmp (name, "super") == 0)
-    cache_all_permissions_for_users (NULL);
-  else if (resource_type && resource)
-    cache_permissions_for_resource (resource_type, resource, NULL);
+  cache_permissions_for_permission (name, resource_type, resource,
+                                    subject_where);
 
   /* Update Reports cache */
   if (resource_type && resource && strcmp (resource_type, "override") == 0)
@@ -45113,7 +52574,7 @@ delete_permission (const char *permission_id, int ultimate)
                                     ((gpointer*)&reports_ptr), NULL))
         {
           if (auto_cache_rebuild)
-            report_cache_counts (*reports_ptr, clear_original, 1,
+            report_queue_counts (*reports_ptr, clear_original, 1,
                                  subject_where);
           else
             report_clear_count_cache (*reports_ptr, clear_original, 1,
@@ -45349,19 +52810,22 @@ modify_permission (const char *permission_id, const char *name_arg,
 
   /* Update permission caches according to the modifications. */
 
-  if (strcasecmp (name, "super") == 0 || strcasecmp (old_name, "super") == 0)
-    cache_all_permissions_for_users (NULL);
+  if (strcasecmp (quoted_name, "super") == 0
+      || strcasecmp (old_name, "super") == 0)
+    cache_permissions_for_permission ("super", NULL, 0, subject_where);
   else
     {
       if (resource_type && resource_id && strcmp (resource_id, ""))
-        cache_permissions_for_resource (resource_type, resource, NULL);
+        cache_permissions_for_permission (quoted_name, resource_type,
+                                          resource, subject_where);
 
       if (old_resource
           && old_resource_type
           && ((resource != old_resource)
               || (resource_type
                   && strcmp (old_resource_type, resource_type))))
-        cache_permissions_for_resource (old_resource_type, old_resource, NULL);
+        cache_permissions_for_permission (old_name, old_resource_type,
+                                          old_resource, subject_where);
     }
 
   /* Check if caches are affected by the permission and update reports cache */
@@ -45394,7 +52858,7 @@ modify_permission (const char *permission_id, const char *name_arg,
                                     ((gpointer*)&reports_ptr), NULL))
         {
           if (auto_cache_rebuild)
-            report_cache_counts (*reports_ptr, clear_original, 1,
+            report_queue_counts (*reports_ptr, clear_original, 1,
                                  subject_where);
           else
             report_clear_count_cache (*reports_ptr, clear_original, 1,
@@ -47598,7 +55062,7 @@ manage_restore (const char *id)
                                     ((gpointer*)&reports_ptr), NULL))
         {
           if (auto_cache_rebuild)
-            report_cache_counts (*reports_ptr, 0, 1, users_where);
+            report_queue_counts (*reports_ptr, 0, 1, users_where);
           else
             report_clear_count_cache (*reports_ptr, 0, 1, users_where);
         }
@@ -47653,11 +55117,8 @@ manage_restore (const char *id)
 
       tags_set_locations ("permission", resource, permission, LOCATION_TABLE);
 
-      if (strcasecmp (name, "super") == 0)
-        cache_all_permissions_for_users (NULL);
-      else if (perm_resource != 0
-               && resource_type && strcmp (resource_type, ""))
-        cache_permissions_for_resource (resource_type, perm_resource, NULL);
+      cache_permissions_for_permission (name, resource_type, perm_resource,
+                                        subject_where);
 
       /* Update Reports cache */
       if (resource_type && perm_resource
@@ -47684,7 +55145,7 @@ manage_restore (const char *id)
                                         ((gpointer*)&reports_ptr), NULL))
             {
               if (auto_cache_rebuild)
-                report_cache_counts (*reports_ptr, clear_original, 1,
+                report_queue_counts (*reports_ptr, clear_original, 1,
                                      subject_where);
               else
                 report_clear_count_cache (*reports_ptr, clear_original, 1,
@@ -48065,10 +55526,10 @@ manage_restore (const char *id)
       sql ("INSERT INTO results"
            " (uuid, task, host, port, nvt, result_nvt, type, description,"
            "  report, nvt_version, severity, qod, qod_type, owner, date,"
-           "  hostname)"
+           "  hostname, fingerprint)"
            " SELECT uuid, task, host, port, nvt, result_nvt, type,"
            "        description, report, nvt_version, severity, qod,"
-           "         qod_type, owner, date, hostname"
+           "         qod_type, owner, date, hostname, fingerprint"
            " FROM results_trash"
            " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
            resource);
@@ -48085,6 +55546,9 @@ manage_restore (const char *id)
       sql ("DELETE FROM report_counts"
            " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
            resource);
+      sql ("DELETE FROM result_severities"
+           " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
+           resource);
 
       sql ("UPDATE tasks SET hidden = 0 WHERE id = %llu;", resource);
 
@@ -48113,6 +55577,25 @@ manage_restore (const char *id)
 int
 manage_empty_trashcan ()
 {
+  gchar *trash_reports;
+  int ret;
+
+  if (acl_user_may ("empty_trashcan") == 0)
+    return 99;
+
+  /* Delete the reports of the trash tasks first, in chunks, so that a full
+   * trashcan does not lock the reports for the whole deletion. */
+
+  trash_reports = g_strdup_printf ("task IN (SELECT id FROM tasks"
+                                   "         WHERE hidden = 2"
+                                   "         AND owner = (SELECT id FROM users"
+                                   "                      WHERE uuid = '%s'))",
+                                   current_credentials.uuid);
+  while ((ret = delete_reports_chunk (trash_reports, 1)) > 0);
+  g_free (trash_reports);
+  if (ret < 0)
+    return -1;
+
   sql_begin_immediate ();
 
   if (acl_user_may ("empty_trashcan") == 0)
@@ -48472,6 +55955,10 @@ identifier_free (identifier_t *identifier)
  * for each host that has identifiers.  The rules for this decision are described
  * in \ref asset_rules.  (The initial decision is made by \ref host_notice.)
  *
+ * The identifiers are loaded into temporary tables, so that all hosts are
+ * matched and updated with a few set-based statements, instead of a round
+ * of statements per host.
+ *
  * @param[in]  report  Report that the identifiers come from.
  */
 void
@@ -48479,253 +55966,228 @@ hosts_set_identifiers (report_t report)
 {
   if (identifier_hosts)
     {
-      int host_index, index;
-      gchar *ip;
+      int index;
+      gchar *ip, *os_select;
+      identifier_t *identifier;
+      osp_inserts_t inserts;
+      user_t owner;
 
       array_terminate (identifiers);
       array_terminate (identifier_hosts);
 
-      host_index = 0;
-      while ((ip = (gchar*) g_ptr_array_index (identifier_hosts, host_index)))
-        {
-          host_t host, host_new;
-          gchar *quoted_host_name;
-          identifier_t *identifier;
-          GString *select;
-
-          if (report_host_noticeable (report, ip) == 0)
-            continue;
-
-          quoted_host_name = sql_quote (ip);
-
-          select = g_string_new ("");
-
-          /* Select the most recent host whose identifiers all match the given
-           * identifiers, even if the host has fewer identifiers than given. */
-
-          g_string_append_printf (select,
-                                  "SELECT id FROM hosts"
-                                  " WHERE name = '%s'"
-                                  " AND owner = (SELECT id FROM users"
-                                  "              WHERE uuid = '%s')",
-                                  quoted_host_name,
-                                  current_credentials.uuid);
-
-          index = 0;
-          while ((identifier = (identifier_t*) g_ptr_array_index (identifiers, index)))
-            {
-              gchar *quoted_identifier_name, *quoted_identifier_value;
-
-              if (strcmp (identifier->ip, ip))
-                {
-                  index++;
-                  continue;
-                }
-
-              quoted_identifier_name = sql_quote (identifier->name);
-              quoted_identifier_value = sql_quote (identifier->value);
-
-              g_string_append_printf (select,
-                                      " AND (EXISTS (SELECT * FROM host_identifiers"
-                                      "              WHERE host = hosts.id"
-                                      "              AND owner = (SELECT id FROM users"
-                                      "                           WHERE uuid = '%s')"
-                                      "              AND name = '%s'"
-                                      "              AND value = '%s')"
-                                      "      OR NOT EXISTS (SELECT * FROM host_identifiers"
-                                      "                     WHERE host = hosts.id"
-                                      "                     AND owner = (SELECT id FROM users"
-                                      "                                  WHERE uuid = '%s')"
-                                      "                     AND name = '%s'))",
-                                      current_credentials.uuid,
-                                      quoted_identifier_name,
-                                      quoted_identifier_value,
-                                      current_credentials.uuid,
-                                      quoted_identifier_name);
-
-              g_free (quoted_identifier_name);
-              g_free (quoted_identifier_value);
-
-              index++;
-            }
-
-          g_string_append_printf (select,
-                                  " ORDER BY creation_time DESC LIMIT 1;");
-
-          switch (sql_int64 (&host, select->str))
-            {
-              case 0:
-                break;
-              case 1:        /* Too few rows in result of query. */
-                host = 0;
-                break;
-              default:       /* Programming error. */
-                assert (0);
-              case -1:
-                host = 0;
-                break;
-            }
-
-          g_string_free (select, TRUE);
-
-          if (host == 0)
-            {
-              /* Add the host. */
-
-              sql ("INSERT into hosts"
-                   " (uuid, owner, name, comment, creation_time, modification_time)"
-                   " VALUES"
-                   " (make_uuid (), (SELECT id FROM users WHERE uuid = '%s'), '%s', '',"
-                   "  m_now (), m_now ());",
-                   current_credentials.uuid,
-                   quoted_host_name);
-
-              host_new = host = sql_last_insert_id ();
-
-              /* Make sure the Report Host identifiers added when the host was
-               * first noticed now refer to the new host. */
-
-              sql ("UPDATE host_identifiers SET host = %llu"
-                   " WHERE source_id = (SELECT uuid FROM reports"
-                   "                    WHERE id = %llu)"
-                   " AND name = 'ip'"
-                   " AND value = '%s';",
-                   host_new,
-                   report,
-                   quoted_host_name);
-            }
-          else
-            {
-              /* Use the existing host. */
-
-              host_new = 0;
-            }
+      owner = 0;
+      sql_int64 (&owner,
+                 "SELECT id FROM users WHERE uuid = '%s';",
+                 current_credentials.uuid);
 
-          /* Add the host identifiers. */
+      sql ("CREATE TEMPORARY TABLE scan_identifier_hosts"
+           " (ip text PRIMARY KEY, host integer, added integer);");
+      sql ("CREATE TEMPORARY TABLE scan_identifiers"
+           " (id SERIAL PRIMARY KEY, ip text, name text, value text,"
+           "  source_type text, source_id text, source_data text);");
 
-          index = 0;
-          while ((identifier = (identifier_t*) g_ptr_array_index (identifiers,
-                                                                  index)))
-            {
-              gchar *quoted_identifier_name, *quoted_identifier_value;
-              gchar *quoted_source_id, *quoted_source_type, *quoted_source_data;
-
-              if (strcmp (identifier->ip, ip))
-                {
-                  index++;
-                  continue;
-                }
+      /* Load the hosts and their identifiers. */
 
-              quoted_identifier_name = sql_quote (identifier->name);
-              quoted_identifier_value = sql_quote (identifier->value);
-              quoted_source_id = sql_quote (identifier->source_id);
-              quoted_source_data = sql_quote (identifier->source_data);
-              quoted_source_type = sql_quote (identifier->source_type);
-
-              if (strcmp (identifier->name, "OS") == 0)
-                {
-                  resource_t os;
-
-                  switch (sql_int64 (&os,
-                                     "SELECT id FROM oss"
-                                     " WHERE name = '%s'"
-                                     " AND owner = (SELECT id FROM users"
-                                     "              WHERE uuid = '%s');",
-                                     quoted_identifier_value,
-                                     current_credentials.uuid))
-                    {
-                      case 0:
-                        break;
-                      default:       /* Programming error. */
-                        assert (0);
-                      case -1:
-                      case 1:        /* Too few rows in result of query. */
-                        sql ("INSERT into oss"
-                             " (uuid, owner, name, comment, creation_time,"
-                             "  modification_time)"
-                             " VALUES"
-                             " (make_uuid (),"
-                             "  (SELECT id FROM users WHERE uuid = '%s'),"
-                             "  '%s', '', m_now (), m_now ());",
-                             current_credentials.uuid,
-                             quoted_identifier_value);
-                        os = sql_last_insert_id ();
-                        break;
-                    }
+      osp_inserts_init (&inserts,
+                        "INSERT INTO scan_identifier_hosts (ip, added) VALUES ");
+      index = 0;
+      while ((ip = (gchar*) g_ptr_array_index (identifier_hosts, index++)))
+        {
+          gchar *quoted_ip;
 
-                  sql ("INSERT into host_oss"
-                       " (uuid, host, owner, name, comment, os, source_type,"
-                       "  source_id, source_data, creation_time, modification_time)"
-                       " VALUES"
-                       " (make_uuid (), %llu,"
-                       "  (SELECT id FROM users WHERE uuid = '%s'),"
-                       "  '%s', '', %llu, '%s', '%s', '%s', m_now (), m_now ());",
-                       host,
-                       current_credentials.uuid,
-                       quoted_identifier_name,
-                       os,
-                       quoted_source_type,
-                       quoted_source_id,
-                       quoted_source_data);
+          quoted_ip = sql_quote (ip);
+          osp_inserts_next (&inserts);
+          g_string_append_printf (inserts.statement, "('%s', 0)", quoted_ip);
+          g_free (quoted_ip);
+        }
+      osp_inserts_flush (&inserts);
+      osp_inserts_free (&inserts);
 
-                  if (host_new == 0)
-                    {
-                      sql ("UPDATE hosts"
-                           " SET modification_time = (SELECT modification_time"
-                           "                          FROM host_oss"
-                           "                          WHERE id = %llu)"
-                           " WHERE id = %llu;",
-                           sql_last_insert_id (),
-                           host);
-
-                      sql ("UPDATE oss"
-                           " SET modification_time = (SELECT modification_time"
-                           "                          FROM host_oss"
-                           "                          WHERE id = %llu)"
-                           " WHERE id = %llu;",
-                           sql_last_insert_id (),
-                           os);
-                    }
-                }
-              else
-                {
-                  sql ("INSERT into host_identifiers"
-                       " (uuid, host, owner, name, comment, value, source_type,"
-                       "  source_id, source_data, creation_time, modification_time)"
-                       " VALUES"
-                       " (make_uuid (), %llu,"
-                       "  (SELECT id FROM users WHERE uuid = '%s'),"
-                       "  '%s', '', '%s', '%s', '%s', '%s', m_now (), m_now ());",
-                       host,
-                       current_credentials.uuid,
-                       quoted_identifier_name,
-                       quoted_identifier_value,
-                       quoted_source_type,
-                       quoted_source_id,
-                       quoted_source_data);
-
-                  if (host_new == 0)
-                    sql ("UPDATE hosts"
-                         " SET modification_time = (SELECT modification_time"
-                         "                          FROM host_identifiers"
-                         "                          WHERE id = %llu)"
-                         " WHERE id = %llu;",
-                         sql_last_insert_id (),
-                         host);
-                }
+      osp_inserts_init (&inserts,
+                        "INSERT INTO scan_identifiers"
+                        " (ip, name, value, source_type, source_id,"
+                        "  source_data)"
+                        " VALUES ");
+      index = 0;
+      while ((identifier = (identifier_t*) g_ptr_array_index (identifiers,
+                                                              index++)))
+        {
+          gchar *quoted_ip, *quoted_name, *quoted_value;
+          gchar *quoted_source_type, *quoted_source_id, *quoted_source_data;
+
+          quoted_ip = sql_quote (identifier->ip);
+          quoted_name = sql_quote (identifier->name);
+          quoted_value = sql_quote (identifier->value);
+          quoted_source_type = sql_quote (identifier->source_type);
+          quoted_source_id = sql_quote (identifier->source_id);
+          quoted_source_data = sql_quote (identifier->source_data);
+
+          osp_inserts_next (&inserts);
+          g_string_append_printf (inserts.statement,
+                                  "('%s', '%s', '%s', '%s', '%s', '%s')",
+                                  quoted_ip,
+                                  quoted_name,
+                                  quoted_value,
+                                  quoted_source_type,
+                                  quoted_source_id,
+                                  quoted_source_data);
+
+          g_free (quoted_ip);
+          g_free (quoted_name);
+          g_free (quoted_value);
+          g_free (quoted_source_type);
+          g_free (quoted_source_id);
+          g_free (quoted_source_data);
+        }
+      osp_inserts_flush (&inserts);
+      osp_inserts_free (&inserts);
+
+      /* Skip hosts that are dead or have no results, as in
+       * report_host_noticeable. */
+
+      sql ("DELETE FROM scan_identifier_hosts"
+           " WHERE NOT EXISTS"
+           "        (SELECT * FROM report_hosts"
+           "         WHERE report = %llu"
+           "         AND host = scan_identifier_hosts.ip"
+           "         AND NOT EXISTS (SELECT * FROM report_host_details"
+           "                         WHERE report_host = report_hosts.id"
+           "                         AND name = 'Host dead'"
+           "                         AND value != '0'))"
+           " OR NOT EXISTS (SELECT * FROM results"
+           "                WHERE report = %llu"
+           "                AND host = scan_identifier_hosts.ip);",
+           report,
+           report);
 
-              g_free (quoted_source_type);
-              g_free (quoted_source_id);
-              g_free (quoted_source_data);
-              g_free (quoted_identifier_name);
-              g_free (quoted_identifier_value);
+      /* Select the most recent host whose identifiers all match the given
+       * identifiers, even if the host has fewer identifiers than given. */
+
+      sql ("UPDATE scan_identifier_hosts"
+           " SET host = (SELECT id FROM hosts"
+           "             WHERE name = scan_identifier_hosts.ip"
+           "             AND owner = %llu"
+           "             AND NOT EXISTS"
+           "                  (SELECT * FROM scan_identifiers"
+           "                   WHERE scan_identifiers.ip"
+           "                         = scan_identifier_hosts.ip"
+           "                   AND EXISTS"
+           "                        (SELECT * FROM host_identifiers"
+           "                         WHERE host = hosts.id"
+           "                         AND owner = %llu"
+           "                         AND name = scan_identifiers.name)"
+           "                   AND NOT EXISTS"
+           "                        (SELECT * FROM host_identifiers"
+           "                         WHERE host = hosts.id"
+           "                         AND owner = %llu"
+           "                         AND name = scan_identifiers.name"
+           "                         AND value = scan_identifiers.value))"
+           "             ORDER BY creation_time DESC LIMIT 1);",
+           owner,
+           owner,
+           owner);
+
+      /* Add the hosts that did not match. */
+
+      sql ("WITH new_hosts"
+           " AS (INSERT into hosts"
+           "      (uuid, owner, name, comment, creation_time,"
+           "       modification_time)"
+           "     SELECT make_uuid (), %llu, ip, '', m_now (), m_now ()"
+           "     FROM scan_identifier_hosts"
+           "     WHERE host IS NULL"
+           "     RETURNING id, name)"
+           " UPDATE scan_identifier_hosts"
+           " SET host = new_hosts.id, added = 1"
+           " FROM new_hosts"
+           " WHERE scan_identifier_hosts.ip = new_hosts.name"
+           " AND scan_identifier_hosts.host IS NULL;",
+           owner);
+
+      /* Make sure the Report Host identifiers added when the hosts were
+       * first noticed now refer to the new hosts. */
+
+      sql ("UPDATE host_identifiers SET host = scan_identifier_hosts.host"
+           " FROM scan_identifier_hosts"
+           " WHERE scan_identifier_hosts.added = 1"
+           " AND host_identifiers.source_id = (SELECT uuid FROM reports"
+           "                                   WHERE id = %llu)"
+           " AND host_identifiers.name = 'ip'"
+           " AND host_identifiers.value = scan_identifier_hosts.ip;",
+           report);
 
-              index++;
-            }
+      /* Add the OSs, and the OS identifiers. */
 
-          g_free (quoted_host_name);
-          host_index++;
-        }
+      sql ("INSERT into oss"
+           " (uuid, owner, name, comment, creation_time, modification_time)"
+           " SELECT make_uuid (), %llu, value, '', m_now (), m_now ()"
+           " FROM (SELECT DISTINCT value FROM scan_identifiers"
+           "       WHERE name = 'OS'"
+           "       AND ip IN (SELECT ip FROM scan_identifier_hosts))"
+           "      AS os_names"
+           " WHERE NOT EXISTS (SELECT * FROM oss"
+           "                   WHERE name = os_names.value"
+           "                   AND owner = %llu);",
+           owner,
+           owner);
+
+      os_select = g_strdup_printf ("(SELECT id FROM oss"
+                                   " WHERE name = scan_identifiers.value"
+                                   " AND owner = %llu"
+                                   " ORDER BY id LIMIT 1)",
+                                   owner);
+
+      sql ("INSERT into host_oss"
+           " (uuid, host, owner, name, comment, os, source_type,"
+           "  source_id, source_data, creation_time, modification_time)"
+           " SELECT make_uuid (), scan_identifier_hosts.host, %llu,"
+           "        scan_identifiers.name, '', %s,"
+           "        scan_identifiers.source_type, scan_identifiers.source_id,"
+           "        scan_identifiers.source_data, m_now (), m_now ()"
+           " FROM scan_identifiers, scan_identifier_hosts"
+           " WHERE scan_identifiers.ip = scan_identifier_hosts.ip"
+           " AND scan_identifiers.name = 'OS'"
+           " ORDER BY scan_identifiers.id;",
+           owner,
+           os_select);
+
+      sql ("UPDATE oss SET modification_time = m_now ()"
+           " WHERE id IN (SELECT %s"
+           "              FROM scan_identifiers, scan_identifier_hosts"
+           "              WHERE scan_identifiers.ip"
+           "                    = scan_identifier_hosts.ip"
+           "              AND scan_identifiers.name = 'OS'"
+           "              AND scan_identifier_hosts.added = 0);",
+           os_select);
+
+      g_free (os_select);
+
+      /* Add the other host identifiers. */
+
+      sql ("INSERT into host_identifiers"
+           " (uuid, host, owner, name, comment, value, source_type,"
+           "  source_id, source_data, creation_time, modification_time)"
+           " SELECT make_uuid (), scan_identifier_hosts.host, %llu,"
+           "        scan_identifiers.name, '', scan_identifiers.value,"
+           "        scan_identifiers.source_type, scan_identifiers.source_id,"
+           "        scan_identifiers.source_data, m_now (), m_now ()"
+           " FROM scan_identifiers, scan_identifier_hosts"
+           " WHERE scan_identifiers.ip = scan_identifier_hosts.ip"
+           " AND scan_identifiers.name != 'OS'"
+           " ORDER BY scan_identifiers.id;",
+           owner);
+
+      /* Existing hosts were modified by their new identifiers. */
+
+      sql ("UPDATE hosts SET modification_time = m_now ()"
+           " WHERE id IN (SELECT host FROM scan_identifier_hosts"
+           "              WHERE added = 0"
+           "              AND EXISTS (SELECT * FROM scan_identifiers"
+           "                          WHERE scan_identifiers.ip"
+           "                                = scan_identifier_hosts.ip));");
+
+      sql ("DROP TABLE scan_identifiers;");
+      sql ("DROP TABLE scan_identifier_hosts;");
 
       index = 0;
       while (identifiers && (index < identifiers->len))
@@ -48739,16 +56201,128 @@ hosts_set_identifiers (report_t report)
 }
 
 /**
- * @brief Set the maximum severity of each host in a scan.
+ * @brief Add a scan to the daily trends of its hosts.
  *
- * @param[in]  report         The report associated with the scan.
- * @param[in]  overrides_arg  Whether override should be applied.
- * @param[in]  min_qod_arg    Min QOD to use.
+ * Each host has one row per UTC day, with the figures of the last scan of
+ * the host on the day.  A vulnerability is an NVT with a severity above 0.  It
+ * is closed when the previous scan of the host found it and this scan did
+ * not.  A scan that is older than the latest trend of a host, like an
+ * imported one, leaves the open vulnerabilities of the host alone.
+ *
+ * @param[in]  report            The report associated with the scan.
+ * @param[in]  new_severity_sql  SQL for the severity of a result.
+ * @param[in]  min_qod           Min QOD to use.
  */
-void
-hosts_set_max_severity (report_t report, int *overrides_arg, int *min_qod_arg)
+static void
+host_trends_add (report_t report, const gchar *new_severity_sql, int min_qod)
+{
+  char *report_id;
+  time_t scan_time;
+  long day;
+
+  report_id = report_uuid (report);
+  if (report_id == NULL)
+    return;
+
+  scan_time = sql_int64_0 ("SELECT coalesce (nullif (end_time, 0),"
+                           "                 nullif (start_time, 0),"
+                           "                 date)"
+                           " FROM reports WHERE id = %llu;",
+                           report);
+  /* Days are UTC days, so that the points line up across users. */
+  day = day_start_utc (scan_time);
+
+  /* Work out the severity of each result once. */
+  sql ("CREATE TEMPORARY TABLE IF NOT EXISTS host_trend_results"
+       " (host integer, nvt text, severity double precision);");
+  sql ("INSERT INTO host_trend_results (host, nvt, severity)"
+       " SELECT asset_host, results.nvt, %s"
+       " FROM (SELECT DISTINCT host AS asset_host"
+       "       FROM host_identifiers"
+       "       WHERE source_id = '%s')"
+       "      AS assets"
+       " LEFT JOIN results"
+       " ON results.report = %llu"
+       " AND results.qod >= %i"
+       " AND results.host = (SELECT name FROM hosts WHERE id = asset_host);",
+       new_severity_sql,
+       report_id,
+       report,
+       min_qod);
+  free (report_id);
+
+  sql ("INSERT INTO host_trends"
+       " (host, day, report, max_severity, high, medium, low, log, open,"
+       "  closed)"
+       " SELECT host, %li, %llu,"
+       "        coalesce (max (severity), 0.0),"
+       "        count (*) FILTER (WHERE severity_in_level (severity, 'high')),"
+       "        count (*) FILTER (WHERE severity_in_level (severity,"
+       "                                                   'medium')),"
+       "        count (*) FILTER (WHERE severity_in_level (severity, 'low')),"
+       "        count (*) FILTER (WHERE severity_in_level (severity, 'log')),"
+       "        count (DISTINCT nvt) FILTER (WHERE severity > 0.0),"
+       "        CASE WHEN EXISTS (SELECT * FROM host_trends AS later"
+       "                          WHERE later.host = host_trend_results.host"
+       "                          AND later.day > %li)"
+       "        THEN 0"
+       "        ELSE (SELECT count (*) FROM host_open_nvts"
+       "              WHERE host_open_nvts.host = host_trend_results.host"
+       "              AND nvt NOT IN (SELECT nvt FROM host_trend_results"
+       "                                              AS found"
+       "                              WHERE found.host = host_open_nvts.host"
+       "                              AND found.severity > 0.0))"
+       "        END"
+       " FROM host_trend_results"
+       " GROUP BY host"
+       " ON CONFLICT (host, day)"
+       " DO UPDATE SET report = EXCLUDED.report,"
+       "               max_severity = EXCLUDED.max_severity,"
+       "               high = EXCLUDED.high,"
+       "               medium = EXCLUDED.medium,"
+       "               low = EXCLUDED.low,"
+       "               log = EXCLUDED.log,"
+       "               open = EXCLUDED.open,"
+       "               closed = host_trends.closed + EXCLUDED.closed;",
+       day,
+       report,
+       day);
+
+  sql ("DELETE FROM host_open_nvts"
+       " WHERE host IN (SELECT host FROM host_trend_results)"
+       " AND NOT EXISTS (SELECT * FROM host_trends"
+       "                 WHERE host_trends.host = host_open_nvts.host"
+       "                 AND day > %li);",
+       day);
+  sql ("INSERT INTO host_open_nvts (host, nvt)"
+       " SELECT DISTINCT host, nvt FROM host_trend_results"
+       " WHERE severity > 0.0"
+       " AND NOT EXISTS (SELECT * FROM host_trends"
+       "                 WHERE host_trends.host = host_trend_results.host"
+       "                 AND day > %li);",
+       day);
+
+  sql ("DELETE FROM host_trend_results;");
+}
+
+/**
+ * @brief Get the SQL for the severity of a result, for the assets of a scan.
+ *
+ * The severity is the one that the current user sees.
+ *
+ * @param[in]   report         The report associated with the scan.
+ * @param[in]   overrides_arg  Whether override should be applied, or NULL
+ *                             for the task preference.
+ * @param[in]   min_qod_arg    Min QOD to use, or NULL for the task
+ *                             preference.
+ * @param[out]  min_qod_return Return for the min QOD.
+ *
+ * @return Freshly allocated SQL expression.
+ */
+static gchar *
+hosts_severity_sql (report_t report, int *overrides_arg, int *min_qod_arg,
+                    int *min_qod_return)
 {
-  gchar *new_severity_sql;
   int overrides, min_qod;
 
   if (overrides_arg)
@@ -48787,17 +56361,36 @@ hosts_set_max_severity (report_t report, int *overrides_arg, int *min_qod_arg)
         }
     }
 
-  new_severity_sql
-    = g_strdup_printf ("(SELECT new_severity FROM result_new_severities"
-                       " WHERE result_new_severities.result = results.id"
-                       " AND result_new_severities.user"
-                       "     = (SELECT id FROM users WHERE uuid = '%s')"
-                       " AND override = %d"
-                       " AND dynamic = %d"
-                       " LIMIT 1)",
-                       current_credentials.uuid,
-                       overrides,
-                       setting_dynamic_severity_int ());
+  *min_qod_return = min_qod;
+  return g_strdup_printf ("(SELECT new_severity FROM result_new_severities"
+                          " WHERE result_new_severities.result = results.id"
+                          " AND result_new_severities.user"
+                          "     = (SELECT id FROM users WHERE uuid = '%s')"
+                          " AND override = %d"
+                          " AND dynamic = %d"
+                          " LIMIT 1)",
+                          current_credentials.uuid,
+                          overrides,
+                          setting_dynamic_severity_int ());
+}
+
+/**
+ * @brief Set the maximum severity of each host in a scan.
+ *
+ * Also adds the scan to the daily trends of the hosts.
+ *
+ * @param[in]  report         The report associated with the scan.
+ * @param[in]  overrides_arg  Whether override should be applied.
+ * @param[in]  min_qod_arg    Min QOD to use.
+ */
+void
+hosts_set_max_severity (report_t report, int *overrides_arg, int *min_qod_arg)
+{
+  gchar *new_severity_sql;
+  int min_qod;
+
+  new_severity_sql = hosts_severity_sql (report, overrides_arg, min_qod_arg,
+                                         &min_qod);
 
   sql ("INSERT INTO host_max_severities"
        " (host, severity, source_type, source_id, creation_time)"
@@ -48821,9 +56414,62 @@ hosts_set_max_severity (report_t report, int *overrides_arg, int *min_qod_arg)
        report,
        report);
 
+  host_trends_add (report, new_severity_sql, min_qod);
+  aggregate_rollups_refresh_assets ();
+
   g_free (new_severity_sql);
 }
 
+/**
+ * @brief Add the finished scans in a range of reports to the host trends.
+ *
+ * Fills in the trends of the scans that finished before there were trends.
+ * Each scan is added with the severities that its owner sees, like at the
+ * end of the scan.  Reports that are in the trends already are skipped.
+ *
+ * It's up to the caller to provide the transaction.
+ *
+ * @param[in]  from  Last report ID of the previous range.
+ * @param[in]  to    Last report ID of this range.
+ */
+void
+host_trends_add_reports (report_t from, report_t to)
+{
+  iterator_t reports;
+  gchar *old_uuid;
+
+  old_uuid = current_credentials.uuid;
+  init_iterator (&reports,
+                 "SELECT id, (SELECT uuid FROM users WHERE id = owner)"
+                 " FROM reports"
+                 " WHERE id > %llu AND id <= %llu"
+                 " AND scan_run_status = %u"
+                 " AND NOT EXISTS (SELECT * FROM host_trends"
+                 "                 WHERE host_trends.report = reports.id)"
+                 " ORDER BY id;",
+                 from,
+                 to,
+                 TASK_STATUS_DONE);
+  while (next (&reports))
+    {
+      report_t report;
+      gchar *new_severity_sql;
+      int min_qod;
+
+      if (iterator_string (&reports, 1) == NULL)
+        continue;
+
+      report = iterator_int64 (&reports, 0);
+      current_credentials.uuid = g_strdup (iterator_string (&reports, 1));
+      new_severity_sql = hosts_severity_sql (report, NULL, NULL, &min_qod);
+      host_trends_add (report, new_severity_sql, min_qod);
+      g_free (new_severity_sql);
+      g_free (current_credentials.uuid);
+    }
+  cleanup_iterator (&reports);
+  current_credentials.uuid = old_uuid;
+}
+
 /**
  * @brief Store certain host details in the assets after a scan.
  *
@@ -49006,6 +56652,8 @@ host_routes_xml (host_t host)
 /**
  * @brief Add host details to a report host.
  *
+ * The details are sent to the database with a single COPY.
+ *
  * @param[in]  report  UUID of resource.
  * @param[in]  ip      Host.
  * @param[in]  entity  XML entity containing details.
@@ -49018,7 +56666,9 @@ manage_report_host_details (report_t report, const char *ip, entity_t entity)
   int in_assets;
   entities_t details;
   entity_t detail;
-  char *uuid;
+  char *uuid, *quoted_ip;
+  gchar *report_host;
+  GString *rows;
 
   in_assets = sql_int ("SELECT not(value = 'no') FROM task_preferences"
                        " WHERE task = (SELECT task FROM reports"
@@ -49032,6 +56682,12 @@ manage_report_host_details (report_t report, const char *ip, entity_t entity)
   if (identifier_hosts == NULL)
     identifier_hosts = make_array ();
   uuid = report_uuid (report);
+  quoted_ip = sql_quote (ip);
+  report_host = sql_string ("SELECT id FROM report_hosts"
+                            " WHERE report = %llu AND host = '%s';",
+                            report, quoted_ip);
+  g_free (quoted_ip);
+  rows = g_string_new ("");
   while ((detail = first_entity (details)))
     {
       if (strcmp (entity_name (detail), "detail") == 0)
@@ -49057,9 +56713,12 @@ manage_report_host_details (report_t report, const char *ip, entity_t entity)
           value = entity_child (detail, "value");
           if (value == NULL)
             goto error;
-          insert_report_host_detail
-           (report, ip, entity_text (source_type), entity_text (source_name),
-            entity_text (source_desc), entity_text (name), entity_text (value));
+          sql_copy_append (rows, report_host, 0);
+          sql_copy_append (rows, entity_text (source_type), 0);
+          sql_copy_append (rows, entity_text (source_name), 0);
+          sql_copy_append (rows, entity_text (source_desc), 0);
+          sql_copy_append (rows, entity_text (name), 0);
+          sql_copy_append (rows, entity_text (value), 1);
 
           /* Only add to assets if "Add to Assets" is set on the task. */
           if (in_assets)
@@ -49130,11 +56789,27 @@ manage_report_host_details (report_t report, const char *ip, entity_t entity)
       details = next_entities (details);
     }
   free (uuid);
+  g_free (report_host);
+
+  if (rows->len
+      && sql_copy_start ("COPY report_host_details"
+                         " (report_host, source_type, source_name,"
+                         "  source_description, name, value)"
+                         " FROM STDIN;") == 0)
+    {
+      if (sql_copy_data (rows->str, rows->len))
+        sql_copy_end ("Failed to send host details");
+      else
+        sql_copy_end (NULL);
+    }
+  g_string_free (rows, TRUE);
 
   return 0;
 
  error:
   free (uuid);
+  g_free (report_host);
+  g_string_free (rows, TRUE);
   return -1;
 }
 
@@ -49828,6 +57503,189 @@ find_host_with_permission (const char* uuid, host_t* host,
   return find_resource_with_permission ("host", uuid, host, permission, 0);
 }
 
+/**
+ * @brief Initialise a host trend iterator.
+ *
+ * Without a host, each point sums the trends of all the hosts of the
+ * current user that were scanned on the day.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  host_id   UUID of host, or NULL for all hosts.
+ * @param[in]  days      Number of days back from today.
+ *
+ * @return 0 success, 1 failed to find host, -1 error.
+ */
+int
+init_host_trend_iterator (iterator_t *iterator, const char *host_id,
+                          int days)
+{
+  time_t start;
+
+  start = day_start_utc (time (NULL) - (time_t) days * 86400);
+
+  if (host_id)
+    {
+      host_t host;
+
+      if (find_host_with_permission (host_id, &host, "get_assets"))
+        return -1;
+      if (host == 0)
+        return 1;
+
+      init_iterator (iterator,
+                     "SELECT day, 1, max_severity, high, medium, low, log,"
+                     "       open, closed"
+                     " FROM host_trends"
+                     " WHERE host = %llu"
+                     " AND day >= %li"
+                     " ORDER BY day;",
+                     host,
+                     (long) start);
+      return 0;
+    }
+
+  init_iterator (iterator,
+                 "SELECT day, count (*), max (max_severity), sum (high),"
+                 "       sum (medium), sum (low), sum (log), sum (open),"
+                 "       sum (closed)"
+                 " FROM host_trends"
+                 " WHERE host IN (SELECT id FROM hosts"
+                 "                WHERE owner = (SELECT id FROM users"
+                 "                               WHERE uuid = '%s'))"
+                 " AND day >= %li"
+                 " GROUP BY day"
+                 " ORDER BY day;",
+                 current_credentials.uuid,
+                 (long) start);
+  return 0;
+}
+
+/**
+ * @brief Get the day from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Start of the day, in seconds since the epoch.
+ */
+time_t
+host_trend_iterator_day (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 0);
+}
+
+/**
+ * @brief Get the number of hosts from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of hosts scanned on the day.
+ */
+int
+host_trend_iterator_hosts (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 1);
+}
+
+/**
+ * @brief Get the max severity from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Max severity.
+ */
+double
+host_trend_iterator_max_severity (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_double (iterator, 2);
+}
+
+/**
+ * @brief Get the number of high results from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of high results.
+ */
+int
+host_trend_iterator_high (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 3);
+}
+
+/**
+ * @brief Get the number of medium results from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of medium results.
+ */
+int
+host_trend_iterator_medium (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 4);
+}
+
+/**
+ * @brief Get the number of low results from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of low results.
+ */
+int
+host_trend_iterator_low (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 5);
+}
+
+/**
+ * @brief Get the number of log results from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of log results.
+ */
+int
+host_trend_iterator_log (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 6);
+}
+
+/**
+ * @brief Get the number of open vulnerabilities from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of open vulnerabilities.
+ */
+int
+host_trend_iterator_open (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 7);
+}
+
+/**
+ * @brief Get the number of closed vulnerabilities from a host trend iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Number of vulnerabilities closed on the day.
+ */
+int
+host_trend_iterator_closed (iterator_t *iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, 8);
+}
+
 /**
  * @brief Check whether a string is an identifier name.
  *
@@ -49900,6 +57758,8 @@ create_asset_host (const char *host_name, const char *comment,
   if (host_return)
     *host_return = host;
 
+  aggregate_rollups_clear_assets ();
+
   sql_commit ();
 
   return 0;
@@ -49961,6 +57821,7 @@ create_asset_report (const char *report_id, const char *term)
   sql ("DELETE FROM host_details WHERE source_id = '%s';",
        quoted_report_id);
   g_free (quoted_report_id);
+  aggregate_rollups_clear_assets ();
 
   init_report_host_iterator (&hosts, report, NULL, 0);
   while (next (&hosts))
@@ -50170,11 +58031,19 @@ delete_report_assets (const char *report_id)
   sql ("DELETE FROM host_max_severities"
        " WHERE host in (SELECT host FROM delete_report_assets_hosts);");
 
+  /* The host is going, so its trends go too. */
+  sql ("DELETE FROM host_trends"
+       " WHERE host in (SELECT host FROM delete_report_assets_hosts);");
+  sql ("DELETE FROM host_open_nvts"
+       " WHERE host in (SELECT host FROM delete_report_assets_hosts);");
+
   sql ("DELETE FROM hosts"
        " WHERE id in (SELECT host FROM delete_report_assets_hosts);");
 
   sql ("DROP TABLE delete_report_assets_hosts;");
 
+  aggregate_rollups_clear_assets ();
+
   sql_commit ();
   return 0;
 }
@@ -50307,6 +58176,7 @@ delete_asset (const char *asset_id, const char *report_id, int dummy)
         }
 
       sql ("DELETE FROM host_oss WHERE id = %llu;", asset);
+      aggregate_rollups_clear_assets ();
       sql_commit ();
 
       return 0;
@@ -50348,6 +58218,7 @@ delete_asset (const char *asset_id, const char *report_id, int dummy)
       sql ("DELETE FROM oss WHERE id = %llu;", asset);
       permissions_set_orphans ("os", asset, LOCATION_TABLE);
       tags_remove_resource ("os", asset, LOCATION_TABLE);
+      aggregate_rollups_clear_assets ();
       sql_commit ();
 
       return 0;
@@ -50381,10 +58252,13 @@ delete_asset (const char *asset_id, const char *report_id, int dummy)
       sql ("DELETE FROM host_identifiers WHERE host = %llu;", asset);
       sql ("DELETE FROM host_oss WHERE host = %llu;", asset);
       sql ("DELETE FROM host_max_severities WHERE host = %llu;", asset);
+      sql ("DELETE FROM host_trends WHERE host = %llu;", asset);
+      sql ("DELETE FROM host_open_nvts WHERE host = %llu;", asset);
       sql ("DELETE FROM host_details WHERE host = %llu;", asset);
       sql ("DELETE FROM hosts WHERE id = %llu;", asset);
       permissions_set_orphans ("host", asset, LOCATION_TABLE);
       tags_remove_resource ("host", asset, LOCATION_TABLE);
+      aggregate_rollups_clear_assets ();
       sql_commit ();
 
       return 0;
@@ -52075,7 +59949,8 @@ set_password (const gchar *name, const gchar *uuid, const gchar *password,
       return -1;
     }
   hash = get_password_hashes (password);
-  sql ("UPDATE users SET password = '%s', modification_time = m_now ()"
+  sql ("UPDATE users SET password = '%s', modification_time = m_now (),"
+       "                 auth_token_generation = auth_token_generation + 1"
        " WHERE uuid = '%s';",
        hash,
        uuid);
@@ -52608,6 +60483,10 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
   user_t user, inheritor;
   get_data_t get;
   char *current_uuid, *feed_owner_id;
+  iterator_t credentials;
+  GPtrArray *credential_ids;
+  GHashTable *uuids;
+  guint index;
 
   assert (user_id_arg || name_arg);
 
@@ -52842,6 +60721,7 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
            inheritor, user);
       sql ("UPDATE oss SET owner = %llu WHERE owner = %llu;",
            inheritor, user);
+      aggregate_rollups_clear_assets ();
       sql ("UPDATE permissions SET owner = %llu WHERE owner = %llu",
            inheritor, user);
 
@@ -52852,6 +60732,8 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
            inheritor, user);
       sql ("UPDATE report_counts SET \"user\" = %llu WHERE \"user\" = %llu",
            inheritor, user);
+      /* The inheritor may see other overrides, so severities are recached. */
+      sql ("DELETE FROM result_severities WHERE \"user\" = %llu", user);
       sql ("UPDATE reports SET owner = %llu WHERE owner = %llu;",
            inheritor, user);
       sql ("UPDATE results SET owner = %llu WHERE owner = %llu;",
@@ -52912,10 +60794,17 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
 
       delete_permissions_cache_for_user (user);
 
+      uuids = g_hash_table_new_full (g_str_hash, g_str_equal, free, NULL);
+      g_hash_table_add (uuids, user_uuid (user));
+
       sql ("DELETE FROM users WHERE id = %llu;", user);
 
       sql_commit ();
 
+      /* Remove the cached reports that the user rendered. */
+      report_cache_purge (uuids);
+      g_hash_table_destroy (uuids);
+
       return 0;
     }
 
@@ -52955,9 +60844,14 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
        " (SELECT id FROM hosts WHERE owner = %llu);", user);
   sql ("DELETE FROM host_max_severities WHERE host IN"
        " (SELECT id FROM hosts WHERE owner = %llu);", user);
+  sql ("DELETE FROM host_trends WHERE host IN"
+       " (SELECT id FROM hosts WHERE owner = %llu);", user);
+  sql ("DELETE FROM host_open_nvts WHERE host IN"
+       " (SELECT id FROM hosts WHERE owner = %llu);", user);
   sql ("DELETE FROM host_identifiers WHERE owner = %llu;", user);
   sql ("DELETE FROM host_oss WHERE owner = %llu;", user);
   sql ("DELETE FROM hosts WHERE owner = %llu;", user);
+  sql ("DELETE FROM aggregate_rollups WHERE owner = %llu;", user);
 
   /* OSs. */
   sql ("DELETE FROM oss WHERE owner = %llu;", user);
@@ -52966,9 +60860,14 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
 
   /* Counts. */
   sql ("DELETE FROM report_counts WHERE \"user\" = %llu", user);
+  sql ("DELETE FROM report_counts_rebuilds WHERE \"user\" = %llu", user);
   sql ("DELETE FROM report_counts"
        " WHERE report IN (SELECT id FROM reports WHERE owner = %llu);",
        user);
+  sql ("DELETE FROM result_severities WHERE \"user\" = %llu", user);
+  sql ("DELETE FROM result_severities"
+       " WHERE report IN (SELECT id FROM reports WHERE owner = %llu);",
+       user);
 
   /* Hosts. */
   sql ("DELETE FROM report_host_details"
@@ -53013,6 +60912,9 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
   sql ("DELETE FROM task_preferences"
        " WHERE task IN (SELECT id FROM tasks WHERE owner = %llu);",
        user);
+  sql ("DELETE FROM task_summaries"
+       " WHERE task IN (SELECT id FROM tasks WHERE owner = %llu);",
+       user);
   sql ("DELETE FROM tasks WHERE owner = %llu;", user);
 
   /* Delete resources directly used by tasks. */
@@ -53151,6 +61053,19 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
       sql_rollback ();
       return 9;
     }
+
+  credential_ids = g_ptr_array_new_with_free_func (g_free);
+  init_iterator (&credentials,
+                 "SELECT uuid FROM credentials WHERE owner = %llu"
+                 " UNION ALL"
+                 " SELECT uuid FROM credentials_trash WHERE owner = %llu;",
+                 user,
+                 user);
+  while (next (&credentials))
+    g_ptr_array_add (credential_ids,
+                     g_strdup (iterator_string (&credentials, 0)));
+  cleanup_iterator (&credentials);
+
   sql ("DELETE FROM credentials_data WHERE credential IN"
        " (SELECT id FROM credentials WHERE owner = %llu);",
        user);
@@ -53213,9 +61128,22 @@ delete_user (const char *user_id_arg, const char *name_arg, int ultimate,
 
   /* Delete user. */
 
+  uuids = g_hash_table_new_full (g_str_hash, g_str_equal, free, NULL);
+  g_hash_table_add (uuids, user_uuid (user));
+
   sql ("DELETE FROM users WHERE id = %llu;", user);
 
   sql_commit ();
+
+  /* Remove the cached reports that the user rendered. */
+  report_cache_purge (uuids);
+  g_hash_table_destroy (uuids);
+
+  /* Remove the cached packages of the deleted credentials. */
+  for (index = 0; index < credential_ids->len; index++)
+    lsc_user_packages_remove (g_ptr_array_index (credential_ids, index));
+  g_ptr_array_free (credential_ids, TRUE);
+
   return 0;
 }
 
@@ -53433,6 +61361,8 @@ modify_user (const gchar * user_id, gchar **name, const gchar *new_name,
        allowed_methods ? quoted_method : "method",
        allowed_methods ? "'" : "",
        user);
+  if (hash || allowed_methods || quoted_new_name)
+    auth_tokens_revoke (user);
   g_free (quoted_new_name);
   g_free (quoted_hosts);
   g_free (quoted_ifaces);
@@ -56535,19 +64465,23 @@ tags_set_locations (const char *type, resource_t old, resource_t new,
 }
 
 /**
- * @brief  Get a GArray of all users as user_t.
+ * @brief  Get a GArray of users as user_t.
  *
- * @return  Newly allocated GArray containing all users.
+ * @param[in]  users_where  SQL clause to limit users, NULL for all users.
+ *
+ * @return  Newly allocated GArray containing the users.
  */
 static GArray*
-all_users_array ()
+users_array_where (const char *users_where)
 {
   iterator_t users_iter;
   GArray *ret;
 
   ret = g_array_new (TRUE, TRUE, sizeof (resource_t));
 
-  init_iterator (&users_iter, "SELECT id FROM users;");
+  init_iterator (&users_iter, "SELECT id FROM users%s%s;",
+                 users_where ? " WHERE " : "",
+                 users_where ? users_where : "");
 
   while (next (&users_iter))
     {
@@ -56560,9 +64494,23 @@ all_users_array ()
   return ret;
 }
 
+/**
+ * @brief  Get a GArray of all users as user_t.
+ *
+ * @return  Newly allocated GArray containing all users.
+ */
+static GArray*
+all_users_array ()
+{
+  return users_array_where (NULL);
+}
+
 /**
  * @brief Update permissions cache for a resource.
  *
+ * Runs one statement per user.  Rows are only written where the cached
+ * value changes.
+ *
  * @param[in]  type         Resource type.
  * @param[in]  resource     The resource to update the cache for.
  * @param[in]  cache_users  GArray of users to create cache for or NULL for all.
@@ -56585,6 +64533,8 @@ cache_permissions_for_resource (const char *type, resource_t resource,
   else
     free_users = 0;
 
+  acl_cache_reset ();
+
   if (strcmp (type, "task") == 0)
     {
       char* old_current_user_id;
@@ -56608,47 +64558,26 @@ cache_permissions_for_resource (const char *type, resource_t resource,
           current_credentials.uuid = user_id;
           manage_session_init (user_id);
 
-          if (sql_int ("SELECT count(*) FROM permissions_get_%ss"
-                       " WHERE \"user\" = %llu"
-                       "   AND %s = %llu;",
-                       type,
-                       user,
-                       type,
-                       resource))
-            {
-              sql ("UPDATE permissions_get_%ss"
-                   "  SET has_permission"
-                   "       = user_has_access_uuid (cast ('%s' as text),"
-                   "                               cast ('%s' as text),"
-                   "                               cast ('get_%ss' as text),"
-                   "                               0)"
-                   " WHERE \"user\" = %llu"
-                   "   AND %s = %llu;",
-                   type,
-                   type,
-                   resource_id,
-                   type,
-                   user,
-                   type,
-                   resource);
-            }
-          else
-            {
-              sql ("INSERT INTO permissions_get_%ss"
-                   "              (\"user\", %s, has_permission)"
-                   "  SELECT %llu, %llu,"
-                   "         user_has_access_uuid (cast ('%s' as text),"
-                   "                               cast ('%s' as text),"
-                   "                               cast ('get_%ss' as text),"
-                   "                               0);",
-                   type,
-                   type,
-                   user,
-                   resource,
-                   type,
-                   resource_id,
-                   type);
-            }
+          sql ("INSERT INTO permissions_get_%ss"
+               "              (\"user\", %s, has_permission)"
+               "  SELECT %llu, %llu,"
+               "         user_has_access_uuid (cast ('%s' as text),"
+               "                               cast ('%s' as text),"
+               "                               cast ('get_%ss' as text),"
+               "                               0)"
+               " ON CONFLICT (\"user\", %s)"
+               " DO UPDATE SET has_permission = EXCLUDED.has_permission"
+               " WHERE permissions_get_%ss.has_permission"
+               "       IS DISTINCT FROM EXCLUDED.has_permission;",
+               type,
+               type,
+               user,
+               resource,
+               type,
+               resource_id,
+               type,
+               type,
+               type);
 
           g_free (user_id);
           current_credentials.uuid = NULL;
@@ -56667,6 +64596,9 @@ cache_permissions_for_resource (const char *type, resource_t resource,
 /**
  * @brief Update permissions cache for a given type and selection of users.
  *
+ * Runs one statement per user, covering all resources of the type.  Rows
+ * are only written where the cached value changes.
+ *
  * @param[in]  type         Type.
  * @param[in]  cache_users  GArray of users to create cache for.
  */
@@ -56687,19 +64619,59 @@ cache_permissions_for_users (const char *type, GArray *cache_users)
   else
     free_users = 0;
 
+  acl_cache_reset ();
+
   if (strcmp (type, "task") == 0)
     {
-      iterator_t resources;
+      char* old_current_user_id;
+      gint64 start;
+      int user_index;
 
-      init_iterator (&resources, "SELECT id FROM %ss;", type);
+      old_current_user_id = current_credentials.uuid;
+      start = g_get_monotonic_time ();
 
-      while (next (&resources))
+      for (user_index = 0; user_index < cache_users->len; user_index++)
         {
-          resource_t resource = iterator_int64 (&resources, 0);
-          cache_permissions_for_resource (type, resource, cache_users);
+          user_t user;
+          gchar *user_id;
+
+          user = g_array_index (cache_users, user_t, user_index);
+          user_id = user_uuid (user);
+
+          current_credentials.uuid = user_id;
+          manage_session_init (user_id);
+
+          sql ("INSERT INTO permissions_get_%ss"
+               "              (\"user\", %s, has_permission)"
+               "  SELECT %llu, id,"
+               "         user_has_access_uuid (cast ('%s' as text),"
+               "                               uuid,"
+               "                               cast ('get_%ss' as text),"
+               "                               0)"
+               "  FROM %ss"
+               " ON CONFLICT (\"user\", %s)"
+               " DO UPDATE SET has_permission = EXCLUDED.has_permission"
+               " WHERE permissions_get_%ss.has_permission"
+               "       IS DISTINCT FROM EXCLUDED.has_permission;",
+               type,
+               type,
+               user,
+               type,
+               type,
+               type,
+               type,
+               type);
+
+          g_free (user_id);
+          current_credentials.uuid = NULL;
         }
 
-      cleanup_iterator (&resources);
+      current_credentials.uuid = old_current_user_id;
+      manage_session_init (old_current_user_id);
+
+      g_info ("%s: Cached permissions on %ss for %d user(s) in %.3f s",
+              __func__, type, cache_users->len,
+              (g_get_monotonic_time () - start) / 1000000.0);
     }
 
   if (free_users)
@@ -56732,6 +64704,41 @@ cache_all_permissions_for_users (GArray *cache_users)
     g_array_free (cache_users, TRUE);
 }
 
+/**
+ * @brief Update the permission caches affected by a permission.
+ *
+ * Only the users selected by users_where can have gained or lost access
+ * through the permission, so only their caches are updated.
+ *
+ * @param[in]  name           Name of permission.
+ * @param[in]  resource_type  Type of resource of permission.
+ * @param[in]  resource       Resource of permission.
+ * @param[in]  users_where    SQL clause selecting the subject users, NULL for
+ *                            all users.
+ */
+static void
+cache_permissions_for_permission (const char *name, const char *resource_type,
+                                  resource_t resource,
+                                  const char *users_where)
+{
+  GArray *cache_users;
+
+  if (name == NULL)
+    return;
+
+  if (strcasecmp (name, "super")
+      && (resource == 0 || resource_type == NULL
+          || strcmp (resource_type, "") == 0))
+    return;
+
+  cache_users = users_array_where (users_where);
+  if (strcasecmp (name, "super") == 0)
+    cache_all_permissions_for_users (cache_users);
+  else
+    cache_permissions_for_resource (resource_type, resource, cache_users);
+  g_array_free (cache_users, TRUE);
+}
+
 /**
  * @brief Delete permission cache a resource.
  *
@@ -56978,6 +64985,40 @@ manage_optimize (GSList *log_config, const gchar *database, const gchar *name)
 
       success_text = g_strdup_printf ("Optimized: Cleaned up result_nvts.");
     }
+  else if (strcasecmp (name, "cleanup-result-descriptions") == 0)
+    {
+      int removed;
+
+      sql_begin_immediate ();
+
+      /* The fingerprint trigger shares an existing description without
+       * locking its row, so a result that is being added could refer to
+       * a description deleted here.  Every INSERT into the table takes a
+       * ROW EXCLUSIVE lock, even when it does nothing on conflict.  This
+       * lock waits for the transactions that did an INSERT to end, and
+       * keeps out new ones, so the DELETE sees all results that refer to
+       * the descriptions. */
+      sql ("LOCK TABLE result_descriptions IN SHARE ROW EXCLUSIVE MODE;");
+
+      removed = sql_int ("WITH deleted AS"
+                         " (DELETE FROM result_descriptions"
+                         "  WHERE NOT EXISTS"
+                         "         (SELECT * FROM results"
+                         "          WHERE fingerprint"
+                         "                = result_descriptions.fingerprint)"
+                         "  AND NOT EXISTS"
+                         "       (SELECT * FROM results_trash"
+                         "        WHERE fingerprint"
+                         "              = result_descriptions.fingerprint)"
+                         "  RETURNING 1)"
+                         " SELECT count (*) FROM deleted;");
+
+      sql_commit ();
+
+      success_text = g_strdup_printf ("Optimized: cleanup-result-descriptions."
+                                      " Removed %d unused descriptions.",
+                                      removed);
+    }
   else if (strcasecmp (name, "cleanup-result-severities") == 0)
     {
       int missing_severity_changes = 0;
@@ -57033,6 +65074,34 @@ manage_optimize (GSList *log_config, const gchar *database, const gchar *name)
           ret = -1;
         }
     }
+  else if (strcasecmp (name, "partition-results") == 0)
+    {
+      switch (manage_partition_results ())
+        {
+          case 0:
+            success_text = g_strdup_printf ("Optimized: partition-results."
+                                            " Results partitioned by"
+                                            " report.");
+            break;
+          case 1:
+            success_text = g_strdup_printf ("Optimized: partition-results."
+                                            " Results were already"
+                                            " partitioned.");
+            break;
+          case 2:
+            fprintf (stderr,
+                     "Partitioning the results requires PostgreSQL 13"
+                     " or later.\n");
+            success_text = NULL;
+            ret = -1;
+            break;
+          default:
+            fprintf (stderr, "Failed to partition the results.\n");
+            success_text = NULL;
+            ret = -1;
+            break;
+        }
+    }
   else if (strcasecmp (name, "rebuild-permissions-cache") == 0)
     {
       sql_begin_immediate ();
@@ -57056,6 +65125,8 @@ manage_optimize (GSList *log_config, const gchar *database, const gchar *name)
 
       sql_commit ();
 
+      aggregate_rollups_refresh (NULL);
+
       success_text = g_strdup_printf ("Optimized: rebuild-report-cache."
                                       " Result counts recalculated for %d"
                                       " reports.",
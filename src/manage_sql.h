@@ -29,6 +29,7 @@
 
 #include "manage.h"
 #include "manage_utils.h"
+#include "utils.h"
 
 
 /* Internal types and preprocessor definitions. */
@@ -87,6 +88,20 @@
  */
 #define PORT_LIST_UUID_DEFAULT "c7e03b6c-3bbe-11e1-a057-406186ea4fc5"
 
+/**
+ * @brief Length from which result descriptions are stored only once.
+ *
+ * Shorter descriptions cost less inline than the lookup.
+ */
+#define RESULT_DESCRIPTION_SHARED_MIN 128
+
+/**
+ * @brief SQL key of the hosts of a target, for target_host_counts.
+ */
+#define TARGET_HOSTS_KEY(hosts, exclude_hosts)                \
+  "md5 (coalesce (" hosts ", '') || '|'"                      \
+  "     || coalesce (" exclude_hosts ", ''))"
+
 /**
  * @brief Predefined role UUID.
  */
@@ -226,7 +241,7 @@ name (iterator_t* iterator)                                       \
   do                                                                         \
     {                                                                        \
       gchar *msg;                                                            \
-      msg = g_markup_printf_escaped (format, ## args);                       \
+      msg = xml_printf_escaped (format, ## args);                            \
       if (fprintf (stream, "%s", msg) < 0)                                   \
         {                                                                    \
           g_free (msg);                                                      \
@@ -356,6 +371,8 @@ credential_t target_ssh_credential (target_t);
 credential_t target_smb_credential (target_t);
 credential_t target_esxi_credential (target_t);
 
+void target_decrypt_credentials (target_t);
+
 int create_current_report (task_t, char **, task_status_t);
 
 char *alert_data (alert_t, const char *, const char *);
@@ -384,6 +401,14 @@ gboolean task_schedule_iterator_start_due (iterator_t *);
 
 gboolean task_schedule_iterator_stop_due (iterator_t *);
 
+time_t task_schedule_iterator_next_time (iterator_t *);
+
+time_t task_schedule_iterator_stop_time (iterator_t *);
+
+int manage_task_schedules_changed ();
+
+int manage_task_schedules_socket ();
+
 time_t task_schedule_iterator_initial_offset (iterator_t *);
 
 int set_task_schedule_uuid (const gchar*, schedule_t, int);
@@ -460,6 +485,24 @@ gchar *
 filter_clause (const char*, const char*, const char **, column_t *,
                column_t *, int, gchar **, int *, int *, array_t **, gchar **);
 
+void
+aggregate_rollups_refresh (const char *);
+
+void
+aggregate_rollups_refresh_assets ();
+
+void
+aggregate_rollups_clear_assets ();
+
+int
+secinfo_changes_mark (const char *);
+
+int
+secinfo_changes_generation ();
+
+void
+secinfo_changes_record (const char *, int, int);
+
 void
 check_alerts ();
 
@@ -472,6 +515,9 @@ manage_option_cleanup ();
 void
 update_all_config_caches ();
 
+void
+nvt_selector_family_counts_update_nvts ();
+
 void
 event (event_t, void *, resource_t, resource_t);
 
@@ -523,4 +569,13 @@ void
 add_role_permission_resource (const gchar *, const gchar *, const gchar *,
                               const gchar *);
 
+int
+migration_steps_queued ();
+
+void
+migration_steps_run ();
+
+void
+host_trends_add_reports (report_t, report_t);
+
 #endif /* not _GVMD_MANAGE_SQL_H */
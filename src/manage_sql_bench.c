@@ -0,0 +1,354 @@
+/* Copyright (C) 2020 Greenbone Networks GmbH
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file  manage_sql_bench.c
+ * @brief Microbenchmarks of hot helpers.
+ *
+ * Times filter parsing, time, severity and host helpers that run for
+ * nearly every request.  None of the benchmarks need a database.
+ *
+ * Each benchmark prints a line like
+ *
+ *   split_filter  200000  1234.5 ns/op  17.00 allocs/op
+ *
+ * which is the format that benchstat expects.
+ */
+
+#include "manage_sql.c"
+
+/* Allocation counting. */
+
+/**
+ * @brief Number of allocations since the start of the process.
+ */
+static unsigned long long bench_allocations = 0;
+
+void *__libc_malloc (size_t);
+void *__libc_calloc (size_t, size_t);
+void *__libc_realloc (void *, size_t);
+
+/**
+ * @brief Allocate memory, counting the allocation.
+ *
+ * @param[in]  size  Number of bytes.
+ *
+ * @return Memory.
+ */
+void *
+malloc (size_t size)
+{
+  bench_allocations++;
+  return __libc_malloc (size);
+}
+
+/**
+ * @brief Allocate zeroed memory, counting the allocation.
+ *
+ * @param[in]  count  Number of members.
+ * @param[in]  size   Size of a member.
+ *
+ * @return Memory.
+ */
+void *
+calloc (size_t count, size_t size)
+{
+  bench_allocations++;
+  return __libc_calloc (count, size);
+}
+
+/**
+ * @brief Reallocate memory, counting the allocation.
+ *
+ * @param[in]  pointer  Memory.
+ * @param[in]  size     New number of bytes.
+ *
+ * @return Memory.
+ */
+void *
+realloc (void *pointer, size_t size)
+{
+  bench_allocations++;
+  return __libc_realloc (pointer, size);
+}
+
+/* Benchmarks. */
+
+/**
+ * @brief Minimum time in microseconds that each benchmark runs for.
+ */
+#define BENCH_MIN_TIME 500000
+
+/**
+ * @brief Filter term, like those the GSA sends.
+ */
+#define BENCH_FILTER                                                      \
+  "name~\"web server\" hosts~192.168 apply_overrides=1 min_qod=70"        \
+  " rows=100 first=1 sort-reverse=modified"
+
+/**
+ * @brief Sink that keeps the compiler from optimising the work away.
+ */
+static volatile long long bench_sink;
+
+/**
+ * @brief split_filter.
+ */
+static void
+bench_split_filter ()
+{
+  array_t *split;
+
+  split = split_filter (BENCH_FILTER);
+  bench_sink += split->len;
+  filter_free (split);
+}
+
+/**
+ * @brief filter_clause_build, which is the uncached parse of a filter.
+ */
+static void
+bench_filter_clause_build ()
+{
+  static const char *filter_columns[] = TARGET_ITERATOR_FILTER_COLUMNS;
+  static column_t select_columns[] = TARGET_ITERATOR_COLUMNS;
+  gchar *clause, *order, *owner_filter;
+  array_t *permissions;
+  int first, max;
+
+  clause = filter_clause_build ("target", BENCH_FILTER, filter_columns,
+                                select_columns, NULL, 0, &order, &first,
+                                &max, &permissions, &owner_filter);
+  bench_sink += first;
+  g_free (clause);
+  g_free (order);
+  g_free (owner_filter);
+  if (permissions)
+    array_free (permissions);
+}
+
+/**
+ * @brief filter_clause, which usually hits the filter cache.
+ */
+static void
+bench_filter_clause ()
+{
+  static const char *filter_columns[] = TARGET_ITERATOR_FILTER_COLUMNS;
+  static column_t select_columns[] = TARGET_ITERATOR_COLUMNS;
+  gchar *clause, *order, *owner_filter;
+  array_t *permissions;
+  int first;
+
+  clause = filter_clause ("target", BENCH_FILTER, filter_columns,
+                          select_columns, NULL, 0, &order, &first,
+                          NULL, &permissions, &owner_filter);
+  bench_sink += first;
+  g_free (clause);
+  g_free (order);
+  g_free (owner_filter);
+  if (permissions)
+    array_free (permissions);
+}
+
+/**
+ * @brief parse_iso_time, with an offset and with UTC.
+ */
+static void
+bench_parse_iso_time ()
+{
+  bench_sink += parse_iso_time ("2020-03-17T10:14:53+01:00");
+  bench_sink += parse_iso_time ("2020-03-17T10:14:53Z");
+}
+
+/**
+ * @brief iso_time_tz.
+ */
+static void
+bench_iso_time_tz ()
+{
+  time_t epoch_time;
+  const char *abbrev;
+
+  epoch_time = 1584436493;
+  bench_sink += strlen (iso_time_tz (&epoch_time, "Europe/Berlin", &abbrev));
+}
+
+/**
+ * @brief severity_to_level, over the range of severities.
+ */
+static void
+bench_severity_to_level ()
+{
+  static int score = 0;
+
+  bench_sink += strlen (severity_to_level (score / 10.0, 0));
+  score = (score + 7) % 101;
+}
+
+/**
+ * @brief level_min_severity.
+ */
+static void
+bench_level_min_severity ()
+{
+  bench_sink += level_min_severity ("medium", "nist");
+}
+
+/**
+ * @brief collate_ip, which calls collate_ip_compare for each octet.
+ */
+static void
+bench_collate_ip ()
+{
+  static const char *one = "192.168.10.5";
+  static const char *two = "192.168.2.17";
+
+  bench_sink += collate_ip (NULL, strlen (one), one, strlen (two), two);
+}
+
+/**
+ * @brief manage_count_hosts_max, with ranges, a CIDR block and a name.
+ */
+static void
+bench_manage_count_hosts_max ()
+{
+  bench_sink += manage_count_hosts_max ("192.168.0.0/24, 10.0.0.1-10.0.0.50,"
+                                        " scanme.example.com",
+                                        "192.168.0.5",
+                                        4096);
+}
+
+/**
+ * @brief icalendar_next_time_from_string, for a weekly schedule.
+ */
+static void
+bench_icalendar_next_time_from_string ()
+{
+  bench_sink += icalendar_next_time_from_string
+                 ("BEGIN:VCALENDAR\n"
+                  "VERSION:2.0\n"
+                  "PRODID:-//Greenbone.net//NONSGML Greenbone Security"
+                  " Manager 8.0.0//EN\n"
+                  "BEGIN:VEVENT\n"
+                  "DTSTART:20190312T083000Z\n"
+                  "DURATION:PT0S\n"
+                  "RRULE:FREQ=WEEKLY;BYDAY=MO,WE,FR\n"
+                  "UID:c2d9dd20-9d56-4e2d-9717-aa3b4b92d13b\n"
+                  "DTSTAMP:20190312T083040Z\n"
+                  "END:VEVENT\n"
+                  "END:VCALENDAR\n",
+                  "Europe/Berlin",
+                  0);
+}
+
+/**
+ * @brief A benchmark.
+ */
+typedef struct
+{
+  const char *name;       ///< Name.
+  void (*run) ();         ///< Function that does one operation.
+} bench_t;
+
+/**
+ * @brief The benchmarks.
+ */
+static bench_t benches[]
+  = {{ "split_filter", bench_split_filter },
+     { "filter_clause_build", bench_filter_clause_build },
+     { "filter_clause", bench_filter_clause },
+     { "parse_iso_time", bench_parse_iso_time },
+     { "iso_time_tz", bench_iso_time_tz },
+     { "severity_to_level", bench_severity_to_level },
+     { "level_min_severity", bench_level_min_severity },
+     { "collate_ip", bench_collate_ip },
+     { "manage_count_hosts_max", bench_manage_count_hosts_max },
+     { "icalendar_next_time_from_string",
+       bench_icalendar_next_time_from_string },
+     { NULL, NULL }};
+
+/**
+ * @brief Run a benchmark and print the result.
+ *
+ * Doubles the number of operations until a run takes at least
+ * BENCH_MIN_TIME.
+ *
+ * @param[in]  bench  Benchmark.
+ */
+static void
+bench_run (bench_t *bench)
+{
+  long long count, index;
+  unsigned long long allocations;
+  gint64 start, elapsed;
+
+  /* Warm up caches, like the filter cache. */
+  bench->run ();
+
+  count = 1;
+  while (1)
+    {
+      allocations = bench_allocations;
+      start = g_get_monotonic_time ();
+      for (index = 0; index < count; index++)
+        bench->run ();
+      elapsed = g_get_monotonic_time () - start;
+      allocations = bench_allocations - allocations;
+      if (elapsed >= BENCH_MIN_TIME)
+        break;
+      count *= 2;
+    }
+
+  printf ("%-32s %10lli %12.1f ns/op %10.2f allocs/op\n",
+          bench->name,
+          count,
+          elapsed * 1000.0 / count,
+          allocations / (double) count);
+}
+
+/**
+ * @brief Run the benchmarks.
+ *
+ * @param[in]  argc  The number of arguments in argv.
+ * @param[in]  argv  The list of arguments to the program.  A benchmark
+ *                   name runs only that benchmark.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure.
+ */
+int
+main (int argc, char **argv)
+{
+  bench_t *bench;
+  int found;
+
+  found = 0;
+  for (bench = benches; bench->name; bench++)
+    if (argc < 2 || strcmp (argv[1], bench->name) == 0)
+      {
+        bench_run (bench);
+        found = 1;
+      }
+
+  if (found == 0)
+    {
+      fprintf (stderr, "No benchmark named %s\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
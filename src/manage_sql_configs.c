@@ -523,6 +523,194 @@ nvt_selector_family_growing (const char *selector,
   return ret ? 1 : 0;
 }
 
+/**
+ * @brief Count the stale and missing families of an NVT selector.
+ *
+ * The counts are kept in nvt_selector_family_counts.  Changes to the
+ * selector mark the families they touch as stale, via a trigger, and
+ * NVT updates mark the families whose NVTs changed, so this only has to
+ * count those families.
+ *
+ * It's up to the caller to organise a transaction.
+ *
+ * @param[in]  quoted_selector  SQL-quoted selector name.
+ */
+static void
+nvt_selector_family_counts_refresh (const char *quoted_selector)
+{
+  int state;
+  gchar *families;
+
+  /* 0 all counted, 1 some stale, 2 never counted. */
+  state = sql_int ("SELECT CASE"
+                   "       WHEN NOT EXISTS (SELECT *"
+                   "                        FROM nvt_selector_family_counts"
+                   "                        WHERE selector = '%s')"
+                   "       THEN 2"
+                   "       WHEN EXISTS (SELECT *"
+                   "                    FROM nvt_selector_family_counts"
+                   "                    WHERE selector = '%s'"
+                   "                    AND stale = 1)"
+                   "       THEN 1"
+                   "       ELSE 0"
+                   "       END;",
+                   quoted_selector,
+                   quoted_selector);
+  if (state == 0)
+    return;
+
+  if (state == 1)
+    families = g_strdup_printf (" AND family IN"
+                                " (SELECT family"
+                                "  FROM nvt_selector_family_counts"
+                                "  WHERE selector = '%s'"
+                                "  AND stale = 1)",
+                                quoted_selector);
+  else
+    families = g_strdup ("");
+
+  /* Same rules as nvt_selector_family_growing and nvt_selector_nvt_count. */
+  sql ("INSERT INTO nvt_selector_family_counts"
+       " (selector, family, growing, nvt_count, max_nvt_count, stale)"
+       " SELECT '%s', family, growing,"
+       "        CASE WHEN growing = 1"
+       "        THEN total - (SELECT count (*) FROM nvt_selectors"
+       "                      WHERE name = '%s'"
+       "                      AND exclude = 1"
+       "                      AND type = " G_STRINGIFY (NVT_SELECTOR_TYPE_NVT)
+       "                      AND nvt_selectors.family = families.family)"
+       "        ELSE (SELECT count (*) FROM nvt_selectors"
+       "              WHERE name = '%s'"
+       "              AND exclude = 0"
+       "              AND type = " G_STRINGIFY (NVT_SELECTOR_TYPE_NVT)
+       "              AND nvt_selectors.family = families.family)"
+       "        END,"
+       "        total, 0"
+       " FROM (SELECT family, count (*) AS total,"
+       "              CASE WHEN EXISTS"
+       "                         (SELECT * FROM nvt_selectors"
+       "                          WHERE name = '%s'"
+       "                          AND type = "
+       G_STRINGIFY (NVT_SELECTOR_TYPE_ALL)
+       "                          AND exclude = 0)"
+       "              THEN (NOT EXISTS"
+       "                     (SELECT * FROM nvt_selectors"
+       "                      WHERE name = '%s'"
+       "                      AND type = "
+       G_STRINGIFY (NVT_SELECTOR_TYPE_FAMILY)
+       "                      AND family_or_nvt = nvts.family"
+       "                      AND exclude = 1))::integer"
+       "              ELSE (EXISTS"
+       "                     (SELECT * FROM nvt_selectors"
+       "                      WHERE name = '%s'"
+       "                      AND type = "
+       G_STRINGIFY (NVT_SELECTOR_TYPE_FAMILY)
+       "                      AND family_or_nvt = nvts.family"
+       "                      AND exclude = 0))::integer"
+       "              END AS growing"
+       "       FROM nvts"
+       "       WHERE family != 'Credentials'%s"
+       "       GROUP BY family) AS families"
+       " ON CONFLICT (selector, family) DO UPDATE"
+       " SET growing = EXCLUDED.growing,"
+       "     nvt_count = EXCLUDED.nvt_count,"
+       "     max_nvt_count = EXCLUDED.max_nvt_count,"
+       "     stale = 0;",
+       quoted_selector,
+       quoted_selector,
+       quoted_selector,
+       quoted_selector,
+       quoted_selector,
+       quoted_selector,
+       families);
+  g_free (families);
+
+  /* Any families still stale have no NVTs anymore. */
+  if (state == 1)
+    sql ("DELETE FROM nvt_selector_family_counts"
+         " WHERE selector = '%s' AND stale = 1;",
+         quoted_selector);
+}
+
+/**
+ * @brief Mark the cached counts of families whose NVTs changed as stale.
+ *
+ * For use after an NVT update.  Also adds stale entries for new families.
+ *
+ * It's up to the caller to organise a transaction.
+ */
+void
+nvt_selector_family_counts_update_nvts ()
+{
+  sql ("WITH totals AS (SELECT family, count (*) AS total FROM nvts"
+       "                GROUP BY family)"
+       " UPDATE nvt_selector_family_counts SET stale = 1"
+       " WHERE stale = 0"
+       " AND max_nvt_count"
+       "     IS DISTINCT FROM coalesce ((SELECT total FROM totals"
+       "                                 WHERE totals.family"
+       "                                       = nvt_selector_family_counts"
+       "                                         .family),"
+       "                                0);");
+
+  sql ("INSERT INTO nvt_selector_family_counts (selector, family, stale)"
+       " SELECT selectors.selector, families.family, 1"
+       " FROM (SELECT DISTINCT selector FROM nvt_selector_family_counts)"
+       "      AS selectors,"
+       "      (SELECT DISTINCT family FROM nvts"
+       "       WHERE family != 'Credentials')"
+       "      AS families"
+       " ON CONFLICT (selector, family) DO NOTHING;");
+}
+
+/**
+ * @brief Get the cached counts of a family in an NVT selector.
+ *
+ * The growing flag follows the same rules as nvt_selector_family_growing,
+ * with the families of the selector growing when it includes all.
+ *
+ * @param[in]  selector       NVT selector.
+ * @param[in]  family         Family name.
+ * @param[out] growing        True if the family is growing, else 0.
+ * @param[out] nvt_count      Number of NVTs selected in the family.
+ * @param[out] max_nvt_count  Number of NVTs in the family.
+ *
+ * @return 0 success, -1 family has no NVTs.
+ */
+int
+nvt_selector_family_counts (const char *selector, const char *family,
+                            int *growing, int *nvt_count, int *max_nvt_count)
+{
+  iterator_t counts;
+  gchar *quoted_selector, *quoted_family;
+  int ret;
+
+  quoted_selector = sql_quote (selector);
+  quoted_family = sql_quote (family);
+
+  nvt_selector_family_counts_refresh (quoted_selector);
+
+  ret = -1;
+  init_iterator (&counts,
+                 "SELECT growing, nvt_count, max_nvt_count"
+                 " FROM nvt_selector_family_counts"
+                 " WHERE selector = '%s' AND family = '%s';",
+                 quoted_selector,
+                 quoted_family);
+  if (next (&counts))
+    {
+      *growing = iterator_int (&counts, 0);
+      *nvt_count = iterator_int (&counts, 1);
+      *max_nvt_count = iterator_int (&counts, 2);
+      ret = 0;
+    }
+  cleanup_iterator (&counts);
+
+  g_free (quoted_selector);
+  g_free (quoted_family);
+  return ret;
+}
+
 /**
  * @brief Get the number of NVTs selected by an NVT selector.
  *
@@ -542,9 +730,29 @@ nvt_selector_nvt_count (const char *selector,
   if (family)
     {
       int ret;
+      long long int cached;
+      gchar *quoted_family, *quoted_selector;
 
       /* Count in a single family. */
 
+      quoted_family = sql_quote (family);
+      quoted_selector = sql_quote (selector);
+      if (sql_int64 (&cached,
+                     "SELECT nvt_count FROM nvt_selector_family_counts"
+                     " WHERE selector = '%s' AND family = '%s'"
+                     " AND growing = %i AND stale = 0;",
+                     quoted_selector,
+                     quoted_family,
+                     growing ? 1 : 0)
+          == 0)
+        {
+          g_free (quoted_family);
+          g_free (quoted_selector);
+          return cached;
+        }
+      g_free (quoted_family);
+      g_free (quoted_selector);
+
       if (growing)
         {
           gchar *quoted_family = sql_quote (family);
@@ -578,6 +786,21 @@ nvt_selector_nvt_count (const char *selector,
    {
      int count;
      iterator_t families;
+     gchar *quoted_selector;
+
+     /* Sum the cached counts, if they use the same growth status. */
+
+     if ((growing ? 1 : 0) == nvt_selector_families_growing (selector))
+       {
+         quoted_selector = sql_quote (selector);
+         nvt_selector_family_counts_refresh (quoted_selector);
+         count = sql_int ("SELECT coalesce (sum (nvt_count), 0)"
+                          " FROM nvt_selector_family_counts"
+                          " WHERE selector = '%s';",
+                          quoted_selector);
+         g_free (quoted_selector);
+         return count;
+       }
 
      /* Count in each family. */
 
@@ -2540,7 +2763,7 @@ get_scanner_params (scanner_t scanner)
     return NULL;
 
   osp_get_scanner_details (connection, NULL, &list);
-  osp_connection_close (connection);
+  osp_scanner_disconnect (connection);
   return list;
 }
 
@@ -3133,6 +3356,7 @@ delete_config (const char *config_id, int ultimate)
     }
 
   sql ("DELETE FROM config_preferences WHERE config = %llu;", config);
+  sql ("DELETE FROM config_vts_bundles WHERE config = %llu;", config);
   sql ("DELETE FROM configs WHERE id = %llu;", config);
 
   sql_commit ();
@@ -3758,6 +3982,86 @@ config_nvt_selector (config_t config)
                      config);
 }
 
+/**
+ * @brief Get the cached OSP VT bundle of a config.
+ *
+ * The key covers the NVT selector, the VT preferences and the NVT feed
+ * version, so any change to the config or the feed invalidates the bundle.
+ *
+ * @param[in]   config  Config.
+ * @param[out]  key     Key of the current state of the config, for
+ *                      config_vts_bundle_set.  Freed by caller.
+ *
+ * @return Bundle if one is cached for the current state of the config,
+ *         else NULL.  Freed by caller.
+ */
+gchar *
+config_vts_bundle (config_t config, gchar **key)
+{
+  gchar *quoted_key;
+  gchar *bundle;
+
+  *key = sql_string ("SELECT md5 (nvt_selector"
+                     "            || coalesce ((SELECT string_agg"
+                     "                                  (exclude || ':'"
+                     "                                   || type || ':'"
+                     "                                   || family_or_nvt,"
+                     "                                   ','"
+                     "                                   ORDER BY id)"
+                     "                          FROM nvt_selectors"
+                     "                          WHERE name = nvt_selector),"
+                     "                         '')"
+                     "            || coalesce ((SELECT string_agg"
+                     "                                  (name || '=' || value,"
+                     "                                   E'\\n'"
+                     "                                   ORDER BY id)"
+                     "                          FROM config_preferences"
+                     "                          WHERE config = configs.id"
+                     "                          AND type = 'PLUGINS_PREFS'),"
+                     "                         '')"
+                     "            || coalesce ((SELECT value FROM meta"
+                     "                          WHERE name"
+                     "                                = 'nvts_feed_version'),"
+                     "                         ''))"
+                     " FROM configs WHERE id = %llu;",
+                     config);
+  if (*key == NULL)
+    return NULL;
+
+  quoted_key = sql_quote (*key);
+  bundle = sql_string ("SELECT bundle FROM config_vts_bundles"
+                       " WHERE config = %llu AND key = '%s';",
+                       config,
+                       quoted_key);
+  g_free (quoted_key);
+  return bundle;
+}
+
+/**
+ * @brief Cache the OSP VT bundle of a config.
+ *
+ * @param[in]  config  Config.
+ * @param[in]  key     Key from config_vts_bundle.
+ * @param[in]  bundle  Bundle.
+ */
+void
+config_vts_bundle_set (config_t config, const gchar *key, const gchar *bundle)
+{
+  gchar *quoted_key, *quoted_bundle;
+
+  quoted_key = sql_quote (key);
+  quoted_bundle = sql_quote (bundle);
+  sql ("INSERT INTO config_vts_bundles (config, key, bundle)"
+       " VALUES (%llu, '%s', '%s')"
+       " ON CONFLICT (config)"
+       " DO UPDATE SET key = EXCLUDED.key, bundle = EXCLUDED.bundle;",
+       config,
+       quoted_key,
+       quoted_bundle);
+  g_free (quoted_key);
+  g_free (quoted_bundle);
+}
+
 /**
  * @brief Update a preference of a config.
  *
@@ -4780,4 +5084,10 @@ check_db_configs ()
          " AND family = 'Service detection'"
          " AND NOT EXISTS (SELECT * FROM nvts"
          "                 WHERE oid = nvt_selectors.family_or_nvt);");
+
+  /* Remove the cached family counts of deleted selectors. */
+
+  sql ("DELETE FROM nvt_selector_family_counts"
+       " WHERE NOT EXISTS (SELECT * FROM nvt_selectors"
+       "                   WHERE name = nvt_selector_family_counts.selector);");
 }
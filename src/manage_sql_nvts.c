@@ -161,6 +161,29 @@ nvts_feed_version ()
                      sql_schema ());
 }
 
+/**
+ * @brief Return the version of the feeds that NVT details come from.
+ *
+ * This is the NVT feed version together with the time of the last CERT
+ * update, because the details include the CERT advisories of the NVT.
+ *
+ * @return Freshly allocated version.
+ */
+char*
+nvt_details_version ()
+{
+  return sql_string ("SELECT coalesce ((SELECT value FROM %s.meta"
+                     "                  WHERE name = 'nvts_feed_version'),"
+                     "                 '')"
+                     "       || '/' || %s;",
+                     sql_schema (),
+                     manage_cert_loaded ()
+                      ? "coalesce ((SELECT value FROM cert.meta"
+                        "           WHERE name = 'last_update'),"
+                        "          '')"
+                      : "''");
+}
+
 /**
  * @brief Return feed version of the plugins as seconds since epoch.
  *
@@ -293,9 +316,7 @@ insert_nvt (const nvti_t *nvti)
 
   quoted_family = sql_quote (nvti_family (nvti) ? nvti_family (nvti) : "");
 
-  if (sql_int ("SELECT EXISTS (SELECT * FROM nvts WHERE oid = '%s');",
-               nvti_oid (nvti)))
-    sql ("DELETE FROM nvts WHERE oid = '%s';", nvti_oid (nvti));
+  sql ("DELETE FROM nvts WHERE oid = '%s';", nvti_oid (nvti));
 
   sql ("INSERT into nvts (oid, name, summary, insight, affected,"
        " impact, cve, tag, category, family, cvss_base,"
@@ -1345,9 +1366,27 @@ nvti_from_vt (entity_t vt)
   return nvti;
 }
 
+/**
+ * @brief Check whether the preference names have been checked after
+ *        migrating them to the new format.
+ *
+ * @return 1 if checked, else 0.
+ */
+static int
+nvt_preferences_checked ()
+{
+  return sql_int ("SELECT coalesce ((SELECT CAST (value AS INTEGER)"
+                  "                  FROM meta"
+                  "                  WHERE name = 'checked_preferences'),"
+                  "                 0);");
+}
+
 /**
  * @brief Update NVTs from VTs XML.
  *
+ * Only writes the NVTs whose modification time differs from the NVT in
+ * the db, along with their refs and preferences.
+ *
  * @param[in]  get_vts_response      OSP GET_VTS response.
  * @param[in]  scanner_feed_version  Version of feed from scanner.
  */
@@ -1358,13 +1397,12 @@ update_nvts_from_vts (entity_t *get_vts_response,
   entity_t vts, vt;
   entities_t children;
   GList *preferences;
-  int count_modified_vts, count_new_vts;
-  time_t feed_version_epoch;
+  int count_modified_vts, count_new_vts, count_unchanged_vts;
+  int skip_unchanged;
 
   count_modified_vts = 0;
   count_new_vts = 0;
-
-  feed_version_epoch = nvts_feed_version_epoch();
+  count_unchanged_vts = 0;
 
   vts = entity_child (*get_vts_response, "vts");
   if (vts == NULL)
@@ -1375,11 +1413,8 @@ update_nvts_from_vts (entity_t *get_vts_response,
 
   sql_begin_immediate ();
 
-  if (sql_int ("SELECT coalesce ((SELECT CAST (value AS INTEGER)"
-               "                  FROM meta"
-               "                  WHERE name = 'checked_preferences'),"
-               "                 0);")
-      == 0)
+  skip_unchanged = 1;
+  if (nvt_preferences_checked () == 0)
     /* We're in the first NVT sync after migrating preference names.
      *
      * If a preference was removed from an NVT then the preference will be in
@@ -1391,19 +1426,59 @@ update_nvts_from_vts (entity_t *get_vts_response,
      * preference would be inserted alongside the old version, resulting in a
      * duplicate when the name of the old version was corrected.
      *
-     * To solve both cases, we remove all nvt_preferences. */
-    sql ("TRUNCATE nvt_preferences;");
+     * To solve both cases, we remove all nvt_preferences, so every NVT
+     * must be written again. */
+    {
+      sql ("TRUNCATE nvt_preferences;");
+      skip_unchanged = 0;
+    }
 
   preferences = NULL;
   children = vts->entities;
   while ((vt = first_entity (children)))
     {
-      nvti_t *nvti = nvti_from_vt (vt);
+      nvti_t *nvti;
+      gchar *quoted_oid;
+      long long int db_modification_time;
 
-      if (nvti_creation_time (nvti) > feed_version_epoch)
-        count_new_vts += 1;
-      else
-        count_modified_vts += 1;
+      nvti = nvti_from_vt (vt);
+      if (nvti == NULL)
+        {
+          children = next_entities (children);
+          continue;
+        }
+
+      quoted_oid = sql_quote (nvti_oid (nvti));
+      switch (sql_int64 (&db_modification_time,
+                         "SELECT modification_time FROM nvts"
+                         " WHERE oid = '%s';",
+                         quoted_oid))
+        {
+          case 0:
+            if (skip_unchanged
+                && db_modification_time == nvti_modification_time (nvti))
+              {
+                count_unchanged_vts++;
+                g_free (quoted_oid);
+                nvti_free (nvti);
+                children = next_entities (children);
+                continue;
+              }
+            count_modified_vts++;
+            /* Clear preferences that the new version may have dropped. */
+            sql ("DELETE FROM nvt_preferences WHERE name LIKE '%s:%%';",
+                 quoted_oid);
+            break;
+          case 1:
+            count_new_vts++;
+            break;
+          default:
+            g_free (quoted_oid);
+            nvti_free (nvti);
+            sql_rollback ();
+            return;
+        }
+      g_free (quoted_oid);
 
       insert_nvt (nvti);
 
@@ -1424,16 +1499,29 @@ update_nvts_from_vts (entity_t *get_vts_response,
 
   set_nvts_feed_version (scanner_feed_version);
 
-  if (check_config_families ())
-    g_warning ("%s: Error updating config families."
-               "  One or more configs refer to an outdated family of an NVT.",
-               __func__);
-  update_all_config_caches ();
+  if (count_new_vts || count_modified_vts)
+    {
+      if (check_config_families ())
+        g_warning ("%s: Error updating config families."
+                   "  One or more configs refer to an outdated family of"
+                   " an NVT.",
+                   __func__);
+      nvt_selector_family_counts_update_nvts ();
+      update_all_config_caches ();
+    }
 
-  g_info ("Updating VTs in database ... %i new VTs, %i changed VTs",
-          count_new_vts, count_modified_vts);
+  g_info ("Updating VTs in database ... %i new VTs, %i changed VTs,"
+          " %i unchanged VTs skipped",
+          count_new_vts, count_modified_vts, count_unchanged_vts);
+
+  /* Dynamic severities come from the NVTs, so the cached ones are stale. */
+  if (count_new_vts || count_modified_vts)
+    sql ("DELETE FROM result_severities WHERE dynamic = 1;");
 
   sql_commit ();
+
+  if (count_new_vts || count_modified_vts)
+    aggregate_rollups_refresh ("nvt");
 }
 
 /**
@@ -1550,6 +1638,14 @@ manage_update_nvt_cache_osp (const gchar *update_socket)
   reinit_manage_process ();
   manage_session_init (current_credentials.uuid);
 
+  /* In a cluster the other nodes share the NVTs too. */
+
+  if (cluster_feed_lock (CLUSTER_FEED_NVT))
+    {
+      g_debug ("%s: skipping, another node is updating", __func__);
+      return 0;
+    }
+
   /* Try update VTs. */
 
   db_feed_version = nvts_feed_version ();
@@ -1565,6 +1661,7 @@ manage_update_nvt_cache_osp (const gchar *update_socket)
   if (osp_get_vts_version (connection, &scanner_feed_version))
     {
       g_warning ("%s: failed to get scanner_version", __func__);
+      osp_connection_close (connection);
       return -1;
     }
   g_debug ("%s: scanner_feed_version: %s", __func__, scanner_feed_version);
@@ -1598,7 +1695,9 @@ manage_update_nvt_cache_osp (const gchar *update_socket)
           return -1;
         }
 
-      if (db_feed_version)
+      /* Only get the VTs that changed since the last update, unless every
+       * NVT must be written again to fix the preference names. */
+      if (db_feed_version && nvt_preferences_checked ())
         get_vts_opts.filter = g_strdup_printf ("modification_time>%s", db_feed_version);
       else
         get_vts_opts.filter = NULL;
@@ -1606,6 +1705,7 @@ manage_update_nvt_cache_osp (const gchar *update_socket)
         {
           g_warning ("%s: failed to get VTs", __func__);
           g_free (get_vts_opts.filter);
+          osp_connection_close (connection);
           return -1;
         }
       g_free (get_vts_opts.filter);
@@ -1681,11 +1781,7 @@ manage_update_nvt_cache_osp (const gchar *update_socket)
       g_info ("Updating VTs in database ... done (%i VTs).",
               sql_int ("SELECT count (*) FROM nvts;"));
 
-      if (sql_int ("SELECT coalesce ((SELECT CAST (value AS INTEGER)"
-                   "                  FROM meta"
-                   "                  WHERE name = 'checked_preferences'),"
-                   "                 0);")
-          == 0)
+      if (nvt_preferences_checked () == 0)
         {
           check_old_preference_names ("config_preferences");
           check_old_preference_names ("config_preferences_trash");
@@ -1007,6 +1007,121 @@ ranges_sort_merge (array_t *ranges)
     }
 }
 
+/**
+ * @brief Store the merged port range and the port counts of a port list.
+ *
+ * Must be called whenever the ranges of a port list change, so that listing
+ * port lists and starting scans can use the stored values.
+ *
+ * @param[in]  port_list  Port list.
+ * @param[in]  trash      Whether port list is in the trashcan.
+ */
+static void
+port_list_cache_update (port_list_t port_list, int trash)
+{
+  iterator_t rows;
+  array_t *ranges;
+  GString *port_range;
+  int index, count_all, count_tcp, count_udp, previous_type;
+
+  ranges = make_array ();
+  init_iterator (&rows,
+                 "SELECT type, start, \"end\" FROM port_ranges%s"
+                 " WHERE port_list = %llu;",
+                 trash ? "_trash" : "",
+                 port_list);
+  while (next (&rows))
+    {
+      range_t *range;
+
+      range = g_malloc0 (sizeof (range_t));
+      range->type = iterator_int (&rows, 0);
+      range->start = iterator_int (&rows, 1);
+      range->end = iterator_int (&rows, 2);
+      if (range->end < range->start)
+        range->end = range->start;
+      array_add (ranges, range);
+    }
+  cleanup_iterator (&rows);
+
+  ranges_sort_merge (ranges);
+
+  /* Scanner can only handle: T:1-3,5-6,9,U:1-2 */
+
+  port_range = g_string_new ("");
+  count_all = count_tcp = count_udp = 0;
+  previous_type = -1;
+  for (index = 0; index < ranges->len; index++)
+    {
+      range_t *range;
+
+      range = (range_t*) g_ptr_array_index (ranges, index);
+      if (range == NULL)
+        break;
+
+      count_all += range->end - range->start + 1;
+      if (range->type == PORT_PROTOCOL_TCP)
+        count_tcp += range->end - range->start + 1;
+      else if (range->type == PORT_PROTOCOL_UDP)
+        count_udp += range->end - range->start + 1;
+
+      if (previous_type == -1)
+        g_string_append (port_range,
+                         range->type == PORT_PROTOCOL_UDP ? "U:" : "T:");
+      else
+        g_string_append_printf (port_range, ",%s",
+                                previous_type == PORT_PROTOCOL_TCP
+                                && range->type == PORT_PROTOCOL_UDP
+                                 ? "U:" : "");
+
+      if (range->end > range->start)
+        g_string_append_printf (port_range, "%i-%i", range->start, range->end);
+      else
+        g_string_append_printf (port_range, "%i", range->start);
+
+      previous_type = range->type;
+    }
+  array_free (ranges);
+
+  sql ("UPDATE port_lists%s"
+       " SET port_range = '%s', port_count_all = %i, port_count_tcp = %i,"
+       "     port_count_udp = %i"
+       " WHERE id = %llu;",
+       trash ? "_trash" : "",
+       port_range->str,
+       count_all,
+       count_tcp,
+       count_udp,
+       port_list);
+
+  g_string_free (port_range, TRUE);
+}
+
+/**
+ * @brief Return the port range of a port list, in scanner format.
+ *
+ * @param[in]  port_list  Port list.
+ *
+ * @return Newly allocated port range, for example "T:1-3,5,U:1-2".
+ */
+char *
+port_list_port_range (port_list_t port_list)
+{
+  char *port_range;
+
+  port_range = sql_string ("SELECT port_range FROM port_lists"
+                           " WHERE id = %llu;",
+                           port_list);
+  if (port_range)
+    return port_range;
+
+  port_list_cache_update (port_list, 0);
+  port_range = sql_string ("SELECT port_range FROM port_lists"
+                           " WHERE id = %llu;",
+                           port_list);
+  return port_range ? port_range : g_strdup ("");
+}
+
 /**
  * @brief Create a port list, with database locked.
  *
@@ -1068,6 +1183,7 @@ create_port_list_lock (const char *quoted_id, const char *quoted_name,
          range->start,
          range->end,
          range->exclude);
+  port_list_cache_update (*port_list, 0);
   return 0;
 }
 
@@ -1259,6 +1375,7 @@ create_port_list_internal (int check_access, const char *id, const char *name,
 
       port_list = sql_last_insert_id ();
       make_port_ranges_openvas_default (port_list);
+      port_list_cache_update (port_list, 0);
     }
   else
     {
@@ -1372,6 +1489,7 @@ copy_port_list (const char* name, const char* comment,
        "  FROM port_ranges WHERE port_list = %llu;",
        new,
        old);
+  port_list_cache_update (new, 0);
 
   sql_commit ();
   if (new_port_list) *new_port_list = new;
@@ -1558,6 +1676,7 @@ create_port_range (const char *port_list_id, const char *type,
        " (make_uuid (), %llu, %i, %i, %i, '', 0);",
        port_list, port_type, first, last, quoted_comment);
   g_free (quoted_comment);
+  port_list_cache_update (port_list, 0);
 
   if (port_range_return)
     *port_range_return = sql_last_insert_id ();
@@ -1649,9 +1768,11 @@ delete_port_list (const char *port_list_id, int ultimate)
       port_list_t trash_port_list;
 
       sql ("INSERT INTO port_lists_trash"
-           " (uuid, owner, name, comment, creation_time, modification_time)"
+           " (uuid, owner, name, comment, creation_time, modification_time,"
+           "  port_range, port_count_all, port_count_tcp, port_count_udp)"
            " SELECT uuid, owner, name, comment, creation_time,"
-           "        modification_time"
+           "        modification_time, port_range, port_count_all,"
+           "        port_count_tcp, port_count_udp"
            " FROM port_lists WHERE id = %llu;",
            port_list);
 
@@ -1726,6 +1847,7 @@ int
 delete_port_range (const char *port_range_id, int dummy)
 {
   port_range_t port_range = 0;
+  port_list_t port_list;
 
   sql_begin_immediate ();
 
@@ -1748,8 +1870,14 @@ delete_port_range (const char *port_range_id, int dummy)
       return 2;
     }
 
+  port_list = sql_int64_0 ("SELECT port_list FROM port_ranges"
+                           " WHERE id = %llu;",
+                           port_range);
+
   sql ("DELETE FROM port_ranges WHERE id = %llu;", port_range);
 
+  port_list_cache_update (port_list, 0);
+
   sql_commit ();
   return 0;
 }
@@ -1766,44 +1894,9 @@ delete_port_range (const char *port_range_id, int dummy)
 #define PORT_LIST_ITERATOR_COLUMNS                                 \
  {                                                                 \
    GET_ITERATOR_COLUMNS (port_lists),                              \
-   {                                                               \
-     /* COUNT ALL ports */                                         \
-     "(SELECT"                                                     \
-     " sum ((CASE"                                                 \
-     "       WHEN \"end\" IS NULL THEN start ELSE \"end\""         \
-     "       END)"                                                 \
-     "      - start"                                               \
-     "      + 1)"                                                  \
-     " FROM port_ranges WHERE port_list = port_lists.id)",         \
-     "total",                                                      \
-     KEYWORD_TYPE_INTEGER                                          \
-   },                                                              \
-   {                                                               \
-     /* COUNT TCP ports */                                         \
-     "(SELECT"                                                     \
-     " sum ((CASE"                                                 \
-     "       WHEN \"end\" IS NULL THEN start ELSE \"end\""         \
-     "       END)"                                                 \
-     "      - start"                                               \
-     "      + 1)"                                                  \
-     " FROM port_ranges WHERE port_list = port_lists.id"           \
-     "                  AND   type = 0)",                          \
-     "tcp",                                                        \
-     KEYWORD_TYPE_INTEGER                                          \
-   },                                                              \
-   {                                                               \
-     /* COUNT UDP ports */                                         \
-     "(SELECT"                                                     \
-     " sum ((CASE"                                                 \
-     "       WHEN \"end\" IS NULL THEN start ELSE \"end\""         \
-     "       END)"                                                 \
-     "      - start"                                               \
-     "      + 1)"                                                  \
-     " FROM port_ranges WHERE port_list = port_lists.id"           \
-     "                  AND   type = 1)",                          \
-     "udp",                                                        \
-     KEYWORD_TYPE_INTEGER                                          \
-   },                                                              \
+   { "port_count_all", "total", KEYWORD_TYPE_INTEGER },            \
+   { "port_count_tcp", "tcp", KEYWORD_TYPE_INTEGER },              \
+   { "port_count_udp", "udp", KEYWORD_TYPE_INTEGER },              \
    { NULL, NULL, KEYWORD_TYPE_UNKNOWN }                            \
  }
 
@@ -1813,45 +1906,9 @@ delete_port_range (const char *port_range_id, int dummy)
 #define PORT_LIST_ITERATOR_TRASH_COLUMNS                           \
  {                                                                 \
    GET_ITERATOR_COLUMNS (port_lists_trash),                        \
-   {                                                               \
-     /* COUNT ALL ports */                                         \
-     "(SELECT"                                                     \
-     " sum ((CASE"                                                 \
-     "       WHEN \"end\" IS NULL THEN start ELSE \"end\""         \
-     "       END)"                                                 \
-     "      - start"                                               \
-     "      + 1)"                                                  \
-     " FROM port_ranges_trash"                                     \
-     " WHERE port_list = port_lists_trash.id)",                    \
-     "total",                                                      \
-     KEYWORD_TYPE_INTEGER                                          \
-   },                                                              \
-   {                                                               \
-     /* COUNT TCP ports */                                         \
-     "(SELECT"                                                     \
-     " sum ((CASE"                                                 \
-     "       WHEN \"end\" IS NULL THEN start ELSE \"end\""         \
-     "       END)"                                                 \
-     "      - start"                                               \
-     "      + 1)"                                                  \
-     " FROM port_ranges_trash"                                     \
-     " WHERE port_list = port_lists_trash.id AND type = 0)",       \
-     "tcp",                                                        \
-     KEYWORD_TYPE_INTEGER                                          \
-   },                                                              \
-   {                                                               \
-     /* COUNT UDP ports */                                         \
-     "(SELECT"                                                     \
-     " sum ((CASE"                                                 \
-     "       WHEN \"end\" IS NULL THEN start ELSE \"end\""         \
-     "       END)"                                                 \
-     "      - start"                                               \
-     "      + 1)"                                                  \
-     " FROM port_ranges_trash"                                     \
-     " WHERE port_list = port_lists_trash.id AND type = 1)",       \
-     "udp",                                                        \
-     KEYWORD_TYPE_INTEGER                                          \
-   },                                                              \
+   { "port_count_all", "total", KEYWORD_TYPE_INTEGER },            \
+   { "port_count_tcp", "tcp", KEYWORD_TYPE_INTEGER },              \
+   { "port_count_udp", "udp", KEYWORD_TYPE_INTEGER },              \
    { NULL, NULL, KEYWORD_TYPE_UNKNOWN }                            \
  }
 
@@ -2332,8 +2389,10 @@ restore_port_list (const char *port_list_id)
     }
 
   sql ("INSERT INTO port_lists"
-       " (uuid, owner, name, comment, creation_time, modification_time)"
-       " SELECT uuid, owner, name, comment, creation_time, modification_time"
+       " (uuid, owner, name, comment, creation_time, modification_time,"
+       "  port_range, port_count_all, port_count_tcp, port_count_udp)"
+       " SELECT uuid, owner, name, comment, creation_time, modification_time,"
+       "        port_range, port_count_all, port_count_tcp, port_count_udp"
        " FROM port_lists_trash WHERE id = %llu;",
        port_list);
 
@@ -2508,10 +2567,30 @@ update_port_list (port_list_t port_list, const gchar *name,
   index = 0;
   while ((range = (range_t*) g_ptr_array_index (ranges, index++)))
     insert_port_range (port_list, range->type, range->start, range->end);
+  port_list_cache_update (port_list, 0);
 
   sql_commit ();
 }
 
+/**
+ * @brief Fill in the stored range and counts of port lists that lack them.
+ */
+static void
+port_lists_cache_fill ()
+{
+  iterator_t port_lists;
+
+  init_iterator (&port_lists,
+                 "SELECT id, 0 FROM port_lists WHERE port_range IS NULL"
+                 " UNION ALL"
+                 " SELECT id, 1 FROM port_lists_trash"
+                 " WHERE port_range IS NULL;");
+  while (next (&port_lists))
+    port_list_cache_update (iterator_int64 (&port_lists, 0),
+                            iterator_int (&port_lists, 1));
+  cleanup_iterator (&port_lists);
+}
+
 /**
  * @brief Ensure that the predefined port lists exist.
  */
@@ -2530,4 +2609,8 @@ check_db_port_lists ()
    * This should be a migrator, but this way is easier to backport.  */
   sql ("UPDATE port_ranges SET \"end\" = 65535 WHERE \"end\" = 65536;");
   sql ("UPDATE port_ranges SET start = 65535 WHERE start = 65536;");
+
+  /* Fill in the stored ranges and counts of any port lists that lack them,
+   * for example after the migration that added them. */
+  port_lists_cache_fill ();
 }
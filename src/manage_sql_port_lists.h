@@ -73,4 +73,7 @@ update_port_list (port_list_t, const gchar *, const gchar *, array_t *);
 void
 check_db_port_lists ();
 
+char *
+port_list_port_range (port_list_t);
+
 #endif /* not _GVMD_MANAGE_SQL_PORT_LISTS_H */
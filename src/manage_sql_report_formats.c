@@ -39,6 +39,7 @@
 #include <pwd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -193,9 +194,9 @@ resource_set_predefined (const gchar *type, resource_t resource, int enable)
  * @return 0 success, -1 error.
  */
 static int
-verify_signature (const gchar *installer, gsize installer_size,
-                  const gchar *signature, gsize signature_size,
-                  int *trust)
+verify_signature_gpgv (const gchar *installer, gsize installer_size,
+                       const gchar *signature, gsize signature_size,
+                       int *trust)
 {
   gchar **cmd;
   gint exit_status;
@@ -307,6 +308,120 @@ verify_signature (const gchar *installer, gsize installer_size,
   return ret;
 }
 
+/**
+ * @brief Get the modification time of the trusted keys file.
+ *
+ * @return Modification time, 0 if there is no trusted keys file.
+ */
+static time_t
+trustedkeys_mtime ()
+{
+  struct stat state;
+
+  if (stat (get_trustedkeys_name (), &state))
+    return 0;
+  return state.st_mtime;
+}
+
+/**
+ * @brief Get the key of an installer and signature in the verification cache.
+ *
+ * @param[in]  installer       Installer.
+ * @param[in]  installer_size  Size of installer.
+ * @param[in]  signature       Installer signature.
+ * @param[in]  signature_size  Size of installer signature.
+ *
+ * @return Freshly allocated SHA256 of the sizes and contents.
+ */
+static gchar *
+signature_cache_key (const gchar *installer, gsize installer_size,
+                     const gchar *signature, gsize signature_size)
+{
+  GChecksum *checksum;
+  gchar *sizes, *key;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  sizes = g_strdup_printf ("%" G_GSIZE_FORMAT ":%" G_GSIZE_FORMAT ":",
+                           installer_size, signature_size);
+  g_checksum_update (checksum, (const guchar *) sizes, strlen (sizes));
+  g_checksum_update (checksum, (const guchar *) installer, installer_size);
+  g_checksum_update (checksum, (const guchar *) signature, signature_size);
+  key = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+  g_free (sizes);
+  return key;
+}
+
+/**
+ * @brief Verify an installer signature, using earlier results if possible.
+ *
+ * A result is reused while the installer, the signature and the trusted
+ * keys file are unchanged, so that gpgv only runs for new material.  Only
+ * definite results are kept, because an unknown trust may come from gpgv
+ * failing to run.
+ *
+ * @param[in]  installer       Installer.
+ * @param[in]  installer_size  Size of installer.
+ * @param[in]  signature       Installer signature.
+ * @param[in]  signature_size  Size of installer signature.
+ * @param[out] trust           Trust value.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+verify_signature (const gchar *installer, gsize installer_size,
+                  const gchar *signature, gsize signature_size,
+                  int *trust)
+{
+  gchar *key;
+  time_t keyring_time;
+  int cached;
+
+  key = signature_cache_key (installer, installer_size, signature,
+                             signature_size);
+  keyring_time = trustedkeys_mtime ();
+
+  cached = sql_int ("SELECT coalesce ((SELECT trust"
+                    "                  FROM signature_verifications"
+                    "                  WHERE hash = '%s'"
+                    "                  AND keyring_time = %li),"
+                    "                 0);",
+                    key,
+                    (long) keyring_time);
+  if (cached)
+    {
+      g_debug ("%s: cached trust %i", __func__, cached);
+      *trust = cached;
+      g_free (key);
+      return 0;
+    }
+
+  if (verify_signature_gpgv (installer, installer_size, signature,
+                             signature_size, trust))
+    {
+      g_free (key);
+      return -1;
+    }
+
+  if (*trust == TRUST_YES || *trust == TRUST_NO)
+    {
+      /* Results for other keyrings can never match again. */
+      sql ("DELETE FROM signature_verifications WHERE keyring_time != %li;",
+           (long) keyring_time);
+      sql ("INSERT INTO signature_verifications (hash, keyring_time, trust)"
+           " VALUES ('%s', %li, %i)"
+           " ON CONFLICT (hash)"
+           " DO UPDATE SET keyring_time = EXCLUDED.keyring_time,"
+           "               trust = EXCLUDED.trust;",
+           key,
+           (long) keyring_time,
+           *trust);
+    }
+
+  g_free (key);
+  return 0;
+}
+
 /**
  * @brief Find a signature in a feed.
  *
@@ -3268,9 +3383,118 @@ verify_report_format (const char *report_format_id)
   return 0;
 }
 
+/**
+ * @brief Get the directory of the generate script of a report format.
+ *
+ * @param[in]   report_format     Report format.
+ * @param[in]   report_format_id  UUID of the report format.
+ *
+ * @return Freshly allocated path of the directory.
+ */
+static gchar *
+report_format_script_dir (report_format_t report_format,
+                          const gchar *report_format_id)
+{
+  gchar *owner, *script_dir;
+
+  if (report_format_predefined (report_format))
+    return predefined_report_format_dir (report_format_id);
+
+  owner = sql_string ("SELECT uuid FROM users"
+                      " WHERE id = (SELECT owner FROM"
+                      "             report_formats WHERE id = %llu);",
+                      report_format);
+  script_dir = g_build_filename (GVMD_STATE_DIR,
+                                 "report_formats",
+                                 owner,
+                                 report_format_id,
+                                 NULL);
+  g_free (owner);
+  return script_dir;
+}
+
+/**
+ * @brief Get the stylesheet of a report format that only runs xsltproc.
+ *
+ * Recognises generate scripts of the form "xsltproc ./NAME.xsl $1", with
+ * an optional stderr redirection, ignoring comments and blank lines.
+ *
+ * @param[in]   script_dir  Directory of the report format.
+ * @param[in]   script      Path of the generate script.
+ *
+ * @return Freshly allocated path of the stylesheet if the script is pure
+ *         XSL, else NULL.
+ */
+static gchar *
+report_format_script_stylesheet (const gchar *script_dir, const gchar *script)
+{
+  gchar *contents, **lines, **line, **words, *stylesheet;
+  int commands, word;
+
+  if (g_file_get_contents (script, &contents, NULL, NULL) == FALSE)
+    return NULL;
+
+  lines = g_strsplit (contents, "\n", 0);
+  g_free (contents);
+
+  commands = 0;
+  stylesheet = NULL;
+  for (line = lines; *line; line++)
+    {
+      const gchar *name;
+      int index;
+
+      g_strstrip (*line);
+      if (**line == '\0' || **line == '#')
+        continue;
+
+      commands++;
+      if (commands > 1)
+        break;
+
+      words = g_strsplit_set (*line, " \t", 0);
+      index = 0;
+      for (word = 0; words[word]; word++)
+        if (*words[word])
+          words[index++] = words[word];
+        else
+          g_free (words[word]);
+      words[index] = NULL;
+
+      name = words[0] && words[1]
+              ? (g_str_has_prefix (words[1], "./") ? words[1] + 2 : words[1])
+              : NULL;
+      if (index >= 3
+          && strcmp (words[0], "xsltproc") == 0
+          && name
+          && g_str_has_suffix (name, ".xsl")
+          && strchr (name, '/') == NULL
+          && (strcmp (words[2], "$1") == 0
+              || strcmp (words[2], "\"$1\"") == 0)
+          && (index == 3
+              || (index == 4 && g_str_has_prefix (words[3], "2>"))))
+        stylesheet = g_build_filename (script_dir, name, NULL);
+
+      g_strfreev (words);
+      if (stylesheet == NULL)
+        break;
+    }
+  g_strfreev (lines);
+
+  if (commands != 1)
+    {
+      g_free (stylesheet);
+      return NULL;
+    }
+  return stylesheet;
+}
+
 /**
  * @brief Runs the script of a report format.
  *
+ * Report formats that only run xsltproc on a stylesheet are transformed in
+ * process instead, with the compiled stylesheet cached.
+ *
  * @param[in]   report_format_id    UUID of the report format.
  * @param[in]   xml_file            Path to main part of the report XML.
  * @param[in]   xml_dir             Path of the dir with XML and subreports.
@@ -3288,8 +3512,9 @@ run_report_format_script (gchar *report_format_id,
 {
   iterator_t formats;
   report_format_t report_format;
-  gchar *script, *script_dir;
+  gchar *script, *script_dir, *stylesheet;
   get_data_t report_format_get;
+  int predefined;
 
   gchar *command;
   char *previous_dir;
@@ -3308,25 +3533,8 @@ run_report_format_script (gchar *report_format_id,
     }
 
   report_format = get_iterator_resource (&formats);
-
-  if (report_format_predefined (report_format))
-    {
-      script_dir = predefined_report_format_dir (report_format_id);
-    }
-  else
-    {
-      gchar *owner;
-      owner = sql_string ("SELECT uuid FROM users"
-                          " WHERE id = (SELECT owner FROM"
-                          "             report_formats WHERE id = %llu);",
-                          report_format);
-      script_dir = g_build_filename (GVMD_STATE_DIR,
-                                     "report_formats",
-                                     owner,
-                                     report_format_id,
-                                     NULL);
-      g_free (owner);
-    }
+  predefined = report_format_predefined (report_format);
+  script_dir = report_format_script_dir (report_format, report_format_id);
 
   cleanup_iterator (&formats);
 
@@ -3351,6 +3559,23 @@ run_report_format_script (gchar *report_format_id,
       return -1;
     }
 
+  /* Transform pure XSL formats in process.  Uploaded formats only when the
+   * script would have run with our privileges anyway. */
+
+  if (predefined || geteuid () != 0)
+    {
+      stylesheet = report_format_script_stylesheet (script_dir, script);
+      if (stylesheet)
+        {
+          g_debug ("%s: transforming with %s", __func__, stylesheet);
+          ret = xsl_transform_to_file (stylesheet, xml_file, output_file);
+          g_free (stylesheet);
+          g_free (script);
+          g_free (script_dir);
+          return ret;
+        }
+    }
+
   /* Change into the script directory. */
 
   previous_dir = getcwd (NULL, 0);
@@ -3580,20 +3805,33 @@ run_report_format_script (gchar *report_format_id,
 /**
  * @brief Completes a report by adding report format info.
  *
+ * When the start file is not needed again, it is moved instead of copied,
+ * which saves writing the whole report a second time.
+ *
  * @param[in]   xml_start      Path of file containing start of report.
  * @param[in]   xml_full       Path to file to print full report to.
  * @param[in]   report_format  Format of report that will be created from XML.
+ * @param[in]   consume_start  Whether the start file may be moved.
  *
  * @return 0 success, -1 error.
  */
 static int
 print_report_xml_end (gchar *xml_start, gchar *xml_full,
-                      report_format_t report_format)
+                      report_format_t report_format, int consume_start)
 {
   FILE *out;
   iterator_t params;
 
-  if (gvm_file_copy (xml_start, xml_full) == FALSE)
+  if (consume_start)
+    {
+      if (rename (xml_start, xml_full))
+        {
+          g_warning ("%s: failed to move xml_start file: %s",
+                     __func__, strerror (errno));
+          return -1;
+        }
+    }
+  else if (gvm_file_copy (xml_start, xml_full) == FALSE)
     {
       g_warning ("%s: failed to copy xml_start file", __func__);
       return -1;
@@ -3830,9 +4068,11 @@ apply_report_format (gchar *report_format_id,
   g_free (out_file_ext);
   g_free (out_file_part);
 
-  /* Add second half of input XML */
+  /* Add second half of input XML.  The start is only needed again while
+   * generating the subreports of a dependency. */
 
-  if (print_report_xml_end (xml_start, xml_file, report_format))
+  if (print_report_xml_end (xml_start, xml_file, report_format,
+                            *used_rfps == NULL))
     {
       g_free (output_file);
       output_file = NULL;
@@ -3868,6 +4108,79 @@ apply_report_format (gchar *report_format_id,
   return output_file;
 }
 
+/**
+ * @brief Apply a report format to an XML report, streaming the output.
+ *
+ * Only pure XSL report formats can be streamed, because they are transformed
+ * in process.  For other formats the caller must use apply_report_format.
+ *
+ * @param[in]  report_format_id   Report format to apply.
+ * @param[in]  xml_start          Path to the main part of the report XML.
+ *                                Moved to xml_file.
+ * @param[in]  xml_file           Path to the report XML file.
+ * @param[in]  write              Function that writes a piece of the output.
+ *                                Must return the number of bytes written, or
+ *                                -1 on error.
+ * @param[in]  write_data         Argument for \p write.
+ *
+ * @return 0 success, 1 report format cannot be streamed, -1 error.
+ */
+int
+apply_report_format_stream (gchar *report_format_id,
+                            gchar *xml_start,
+                            gchar *xml_file,
+                            int (*write) (void *, const char *, int),
+                            void *write_data)
+{
+  report_format_t report_format;
+  gchar *script_dir, *script, *stylesheet;
+  int ret;
+
+  assert (report_format_id);
+  assert (xml_start);
+  assert (xml_file);
+
+  if (find_report_format_with_permission (report_format_id, &report_format,
+                                          "get_report_formats")
+      || report_format == 0)
+    {
+      g_message ("%s: Report format '%s' not found",
+                 __func__, report_format_id);
+      return -1;
+    }
+
+  if (report_format_active (report_format) == 0)
+    {
+      g_message ("%s: Report format '%s' is not active",
+                 __func__, report_format_id);
+      return -1;
+    }
+
+  /* Uploaded formats only when the script would have run with our
+   * privileges anyway, as in run_report_format_script. */
+  if (report_format_predefined (report_format) == 0 && geteuid () == 0)
+    return 1;
+
+  script_dir = report_format_script_dir (report_format, report_format_id);
+  script = g_build_filename (script_dir, "generate", NULL);
+  stylesheet = report_format_script_stylesheet (script_dir, script);
+  g_free (script);
+  g_free (script_dir);
+  if (stylesheet == NULL)
+    return 1;
+
+  if (print_report_xml_end (xml_start, xml_file, report_format, 1))
+    {
+      g_free (stylesheet);
+      return -1;
+    }
+
+  g_debug ("%s: streaming with %s", __func__, stylesheet);
+  ret = xsl_transform_to_stream (stylesheet, xml_file, write, write_data);
+  g_free (stylesheet);
+  return ret;
+}
+
 /**
  * @brief Empty trashcan.
  *
@@ -53,6 +53,10 @@ gchar *
 apply_report_format (gchar *, gchar *, gchar *, gchar *,
                      GList **);
 
+int
+apply_report_format_stream (gchar *, gchar *, gchar *,
+                            int (*) (void *, const char *, int), void *);
+
 void
 delete_report_formats_user (user_t);
 
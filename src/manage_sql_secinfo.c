@@ -45,8 +45,11 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include <libxml/xmlreader.h>
+
 #include <gvm/base/proctitle.h>
 #include <gvm/util/fileutils.h>
 
@@ -64,11 +67,22 @@
  */
 #define CPE_MAX_CHUNK_SIZE 10000
 
+/**
+ * @brief Size of data to collect before sending it to a COPY.
+ */
+#define COPY_BUFFER_SIZE 1048576
+
 /**
  * @brief Commit size for updates.
  */
 static int secinfo_commit_size = SECINFO_COMMIT_SIZE_DEFAULT;
 
+/**
+ * @brief Number of processes that load SecInfo files, 0 to load in sync
+ *        process.
+ */
+static int secinfo_sync_workers = SECINFO_SYNC_WORKERS_DEFAULT;
+
 
 /* Headers. */
 
@@ -568,6 +582,26 @@ DEF_ACCESS (cpe_info_iterator_cve_refs, GET_ITERATOR_COLUMN_COUNT + 4);
  */
 DEF_ACCESS (cpe_info_iterator_nvd_id, GET_ITERATOR_COLUMN_COUNT + 5);
 
+/**
+ * @brief Get the feed XML of a CPE, as stored at sync time.
+ *
+ * @param[in]  name  Name of the CPE.
+ *
+ * @return The cpe-item element of the CPE, or NULL if the db has no XML for
+ *         the CPE.  Freed by g_free.
+ */
+gchar *
+cpe_details_xml (const gchar *name)
+{
+  gchar *quoted_name, *ret;
+
+  quoted_name = sql_quote (name);
+  ret = sql_string ("SELECT raw_xml FROM cpes WHERE name = '%s';",
+                    quoted_name);
+  g_free (quoted_name);
+  return ret;
+}
+
 
 /* CVE data. */
 
@@ -661,6 +695,26 @@ cve_cvss_base (const gchar *cve)
   return ret;
 }
 
+/**
+ * @brief Get the feed XML of a CVE, as stored at sync time.
+ *
+ * @param[in]  name  Name of the CVE.
+ *
+ * @return The entry element of the CVE, or NULL if the db has no XML for
+ *         the CVE.  Freed by g_free.
+ */
+gchar *
+cve_details_xml (const gchar *name)
+{
+  gchar *quoted_name, *ret;
+
+  quoted_name = sql_quote (name);
+  ret = sql_string ("SELECT raw_xml FROM cves WHERE name = '%s';",
+                    quoted_name);
+  g_free (quoted_name);
+  return ret;
+}
+
 /**
  * @brief Count number of cve.
  *
@@ -2378,19 +2432,23 @@ update_scap_cpes_from_file (const gchar *path, int last_cve_update)
 
   inserts_init (&inserts,
                 CPE_MAX_CHUNK_SIZE,
-                "INSERT INTO scap.cpes"
-                " (uuid, name, title, creation_time,"
-                "  modification_time, status, deprecated_by_id,"
-                "  nvd_id)"
-                " VALUES",
-                " ON CONFLICT (uuid) DO UPDATE"
-                " SET name = EXCLUDED.name,"
-                "     title = EXCLUDED.title,"
-                "     creation_time = EXCLUDED.creation_time,"
-                "     modification_time = EXCLUDED.modification_time,"
-                "     status = EXCLUDED.status,"
-                "     deprecated_by_id = EXCLUDED.deprecated_by_id,"
-                "     nvd_id = EXCLUDED.nvd_id");
+                "WITH rows AS (INSERT INTO scap.cpes"
+                "              (uuid, name, title, creation_time,"
+                "               modification_time, status, deprecated_by_id,"
+                "               nvd_id)"
+                "              VALUES",
+                "              ON CONFLICT (uuid) DO UPDATE"
+                "              SET name = EXCLUDED.name,"
+                "                  title = EXCLUDED.title,"
+                "                  creation_time = EXCLUDED.creation_time,"
+                "                  modification_time"
+                "                  = EXCLUDED.modification_time,"
+                "                  status = EXCLUDED.status,"
+                "                  deprecated_by_id = EXCLUDED.deprecated_by_id,"
+                "                  nvd_id = EXCLUDED.nvd_id,"
+                "                  raw_xml = NULL"
+                "              RETURNING id)"
+                " INSERT INTO changed_cpes SELECT id FROM rows");
   cpe_item = element_first_child (cpe_list);
   while (cpe_item)
     {
@@ -2448,6 +2506,461 @@ update_scap_cpes_from_file (const gchar *path, int last_cve_update)
   return -1;
 }
 
+/**
+ * @brief Get an attribute of an XML node.
+ *
+ * @param[in]  node  Node.
+ * @param[in]  name  Name of attribute.
+ *
+ * @return Freshly allocated value of attribute if present, else NULL.
+ */
+static gchar *
+xml_node_attribute (xmlNodePtr node, const gchar *name)
+{
+  xmlChar *value;
+  gchar *ret;
+
+  value = xmlGetProp (node, (const xmlChar *) name);
+  if (value == NULL)
+    return NULL;
+  ret = g_strdup ((gchar *) value);
+  xmlFree (value);
+  return ret;
+}
+
+/**
+ * @brief Get the first child element of an XML node with a given name.
+ *
+ * @param[in]  node  Node.
+ * @param[in]  name  Name of child, without namespace prefix.
+ *
+ * @return Child if found, else NULL.
+ */
+static xmlNodePtr
+xml_node_child (xmlNodePtr node, const gchar *name)
+{
+  xmlNodePtr child;
+
+  for (child = node->children; child; child = child->next)
+    if (child->type == XML_ELEMENT_NODE
+        && xmlStrcmp (child->name, (const xmlChar *) name) == 0)
+      return child;
+  return NULL;
+}
+
+/**
+ * @brief Serialise an XML node as a standalone element.
+ *
+ * The copy declares the namespaces that the node uses, so that the result
+ * can be parsed on its own.
+ *
+ * @param[in]  node  Node.
+ *
+ * @return Freshly allocated XML.
+ */
+static gchar *
+xml_node_dump (xmlNodePtr node)
+{
+  xmlDocPtr doc;
+  xmlNodePtr copy;
+  xmlBufferPtr buffer;
+  gchar *ret;
+
+  doc = xmlNewDoc ((const xmlChar *) "1.0");
+  copy = xmlDocCopyNode (node, doc, 1);
+  xmlDocSetRootElement (doc, copy);
+  xmlReconciliateNs (doc, copy);
+
+  buffer = xmlBufferCreate ();
+  xmlNodeDump (buffer, doc, copy, 0, 0);
+  ret = g_strndup ((const gchar *) xmlBufferContent (buffer),
+                   xmlBufferLength (buffer));
+  xmlBufferFree (buffer);
+  xmlFreeDoc (doc);
+  return ret;
+}
+
+/**
+ * @brief Add a SCAP CPE to a COPY buffer.
+ *
+ * @param[in]  rows             COPY buffer.
+ * @param[in]  cpe_item         CPE item node.
+ * @param[in]  last_cve_update  Time of last CVE update.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+copy_scap_cpe (GString *rows, xmlNodePtr cpe_item, int last_cve_update)
+{
+  xmlNodePtr item_metadata, child;
+  gchar *name, *modification_date, *status, *deprecated, *nvd_id;
+  gchar *title, *name_decoded, *name_tilde, *time_text, *raw_xml;
+  int modification_time;
+
+  item_metadata = xml_node_child (cpe_item, "item-metadata");
+  if (item_metadata == NULL)
+    {
+      g_warning ("%s: item-metadata missing", __func__);
+      return -1;
+    }
+
+  modification_date = xml_node_attribute (item_metadata, "modification-date");
+  if (modification_date == NULL)
+    {
+      g_warning ("%s: modification-date missing", __func__);
+      return -1;
+    }
+  modification_time = parse_iso_time (modification_date);
+  g_free (modification_date);
+
+  if (modification_time <= last_cve_update)
+    return 0;
+
+  name = xml_node_attribute (cpe_item, "name");
+  if (name == NULL)
+    {
+      g_warning ("%s: name missing", __func__);
+      return -1;
+    }
+
+  status = xml_node_attribute (item_metadata, "status");
+  if (status == NULL)
+    {
+      g_warning ("%s: status missing", __func__);
+      g_free (name);
+      return -1;
+    }
+
+  deprecated = xml_node_attribute (item_metadata, "deprecated-by-nvd-id");
+  if (deprecated
+      && (g_regex_match_simple ("^[0-9]+$", (gchar *) deprecated, 0, 0)
+          == 0))
+    {
+      g_warning ("%s: invalid deprecated-by-nvd-id: %s",
+                 __func__,
+                 deprecated);
+      g_free (name);
+      g_free (status);
+      g_free (deprecated);
+      return -1;
+    }
+
+  nvd_id = xml_node_attribute (item_metadata, "nvd-id");
+  if (nvd_id == NULL)
+    {
+      g_warning ("%s: nvd_id missing", __func__);
+      g_free (name);
+      g_free (status);
+      g_free (deprecated);
+      return -1;
+    }
+
+  title = NULL;
+  for (child = cpe_item->children; child; child = child->next)
+    if (child->type == XML_ELEMENT_NODE
+        && xmlStrcmp (child->name, (const xmlChar *) "title") == 0)
+      {
+        xmlChar *lang;
+
+        lang = xmlNodeGetLang (child);
+        if (lang && xmlStrcmp (lang, (const xmlChar *) "en-US") == 0)
+          {
+            xmlChar *content;
+
+            content = xmlNodeGetContent (child);
+            title = g_strdup (content ? (gchar *) content : "");
+            xmlFree (content);
+            xmlFree (lang);
+            break;
+          }
+        xmlFree (lang);
+      }
+
+  name_decoded = g_uri_unescape_string (name, NULL);
+  g_free (name);
+  name_tilde = string_replace (name_decoded,
+                               "~", "%7E", "%7e", NULL);
+  g_free (name_decoded);
+  time_text = g_strdup_printf ("%i", modification_time);
+  raw_xml = xml_node_dump (cpe_item);
+
+  sql_copy_append (rows, name_tilde, 0);
+  sql_copy_append (rows, name_tilde, 0);
+  sql_copy_append (rows, title ? title : "", 0);
+  sql_copy_append (rows, time_text, 0);
+  sql_copy_append (rows, time_text, 0);
+  sql_copy_append (rows, status, 0);
+  sql_copy_append (rows, deprecated, 0);
+  sql_copy_append (rows, nvd_id, 0);
+  sql_copy_append (rows, raw_xml, 1);
+
+  g_free (name_tilde);
+  g_free (raw_xml);
+  g_free (title);
+  g_free (time_text);
+  g_free (status);
+  g_free (deprecated);
+  g_free (nvd_id);
+
+  return 0;
+}
+
+/**
+ * @brief Load SCAP CPEs from a file into the staging table.
+ *
+ * Reads the file with a streaming parser, so that only one CPE item is in
+ * memory at a time.
+ *
+ * @param[in]  path             Path to file.
+ * @param[in]  last_cve_update  Time of last CVE update.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+copy_scap_cpes_from_file (const gchar *path, int last_cve_update)
+{
+  xmlTextReaderPtr reader;
+  GString *rows;
+  int ret;
+
+  g_debug ("%s: loading %s", __func__, path);
+
+  reader = xmlReaderForFile (path, NULL, XML_PARSE_HUGE | XML_PARSE_NONET);
+  if (reader == NULL)
+    {
+      g_warning ("%s: Failed to open %s", __func__, path);
+      return -1;
+    }
+
+  if (sql_copy_start ("COPY scap.cpes_staging"
+                      " (uuid, name, title, creation_time,"
+                      "  modification_time, status, deprecated_by_id,"
+                      "  nvd_id, raw_xml)"
+                      " FROM STDIN;"))
+    {
+      xmlFreeTextReader (reader);
+      return -1;
+    }
+
+  rows = g_string_new ("");
+  ret = xmlTextReaderRead (reader);
+  while (ret == 1)
+    {
+      xmlNodePtr cpe_item;
+
+      if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT
+          || xmlTextReaderDepth (reader) != 1
+          || xmlStrcmp (xmlTextReaderConstLocalName (reader),
+                        (const xmlChar *) "cpe-item"))
+        {
+          ret = xmlTextReaderRead (reader);
+          continue;
+        }
+
+      cpe_item = xmlTextReaderExpand (reader);
+      if (cpe_item == NULL
+          || copy_scap_cpe (rows, cpe_item, last_cve_update))
+        {
+          ret = -1;
+          break;
+        }
+
+      if (rows->len >= COPY_BUFFER_SIZE)
+        {
+          if (sql_copy_data (rows->str, rows->len))
+            {
+              ret = -1;
+              break;
+            }
+          g_string_truncate (rows, 0);
+        }
+
+      /* Skip to the next CPE item, letting the reader free this one. */
+      ret = xmlTextReaderNext (reader);
+    }
+
+  xmlFreeTextReader (reader);
+
+  if (ret == 0 && rows->len && sql_copy_data (rows->str, rows->len))
+    ret = -1;
+  g_string_free (rows, TRUE);
+
+  if (ret)
+    {
+      g_warning ("%s: Failed to load %s", __func__, path);
+      sql_copy_end ("Failed to load CPEs");
+      return -1;
+    }
+
+  return sql_copy_end (NULL);
+}
+
+/**
+ * @brief Load a worker's share of split SCAP CPE files into the staging table.
+ *
+ * @param[in]  split_dir        Directory holding split files.
+ * @param[in]  worker           Number of the worker, from 0.
+ * @param[in]  last_cve_update  Time of last CVE update.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+copy_scap_cpes_worker (const gchar *split_dir, int worker,
+                       int last_cve_update)
+{
+  int index;
+
+  for (index = 1 + worker; 1; index += secinfo_sync_workers)
+    {
+      GStatBuf state;
+      gchar *path, *name;
+      int ret;
+
+      name = g_strdup_printf ("split-%02i.xml", index);
+      path = g_build_filename (split_dir, name, NULL);
+      g_free (name);
+
+      if (g_stat (path, &state))
+        {
+          g_free (path);
+          break;
+        }
+
+      ret = copy_scap_cpes_from_file (path, last_cve_update);
+      g_free (path);
+      if (ret)
+        return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Update SCAP CPEs from split files using parallel workers.
+ *
+ * Each worker streams its files into an unlogged staging table with COPY.
+ * The staging table is then merged into the CPEs in a single transaction,
+ * so readers see either the old or the new data.
+ *
+ * @param[in]  split_dir        Directory holding split files.
+ * @param[in]  last_cve_update  Time of last CVE update.
+ *
+ * @return 0 nothing to do, 1 updated, -1 error.
+ */
+static int
+update_scap_cpes_parallel (const gchar *split_dir, int last_cve_update)
+{
+  GArray *pids;
+  gint64 start;
+  guint index;
+  int worker, failed, updated;
+
+  start = g_get_monotonic_time ();
+
+  sql ("DROP TABLE IF EXISTS scap.cpes_staging;");
+  sql ("CREATE UNLOGGED TABLE scap.cpes_staging"
+       " (uuid text, name text, title text, creation_time integer,"
+       "  modification_time integer, status text, deprecated_by_id integer,"
+       "  nvd_id text, raw_xml text);");
+
+  failed = 0;
+  pids = g_array_new (FALSE, FALSE, sizeof (pid_t));
+  for (worker = 0; worker < secinfo_sync_workers; worker++)
+    {
+      pid_t pid;
+
+      pid = fork ();
+      if (pid == 0)
+        {
+          /* Child.  Reopen the database (required after fork). */
+          reinit_manage_process ();
+          proctitle_set ("gvmd: Syncing SCAP: Loading CPEs");
+          exit (copy_scap_cpes_worker (split_dir, worker, last_cve_update)
+                 ? EXIT_FAILURE
+                 : EXIT_SUCCESS);
+        }
+      if (pid == -1)
+        {
+          g_warning ("%s: fork: %s", __func__, strerror (errno));
+          failed = 1;
+          break;
+        }
+      g_array_append_val (pids, pid);
+    }
+
+  for (index = 0; index < pids->len; index++)
+    {
+      pid_t pid;
+      int status;
+
+      pid = g_array_index (pids, pid_t, index);
+      while (waitpid (pid, &status, 0) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+          status = -1;
+          break;
+        }
+      if (status == -1 || WIFEXITED (status) == 0 || WEXITSTATUS (status))
+        {
+          g_warning ("%s: CPE worker %i failed", __func__, pid);
+          failed = 1;
+        }
+    }
+  g_array_free (pids, TRUE);
+
+  if (failed)
+    {
+      sql ("DROP TABLE scap.cpes_staging;");
+      return -1;
+    }
+
+  g_info ("%s: Loaded CPEs with %i workers in %.1f s",
+          __func__,
+          secinfo_sync_workers,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
+  start = g_get_monotonic_time ();
+
+  sql_begin_immediate ();
+
+  updated = sql_int ("SELECT EXISTS (SELECT * FROM scap.cpes_staging);");
+
+  /* Split files may repeat a CPE, so keep the newest. */
+  sql ("WITH rows AS (INSERT INTO scap.cpes"
+       "              (uuid, name, title, creation_time,"
+       "               modification_time, status, deprecated_by_id,"
+       "               nvd_id, raw_xml)"
+       "              SELECT DISTINCT ON (uuid)"
+       "                     uuid, name, title, creation_time,"
+       "                     modification_time, status, deprecated_by_id,"
+       "                     nvd_id, raw_xml"
+       "              FROM scap.cpes_staging"
+       "              ORDER BY uuid, modification_time DESC"
+       "              ON CONFLICT (uuid) DO UPDATE"
+       "              SET name = EXCLUDED.name,"
+       "                  title = EXCLUDED.title,"
+       "                  creation_time = EXCLUDED.creation_time,"
+       "                  modification_time = EXCLUDED.modification_time,"
+       "                  status = EXCLUDED.status,"
+       "                  deprecated_by_id = EXCLUDED.deprecated_by_id,"
+       "                  nvd_id = EXCLUDED.nvd_id,"
+       "                  raw_xml = EXCLUDED.raw_xml"
+       "              RETURNING id)"
+       " INSERT INTO changed_cpes SELECT id FROM rows;");
+
+  sql ("DROP TABLE scap.cpes_staging;");
+
+  sql_commit ();
+
+  g_info ("%s: Merged CPEs in %.1f s",
+          __func__,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
+  return updated;
+}
+
 /**
  * @brief Update SCAP CPEs.
  *
@@ -2486,9 +2999,12 @@ update_scap_cpes (int last_scap_update)
 
   g_info ("Updating CPEs");
 
-  /* This will be zero for an empty db, so everything will be added. */
-  last_cve_update = sql_int ("SELECT max (modification_time)"
-                             " FROM scap.cves;");
+  /* This will be zero for an empty db, so everything will be added.  CVEs
+   * without XML are left out, so that a db that has not kept the XML yet
+   * gets all the CPEs again. */
+  last_cve_update = sql_int ("SELECT coalesce (max (modification_time), 0)"
+                             " FROM scap.cves"
+                             " WHERE raw_xml IS NOT NULL;");
 
   split_dir = split_xml_file (full_path, "40Mb", "</cpe-list>");
   if (split_dir == NULL)
@@ -2502,6 +3018,14 @@ update_scap_cpes (int last_scap_update)
     }
   g_free (full_path);
 
+  if (secinfo_sync_workers > 0)
+    {
+      updated_scap_cpes = update_scap_cpes_parallel (split_dir,
+                                                     last_cve_update);
+      gvm_file_remove_recurse (split_dir);
+      return updated_scap_cpes;
+    }
+
   for (index = 1; 1; index++)
     {
       int ret;
@@ -2731,14 +3255,16 @@ insert_cve_products (element_t list, resource_t cve,
  *
  * @param[in]  entry             XML entry.
  * @param[in]  last_modified     XML last_modified element.
- * @param[in]  transaction_size  Statement counter for batching.
+ * @param[in]  raw_xml           XML of entry, for the detail view.
  * @param[in]  hashed_cpes       Hashed CPEs.
+ * @param[in]  transaction_size  Statement counter for batching.
  *
  * @return 0 success, -1 error.
  */
 static int
 insert_cve_from_entry (element_t entry, element_t last_modified,
-                       GHashTable *hashed_cpes, int *transaction_size)
+                       const gchar *raw_xml, GHashTable *hashed_cpes,
+                       int *transaction_size)
 {
   element_t published, summary, cvss, score, base_metrics;
   element_t access_vector, access_complexity, authentication;
@@ -2748,7 +3274,7 @@ insert_cve_from_entry (element_t entry, element_t last_modified,
   gchar *quoted_access_vector, *quoted_access_complexity;
   gchar *quoted_authentication, *quoted_confidentiality_impact;
   gchar *quoted_integrity_impact, *quoted_availability_impact;
-  gchar *quoted_software, *id, *score_text;
+  gchar *quoted_software, *quoted_raw_xml, *id, *score_text;
   GString *software;
   gchar *software_unescaped, *software_tilde;
   int time_modified, time_published;
@@ -2905,33 +3431,39 @@ insert_cve_from_entry (element_t entry, element_t last_modified,
   g_free (software_unescaped);
   quoted_software = sql_quote (software_tilde);
   g_free (software_tilde);
+  quoted_raw_xml = sql_quote (raw_xml);
   time_modified = parse_iso_time_element_text (last_modified);
   time_published = parse_iso_time_element_text (published);
   score_text = score ? element_text (score) : g_strdup ("NULL");
   cve = sql_int64_0
-         ("INSERT INTO scap.cves"
-          " (uuid, name, creation_time, modification_time,"
-          "  cvss, description, vector, complexity,"
-          "  authentication, confidentiality_impact,"
-          "  integrity_impact, availability_impact, products)"
-          " VALUES"
-          " ('%s', '%s', %i, %i, %s, '%s', '%s', '%s', '%s',"
-          "  '%s', '%s', '%s', '%s')"
-          " ON CONFLICT (uuid) DO UPDATE"
-          " SET name = EXCLUDED.name,"
-          "     creation_time = EXCLUDED.creation_time,"
-          "     modification_time = EXCLUDED.modification_time,"
-          "     cvss = EXCLUDED.cvss,"
-          "     description = EXCLUDED.description,"
-          "     vector = EXCLUDED.vector,"
-          "     complexity = EXCLUDED.complexity,"
-          "     authentication = EXCLUDED.authentication,"
-          "     confidentiality_impact"
-          "     = EXCLUDED.confidentiality_impact,"
-          "     integrity_impact = EXCLUDED.integrity_impact,"
-          "     availability_impact = EXCLUDED.availability_impact,"
-          "     products = EXCLUDED.products"
-          " RETURNING scap.cves.id;",
+         ("WITH row AS (INSERT INTO scap.cves"
+          "             (uuid, name, creation_time, modification_time,"
+          "              cvss, description, vector, complexity,"
+          "              authentication, confidentiality_impact,"
+          "              integrity_impact, availability_impact, products,"
+          "              raw_xml)"
+          "             VALUES"
+          "             ('%s', '%s', %i, %i, %s, '%s', '%s', '%s', '%s',"
+          "              '%s', '%s', '%s', '%s', '%s')"
+          "             ON CONFLICT (uuid) DO UPDATE"
+          "             SET name = EXCLUDED.name,"
+          "                 creation_time = EXCLUDED.creation_time,"
+          "                 modification_time = EXCLUDED.modification_time,"
+          "                 cvss = EXCLUDED.cvss,"
+          "                 description = EXCLUDED.description,"
+          "                 vector = EXCLUDED.vector,"
+          "                 complexity = EXCLUDED.complexity,"
+          "                 authentication = EXCLUDED.authentication,"
+          "                 confidentiality_impact"
+          "                 = EXCLUDED.confidentiality_impact,"
+          "                 integrity_impact = EXCLUDED.integrity_impact,"
+          "                 availability_impact"
+          "                 = EXCLUDED.availability_impact,"
+          "                 products = EXCLUDED.products,"
+          "                 raw_xml = EXCLUDED.raw_xml"
+          "             RETURNING scap.cves.id),"
+          "      changed AS (INSERT INTO changed_cves SELECT id FROM row)"
+          " SELECT id FROM row;",
           quoted_id,
           quoted_id,
           time_published,
@@ -2944,7 +3476,8 @@ insert_cve_from_entry (element_t entry, element_t last_modified,
           quoted_confidentiality_impact,
           quoted_integrity_impact,
           quoted_availability_impact,
-          quoted_software);
+          quoted_software,
+          quoted_raw_xml);
   increment_transaction_size (transaction_size);
   g_free (quoted_summary);
   g_free (quoted_access_vector);
@@ -2953,6 +3486,8 @@ insert_cve_from_entry (element_t entry, element_t last_modified,
   g_free (quoted_confidentiality_impact);
   g_free (quoted_integrity_impact);
   g_free (quoted_availability_impact);
+  g_free (quoted_software);
+  g_free (quoted_raw_xml);
   g_free (score_text);
 
   insert_cve_products (list, cve, time_published, time_modified,
@@ -2965,23 +3500,25 @@ insert_cve_from_entry (element_t entry, element_t last_modified,
 /**
  * @brief Update CVE info from a single XML feed file.
  *
+ * Reads the file with a streaming parser, so that only one entry is in
+ * memory at a time.  Entries that the db already has are skipped before
+ * they are parsed into elements.
+ *
  * @param[in]  xml_path          XML path.
  * @param[in]  last_scap_update  Time of last SCAP update.
- * @param[in]  last_cve_update   Time of last update to a DFN.
+ * @param[in]  hashed_cves       Modification times of CVEs in the db.
  * @param[in]  hashed_cpes       Hashed CPEs.
  *
  * @return 0 nothing to do, 1 updated, -1 error.
  */
 static int
 update_cve_xml (const gchar *xml_path, int last_scap_update,
-                int last_cve_update, GHashTable *hashed_cpes)
+                GHashTable *hashed_cves, GHashTable *hashed_cpes)
 {
-  GError *error;
-  element_t element, entry;
-  gchar *xml, *full_path;
-  gsize xml_len;
+  xmlTextReaderPtr reader;
+  gchar *full_path;
   GStatBuf state;
-  int updated_scap_bund;
+  int updated_scap_bund, ret;
   int transaction_size = 0;
 
   updated_scap_bund = 0;
@@ -3006,60 +3543,100 @@ update_cve_xml (const gchar *xml_path, int last_scap_update,
 
   g_info ("Updating %s", full_path);
 
-  error = NULL;
-  g_file_get_contents (full_path, &xml, &xml_len, &error);
-  if (error)
+  reader = xmlReaderForFile (full_path, NULL,
+                             XML_PARSE_HUGE | XML_PARSE_NONET);
+  if (reader == NULL)
     {
-      g_warning ("%s: Failed to get contents: %s",
-                 __func__,
-                 error->message);
-      g_error_free (error);
+      g_warning ("%s: Failed to open %s", __func__, full_path);
       g_free (full_path);
       return -1;
     }
 
-  if (parse_element (xml, &element))
-    {
-      g_free (xml);
-      g_warning ("%s: Failed to parse element", __func__);
-      g_free (full_path);
-      return -1;
-    }
-  g_free (xml);
-
   sql_begin_immediate ();
-  entry = element_first_child (element);
-  while (entry)
-    {
-      if (strcmp (element_name (entry), "entry") == 0)
+  ret = xmlTextReaderRead (reader);
+  while (ret == 1)
+    {
+      xmlNodePtr node, modified;
+      xmlChar *modified_text;
+      element_t entry, last_modified;
+      gchar *id, *raw_xml;
+      gpointer db_time;
+      int unchanged;
+
+      if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT
+          || xmlTextReaderDepth (reader) != 1
+          || xmlStrcmp (xmlTextReaderConstLocalName (reader),
+                        (const xmlChar *) "entry"))
         {
-          element_t last_modified;
+          ret = xmlTextReaderRead (reader);
+          continue;
+        }
+
+      node = xmlTextReaderExpand (reader);
+      if (node == NULL)
+        goto fail;
 
-          last_modified = element_child (entry, "vuln:last-modified-datetime");
-          if (last_modified == NULL)
+      modified = xml_node_child (node, "last-modified-datetime");
+      if (modified == NULL)
+        {
+          g_warning ("%s: vuln:last-modified-datetime missing",
+                     __func__);
+          goto fail;
+        }
+
+      /* Skip the entry if the db already has this version of the CVE. */
+      id = xml_node_attribute (node, "id");
+      modified_text = xmlNodeGetContent (modified);
+      unchanged = id
+                  && g_hash_table_lookup_extended (hashed_cves, id, NULL,
+                                                   &db_time)
+                  && GPOINTER_TO_INT (db_time)
+                     >= parse_iso_time (modified_text
+                                         ? (gchar *) modified_text
+                                         : "");
+      xmlFree (modified_text);
+      g_free (id);
+
+      if (unchanged == 0)
+        {
+          /* Keep the XML of the entry for the detail view. */
+          raw_xml = xml_node_dump (node);
+          if (parse_element (raw_xml, &entry))
             {
-              g_warning ("%s: vuln:last-modified-datetime missing",
-                         __func__);
+              g_warning ("%s: Failed to parse entry", __func__);
+              g_free (raw_xml);
               goto fail;
             }
-          if (parse_iso_time_element_text (last_modified) > last_cve_update)
+
+          last_modified = element_child (entry,
+                                         "vuln:last-modified-datetime");
+          if (last_modified == NULL
+              || insert_cve_from_entry (entry, last_modified, raw_xml,
+                                        hashed_cpes, &transaction_size))
             {
-              if (insert_cve_from_entry (entry, last_modified, hashed_cpes,
-                                         &transaction_size))
-                goto fail;
-              updated_scap_bund = 1;
+              element_free (entry);
+              g_free (raw_xml);
+              goto fail;
             }
+          element_free (entry);
+          g_free (raw_xml);
+          updated_scap_bund = 1;
         }
-      entry = element_next (entry);
+
+      /* Skip to the next entry, letting the reader free this one. */
+      ret = xmlTextReaderNext (reader);
     }
 
-  element_free (element);
+  if (ret)
+    goto fail;
+
+  xmlFreeTextReader (reader);
   g_free (full_path);
   sql_commit ();
   return updated_scap_bund;
 
  fail:
-  element_free (element);
+  xmlFreeTextReader (reader);
   g_warning ("Update of CVEs failed at file '%s'",
              full_path);
   g_free (full_path);
@@ -3080,11 +3657,11 @@ static int
 update_scap_cves (int last_scap_update)
 {
   GError *error;
-  int count, last_cve_update, updated_scap_cves;
+  int count, updated_scap_cves;
   GDir *dir;
   const gchar *xml_path;
-  GHashTable *hashed_cpes;
-  iterator_t cpes;
+  GHashTable *hashed_cpes, *hashed_cves;
+  iterator_t cpes, cves;
 
   error = NULL;
   dir = g_dir_open (GVM_SCAP_DATA_DIR, 0, &error);
@@ -3096,8 +3673,17 @@ update_scap_cves (int last_scap_update)
       return -1;
     }
 
-  last_cve_update = sql_int ("SELECT max (modification_time)"
-                             " FROM scap.cves;");
+  /* CVEs without XML are left out, so that they are stored again even if
+   * they are unchanged, to fill in the XML. */
+  hashed_cves = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  init_iterator (&cves,
+                 "SELECT uuid, modification_time FROM scap.cves"
+                 " WHERE raw_xml IS NOT NULL;");
+  while (next (&cves))
+    g_hash_table_insert (hashed_cves,
+                         g_strdup (iterator_string (&cves, 0)),
+                         GINT_TO_POINTER (iterator_int (&cves, 1)));
+  cleanup_iterator (&cves);
 
   hashed_cpes = g_hash_table_new (g_str_hash, g_str_equal);
   init_iterator (&cpes, "SELECT uuid, id FROM scap.cpes;");
@@ -3111,7 +3697,7 @@ update_scap_cves (int last_scap_update)
   while ((xml_path = g_dir_read_name (dir)))
     if (fnmatch ("nvdcve-2.0-*.xml", xml_path, 0) == 0)
       {
-        switch (update_cve_xml (xml_path, last_scap_update, last_cve_update,
+        switch (update_cve_xml (xml_path, last_scap_update, hashed_cves,
                                 hashed_cpes))
           {
             case 0:
@@ -3121,6 +3707,7 @@ update_scap_cves (int last_scap_update)
               break;
             default:
               g_dir_close (dir);
+              g_hash_table_destroy (hashed_cves);
               g_hash_table_destroy (hashed_cpes);
               cleanup_iterator (&cpes);
               return -1;
@@ -3132,6 +3719,7 @@ update_scap_cves (int last_scap_update)
     g_warning ("No CVEs found in %s", GVM_SCAP_DATA_DIR);
 
   g_dir_close (dir);
+  g_hash_table_destroy (hashed_cves);
   g_hash_table_destroy (hashed_cpes);
   cleanup_iterator (&cpes);
   return updated_scap_cves;
@@ -4273,10 +4861,12 @@ manage_db_reinit (const gchar *name)
  * @param[in]  update             Function to do the sync.
  * @param[in]  process_title      Process title.
  * @param[in]  lockfile_basename  Basename for lockfile.
+ * @param[in]  feed               Feed, for the cluster lock.
  */
 static void
 sync_secinfo (sigset_t *sigmask_current, int (*update) (int),
-              const gchar *process_title, const gchar *lockfile_basename)
+              const gchar *process_title, const gchar *lockfile_basename,
+              cluster_feed_t feed)
 {
   int pid, lockfile;
   gchar *lockfile_name;
@@ -4330,6 +4920,15 @@ sync_secinfo (sigset_t *sigmask_current, int (*update) (int),
         reinit_manage_process ();
         manage_session_init (current_credentials.uuid);
 
+        /* In a cluster the other nodes share the SecInfo data too. */
+
+        if (cluster_feed_lock (feed))
+          {
+            g_debug ("%s: skipping, another node is syncing", __func__);
+            g_free (lockfile_name);
+            exit (EXIT_SUCCESS);
+          }
+
         break;
 
       case -1:
@@ -4344,6 +4943,7 @@ sync_secinfo (sigset_t *sigmask_current, int (*update) (int),
     }
 
   proctitle_set (process_title);
+  manage_process_register ("secinfo_sync", 0, 0);
 
   if (update (lockfile) == 0)
     {
@@ -4575,7 +5175,7 @@ static int
 sync_cert (int lockfile)
 {
   int last_feed_update, last_cert_update, last_scap_update, updated_dfn_cert;
-  int updated_cert_bund;
+  int updated_cert_bund, mark_dfn_cert, mark_cert_bund, generation;
 
   if (manage_cert_db_exists ())
     {
@@ -4638,6 +5238,9 @@ sync_cert (int lockfile)
   if (manage_update_cert_db_init ())
     goto fail;
 
+  mark_dfn_cert = secinfo_changes_mark ("dfn_cert_adv");
+  mark_cert_bund = secinfo_changes_mark ("cert_bund_adv");
+
   g_info ("%s: Updating data from feed", __func__);
 
   g_debug ("%s: update dfn", __func__);
@@ -4678,10 +5281,20 @@ sync_cert (int lockfile)
       goto fail;
     }
 
+  /* Log the changes for the SecInfo alerts. */
+  sql_begin_immediate ();
+  generation = secinfo_changes_generation ();
+  secinfo_changes_record ("dfn_cert_adv", mark_dfn_cert, generation);
+  secinfo_changes_record ("cert_bund_adv", mark_cert_bund, generation);
+  sql_commit ();
+
   g_info ("%s: Updating CERT info succeeded.", __func__);
 
   manage_update_cert_db_cleanup ();
 
+  aggregate_rollups_refresh ("cert_bund_adv");
+  aggregate_rollups_refresh ("dfn_cert_adv");
+
   /* Clear date from lock file. */
 
   if (ftruncate (lockfile, 0))
@@ -4713,7 +5326,8 @@ manage_sync_cert (sigset_t *sigmask_current)
   sync_secinfo (sigmask_current,
                 sync_cert,
                 "gvmd: Syncing CERT",
-                "gvm-sync-cert");
+                "gvm-sync-cert",
+                CLUSTER_FEED_CERT);
 }
 
 
@@ -4753,6 +5367,17 @@ check_scap_db_version ()
        sql ("UPDATE scap.meta"
             " SET value = '16'"
             " WHERE name = 'database_version';");
+       /* Fall through. */
+      case 16:
+       sql ("ALTER TABLE scap.cves ADD COLUMN IF NOT EXISTS raw_xml text;");
+       sql ("ALTER TABLE scap.cpes ADD COLUMN IF NOT EXISTS raw_xml text;");
+       /* Sync everything again, to fill in the XML. */
+       sql ("UPDATE scap.meta"
+            " SET value = '0'"
+            " WHERE name = 'last_update';");
+       sql ("UPDATE scap.meta"
+            " SET value = '17'"
+            " WHERE name = 'database_version';");
        break;
     }
   return 0;
@@ -4812,9 +5437,26 @@ update_scap_timestamp ()
   return 0;
 }
 
+/**
+ * @brief Create the tables that collect the CVEs and CPEs changed by a sync.
+ *
+ * The tables are temporary, so they go with the connection of the sync
+ * process.
+ */
+static void
+scap_changes_init ()
+{
+  sql ("CREATE TEMPORARY TABLE IF NOT EXISTS changed_cves (id integer);");
+  sql ("CREATE TEMPORARY TABLE IF NOT EXISTS changed_cpes (id integer);");
+  sql ("TRUNCATE changed_cves, changed_cpes;");
+}
+
 /**
  * @brief Update CERT-Bund Max CVSS.
  *
+ * Only recalculates the CPEs and OVAL definitions affected by the CVEs and
+ * CPEs that the sync changed.
+ *
  * @param[in]  updated_cves      Whether CVEs were updated.
  * @param[in]  updated_cpes      Whether CPEs were updated.
  * @param[in]  updated_ovaldefs  Whether OVAL defs were updated.
@@ -4826,7 +5468,7 @@ update_scap_cvss (int updated_cves, int updated_cpes, int updated_ovaldefs)
 
   if (updated_cves || updated_cpes)
     {
-      g_info ("Updating CVSS scores and CVE counts for CPEs");
+      g_info ("Updating CVSS scores and CVE counts for changed CPEs");
       sql_recursive_triggers_off ();
       sql ("UPDATE scap.cpes"
            " SET (max_cvss, cve_refs)"
@@ -4835,13 +5477,18 @@ update_scap_cvss (int updated_cves, int updated_cpes, int updated_ovaldefs)
            "            WHERE cpe=cpes.id)"
            "        SELECT (SELECT max (cvss) FROM scap.cves"
            "                WHERE id IN (SELECT cve FROM affected_cves)),"
-           "               (SELECT count (*) FROM affected_cves));");
+           "               (SELECT count (*) FROM affected_cves))"
+           " WHERE id IN (SELECT id FROM changed_cpes"
+           "              UNION"
+           "              SELECT cpe FROM scap.affected_products"
+           "              WHERE cve IN (SELECT id FROM changed_cves));");
     }
   else
     g_info ("No CPEs or CVEs updated, skipping CVSS and CVE recount for CPEs.");
 
-  if (updated_cves || updated_ovaldefs)
+  if (updated_ovaldefs)
     {
+      /* The OVAL update may have changed any definition's CVEs. */
       g_info ("Updating CVSS scores for OVAL definitions");
       sql_recursive_triggers_off ();
       sql ("UPDATE scap.ovaldefs"
@@ -4852,6 +5499,20 @@ update_scap_cvss (int updated_cves, int updated_cpes, int updated_ovaldefs)
            "                              WHERE ovaldef=ovaldefs.id)"
            "                 AND cvss != 0.0);");
     }
+  else if (updated_cves)
+    {
+      g_info ("Updating CVSS scores for OVAL definitions of changed CVEs");
+      sql_recursive_triggers_off ();
+      sql ("UPDATE scap.ovaldefs"
+           " SET max_cvss = (SELECT max (cvss)"
+           "                 FROM scap.cves"
+           "                 WHERE id IN (SELECT cve"
+           "                              FROM scap.affected_ovaldefs"
+           "                              WHERE ovaldef=ovaldefs.id)"
+           "                 AND cvss != 0.0)"
+           " WHERE id IN (SELECT ovaldef FROM scap.affected_ovaldefs"
+           "              WHERE cve IN (SELECT id FROM changed_cves));");
+    }
   else
     g_info ("No OVAL definitions or CVEs updated,"
             " skipping CVSS recount for OVAL definitions.");
@@ -4869,7 +5530,7 @@ update_scap_placeholders (int updated_cves)
 
   if (updated_cves)
     {
-      g_info ("Updating placeholder CPEs");
+      g_info ("Updating placeholder CPEs of changed CVEs");
       sql ("UPDATE scap.cpes"
            " SET creation_time = (SELECT min (creation_time)"
            "                      FROM scap.cves"
@@ -4881,7 +5542,9 @@ update_scap_placeholders (int updated_cves)
            "                          WHERE id IN (SELECT cve"
            "                                       FROM scap.affected_products"
            "                                       WHERE cpe=cpes.id))"
-           " WHERE cpes.title IS NULL;");
+           " WHERE cpes.title IS NULL"
+           " AND id IN (SELECT cpe FROM scap.affected_products"
+           "            WHERE cve IN (SELECT id FROM changed_cves));");
     }
   else
     g_info ("No CVEs updated, skipping placeholder CPE update.");
@@ -4899,6 +5562,8 @@ sync_scap (int lockfile)
 {
   int last_feed_update, last_scap_update;
   int updated_scap_ovaldefs, updated_scap_cpes, updated_scap_cves;
+  int mark_cpes, mark_cves, mark_ovaldefs, generation;
+  gint64 start;
 
   if (manage_scap_db_exists ())
     {
@@ -4962,11 +5627,18 @@ sync_scap (int lockfile)
   if (manage_update_scap_db_init ())
      goto fail;
 
+  scap_changes_init ();
+
+  mark_cpes = secinfo_changes_mark ("cpe");
+  mark_cves = secinfo_changes_mark ("cve");
+  mark_ovaldefs = secinfo_changes_mark ("ovaldef");
+
   g_info ("%s: Updating data from feed", __func__);
 
   g_debug ("%s: update cpes", __func__);
   proctitle_set ("gvmd: Syncing SCAP: Updating CPEs");
 
+  start = g_get_monotonic_time ();
   updated_scap_cpes = update_scap_cpes (last_scap_update);
   if (updated_scap_cpes == -1)
     {
@@ -4974,9 +5646,14 @@ sync_scap (int lockfile)
       goto fail;
     }
 
+  g_info ("%s: Updated CPEs in %.1f s",
+          __func__,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
   g_debug ("%s: update cves", __func__);
   proctitle_set ("gvmd: Syncing SCAP: Updating CVEs");
 
+  start = g_get_monotonic_time ();
   updated_scap_cves = update_scap_cves (last_scap_update);
   if (updated_scap_cves == -1)
     {
@@ -4984,9 +5661,14 @@ sync_scap (int lockfile)
       goto fail;
     }
 
+  g_info ("%s: Updated CVEs in %.1f s",
+          __func__,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
   g_debug ("%s: update ovaldefs", __func__);
   proctitle_set ("gvmd: Syncing SCAP: Updating OVALdefs");
 
+  start = g_get_monotonic_time ();
   updated_scap_ovaldefs = update_scap_ovaldefs (last_scap_update,
                                                 0 /* Feed data. */);
   if (updated_scap_ovaldefs == -1)
@@ -4995,6 +5677,10 @@ sync_scap (int lockfile)
       goto fail;
     }
 
+  g_info ("%s: Updated OVAL definitions in %.1f s",
+          __func__,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
   g_debug ("%s: updating user defined data", __func__);
   proctitle_set ("gvmd: Syncing SCAP: Updating private OVALdefs");
 
@@ -5014,14 +5700,24 @@ sync_scap (int lockfile)
   g_debug ("%s: update max cvss", __func__);
   proctitle_set ("gvmd: Syncing SCAP: Updating max CVSS");
 
+  start = g_get_monotonic_time ();
   update_scap_cvss (updated_scap_cves, updated_scap_cpes,
                     updated_scap_ovaldefs);
 
+  g_info ("%s: Updated max CVSS in %.1f s",
+          __func__,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
   g_debug ("%s: update placeholders", __func__);
   proctitle_set ("gvmd: Syncing SCAP: Updating placeholders");
 
+  start = g_get_monotonic_time ();
   update_scap_placeholders (updated_scap_cves);
 
+  g_info ("%s: Updated placeholders in %.1f s",
+          __func__,
+          (g_get_monotonic_time () - start) / 1000000.0);
+
   g_debug ("%s: update timestamp", __func__);
 
   if (update_scap_timestamp ())
@@ -5030,11 +5726,28 @@ sync_scap (int lockfile)
       goto fail;
     }
 
+  g_info ("%s: Updated %i CVEs and %i CPEs",
+          __func__,
+          sql_int ("SELECT count (DISTINCT id) FROM changed_cves;"),
+          sql_int ("SELECT count (DISTINCT id) FROM changed_cpes;"));
+
+  /* Log the changes for the SecInfo alerts. */
+  sql_begin_immediate ();
+  generation = secinfo_changes_generation ();
+  secinfo_changes_record ("cpe", mark_cpes, generation);
+  secinfo_changes_record ("cve", mark_cves, generation);
+  secinfo_changes_record ("ovaldef", mark_ovaldefs, generation);
+  sql_commit ();
+
   g_info ("%s: Updating SCAP info succeeded", __func__);
   proctitle_set ("gvmd: Syncing SCAP: done");
 
   manage_update_scap_db_cleanup ();
 
+  aggregate_rollups_refresh ("cve");
+  aggregate_rollups_refresh ("cpe");
+  aggregate_rollups_refresh ("ovaldef");
+
   /* Clear date from lock file. */
 
   if (ftruncate (lockfile, 0))
@@ -5066,7 +5779,23 @@ manage_sync_scap (sigset_t *sigmask_current)
   sync_secinfo (sigmask_current,
                 sync_scap,
                 "gvmd: Syncing SCAP",
-                "gvm-sync-scap");
+                "gvm-sync-scap",
+                CLUSTER_FEED_SCAP);
+}
+
+/**
+ * @brief Set the number of SecInfo sync workers.
+ *
+ * @param new_workers  The new number of workers, 0 to load in the sync
+ *                     process.
+ */
+void
+set_secinfo_sync_workers (int new_workers)
+{
+  if (new_workers < 0)
+    secinfo_sync_workers = 0;
+  else
+    secinfo_sync_workers = new_workers;
 }
 
 /**
@@ -208,6 +208,11 @@
  */
 #define SECINFO_COMMIT_SIZE_DEFAULT 0
 
+/**
+ * @brief Default for secinfo_sync_workers.
+ */
+#define SECINFO_SYNC_WORKERS_DEFAULT 0
+
 void
 manage_sync_scap (sigset_t *);
 
@@ -226,4 +231,7 @@ get_secinfo_commit_size ();
 void
 set_secinfo_commit_size (int);
 
+void
+set_secinfo_sync_workers (int);
+
 #endif /* not _GVMD_MANAGE_SQL_SECINFO_H */
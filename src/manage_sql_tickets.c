@@ -1467,6 +1467,9 @@ empty_trashcan_tickets ()
 /**
  * @brief Check if tickets have been resolved.
  *
+ * All open and fixed tickets of the task are reconciled against the last
+ * report in a single statement, matching each ticket on its host and NVT.
+ *
  * @param[in]  task  Task.
  */
 void
@@ -1485,41 +1488,36 @@ check_tickets (task_t task)
     }
 
   init_iterator (&tickets,
-                 "SELECT id FROM tickets"
-                 " WHERE task = %llu"
-                 " AND (status = %i"
-                 "      OR status = %i)"
+                 "UPDATE tickets"
+                 " SET status = %i,"
+                 "     fix_verified_time = m_now (),"
+                 "     fix_verified_report = %llu"
+                 " FROM report_hosts"
+                 " WHERE tickets.task = %llu"
+                 " AND (tickets.status = %i"
+                 "      OR tickets.status = %i)"
                  /* Only if the same host was scanned. */
-                 " AND EXISTS (SELECT * FROM report_hosts"
-                 "             WHERE report = %llu"
-                 "             AND report_hosts.host = tickets.host)"
-                 /* Only if the problem result is gone. */
+                 " AND report_hosts.report = %llu"
+                 " AND report_hosts.host = tickets.host"
+                 /* Only if the problem result is gone from the host. */
                  " AND NOT EXISTS (SELECT * FROM results"
-                 "                 WHERE report = %llu"
-                 "                 AND nvt = (SELECT nvt FROM results"
-                 "                            WHERE id = (SELECT result"
-                 "                                        FROM ticket_results"
-                 "                                        WHERE ticket = tickets.id"
-                 "                                        AND result_location = %i"
-                 "                                        LIMIT 1)))"
+                 "                 WHERE results.report = %llu"
+                 "                 AND results.host = tickets.host"
+                 "                 AND results.nvt = tickets.nvt)"
                  /* Only if there were no login failures on the host. */
                  " AND NOT EXISTS (SELECT * FROM report_host_details"
-                 "                 WHERE report_host = (SELECT id"
-                 "                                      FROM report_hosts"
-                 "                                      WHERE report = %llu"
-                 "                                      AND report_hosts.host"
-                 "                                          = tickets.host"
-                 "                                      LIMIT 1)"
+                 "                 WHERE report_host = report_hosts.id"
                  "                 AND (name = 'Auth-SSH-Failure'"
                  "                      OR name = 'Auth-SMB-Failure'"
                  "                      OR name = 'Auth-SNMP-Failure'"
-                 "                      OR name = 'Auth-ESXi-Failure'));",
+                 "                      OR name = 'Auth-ESXi-Failure'))"
+                 " RETURNING tickets.id;",
+                 TICKET_STATUS_FIX_VERIFIED,
+                 report,
                  task,
                  TICKET_STATUS_OPEN,
                  TICKET_STATUS_FIXED,
                  report,
-                 report,
-                 LOCATION_TABLE,
                  report);
   while (next (&tickets))
     {
@@ -1527,15 +1525,6 @@ check_tickets (task_t task)
 
       ticket = iterator_int64 (&tickets, 0);
 
-      sql ("UPDATE tickets"
-           " SET status = %i,"
-           "     fix_verified_time = m_now (),"
-           "     fix_verified_report = %llu"
-           " WHERE id = %llu;",
-           TICKET_STATUS_FIX_VERIFIED,
-           report,
-           ticket);
-
       event (EVENT_OWNED_TICKET_CHANGED, NULL, ticket, 0);
       event (EVENT_ASSIGNED_TICKET_CHANGED, NULL, ticket, 0);
     }
@@ -1468,9 +1468,497 @@ user_has_tls_certificate (tls_certificate_t tls_certificate,
   return 0;
 }
 
+/**
+ * @brief A TLS certificate collected from the details of a report host.
+ */
+typedef struct
+{
+  gchar *certificate_b64;            ///< Base64 encoded certificate.
+  gchar *scanner_fpr;                ///< Fingerprint given by the scanner.
+  gchar *source_name;                ///< Source name of the detail.
+  time_t activation_time;            ///< Activation time.
+  time_t expiration_time;            ///< Expiration time.
+  gchar *md5_fingerprint;            ///< MD5 fingerprint.
+  gchar *sha256_fingerprint;         ///< SHA-256 fingerprint.
+  gchar *subject;                    ///< Subject DN.
+  gchar *issuer;                     ///< Issuer DN.
+  gchar *serial;                     ///< Serial.
+  gnutls_x509_crt_fmt_t certificate_format;  ///< Certificate format.
+  tls_certificate_t tls_certificate; ///< Certificate row, 0 if unknown.
+} host_tls_certificate_t;
+
+/**
+ * @brief Free a host TLS certificate.
+ *
+ * @param[in]  data  Host TLS certificate.
+ */
+static void
+host_tls_certificate_free (gpointer data)
+{
+  host_tls_certificate_t *certificate;
+
+  certificate = data;
+  g_free (certificate->certificate_b64);
+  g_free (certificate->scanner_fpr);
+  g_free (certificate->source_name);
+  g_free (certificate->md5_fingerprint);
+  g_free (certificate->sha256_fingerprint);
+  g_free (certificate->subject);
+  g_free (certificate->issuer);
+  g_free (certificate->serial);
+  g_free (certificate);
+}
+
+/**
+ * @brief Get the port from an SSLInfo detail about a certificate.
+ *
+ * Matches like "value LIKE '%:%:<fingerprint>'".
+ *
+ * @param[in]  value        Value of SSLInfo detail.
+ * @param[in]  scanner_fpr  Fingerprint given by the scanner.
+ *
+ * @return Freshly allocated port if the detail is about the certificate,
+ *         else NULL.
+ */
+static gchar *
+ssl_info_port (const char *value, const char *scanner_fpr)
+{
+  gsize value_len, fpr_len;
+
+  value_len = strlen (value);
+  fpr_len = strlen (scanner_fpr);
+  if (value_len < fpr_len + 2
+      || strcmp (value + value_len - fpr_len, scanner_fpr)
+      || value[value_len - fpr_len - 1] != ':'
+      || memchr (value, ':', value_len - fpr_len - 1) == NULL)
+    return NULL;
+
+  return g_strndup (value, g_strrstr (value, ":") - value - 1);
+}
+
+/**
+ * @brief Look up the certificates of a host that the owner already has.
+ *
+ * Resolves all certificates with a single query.  Sets tls_certificate
+ * of each known certificate.
+ *
+ * @param[in]  certificates  Host TLS certificates.
+ * @param[in]  owner         Owner of the certificates.
+ */
+static void
+host_tls_certificates_resolve (GPtrArray *certificates, user_t owner)
+{
+  GString *sha256_fingerprints, *md5_fingerprints;
+  GHashTable *by_sha256, *by_md5;
+  iterator_t known;
+  guint index;
+
+  sha256_fingerprints = g_string_new ("");
+  md5_fingerprints = g_string_new ("");
+  for (index = 0; index < certificates->len; index++)
+    {
+      host_tls_certificate_t *certificate;
+      gchar *quoted;
+
+      certificate = g_ptr_array_index (certificates, index);
+
+      quoted = sql_quote (certificate->sha256_fingerprint);
+      g_string_append_printf (sha256_fingerprints, "%s'%s'",
+                              sha256_fingerprints->len ? ", " : "",
+                              quoted);
+      g_free (quoted);
+
+      if (certificate->md5_fingerprint
+          && strcmp (certificate->md5_fingerprint, ""))
+        {
+          quoted = sql_quote (certificate->md5_fingerprint);
+          g_string_append_printf (md5_fingerprints, "%s'%s'",
+                                  md5_fingerprints->len ? ", " : "",
+                                  quoted);
+          g_free (quoted);
+        }
+    }
+
+  by_sha256 = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  by_md5 = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  init_iterator (&known,
+                 "SELECT id, sha256_fingerprint, md5_fingerprint"
+                 " FROM tls_certificates"
+                 " WHERE owner = %llu"
+                 "   AND (sha256_fingerprint IN (%s)"
+                 "        %s%s%s);",
+                 owner,
+                 sha256_fingerprints->str,
+                 md5_fingerprints->len ? "OR md5_fingerprint IN (" : "",
+                 md5_fingerprints->str,
+                 md5_fingerprints->len ? ")" : "");
+  while (next (&known))
+    {
+      tls_certificate_t tls_certificate;
+      const char *sha256_fingerprint, *md5_fingerprint;
+
+      tls_certificate = iterator_int64 (&known, 0);
+      sha256_fingerprint = iterator_string (&known, 1);
+      md5_fingerprint = iterator_string (&known, 2);
+
+      if (sha256_fingerprint
+          && g_hash_table_lookup (by_sha256, sha256_fingerprint) == NULL)
+        g_hash_table_insert (by_sha256,
+                             g_strdup (sha256_fingerprint),
+                             GSIZE_TO_POINTER (tls_certificate));
+      if (md5_fingerprint
+          && g_hash_table_lookup (by_md5, md5_fingerprint) == NULL)
+        g_hash_table_insert (by_md5,
+                             g_strdup (md5_fingerprint),
+                             GSIZE_TO_POINTER (tls_certificate));
+    }
+  cleanup_iterator (&known);
+
+  for (index = 0; index < certificates->len; index++)
+    {
+      host_tls_certificate_t *certificate;
+
+      certificate = g_ptr_array_index (certificates, index);
+      certificate->tls_certificate
+        = GPOINTER_TO_SIZE (g_hash_table_lookup
+                             (by_sha256, certificate->sha256_fingerprint));
+      if (certificate->tls_certificate == 0
+          && certificate->md5_fingerprint
+          && strcmp (certificate->md5_fingerprint, ""))
+        certificate->tls_certificate
+          = GPOINTER_TO_SIZE (g_hash_table_lookup
+                               (by_md5, certificate->md5_fingerprint));
+    }
+
+  g_hash_table_destroy (by_sha256);
+  g_hash_table_destroy (by_md5);
+  g_string_free (sha256_fingerprints, TRUE);
+  g_string_free (md5_fingerprints, TRUE);
+}
+
+/**
+ * @brief Append the quoted columns of a host TLS certificate to a VALUES row.
+ *
+ * @param[in]  row          Row to append to.
+ * @param[in]  certificate  Host TLS certificate.
+ */
+static void
+host_tls_certificate_append_values (GString *row,
+                                    host_tls_certificate_t *certificate)
+{
+  gchar *quoted_certificate_b64, *quoted_md5_fingerprint;
+  gchar *quoted_sha256_fingerprint, *quoted_subject_dn, *quoted_issuer_dn;
+  gchar *quoted_serial;
+
+  quoted_certificate_b64
+    = sql_quote (certificate->certificate_b64);
+  quoted_md5_fingerprint
+    = sql_quote (certificate->md5_fingerprint
+                  ? certificate->md5_fingerprint : "");
+  quoted_sha256_fingerprint
+    = sql_quote (certificate->sha256_fingerprint);
+  quoted_subject_dn
+    = sql_quote (certificate->subject ? certificate->subject : "");
+  quoted_issuer_dn
+    = sql_quote (certificate->issuer ? certificate->issuer : "");
+  quoted_serial
+    = sql_quote (certificate->serial ? certificate->serial : "");
+
+  g_string_append_printf (row,
+                          "'%s', %ld, %ld, '%s', '%s', '%s', '%s', '%s', '%s'",
+                          quoted_certificate_b64,
+                          certificate->activation_time,
+                          certificate->expiration_time,
+                          quoted_md5_fingerprint,
+                          quoted_sha256_fingerprint,
+                          quoted_subject_dn,
+                          quoted_issuer_dn,
+                          quoted_serial,
+                          tls_certificate_format_str
+                           (certificate->certificate_format));
+
+  g_free (quoted_certificate_b64);
+  g_free (quoted_md5_fingerprint);
+  g_free (quoted_sha256_fingerprint);
+  g_free (quoted_subject_dn);
+  g_free (quoted_issuer_dn);
+  g_free (quoted_serial);
+}
+
+/**
+ * @brief Update missing columns of the known certificates of a host.
+ *
+ * Does the same as make_tls_certificate with update 1, for all
+ * certificates in a single statement.
+ *
+ * @param[in]  certificates  Host TLS certificates.
+ */
+static void
+host_tls_certificates_update (GPtrArray *certificates)
+{
+  GString *values;
+  GHashTable *updated;
+  guint index;
+
+  values = g_string_new ("");
+  updated = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (index = 0; index < certificates->len; index++)
+    {
+      host_tls_certificate_t *certificate;
+      gpointer key;
+
+      certificate = g_ptr_array_index (certificates, index);
+      key = GSIZE_TO_POINTER (certificate->tls_certificate);
+      if (certificate->tls_certificate == 0
+          || g_hash_table_contains (updated, key))
+        continue;
+      g_hash_table_add (updated, key);
+
+      g_string_append_printf (values, "%s(%llu, ",
+                              values->len ? ", " : "",
+                              certificate->tls_certificate);
+      host_tls_certificate_append_values (values, certificate);
+      g_string_append (values, ")");
+    }
+
+  if (values->len)
+    sql ("UPDATE tls_certificates SET"
+         " certificate"
+         "   = coalesce (nullif (certificate, ''), batch.certificate),"
+         " activation_time"
+         "   = coalesce (nullif (activation_time, -1), batch.activation_time),"
+         " expiration_time"
+         "   = coalesce (nullif (expiration_time, -1), batch.expiration_time),"
+         " md5_fingerprint"
+         "   = coalesce (nullif (md5_fingerprint, ''), batch.md5_fingerprint),"
+         " sha256_fingerprint"
+         "   = coalesce (nullif (sha256_fingerprint, ''),"
+         "               batch.sha256_fingerprint),"
+         " subject_dn"
+         "   = coalesce (nullif (subject_dn, ''), batch.subject_dn),"
+         " issuer_dn"
+         "   = coalesce (nullif (issuer_dn, ''), batch.issuer_dn),"
+         " serial"
+         "   = coalesce (nullif (serial, ''), batch.serial),"
+         " certificate_format"
+         "   = (CASE"
+         "      WHEN (tls_certificates.certificate IS NULL)"
+         "           OR (tls_certificates.certificate = '')"
+         "      THEN batch.certificate_format"
+         "      ELSE tls_certificates.certificate_format"
+         "      END),"
+         " modification_time = m_now ()"
+         " FROM (VALUES %s)"
+         "      AS batch (id, certificate, activation_time, expiration_time,"
+         "                md5_fingerprint, sha256_fingerprint, subject_dn,"
+         "                issuer_dn, serial, certificate_format)"
+         " WHERE tls_certificates.id = batch.id;",
+         values->str);
+
+  g_hash_table_destroy (updated);
+  g_string_free (values, TRUE);
+}
+
+/**
+ * @brief Create the certificates of a host that the owner does not have yet.
+ *
+ * Inserts all new certificates in a single statement.  Sets
+ * tls_certificate of each new certificate.
+ *
+ * @param[in]  certificates  Host TLS certificates.
+ * @param[in]  owner         Owner of the certificates.
+ */
+static void
+host_tls_certificates_insert (GPtrArray *certificates, user_t owner)
+{
+  GString *values;
+  GHashTable *inserted;
+  iterator_t rows;
+  guint index;
+
+  values = g_string_new ("");
+  inserted = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (index = 0; index < certificates->len; index++)
+    {
+      host_tls_certificate_t *certificate;
+      gchar *quoted_name;
+
+      certificate = g_ptr_array_index (certificates, index);
+      if (certificate->tls_certificate
+          || g_hash_table_contains (inserted,
+                                    certificate->sha256_fingerprint))
+        continue;
+      g_hash_table_insert (inserted,
+                           g_strdup (certificate->sha256_fingerprint),
+                           NULL);
+
+      quoted_name = sql_quote (certificate->sha256_fingerprint);
+      g_string_append_printf (values,
+                              "%s(make_uuid (), %llu, '%s', '',"
+                              "   m_now (), m_now (), 0, ",
+                              values->len ? ", " : "",
+                              owner,
+                              quoted_name);
+      g_free (quoted_name);
+      host_tls_certificate_append_values (values, certificate);
+      g_string_append (values, ")");
+    }
+
+  if (values->len == 0)
+    {
+      g_hash_table_destroy (inserted);
+      g_string_free (values, TRUE);
+      return;
+    }
+
+  init_iterator (&rows,
+                 "INSERT INTO tls_certificates"
+                 " (uuid, owner, name, comment,"
+                 "  creation_time, modification_time, trust,"
+                 "  certificate, activation_time, expiration_time,"
+                 "  md5_fingerprint, sha256_fingerprint, subject_dn,"
+                 "  issuer_dn, serial, certificate_format)"
+                 " VALUES %s"
+                 " RETURNING id, sha256_fingerprint;",
+                 values->str);
+  while (next (&rows))
+    g_hash_table_replace (inserted,
+                          g_strdup (iterator_string (&rows, 1)),
+                          GSIZE_TO_POINTER (iterator_int64 (&rows, 0)));
+  cleanup_iterator (&rows);
+
+  for (index = 0; index < certificates->len; index++)
+    {
+      host_tls_certificate_t *certificate;
+
+      certificate = g_ptr_array_index (certificates, index);
+      if (certificate->tls_certificate == 0)
+        certificate->tls_certificate
+          = GPOINTER_TO_SIZE (g_hash_table_lookup
+                               (inserted, certificate->sha256_fingerprint));
+    }
+
+  g_hash_table_destroy (inserted);
+  g_string_free (values, TRUE);
+}
+
+/**
+ * @brief Add the sources of the certificates of a host.
+ *
+ * Creates each location and origin once, then inserts all missing sources
+ * in a single statement.
+ *
+ * @param[in]  certificates  Host TLS certificates.
+ * @param[in]  ssl_infos     Values of the SSLInfo details of the host.
+ * @param[in]  host_ip       The IP address of the report host.
+ * @param[in]  report_id     UUID of the report.
+ */
+static void
+host_tls_certificates_add_sources (GPtrArray *certificates,
+                                   GPtrArray *ssl_infos,
+                                   const char *host_ip,
+                                   const char *report_id)
+{
+  GHashTable *locations, *origins, *sources;
+  GString *values;
+  guint index;
+
+  locations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  origins = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  sources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  values = g_string_new ("");
+
+  for (index = 0; index < certificates->len; index++)
+    {
+      host_tls_certificate_t *certificate;
+      resource_t origin;
+      gboolean has_ports;
+      guint info;
+
+      certificate = g_ptr_array_index (certificates, index);
+      if (certificate->tls_certificate == 0)
+        continue;
+
+      origin = GPOINTER_TO_SIZE (g_hash_table_lookup
+                                  (origins, certificate->source_name));
+      if (origin == 0)
+        {
+          origin = get_or_make_tls_certificate_origin
+                    ("Report", report_id, certificate->source_name);
+          g_hash_table_insert (origins,
+                               g_strdup (certificate->source_name),
+                               GSIZE_TO_POINTER (origin));
+        }
+
+      has_ports = FALSE;
+      for (info = 0; info < ssl_infos->len; info++)
+        {
+          gchar *port, *source;
+          resource_t location;
+
+          port = ssl_info_port (g_ptr_array_index (ssl_infos, info),
+                                certificate->scanner_fpr);
+          if (port == NULL)
+            continue;
+
+          has_ports = TRUE;
+
+          location = GPOINTER_TO_SIZE (g_hash_table_lookup (locations, port));
+          if (location == 0)
+            {
+              location = get_or_make_tls_certificate_location (host_ip, port);
+              g_hash_table_insert (locations,
+                                   g_strdup (port),
+                                   GSIZE_TO_POINTER (location));
+            }
+          g_free (port);
+
+          source = g_strdup_printf ("(%llu, %llu, %llu)",
+                                    certificate->tls_certificate,
+                                    location,
+                                    origin);
+          if (g_hash_table_contains (sources, source))
+            {
+              g_free (source);
+              continue;
+            }
+          g_string_append_printf (values, "%s%s",
+                                  values->len ? ", " : "",
+                                  source);
+          g_hash_table_add (sources, source);
+        }
+
+      if (has_ports == FALSE)
+        g_warning ("Certificate without ports: %s report:%s host:%s",
+                   certificate->scanner_fpr, report_id, host_ip);
+    }
+
+  if (values->len)
+    sql ("INSERT INTO tls_certificate_sources"
+         " (uuid, tls_certificate, location, origin, timestamp)"
+         " SELECT make_uuid (), batch.tls_certificate, batch.location,"
+         "        batch.origin, m_now ()"
+         " FROM (VALUES %s) AS batch (tls_certificate, location, origin)"
+         " WHERE NOT EXISTS (SELECT * FROM tls_certificate_sources"
+         "                   WHERE tls_certificate = batch.tls_certificate"
+         "                     AND location = batch.location"
+         "                     AND origin = batch.origin);",
+         values->str);
+
+  g_string_free (values, TRUE);
+  g_hash_table_destroy (sources);
+  g_hash_table_destroy (origins);
+  g_hash_table_destroy (locations);
+}
+
 /**
  * @brief Collects and add TLS certificates from the details of a report host.
  *
+ * Reads all the details it needs in one query, resolves the certificates
+ * the user already has in one query, and then updates, creates and adds
+ * sources to all certificates in bulk.
+ *
  * @param[in] report_host  The report host to get certificates from.
  * @param[in] report_id    UUID of the report
  * @param[in] host_ip      The IP address of the report host.
@@ -1482,10 +1970,11 @@ add_tls_certificates_from_report_host (report_host_t report_host,
                                        const char *report_id,
                                        const char *host_ip)
 {
-  iterator_t tls_certs;
-  time_t activation_time, expiration_time;
-  gchar *md5_fingerprint, *sha256_fingerprint, *subject, *issuer, *serial;
-  gnutls_x509_crt_fmt_t certificate_format;
+  iterator_t details;
+  GPtrArray *certificates, *ssl_infos;
+  GHashTable *ssl_details;
+  user_t owner;
+  guint index;
 
   /* host_ip and report_id are expected to avoid possibly redundant
    *  SQL queries to get them */
@@ -1496,184 +1985,134 @@ add_tls_certificates_from_report_host (report_host_t report_host,
       || strcmp (report_id, "") == 0)
     return -1;
 
-  init_iterator (&tls_certs,
-                 "SELECT rhd.value, rhd.name, rhd.source_name"
+  certificates = g_ptr_array_new_with_free_func (host_tls_certificate_free);
+  ssl_infos = g_ptr_array_new_with_free_func (g_free);
+  ssl_details = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       g_free, g_free);
+
+  init_iterator (&details,
+                 "SELECT rhd.value, rhd.name, rhd.source_name,"
+                 "       rhd.source_description"
                  " FROM report_host_details AS rhd"
                  " WHERE rhd.report_host = %llu"
                  "   AND (source_description = 'SSL/TLS Certificate'"
-                 "        OR source_description = 'SSL Certificate')",
+                 "        OR source_description = 'SSL Certificate'"
+                 "        OR name = 'SSLInfo'"
+                 "        OR name LIKE 'SSLDetails:%%')",
                  report_host);
+  while (next (&details))
+    {
+      const char *value, *name, *source_name, *source_description;
+
+      value = iterator_string (&details, 0);
+      name = iterator_string (&details, 1);
+      source_name = iterator_string (&details, 2);
+      source_description = iterator_string (&details, 3);
+      if (value == NULL || name == NULL)
+        continue;
+
+      if (source_description
+          && (strcmp (source_description, "SSL/TLS Certificate") == 0
+              || strcmp (source_description, "SSL Certificate") == 0))
+        {
+          host_tls_certificate_t *certificate;
+          const char *colon;
+
+          certificate = g_malloc0 (sizeof (*certificate));
+          colon = strrchr (value, ':');
+          certificate->certificate_b64 = g_strdup (colon ? colon + 1 : value);
+          colon = strrchr (name, ':');
+          certificate->scanner_fpr = g_strdup (colon ? colon + 1 : name);
+          certificate->source_name = g_strdup (source_name
+                                                ? source_name : "");
+          g_ptr_array_add (certificates, certificate);
+        }
+      else if (strcmp (name, "SSLInfo") == 0)
+        g_ptr_array_add (ssl_infos, g_strdup (value));
+      else if (g_str_has_prefix (name, "SSLDetails:")
+               && g_hash_table_contains (ssl_details,
+                                         name + strlen ("SSLDetails:"))
+                  == FALSE)
+        g_hash_table_insert (ssl_details,
+                             g_strdup (name + strlen ("SSLDetails:")),
+                             g_strdup (value));
+    }
+  cleanup_iterator (&details);
 
-  while (next (&tls_certs))
+  index = 0;
+  while (index < certificates->len)
     {
-      const char *certificate_prefixed, *certificate_b64;
+      host_tls_certificate_t *certificate;
       gsize certificate_size;
-      unsigned char *certificate;
-      const char *scanner_fpr_prefixed, *scanner_fpr;
-      gchar *quoted_scanner_fpr;
-      const char *source_name;
-      char *ssldetails;
-      tls_certificate_t tls_certificate;
+      unsigned char *certificate_der;
+      const char *ssldetails;
 
-      iterator_t ports;
-      gboolean has_ports;
+      certificate = g_ptr_array_index (certificates, index);
 
-      certificate_prefixed = iterator_string (&tls_certs, 0);
-      certificate_b64 = g_strrstr (certificate_prefixed, ":") + 1;
-
-      certificate = g_base64_decode (certificate_b64, &certificate_size);
-
-      scanner_fpr_prefixed = iterator_string (&tls_certs, 1);
-      scanner_fpr = g_strrstr (scanner_fpr_prefixed, ":") + 1;
-
-      quoted_scanner_fpr = sql_quote (scanner_fpr);
+      g_debug ("%s: Handling certificate %s on %s in report %s",
+               __func__, certificate->scanner_fpr, host_ip, report_id);
 
-      source_name = iterator_string (&tls_certs, 2);
+      certificate_der = g_base64_decode (certificate->certificate_b64,
+                                         &certificate_size);
 
-      g_debug ("%s: Handling certificate %s on %s in report %s",
-               __func__, scanner_fpr, host_ip, report_id);
-
-      tls_certificate = 0;
-      activation_time = -1;
-      expiration_time = -1;
-      md5_fingerprint = NULL;
-      sha256_fingerprint = NULL;
-      subject = NULL;
-      issuer = NULL;
-      serial = NULL;
-      certificate_format = 0;
-
-      get_certificate_info ((gchar*)certificate,
+      get_certificate_info ((gchar*)certificate_der,
                             certificate_size,
-                            &activation_time,
-                            &expiration_time,
-                            &md5_fingerprint,
-                            &sha256_fingerprint,
-                            &subject,
-                            &issuer,
-                            &serial,
-                            &certificate_format);
-
-      if (sha256_fingerprint == NULL)
-        sha256_fingerprint = g_strdup (scanner_fpr);
-
-      ssldetails
-        = sql_string ("SELECT rhd.value"
-                      " FROM report_host_details AS rhd"
-                      " WHERE report_host = %llu"
-                      "   AND name = 'SSLDetails:%s'"
-                      " LIMIT 1;",
-                      report_host,
-                      quoted_scanner_fpr);
-
+                            &certificate->activation_time,
+                            &certificate->expiration_time,
+                            &certificate->md5_fingerprint,
+                            &certificate->sha256_fingerprint,
+                            &certificate->subject,
+                            &certificate->issuer,
+                            &certificate->serial,
+                            &certificate->certificate_format);
+      g_free (certificate_der);
+
+      if (certificate->sha256_fingerprint == NULL)
+        certificate->sha256_fingerprint
+          = g_strdup (certificate->scanner_fpr);
+
+      ssldetails = g_hash_table_lookup (ssl_details,
+                                        certificate->scanner_fpr);
       if (ssldetails)
         parse_ssldetails (ssldetails,
-                          &activation_time,
-                          &expiration_time,
-                          &issuer,
-                          &serial);
+                          &certificate->activation_time,
+                          &certificate->expiration_time,
+                          &certificate->issuer,
+                          &certificate->serial);
       else
         g_warning ("%s: No SSLDetails found for fingerprint %s",
                    __func__,
-                   scanner_fpr);
-
-      free (ssldetails);
-
-      if (make_tls_certificate (sha256_fingerprint, /* name */
-                                "", /* comment */
-                                certificate_b64,
-                                activation_time,
-                                expiration_time,
-                                md5_fingerprint,
-                                sha256_fingerprint,
-                                subject,
-                                issuer,
-                                serial,
-                                certificate_format,
-                                0,
-                                1,
-                                &tls_certificate)
-          || tls_certificate == 0)
+                   certificate->scanner_fpr);
+
+      if (strcmp (certificate->sha256_fingerprint, "") == 0)
         {
           g_warning ("%s: Could not create TLS certificate"
                      " or get existing one for fingerprint '%s'.",
-                     __func__, scanner_fpr);
-
-          g_free (certificate);
-          g_free (md5_fingerprint);
-          g_free (sha256_fingerprint);
-          g_free (subject);
-          g_free (issuer);
-          g_free (serial);
+                     __func__, certificate->scanner_fpr);
+          g_ptr_array_remove_index (certificates, index);
           continue;
         }
 
-      init_iterator (&ports,
-                     "SELECT value FROM report_host_details"
-                     " WHERE report_host = %llu"
-                     "   AND name = 'SSLInfo'"
-                     "   AND value LIKE '%%:%%:%s'",
-                     report_host,
-                     quoted_scanner_fpr);
-
-      has_ports = FALSE;
-      while (next (&ports))
-        {
-          const char *value;
-          gchar *port, *quoted_port;
-          GString *versions;
-          iterator_t versions_iter;
-
-          value = iterator_string (&ports, 0);
-          port = g_strndup (value, g_strrstr (value, ":") - value - 1);
-          quoted_port = sql_quote (port);
-
-          has_ports = TRUE;
-
-          versions = g_string_new ("");
-          init_iterator (&versions_iter,
-                         "SELECT value FROM report_host_details"
-                         " WHERE report_host = %llu"
-                         "   AND name = 'TLS/%s'",
-                         report_host,
-                         quoted_port);
-          while (next (&versions_iter))
-            {
-              gchar *quoted_version;
-              quoted_version = sql_quote (iterator_string (&versions_iter, 0));
-
-              if (versions->len)
-                g_string_append (versions, ", ");
-              g_string_append (versions, quoted_version);
-            }
-          cleanup_iterator (&versions_iter);
-
-          get_or_make_tls_certificate_source (tls_certificate,
-                                              host_ip,
-                                              port,
-                                              "Report",
-                                              report_id,
-                                              source_name);
-
-          g_free (port);
-          g_free (quoted_port);
-          g_string_free (versions, TRUE);
-        }
-
-      if (has_ports == FALSE)
-        g_warning ("Certificate without ports: %s report:%s host:%s",
-                   quoted_scanner_fpr, report_id, host_ip);
-
-      cleanup_iterator (&ports);
+      index++;
+    }
 
-      g_free (certificate);
-      g_free (md5_fingerprint);
-      g_free (sha256_fingerprint);
-      g_free (subject);
-      g_free (issuer);
-      g_free (serial);
+  if (certificates->len)
+    {
+      owner = 0;
+      sql_int64 (&owner,
+                 "SELECT id FROM users WHERE uuid = '%s'",
+                 current_credentials.uuid);
+
+      host_tls_certificates_resolve (certificates, owner);
+      host_tls_certificates_update (certificates);
+      host_tls_certificates_insert (certificates, owner);
+      host_tls_certificates_add_sources (certificates, ssl_infos,
+                                         host_ip, report_id);
     }
-  cleanup_iterator (&tls_certs);
+
+  g_hash_table_destroy (ssl_details);
+  g_ptr_array_free (ssl_infos, TRUE);
+  g_ptr_array_free (certificates, TRUE);
 
   return 0;
 }
@@ -24,6 +24,7 @@
 
 #include "manage_utils.h"
 
+#include <arpa/inet.h> /* for inet_pton */
 #include <assert.h> /* for assert */
 #include <stdlib.h> /* for getenv */
 #include <stdio.h>  /* for sscanf */
@@ -120,6 +121,19 @@ current_offset (const char *zone)
   return offset;
 }
 
+/**
+ * @brief Get the start of the UTC day of a time.
+ *
+ * @param[in]  time  Time.
+ *
+ * @return Midnight UTC at or before the time.
+ */
+time_t
+day_start_utc (time_t time)
+{
+  return time - (((time % 86400) + 86400) % 86400);
+}
+
 /**
  * @brief Add months to a time.
  *
@@ -256,6 +270,164 @@ level_max_severity (const char *level, const char *class)
     }
 }
 
+/**
+ * @brief Parse an entry of a hosts string as a range of IPv4 addresses.
+ *
+ * Handles single addresses, "a.b.c.d-e.f.g.h", "a.b.c.d-h" and CIDR blocks.
+ * CIDR blocks leave out the network and broadcast addresses, like
+ * gvm_hosts_new.
+ *
+ * @param[in]  entry  Entry, without surrounding space.
+ * @param[out] first  First address in host byte order.
+ * @param[out] last   Last address in host byte order.
+ *
+ * @return 0 success, -1 entry is not an IPv4 range.
+ */
+static int
+host_entry_ipv4_range (const char *entry, guint32 *first, guint32 *last)
+{
+  gchar *copy, *dash, *slash, *tail;
+  struct in_addr addr;
+  long number;
+  int ret;
+
+  copy = g_strdup (entry);
+  dash = strchr (copy, '-');
+  slash = strchr (copy, '/');
+  if (dash)
+    *dash = '\0';
+  else if (slash)
+    *slash = '\0';
+
+  if (inet_pton (AF_INET, copy, &addr) != 1)
+    {
+      g_free (copy);
+      return -1;
+    }
+
+  *first = ntohl (addr.s_addr);
+  *last = *first;
+  ret = 0;
+  if (dash)
+    {
+      if (inet_pton (AF_INET, dash + 1, &addr) == 1)
+        *last = ntohl (addr.s_addr);
+      else
+        {
+          number = strtol (dash + 1, &tail, 10);
+          if (dash[1] && *tail == '\0' && number >= 0 && number <= 255)
+            *last = (*first & 0xFFFFFF00) | number;
+          else
+            ret = -1;
+        }
+    }
+  else if (slash)
+    {
+      number = strtol (slash + 1, &tail, 10);
+      if (slash[1] && *tail == '\0' && number > 0 && number <= 32)
+        {
+          guint32 mask;
+
+          mask = 0xFFFFFFFF << (32 - number);
+          *first &= mask;
+          *last = *first | ~mask;
+          if (number < 31)
+            {
+              (*first)++;
+              (*last)--;
+            }
+        }
+      else
+        ret = -1;
+    }
+
+  if (*last < *first)
+    ret = -1;
+  g_free (copy);
+  return ret;
+}
+
+/**
+ * @brief Check whether a hosts entry is a plain host name.
+ *
+ * @param[in]  entry  Entry, without surrounding space.
+ *
+ * @return 1 yes, 0 no.
+ */
+static int
+host_entry_is_name (const char *entry)
+{
+  int letter;
+
+  letter = 0;
+  for (; *entry; entry++)
+    if (g_ascii_isalpha (*entry))
+      letter = 1;
+    else if (g_ascii_isdigit (*entry) == 0 && *entry != '.' && *entry != '-'
+             && *entry != '_')
+      return 0;
+  return letter;
+}
+
+/**
+ * @brief Check whether an IPv4 address is in a hosts string, without
+ * @brief expanding the hosts.
+ *
+ * gvm_hosts_new expands every range into single hosts, which is slow for
+ * large ranges.  This compares against the ranges instead, for hosts
+ * strings that only have IPv4 ranges and host names.
+ *
+ * @param[in] hosts_str      Hosts string to check.
+ * @param[in] find_host_str  The host to find.
+ * @param[in] max_hosts      Maximum number of hosts allowed in hosts_str.
+ *
+ * @return 1 if host is in hosts_str, 0 if not, -1 if the strings need
+ *         gvm_hosts_new.
+ */
+static int
+hosts_str_contains_ipv4 (const char* hosts_str, const char* find_host_str,
+                         int max_hosts)
+{
+  gchar **entries, **point;
+  struct in_addr addr;
+  guint32 find, first, last;
+  guint64 count;
+  int ret;
+
+  if (inet_pton (AF_INET, find_host_str, &addr) != 1)
+    return -1;
+  find = ntohl (addr.s_addr);
+
+  entries = g_strsplit (hosts_str, ",", 0);
+  ret = 0;
+  count = 0;
+  for (point = entries; *point; point++)
+    {
+      g_strstrip (*point);
+      if (**point == '\0')
+        continue;
+      if (host_entry_ipv4_range (*point, &first, &last) == 0)
+        {
+          count += (guint64) last - first + 1;
+          if (find >= first && find <= last)
+            ret = 1;
+        }
+      else if (host_entry_is_name (*point))
+        count++;
+      else
+        {
+          ret = -1;
+          break;
+        }
+    }
+  g_strfreev (entries);
+
+  /* Leave the limit, and the duplicates it may count, to gvm_hosts_new. */
+  if (ret >= 0 && max_hosts > 0 && count > (guint64) max_hosts)
+    return -1;
+  return ret;
+}
+
 /**
  * @brief Returns whether a host has an equal host in a hosts string.
  *
@@ -273,6 +445,11 @@ hosts_str_contains (const char* hosts_str, const char* find_host_str,
                     int max_hosts)
 {
   gvm_hosts_t *hosts, *find_hosts;
+  int ret;
+
+  ret = hosts_str_contains_ipv4 (hosts_str, find_host_str, max_hosts);
+  if (ret >= 0)
+    return ret;
 
   hosts = gvm_hosts_new_with_max (hosts_str, max_hosts);
   find_hosts = gvm_hosts_new_with_max (find_host_str, 1);
@@ -284,7 +461,7 @@ hosts_str_contains (const char* hosts_str, const char* find_host_str,
       return 0;
     }
 
-  int ret = gvm_host_in_hosts (find_hosts->hosts[0], NULL, hosts);
+  ret = gvm_host_in_hosts (find_hosts->hosts[0], NULL, hosts);
   gvm_hosts_free (hosts);
   gvm_hosts_free (find_hosts);
   return ret;
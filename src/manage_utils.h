@@ -52,6 +52,9 @@
 long
 current_offset (const char *);
 
+time_t
+day_start_utc (time_t);
+
 time_t
 add_months (time_t, int);
 
@@ -26,6 +26,27 @@ Describe (manage_utils);
 BeforeEach (manage_utils) {}
 AfterEach (manage_utils) {}
 
+/* day_start_utc */
+
+Ensure (manage_utils, day_start_utc_rounds_down_to_midnight)
+{
+  /* 2020-03-17T10:14:53Z. */
+  assert_that (day_start_utc (1584440093), is_equal_to (1584403200));
+  /* 2020-03-17T23:59:59Z. */
+  assert_that (day_start_utc (1584489599), is_equal_to (1584403200));
+}
+
+Ensure (manage_utils, day_start_utc_keeps_midnight)
+{
+  assert_that (day_start_utc (1584403200), is_equal_to (1584403200));
+  assert_that (day_start_utc (0), is_equal_to (0));
+}
+
+Ensure (manage_utils, day_start_utc_handles_times_before_epoch)
+{
+  assert_that (day_start_utc (-1), is_equal_to (-86400));
+}
+
 /* add_months */
 
 Ensure (manage_utils, add_months_0_months)
@@ -45,6 +66,46 @@ Ensure (manage_utils, add_months_positive_months)
   assert_that (add_months (1551484799, 2), is_equal_to (1556755199));
 }
 
+/* hosts_str_contains_ipv4 */
+
+Ensure (manage_utils, hosts_str_contains_ipv4_ranges)
+{
+  assert_that (hosts_str_contains_ipv4 ("192.168.10.1-5, 192.168.10.10-20",
+                                        "192.168.10.12", 0),
+               is_equal_to (1));
+  assert_that (hosts_str_contains_ipv4 ("192.168.10.1-5, 192.168.10.10-20",
+                                        "192.168.10.7", 0),
+               is_equal_to (0));
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.1-10.0.1.5",
+                                        "10.0.0.255", 0),
+               is_equal_to (1));
+}
+
+Ensure (manage_utils, hosts_str_contains_ipv4_cidr)
+{
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.0/24", "10.0.0.254", 0),
+               is_equal_to (1));
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.0/24", "10.0.0.0", 0),
+               is_equal_to (0));
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.0/24", "10.0.0.255", 0),
+               is_equal_to (0));
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.7/32", "10.0.0.7", 0),
+               is_equal_to (1));
+}
+
+Ensure (manage_utils, hosts_str_contains_ipv4_falls_back)
+{
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.1", "example.org", 0),
+               is_equal_to (-1));
+  assert_that (hosts_str_contains_ipv4 ("::1, 10.0.0.1", "10.0.0.1", 0),
+               is_equal_to (-1));
+  assert_that (hosts_str_contains_ipv4 ("10.0.0.0/16", "10.0.0.1", 100),
+               is_equal_to (-1));
+  assert_that (hosts_str_contains_ipv4 ("example.org, 10.0.0.1",
+                                        "10.0.0.1", 0),
+               is_equal_to (1));
+}
+
 /* Test suite. */
 
 int
@@ -54,10 +115,21 @@ main (int argc, char **argv)
 
   suite = create_test_suite ();
 
+  add_test_with_context (suite, manage_utils,
+                         day_start_utc_rounds_down_to_midnight);
+  add_test_with_context (suite, manage_utils, day_start_utc_keeps_midnight);
+  add_test_with_context (suite, manage_utils,
+                         day_start_utc_handles_times_before_epoch);
+
   add_test_with_context (suite, manage_utils, add_months_0_months);
   add_test_with_context (suite, manage_utils, add_months_negative_months);
   add_test_with_context (suite, manage_utils, add_months_positive_months);
 
+  add_test_with_context (suite, manage_utils, hosts_str_contains_ipv4_ranges);
+  add_test_with_context (suite, manage_utils, hosts_str_contains_ipv4_cidr);
+  add_test_with_context (suite, manage_utils,
+                         hosts_str_contains_ipv4_falls_back);
+
   if (argc > 1)
     return run_single_test (suite, argv[1], create_text_reporter ());
 
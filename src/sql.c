@@ -28,6 +28,9 @@
  * implemented for that database.
  */
 
+/* This file defines the functions that sql.h wraps. */
+#define SQL_NO_CALLER
+
 #include "sql.h"
 
 #include <assert.h>
@@ -50,6 +53,9 @@ sql_prepare_internal (int, int, const char*, va_list, sql_stmt_t **);
 int
 sql_exec_internal (int, sql_stmt_t *);
 
+int
+sql_prepare_ps_internal (int, int, const char*, GPtrArray *, sql_stmt_t **);
+
 
 /* Variables. */
 
@@ -60,6 +66,11 @@ sql_exec_internal (int, sql_stmt_t *);
  */
 int log_errors = 1;
 
+/**
+ * @brief Function that last called the SQL layer, for the slow statement log.
+ */
+const char *sql_caller = NULL;
+
 
 /* Helpers. */
 
@@ -178,7 +189,7 @@ sqlv (int retry, char* sql, va_list args)
       /* Run statement. */
 
       while ((ret = sql_exec_internal (retry, stmt)) == 1);
-      if ((ret == -1) && log_errors)
+      if ((ret == -1) && log_errors && sql_deadline_passed () == 0)
         g_warning ("%s: sql_exec_internal failed", __func__);
       sql_finalize (stmt);
       if (ret == 2)
@@ -197,6 +208,8 @@ sqlv (int retry, char* sql, va_list args)
 /**
  * @brief Perform an SQL statement, retrying if database is busy or locked.
  *
+ * Aborts on error, except when the command has run out of time.
+ *
  * @param[in]  sql    Format string for SQL statement.
  * @param[in]  ...    Arguments for format string.
  */
@@ -214,7 +227,7 @@ sql (char* sql, ...)
       if (ret == 1)
         /* Gave up with statement reset. */
         continue;
-      else if (ret)
+      else if (ret && sql_deadline_passed () == 0)
         abort();
       break;
     }
@@ -312,7 +325,7 @@ sql_x (char* sql, va_list args, sql_stmt_t** stmt_return)
       ret = sql_exec_internal (1, *stmt_return);
       if (ret == -1 || ret == -4)
         {
-          if (log_errors)
+          if (log_errors && sql_deadline_passed () == 0)
             g_warning ("%s: sql_exec_internal failed", __func__);
           return -1;
         }
@@ -339,6 +352,7 @@ sql_x (char* sql, va_list args, sql_stmt_t** stmt_return)
  *
  * @warning Aborts when the query returns fewer rows than \p row.  The
  *          caller must ensure that the query will return sufficient rows.
+ *          Once the command has run out of time it returns 0 instead.
  *
  * @param[in]  sql    Format string for SQL query.
  * @param[in]  ...    Arguments for format string.
@@ -359,6 +373,9 @@ sql_double (char* sql, ...)
   if (sql_x_ret)
     {
       sql_finalize (stmt);
+      if (sql_deadline_passed ())
+        /* The command ran out of time and is winding down. */
+        return 0;
       abort ();
     }
   ret = sql_column_double (stmt, 0);
@@ -373,6 +390,7 @@ sql_double (char* sql, ...)
  *
  * @warning Aborts when the query returns fewer rows than \p row.  The
  *          caller must ensure that the query will return sufficient rows.
+ *          Once the command has run out of time it returns 0 instead.
  *
  * @param[in]  sql    Format string for SQL query.
  * @param[in]  ...    Arguments for format string.
@@ -393,6 +411,9 @@ sql_int (char* sql, ...)
   if (sql_x_ret)
     {
       sql_finalize (stmt);
+      if (sql_deadline_passed ())
+        /* The command ran out of time and is winding down. */
+        return 0;
       abort ();
     }
   ret = sql_column_int (stmt, 0);
@@ -504,6 +525,368 @@ sql_int64_0 (char* sql, ...)
   return ret;
 }
 
+
+/* Parameterised statements. */
+
+/**
+ * @brief Create a NULL parameter for a parameterised statement.
+ *
+ * @return Freshly allocated parameter.
+ */
+sql_param_t *
+sql_param_null ()
+{
+  sql_param_t *param;
+
+  param = g_malloc0 (sizeof (sql_param_t));
+  param->type = SQL_PARAM_TYPE_NULL;
+  return param;
+}
+
+/**
+ * @brief Create a string parameter for a parameterised statement.
+ *
+ * @param[in]  value  Value.  NULL is passed to SQL as NULL.
+ *
+ * @return Freshly allocated parameter.
+ */
+sql_param_t *
+sql_param_string (const char *value)
+{
+  sql_param_t *param;
+
+  if (value == NULL)
+    return sql_param_null ();
+
+  param = g_malloc0 (sizeof (sql_param_t));
+  param->type = SQL_PARAM_TYPE_STRING;
+  param->value.string = g_strdup (value);
+  return param;
+}
+
+/**
+ * @brief Create an integer parameter for a parameterised statement.
+ *
+ * @param[in]  value  Value.
+ *
+ * @return Freshly allocated parameter.
+ */
+sql_param_t *
+sql_param_int (int value)
+{
+  sql_param_t *param;
+
+  param = g_malloc0 (sizeof (sql_param_t));
+  param->type = SQL_PARAM_TYPE_INT;
+  param->value.integer = value;
+  return param;
+}
+
+/**
+ * @brief Create a double parameter for a parameterised statement.
+ *
+ * @param[in]  value  Value.
+ *
+ * @return Freshly allocated parameter.
+ */
+sql_param_t *
+sql_param_double (double value)
+{
+  sql_param_t *param;
+
+  param = g_malloc0 (sizeof (sql_param_t));
+  param->type = SQL_PARAM_TYPE_DOUBLE;
+  param->value.dbl = value;
+  return param;
+}
+
+/**
+ * @brief Create a resource parameter for a parameterised statement.
+ *
+ * @param[in]  value  Value.
+ *
+ * @return Freshly allocated parameter.
+ */
+sql_param_t *
+sql_param_resource (resource_t value)
+{
+  sql_param_t *param;
+
+  param = g_malloc0 (sizeof (sql_param_t));
+  param->type = SQL_PARAM_TYPE_RESOURCE;
+  param->value.resource = value;
+  return param;
+}
+
+/**
+ * @brief Free a parameter of a parameterised statement.
+ *
+ * @param[in]  param  Parameter.
+ */
+static void
+sql_param_free (gpointer param)
+{
+  if (param && ((sql_param_t *) param)->type == SQL_PARAM_TYPE_STRING)
+    g_free (((sql_param_t *) param)->value.string);
+  g_free (param);
+}
+
+/**
+ * @brief Collect the parameters of a parameterised statement.
+ *
+ * @param[in]  args  Arguments: the parameters, terminated by NULL.
+ *
+ * @return Array of parameters.  Free with g_ptr_array_free.
+ */
+static GPtrArray *
+sql_params_collect (va_list args)
+{
+  GPtrArray *params;
+  sql_param_t *param;
+
+  params = g_ptr_array_new_with_free_func (sql_param_free);
+  while ((param = va_arg (args, sql_param_t *)))
+    g_ptr_array_add (params, param);
+  return params;
+}
+
+/**
+ * @brief Perform a parameterised SQL statement.
+ *
+ * @param[in]  sql     SQL statement, with parameters as $1, $2, ...
+ * @param[in]  params  Parameters.
+ *
+ * @return 0 success, 1 gave up, 2 reserved (lock unavailable),
+ *         3 unique constraint violation, -1 error.
+ */
+static int
+sqlv_ps (const char *sql, GPtrArray *params)
+{
+  while (1)
+    {
+      int ret;
+      sql_stmt_t* stmt;
+
+      ret = sql_prepare_ps_internal (1, 1, sql, params, &stmt);
+      if (ret == -1)
+        g_warning ("%s: sql_prepare_ps_internal failed", __func__);
+      if (ret)
+        return ret;
+
+      while ((ret = sql_exec_internal (1, stmt)) == 1);
+      if ((ret == -1) && log_errors && sql_deadline_passed () == 0)
+        g_warning ("%s: sql_exec_internal failed", __func__);
+      sql_finalize (stmt);
+      if (ret == 2)
+        continue;
+      if (ret == -2)
+        return 1;
+      if (ret == -3)
+        return -1;
+      if (ret == -4)
+        return 3;
+      assert (ret == -1 || ret == 0);
+      return ret;
+    }
+}
+
+/**
+ * @brief Perform a parameterised SQL statement, retrying if database is busy.
+ *
+ * The statement is prepared on the server once per connection and then
+ * reused, so it must be a fixed template with the values passed as
+ * parameters.
+ *
+ * @param[in]  sql    SQL statement, with parameters as $1, $2, ...
+ * @param[in]  ...    Parameters, like SQL_STR_PARAM (value), then NULL.
+ */
+void
+sql_ps (const char* sql, ...)
+{
+  GPtrArray *params;
+  va_list args;
+  int ret;
+
+  va_start (args, sql);
+  params = sql_params_collect (args);
+  va_end (args);
+
+  while ((ret = sqlv_ps (sql, params)) == 1)
+    /* Gave up with statement reset. */;
+  g_ptr_array_free (params, TRUE);
+  if (ret && sql_deadline_passed () == 0)
+    abort ();
+}
+
+/**
+ * @brief Get a particular cell from a parameterised SQL query.
+ *
+ * @param[in]   sql          SQL query, with parameters as $1, $2, ...
+ * @param[in]   params       Parameters.
+ * @param[out]  stmt_return  Return from statement.
+ *
+ * @return 0 success, 1 too few rows, -1 error.
+ */
+static int
+sql_x_ps (const char* sql, GPtrArray *params, sql_stmt_t** stmt_return)
+{
+  int ret;
+
+  assert (stmt_return);
+
+  /* So that callers can always finalize, even when prepare fails. */
+  *stmt_return = NULL;
+
+  while (1)
+    {
+      ret = sql_prepare_ps_internal (1, 1, sql, params, stmt_return);
+      if (ret)
+        {
+          g_warning ("%s: sql_prepare_ps_internal failed", __func__);
+          return -1;
+        }
+
+      ret = sql_exec_internal (1, *stmt_return);
+      if (ret == -1 || ret == -4)
+        {
+          if (log_errors && sql_deadline_passed () == 0)
+            g_warning ("%s: sql_exec_internal failed", __func__);
+          return -1;
+        }
+      if (ret == 0)
+        /* Too few rows. */
+        return 1;
+      if (ret == -3 || ret == -2 || ret == 2)
+        {
+          /* Busy or locked, with statement reset.  Or schema changed. */
+          sql_finalize (*stmt_return);
+          *stmt_return = NULL;
+          continue;
+        }
+      break;
+    }
+  assert (ret == 1);
+  g_debug ("   sql_x_ps end (%s)", sql);
+  return 0;
+}
+
+/**
+ * @brief Get the first cell from a parameterised SQL query, as an int.
+ *
+ * @warning Aborts on invalid queries and when there are no rows, unless
+ *          the command has run out of time, in which case it returns 0.
+ *
+ * @param[in]  sql    SQL query, with parameters as $1, $2, ...
+ * @param[in]  ...    Parameters, like SQL_STR_PARAM (value), then NULL.
+ *
+ * @return Result of the query as an integer.
+ */
+int
+sql_int_ps (const char* sql, ...)
+{
+  GPtrArray *params;
+  sql_stmt_t* stmt;
+  va_list args;
+  int ret, sql_x_ret;
+
+  va_start (args, sql);
+  params = sql_params_collect (args);
+  va_end (args);
+
+  sql_x_ret = sql_x_ps (sql, params, &stmt);
+  g_ptr_array_free (params, TRUE);
+  if (sql_x_ret)
+    {
+      sql_finalize (stmt);
+      if (sql_deadline_passed ())
+        /* The command ran out of time and is winding down. */
+        return 0;
+      abort ();
+    }
+  ret = sql_column_int (stmt, 0);
+  sql_finalize (stmt);
+  return ret;
+}
+
+/**
+ * @brief Get the first cell from a parameterised SQL query, as an int64.
+ *
+ * @param[out] ret    Return value.
+ * @param[in]  sql    SQL query, with parameters as $1, $2, ...
+ * @param[in]  ...    Parameters, like SQL_STR_PARAM (value), then NULL.
+ *
+ * @return 0 success, 1 too few rows, -1 error.
+ */
+int
+sql_int64_ps (long long int* ret, const char* sql, ...)
+{
+  GPtrArray *params;
+  sql_stmt_t* stmt;
+  int sql_x_ret;
+  va_list args;
+
+  va_start (args, sql);
+  params = sql_params_collect (args);
+  va_end (args);
+
+  sql_x_ret = sql_x_ps (sql, params, &stmt);
+  g_ptr_array_free (params, TRUE);
+  switch (sql_x_ret)
+    {
+      case  0:
+        break;
+      case  1:
+        sql_finalize (stmt);
+        return 1;
+        break;
+      default:
+        assert (0);
+        /* Fall through. */
+      case -1:
+        sql_finalize (stmt);
+        return -1;
+        break;
+    }
+  *ret = sql_column_int64 (stmt, 0);
+  sql_finalize (stmt);
+  return 0;
+}
+
+/**
+ * @brief Get the first cell from a parameterised SQL query, as a string.
+ *
+ * @param[in]  sql    SQL query, with parameters as $1, $2, ...
+ * @param[in]  ...    Parameters, like SQL_STR_PARAM (value), then NULL.
+ *
+ * @return Freshly allocated string containing the result, NULL otherwise.
+ *         NULL means that either the selected value was NULL or there were
+ *         no rows in the result.
+ */
+char*
+sql_string_ps (const char* sql, ...)
+{
+  GPtrArray *params;
+  sql_stmt_t* stmt;
+  char* ret;
+  int sql_x_ret;
+  va_list args;
+
+  va_start (args, sql);
+  params = sql_params_collect (args);
+  va_end (args);
+
+  sql_x_ret = sql_x_ps (sql, params, &stmt);
+  g_ptr_array_free (params, TRUE);
+  if (sql_x_ret)
+    {
+      sql_finalize (stmt);
+      return NULL;
+    }
+  ret = g_strdup (sql_column_text (stmt, 0));
+  sql_finalize (stmt);
+  return ret;
+}
+
 
 /* Iterators. */
 
@@ -551,6 +934,39 @@ init_iterator (iterator_t* iterator, const char* sql, ...)
   iterator->stmt = stmt;
 }
 
+/**
+ * @brief Initialise an iterator from a parameterised statement.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  sql       SQL, with parameters as $1, $2, ...
+ * @param[in]  ...       Parameters, like SQL_STR_PARAM (value), then NULL.
+ */
+void
+init_ps_iterator (iterator_t* iterator, const char* sql, ...)
+{
+  GPtrArray *params;
+  int ret;
+  sql_stmt_t* stmt;
+  va_list args;
+
+  iterator->done = FALSE;
+  iterator->prepared = 0;
+  iterator->crypt_ctx = NULL;
+
+  va_start (args, sql);
+  params = sql_params_collect (args);
+  va_end (args);
+
+  ret = sql_prepare_ps_internal (1, 1, sql, params, &stmt);
+  g_ptr_array_free (params, TRUE);
+  if (ret)
+    {
+      g_warning ("%s: sql_prepare_ps_internal failed", __func__);
+      abort ();
+    }
+  iterator->stmt = stmt;
+}
+
 /**
  * @brief Get a double column from an iterator.
  *
@@ -672,8 +1088,9 @@ next (iterator_t* iterator)
   while (1)
     {
       ret = sql_exec_internal (1, iterator->stmt);
-      if (ret == 0)
+      if (ret == 0 || sql_deadline_passed ())
         {
+          /* Finished, or the command ran out of time. */
           iterator->done = TRUE;
           return FALSE;
         }
@@ -29,6 +29,70 @@
 
 #include <glib.h>
 
+/* Types. */
+
+/**
+ * @brief Type of a parameter of a parameterised statement.
+ */
+typedef enum
+{
+  SQL_PARAM_TYPE_NULL,
+  SQL_PARAM_TYPE_STRING,
+  SQL_PARAM_TYPE_INT,
+  SQL_PARAM_TYPE_DOUBLE,
+  SQL_PARAM_TYPE_RESOURCE
+} sql_param_type_t;
+
+/**
+ * @brief A parameter of a parameterised statement.
+ */
+typedef struct
+{
+  sql_param_type_t type;   ///< Type of the value.
+  union
+  {
+    gchar *string;         ///< String value.
+    int integer;           ///< Integer value.
+    double dbl;            ///< Double value.
+    resource_t resource;   ///< Resource value.
+  } value;                 ///< Value of the parameter.
+} sql_param_t;
+
+/**
+ * @brief Lock waits at one call site.
+ */
+typedef struct
+{
+  long long count;     ///< Number of locks taken.
+  double wait_time;    ///< Seconds spent waiting for the locks.
+  double max_wait;     ///< Longest wait in seconds.
+} sql_lock_stats_t;
+
+/**
+ * @brief NULL parameter, for the *_ps functions.
+ */
+#define SQL_NULL_PARAM sql_param_null ()
+
+/**
+ * @brief String parameter, for the *_ps functions.
+ */
+#define SQL_STR_PARAM(value) sql_param_string (value)
+
+/**
+ * @brief Integer parameter, for the *_ps functions.
+ */
+#define SQL_INT_PARAM(value) sql_param_int (value)
+
+/**
+ * @brief Double parameter, for the *_ps functions.
+ */
+#define SQL_DOUBLE_PARAM(value) sql_param_double (value)
+
+/**
+ * @brief Resource parameter, for the *_ps functions.
+ */
+#define SQL_RESOURCE_PARAM(value) sql_param_resource (value)
+
 /* Helpers. */
 
 const char *
@@ -73,6 +137,33 @@ sql_changes ();
 resource_t
 sql_last_insert_id ();
 
+void
+sql_stats (long long *, double *, long long *);
+
+void
+sql_lock_wait (const char *, gint64);
+
+GHashTable *
+sql_lock_stats_take ();
+
+void
+sql_set_slow_log (int, int);
+
+void
+sql_replica_setup (const char *, int);
+
+void
+sql_replica_begin ();
+
+void
+sql_replica_end ();
+
+void
+sql_set_deadline (int, void (*) ());
+
+int
+sql_deadline_passed ();
+
 gchar *
 sql_nquote (const char *, size_t);
 
@@ -115,6 +206,38 @@ sql_int64_0 (char *sql, ...);
 void
 sql_rename_column (const char *, const char *, const char *, const char *);
 
+/* Parameterised statements. */
+
+sql_param_t *
+sql_param_null ();
+
+sql_param_t *
+sql_param_string (const char *);
+
+sql_param_t *
+sql_param_int (int);
+
+sql_param_t *
+sql_param_double (double);
+
+sql_param_t *
+sql_param_resource (resource_t);
+
+void
+sql_ps (const char *, ...);
+
+int
+sql_int_ps (const char *, ...);
+
+int
+sql_int64_ps (long long int *, const char *, ...);
+
+char *
+sql_string_ps (const char *, ...);
+
+void
+sql_prepared_cache_counts (long long int *, long long int *);
+
 /* Transactions. */
 
 void
@@ -129,6 +252,35 @@ sql_commit ();
 void
 sql_rollback ();
 
+int
+sql_in_transaction ();
+
+/* Notifications. */
+
+void
+sql_listen (const char *);
+
+void
+sql_notify (const char *);
+
+int
+sql_notified (const char *);
+
+int
+sql_socket ();
+
+int
+sql_copy_start (const char *, ...);
+
+int
+sql_copy_data (const char *, int);
+
+int
+sql_copy_end (const char *);
+
+void
+sql_copy_append (GString *, const char *, int);
+
 /* Iterators. */
 
 /* These functions are for "internal" use.  They may only be accessed by code
@@ -140,9 +292,15 @@ init_prepared_iterator (iterator_t *, sql_stmt_t *);
 void
 init_iterator (iterator_t *, const char *, ...);
 
+void
+init_ps_iterator (iterator_t *, const char *, ...);
+
 void
 iterator_rewind (iterator_t *iterator);
 
+void
+iterator_stream (iterator_t *, int);
+
 double
 iterator_double (iterator_t *, int);
 
@@ -181,6 +339,9 @@ sql_bind_text (sql_stmt_t *, int, const gchar *, gsize);
 int
 sql_bind_double (sql_stmt_t *, int, double *);
 
+int
+sql_bind_null (sql_stmt_t *, int);
+
 void
 sql_finalize (sql_stmt_t *);
 
@@ -202,6 +363,36 @@ sql_column_int64 (sql_stmt_t *, int);
 gchar **
 sql_column_array (sql_stmt_t *, int);
 
+/* Callers. */
+
+extern const char *sql_caller;
+
+/* The wrappers record the calling function for the slow statement log.
+ * sql.c defines SQL_NO_CALLER because it defines the wrapped functions. */
+#ifndef SQL_NO_CALLER
+
+/**
+ * @brief Record the calling function, then call an SQL function.
+ */
+#define SQL_CALLER(call) (sql_caller = __func__, call)
+
+#define sql(...) SQL_CALLER (sql (__VA_ARGS__))
+#define sql_error(...) SQL_CALLER (sql_error (__VA_ARGS__))
+#define sql_giveup(...) SQL_CALLER (sql_giveup (__VA_ARGS__))
+#define sql_double(...) SQL_CALLER (sql_double (__VA_ARGS__))
+#define sql_int(...) SQL_CALLER (sql_int (__VA_ARGS__))
+#define sql_string(...) SQL_CALLER (sql_string (__VA_ARGS__))
+#define sql_int64(...) SQL_CALLER (sql_int64 (__VA_ARGS__))
+#define sql_int64_0(...) SQL_CALLER (sql_int64_0 (__VA_ARGS__))
+#define sql_ps(...) SQL_CALLER (sql_ps (__VA_ARGS__))
+#define sql_int_ps(...) SQL_CALLER (sql_int_ps (__VA_ARGS__))
+#define sql_int64_ps(...) SQL_CALLER (sql_int64_ps (__VA_ARGS__))
+#define sql_string_ps(...) SQL_CALLER (sql_string_ps (__VA_ARGS__))
+#define init_iterator(...) SQL_CALLER (init_iterator (__VA_ARGS__))
+#define init_ps_iterator(...) SQL_CALLER (init_ps_iterator (__VA_ARGS__))
+
+#endif /* not SQL_NO_CALLER */
+
 int
 sql_cancel_internal ();
 
@@ -66,8 +66,24 @@ struct sql_stmt
   array_t *param_values;  ///< Parameter values.
   GArray *param_lengths;  ///< Parameter lengths (int's).
   GArray *param_formats;  ///< Parameter formats (int's).
+  int cache;              ///< Whether to use the prepared statement cache.
+  int fetch_size;         ///< Rows per FETCH when streaming, 0 for all at once.
+  gchar *cursor;          ///< Name of cursor when streaming.
+  PGconn *cursor_conn;    ///< Connection that the cursor belongs to.
+  const char *caller;     ///< Function that ran the statement.
+  gint64 time;            ///< Microseconds spent executing so far.
+  int rows;               ///< Rows returned so far.
 };
 
+/**
+ * @brief The statement timeout of a connection.
+ */
+typedef struct
+{
+  int milliseconds;       ///< Last statement_timeout set, 0 for none.
+  int uncertain;          ///< Whether a ROLLBACK may have undone the setting.
+} sql_timeout_t;
+
 
 /* Variables. */
 
@@ -81,9 +97,184 @@ extern int log_errors;
 
 /**
  * @brief Handle on the database.
+ *
+ * This is the primary, or the read replica while a read-only command runs.
  */
 static PGconn *conn = NULL;
 
+/**
+ * @brief Handle on the primary database.
+ */
+static PGconn *primary_conn = NULL;
+
+/**
+ * @brief Handle on the read replica, if open.
+ */
+static PGconn *replica_conn = NULL;
+
+/**
+ * @brief Connection string of the read replica, NULL for no replica.
+ */
+static gchar *replica_conn_info = NULL;
+
+/**
+ * @brief Seconds that the replica may lag behind the primary.
+ */
+static int replica_max_lag = 0;
+
+/**
+ * @brief Seconds between checks of the replica lag.
+ */
+#define REPLICA_CHECK_PERIOD 1
+
+/**
+ * @brief Seconds to wait before connecting again after the replica failed.
+ */
+#define REPLICA_RETRY_PERIOD 60
+
+/**
+ * @brief Time of the last check of the replica, in microseconds.
+ */
+static gint64 replica_checked = 0;
+
+/**
+ * @brief Whether the replica was close enough at the last check.
+ */
+static int replica_usable = 0;
+
+/**
+ * @brief Session settings last copied to the replica connection.
+ */
+static gchar *replica_session = NULL;
+
+/**
+ * @brief Time of the last write on the primary, in microseconds.
+ */
+static gint64 primary_written = 0;
+
+/**
+ * @brief Time at which the current command runs out, 0 for no deadline.
+ */
+static gint64 deadline = 0;
+
+/**
+ * @brief Function to call when the current command runs out of time.
+ */
+static void (*deadline_expired) () = NULL;
+
+/**
+ * @brief Whether the current command ran out of time.
+ */
+static int deadline_passed = 0;
+
+/**
+ * @brief Statement timeout of the primary connection.
+ */
+static sql_timeout_t primary_timeout = { 0, 0 };
+
+/**
+ * @brief Statement timeout of the replica connection.
+ */
+static sql_timeout_t replica_timeout = { 0, 0 };
+
+/**
+ * @brief Milliseconds that the statement timeout may run past the deadline.
+ *
+ * Lowering the timeout for every statement would double the round trips,
+ * so it is only lowered when it is this far behind.
+ */
+#define DEADLINE_SLACK 1000
+
+/**
+ * @brief Number of statements executed by this process.
+ */
+static long long stats_statements = 0;
+
+/**
+ * @brief Microseconds spent executing statements in this process.
+ */
+static gint64 stats_time = 0;
+
+/**
+ * @brief Number of rows returned to this process.
+ */
+static long long stats_rows = 0;
+
+/**
+ * @brief Lock waits of this process, per calling function.
+ *
+ * Keys are the static names of the callers, values are sql_lock_stats_t.
+ */
+static GHashTable *lock_stats = NULL;
+
+/**
+ * @brief Milliseconds after which a statement is logged as slow, 0 for never.
+ */
+static int slow_threshold = 0;
+
+/**
+ * @brief Whether to capture the plan of slow statements.
+ */
+static int slow_explain = 0;
+
+/**
+ * @brief Side connection for capturing the plan of slow statements.
+ */
+static PGconn *explain_conn = NULL;
+
+/**
+ * @brief Whether an EXPLAIN is running on the side connection.
+ */
+static int explain_pending = 0;
+
+/**
+ * @brief Function that ran the statement being explained.
+ */
+static const char *explain_caller = NULL;
+
+/**
+ * @brief Session settings last applied to the side connection.
+ */
+static gchar *explain_session = NULL;
+
+/**
+ * @brief Maximum number of statements in the prepared statement cache.
+ *
+ * When the cache is full all statements are deallocated and the cache
+ * starts again from empty.
+ */
+#define PREPARED_CACHE_MAX 512
+
+/**
+ * @brief Prepared statements of the connection, keyed by SQL template.
+ *
+ * The values are the server-side names of the prepared statements.
+ */
+static GHashTable *prepared_cache = NULL;
+
+/**
+ * @brief Prepared statements of the connection that is not conn.
+ *
+ * Swapped with prepared_cache when conn changes between the primary and
+ * the replica.
+ */
+static GHashTable *prepared_cache_other = NULL;
+
+/**
+ * @brief Counter for naming prepared statements.
+ */
+static unsigned int prepared_cache_serial = 0;
+
+/**
+ * @brief Number of executions that reused a cached prepared statement.
+ */
+static long long int prepared_cache_hits = 0;
+
+/**
+ * @brief Number of executions that had to prepare a statement first.
+ */
+static long long int prepared_cache_misses = 0;
+
 
 /* Helpers. */
 
@@ -148,6 +339,103 @@ sql_stmt_param_add (sql_stmt_t *stmt, const char *param_value,
   g_array_append_val (stmt->param_formats, param_format);
 }
 
+/**
+ * @brief Forget all statements in the prepared statement cache.
+ *
+ * This does not deallocate the statements on the server.  The serial keeps
+ * counting so that names stay unique on the other connection too.
+ */
+static void
+prepared_cache_clear ()
+{
+  if (prepared_cache)
+    g_hash_table_remove_all (prepared_cache);
+}
+
+/**
+ * @brief Get the counters of the prepared statement cache.
+ *
+ * @param[out]  hits    Number of executions that reused a statement.
+ * @param[out]  misses  Number of executions that prepared a statement.
+ */
+void
+sql_prepared_cache_counts (long long int *hits, long long int *misses)
+{
+  if (hits)
+    *hits = prepared_cache_hits;
+  if (misses)
+    *misses = prepared_cache_misses;
+}
+
+/**
+ * @brief Get the server-side prepared statement for an SQL template.
+ *
+ * Prepares the statement on the server if it is not in the cache yet.
+ *
+ * @param[in]  stmt  Statement.
+ *
+ * @return Name of prepared statement, or NULL on error.
+ */
+static const gchar *
+prepared_cache_get (sql_stmt_t *stmt)
+{
+  gchar *name;
+  PGresult *result;
+
+  if (prepared_cache == NULL)
+    prepared_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, g_free);
+
+  name = g_hash_table_lookup (prepared_cache, stmt->sql);
+  if (name)
+    {
+      prepared_cache_hits++;
+      return name;
+    }
+
+  prepared_cache_misses++;
+
+  if (g_hash_table_size (prepared_cache) >= PREPARED_CACHE_MAX)
+    {
+      g_debug ("%s: cache full, deallocating", __func__);
+      result = PQexec (conn, "DEALLOCATE ALL;");
+      if (PQresultStatus (result) != PGRES_COMMAND_OK)
+        {
+          g_warning ("%s: DEALLOCATE failed: %s",
+                     __func__,
+                     PQresultErrorMessage (result));
+          PQclear (result);
+          return NULL;
+        }
+      PQclear (result);
+      prepared_cache_clear ();
+    }
+
+  name = g_strdup_printf ("gvmd_ps_%u", prepared_cache_serial++);
+  result = PQprepare (conn,
+                      name,
+                      stmt->sql,
+                      stmt->param_values->len,
+                      NULL);               /* Default param types. */
+  if (PQresultStatus (result) != PGRES_COMMAND_OK)
+    {
+      if (log_errors)
+        {
+          g_warning ("%s: PQprepare failed: %s",
+                     __func__,
+                     PQresultErrorMessage (result));
+          g_warning ("%s: SQL: %s", __func__, stmt->sql);
+        }
+      PQclear (result);
+      g_free (name);
+      return NULL;
+    }
+  PQclear (result);
+
+  g_hash_table_insert (prepared_cache, g_strdup (stmt->sql), name);
+  return name;
+}
+
 /**
  * @brief Init statement, preserving SQL.
  *
@@ -243,6 +531,273 @@ sql_recursive_triggers_off ()
   return;
 }
 
+/**
+ * @brief Set up logging of slow statements.
+ *
+ * @param[in]  threshold  Milliseconds after which a statement is logged as
+ *                        slow, 0 for never.
+ * @param[in]  explain    Whether to capture the plan of slow statements.
+ */
+void
+sql_set_slow_log (int threshold, int explain)
+{
+  slow_threshold = threshold > 0 ? threshold : 0;
+  slow_explain = explain;
+}
+
+/**
+ * @brief Close the side connection used for capturing plans.
+ */
+static void
+sql_explain_close ()
+{
+  PQfinish (explain_conn);
+  explain_conn = NULL;
+  explain_pending = 0;
+  g_free (explain_session);
+  explain_session = NULL;
+}
+
+/**
+ * @brief Copy the session settings of one connection to another.
+ *
+ * This covers the settings that the manage layer sets up for a session:
+ * the user and timezone override that the SQL functions read, the search
+ * path with the SecInfo schemas, and the timezone.  The settings are only
+ * sent again when they have changed since the last copy.
+ *
+ * @param[in]      from     Connection to copy from.
+ * @param[in]      to       Connection to copy to.
+ * @param[in,out]  applied  Settings last copied to \p to, updated on success.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+sql_session_copy (PGconn *from, PGconn *to, gchar **applied)
+{
+  PGresult *result, *set;
+  const char *values[5];
+  gchar *settings;
+  int index;
+
+  if (PQtransactionStatus (from) == PQTRANS_INERROR)
+    return -1;
+
+  result = PQexec (from,
+                   "SELECT coalesce (current_setting ('gvmd.user.uuid', true),"
+                   "                 ''),"
+                   "       coalesce (current_setting ('gvmd.tz_override',"
+                   "                                  true),"
+                   "                 ''),"
+                   "       current_setting ('search_path'),"
+                   "       current_setting ('TimeZone');");
+  if (PQresultStatus (result) != PGRES_TUPLES_OK)
+    {
+      g_warning ("%s: failed to get session settings: %s",
+                 __func__, PQresultErrorMessage (result));
+      PQclear (result);
+      return -1;
+    }
+
+  for (index = 0; index < 4; index++)
+    values[index] = PQgetvalue (result, 0, index);
+  values[4] = NULL;
+  settings = g_strjoinv ("\n", (gchar **) values);
+
+  if (*applied && strcmp (*applied, settings) == 0)
+    {
+      g_free (settings);
+      PQclear (result);
+      return 0;
+    }
+
+  set = PQexecParams (to,
+                      "SELECT set_config ('gvmd.user.uuid', $1, false),"
+                      "       set_config ('gvmd.tz_override', $2, false),"
+                      "       set_config ('search_path', $3, false),"
+                      "       set_config ('TimeZone', $4, false);",
+                      4, NULL, values, NULL, NULL, 0);
+  PQclear (result);
+  if (PQresultStatus (set) != PGRES_TUPLES_OK)
+    {
+      g_warning ("%s: failed to set session settings: %s",
+                 __func__, PQresultErrorMessage (set));
+      PQclear (set);
+      g_free (settings);
+      return -1;
+    }
+  PQclear (set);
+
+  g_free (*applied);
+  *applied = settings;
+  return 0;
+}
+
+/**
+ * @brief Log the plan of a slow statement, if the side connection has it.
+ *
+ * Does not block.
+ */
+static void
+sql_explain_collect ()
+{
+  if (PQconsumeInput (explain_conn) == 0)
+    {
+      g_warning ("%s: PQconsumeInput failed: %s",
+                 __func__, PQerrorMessage (explain_conn));
+      sql_explain_close ();
+      return;
+    }
+
+  while (PQisBusy (explain_conn) == 0)
+    {
+      PGresult *result;
+
+      result = PQgetResult (explain_conn);
+      if (result == NULL)
+        {
+          explain_pending = 0;
+          return;
+        }
+
+      if (PQresultStatus (result) == PGRES_TUPLES_OK)
+        {
+          GString *plan;
+          int row;
+
+          plan = g_string_new ("");
+          for (row = 0; row < PQntuples (result); row++)
+            g_string_append_printf (plan, "\n%s", PQgetvalue (result, row, 0));
+          g_message ("%s: plan of slow statement in %s:%s",
+                     __func__,
+                     explain_caller ? explain_caller : "(unknown)",
+                     plan->str);
+          g_string_free (plan, TRUE);
+        }
+      else
+        g_message ("%s: failed to explain slow statement in %s: %s",
+                   __func__,
+                   explain_caller ? explain_caller : "(unknown)",
+                   PQresultErrorMessage (result));
+      PQclear (result);
+    }
+}
+
+/**
+ * @brief Start capturing the plan of a slow statement on the side connection.
+ *
+ * ANALYZE runs the statement again, so only queries are explained, and the
+ * side connection is read only.  The side connection cannot see temporary
+ * tables or uncommitted changes of the main connection, so the EXPLAIN
+ * fails for statements that depend on them.
+ *
+ * @param[in]  stmt  Statement.
+ */
+static void
+sql_explain_start (sql_stmt_t *stmt)
+{
+  const char *sql;
+  gchar *explain;
+
+  if (explain_pending)
+    /* Only capture one plan at a time. */
+    return;
+
+  sql = stmt->sql;
+  while (g_ascii_isspace (*sql))
+    sql++;
+  if (g_ascii_strncasecmp (sql, "SELECT", strlen ("SELECT"))
+      && g_ascii_strncasecmp (sql, "WITH", strlen ("WITH")))
+    return;
+
+  if (explain_conn == NULL)
+    {
+      gchar *conn_info;
+
+      conn_info = g_strdup_printf ("dbname='%s' application_name='%s'"
+                                   " options='-c default_transaction_read_only"
+                                   "=on'",
+                                   PQdb (conn),
+                                   "gvmd explain");
+      explain_conn = PQconnectdb (conn_info);
+      g_free (conn_info);
+      if (PQstatus (explain_conn) != CONNECTION_OK)
+        {
+          g_warning ("%s: failed to open side connection: %s",
+                     __func__, PQerrorMessage (explain_conn));
+          sql_explain_close ();
+          return;
+        }
+      PQsetNoticeProcessor (explain_conn, log_notice, NULL);
+    }
+
+  /* Run the statement in the same session setup as on the main
+   * connection, because the SQL functions and views depend on it. */
+  if (sql_session_copy (conn, explain_conn, &explain_session))
+    return;
+
+  explain = g_strdup_printf ("EXPLAIN (ANALYZE, BUFFERS) %s", sql);
+  if (PQsendQueryParams (explain_conn,
+                         explain,
+                         stmt->param_values->len,
+                         NULL,
+                         (const char* const*) stmt->param_values->pdata,
+                         (const int*) stmt->param_lengths->data,
+                         (const int*) stmt->param_formats->data,
+                         0)
+      == 0)
+    {
+      g_warning ("%s: PQsendQueryParams failed: %s",
+                 __func__, PQerrorMessage (explain_conn));
+      g_free (explain);
+      sql_explain_close ();
+      return;
+    }
+  g_free (explain);
+
+  explain_pending = 1;
+  explain_caller = stmt->caller;
+}
+
+/**
+ * @brief Log a statement if it was slow.
+ *
+ * @param[in]  stmt  Statement.
+ */
+static void
+sql_slow_check (sql_stmt_t *stmt)
+{
+  if (slow_threshold == 0
+      || stmt->executed == 0
+      || stmt->time < slow_threshold * (gint64) 1000)
+    return;
+
+  g_message ("%s: slow statement (%.3f s, %i rows) in %s: %s",
+             __func__,
+             stmt->time / (double) G_USEC_PER_SEC,
+             stmt->rows,
+             stmt->caller ? stmt->caller : "(unknown)",
+             stmt->sql);
+
+  if (slow_explain)
+    sql_explain_start (stmt);
+}
+
+/**
+ * @brief Forget the deadline of the current command.
+ *
+ * A forked process inherits the deadline of the command that forked it,
+ * and must not wind down when that command runs out of time.  The timeouts
+ * belong to the connections, which are new after a fork.
+ */
+static void
+sql_deadline_clear ()
+{
+  deadline = 0;
+  deadline_expired = NULL;
+  deadline_passed = 0;
+}
+
 /**
  * @brief Open the database.
  *
@@ -346,6 +901,13 @@ sql_open (const char *database)
     }
 
   PQsetNoticeProcessor (conn, log_notice, NULL);
+  primary_conn = conn;
+  primary_timeout.milliseconds = 0;
+  primary_timeout.uncertain = 0;
+  sql_deadline_clear ();
+
+  /* Prepared statements belong to the connection. */
+  prepared_cache_clear ();
 
   g_debug ("%s:   db: %s", __func__, PQdb (conn));
   g_debug ("%s: user: %s", __func__, PQuser (conn));
@@ -377,8 +939,23 @@ sql_open (const char *database)
 void
 sql_close ()
 {
+  g_debug ("%s: prepared statement cache: %lli hits, %lli misses",
+           __func__, prepared_cache_hits, prepared_cache_misses);
+  sql_replica_end ();
+  if (replica_conn)
+    {
+      PQfinish (replica_conn);
+      replica_conn = NULL;
+    }
+  g_free (replica_session);
+  replica_session = NULL;
+  if (prepared_cache_other)
+    g_hash_table_remove_all (prepared_cache_other);
   PQfinish (conn);
   conn = NULL;
+  primary_conn = NULL;
+  prepared_cache_clear ();
+  sql_explain_close ();
 }
 
 /**
@@ -389,33 +966,580 @@ sql_close_fork ()
 {
   // FIX PQfinish?
   conn = NULL;
+  prepared_cache_clear ();
+  /* The side connections belong to the parent too. */
+  explain_conn = NULL;
+  explain_pending = 0;
+  g_free (explain_session);
+  explain_session = NULL;
+  primary_conn = NULL;
+  replica_conn = NULL;
+  replica_usable = 0;
+  replica_checked = 0;
+  g_free (replica_session);
+  replica_session = NULL;
+  if (prepared_cache_other)
+    g_hash_table_remove_all (prepared_cache_other);
+  /* So do the lock waits so far. */
+  if (lock_stats)
+    g_hash_table_remove_all (lock_stats);
+  /* And the deadline of the command that forked. */
+  sql_deadline_clear ();
+  primary_timeout.milliseconds = 0;
+  primary_timeout.uncertain = 0;
+  replica_timeout.milliseconds = 0;
+  replica_timeout.uncertain = 0;
 }
 
+
+/* Read replica. */
+
 /**
- * @brief Return 0.
+ * @brief Set up the read replica.
  *
- * @return 0.
+ * @param[in]  conn_info  libpq connection string of the replica, NULL or
+ *                        empty for no replica.
+ * @param[in]  max_lag    Seconds that the replica may lag behind the primary
+ *                        for commands to read from it.
  */
-int
-sql_changes ()
+void
+sql_replica_setup (const char *conn_info, int max_lag)
 {
-  /* TODO PQcmdTuples needs a PQresult.  Callers use for info only anyway. */
-  return 0;
+  g_free (replica_conn_info);
+  replica_conn_info = (conn_info && strlen (conn_info))
+                       ? g_strdup (conn_info)
+                       : NULL;
+  replica_max_lag = max_lag > 0 ? max_lag : 0;
 }
 
 /**
- * @brief Get the ID of the last inserted row.
+ * @brief Swap the current connection between the primary and the replica.
  *
- * @return Resource.
+ * @param[in]  to  Connection to switch to.
  */
-resource_t
-sql_last_insert_id ()
+static void
+sql_replica_swap (PGconn *to)
 {
-  return sql_int ("SELECT LASTVAL ();");
+  GHashTable *cache;
+
+  if (conn == to)
+    return;
+  conn = to;
+  cache = prepared_cache;
+  prepared_cache = prepared_cache_other;
+  prepared_cache_other = cache;
 }
 
 /**
- * @brief Perform an SQL statement, retrying if database is busy or locked.
+ * @brief Check how far the replica is behind the primary.
+ *
+ * The replica is current when it has replayed all the WAL that the primary
+ * has written so far.  A replica that only compared its own receive and
+ * replay positions would look current after losing its upstream.  When
+ * the replica is behind, the lag is the age of the last transaction it
+ * replayed.
+ *
+ * @return Lag in seconds, or -1 on error.
+ */
+static double
+sql_replica_lag ()
+{
+  PGresult *result;
+  gchar *primary_lsn, *check;
+  double lag;
+  int version10;
+
+  version10 = PQserverVersion (primary_conn) >= 100000;
+  result = PQexec (primary_conn,
+                   version10
+                    ? "SELECT pg_current_wal_lsn ();"
+                    : "SELECT pg_current_xlog_location ();");
+  if (PQresultStatus (result) != PGRES_TUPLES_OK)
+    {
+      g_warning ("%s: WAL position of primary failed: %s",
+                 __func__,
+                 PQresultErrorMessage (result));
+      PQclear (result);
+      return -1;
+    }
+  primary_lsn = g_strdup (PQgetvalue (result, 0, 0));
+  PQclear (result);
+
+  check = g_strdup_printf
+           (PQserverVersion (replica_conn) >= 100000
+             ? "SELECT CASE"
+               " WHEN pg_wal_lsn_diff ('%s', pg_last_wal_replay_lsn ()) <= 0"
+               " THEN 0"
+               " ELSE coalesce (extract (epoch FROM now ()"
+               "                 - pg_last_xact_replay_timestamp ()),"
+               "                -1)"
+               " END;"
+             : "SELECT CASE"
+               " WHEN pg_xlog_location_diff ('%s',"
+               "                             pg_last_xlog_replay_location ())"
+               "      <= 0"
+               " THEN 0"
+               " ELSE coalesce (extract (epoch FROM now ()"
+               "                 - pg_last_xact_replay_timestamp ()),"
+               "                -1)"
+               " END;",
+            primary_lsn);
+  g_free (primary_lsn);
+  result = PQexec (replica_conn, check);
+  g_free (check);
+  if (PQresultStatus (result) != PGRES_TUPLES_OK
+      || PQgetisnull (result, 0, 0))
+    {
+      g_warning ("%s: lag check failed: %s",
+                 __func__,
+                 PQresultErrorMessage (result));
+      PQclear (result);
+      return -1;
+    }
+  lag = atof (PQgetvalue (result, 0, 0));
+  PQclear (result);
+  return lag;
+}
+
+/**
+ * @brief Check whether the replica can serve reads now.
+ *
+ * Connects to the replica if needed.  Checks at most once per
+ * REPLICA_CHECK_PERIOD, and waits REPLICA_RETRY_PERIOD after a failure.
+ *
+ * @param[in]  now  Current monotonic time.
+ *
+ * @return 1 if usable, else 0.
+ */
+static int
+sql_replica_check (gint64 now)
+{
+  double lag;
+
+  if (replica_checked
+      && now - replica_checked
+         < (replica_usable || replica_conn
+             ? REPLICA_CHECK_PERIOD
+             : REPLICA_RETRY_PERIOD) * G_USEC_PER_SEC)
+    return replica_usable;
+  replica_checked = now;
+  replica_usable = 0;
+
+  if (replica_conn && PQstatus (replica_conn) != CONNECTION_OK)
+    {
+      PQfinish (replica_conn);
+      replica_conn = NULL;
+      if (prepared_cache_other)
+        g_hash_table_remove_all (prepared_cache_other);
+    }
+
+  if (replica_conn == NULL)
+    {
+      replica_conn = PQconnectdb (replica_conn_info);
+      if (PQstatus (replica_conn) != CONNECTION_OK)
+        {
+          g_warning ("%s: failed to connect to replica: %s",
+                     __func__,
+                     PQerrorMessage (replica_conn));
+          PQfinish (replica_conn);
+          replica_conn = NULL;
+          return 0;
+        }
+      PQsetNoticeProcessor (replica_conn, log_notice, NULL);
+      replica_timeout.milliseconds = 0;
+      replica_timeout.uncertain = 0;
+      g_free (replica_session);
+      replica_session = NULL;
+    }
+
+  lag = sql_replica_lag ();
+  if (lag < 0)
+    return 0;
+  if (lag > replica_max_lag)
+    {
+      g_debug ("%s: replica is %.1f seconds behind", __func__, lag);
+      return 0;
+    }
+  replica_usable = 1;
+  return 1;
+}
+
+/**
+ * @brief Send the statements of a read-only command to the replica.
+ *
+ * Stays on the primary when there is no replica, when the replica lags too
+ * far, inside a transaction, or when this process wrote to the primary in
+ * the last max lag seconds, so that clients read their own writes.
+ *
+ * The replica gets the session setup of the primary first, so that the
+ * user, timezone and search path are the same on both.
+ */
+void
+sql_replica_begin ()
+{
+  gint64 now;
+
+  if (replica_conn_info == NULL
+      || primary_conn == NULL
+      || conn != primary_conn
+      || sql_in_transaction ())
+    return;
+
+  now = g_get_monotonic_time ();
+  if (primary_written
+      && now - primary_written < replica_max_lag * G_USEC_PER_SEC)
+    return;
+
+  if (sql_replica_check (now)
+      && sql_session_copy (primary_conn, replica_conn, &replica_session) == 0)
+    sql_replica_swap (replica_conn);
+}
+
+/**
+ * @brief Go back to sending statements to the primary.
+ */
+void
+sql_replica_end ()
+{
+  if (replica_conn == NULL || conn != replica_conn)
+    return;
+
+  if (PQtransactionStatus (replica_conn) != PQTRANS_IDLE)
+    {
+      PGresult *result;
+
+      /* Nothing was written, so there is nothing to keep. */
+      result = PQexec (replica_conn, "ROLLBACK;");
+      PQclear (result);
+    }
+  sql_replica_swap (primary_conn);
+}
+
+/**
+ * @brief Move the current command from the replica to the primary.
+ *
+ * Used when the command turns out to write or to start a transaction after
+ * all.  This is only safe while the replica has no open transaction, and
+ * so no open cursor, because the rows that the command has read so far
+ * must stay valid.  Transactions move to the primary when they begin, so
+ * a write inside one only happens if the command began the transaction
+ * some other way.  Such a command fails, and needs to be run again on the
+ * primary.
+ *
+ * @return 0 moved to primary, -1 command must fail.
+ */
+static int
+sql_replica_fall_back ()
+{
+  if (PQtransactionStatus (replica_conn) != PQTRANS_IDLE)
+    {
+      g_warning ("%s: command writes inside a transaction on the read"
+                 " replica, so it must be run on the primary",
+                 __func__);
+      return -1;
+    }
+
+  g_debug ("%s: command writes, moving to primary", __func__);
+  sql_replica_end ();
+  primary_written = g_get_monotonic_time ();
+  return 0;
+}
+
+/**
+ * @brief Get the statement timeout record of a connection.
+ *
+ * @param[in]  connection  Connection.
+ *
+ * @return Timeout record, or NULL if the connection has none.
+ */
+static sql_timeout_t *
+sql_timeout_of (PGconn *connection)
+{
+  if (connection == NULL)
+    return NULL;
+  if (connection == primary_conn)
+    return &primary_timeout;
+  if (connection == replica_conn)
+    return &replica_timeout;
+  return NULL;
+}
+
+/**
+ * @brief Set the statement timeout of a connection.
+ *
+ * @param[in]  connection    Connection.
+ * @param[in]  timeout       Timeout record of connection.
+ * @param[in]  milliseconds  Timeout, 0 for none.
+ */
+static void
+sql_timeout_set (PGconn *connection, sql_timeout_t *timeout,
+                 int milliseconds)
+{
+  PGresult *result;
+  gchar *set;
+
+  if (PQtransactionStatus (connection) == PQTRANS_INERROR)
+    return;
+
+  set = g_strdup_printf ("SET statement_timeout = %i;", milliseconds);
+  result = PQexec (connection, set);
+  g_free (set);
+  if (PQresultStatus (result) == PGRES_COMMAND_OK)
+    {
+      timeout->milliseconds = milliseconds;
+      timeout->uncertain
+       = PQtransactionStatus (connection) != PQTRANS_IDLE;
+    }
+  else
+    g_warning ("%s: SET statement_timeout failed: %s",
+               __func__,
+               PQresultErrorMessage (result));
+  PQclear (result);
+}
+
+/**
+ * @brief Remove any statement timeout that a deadline set.
+ *
+ * A connection inside a failed transaction keeps its timeout until the
+ * ROLLBACK, so callers check again after rolling back.
+ */
+static void
+sql_timeouts_reset ()
+{
+  if (primary_conn
+      && PQtransactionStatus (primary_conn) != PQTRANS_ACTIVE
+      && (primary_timeout.milliseconds || primary_timeout.uncertain))
+    sql_timeout_set (primary_conn, &primary_timeout, 0);
+  if (replica_conn
+      && PQtransactionStatus (replica_conn) != PQTRANS_ACTIVE
+      && (replica_timeout.milliseconds || replica_timeout.uncertain))
+    sql_timeout_set (replica_conn, &replica_timeout, 0);
+}
+
+/**
+ * @brief Give up on the current command, because it ran out of time.
+ */
+static void
+sql_deadline_expire ()
+{
+  void (*expired) ();
+
+  /* Clear first, in case the handler runs statements. */
+  expired = deadline_expired;
+  deadline = 0;
+  deadline_expired = NULL;
+  deadline_passed = 1;
+  /* The rest of the command only winds down, so it needs no timeout. */
+  sql_timeouts_reset ();
+  if (expired)
+    expired ();
+}
+
+/**
+ * @brief Check whether the current command ran out of time.
+ *
+ * Iterators end early once this is set, and the transaction of the command
+ * is rolled back instead of committed.
+ *
+ * @return 1 if the deadline passed, else 0.
+ */
+int
+sql_deadline_passed ()
+{
+  return deadline_passed;
+}
+
+/**
+ * @brief Check the deadline before a step of a statement.
+ *
+ * Gives up on the command if the deadline has passed.  Otherwise brings
+ * the statement timeout of the connection down to the time that is left,
+ * so that the server cancels a statement that would run past the deadline.
+ *
+ * @param[in]  stmt  Statement.
+ */
+static void
+sql_deadline_check (sql_stmt_t *stmt)
+{
+  PGconn *connection;
+  sql_timeout_t *timeout;
+  gint64 left;
+  int milliseconds;
+
+  left = deadline - g_get_monotonic_time ();
+  if (left <= 0)
+    {
+      g_debug ("%s: deadline passed before: %s", __func__, stmt->sql);
+      sql_deadline_expire ();
+      return;
+    }
+
+  connection = stmt->cursor ? stmt->cursor_conn : conn;
+  timeout = sql_timeout_of (connection);
+  if (timeout == NULL)
+    return;
+
+  milliseconds = left / 1000 + 1;
+  if (timeout->milliseconds == 0
+      || timeout->milliseconds > milliseconds + DEADLINE_SLACK)
+    sql_timeout_set (connection, timeout, milliseconds);
+}
+
+/**
+ * @brief Set a deadline for the statements of the current command.
+ *
+ * The deadline is checked before every statement and every row, and the
+ * server cancels any statement that runs past it.  In both cases \p expired
+ * gets called.  From then on the SQL layer refuses every statement except
+ * ROLLBACK, so nothing the command does after that point is stored.
+ * Iterators return no more rows, and the other statements return errors
+ * instead of aborting, so that the command can wind down at its next check
+ * of the client connection.
+ *
+ * Removing the deadline after it passed rolls back the open transaction.
+ *
+ * @param[in]  milliseconds  Time from now, 0 to remove the deadline.
+ * @param[in]  expired       Function to call when the deadline passes.
+ */
+void
+sql_set_deadline (int milliseconds, void (*expired) ())
+{
+  if (milliseconds > 0)
+    {
+      deadline = g_get_monotonic_time () + milliseconds * (gint64) 1000;
+      deadline_expired = expired;
+      deadline_passed = 0;
+      return;
+    }
+
+  if (deadline_passed && conn
+      && PQtransactionStatus (conn) != PQTRANS_IDLE)
+    {
+      PGresult *result;
+
+      result = PQexec (conn, "ROLLBACK;");
+      PQclear (result);
+    }
+  deadline_passed = 0;
+  deadline = 0;
+  deadline_expired = NULL;
+  sql_timeouts_reset ();
+}
+
+/**
+ * @brief Check whether a statement writes to the database.
+ *
+ * @param[in]  sql  Statement.
+ *
+ * @return 1 if statement writes, else 0.
+ */
+static int
+sql_writes (const char *sql)
+{
+  while (*sql == ' ' || *sql == '\n' || *sql == '\t')
+    sql++;
+  return g_ascii_strncasecmp (sql, "INSERT", 6) == 0
+         || g_ascii_strncasecmp (sql, "UPDATE", 6) == 0
+         || g_ascii_strncasecmp (sql, "DELETE", 6) == 0
+         || g_ascii_strncasecmp (sql, "CREATE", 6) == 0
+         || g_ascii_strncasecmp (sql, "ALTER", 5) == 0
+         || g_ascii_strncasecmp (sql, "DROP", 4) == 0
+         || g_ascii_strncasecmp (sql, "TRUNCATE", 8) == 0
+         || g_ascii_strncasecmp (sql, "COPY", 4) == 0;
+}
+
+/**
+ * @brief Check whether a statement changes session settings.
+ *
+ * @param[in]  sql  Statement.
+ *
+ * @return 1 if statement sets settings, else 0.
+ */
+static int
+sql_sets_session (const char *sql)
+{
+  while (*sql == ' ' || *sql == '\n' || *sql == '\t')
+    sql++;
+  return g_ascii_strncasecmp (sql, "SET", 3) == 0
+         || g_ascii_strncasecmp (sql, "RESET", 5) == 0
+         || strstr (sql, "set_config");
+}
+
+/**
+ * @brief Check whether a statement begins a transaction.
+ *
+ * @param[in]  sql  Statement.
+ *
+ * @return 1 if statement begins a transaction, else 0.
+ */
+static int
+sql_begins (const char *sql)
+{
+  while (*sql == ' ' || *sql == '\n' || *sql == '\t')
+    sql++;
+  return g_ascii_strncasecmp (sql, "BEGIN", 5) == 0
+         || g_ascii_strncasecmp (sql, "START TRANSACTION", 17) == 0;
+}
+
+/**
+ * @brief Check whether a statement rolls back.
+ *
+ * @param[in]  sql  Statement.
+ *
+ * @return 1 if statement is a ROLLBACK, else 0.
+ */
+static int
+sql_rolls_back (const char *sql)
+{
+  while (*sql == ' ' || *sql == '\n' || *sql == '\t')
+    sql++;
+  return g_ascii_strncasecmp (sql, "ROLLBACK", 8) == 0;
+}
+
+/**
+ * @brief Check whether a statement takes an explicit lock.
+ *
+ * @param[in]  sql  Statement.
+ *
+ * @return 1 if statement locks, else 0.
+ */
+static int
+sql_locks (const char *sql)
+{
+  while (*sql == ' ' || *sql == '\n' || *sql == '\t')
+    sql++;
+  return g_ascii_strncasecmp (sql, "LOCK", 4) == 0
+         || strstr (sql, "pg_advisory_xact_lock")
+         || strstr (sql, "try_exclusive_lock")
+         || strstr (sql, " FOR UPDATE")
+         || strstr (sql, " FOR SHARE");
+}
+
+/**
+ * @brief Return 0.
+ *
+ * @return 0.
+ */
+int
+sql_changes ()
+{
+  /* TODO PQcmdTuples needs a PQresult.  Callers use for info only anyway. */
+  return 0;
+}
+
+/**
+ * @brief Get the ID of the last inserted row.
+ *
+ * @return Resource.
+ */
+resource_t
+sql_last_insert_id ()
+{
+  return sql_int ("SELECT LASTVAL ();");
+}
+
+/**
+ * @brief Perform an SQL statement, retrying if database is busy or locked.
  *
  * @param[out] resource  Last inserted resource.
  * @param[in]  sql       Format string for SQL statement.
@@ -480,15 +1604,289 @@ sql_prepare_internal (int retry, int log, const char* sql, va_list args,
   *stmt = (sql_stmt_t*) g_malloc (sizeof (sql_stmt_t));
   sql_stmt_init (*stmt);
   (*stmt)->sql = g_strdup_vprintf (sql, args);
+  (*stmt)->caller = sql_caller;
 
   if (log)
     g_debug ("   sql: %s", (*stmt)->sql);
 
-  return 0;
+  return 0;
+}
+
+/**
+ * @brief Bind a parameter of a parameterised statement.
+ *
+ * @param[in]  stmt      Statement.
+ * @param[in]  position  Position in statement.
+ * @param[in]  param     Parameter.
+ */
+static void
+sql_bind_param (sql_stmt_t *stmt, int position, sql_param_t *param)
+{
+  gchar *text;
+
+  switch (param->type)
+    {
+      case SQL_PARAM_TYPE_NULL:
+        sql_bind_null (stmt, position);
+        return;
+      case SQL_PARAM_TYPE_STRING:
+        sql_bind_text (stmt, position, param->value.string, -1);
+        return;
+      case SQL_PARAM_TYPE_INT:
+        text = g_strdup_printf ("%i", param->value.integer);
+        break;
+      case SQL_PARAM_TYPE_DOUBLE:
+        text = g_strdup_printf ("%.17g", param->value.dbl);
+        break;
+      case SQL_PARAM_TYPE_RESOURCE:
+        text = g_strdup_printf ("%llu", param->value.resource);
+        break;
+      default:
+        g_critical ("%s: unknown param type %i", __func__, param->type);
+        abort ();
+    }
+  sql_bind_text (stmt, position, text, -1);
+  g_free (text);
+}
+
+/**
+ * @brief Prepare a parameterised statement.
+ *
+ * The statement is executed via the prepared statement cache.
+ *
+ * @param[in]  retry   Whether to keep retrying while database is busy.
+ * @param[in]  log     Whether to log the SQL.
+ * @param[in]  sql     SQL statement, with parameters as $1, $2, ...
+ * @param[in]  params  Parameters (sql_param_t's).
+ * @param[out] stmt    Statement return.
+ *
+ * @return 0 success, 1 gave up, -1 error.
+ */
+int
+sql_prepare_ps_internal (int retry, int log, const char* sql,
+                         GPtrArray *params, sql_stmt_t **stmt)
+{
+  guint index;
+
+  assert (stmt);
+
+  *stmt = (sql_stmt_t*) g_malloc (sizeof (sql_stmt_t));
+  sql_stmt_init (*stmt);
+  (*stmt)->sql = g_strdup (sql);
+  (*stmt)->cache = 1;
+  (*stmt)->caller = sql_caller;
+
+  for (index = 0; index < params->len; index++)
+    sql_bind_param (*stmt, index + 1, g_ptr_array_index (params, index));
+
+  if (log)
+    g_debug ("   sql: %s", (*stmt)->sql);
+
+  return 0;
+}
+
+/**
+ * @brief Check the result of executing a statement.
+ *
+ * @param[in]  stmt    Statement.
+ * @param[in]  result  Result of executing the statement.
+ *
+ * @return 0 success, -1 error, -3 lock unavailable,
+ *         -4 unique constraint violation, -5 write on read replica.
+ */
+static int
+sql_result_check (sql_stmt_t *stmt, PGresult *result)
+{
+  char *sqlstate;
+
+  if (PQresultStatus (result) == PGRES_TUPLES_OK
+      || PQresultStatus (result) == PGRES_COMMAND_OK)
+    return 0;
+
+  sqlstate = PQresultErrorField (result, PG_DIAG_SQLSTATE);
+  g_debug ("%s: sqlstate: %s", __func__, sqlstate);
+  if (sqlstate && (strcmp (sqlstate, "57014") == 0))
+    {
+      /* query_canceled */
+      if (deadline)
+        {
+          /* The statement timeout of the deadline.  Callers see the error
+           * and wind down, because the deadline has passed. */
+          g_debug ("%s: deadline passed during: %s", __func__, stmt->sql);
+          sql_deadline_expire ();
+          return -1;
+        }
+      log_errors = 0;
+      g_debug ("%s: canceled SQL: %s", __func__, stmt->sql);
+    }
+  else if (sqlstate && (strcmp (sqlstate, "55P03") == 0))
+    {
+      /* lock_not_available */
+      g_debug ("%s: lock unavailable: %s",
+               __func__,
+               PQresultErrorMessage(result));
+      return -3;
+    }
+  else if (sqlstate && (strcmp (sqlstate, "25006") == 0)
+           && conn == replica_conn)
+    {
+      /* read_only_sql_transaction, so the statement needs the primary. */
+      g_debug ("%s: read only replica: %s", __func__, stmt->sql);
+      return -5;
+    }
+  else if (sqlstate && (strcmp (sqlstate, "23505") == 0))
+    {
+      /* unique_violation */
+      g_warning ("%s: constraint violation: %s",
+                 __func__,
+                 PQresultErrorMessage (result));
+      g_warning ("%s: SQL: %s", __func__, stmt->sql);
+      return -4;
+    }
+
+  if (log_errors)
+    {
+      g_warning ("%s: PQexec failed: %s (%i)",
+                 __func__,
+                 PQresultErrorMessage (result),
+                 PQresultStatus (result));
+      g_warning ("%s: SQL: %s", __func__, stmt->sql);
+    }
+#if 0
+  // FIX ?
+  PQclear (result);
+  PQfinish (conn);
+#endif
+  return -1;
+}
+
+static void
+sql_cursor_close (sql_stmt_t *);
+
+/**
+ * @brief Open a cursor for a streaming statement.
+ *
+ * The cursor is not declared WITH HOLD, because the server would then
+ * materialise all its rows at the end of the transaction.  So the cursor
+ * lives in the transaction of the caller, which the caller must keep open
+ * until the iterator is done.
+ *
+ * @param[in]  stmt  Statement.
+ *
+ * @return 0 success, else error as for sql_result_check.
+ */
+static int
+sql_cursor_open (sql_stmt_t *stmt)
+{
+  static unsigned int serial = 0;
+  PGresult *result;
+  gchar *name, *declare;
+  int ret;
+
+  sql_cursor_close (stmt);
+
+  name = g_strdup_printf ("gvmd_cursor_%u", serial++);
+  declare = g_strdup_printf ("DECLARE %s NO SCROLL CURSOR FOR %s",
+                             name, stmt->sql);
+  result = PQexecParams (conn,
+                         declare,
+                         stmt->param_values->len,
+                         NULL,                     /* Default param types. */
+                         (const char* const*) stmt->param_values->pdata,
+                         (const int*) stmt->param_lengths->data,
+                         (const int*) stmt->param_formats->data,
+                         0);                       /* Results as text. */
+  g_free (declare);
+  ret = sql_result_check (stmt, result);
+  PQclear (result);
+  if (ret)
+    {
+      g_free (name);
+      return ret;
+    }
+  stmt->cursor = name;
+  stmt->cursor_conn = conn;
+  return 0;
+}
+
+/**
+ * @brief Fetch the next batch of rows from the cursor of a statement.
+ *
+ * @param[in]  stmt  Statement.
+ *
+ * @return 0 success, else error as for sql_result_check.
+ */
+static int
+sql_cursor_fetch (sql_stmt_t *stmt)
+{
+  PGresult *result;
+  gchar *fetch;
+  int ret;
+
+  if (PQtransactionStatus (stmt->cursor_conn) == PQTRANS_IDLE)
+    {
+      /* Running the statement again would see a different snapshot, so
+       * there is no safe way to carry on. */
+      g_warning ("%s: transaction of %s ended while streaming: %s",
+                 __func__, stmt->cursor, stmt->sql);
+      return -1;
+    }
+
+  fetch = g_strdup_printf ("FETCH FORWARD %i FROM %s",
+                           stmt->fetch_size, stmt->cursor);
+  result = PQexec (stmt->cursor_conn, fetch);
+  g_free (fetch);
+  ret = sql_result_check (stmt, result);
+  if (ret)
+    {
+      PQclear (result);
+      return ret;
+    }
+
+  PQclear (stmt->result);
+  stmt->result = result;
+  stmt->current_row = -1;
+  return 0;
+}
+
+/**
+ * @brief Close the cursor of a streaming statement, if it has one.
+ *
+ * @param[in]  stmt  Statement.
+ */
+static void
+sql_cursor_close (sql_stmt_t *stmt)
+{
+  if (stmt->cursor == NULL)
+    return;
+
+  /* The cursor died with its connection, or with the transaction. */
+  if (stmt->cursor_conn
+      && (stmt->cursor_conn == primary_conn
+          || stmt->cursor_conn == replica_conn)
+      && PQtransactionStatus (stmt->cursor_conn) == PQTRANS_INTRANS)
+    {
+      PGresult *result;
+      gchar *close;
+
+      close = g_strdup_printf ("CLOSE %s", stmt->cursor);
+      result = PQexec (stmt->cursor_conn, close);
+      g_free (close);
+      if (PQresultStatus (result) != PGRES_COMMAND_OK)
+        g_warning ("%s: CLOSE %s failed: %s",
+                   __func__,
+                   stmt->cursor,
+                   PQresultErrorMessage (result));
+      PQclear (result);
+    }
+
+  g_free (stmt->cursor);
+  stmt->cursor = NULL;
+  stmt->cursor_conn = NULL;
 }
 
 /**
- * @brief Execute a prepared statement.
+ * @brief Execute a prepared statement, or step to its next row.
  *
  * @param[in]  retry  Whether to keep retrying while database is busy or locked.
  * @param[in]  stmt   Statement.
@@ -496,10 +1894,11 @@ sql_prepare_internal (int retry, int log, const char* sql, va_list args,
  * @return 0 complete, 1 row available in results, -1 error, -2 gave up,
  *         -3 lock unavailable, -4 unique constraint violation.
  */
-int
-sql_exec_internal (int retry, sql_stmt_t *stmt)
+static int
+sql_exec_step (int retry, sql_stmt_t *stmt)
 {
   PGresult *result;
+  int ret;
 
   assert (stmt->sql);
 
@@ -507,63 +1906,59 @@ sql_exec_internal (int retry, sql_stmt_t *stmt)
     {
       // FIX retry?
 
-      result = PQexecParams (conn,
-                             stmt->sql,
-                             stmt->param_values->len,
-                             NULL,                 /* Default param types. */
-                             (const char* const*) stmt->param_values->pdata,
-                             (const int*) stmt->param_lengths->data,
-                             (const int*) stmt->param_formats->data,
-                             0);                   /* Results as text. */
-      if (PQresultStatus (result) != PGRES_TUPLES_OK
-          && PQresultStatus (result) != PGRES_COMMAND_OK)
+      /* Stream only inside a transaction of the caller, so that the
+       * cursor never holds a transaction open on its own. */
+      if (stmt->fetch_size > 0
+          && PQtransactionStatus (conn) == PQTRANS_INTRANS)
         {
-          char *sqlstate;
-
-          sqlstate = PQresultErrorField (result, PG_DIAG_SQLSTATE);
-          g_debug ("%s: sqlstate: %s", __func__, sqlstate);
-          if (sqlstate && (strcmp (sqlstate, "57014") == 0))
-            {
-              /* query_canceled */
-              log_errors = 0;
-              g_debug ("%s: canceled SQL: %s", __func__, stmt->sql);
-            }
-          else if (sqlstate && (strcmp (sqlstate, "55P03") == 0))
+          ret = sql_cursor_open (stmt);
+          if (ret)
+            return ret;
+          ret = sql_cursor_fetch (stmt);
+          if (ret)
+            return ret;
+          stmt->executed = 1;
+        }
+      else
+        {
+          if (stmt->cache)
             {
-              /* lock_not_available */
-              g_debug ("%s: lock unavailable: %s",
-                       __func__,
-                       PQresultErrorMessage(result));
-              return -3;
+              const gchar *name;
+
+              name = prepared_cache_get (stmt);
+              if (name == NULL)
+                return -1;
+
+              result = PQexecPrepared (conn,
+                                       name,
+                                       stmt->param_values->len,
+                                       (const char* const*)
+                                        stmt->param_values->pdata,
+                                       (const int*) stmt->param_lengths->data,
+                                       (const int*) stmt->param_formats->data,
+                                       0);         /* Results as text. */
             }
-          else if (sqlstate && (strcmp (sqlstate, "23505") == 0))
+          else
+            result = PQexecParams (conn,
+                                   stmt->sql,
+                                   stmt->param_values->len,
+                                   NULL,           /* Default param types. */
+                                   (const char* const*)
+                                    stmt->param_values->pdata,
+                                   (const int*) stmt->param_lengths->data,
+                                   (const int*) stmt->param_formats->data,
+                                   0);             /* Results as text. */
+
+          ret = sql_result_check (stmt, result);
+          if (ret)
             {
-              /* unique_violation */
-              g_warning ("%s: constraint violation: %s",
-                         __func__,
-                         PQresultErrorMessage (result));
-              g_warning ("%s: SQL: %s", __func__, stmt->sql);
-              return -4;
+              PQclear (result);
+              return ret;
             }
 
-          if (log_errors)
-            {
-              g_warning ("%s: PQexec failed: %s (%i)",
-                         __func__,
-                         PQresultErrorMessage (result),
-                         PQresultStatus (result));
-              g_warning ("%s: SQL: %s", __func__, stmt->sql);
-            }
-#if 0
-          // FIX ?
-          PQclear (result);
-          PQfinish (conn);
-#endif
-          return -1;
+          stmt->result = result;
+          stmt->executed = 1;
         }
-
-      stmt->result = result;
-      stmt->executed = 1;
     }
 
   if (stmt->current_row < (PQntuples (stmt->result) - 1))
@@ -572,9 +1967,168 @@ sql_exec_internal (int retry, sql_stmt_t *stmt)
       return 1;
     }
 
+  if (stmt->cursor && PQntuples (stmt->result) == stmt->fetch_size)
+    {
+      /* End of the batch, so get the next one from the cursor. */
+      ret = sql_cursor_fetch (stmt);
+      if (ret)
+        return ret;
+      if (PQntuples (stmt->result) > 0)
+        {
+          stmt->current_row = 0;
+          return 1;
+        }
+    }
+
   return 0;
 }
 
+/**
+ * @brief Execute a prepared statement.
+ *
+ * Also counts statements, rows and time for sql_stats, and checks the
+ * deadline of the current command.
+ *
+ * @param[in]  retry  Whether to keep retrying while database is busy or locked.
+ * @param[in]  stmt   Statement.
+ *
+ * @return 0 complete, 1 row available in results, -1 error, -2 gave up,
+ *         -3 lock unavailable, -4 unique constraint violation.
+ */
+int
+sql_exec_internal (int retry, sql_stmt_t *stmt)
+{
+  gint64 start, elapsed;
+  int ret, locks;
+
+  locks = 0;
+  if (stmt->executed == 0)
+    {
+      stats_statements++;
+      /* Transactions run on the primary, so that a write inside one never
+       * has to move a transaction or its cursors between servers. */
+      if (replica_conn && conn == replica_conn && sql_begins (stmt->sql))
+        sql_replica_fall_back ();
+      if (replica_conn_info && conn == primary_conn && sql_writes (stmt->sql))
+        primary_written = g_get_monotonic_time ();
+      if (replica_session && conn == replica_conn
+          && sql_sets_session (stmt->sql))
+        {
+          /* The replica may now differ from the primary, so copy the
+           * settings again before the next command. */
+          g_free (replica_session);
+          replica_session = NULL;
+        }
+      locks = sql_locks (stmt->sql);
+    }
+
+  if (deadline)
+    sql_deadline_check (stmt);
+
+  /* Once the command has run out of time it only winds down.  Refusing
+   * everything but a ROLLBACK keeps autocommit writes after a cut short
+   * iteration from storing part of the work of the command. */
+  if (deadline_passed && sql_rolls_back (stmt->sql) == 0)
+    {
+      g_debug ("%s: deadline passed, refusing: %s", __func__, stmt->sql);
+      return -1;
+    }
+
+  start = g_get_monotonic_time ();
+  ret = sql_exec_step (retry, stmt);
+  if (ret == -5)
+    ret = sql_replica_fall_back () ? -1 : sql_exec_step (retry, stmt);
+  elapsed = g_get_monotonic_time () - start;
+  stats_time += elapsed;
+  stmt->time += elapsed;
+  if (locks)
+    sql_lock_wait (stmt->caller, elapsed);
+
+  if (ret == 1)
+    {
+      stats_rows++;
+      stmt->rows++;
+    }
+
+  if (explain_pending)
+    sql_explain_collect ();
+  return ret;
+}
+
+/**
+ * @brief Get the statement counters of this process.
+ *
+ * The counters only ever grow, so callers take the difference between two
+ * readings.
+ *
+ * @param[out]  statements  Number of statements executed.
+ * @param[out]  seconds     Time spent executing statements.
+ * @param[out]  rows        Number of rows returned.
+ */
+void
+sql_stats (long long *statements, double *seconds, long long *rows)
+{
+  *statements = stats_statements;
+  *seconds = stats_time / (double) G_USEC_PER_SEC;
+  *rows = stats_rows;
+}
+
+/**
+ * @brief Record the time that a call site waited for a lock.
+ *
+ * Statements that take a lock are recorded automatically, with the time
+ * of the whole statement.  Other locks, like lock files, are recorded by
+ * the caller.
+ *
+ * @param[in]  site          Static name of the call site.  NULL for unknown.
+ * @param[in]  microseconds  Time spent waiting.
+ */
+void
+sql_lock_wait (const char *site, gint64 microseconds)
+{
+  sql_lock_stats_t *stats;
+  double seconds;
+
+  if (site == NULL)
+    site = "(unknown)";
+
+  if (lock_stats == NULL)
+    lock_stats = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                        g_free);
+
+  stats = g_hash_table_lookup (lock_stats, site);
+  if (stats == NULL)
+    {
+      stats = g_malloc0 (sizeof (sql_lock_stats_t));
+      g_hash_table_insert (lock_stats, (gpointer) site, stats);
+    }
+
+  seconds = microseconds / (double) G_USEC_PER_SEC;
+  stats->count++;
+  stats->wait_time += seconds;
+  if (seconds > stats->max_wait)
+    stats->max_wait = seconds;
+}
+
+/**
+ * @brief Take the lock waits recorded since the previous call.
+ *
+ * @return Lock waits, keyed on call site, or NULL if there are none.  Caller
+ *         must destroy with g_hash_table_destroy.
+ */
+GHashTable *
+sql_lock_stats_take ()
+{
+  GHashTable *taken;
+
+  if (lock_stats == NULL || g_hash_table_size (lock_stats) == 0)
+    return NULL;
+
+  taken = lock_stats;
+  lock_stats = NULL;
+  return taken;
+}
+
 
 /* Transactions. */
 
@@ -605,10 +2159,19 @@ sql_begin_immediate_giveup ()
 
 /**
  * @brief Commit a transaction.
+ *
+ * Rolls back instead if the current command ran out of time, because the
+ * command may have stopped part way through.
  */
 void
 sql_commit ()
 {
+  if (deadline_passed)
+    {
+      g_debug ("%s: deadline passed, rolling back", __func__);
+      sql_rollback ();
+      return;
+    }
   sql ("COMMIT;");
 }
 
@@ -619,8 +2182,249 @@ void
 sql_rollback ()
 {
   sql ("ROLLBACK;");
+  if (deadline_passed)
+    /* The timeout may have outlived a failed transaction. */
+    sql_timeouts_reset ();
+}
+
+/**
+ * @brief Check whether a transaction is open.
+ *
+ * @return 1 if a transaction is open, including a failed one, else 0.
+ */
+int
+sql_in_transaction ()
+{
+  if (conn == NULL)
+    return 0;
+  switch (PQtransactionStatus (conn))
+    {
+      case PQTRANS_INTRANS:
+      case PQTRANS_INERROR:
+      case PQTRANS_ACTIVE:
+        return 1;
+      default:
+        return 0;
+    }
+}
+
+
+/* Notifications. */
+
+/**
+ * @brief Listen for notifications on a channel.
+ *
+ * @param[in]  channel  Channel name.
+ */
+void
+sql_listen (const char *channel)
+{
+  sql ("LISTEN %s;", channel);
+}
+
+/**
+ * @brief Send a notification on a channel.
+ *
+ * Inside a transaction the notification is only delivered on commit.
+ *
+ * @param[in]  channel  Channel name.
+ */
+void
+sql_notify (const char *channel)
+{
+  sql ("NOTIFY %s;", channel);
+}
+
+/**
+ * @brief Check for notifications on a channel.
+ *
+ * Consumes all notifications that have arrived, on any channel.
+ *
+ * @param[in]  channel  Channel name.
+ *
+ * @return 1 if a notification arrived on the channel, or the connection
+ *         failed, else 0.
+ */
+int
+sql_notified (const char *channel)
+{
+  PGnotify *notify;
+  int ret;
+
+  if (conn == NULL)
+    return 0;
+
+  if (PQconsumeInput (conn) == 0)
+    {
+      g_warning ("%s: PQconsumeInput failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return 1;
+    }
+
+  ret = 0;
+  while ((notify = PQnotifies (conn)))
+    {
+      if (strcmp (notify->relname, channel) == 0)
+        ret = 1;
+      PQfreemem (notify);
+    }
+  return ret;
+}
+
+/**
+ * @brief Get the socket of the database connection.
+ *
+ * The socket becomes readable when a notification arrives.
+ *
+ * @return Socket, or -1 if there is no connection.
+ */
+int
+sql_socket ()
+{
+  if (conn == NULL)
+    return -1;
+  return PQsocket (conn);
+}
+
+
+/* Bulk loading. */
+
+/**
+ * @brief Start a COPY FROM STDIN.
+ *
+ * @param[in]  sql  Format string for the COPY statement.
+ * @param[in]  ...  Arguments for format string.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_copy_start (const char *sql, ...)
+{
+  PGresult *result;
+  gchar *statement;
+  va_list args;
+
+  /* Like any other write, refused once the command ran out of time. */
+  if (deadline_passed)
+    return -1;
+
+  va_start (args, sql);
+  statement = g_strdup_vprintf (sql, args);
+  va_end (args);
+
+  result = PQexec (conn, statement);
+  if (PQresultStatus (result) != PGRES_COPY_IN)
+    {
+      g_warning ("%s: PQexec failed: %s (%i)",
+                 __func__,
+                 PQresultErrorMessage (result),
+                 PQresultStatus (result));
+      g_warning ("%s: SQL: %s", __func__, statement);
+      PQclear (result);
+      g_free (statement);
+      return -1;
+    }
+
+  PQclear (result);
+  g_free (statement);
+  return 0;
+}
+
+/**
+ * @brief Send rows to a COPY started with sql_copy_start.
+ *
+ * @param[in]  buffer  Rows in COPY text format.
+ * @param[in]  length  Length of buffer.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_copy_data (const char *buffer, int length)
+{
+  if (PQputCopyData (conn, buffer, length) != 1)
+    {
+      g_warning ("%s: PQputCopyData failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return -1;
+    }
+  return 0;
+}
+
+/**
+ * @brief End a COPY started with sql_copy_start.
+ *
+ * @param[in]  error  NULL to complete the COPY, else message to abort it with.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_copy_end (const char *error)
+{
+  PGresult *result;
+  int ret;
+
+  if (PQputCopyEnd (conn, error) != 1)
+    {
+      g_warning ("%s: PQputCopyEnd failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return -1;
+    }
+
+  ret = 0;
+  while ((result = PQgetResult (conn)))
+    {
+      if (PQresultStatus (result) != PGRES_COMMAND_OK && error == NULL)
+        {
+          g_warning ("%s: COPY failed: %s",
+                     __func__,
+                     PQresultErrorMessage (result));
+          ret = -1;
+        }
+      PQclear (result);
+    }
+  return ret;
+}
+
+/**
+ * @brief Append a value to a row in COPY text format.
+ *
+ * @param[in]  row    Row.
+ * @param[in]  value  Value.  NULL is passed to SQL as NULL.
+ * @param[in]  last   Whether this is the last value in the row.
+ */
+void
+sql_copy_append (GString *row, const char *value, int last)
+{
+  if (value == NULL)
+    g_string_append (row, "\\N");
+  else
+    for (; *value; value++)
+      switch (*value)
+        {
+          case '\\':
+            g_string_append (row, "\\\\");
+            break;
+          case '\t':
+            g_string_append (row, "\\t");
+            break;
+          case '\n':
+            g_string_append (row, "\\n");
+            break;
+          case '\r':
+            g_string_append (row, "\\r");
+            break;
+          default:
+            g_string_append_c (row, *value);
+            break;
+        }
+
+  g_string_append_c (row, last ? '\n' : '\t');
 }
 
+
 
 /* Iterators. */
 
@@ -637,7 +2441,8 @@ iterator_null (iterator_t* iterator, int col)
 {
   if (iterator->done) abort ();
   assert (iterator->stmt->result);
-  return PQgetisnull (iterator->stmt->result, 0, col);
+  return PQgetisnull (iterator->stmt->result, iterator->stmt->current_row,
+                      col);
 }
 
 /**
@@ -652,6 +2457,40 @@ iterator_rewind (iterator_t* iterator)
 {
   iterator->done = FALSE;
   iterator->stmt->current_row = -1;
+  if (iterator->stmt->cursor)
+    {
+      /* The cursor only goes forward, so run the statement again. */
+      sql_cursor_close (iterator->stmt);
+      PQclear (iterator->stmt->result);
+      iterator->stmt->result = NULL;
+      iterator->stmt->executed = 0;
+    }
+}
+
+/**
+ * @brief Make an iterator stream its rows instead of getting them all at once.
+ *
+ * The rows are fetched from a server-side cursor in batches of
+ * \p fetch_size, so that only one batch is held in memory at a time.
+ * This must be called before the first call to next.
+ *
+ * The iterator only streams when the first call to next happens inside a
+ * transaction, which the caller must keep open until the iterator is done.
+ * Otherwise the rows are fetched all at once as usual.  Ending the
+ * transaction while streaming is an error.
+ *
+ * @param[in]  iterator    Iterator.
+ * @param[in]  fetch_size  Number of rows per batch.
+ */
+void
+iterator_stream (iterator_t* iterator, int fetch_size)
+{
+  if (iterator->stmt->executed)
+    {
+      g_warning ("%s: iterator already executed", __func__);
+      return;
+    }
+  iterator->stmt->fetch_size = fetch_size > 0 ? fetch_size : 0;
 }
 
 
@@ -721,14 +2560,33 @@ sql_bind_text (sql_stmt_t *stmt, int position, const gchar *value,
   return 0;
 }
 
+/**
+ * @brief Bind a NULL value to a statement.
+ *
+ * @param[in]  stmt        Statement.
+ * @param[in]  position    Position in statement.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_bind_null (sql_stmt_t *stmt, int position)
+{
+  bind_param (stmt, position, NULL, 0, 0);
+  return 0;
+}
+
 /**
  * @brief Free a prepared statement.
  *
- * @param[in]  stmt  Statement.
+ * @param[in]  stmt  Statement.  NULL is ignored.
  */
 void
 sql_finalize (sql_stmt_t *stmt)
 {
+  if (stmt == NULL)
+    return;
+  sql_slow_check (stmt);
+  sql_cursor_close (stmt);
   PQclear (stmt->result);
   g_free (stmt->sql);
   array_free (stmt->param_values);
@@ -748,15 +2606,25 @@ int
 sql_reset (sql_stmt_t *stmt)
 {
   gchar *sql;
+  const char *caller;
+  int cache, fetch_size;
 
+  sql_slow_check (stmt);
+  sql_cursor_close (stmt);
   PQclear (stmt->result);
   array_free (stmt->param_values);
   g_array_free (stmt->param_lengths, TRUE);
   g_array_free (stmt->param_formats, TRUE);
 
   sql = stmt->sql;
+  cache = stmt->cache;
+  fetch_size = stmt->fetch_size;
+  caller = stmt->caller;
   sql_stmt_init (stmt);
   stmt->sql = sql;
+  stmt->cache = cache;
+  stmt->fetch_size = fetch_size;
+  stmt->caller = caller;
   return 0;
 }
 
@@ -27,6 +27,7 @@
 
 #include <glib.h>
 #include <gvm/util/xmlutils.h>
+#include <stdarg.h>
 #include <time.h>
 
 int
@@ -53,6 +54,54 @@ iso_time (time_t *);
 char *
 iso_time_tz (time_t *, const char *, const char **);
 
+/**
+ * @brief Size of a buffer that holds any ISO time.
+ */
+#define ISO_TIME_SIZE 100
+
+/**
+ * @brief Timezone context, for converting times without changing TZ.
+ */
+typedef struct tz_context tz_context_t;
+
+tz_context_t *
+tz_context (const char *);
+
+long
+tz_context_offset (tz_context_t *, time_t);
+
+int
+tz_context_iso_time (tz_context_t *, time_t, char *, size_t, const char **);
+
+time_t
+tz_context_mktime (tz_context_t *, const struct tm *);
+
+/**
+ * @brief Arena, for memory that is released all at once.
+ */
+typedef struct arena arena_t;
+
+arena_t *
+arena_new (gsize);
+
+gpointer
+arena_alloc (arena_t *, gsize);
+
+gchar *
+arena_strndup (arena_t *, const gchar *, gsize);
+
+gchar *
+arena_strdup (arena_t *, const gchar *);
+
+void
+arena_append (arena_t *, gchar **, const gchar *, gsize);
+
+void
+arena_clear (arena_t *);
+
+void
+arena_free (arena_t *);
+
 /**
  * @brief Lockfile.
  */
@@ -83,4 +132,16 @@ is_uuid (const char *);
 int
 parse_xml_file (const gchar *, entity_t *);
 
+void
+xml_string_append_escaped (GString *, const char *, gssize);
+
+gchar *
+xml_escape_text (const char *, gssize);
+
+void
+xml_string_vappend_escaped (GString *, const char *, va_list);
+
+gchar *
+xml_printf_escaped (const char *, ...) G_GNUC_PRINTF (1, 2);
+
 #endif /* not _GVMD_UTILS_H */
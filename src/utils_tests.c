@@ -64,6 +64,197 @@ Ensure (utils, gvm_sleep_sleep_for_1)
   assert_that (timespec_subtract (&end, &start), is_greater_than (NANOSECONDS - 1));
 }
 
+/* tz_context_iso_time */
+
+Ensure (utils, tz_context_iso_time_gives_z_for_utc)
+{
+  char buffer[ISO_TIME_SIZE];
+  const char *abbrev;
+
+  assert_that (tz_context_iso_time (tz_context ("UTC"), 1584436493, buffer,
+                                    sizeof (buffer), &abbrev),
+               is_equal_to (0));
+  assert_that (buffer, is_equal_to_string ("2020-03-17T09:14:53Z"));
+  assert_that (abbrev, is_equal_to_string ("UTC"));
+}
+
+Ensure (utils, tz_context_iso_time_follows_dst)
+{
+  char buffer[ISO_TIME_SIZE];
+
+  /* Winter and summer in Berlin. */
+  assert_that (tz_context_iso_time (tz_context ("Europe/Berlin"), 1584436493,
+                                    buffer, sizeof (buffer), NULL),
+               is_equal_to (0));
+  assert_that (buffer, is_equal_to_string ("2020-03-17T10:14:53+01:00"));
+  assert_that (tz_context_iso_time (tz_context ("Europe/Berlin"), 1592385293,
+                                    buffer, sizeof (buffer), NULL),
+               is_equal_to (0));
+  assert_that (buffer, is_equal_to_string ("2020-06-17T11:14:53+02:00"));
+}
+
+/* tz_context_mktime */
+
+Ensure (utils, tz_context_mktime_reverses_iso_time)
+{
+  struct tm tm;
+
+  memset (&tm, 0, sizeof (tm));
+  tm.tm_year = 2020 - 1900;
+  tm.tm_mon = 5;
+  tm.tm_mday = 17;
+  tm.tm_hour = 11;
+  tm.tm_min = 14;
+  tm.tm_sec = 53;
+  assert_that (tz_context_mktime (tz_context ("Europe/Berlin"), &tm),
+               is_equal_to (1592385293));
+}
+
+/* arena_append */
+
+Ensure (utils, arena_append_extends_in_place)
+{
+  arena_t *arena;
+  gchar *string, *first;
+
+  arena = arena_new (64);
+  string = NULL;
+  arena_append (arena, &string, "abc", 3);
+  first = string;
+  arena_append (arena, &string, "def", 3);
+  arena_append (arena, &string, "ghi", 3);
+  assert_that (string, is_equal_to_string ("abcdefghi"));
+  assert_that (string, is_equal_to (first));
+  arena_free (arena);
+}
+
+Ensure (utils, arena_append_copies_after_other_allocation)
+{
+  arena_t *arena;
+  gchar *string, *other;
+
+  arena = arena_new (64);
+  string = NULL;
+  arena_append (arena, &string, "abc", 3);
+  other = arena_strdup (arena, "xyz");
+  arena_append (arena, &string, "def", 3);
+  assert_that (string, is_equal_to_string ("abcdef"));
+  assert_that (other, is_equal_to_string ("xyz"));
+  arena_free (arena);
+}
+
+Ensure (utils, arena_append_grows_past_block)
+{
+  arena_t *arena;
+  gchar *string;
+  int index;
+
+  arena = arena_new (64);
+  string = NULL;
+  for (index = 0; index < 100; index++)
+    arena_append (arena, &string, "0123456789", 10);
+  assert_that (strlen (string), is_equal_to (1000));
+  assert_that (string[995], is_equal_to ('5'));
+  arena_clear (arena);
+  assert_that (arena_strdup (arena, "after"), is_equal_to_string ("after"));
+  arena_free (arena);
+}
+
+Ensure (utils, arena_append_grows_geometrically)
+{
+  arena_t *arena;
+  gchar *string, *previous;
+  int index, moves;
+
+  arena = arena_new (64);
+  string = NULL;
+  arena_append (arena, &string, "0123456789", 10);
+  moves = 0;
+  for (index = 1; index < 1000; index++)
+    {
+      previous = string;
+      arena_append (arena, &string, "0123456789", 10);
+      if (string != previous)
+        moves++;
+    }
+  assert_that (strlen (string), is_equal_to (10000));
+  assert_that (string[9995], is_equal_to ('5'));
+  assert_that (moves, is_less_than (20));
+  arena_free (arena);
+}
+
+/* xml_escape_text */
+
+Ensure (utils, xml_escape_text_copies_plain_text)
+{
+  gchar *escaped;
+
+  escaped = xml_escape_text ("A line of plain text.\tWith a tab.\n", -1);
+  assert_that (escaped,
+               is_equal_to_string ("A line of plain text.\tWith a tab.\n"));
+  g_free (escaped);
+}
+
+Ensure (utils, xml_escape_text_escapes_like_g_markup_escape_text)
+{
+  const char *texts[] = { "<a href=\"x\">Tom & Jerry's</a>",
+                          "0123456789abcdef<0123456789abcdef>",
+                          "bell \a and DEL \x7F",
+                          "C1 \xC2\x80 NEL \xC2\x85 NBSP \xC2\xA0",
+                          "UTF-8 \xC3\xA4\xE2\x82\xAC & more",
+                          "" };
+  int index;
+
+  for (index = 0; index < 6; index++)
+    {
+      gchar *escaped, *expected;
+
+      escaped = xml_escape_text (texts[index], -1);
+      expected = g_markup_escape_text (texts[index], -1);
+      assert_that (escaped, is_equal_to_string (expected));
+      g_free (escaped);
+      g_free (expected);
+    }
+}
+
+Ensure (utils, xml_escape_text_stops_at_length)
+{
+  gchar *escaped;
+
+  escaped = xml_escape_text ("a<b<c", 3);
+  assert_that (escaped, is_equal_to_string ("a&lt;b"));
+  g_free (escaped);
+}
+
+/* xml_printf_escaped */
+
+Ensure (utils, xml_printf_escaped_escapes_string_arguments)
+{
+  gchar *xml;
+
+  xml = xml_printf_escaped ("<a x=\"%s\">%s%%</a>", "1 < 2", "&");
+  assert_that (xml, is_equal_to_string ("<a x=\"1 &lt; 2\">&amp;%</a>"));
+  g_free (xml);
+}
+
+Ensure (utils, xml_printf_escaped_handles_other_conversions)
+{
+  gchar *xml;
+
+  xml = xml_printf_escaped ("<n>%i %s</n>", 7, "<");
+  assert_that (xml, is_equal_to_string ("<n>7 &lt;</n>"));
+  g_free (xml);
+}
+
+Ensure (utils, xml_printf_escaped_keeps_trailing_percent)
+{
+  gchar *xml;
+
+  xml = xml_printf_escaped ("<p>%s 100%", "<");
+  assert_that (xml, is_equal_to_string ("<p>&lt; 100%"));
+  g_free (xml);
+}
+
 /* Test suite. */
 
 int
@@ -79,6 +270,29 @@ main (int argc, char **argv)
   add_test_with_context (suite, utils, gvm_sleep_sleep_for_0);
   add_test_with_context (suite, utils, gvm_sleep_sleep_for_1);
 
+  add_test_with_context (suite, utils, tz_context_iso_time_gives_z_for_utc);
+  add_test_with_context (suite, utils, tz_context_iso_time_follows_dst);
+
+  add_test_with_context (suite, utils, tz_context_mktime_reverses_iso_time);
+
+  add_test_with_context (suite, utils, arena_append_extends_in_place);
+  add_test_with_context (suite, utils,
+                         arena_append_copies_after_other_allocation);
+  add_test_with_context (suite, utils, arena_append_grows_past_block);
+  add_test_with_context (suite, utils, arena_append_grows_geometrically);
+
+  add_test_with_context (suite, utils, xml_escape_text_copies_plain_text);
+  add_test_with_context (suite, utils,
+                         xml_escape_text_escapes_like_g_markup_escape_text);
+  add_test_with_context (suite, utils, xml_escape_text_stops_at_length);
+
+  add_test_with_context (suite, utils,
+                         xml_printf_escaped_escapes_string_arguments);
+  add_test_with_context (suite, utils,
+                         xml_printf_escaped_handles_other_conversions);
+  add_test_with_context (suite, utils,
+                         xml_printf_escaped_keeps_trailing_percent);
+
   if (argc > 1)
     return run_single_test (suite, argv[1], create_text_reporter ());
 